@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Console output batching
+ *
+ * The output is written by any context into a byte ring buffer, and
+ * flushed by the console driver. The driver is notified once per batch:
+ * either when the pending output reaches the threshold, or when the
+ * timer started by the first character of the batch expires.
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <misc/util.h>
+
+#include <console/console_batch.h>
+
+static inline void batch_notify(struct console_batch *batch)
+{
+	if (batch->flush) {
+		batch->flush(batch);
+	}
+}
+
+static void batch_expired(struct k_timer *timer)
+{
+	struct console_batch *batch =
+		CONTAINER_OF(timer, struct console_batch, timer);
+	bool notify = false;
+	int key;
+
+	key = irq_lock();
+
+	if (batch->head != batch->tail && !batch->notified) {
+		batch->notified = true;
+		notify = true;
+	}
+
+	irq_unlock(key);
+
+	if (notify) {
+		batch_notify(batch);
+	}
+}
+
+int console_batch_init(struct console_batch *batch, u8_t *buf, u32_t size,
+		       u32_t threshold, s32_t interval,
+		       console_batch_flush_t flush)
+{
+	if (!is_power_of_two(size)) {
+		return -EINVAL;
+	}
+
+	batch->buf = buf;
+	batch->mask = size - 1;
+	batch->head = 0;
+	batch->tail = 0;
+	batch->threshold = min(max(threshold, 1), size);
+	batch->interval = interval;
+	batch->dropped = 0;
+	batch->flush = flush;
+	batch->notified = false;
+
+	k_timer_init(&batch->timer, batch_expired, NULL);
+
+	return 0;
+}
+
+int console_batch_put(struct console_batch *batch, u8_t c)
+{
+	bool notify = false;
+	u32_t pending;
+	int key;
+
+	key = irq_lock();
+
+	pending = batch->head - batch->tail;
+	if (pending > batch->mask) {
+		batch->dropped++;
+		irq_unlock(key);
+
+		return -ENOSPC;
+	}
+
+	batch->buf[batch->head & batch->mask] = c;
+	batch->head++;
+
+	if (!pending) {
+		k_timer_start(&batch->timer, K_MSEC(batch->interval), 0);
+	}
+
+	if (pending + 1 >= batch->threshold && !batch->notified) {
+		batch->notified = true;
+		notify = true;
+	}
+
+	irq_unlock(key);
+
+	if (notify) {
+		batch_notify(batch);
+	}
+
+	return 0;
+}
+
+u32_t console_batch_peek(struct console_batch *batch, u8_t **data)
+{
+	u32_t tail = batch->tail & batch->mask;
+	u32_t pending;
+	int key;
+
+	key = irq_lock();
+	pending = batch->head - batch->tail;
+	irq_unlock(key);
+
+	*data = &batch->buf[tail];
+
+	return min(pending, batch->mask + 1 - tail);
+}
+
+void console_batch_consume(struct console_batch *batch, u32_t len)
+{
+	int key;
+
+	key = irq_lock();
+
+	batch->tail += len;
+	if (batch->head == batch->tail) {
+		batch->notified = false;
+	}
+
+	irq_unlock(key);
+}
+
+void console_batch_reset(struct console_batch *batch)
+{
+	int key;
+
+	k_timer_stop(&batch->timer);
+
+	key = irq_lock();
+
+	batch->tail = batch->head;
+	batch->notified = false;
+
+	irq_unlock(key);
+}
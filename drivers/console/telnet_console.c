@@ -25,6 +25,8 @@
 #include <misc/printk.h>
 
 #include <console/console.h>
+#include <console/console_batch.h>
+#include <console/telnet_console.h>
 #include <net/buf.h>
 #include <net/net_pkt.h>
 #include <net/net_ip.h>
@@ -36,49 +38,35 @@
 #define TELNET_PORT		CONFIG_TELNET_CONSOLE_PORT
 #define TELNET_STACK_SIZE	CONFIG_TELNET_CONSOLE_THREAD_STACK
 #define TELNET_PRIORITY		CONFIG_TELNET_CONSOLE_PRIO
-#define TELNET_LINES		CONFIG_TELNET_CONSOLE_LINE_BUF_NUMBERS
-#define TELNET_LINE_SIZE	CONFIG_TELNET_CONSOLE_LINE_BUF_SIZE
-#define TELNET_TIMEOUT		K_MSEC(CONFIG_TELNET_CONSOLE_SEND_TIMEOUT)
+#define TELNET_BUF_SIZE		CONFIG_TELNET_CONSOLE_BUF_SIZE
+#define TELNET_TIMEOUT		CONFIG_TELNET_CONSOLE_SEND_TIMEOUT
 #define TELNET_THRESHOLD	CONFIG_TELNET_CONSOLE_SEND_THRESHOLD
 
 #define TELNET_MIN_MSG		2
 
-/* These 2 structures below are used to store the console output
- * before sending it to the client. This is done to keep some
- * reactivity: the ring buffer is non-protected, if first line has
- * not been sent yet, and if next line is reaching the same index in rb,
- * the first one will be replaced. In a perfect world, this should
- * not happen. However on a loaded system with a lot of debug output
- * this is bound to happen eventualy, moreover if it does not have
- * the luxury to bufferize as much as it wants to. Just raise
- * CONFIG_TELNET_CONSOLE_LINE_BUF_NUMBERS if possible.
+/* The TCP stack does not split the data it is given into segments,
+ * so the output is sent in chunks no larger than the default MSS
+ * (RFC 879), which any client accepts.
  */
-struct line_buf {
-	char buf[TELNET_LINE_SIZE];
-	u16_t len;
-};
-
-struct line_buf_rb {
-	struct line_buf l_bufs[TELNET_LINES];
-	u16_t line_in;
-	u16_t line_out;
-};
+#define TELNET_SEGMENT_SIZE	536
+
+/* The console output is aggregated in this batch before being sent to
+ * the client: the telnet thread is woken up once TELNET_THRESHOLD bytes
+ * are pending, or TELNET_TIMEOUT milliseconds after the first pending
+ * byte was written, so that a long dump goes out in a few large segments
+ * while a lone shell prompt still shows up quickly. Output that does
+ * not fit in the buffer is dropped and counted.
+ */
+BUILD_ASSERT_MSG((TELNET_BUF_SIZE & (TELNET_BUF_SIZE - 1)) == 0,
+		 "CONFIG_TELNET_CONSOLE_BUF_SIZE must be a power of two");
 
-static struct line_buf_rb telnet_rb;
+static u8_t telnet_buf[TELNET_BUF_SIZE];
+static struct console_batch telnet_batch;
 
 static K_THREAD_STACK_DEFINE(telnet_stack, TELNET_STACK_SIZE);
 static struct k_thread telnet_thread_data;
 static K_SEM_DEFINE(send_lock, 0, UINT_MAX);
 
-/* The timer is used to send non-lf terminated output that has
- * been around for "tool long". This will prove to be useful
- * to send the shell prompt for instance.
- * ToDo: raise the time, incrementaly, when no output is coming
- *       so the timer will kick in less and less.
- */
-static void telnet_send_prematurely(struct k_timer *timer);
-static K_TIMER_DEFINE(send_timer, telnet_send_prematurely, NULL);
-
 /* For now we handle a unique telnet client connection */
 static struct net_context *client_cnx;
 static struct net_pkt *out_pkt;
@@ -95,33 +83,20 @@ static struct telnet_simple_command telnet_cmd;
 extern void __printk_hook_install(int (*fn)(int));
 extern void *__printk_get_hook(void);
 
-static void telnet_rb_init(void)
-{
-	int i;
-
-	telnet_rb.line_in = 0;
-	telnet_rb.line_out = 0;
-
-	for (i = 0; i < TELNET_LINES; i++) {
-		telnet_rb.l_bufs[i].len = 0;
-	}
-}
-
 static void telnet_end_client_connection(void)
 {
 	__printk_hook_install(orig_printk_hook);
 	orig_printk_hook = NULL;
 
-	k_timer_stop(&send_timer);
-
 	net_context_put(client_cnx);
 	client_cnx = NULL;
 
 	if (out_pkt) {
 		net_pkt_unref(out_pkt);
+		out_pkt = NULL;
 	}
 
-	telnet_rb_init();
+	console_batch_reset(&telnet_batch);
 }
 
 static int telnet_setup_out_pkt(struct net_context *client)
@@ -135,68 +110,19 @@ static int telnet_setup_out_pkt(struct net_context *client)
 	return 0;
 }
 
-static void telnet_rb_switch(void)
+static void telnet_batch_flush(struct console_batch *batch)
 {
-	telnet_rb.line_in++;
-
-	if (telnet_rb.line_in == TELNET_LINES) {
-		telnet_rb.line_in = 0;
-	}
-
-	telnet_rb.l_bufs[telnet_rb.line_in].len = 0;
-
-	/* Unfortunately, we don't have enough line buffer,
-	 * so we eat the next to be sent.
-	 */
-	if (telnet_rb.line_in == telnet_rb.line_out) {
-		telnet_rb.line_out++;
-		if (telnet_rb.line_out == TELNET_LINES) {
-			telnet_rb.line_out = 0;
-		}
-	}
-
-	k_timer_start(&send_timer, TELNET_TIMEOUT, TELNET_TIMEOUT);
 	k_sem_give(&send_lock);
 }
 
-static inline struct line_buf *telnet_rb_get_line_out(void)
-{
-	u16_t out = telnet_rb.line_out;
-
-	telnet_rb.line_out++;
-	if (telnet_rb.line_out == TELNET_LINES) {
-		telnet_rb.line_out = 0;
-	}
-
-	if (!telnet_rb.l_bufs[out].len) {
-		return NULL;
-	}
-
-	return &telnet_rb.l_bufs[out];
-}
-
-static inline struct line_buf *telnet_rb_get_line_in(void)
-{
-	return &telnet_rb.l_bufs[telnet_rb.line_in];
-}
-
 /* The actual printk hook */
 static int telnet_console_out(int c)
 {
-	int key = irq_lock();
-	struct line_buf *lb = telnet_rb_get_line_in();
-	bool yield = false;
-
-	lb->buf[lb->len++] = (char)c;
-
-	if (c == '\n' || lb->len == TELNET_LINE_SIZE - 1) {
-		lb->buf[lb->len-1] = NVT_CR;
-		lb->buf[lb->len++] = NVT_LF;
-		telnet_rb_switch();
-		yield = true;
+	if (c == '\n') {
+		console_batch_put(&telnet_batch, NVT_CR);
 	}
 
-	irq_unlock(key);
+	console_batch_put(&telnet_batch, (u8_t)c);
 
 #ifdef CONFIG_TELNET_CONSOLE_DEBUG_DEEP
 	/* This is ugly, but if one wants to debug telnet, it
@@ -205,22 +131,9 @@ static int telnet_console_out(int c)
 	orig_printk_hook(c);
 #endif
 
-	if (yield) {
-		k_yield();
-	}
-
 	return c;
 }
 
-static void telnet_send_prematurely(struct k_timer *timer)
-{
-	struct line_buf *lb = telnet_rb_get_line_in();
-
-	if (lb->len >= TELNET_THRESHOLD) {
-		telnet_rb_switch();
-	}
-}
-
 static void telnet_sent_cb(struct net_context *client,
 			   int status, void *token, void *user_data)
 {
@@ -230,26 +143,59 @@ static void telnet_sent_cb(struct net_context *client,
 	}
 }
 
-static inline bool telnet_send(void)
+static bool telnet_send_pkt(void)
 {
-	struct line_buf *lb = telnet_rb_get_line_out();
+	if (net_context_send(out_pkt, telnet_sent_cb,
+			     K_NO_WAIT, NULL, NULL) ||
+	    telnet_setup_out_pkt(client_cnx)) {
+		return false;
+	}
 
-	if (lb) {
-		net_pkt_append_all(out_pkt, lb->len, lb->buf, K_FOREVER);
+	return true;
+}
 
-		/* We reinitialize the line buffer */
-		lb->len = 0;
+/* Sends all the pending output, in as few segments as possible */
+static bool telnet_send(void)
+{
+	u16_t pkt_len = 0;
+	u8_t *data;
+	u32_t len;
 
-		if (net_context_send(out_pkt, telnet_sent_cb,
-				     K_NO_WAIT, NULL, NULL) ||
-		    telnet_setup_out_pkt(client_cnx)) {
+	if (!client_cnx) {
+		return true;
+	}
+
+	while ((len = console_batch_peek(&telnet_batch, &data))) {
+		len = min(len, TELNET_SEGMENT_SIZE - pkt_len);
+
+		if (!net_pkt_append_all(out_pkt, len, data, K_FOREVER)) {
 			return false;
 		}
+
+		console_batch_consume(&telnet_batch, len);
+		pkt_len += len;
+
+		if (pkt_len == TELNET_SEGMENT_SIZE) {
+			if (!telnet_send_pkt()) {
+				return false;
+			}
+
+			pkt_len = 0;
+		}
+	}
+
+	if (pkt_len) {
+		return telnet_send_pkt();
 	}
 
 	return true;
 }
 
+u32_t telnet_console_dropped(void)
+{
+	return console_batch_dropped(&telnet_batch);
+}
+
 #ifdef CONFIG_TELNET_CONSOLE_SUPPORT_COMMAND
 
 static int telnet_console_out_nothing(int c)
@@ -303,7 +249,7 @@ static inline void telnet_reply_command(void)
 	case NVT_CMD_AO:
 		/* OK, no output then */
 		__printk_hook_install(telnet_console_out_nothing);
-		telnet_rb_init();
+		console_batch_reset(&telnet_batch);
 		break;
 	case NVT_CMD_AYT:
 		telnet_reply_ay_command();
@@ -411,7 +357,7 @@ static void telnet_recv(struct net_context *client,
 	net_pkt_unref(pkt);
 }
 
-/* Telnet server loop, used to send buffered output in the RB */
+/* Telnet server loop, used to send the batched output */
 static void telnet_run(void)
 {
 	while (true) {
@@ -458,7 +404,6 @@ static void telnet_accept(struct net_context *client,
 	__printk_hook_install(telnet_console_out);
 
 	client_cnx = client;
-	k_timer_start(&send_timer, TELNET_TIMEOUT, TELNET_TIMEOUT);
 
 	return;
 error:
@@ -531,6 +476,13 @@ static int telnet_console_init(struct device *arg)
 	static struct net_context *ctx6;
 #endif
 
+	if (console_batch_init(&telnet_batch, telnet_buf, sizeof(telnet_buf),
+			       TELNET_THRESHOLD, TELNET_TIMEOUT,
+			       telnet_batch_flush)) {
+		SYS_LOG_ERR("Cannot initialize the output buffer");
+		return -EINVAL;
+	}
+
 #ifdef CONFIG_NET_IPV4
 	telnet_setup_server(&ctx4, AF_INET,
 			    (struct sockaddr *)&any_addr4,
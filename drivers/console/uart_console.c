@@ -28,6 +28,7 @@
 #include <uart.h>
 #include <console/console.h>
 #include <console/uart_console.h>
+#include <console/console_batch.h>
 #include <toolchain.h>
 #include <linker/sections.h>
 #include <atomic.h>
@@ -79,6 +80,70 @@ static int console_in(void)
 }
 #endif
 
+#ifdef CONFIG_UART_CONSOLE_BATCH
+BUILD_ASSERT_MSG((CONFIG_UART_CONSOLE_BATCH_BUF_SIZE &
+		  (CONFIG_UART_CONSOLE_BATCH_BUF_SIZE - 1)) == 0,
+		 "CONFIG_UART_CONSOLE_BATCH_BUF_SIZE must be a power of two");
+
+static u8_t batch_buf[CONFIG_UART_CONSOLE_BATCH_BUF_SIZE];
+static struct console_batch batch;
+static struct k_work batch_work;
+
+static void batch_write(struct k_work *work)
+{
+	u8_t *data;
+	u32_t len, i;
+
+	while ((len = console_batch_peek(&batch, &data))) {
+		for (i = 0; i < len; i++) {
+			uart_poll_out(uart_console_dev, data[i]);
+		}
+
+		console_batch_consume(&batch, len);
+	}
+}
+
+static void batch_flush(struct console_batch *batch)
+{
+	k_work_submit(&batch_work);
+}
+
+/* The output is written directly until the system workqueue runs */
+static bool batch_ready;
+
+static int batch_init(struct device *arg)
+{
+	ARG_UNUSED(arg);
+
+	k_work_init(&batch_work, batch_write);
+	/* The output keeps being written directly if this fails */
+	batch_ready = !console_batch_init(&batch, batch_buf, sizeof(batch_buf),
+					  CONFIG_UART_CONSOLE_BATCH_THRESHOLD,
+					  CONFIG_UART_CONSOLE_BATCH_INTERVAL,
+					  batch_flush);
+
+	return 0;
+}
+
+SYS_INIT(batch_init, POST_KERNEL, CONFIG_UART_CONSOLE_INIT_PRIORITY);
+
+u32_t uart_console_dropped(void)
+{
+	return console_batch_dropped(&batch);
+}
+
+static inline void console_putc(u8_t c)
+{
+	if (batch_ready) {
+		console_batch_put(&batch, c);
+	} else {
+		uart_poll_out(uart_console_dev, c);
+	}
+}
+#else
+#define console_putc(c) uart_poll_out(uart_console_dev, c)
+#endif /* CONFIG_UART_CONSOLE_BATCH */
+
 #if defined(CONFIG_PRINTK) || defined(CONFIG_STDOUT_CONSOLE)
 /**
  *
@@ -104,9 +169,9 @@ static int console_out(int c)
 #endif /* CONFIG_UART_CONSOLE_DEBUG_SERVER_HOOKS */
 
 	if ('\n' == c) {
-		uart_poll_out(uart_console_dev, '\r');
+		console_putc('\r');
 	}
-	uart_poll_out(uart_console_dev, c);
+	console_putc(c);
 
 	return c;
 }
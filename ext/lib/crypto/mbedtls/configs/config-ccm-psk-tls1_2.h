@@ -92,6 +92,19 @@
  */
 #define MBEDTLS_SSL_MAX_CONTENT_LEN             512
 
+/* Session resumption, see CONFIG_MBEDTLS_SSL_SESSION_CACHE and
+ * CONFIG_MBEDTLS_SSL_SESSION_TICKETS
+ */
+#if defined(CONFIG_MBEDTLS_SSL_SESSION_CACHE)
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES CONFIG_MBEDTLS_SSL_SESSION_CACHE_SIZE
+#endif
+
+#if defined(CONFIG_MBEDTLS_SSL_SESSION_TICKETS)
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_SSL_TICKET_C
+#endif
+
 #include "mbedtls/check_config.h"
 
 #endif /* MBEDTLS_CONFIG_H */
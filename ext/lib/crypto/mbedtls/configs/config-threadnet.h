@@ -102,6 +102,19 @@
 /* Save ROM and a few bytes of RAM by specifying our own ciphersuite list */
 #define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECJPAKE_WITH_AES_128_CCM_8
 
+/* Session resumption, see CONFIG_MBEDTLS_SSL_SESSION_CACHE and
+ * CONFIG_MBEDTLS_SSL_SESSION_TICKETS
+ */
+#if defined(CONFIG_MBEDTLS_SSL_SESSION_CACHE)
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES CONFIG_MBEDTLS_SSL_SESSION_CACHE_SIZE
+#endif
+
+#if defined(CONFIG_MBEDTLS_SSL_SESSION_TICKETS)
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_SSL_TICKET_C
+#endif
+
 #include "mbedtls/check_config.h"
 
 #endif /* MBEDTLS_CONFIG_H */
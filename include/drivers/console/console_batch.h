@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Console output batching
+ *
+ * Aggregates the console output in a ring buffer, so that a console
+ * driver can send it in large chunks instead of character by character
+ * or line by line. As with the Nagle algorithm, the driver is asked to
+ * flush once enough output is pending, or once the oldest pending
+ * output has waited for long enough.
+ */
+
+#ifndef __CONSOLE_BATCH_H__
+#define __CONSOLE_BATCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <kernel.h>
+
+struct console_batch;
+
+/**
+ * @brief Callback asking the driver to flush the pending output.
+ *
+ * Called from the context writing the output or from the timer
+ * interrupt, it must not block: it is meant to wake up the thread
+ * that will call console_batch_peek() and console_batch_consume().
+ */
+typedef void (*console_batch_flush_t)(struct console_batch *batch);
+
+/**
+ * @brief Console output batch.
+ *
+ * The head and tail indexes are free running, the buffer size being a
+ * power of two.
+ */
+struct console_batch {
+	u8_t *buf;
+	u32_t mask;
+	u32_t head;
+	u32_t tail;
+	u32_t threshold;
+	s32_t interval;
+	u32_t dropped;
+	console_batch_flush_t flush;
+	struct k_timer timer;
+	bool notified;
+};
+
+/**
+ * @brief Initializes a console output batch.
+ *
+ * @param batch Batch to be initialized
+ * @param buf Buffer storing the pending output
+ * @param size Size of @a buf, must be a power of two
+ * @param threshold Amount of pending output, in bytes, triggering a flush
+ * @param interval Time, in milliseconds, after which the pending output
+ * is flushed even if @a threshold is not reached
+ * @param flush Callback asking the driver to flush the pending output
+ *
+ * @return 0 in case of success, -EINVAL if @a size is not a power of two.
+ */
+int console_batch_init(struct console_batch *batch, u8_t *buf, u32_t size,
+		       u32_t threshold, s32_t interval,
+		       console_batch_flush_t flush);
+
+/**
+ * @brief Adds a character to the pending output.
+ *
+ * Can be called from any context.
+ *
+ * @param batch Batch the character is added to
+ * @param c Character to be added
+ *
+ * @return 0 in case of success, -ENOSPC if the batch is full, the
+ * character then being dropped and counted as such.
+ */
+int console_batch_put(struct console_batch *batch, u8_t c);
+
+/**
+ * @brief Gets the oldest contiguous chunk of pending output.
+ *
+ * The chunk stays in the batch until console_batch_consume() is called.
+ * Only the driver flushing the output may call this function.
+ *
+ * @param batch Batch holding the output
+ * @param data Filled with the start of the chunk
+ *
+ * @return Length of the chunk, 0 if no output is pending.
+ */
+u32_t console_batch_peek(struct console_batch *batch, u8_t **data);
+
+/**
+ * @brief Removes flushed output from the batch.
+ *
+ * @param batch Batch holding the output
+ * @param len Length of the output flushed, at most the length returned
+ * by the last call to console_batch_peek()
+ */
+void console_batch_consume(struct console_batch *batch, u32_t len);
+
+/**
+ * @brief Drops the pending output, without counting it as dropped.
+ *
+ * @param batch Batch to be emptied
+ */
+void console_batch_reset(struct console_batch *batch);
+
+/**
+ * @brief Gets the number of characters dropped because the batch was
+ * full.
+ *
+ * @param batch Batch to query
+ *
+ * @return Number of characters dropped since the initialization.
+ */
+static inline u32_t console_batch_dropped(struct console_batch *batch)
+{
+	return batch->dropped;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONSOLE_BATCH_H__ */
@@ -30,6 +30,15 @@ extern "C" {
 void telnet_register_input(struct k_fifo *avail, struct k_fifo *lines,
 			   u8_t (*completion)(char *str, u8_t len));
 
+/** @brief Get the amount of console output dropped
+ *
+ *  Output is dropped when written while the output buffer is full,
+ *  see CONFIG_TELNET_CONSOLE_BUF_SIZE.
+ *
+ *  @return Number of bytes dropped since boot.
+ */
+u32_t telnet_console_dropped(void);
+
 #ifdef __cplusplus
 }
 #endif
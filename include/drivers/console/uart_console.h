@@ -32,6 +32,17 @@ extern "C" {
 void uart_register_input(struct k_fifo *avail, struct k_fifo *lines,
 			 u8_t (*completion)(char *str, u8_t len));
 
+#ifdef CONFIG_UART_CONSOLE_BATCH
+/** @brief Get the amount of console output dropped
+ *
+ *  Output is dropped when written while the batching buffer is full,
+ *  see CONFIG_UART_CONSOLE_BATCH_BUF_SIZE.
+ *
+ *  @return Number of bytes dropped since boot.
+ */
+u32_t uart_console_dropped(void);
+#endif
+
 /*
  * Allows having debug hooks in the console driver for handling incoming
  * control characters, and letting other ones through.
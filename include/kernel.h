@@ -1458,6 +1458,20 @@ static inline int k_queue_is_empty(struct k_queue *queue)
 	return (int)sys_slist_is_empty(&queue->data_q);
 }
 
+/**
+ * @brief Peek element at the head of queue.
+ *
+ * Return element from the head of queue without removing it.
+ *
+ * @param queue Address of the queue.
+ *
+ * @return Head element, or NULL if queue is empty.
+ */
+static inline void *k_queue_peek_head(struct k_queue *queue)
+{
+	return sys_slist_peek_head(&queue->data_q);
+}
+
 /**
  * @brief Statically define and initialize a queue.
  *
@@ -1615,6 +1629,22 @@ struct k_fifo {
 #define k_fifo_is_empty(fifo) \
 	k_queue_is_empty((struct k_queue *) fifo)
 
+/**
+ * @brief Peek element at the head of fifo.
+ *
+ * Return element from the head of fifo without removing it. A usecase
+ * for this is if elements of the fifo are themselves containers. Then
+ * on each iteration of processing, a head container will be peeked,
+ * and some data processed out of it, and only if the container is empty,
+ * it will be completely removed from the fifo.
+ *
+ * @param fifo Address of the fifo.
+ *
+ * @return Head element, or NULL if the fifo is empty.
+ */
+#define k_fifo_peek_head(fifo) \
+	k_queue_peek_head((struct k_queue *) fifo)
+
 /**
  * @brief Statically define and initialize a fifo.
  *
@@ -386,6 +386,13 @@ static inline void net_buf_simple_restore(struct net_buf_simple *buf,
   */
 #define NET_BUF_FRAGS        BIT(0)
 
+/** Flag indicating that the data pointer of the buffer does not point
+  * into the buffer's own storage but into memory owned by someone else,
+  * e.g. a constant in flash. Such a buffer has no headroom nor tailroom
+  * and its data must be treated as read-only.
+  */
+#define NET_BUF_EXTERNAL_DATA BIT(1)
+
 /** @brief Network buffer representation.
   *
   * This struct is used to represent network buffers. Such buffers are
@@ -462,6 +469,12 @@ struct net_buf_pool {
 	/** Amount of available buffers in the pool. */
 	s16_t avail_count;
 
+	/** Lowest amount of available buffers seen so far, i.e. the
+	 *  pool has never had more than buf_count - min_avail_count
+	 *  buffers allocated at the same time.
+	 */
+	s16_t min_avail_count;
+
 	/** Total size of the pool. */
 	const u16_t pool_size;
 
@@ -485,6 +498,7 @@ struct net_buf_pool {
 		.buf_count = _count,                                         \
 		.uninit_count = _count,                                      \
 		.avail_count = _count,                                       \
+		.min_avail_count = _count,                                   \
 		.pool_size = sizeof(_net_buf_##_pool),                  \
 		.buf_size = _size,                                           \
 		.user_data_size = _ud_size,                                  \
@@ -667,6 +681,8 @@ struct net_buf *net_buf_ref(struct net_buf *buf);
  *  @brief Duplicate buffer
  *
  *  Duplicate given buffer including any data and headers currently stored.
+ *  Buffers referring to external data (NET_BUF_EXTERNAL_DATA) cannot be
+ *  duplicated.
  *
  *  @param buf A valid pointer on a buffer
  *  @param timeout Affects the action taken should the pool be empty.
@@ -915,28 +931,42 @@ static inline void *net_buf_user_data(struct net_buf *buf)
 #define net_buf_pull_be32(buf) net_buf_simple_pull_be32(&(buf)->b)
 
 /**
- *  @def net_buf_tailroom
  *  @brief Check buffer tailroom.
  *
  *  Check how much free space there is at the end of the buffer.
+ *  Buffers referring to external data never have any tailroom.
  *
  *  @param buf A valid pointer on a buffer
  *
  *  @return Number of bytes available at the end of the buffer.
  */
-#define net_buf_tailroom(buf) net_buf_simple_tailroom(&(buf)->b)
+static inline size_t net_buf_tailroom(struct net_buf *buf)
+{
+	if (buf->flags & NET_BUF_EXTERNAL_DATA) {
+		return 0;
+	}
+
+	return net_buf_simple_tailroom(&buf->b);
+}
 
 /**
- *  @def net_buf_headroom
  *  @brief Check buffer headroom.
  *
  *  Check how much free space there is in the beginning of the buffer.
+ *  Buffers referring to external data never have any headroom.
  *
  *  buf A valid pointer on a buffer
  *
  *  @return Number of bytes available in the beginning of the buffer.
  */
-#define net_buf_headroom(buf) net_buf_simple_headroom(&(buf)->b)
+static inline size_t net_buf_headroom(struct net_buf *buf)
+{
+	if (buf->flags & NET_BUF_EXTERNAL_DATA) {
+		return 0;
+	}
+
+	return net_buf_simple_headroom(&buf->b);
+}
 
 /**
  *  @def net_buf_tail
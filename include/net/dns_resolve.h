@@ -27,7 +27,8 @@
  */
 enum dns_query_type {
 	DNS_QUERY_TYPE_A = 1,	 /* IPv4 */
-	DNS_QUERY_TYPE_AAAA = 28 /* IPv6 */
+	DNS_QUERY_TYPE_AAAA = 28, /* IPv6 */
+	DNS_QUERY_TYPE_A_AAAA = 256 /* IPv4 and IPv6 queried in parallel */
 };
 
 #ifndef DNS_MAX_NAME_SIZE
@@ -143,8 +144,17 @@ struct dns_resolve_context {
 		/** Query type */
 		enum dns_query_type query_type;
 
+		/** Negative status received for the first of the A and AAAA
+		 * queries sent in parallel, reported if the other one
+		 * fails too.
+		 */
+		enum dns_resolve_status status;
+
 		/** DNS id of this query */
 		u16_t id;
+
+		/** Address types that have not been answered yet */
+		u8_t pending;
 	} queries[CONFIG_DNS_NUM_CONCUR_QUERIES];
 
 	/** Is this context in use */
@@ -212,6 +222,11 @@ int dns_resolve_cancel(struct dns_resolve_context *ctx,
  * We might send the query to multiple servers (if there are more than one
  * server configured), but we only use the result of the first received
  * response.
+ * If the answer is found in the DNS cache, the callback is called before
+ * this function returns and dns_id is set to 0.
+ * With DNS_QUERY_TYPE_A_AAAA both the IPv4 and IPv6 addresses are queried
+ * at the same time, the first response that contains addresses is passed
+ * to the callback and the other one is ignored.
  *
  * @param ctx DNS context
  * @param query What the caller wants to resolve.
@@ -259,7 +274,8 @@ struct dns_resolve_context *dns_resolve_get_default(void);
  * We might send the query to multiple servers (if there are more than one
  * server configured), but we only use the result of the first received
  * response.
- * This variant uses system wide DNS servers.
+ * This variant uses system wide DNS servers. See dns_resolve_name() for
+ * how cached answers and DNS_QUERY_TYPE_A_AAAA are handled.
  *
  * @param query What the caller wants to resolve.
  * @param type What kind of data the caller wants to get.
@@ -306,6 +322,83 @@ static inline int dns_cancel_addr_info(u16_t dns_id)
 	return dns_resolve_cancel(dns_resolve_get_default(), dns_id);
 }
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/**
+ * DNS cache statistics.
+ */
+struct dns_cache_stats {
+	/** Names resolved from cached addresses */
+	u32_t hits;
+
+	/** Names resolved from cached negative answers */
+	u32_t negative_hits;
+
+	/** Names that had to be queried from the server */
+	u32_t misses;
+
+	/** Answers added to the cache */
+	u32_t inserts;
+
+	/** Entries replaced before they expired */
+	u32_t evictions;
+};
+
+/**
+ * Cached answer, passed to dns_cache_cb_t.
+ */
+struct dns_cache_info {
+	/** Name that was resolved */
+	const char *name;
+
+	/** What kind of addresses were queried */
+	enum dns_query_type type;
+
+	/** 0 if addresses were found, DNS_EAI_NONAME or DNS_EAI_NODATA
+	 * for negative answers.
+	 */
+	int status;
+
+	/** Seconds until the entry expires */
+	u32_t ttl;
+
+	/** Number of valid addresses in addr */
+	u8_t count;
+
+	/** Cached addresses */
+	struct sockaddr addr[CONFIG_DNS_RESOLVER_CACHE_ADDRESSES];
+};
+
+/**
+ * @typedef dns_cache_cb_t
+ * @brief Callback used while iterating over the DNS cache.
+ *
+ * @param info Cached answer
+ * @param user_data A valid pointer to user data or NULL
+ */
+typedef void (*dns_cache_cb_t)(const struct dns_cache_info *info,
+			       void *user_data);
+
+/**
+ * @brief Go through all the answers in the DNS cache that have not expired.
+ *
+ * @param cb Callback to call for each answer.
+ * @param user_data User specified data.
+ */
+void dns_cache_foreach(dns_cache_cb_t cb, void *user_data);
+
+/**
+ * @brief Remove all the answers from the DNS cache.
+ */
+void dns_cache_flush(void);
+
+/**
+ * @brief Get the DNS cache statistics.
+ *
+ * @param stats Statistics are copied here.
+ */
+void dns_cache_get_stats(struct dns_cache_stats *stats);
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 /**
  * @}
  */
@@ -35,6 +35,14 @@
 #include <mbedtls/ssl.h>
 #include <mbedtls/error.h>
 #include <mbedtls/debug.h>
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+#include <mbedtls/ssl_cache.h>
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include <mbedtls/ssl_ticket.h>
+#endif
 #endif /* CONFIG_MBEDTLS */
 #endif /* CONFIG_HTTPS */
 
@@ -339,6 +347,13 @@ struct http_client_ctx {
 			mbedtls_x509_crt ca_cert;
 			u8_t *personalization_data;
 			size_t personalization_data_len;
+#if defined(CONFIG_HTTPS_CLIENT_SESSION_REUSE)
+			/** Session of the last connection to the server, the
+			 * next handshake tries to resume it.
+			 */
+			mbedtls_ssl_session session;
+			bool session_saved;
+#endif
 		} mbedtls;
 	} https;
 #endif /* CONFIG_HTTPS */
@@ -532,6 +547,10 @@ int http_client_init(struct http_client_ctx *http_ctx,
  * @detail Caller can set the various fields in http_ctx after this call
  * if needed.
  *
+ * With CONFIG_HTTPS_CLIENT_SESSION_REUSE, the TLS session of a connection
+ * is kept when it closes, and the next connection to the server resumes it
+ * with an abbreviated handshake if the server agrees.
+ *
  * @param http_ctx HTTPS context.
  * @param server HTTPS server address or host name. If host name is given,
  * then DNS resolver support (CONFIG_DNS_RESOLVER) must be enabled. If caller
@@ -568,6 +587,18 @@ int https_client_init(struct http_client_ctx *http_ctx,
 		      struct k_mem_pool *pool,
 		      u8_t *https_stack,
 		      size_t https_stack_size);
+
+#if defined(CONFIG_HTTPS_CLIENT_SESSION_REUSE)
+/**
+ * @brief Forget the TLS session kept for the server.
+ *
+ * @detail The next connection does a full handshake. This must not be
+ * called while a request is in progress.
+ *
+ * @param http_ctx HTTPS context.
+ */
+void https_client_session_clear(struct http_client_ctx *http_ctx);
+#endif
 #endif /* CONFIG_HTTPS */
 
 /**
@@ -628,12 +659,43 @@ struct http_root_url {
 	u8_t is_used;
 };
 
+/* Node of the prefix tree used to find the handler of a URL. The nodes
+ * point to parts of the registered URL strings instead of copying them.
+ */
+struct http_url_node {
+	/** Part of the URL matched by this node */
+	const char *str;
+
+	/** Length of the part */
+	u16_t len;
+
+	/** Index + 1 of the URL in urls[] that ends at this node, 0 if none */
+	u8_t url;
+
+	/** Index of the first child node, 0 if none */
+	u8_t child;
+
+	/** Index of the next node with the same parent, 0 if none */
+	u8_t sibling;
+};
+
+/* A prefix tree of N strings never has more than 2 * N nodes, plus
+ * its root.
+ */
+#define HTTP_URL_TRIE_NODES (2 * CONFIG_HTTP_SERVER_NUM_URLS + 1)
+
 /* Collection of URLs that this server will handle */
 struct http_server_urls {
 	/* First item is the default handler and it is always there.
 	 */
 	struct http_root_url default_url;
 	struct http_root_url urls[CONFIG_HTTP_SERVER_NUM_URLS];
+
+	/** Prefix tree of the URLs, the first node is its root */
+	struct http_url_node trie[HTTP_URL_TRIE_NODES];
+
+	/** Number of nodes used in the tree */
+	u8_t trie_len;
 };
 
 #if defined(CONFIG_HTTPS)
@@ -653,6 +715,70 @@ typedef int (*https_server_cert_cb_t)(struct http_server_ctx *ctx,
 				      mbedtls_pk_context *pkey);
 #endif /* CONFIG_HTTPS */
 
+/* A client connection of the HTTP server. The requests received on it
+ * are parsed as they arrive, and are served one at a time, in order.
+ */
+struct http_server_conn {
+	/** Server context the connection belongs to */
+	struct http_server_ctx *ctx;
+
+	/** Network context of the client, NULL if the connection is free */
+	struct net_context *net_ctx;
+
+	/** Closes the connection once it has been idle for too long, or
+	 * once the last response has been sent.
+	 */
+	struct k_delayed_work timer;
+
+	/** HTTP parser, it keeps its state between the received packets */
+	struct http_parser parser;
+
+	/** Header fields of the request being received */
+	struct http_field_value field_values[CONFIG_HTTP_HEADER_FIELD_ITEMS];
+
+	/** URL of the request being received */
+	const char *url;
+
+	/** Where the received data is stored, this is a part of the
+	 * request buffer of the server.
+	 */
+	u8_t *buf;
+
+	/** Size of buf, not counting the terminating nul byte */
+	size_t buf_len;
+
+	/** Length of the data in buf */
+	size_t data_len;
+
+	/** Length of the data in buf that the parser has gone through */
+	size_t parsed;
+
+	/** Length of the request line and header fields, once the body of
+	 * the request has started. The body is not stored.
+	 */
+	size_t head_len;
+
+	/** Number of header field elements */
+	u16_t field_values_ctr;
+
+	/** URL's length */
+	u16_t url_len;
+
+	/** Last parser callback, to join the strings split between packets */
+	u8_t last_cb;
+
+	/** The client can send more requests after the current one */
+	u8_t keep_alive : 1;
+
+	/** No more requests are served, the connection is being closed */
+	u8_t closing : 1;
+
+	/** The context is being released, by the RX thread or the timer.
+	 * Not a bit field as both threads write it.
+	 */
+	u8_t releasing;
+};
+
 /* The HTTP server context struct */
 struct http_server_ctx {
 	/** Collection of URLs that this server context will handle */
@@ -691,18 +817,20 @@ struct http_server_ctx {
 	 */
 	bool is_https;
 
+	/** Client connections */
+	struct http_server_conn conns[CONFIG_HTTP_SERVER_CONNECTIONS];
+
+	/** The request being served. It is filled from the connection the
+	 * request was received on before the URL handler is called.
+	 */
 	struct {
+		/** Connection the request was received on */
+		struct http_server_conn *conn;
+
 		/** From which net_context the request came from */
 		struct net_context *net_ctx;
 
-		/** HTTP request timer. After sending a response to the
-		 * client, it is possible to wait for any request back via
-		 * the same socket. If no response is received, then this
-		 * timeout is activated and connection is tore down.
-		 */
-		struct k_delayed_work timer;
-
-		/** HTTP parser */
+		/** HTTP parser, as it was at the end of the request */
 		struct http_parser parser;
 
 		/** HTTP parser settings */
@@ -715,25 +843,19 @@ struct http_server_ctx {
 		/** HTTP Request URL */
 		const char *url;
 
-		/** Where the request is stored, this is to be provided
-		 * by the user.
+		/** Where the requests are stored, this is to be provided
+		 * by the user. It is shared between the connections.
 		 */
 		u8_t *request_buf;
 
 		/** Request buffer maximum length */
 		size_t request_buf_len;
 
-		/** Length of the data in the request buf. */
-		size_t data_len;
-
 		/** Number of header field elements */
 		u16_t field_values_ctr;
 
 		/** URL's length */
 		u16_t url_len;
-
-		/** Has the request timer been cancelled. */
-		u8_t timer_cancelled;
 	} req;
 
 #if defined(CONFIG_HTTPS)
@@ -766,6 +888,14 @@ struct http_server_ctx {
 			mbedtls_pk_context pkey;
 			u8_t *personalization_data;
 			size_t personalization_data_len;
+#if defined(MBEDTLS_SSL_CACHE_C)
+			/** Sessions that the clients can resume */
+			mbedtls_ssl_cache_context cache;
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+			/** Keys of the session tickets */
+			mbedtls_ssl_ticket_context ticket_ctx;
+#endif
 		} mbedtls;
 	} https;
 #endif /* CONFIG_HTTPS */
@@ -803,8 +933,10 @@ void http_server_conn_monitor(http_server_cb_t cb, void *user_data);
  * listened. The parameter can be left NULL in which case a listener to port 80
  * using IPv4 and IPv6 is created. Note that if IPv4 or IPv6 is disabled, then
  * the corresponding disabled service listener is not created.
- * @param request_buf Caller supplied buffer where the HTTP request will be
- * stored
+ * @param request_buf Caller supplied buffer where the HTTP requests will be
+ * stored. It is split evenly between the CONFIG_HTTP_SERVER_CONNECTIONS
+ * connections, each part must be able to hold the request line and the
+ * header fields of a request. The body of the requests is not stored.
  * @param request_buf_len Length of the caller suppied buffer.
  * @param server_banner Print information about started service. This is only
  * printed if HTTP debugging is activated. The parameter can be set to NULL if
@@ -827,6 +959,11 @@ int http_server_init(struct http_server_ctx *http_ctx,
  * @detail Caller can set the various callback fields in http_ctx and
  * http_ctx.req.parser after this call if needed.
  *
+ * The clients can resume their earlier TLS sessions with an abbreviated
+ * handshake if the mbed TLS configuration has a session cache
+ * (CONFIG_MBEDTLS_SSL_SESSION_CACHE) or session tickets
+ * (CONFIG_MBEDTLS_SSL_SESSION_TICKETS).
+ *
  * @param http_ctx HTTP context.
  * @param urls Array of URLs that the server instance will serve. If the
  * server receives a HTTP request into one of the URLs, it will call user
@@ -842,8 +979,9 @@ int http_server_init(struct http_server_ctx *http_ctx,
  * listened. The parameter can be left NULL in which case a listener to port 80
  * using IPv4 and IPv6 is created. Note that if IPv4 or IPv6 is disabled, then
  * the corresponding disabled service listener is not created.
- * @param request_buf Caller supplied buffer where the HTTP request will be
- * stored
+ * @param request_buf Caller supplied buffer where the HTTPS request will be
+ * stored. Its second half is used to encrypt the responses. HTTPS serves one
+ * client at a time, and closes the connection after each response.
  * @param request_buf_len Length of the caller suppied buffer.
  * @param server_banner Print information about started service. This is only
  * printed if HTTP debugging is activated. The parameter can be set to NULL if
@@ -922,7 +1060,11 @@ int http_server_set_local_addr(struct sockaddr *addr, const char *myaddr,
  * @brief Add a handler for a given URL.
  *
  * @detail Register a handler which is called if the server receives a
- * request to a given URL.
+ * request to a given URL. The URL also matches the requests to the
+ * resources below it, "/api" and "/api/" both match "/api/status" but
+ * "/api" does not match "/apis". The query string of the request is not
+ * used for the matching. If several registered URLs match a request, the
+ * longest one is used.
  *
  * @param urls URL struct that will contain all the URLs the user wants to
  * register.
@@ -985,6 +1127,14 @@ int http_server_del_default(struct http_server_urls *urls);
  * @detail After sending a response, an optional timeout is started
  * which will wait for any new requests from the peer.
  *
+ * The payload is sent with the chunked transfer coding, so http_header
+ * must contain "Transfer-Encoding: chunked" if html_payload is set. If the
+ * client asked for a persistent connection and html_payload is set, a
+ * timeout of K_NO_WAIT is replaced by CONFIG_HTTP_SERVER_KEEPALIVE_TIMEOUT,
+ * and the following requests of the client are served on the same
+ * connection. A response without payload is not delimited, so the
+ * connection is closed after it unless a timeout is given.
+ *
  * @param ctx HTTP context.
  * @param http_header HTTP headers to send.
  * @param html_payload HTML payload to send.
@@ -999,7 +1149,8 @@ int http_response_wait(struct http_server_ctx *ctx, const char *http_header,
  * @brief Send HTTP response to client.
  *
  * @detail The connection to peer is torn down right after the response
- * is sent.
+ * is sent, unless the client asked for a persistent connection. See
+ * http_response_wait().
  *
  * @param ctx HTTP context.
  * @param http_header HTTP headers to send.
@@ -30,6 +30,22 @@ enum mqtt_app {
 	MQTT_APP_SERVER
 };
 
+/**
+ * QoS 1 or QoS 2 MQTT PUBLISH msg waiting for an acknowledgement
+ */
+struct mqtt_inflight {
+	/** Packed message, NULL once the MQTT PUBREC msg is received */
+	struct net_buf *buf;
+	/** Order in which the messages were sent */
+	u32_t seq;
+	/** Packet Identifier of the message */
+	u16_t pkt_id;
+	/** Expected acknowledgement: MQTT_PUBACK, MQTT_PUBREC or
+	 * MQTT_PUBCOMP, MQTT_INVALID if the slot is free
+	 */
+	u8_t wait;
+};
+
 /**
  * MQTT context structure
  *
@@ -54,7 +70,8 @@ enum mqtt_app {
  * messages.
  *
  * <b>NOTE: The application (and not the API) is in charge of keeping track of
- * the state of the received and sent messages.</b>
+ * the state of the received messages. The state of the sent messages is only
+ * kept by the API if CONFIG_MQTT_INFLIGHT_WINDOW is not 0.</b>
  */
 struct mqtt_ctx {
 	/** IP stack context structure */
@@ -76,7 +93,9 @@ struct mqtt_ctx {
 	 * a MQTT PUBxxxx msg.
 	 * If type is MQTT_PUBACK, MQTT_PUBCOMP or MQTT_PUBREC, this callback
 	 * must return 0 if pkt_id matches the packet id of a previously
-	 * received MQTT_PUBxxx message. If this callback returns 0, the caller
+	 * received MQTT_PUBxxx message. If CONFIG_MQTT_INFLIGHT_WINDOW is not
+	 * 0, the packet id is already matched with the in-flight messages when
+	 * this callback is executed. If this callback returns 0, the caller
 	 * will continue.
 	 * Any other value will stop the QoS handshake and the caller will
 	 * return -EINVAL. The application must discard all the messages
@@ -110,6 +129,29 @@ struct mqtt_ctx {
 	int (*publish_rx)(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg,
 			  u16_t pkt_id, enum mqtt_packet type);
 
+	/** Callback executed for each part of the payload of a received MQTT
+	 * PUBLISH msg, as the payload is received. This callback may be NULL,
+	 * the whole message is then passed to #publish_rx, and messages
+	 * longer than CONFIG_MQTT_MSG_MAX_SIZE are discarded.
+	 *
+	 * msg->msg points to the part of the payload, directly in the network
+	 * buffers, and msg->msg_len is its length. The part is only valid
+	 * during the callback. The other fields of msg are set from the
+	 * message header. Once the whole payload has been passed, #publish_rx
+	 * is executed with msg->msg set to NULL and msg->msg_len set to 0.
+	 *
+	 * If this callback returns 0, the caller will continue. Any other
+	 * value will discard the rest of the message.
+	 *
+	 * @param [in] ctx MQTT context
+	 * @param [in] msg Publish message
+	 * @param [in] offset Offset of the part in the payload
+	 * @param [in] total Length of the whole payload
+	 */
+	int (*publish_payload)(struct mqtt_ctx *ctx,
+			       struct mqtt_publish_msg *msg,
+			       u32_t offset, u32_t total);
+
 	/** Callback executed when a MQTT_APP_SUBSCRIBER or
 	 * MQTT_APP_PUBLISHER_SUBSCRIBER receives the MQTT SUBACK message
 	 * If this callback returns 0, the caller will continue. Any other
@@ -150,6 +192,21 @@ struct mqtt_ctx {
 	/* Internal use only */
 	int (*rcv)(struct mqtt_ctx *ctx, struct net_pkt *);
 
+	/* Internal use only, state of the incoming message decoder */
+	struct net_buf *rx_buf;
+	struct mqtt_publish_msg rx_publish;
+	u32_t rx_remaining;
+	u32_t rx_payload_len;
+	u16_t rx_need;
+	u8_t rx_state;
+
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+	/* Internal use only, messages waiting for an acknowledgement */
+	struct mqtt_inflight inflight[CONFIG_MQTT_INFLIGHT_WINDOW];
+	struct k_sem inflight_sem;
+	u32_t inflight_seq;
+#endif
+
 	/** Application type, see: enum mqtt_app */
 	u8_t app_type;
 
@@ -172,6 +229,20 @@ struct mqtt_ctx {
  */
 int mqtt_init(struct mqtt_ctx *ctx, enum mqtt_app app_type);
 
+/**
+ * Attaches the MQTT context to a new network context
+ *
+ * @details To be used after the connection to the server was lost, instead of
+ * mqtt_init. The in-flight messages are kept, they are sent again if the
+ * server resumes the session when the MQTT CONNECT msg is sent with
+ * clean_session set to 0.
+ *
+ * @param ctx MQTT context structure
+ * @param net_ctx New IP stack context structure
+ * @retval 0, always.
+ */
+int mqtt_reconnect(struct mqtt_ctx *ctx, struct net_context *net_ctx);
+
 /**
  * Sends the MQTT CONNECT message
  *
@@ -251,10 +322,16 @@ int mqtt_tx_pubrel(struct mqtt_ctx *ctx, u16_t id);
 /**
  * Sends the MQTT PUBLISH message
  *
+ * @details If CONFIG_MQTT_INFLIGHT_WINDOW is not 0, the QoS 1 and QoS 2
+ * messages are kept until they are acknowledged, so several messages may be
+ * sent without waiting for their acknowledgement. When the window is full,
+ * this routine waits for an acknowledgement for up to ctx->net_timeout.
+ *
  * @param [in] ctx MQTT context structure
  * @param [in] msg MQTT PUBLISH msg
  *
  * @retval 0 on success
+ * @retval -EAGAIN if the in-flight window is full
  * @retval -EINVAL
  * @retval -ENOMEM
  * @retval -EIO
@@ -0,0 +1,113 @@
+/** @file
+ * @brief Network packet capture
+ *
+ * Copy the packets received and sent by the network interfaces to a
+ * pcapng stream, for analysing the traffic of a device with Wireshark
+ * or tcpdump.
+ */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __NET_CAPTURE_H
+#define __NET_CAPTURE_H
+
+#include <zephyr/types.h>
+#include <net/net_ip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Network packet capture
+ * @defgroup net_capture Network packet capture
+ * @{
+ */
+
+/**
+ * @brief Selects the packets to capture. A field that is zero or NULL
+ * matches all the packets.
+ *
+ * The protocol and port fields are matched against the IPv4 or IPv6
+ * header that directly follows the link layer header, they never match
+ * packets with IPv6 extension headers or on interfaces whose link layer
+ * compresses the IP headers (IEEE 802.15.4 and Bluetooth).
+ */
+struct net_capture_filter {
+	/** Interface of the packets */
+	struct net_if *iface;
+
+	/** AF_INET or AF_INET6 */
+	sa_family_t family;
+
+	/** IPPROTO_UDP, IPPROTO_TCP, IPPROTO_ICMP or IPPROTO_ICMPV6 */
+	enum net_ip_protocol proto;
+
+	/** UDP or TCP source or destination port, in host byte order */
+	u16_t port;
+};
+
+struct net_capture_stats {
+	/** Number of packets copied to the capture buffer */
+	u32_t captured;
+
+	/** Number of packets lost because the capture buffer was full */
+	u32_t dropped;
+};
+
+/**
+ * @brief Start capturing packets.
+ *
+ * @details The capture starts a new pcapng section, written to the
+ * output selected with CONFIG_NET_CAPTURE_OUTPUT_*. Packets are never
+ * delayed by the capture, they are dropped from the capture instead
+ * when its buffer is full.
+ *
+ * @param filter Packets to capture, NULL to capture all the packets.
+ * @param snaplen Maximum number of bytes to save per packet, 0 for
+ * CONFIG_NET_CAPTURE_SNAPLEN. Larger values are truncated to
+ * CONFIG_NET_CAPTURE_SNAPLEN.
+ *
+ * @return 0 if ok, -EALREADY if a capture is running, -ENOMEM if the
+ * capture buffer is full.
+ */
+int net_capture_start(const struct net_capture_filter *filter,
+		      u16_t snaplen);
+
+/**
+ * @brief Stop capturing packets.
+ *
+ * @details The packets that were already captured are still written
+ * to the output.
+ *
+ * @return 0 if ok, -EALREADY if no capture is running.
+ */
+int net_capture_stop(void);
+
+/**
+ * @brief Tell whether packets are being captured.
+ *
+ * @return True if a capture is running.
+ */
+bool net_capture_is_running(void);
+
+/**
+ * @brief Get the statistics of the current or of the last capture.
+ *
+ * @param stats Filled with the statistics.
+ */
+void net_capture_get_stats(struct net_capture_stats *stats);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_CAPTURE_H */
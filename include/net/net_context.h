@@ -102,6 +102,33 @@ typedef void (*net_context_send_cb_t)(struct net_context *context,
 				      void *token,
 				      void *user_data);
 
+/**
+ * @typedef net_context_release_cb_t
+ * @brief Callback used to give application owned data back to its owner.
+ *
+ * @details The callback is called when the network stack no longer
+ * references data that was given to it without copying, see
+ * net_context_sendv() and net_pkt_append_ext(). This can happen in the
+ * TX thread or in the driver, so the callback must not block.
+ *
+ * @param data Data that was given to the network stack.
+ * @param len Length of the data.
+ * @param user_data The user data given together with the data.
+ */
+typedef void (*net_context_release_cb_t)(const void *data, u16_t len,
+					 void *user_data);
+
+/**
+ * @brief Buffer description used by net_context_sendv().
+ */
+struct net_iovec {
+	/** Start of the data */
+	const void *base;
+
+	/** Length of the data */
+	u16_t len;
+};
+
 /**
  * @typedef net_tcp_accept_cb_t
  * @brief Accept callback
@@ -674,6 +701,46 @@ int net_context_sendto(struct net_pkt *pkt,
 		       void *token,
 		       void *user_data);
 
+/**
+ * @brief Send application owned buffers to a peer without copying them.
+ *
+ * @details This function creates a network packet whose payload consists
+ * of fragments referring directly to the given buffers, and sends it like
+ * net_context_send() or, if dst_addr is given, net_context_sendto().
+ * The payload is not copied between the application and the driver (see
+ * CONFIG_NET_BUF_EXT_COUNT), so the buffers can be for example constant
+ * data in flash. The buffers must stay valid and unmodified until
+ * release_cb has been called for them. The release_cb is called exactly
+ * once for every entry in iov, also if this function returns an error.
+ * Note that link layers that need to fragment the packet (6LoWPAN,
+ * Bluetooth) still copy the data into their own fragments.
+ *
+ * @param context The network context to use.
+ * @param iov Array of buffers to send.
+ * @param iovcnt Number of entries in iov.
+ * @param release_cb Caller supplied callback that is called when a buffer
+ * is no longer used by the network stack, can be NULL.
+ * @param dst_addr Destination address, NULL if the context is connected.
+ * @param addrlen Length of the address.
+ * @param cb Caller supplied send callback function.
+ * @param timeout Timeout for the connection. Possible values
+ * are K_FOREVER, K_NO_WAIT, >0.
+ * @param token Caller specified value that is passed as is to callback.
+ * @param user_data Caller supplied user data, passed to both callbacks.
+ *
+ * @return 0 if ok, < 0 if error
+ */
+int net_context_sendv(struct net_context *context,
+		      const struct net_iovec *iov,
+		      int iovcnt,
+		      net_context_release_cb_t release_cb,
+		      const struct sockaddr *dst_addr,
+		      socklen_t addrlen,
+		      net_context_send_cb_t cb,
+		      s32_t timeout,
+		      void *token,
+		      void *user_data);
+
 /**
  * @brief Receive network data from a peer specified by context.
  *
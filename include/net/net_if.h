@@ -25,6 +25,7 @@
 #include <net/net_linkaddr.h>
 #include <net/net_ip.h>
 #include <net/net_l2.h>
+#include <net/net_stats.h>
 
 #if defined(CONFIG_NET_DHCPV4)
 #include <net/dhcpv4.h>
@@ -158,6 +159,12 @@ enum {
 	/* interface is pointopoint */
 	NET_IF_POINTOPOINT,
 
+	/* hardware calculates the checksums of sent packets */
+	NET_IF_TX_CHKSUM_OFFLOAD,
+
+	/* hardware verifies the checksums of received packets */
+	NET_IF_RX_CHKSUM_OFFLOAD,
+
 	/* Total number of flags - must be at the end of the enum */
 	NET_IF_NUM_FLAGS
 };
@@ -166,6 +173,12 @@ enum {
 struct net_offload;
 #endif /* CONFIG_NET_OFFLOAD */
 
+#if defined(CONFIG_NET_TC_TX_COUNT)
+#define NET_TC_TX_COUNT CONFIG_NET_TC_TX_COUNT
+#else
+#define NET_TC_TX_COUNT 1
+#endif
+
 
 /**
  * @brief Network Interface structure
@@ -196,12 +209,33 @@ struct net_if {
 	/** The hardware link address */
 	struct net_linkaddr link_addr;
 
-	/** Queue for outgoing packets from apps */
-	struct k_fifo tx_queue;
+	/** Queues for outgoing packets from apps, one per traffic class.
+	 * The queue with the highest index has the highest priority.
+	 */
+	struct k_fifo tx_queue[NET_TC_TX_COUNT];
+
+#if defined(CONFIG_NET_TX_THREAD_PER_IF)
+	/** TX thread serving only this interface */
+	struct k_thread tx_thread;
+
+	/** Stack of the TX thread, defined by NET_IF_INIT() */
+	char *tx_stack;
+
+	/** Size of the TX thread stack */
+	size_t tx_stack_size;
+
+	/** Poll events for the traffic class queues of this interface */
+	struct k_poll_event tx_events[NET_TC_TX_COUNT];
+#endif /* CONFIG_NET_TX_THREAD_PER_IF */
 
 	/** The hardware MTU */
 	u16_t mtu;
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	/** Latency of the packets received and sent on this interface */
+	struct net_stats_latency latency;
+#endif
+
 #if defined(CONFIG_NET_OFFLOAD)
 	/** TCP/IP Offload functions.
 	 * If non-NULL, then the TCP/IP stack is located
@@ -376,16 +410,28 @@ static inline struct device *net_if_get_device(struct net_if *iface)
 	return iface->dev;
 }
 
+/**
+ * @brief Convert a packet priority to a TX traffic class
+ *
+ * @details The mapping follows the recommendation of IEEE 802.1Q
+ * table 8-5 for the configured number of traffic classes.
+ *
+ * @param prio Packet priority, see enum net_priority
+ *
+ * @return Traffic class (0 is the lowest) to use for the packet
+ */
+int net_if_tx_priority2tc(enum net_priority prio);
+
 /**
  * @brief Queue a packet to the net interface TX queue
  *
+ * @details The packet is placed into the traffic class queue selected
+ * by its priority, see net_pkt_set_priority().
+ *
  * @param iface Pointer to a network interface structure
  * @param pkt Pointer to a net packet to queue
  */
-static inline void net_if_queue_tx(struct net_if *iface, struct net_pkt *pkt)
-{
-	k_fifo_put(&iface->tx_queue, pkt);
-}
+void net_if_queue_tx(struct net_if *iface, struct net_pkt *pkt);
 
 #if defined(CONFIG_NET_OFFLOAD)
 /**
@@ -401,6 +447,39 @@ static inline bool net_if_is_ip_offloaded(struct net_if *iface)
 }
 #endif
 
+/**
+ * @brief Check if the checksums of sent packets are calculated by hardware
+ *
+ * @details The driver sets the NET_IF_TX_CHKSUM_OFFLOAD flag in its
+ * init function if the device fills in the IPv4 header checksum and the
+ * UDP, TCP and ICMP checksums itself.
+ *
+ * @param iface Pointer to a network interface structure
+ *
+ * @return True if the stack can skip the checksum calculation
+ */
+static inline bool net_if_is_tx_chksum_offloaded(struct net_if *iface)
+{
+	return iface && atomic_test_bit(iface->flags,
+					NET_IF_TX_CHKSUM_OFFLOAD);
+}
+
+/**
+ * @brief Check if the checksums of received packets are verified by hardware
+ *
+ * @details The driver sets the NET_IF_RX_CHKSUM_OFFLOAD flag in its
+ * init function if the device drops packets with invalid checksums.
+ *
+ * @param iface Pointer to a network interface structure
+ *
+ * @return True if the stack can skip the checksum verification
+ */
+static inline bool net_if_is_rx_chksum_offloaded(struct net_if *iface)
+{
+	return iface && atomic_test_bit(iface->flags,
+					NET_IF_RX_CHKSUM_OFFLOAD);
+}
+
 /**
  * @brief Get an network interface's link address
  *
@@ -1210,7 +1289,24 @@ struct net_if_api {
 #define NET_IF_GET(dev_name, sfx)					\
 	((struct net_if *)&NET_IF_GET_NAME(dev_name, sfx))
 
+#if defined(CONFIG_NET_TX_THREAD_PER_IF)
+#define NET_IF_TX_STACK_GET_NAME(dev_name, sfx)			\
+	__net_if_tx_stack_##dev_name##_##sfx
+#define NET_IF_TX_STACK_DEFINE(dev_name, sfx)				\
+	NET_STACK_DEFINE(TX, NET_IF_TX_STACK_GET_NAME(dev_name, sfx),	\
+			 CONFIG_NET_TX_STACK_SIZE,			\
+			 CONFIG_NET_TX_STACK_SIZE);
+#define NET_IF_TX_STACK_INIT(dev_name, sfx)				\
+	.tx_stack = NET_IF_TX_STACK_GET_NAME(dev_name, sfx),		\
+	.tx_stack_size =						\
+		K_THREAD_STACK_SIZEOF(NET_IF_TX_STACK_GET_NAME(dev_name, sfx)),
+#else
+#define NET_IF_TX_STACK_DEFINE(dev_name, sfx)
+#define NET_IF_TX_STACK_INIT(dev_name, sfx)
+#endif /* CONFIG_NET_TX_THREAD_PER_IF */
+
 #define NET_IF_INIT(dev_name, sfx, _l2, _mtu)				\
+	NET_IF_TX_STACK_DEFINE(dev_name, sfx)				\
 	static struct net_if (NET_IF_GET_NAME(dev_name, sfx)) __used	\
 	__attribute__((__section__(".net_if.data"))) = {		\
 		.dev = &(__device_##dev_name),				\
@@ -1218,9 +1314,10 @@ struct net_if_api {
 		.l2_data = &(NET_L2_GET_DATA(dev_name, sfx)),		\
 		.mtu = _mtu,						\
 		NET_IF_DHCPV4_INIT					\
+		NET_IF_TX_STACK_INIT(dev_name, sfx)			\
 	};								\
 	static struct k_poll_event					\
-	(NET_IF_EVENT_GET_NAME(dev_name, sfx)) __used			\
+	(NET_IF_EVENT_GET_NAME(dev_name, sfx))[NET_TC_TX_COUNT] __used	\
 		__attribute__((__section__(".net_if_event.data"))) = {}
 
 
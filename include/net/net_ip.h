@@ -177,6 +177,23 @@ struct net_addr {
 #define NET_IPV6_NEXTHDR_FRAG        44
 #define NET_IPV6_NEXTHDR_NONE        59
 
+/** Network packet priority settings described in IEEE 802.1Q Annex I.1.
+ * The numeric order is the 802.1Q one, so background (BK) sorts below
+ * best effort (BE) even though its value is higher.
+ */
+enum net_priority {
+	NET_PRIORITY_BK = 1, /* Background (lowest)                */
+	NET_PRIORITY_BE = 0, /* Best effort (default)              */
+	NET_PRIORITY_EE = 2, /* Excellent effort                   */
+	NET_PRIORITY_CA = 3, /* Critical applications              */
+	NET_PRIORITY_VI = 4, /* Video, < 100 ms latency and jitter */
+	NET_PRIORITY_VO = 5, /* Voice, < 10 ms latency and jitter  */
+	NET_PRIORITY_IC = 6, /* Internetwork control               */
+	NET_PRIORITY_NC = 7  /* Network control (highest)          */
+};
+
+#define NET_MAX_PRIORITIES 8 /* How many priority values there are */
+
 /** IPv6/IPv4 network connection tuple */
 struct net_tuple {
 	/** IPv6/IPv4 remote address */
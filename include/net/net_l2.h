@@ -59,6 +59,23 @@ extern struct net_l2 __net_l2_start[];
 #define DUMMY_L2		DUMMY
 #define DUMMY_L2_CTX_TYPE	void*
 NET_L2_DECLARE_PUBLIC(DUMMY_L2);
+
+#if defined(CONFIG_NET_L2_DUMMY_LOOPBACK)
+/** Counters of the loopback interface of the dummy L2 */
+struct net_dummy_loopback_stats {
+	/** Packets received back by the stack */
+	u32_t looped;
+	/** Packets dropped for lack of buffers */
+	u32_t dropped;
+};
+
+/**
+ * @brief Get the counters of the loopback interface.
+ *
+ * @param stats Filled with the current counters.
+ */
+void net_dummy_loopback_stats(struct net_dummy_loopback_stats *stats);
+#endif /* CONFIG_NET_L2_DUMMY_LOOPBACK */
 #endif /* CONFIG_NET_L2_DUMMY */
 
 #ifdef CONFIG_NET_L2_ETHERNET
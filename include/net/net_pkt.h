@@ -80,6 +80,19 @@ struct net_pkt {
 	u8_t family     : 4;	/* IPv4 vs IPv6 */
 	u8_t _unused    : 4;
 
+	u8_t priority;	/* IEEE 802.1Q priority, see enum net_priority.
+			 * Selects the TX traffic class queue.
+			 */
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	u32_t stamp;		/* Cycle count when the packet entered the
+				 * RX or TX path, 0 if it is not timed.
+				 */
+	u32_t queue_stamp;	/* Cycle count when the RX thread took
+				 * the packet.
+				 */
+#endif
+
 #if defined(CONFIG_NET_IPV6)
 	u8_t ipv6_hop_limit;	/* IPv6 hop limit for this network packet. */
 	u8_t ipv6_ext_len;	/* length of extension headers */
@@ -138,6 +151,17 @@ static inline void net_pkt_set_token(struct net_pkt *pkt, void *token)
 	pkt->token = token;
 }
 
+static inline u8_t net_pkt_priority(struct net_pkt *pkt)
+{
+	return pkt->priority;
+}
+
+static inline void net_pkt_set_priority(struct net_pkt *pkt,
+					u8_t priority)
+{
+	pkt->priority = priority;
+}
+
 static inline struct net_if *net_pkt_iface(struct net_pkt *pkt)
 {
 	return pkt->iface;
@@ -509,6 +533,12 @@ struct net_buf *net_pkt_get_frag_debug(struct net_pkt *pkt,
 #define net_pkt_get_frag(pkt, timeout)					\
 	net_pkt_get_frag_debug(pkt, timeout, __func__, __LINE__)
 
+struct net_buf *net_pkt_get_frag_len_debug(struct net_pkt *pkt, u16_t len,
+					   s32_t timeout,
+					   const char *caller, int line);
+#define net_pkt_get_frag_len(pkt, len, timeout)				\
+	net_pkt_get_frag_len_debug(pkt, len, timeout, __func__, __LINE__)
+
 void net_pkt_unref_debug(struct net_pkt *pkt, const char *caller, int line);
 #define net_pkt_unref(pkt) net_pkt_unref_debug(pkt, __func__, __LINE__)
 
@@ -712,6 +742,31 @@ struct net_buf *net_pkt_get_reserve_tx_data(u16_t reserve_head,
  */
 struct net_buf *net_pkt_get_frag(struct net_pkt *pkt, s32_t timeout);
 
+/**
+ * @brief Get a data fragment that is sized to hold the given amount of
+ * data.
+ *
+ * @details The fragment is taken from the smallest size class that can
+ * hold len bytes after the link layer reserve. If that class has run out
+ * of fragments, a fragment from a bigger class is used instead of
+ * waiting. If len is bigger than the biggest class, a fragment of the
+ * biggest class is returned, so the caller must still check the
+ * tailroom. If the packet has a user specific buffer pool, it is used
+ * and len is ignored. Without size classes configured this is the same
+ * as net_pkt_get_frag().
+ *
+ * @param pkt Network packet.
+ * @param len Amount of data that the caller wants to store.
+ * @param timeout Affects the action taken should the net buf pool be empty.
+ *        If K_NO_WAIT, then return immediately. If K_FOREVER, then
+ *        wait as long as necessary. Otherwise, wait up to the specified
+ *        number of milliseconds before timing out.
+ *
+ * @return Network buffer if successful, NULL otherwise.
+ */
+struct net_buf *net_pkt_get_frag_len(struct net_pkt *pkt, u16_t len,
+				     s32_t timeout);
+
 /**
  * @brief Place packet back into the available packets slab
  *
@@ -917,6 +972,33 @@ static inline bool net_pkt_append_all(struct net_pkt *pkt, u16_t len,
 	return net_pkt_append(pkt, len, data, timeout) == len;
 }
 
+/**
+ * @brief Append application owned data to a packet without copying it
+ *
+ * @details A fragment referring to the data is added to the end of the
+ * fragment list. The data must stay valid and unmodified until the release
+ * callback is called. The data is never written by the stack so it can
+ * reside in flash. If CONFIG_NET_BUF_EXT_COUNT is 0, the data is copied
+ * into normal data fragments and the callback is called before returning.
+ *
+ * @param pkt Network packet.
+ * @param data Data to be added
+ * @param len Length of the data
+ * @param cb Callback to be called when the data is no longer used by the
+ *        stack, can be NULL.
+ * @param user_data User data passed to the callback.
+ * @param timeout Affects the action taken should the net buf pool be empty.
+ *        If K_NO_WAIT, then return immediately. If K_FOREVER, then
+ *        wait as long as necessary. Otherwise, wait up to the specified
+ *        number of milliseconds before timing out.
+ *
+ * @return 0 if ok, <0 if error. On error the callback is not called and
+ *         the data is not referenced by the packet.
+ */
+int net_pkt_append_ext(struct net_pkt *pkt, const void *data, u16_t len,
+		       net_context_release_cb_t cb, void *user_data,
+		       s32_t timeout);
+
 /**
  * @brief Append u8_t data to last fragment in fragment list of a packet
  *
@@ -1100,6 +1182,201 @@ struct net_buf *net_frag_read_be16(struct net_buf *frag, u16_t offset,
 struct net_buf *net_frag_read_be32(struct net_buf *frag, u16_t offset,
 				   u16_t *pos, u32_t *value);
 
+/**
+ * @brief Position in the fragment list of a packet.
+ *
+ * @details The cursor remembers both the fragment and the offset inside
+ * it, so consecutive reads, writes and skips continue from where the
+ * previous one ended without walking the fragment list from the start.
+ * When all the data has been consumed, frag is NULL.
+ */
+struct net_pkt_cursor {
+	/** Current fragment, NULL at the end of data */
+	struct net_buf *frag;
+
+	/** Offset inside the current fragment */
+	u16_t pos;
+
+	/** Offset from the start of the fragment list */
+	u16_t offset;
+};
+
+/**
+ * @brief Set a cursor to the start of the packet data.
+ *
+ * @param cursor Cursor to initialize.
+ * @param pkt Network packet.
+ */
+void net_pkt_cursor_init(struct net_pkt_cursor *cursor, struct net_pkt *pkt);
+
+/**
+ * @brief Move a cursor to an absolute offset in the packet.
+ *
+ * @details If the offset is after the current position of the cursor, the
+ * fragment list is walked from the current position, otherwise from the
+ * start of the packet.
+ *
+ * @param cursor Cursor to move.
+ * @param pkt Network packet the cursor belongs to.
+ * @param offset Offset from the start of the packet data.
+ *
+ * @return 0 if ok, -ENODATA if the packet is shorter than offset.
+ */
+int net_pkt_cursor_seek(struct net_pkt_cursor *cursor, struct net_pkt *pkt,
+			u16_t offset);
+
+/**
+ * @brief Read data at cursor and advance the cursor.
+ *
+ * @param cursor Cursor.
+ * @param data Data will be copied here, NULL to just skip the data.
+ * @param len Length of data to read.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data in which case
+ *         the cursor is not moved.
+ */
+int net_pkt_cursor_read(struct net_pkt_cursor *cursor, void *data,
+			u16_t len);
+
+/**
+ * @brief Read data at cursor without advancing the cursor.
+ *
+ * @param cursor Cursor.
+ * @param data Data will be copied here.
+ * @param len Length of data to read.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data.
+ */
+static inline int net_pkt_cursor_peek(struct net_pkt_cursor *cursor,
+				      void *data, u16_t len)
+{
+	struct net_pkt_cursor tmp = *cursor;
+
+	return net_pkt_cursor_read(&tmp, data, len);
+}
+
+/**
+ * @brief Skip data at cursor.
+ *
+ * @param cursor Cursor.
+ * @param len Length of data to skip.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data in which case
+ *         the cursor is not moved.
+ */
+static inline int net_pkt_cursor_skip(struct net_pkt_cursor *cursor,
+				      u16_t len)
+{
+	return net_pkt_cursor_read(cursor, NULL, len);
+}
+
+/**
+ * @brief Read a byte at cursor and advance the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value is returned here.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data.
+ */
+static inline int net_pkt_cursor_read_u8(struct net_pkt_cursor *cursor,
+					 u8_t *value)
+{
+	if (cursor->frag) {
+		/* A cursor never points past the data of its fragment */
+		*value = cursor->frag->data[cursor->pos];
+
+		return net_pkt_cursor_read(cursor, NULL, 1);
+	}
+
+	return -ENODATA;
+}
+
+/**
+ * @brief Read a 16 bit big endian value at cursor and advance the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value is returned here in host byte order.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data.
+ */
+int net_pkt_cursor_read_be16(struct net_pkt_cursor *cursor, u16_t *value);
+
+/**
+ * @brief Read a 32 bit big endian value at cursor and advance the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value is returned here in host byte order.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data.
+ */
+int net_pkt_cursor_read_be32(struct net_pkt_cursor *cursor, u32_t *value);
+
+/**
+ * @brief Overwrite data at cursor and advance the cursor.
+ *
+ * @details Only data already in the packet is overwritten, the packet
+ * is never extended. Use net_pkt_write() for that.
+ *
+ * @param cursor Cursor.
+ * @param data Data to write.
+ * @param len Length of the data.
+ *
+ * @return 0 if ok, -ENODATA if there is not enough data in the packet,
+ *         -EPERM if the data is in a fragment referring to read-only
+ *         application data. On error the cursor is not moved, but part of
+ *         the data may have been written.
+ */
+int net_pkt_cursor_write(struct net_pkt_cursor *cursor, const void *data,
+			 u16_t len);
+
+/**
+ * @brief Overwrite a byte at cursor and advance the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value to write.
+ *
+ * @return 0 if ok, <0 if error (see net_pkt_cursor_write()).
+ */
+static inline int net_pkt_cursor_write_u8(struct net_pkt_cursor *cursor,
+					  u8_t value)
+{
+	return net_pkt_cursor_write(cursor, &value, sizeof(value));
+}
+
+/**
+ * @brief Overwrite a 16 bit value in big endian at cursor and advance
+ * the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value to write in host byte order.
+ *
+ * @return 0 if ok, <0 if error (see net_pkt_cursor_write()).
+ */
+static inline int net_pkt_cursor_write_be16(struct net_pkt_cursor *cursor,
+					    u16_t value)
+{
+	u16_t be = htons(value);
+
+	return net_pkt_cursor_write(cursor, &be, sizeof(be));
+}
+
+/**
+ * @brief Overwrite a 32 bit value in big endian at cursor and advance
+ * the cursor.
+ *
+ * @param cursor Cursor.
+ * @param value Value to write in host byte order.
+ *
+ * @return 0 if ok, <0 if error (see net_pkt_cursor_write()).
+ */
+static inline int net_pkt_cursor_write_be32(struct net_pkt_cursor *cursor,
+					    u32_t value)
+{
+	u32_t be = htonl(value);
+
+	return net_pkt_cursor_write(cursor, &be, sizeof(be));
+}
+
 /**
  * @brief Write data to an arbitrary offset in fragments list of a packet.
  *
@@ -1309,6 +1586,18 @@ void net_pkt_get_info(struct k_mem_slab **rx,
 		      struct net_buf_pool **rx_data,
 		      struct net_buf_pool **tx_data);
 
+typedef void (*net_pkt_pool_cb_t)(struct net_buf_pool *pool,
+				  void *user_data);
+
+/**
+ * @brief Go through all the predefined DATA pools, including the
+ * different size classes.
+ *
+ * @param cb Callback to call for each pool.
+ * @param user_data User specified data.
+ */
+void net_pkt_data_pool_foreach(net_pkt_pool_cb_t cb, void *user_data);
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 /**
  * @brief Debug helper to print out the buffer allocations
@@ -140,6 +140,15 @@ struct net_stats_ipv6_nd {
 	net_stats_t drop;
 	net_stats_t recv;
 	net_stats_t sent;
+
+	/** Number of neighbor cache lookups. */
+	net_stats_t nbr_lookup;
+
+	/** Number of neighbor cache lookups that found nothing. */
+	net_stats_t nbr_miss;
+
+	/** Number of neighbors removed to make room for a new one. */
+	net_stats_t nbr_evict;
 };
 
 struct net_stats_rpl_dis {
@@ -221,6 +230,59 @@ struct net_stats_ipv6_mld {
 	net_stats_t drop;
 };
 
+/** Stages of the packet path that are timed */
+enum net_stats_latency_stage {
+	/** From net_recv_data() until the RX thread takes the packet */
+	NET_STATS_LATENCY_RX_QUEUE,
+
+	/** From the RX thread until the UDP or TCP handler is called */
+	NET_STATS_LATENCY_RX_STACK,
+
+	/** From net_if_send_data() until the TX thread takes the packet */
+	NET_STATS_LATENCY_TX_QUEUE,
+
+	/** Time spent in the send function of the driver */
+	NET_STATS_LATENCY_TX_DRIVER,
+
+	NET_STATS_LATENCY_STAGES,
+};
+
+/** Protocols that have their own latency histograms */
+enum net_stats_latency_proto {
+	NET_STATS_LATENCY_UDP,
+	NET_STATS_LATENCY_TCP,
+
+	/** Packets that are not bound to a UDP or TCP context */
+	NET_STATS_LATENCY_OTHER,
+
+	NET_STATS_LATENCY_PROTOS,
+};
+
+#define NET_STATS_LATENCY_BUCKETS 16
+
+struct net_stats_latency_hist {
+	/** Number of timed packets. */
+	net_stats_t count;
+
+	/** Highest latency, in cycles. */
+	u32_t max;
+
+	/** Sum of the latencies, in cycles. */
+	u64_t sum;
+
+	/** Bucket 0 counts the latencies below
+	 * 2^CONFIG_NET_STATISTICS_LATENCY_SHIFT cycles, and bucket n the
+	 * ones below twice the limit of bucket n - 1. The last bucket
+	 * counts all the higher latencies.
+	 */
+	net_stats_t buckets[NET_STATS_LATENCY_BUCKETS];
+};
+
+struct net_stats_latency {
+	struct net_stats_latency_hist
+		hist[NET_STATS_LATENCY_STAGES][NET_STATS_LATENCY_PROTOS];
+};
+
 struct net_stats {
 	net_stats_t processing_error;
 
@@ -287,6 +349,7 @@ enum net_request_stats_cmd {
 	NET_REQUEST_STATS_CMD_GET_UDP,
 	NET_REQUEST_STATS_CMD_GET_TCP,
 	NET_REQUEST_STATS_CMD_GET_RPL,
+	NET_REQUEST_STATS_CMD_GET_LATENCY,
 };
 
 #define NET_REQUEST_STATS_GET_ALL				\
@@ -358,6 +421,14 @@ NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_TCP);
 NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_RPL);
 #endif /* CONFIG_NET_STATISTICS_RPL */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+/** Get the struct net_stats_latency of the given interface */
+#define NET_REQUEST_STATS_GET_LATENCY				\
+	(_NET_STATS_BASE | NET_REQUEST_STATS_CMD_GET_LATENCY)
+
+NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_LATENCY);
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
 
 #ifdef __cplusplus
@@ -0,0 +1,271 @@
+/** @file
+ * @brief BSD Sockets compatible API
+ *
+ * A thin BSD Sockets compatible layer on top of the net_context API.
+ */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __NET_SOCKET_H
+#define __NET_SOCKET_H
+
+/**
+ * @brief BSD Sockets compatible API
+ * @defgroup bsd_sockets BSD Sockets compatible API
+ * @{
+ */
+
+#include <sys/types.h>
+#include <zephyr/types.h>
+#include <net/net_ip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The values are compatible with Linux */
+
+/** zsock_poll(): there is data to read */
+#define ZSOCK_POLLIN 1
+/** zsock_poll(): data can be written without blocking */
+#define ZSOCK_POLLOUT 4
+/** zsock_poll(): an error is pending, output only */
+#define ZSOCK_POLLERR 8
+/** zsock_poll(): the peer closed the connection, output only */
+#define ZSOCK_POLLHUP 0x10
+/** zsock_poll(): the fd is not an open socket, output only */
+#define ZSOCK_POLLNVAL 0x20
+
+/** zsock_recv(): return the data without removing it from the queue */
+#define ZSOCK_MSG_PEEK 0x02
+/** zsock_recv()/zsock_send(): do not block for this call only */
+#define ZSOCK_MSG_DONTWAIT 0x40
+
+/** zsock_fcntl(): get the file status flags */
+#define ZSOCK_F_GETFL 3
+/** zsock_fcntl(): set the file status flags */
+#define ZSOCK_F_SETFL 4
+/** File status flag for non-blocking operation */
+#define ZSOCK_O_NONBLOCK 0x800
+
+/**
+ * Entry of the zsock_poll() array.
+ */
+struct zsock_pollfd {
+	/** Socket to poll */
+	int fd;
+
+	/** Requested ZSOCK_POLL* events */
+	short events;
+
+	/** Returned ZSOCK_POLL* events */
+	short revents;
+};
+
+/*
+ * All the functions below follow the BSD Sockets conventions: on error
+ * they return -1 and set errno.
+ */
+
+/**
+ * @brief Create a socket.
+ *
+ * @details The socket is backed by a net_context. Received packets are
+ * kept in a per-socket queue until the application reads them, so no
+ * application code is run in the RX thread.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param type SOCK_STREAM or SOCK_DGRAM
+ * @param proto IPPROTO_TCP or IPPROTO_UDP
+ *
+ * @return Socket descriptor, or -1 on error.
+ */
+int zsock_socket(int family, int type, int proto);
+
+/**
+ * @brief Close a socket and release its resources.
+ */
+int zsock_close(int sock);
+
+/**
+ * @brief Bind a socket to a local address.
+ */
+int zsock_bind(int sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/**
+ * @brief Connect a socket to a peer.
+ *
+ * @details A non-blocking TCP socket returns -1 with errno set to
+ * EINPROGRESS, and is reported writable by zsock_poll() once connected.
+ */
+int zsock_connect(int sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/**
+ * @brief Start accepting connections on a stream socket.
+ */
+int zsock_listen(int sock, int backlog);
+
+/**
+ * @brief Accept a connection on a listening socket.
+ *
+ * @details Connections are accepted in the background as soon as they
+ * are established, this returns the oldest one that was not returned yet.
+ */
+int zsock_accept(int sock, struct sockaddr *addr, socklen_t *addrlen);
+
+/**
+ * @brief Send data to the connected peer.
+ */
+ssize_t zsock_send(int sock, const void *buf, size_t len, int flags);
+
+/**
+ * @brief Receive data from the connected peer.
+ *
+ * @return Number of bytes received, 0 if the peer closed the connection,
+ * or -1 on error.
+ */
+ssize_t zsock_recv(int sock, void *buf, size_t max_len, int flags);
+
+/**
+ * @brief Send a datagram to the given peer.
+ */
+ssize_t zsock_sendto(int sock, const void *buf, size_t len, int flags,
+		     const struct sockaddr *dest_addr, socklen_t addrlen);
+
+/**
+ * @brief Receive a datagram and get the address of its sender.
+ *
+ * @details Datagrams longer than max_len are truncated.
+ */
+ssize_t zsock_recvfrom(int sock, void *buf, size_t max_len, int flags,
+		       struct sockaddr *src_addr, socklen_t *addrlen);
+
+/**
+ * @brief Get or set the ZSOCK_O_NONBLOCK flag of a socket.
+ */
+int zsock_fcntl(int sock, int cmd, int flags);
+
+/**
+ * @brief Wait for events on several sockets.
+ *
+ * @details Built on k_poll(), so a single thread can wait for data on
+ * many sockets at the same time. At most CONFIG_NET_SOCKETS_POLL_MAX
+ * sockets can be polled for input at once.
+ *
+ * @param fds Sockets and events to poll
+ * @param nfds Number of entries in fds
+ * @param timeout Timeout in milliseconds, -1 to wait forever
+ *
+ * @return Number of entries with returned events, 0 on timeout or
+ * -1 on error.
+ */
+int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout);
+
+/**
+ * @brief Convert an IP address string to binary form.
+ *
+ * @return 1 on success, 0 if the string is not a valid address.
+ */
+int zsock_inet_pton(sa_family_t family, const char *src, void *dst);
+
+#if defined(CONFIG_NET_SOCKETS_POSIX_NAMES)
+#define pollfd zsock_pollfd
+
+static inline int socket(int family, int type, int proto)
+{
+	return zsock_socket(family, type, proto);
+}
+
+static inline int close(int sock)
+{
+	return zsock_close(sock);
+}
+
+static inline int bind(int sock, const struct sockaddr *addr,
+		       socklen_t addrlen)
+{
+	return zsock_bind(sock, addr, addrlen);
+}
+
+static inline int connect(int sock, const struct sockaddr *addr,
+			  socklen_t addrlen)
+{
+	return zsock_connect(sock, addr, addrlen);
+}
+
+static inline int listen(int sock, int backlog)
+{
+	return zsock_listen(sock, backlog);
+}
+
+static inline int accept(int sock, struct sockaddr *addr, socklen_t *addrlen)
+{
+	return zsock_accept(sock, addr, addrlen);
+}
+
+static inline ssize_t send(int sock, const void *buf, size_t len, int flags)
+{
+	return zsock_send(sock, buf, len, flags);
+}
+
+static inline ssize_t recv(int sock, void *buf, size_t max_len, int flags)
+{
+	return zsock_recv(sock, buf, max_len, flags);
+}
+
+static inline ssize_t sendto(int sock, const void *buf, size_t len,
+			     int flags, const struct sockaddr *dest_addr,
+			     socklen_t addrlen)
+{
+	return zsock_sendto(sock, buf, len, flags, dest_addr, addrlen);
+}
+
+static inline ssize_t recvfrom(int sock, void *buf, size_t max_len,
+			       int flags, struct sockaddr *src_addr,
+			       socklen_t *addrlen)
+{
+	return zsock_recvfrom(sock, buf, max_len, flags, src_addr, addrlen);
+}
+
+static inline int fcntl(int sock, int cmd, int flags)
+{
+	return zsock_fcntl(sock, cmd, flags);
+}
+
+static inline int poll(struct zsock_pollfd *fds, int nfds, int timeout)
+{
+	return zsock_poll(fds, nfds, timeout);
+}
+
+static inline int inet_pton(sa_family_t family, const char *src, void *dst)
+{
+	return zsock_inet_pton(family, src, dst);
+}
+
+#define POLLIN ZSOCK_POLLIN
+#define POLLOUT ZSOCK_POLLOUT
+#define POLLERR ZSOCK_POLLERR
+#define POLLHUP ZSOCK_POLLHUP
+#define POLLNVAL ZSOCK_POLLNVAL
+
+#define MSG_PEEK ZSOCK_MSG_PEEK
+#define MSG_DONTWAIT ZSOCK_MSG_DONTWAIT
+
+#define F_GETFL ZSOCK_F_GETFL
+#define F_SETFL ZSOCK_F_SETFL
+#define O_NONBLOCK ZSOCK_O_NONBLOCK
+#endif /* CONFIG_NET_SOCKETS_POSIX_NAMES */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* __NET_SOCKET_H */
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * @brief CoAP server engine for Zephyr.
+ */
+
+#ifndef __ZOAP_SERVER_H__
+#define __ZOAP_SERVER_H__
+
+#include <kernel.h>
+#include <net/buf.h>
+#include <net/net_context.h>
+#include <net/zoap.h>
+
+/**
+ * @brief COAP library
+ * @defgroup zoap COAP Library
+ * @{
+ */
+
+/**
+ * @brief Node of the URI-Path trie used to dispatch the requests.
+ *
+ * Each node matches one path segment, the children of a node are
+ * linked through their @a next index, index 0 being the root.
+ */
+struct zoap_server_node {
+	const char *segment;
+	struct zoap_resource *resource;
+	u8_t len;
+	u8_t child;
+	u8_t next;
+};
+
+/**
+ * @brief Confirmable message sent by the server, waiting for its ACK.
+ */
+struct zoap_server_pending {
+	struct zoap_pending pending;
+	struct zoap_server_observer *observer;
+	struct net_buf *payload;
+	s64_t expiry;
+	u8_t retries;
+	u8_t index;
+};
+
+/**
+ * @brief Observer of a resource, registered by zoap_server_observe().
+ *
+ * The observers are chained in buckets hashed on their address, the
+ * @a next index being the index of the next observer plus one.
+ */
+struct zoap_server_observer {
+	struct zoap_observer observer;
+	struct zoap_resource *resource;
+	/** Latest state not sent yet, shared by all the observers */
+	struct net_buf *payload;
+	/** Message ID of the last notification */
+	u16_t id;
+	u8_t next;
+	u8_t non_count;
+	bool inflight;
+};
+
+/**
+ * @brief Request recently received, with the response that was sent
+ * for it, so that duplicates can be answered without running the
+ * handler again.
+ */
+struct zoap_server_exchange {
+	struct sockaddr addr;
+	struct net_buf *response;
+	s64_t expiry;
+	u16_t id;
+	u8_t token[8];
+	u8_t tkl;
+	u8_t code;
+};
+
+/**
+ * @brief CoAP server state.
+ *
+ * Keeps the resources in a trie, the pending retransmissions in a
+ * min-heap ordered by expiry and driven by a single delayed work, and
+ * the recent exchanges for deduplication (RFC 7252, section 4.5).
+ * The notifications to the observers are sent in paced bursts by
+ * another delayed work.
+ */
+struct zoap_server {
+	struct net_context *context;
+	struct zoap_server_node nodes[CONFIG_ZOAP_SERVER_RESOURCE_NODES];
+	struct zoap_server_pending pendings[CONFIG_ZOAP_SERVER_PENDINGS];
+	struct zoap_server_pending *heap[CONFIG_ZOAP_SERVER_PENDINGS];
+	struct zoap_server_exchange exchanges[CONFIG_ZOAP_SERVER_EXCHANGES];
+	struct zoap_server_exchange *current;
+	struct zoap_server_observer observers[CONFIG_ZOAP_SERVER_OBSERVERS];
+	u8_t buckets[CONFIG_ZOAP_SERVER_OBSERVERS];
+	struct k_delayed_work retransmit;
+	struct k_delayed_work notify;
+	s64_t notify_next;
+	u8_t node_count;
+	u8_t heap_len;
+	u8_t exchange_next;
+	u8_t notify_cursor;
+	bool notify_armed;
+};
+
+/**
+ * @brief Initializes the server and builds the trie of @a resources.
+ *
+ * @param server Server to be initialized
+ * @param context UDP context used to send the messages
+ * @param resources Array of resources, terminated by a resource
+ * without path
+ *
+ * @return 0 in case of success, -ENOMEM if the trie does not have
+ * enough nodes for the resources.
+ */
+int zoap_server_init(struct zoap_server *server,
+		     struct net_context *context,
+		     struct zoap_resource *resources);
+
+/**
+ * @brief Handles a message received by the server.
+ *
+ * Requests are dispatched to the method of the matching resource. A
+ * duplicate of a recent request is answered with the response that was
+ * sent for it. If no response was recorded, the duplicate is handled
+ * again unless it is a POST, the only method that is not idempotent.
+ * ACK and RESET messages stop the retransmission of the confirmable
+ * message they match, a RESET to a notification also removes the
+ * observer.
+ *
+ * @param server Server that received the message
+ * @param zpkt Message received
+ * @param from Address from which the message was received
+ *
+ * @return 0 in case of success, -ENOENT if no resource matches the
+ * request, -EALREADY for a dropped duplicate, or the return value of
+ * the method.
+ */
+int zoap_server_handle(struct zoap_server *server, struct zoap_packet *zpkt,
+		       const struct sockaddr *from);
+
+/**
+ * @brief Sends a message from the server.
+ *
+ * Confirmable messages are retransmitted until they are acknowledged.
+ * A response sent by a method called by zoap_server_handle() is
+ * recorded, to be sent again if the request is duplicated.
+ *
+ * The packet of @a zpkt is released, whatever the result.
+ *
+ * @param server Server sending the message
+ * @param zpkt Message to be sent
+ * @param addr Address of the destination
+ *
+ * @return 0 in case of success or negative in case of error.
+ */
+int zoap_server_send(struct zoap_server *server, struct zoap_packet *zpkt,
+		     const struct sockaddr *addr);
+
+/**
+ * @brief Registers or removes an observer, as requested by the Observe
+ * option of @a request.
+ *
+ * To be called by the GET method of an observable resource. An
+ * observer with the same address and token is refreshed instead of
+ * being registered again.
+ *
+ * @param server Server that received the request
+ * @param resource Resource being observed
+ * @param request Request received
+ * @param from Address from which the request was received
+ *
+ * @return 1 if the observer is registered, the response then carries
+ * the Observe option, 0 if the request does not register an observer,
+ * -ENOMEM if all the observers are in use.
+ */
+int zoap_server_observe(struct zoap_server *server,
+			struct zoap_resource *resource,
+			const struct zoap_packet *request,
+			const struct sockaddr *from);
+
+/**
+ * @brief Notifies the observers of @a resource of a new state.
+ *
+ * The payload is copied once into a buffer shared by the notifications
+ * of all the observers, each of them only having its own header. The
+ * notifications are sent by bursts of CONFIG_ZOAP_SERVER_NOTIFY_BURST,
+ * spaced by CONFIG_ZOAP_SERVER_NOTIFY_INTERVAL milliseconds. An
+ * observer that did not get the previous state yet only gets the new
+ * one.
+ *
+ * Following RFC 7641, section 4.5.1, every
+ * CONFIG_ZOAP_SERVER_NOTIFY_CON_INTERVAL notification is confirmable
+ * and nothing else is sent to the observer until it is acknowledged.
+ * The observer is removed if it is never acknowledged.
+ *
+ * @param server Server of the resource
+ * @param resource Resource whose state changed
+ * @param content_format Content-Format of the payload
+ * @param payload Representation of the new state
+ * @param len Length of the payload
+ *
+ * @return 0 in case of success, -EMSGSIZE if the payload is too large
+ * or -ENOMEM if no buffer is available for it.
+ */
+int zoap_server_notify(struct zoap_server *server,
+		       struct zoap_resource *resource,
+		       u16_t content_format,
+		       const void *payload, u16_t len);
+
+/**
+ * @brief Stops the retransmissions and the notifications, and releases
+ * the packets and observers held by the server.
+ *
+ * @param server Server to be released
+ */
+void zoap_server_release(struct zoap_server *server);
+
+/**
+ * @}
+ */
+
+#endif /* __ZOAP_SERVER_H__ */
@@ -14,6 +14,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(CONFIG_JSON_NET_PKT)
+#include <net/net_pkt.h>
+#endif
+
 #include "json.h"
 
 struct token {
@@ -596,338 +600,1505 @@ int json_obj_parse(char *payload, size_t len,
 	return obj_parse(&obj, descr, descr_len, val);
 }
 
-static char escape_as(char chr)
+enum tokenizer_state {
+	TOKENIZER_IDLE,
+	TOKENIZER_STRING,
+	TOKENIZER_ESCAPE,
+	TOKENIZER_UNICODE,
+	TOKENIZER_NUMBER,
+	TOKENIZER_LITERAL,
+	TOKENIZER_ERROR,
+};
+
+void json_tokenizer_init(struct json_tokenizer *tokenizer,
+			 json_token_cb_t cb, void *data)
 {
-	switch (chr) {
-	case '"':
-		return '"';
-	case '\\':
-		return '\\';
-	case '\b':
-		return 'b';
-	case '\f':
-		return 'f';
-	case '\n':
-		return 'n';
-	case '\r':
-		return 'r';
-	case '\t':
-		return 't';
-	}
+	memset(tokenizer, 0, sizeof(*tokenizer));
 
-	return 0;
+	tokenizer->cb = cb;
+	tokenizer->data = data;
+	tokenizer->state = TOKENIZER_IDLE;
 }
 
-static int json_escape_internal(const char *str,
-				json_append_bytes_t append_bytes,
-				void *data)
+static int tokenizer_emit(struct json_tokenizer *tokenizer,
+			  enum json_tokens type, const char *start,
+			  size_t len, bool partial)
 {
-	const char *cur;
+	struct json_token token = {
+		.type = type,
+		.start = start,
+		.len = len,
+		.partial = partial,
+	};
+
+	return tokenizer->cb(&token, tokenizer->data);
+}
+
+static void tokenizer_literal(struct json_tokenizer *tokenizer,
+			      const char *rest, enum json_tokens type)
+{
+	tokenizer->state = TOKENIZER_LITERAL;
+	tokenizer->literal = rest;
+	tokenizer->literal_type = type;
+}
+
+static bool number_char(char chr)
+{
+	return isdigit(chr) || chr == '.' || chr == 'e' || chr == 'E' ||
+		chr == '+' || chr == '-';
+}
+
+int json_tokenizer_feed(struct json_tokenizer *tokenizer, const char *json,
+			size_t len)
+{
+	const char *end = json + len;
+	const char *pos = json;
+	const char *piece = json;
 	int ret = 0;
 
-	for (cur = str; ret == 0 && *cur; cur++) {
-		char escaped = escape_as(*cur);
+	if (tokenizer->state == TOKENIZER_ERROR) {
+		return -EINVAL;
+	}
 
-		if (escaped) {
-			char bytes[2] = { '\\', escaped };
+	while (pos < end && ret >= 0) {
+		char chr = *pos;
+
+		switch (tokenizer->state) {
+		case TOKENIZER_IDLE:
+			pos++;
+
+			switch (chr) {
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ',':
+			case ':':
+				ret = tokenizer_emit(tokenizer,
+						     (enum json_tokens)chr,
+						     NULL, 0, false);
+				break;
+			case '"':
+				tokenizer->state = TOKENIZER_STRING;
+				piece = pos;
+				break;
+			case 't':
+				tokenizer_literal(tokenizer, "rue",
+						  JSON_TOK_TRUE);
+				break;
+			case 'f':
+				tokenizer_literal(tokenizer, "alse",
+						  JSON_TOK_FALSE);
+				break;
+			case 'n':
+				tokenizer_literal(tokenizer, "ull",
+						  JSON_TOK_NULL);
+				break;
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+				break;
+			default:
+				if (chr == '-' || isdigit(chr)) {
+					tokenizer->state = TOKENIZER_NUMBER;
+					piece = pos - 1;
+					break;
+				}
 
-			ret = append_bytes(bytes, 2, data);
-		} else {
-			ret = append_bytes(cur, 1, data);
+				ret = -EINVAL;
+			}
+
+			break;
+		case TOKENIZER_STRING:
+			/* Nothing to check in the plain characters */
+			while (pos < end && *pos != '"' && *pos != '\\') {
+				pos++;
+			}
+
+			if (pos == end) {
+				break;
+			}
+
+			if (*pos++ == '\\') {
+				tokenizer->state = TOKENIZER_ESCAPE;
+				break;
+			}
+
+			tokenizer->state = TOKENIZER_IDLE;
+			ret = tokenizer_emit(tokenizer, JSON_TOK_STRING, piece,
+					     pos - 1 - piece, false);
+			break;
+		case TOKENIZER_ESCAPE:
+			pos++;
+
+			switch (chr) {
+			case '"':
+			case '\\':
+			case '/':
+			case 'b':
+			case 'f':
+			case 'n':
+			case 'r':
+			case 't':
+				tokenizer->state = TOKENIZER_STRING;
+				break;
+			case 'u':
+				tokenizer->state = TOKENIZER_UNICODE;
+				tokenizer->count = 4;
+				break;
+			default:
+				ret = -EINVAL;
+			}
+
+			break;
+		case TOKENIZER_UNICODE:
+			pos++;
+
+			if (!isxdigit(chr)) {
+				ret = -EINVAL;
+			} else if (!--tokenizer->count) {
+				tokenizer->state = TOKENIZER_STRING;
+			}
+
+			break;
+		case TOKENIZER_NUMBER:
+			if (number_char(chr)) {
+				pos++;
+				break;
+			}
+
+			/* The character is handled again in the idle state */
+			tokenizer->state = TOKENIZER_IDLE;
+			ret = tokenizer_emit(tokenizer, JSON_TOK_NUMBER, piece,
+					     pos - piece, false);
+			break;
+		case TOKENIZER_LITERAL:
+			pos++;
+
+			if (chr != *tokenizer->literal) {
+				ret = -EINVAL;
+				break;
+			}
+
+			if (!*++tokenizer->literal) {
+				tokenizer->state = TOKENIZER_IDLE;
+				ret = tokenizer_emit(tokenizer,
+						     tokenizer->literal_type,
+						     NULL, 0, false);
+			}
+
+			break;
+		}
+	}
+
+	if (ret < 0) {
+		tokenizer->state = TOKENIZER_ERROR;
+		return ret;
+	}
+
+	/* The rest of the token comes with the next chunk */
+	if (tokenizer->state >= TOKENIZER_STRING &&
+	    tokenizer->state <= TOKENIZER_NUMBER && pos > piece) {
+		ret = tokenizer_emit(tokenizer,
+				     tokenizer->state == TOKENIZER_NUMBER ?
+				     JSON_TOK_NUMBER : JSON_TOK_STRING,
+				     piece, pos - piece, true);
+		if (ret < 0) {
+			tokenizer->state = TOKENIZER_ERROR;
 		}
 	}
 
 	return ret;
 }
 
-size_t json_calc_escaped_len(const char *str, size_t len)
-{
-	size_t escaped_len = len;
-	size_t pos;
+enum stream_state {
+	STREAM_START,
+	STREAM_KEY_OR_END,
+	STREAM_KEY,
+	STREAM_COLON,
+	STREAM_VALUE_OR_END,
+	STREAM_VALUE,
+	STREAM_COMMA_OR_END,
+	STREAM_DONE,
+};
 
-	for (pos = 0; pos < len; pos++) {
-		if (escape_as(str[pos])) {
-			escaped_len++;
-		}
-	}
+#define NUM_NEGATIVE BIT(0)
+#define NUM_DIGITS BIT(1)
+#define NUM_INVALID BIT(2)
+#define NUM_RANGE BIT(3)
 
-	return escaped_len;
+static struct json_stream_frame *stream_top(struct json_stream *stream)
+{
+	return &stream->stack[stream->depth - 1];
 }
 
-ssize_t json_escape(char *str, size_t *len, size_t buf_size)
+/* Arrays have a length field, objects do not */
+static bool frame_is_array(const struct json_stream_frame *frame)
 {
-	char *next; /* Points after next character to escape. */
-	char *dest; /* Points after next place to write escaped character. */
-	size_t escaped_len = json_calc_escaped_len(str, *len);
+	return frame->elements != NULL;
+}
 
-	if (escaped_len == *len) {
-		/*
-		 * If no escape is necessary, there is nothing to do.
-		 */
-		return 0;
-	}
+static int stream_push(struct json_stream *stream,
+		       const struct json_obj_descr *descr, size_t descr_len,
+		       void *val)
+{
+	struct json_stream_frame *frame;
 
-	if (escaped_len >= buf_size) {
-		return -ENOMEM;
+	if (stream->depth == CONFIG_JSON_STREAM_DEPTH) {
+		return -E2BIG;
 	}
 
-	/*
-	 * By walking backwards in the buffer from the end positions
-	 * of both the original and escaped strings, we avoid using
-	 * extra space. Characters in the original string are
-	 * overwritten only after they have already been escaped.
-	 */
-	str[escaped_len] = '\0';
-	for (next = &str[*len], dest = &str[escaped_len]; next != str;) {
-		char next_c = *(--next);
-		char escape = escape_as(next_c);
+	assert(descr_len < (sizeof(frame->decoded) * CHAR_BIT - 1));
 
-		if (escape) {
-			*(--dest) = escape;
-			*(--dest) = '\\';
-		} else {
-			*(--dest) = next_c;
-		}
-	}
-	*len = escaped_len;
+	frame = &stream->stack[stream->depth++];
+	frame->descr = descr;
+	frame->descr_len = descr_len;
+	frame->val = val;
+	frame->elements = NULL;
+	frame->decoded = 0;
+	frame->field = -1;
+
+	stream->state = STREAM_KEY_OR_END;
 
 	return 0;
 }
 
-static int encode(const struct json_obj_descr *descr, const void *val,
-		  json_append_bytes_t append_bytes, void *data);
-
-static int arr_encode(const struct json_obj_descr *elem_descr,
-		      const void *field, const void *val,
-		      json_append_bytes_t append_bytes, void *data)
+static int stream_push_array(struct json_stream *stream,
+			     const struct json_obj_descr *descr, void *field,
+			     void *val)
 {
-	ptrdiff_t elem_size = get_elem_size(elem_descr);
-	/*
-	 * NOTE: Since an element descriptor's offset isn't meaningful
-	 * (array elements occur at multiple offsets in `val'), we use
-	 * its space in elem_descr to store the offset to the field
-	 * containing the number of elements.
-	 */
-	size_t n_elem = *(size_t *)((char *)val + elem_descr->offset);
-	size_t i;
-	int ret;
+	const struct json_obj_descr *elem_descr = descr->element_descr;
+	struct json_stream_frame *frame;
 
-	ret = append_bytes("[", 1, data);
-	if (ret < 0) {
-		return ret;
+	if (elem_descr->type == JSON_TOK_LIST_START) {
+		return -EINVAL;
 	}
 
-	for (i = 0; i < n_elem; i++) {
-		/*
-		 * Though "field" points at the next element in the
-		 * array which we need to encode, the value in
-		 * elem_descr->offset is actually the offset of the
-		 * length field in the "parent" struct containing the
-		 * array.
-		 *
-		 * To patch things up, we lie to encode() about where
-		 * the field is by exactly the amount it will offset
-		 * it. This is a size optimization for struct
-		 * json_obj_descr: the alternative is to keep a
-		 * separate field next to element_descr which is an
-		 * offset to the length field in the parent struct,
-		 * but that would add a size_t to every descriptor.
-		 */
-		ret = encode(elem_descr, (char *)field - elem_descr->offset,
-			     append_bytes, data);
-		if (ret < 0) {
-			return ret;
-		}
+	if (stream->depth == CONFIG_JSON_STREAM_DEPTH) {
+		return -E2BIG;
+	}
 
-		if (i < n_elem - 1) {
-			ret = append_bytes(",", 1, data);
-			if (ret < 0) {
-				return ret;
-			}
-		}
+	frame = &stream->stack[stream->depth++];
+	frame->descr = elem_descr;
+	frame->descr_len = descr->n_elements;
+	frame->val = field;
+	/* See arr_encode() for the offset of an element descriptor */
+	frame->elements = (size_t *)((char *)val + elem_descr->offset);
+	frame->elem_size = get_elem_size(elem_descr);
+	frame->decoded = 0;
 
-		field = (char *)field + elem_size;
-	}
+	*frame->elements = 0;
 
-	return append_bytes("]", 1, data);
+	stream->state = STREAM_VALUE_OR_END;
+
+	return 0;
 }
 
-static int str_encode(const char **str, json_append_bytes_t append_bytes,
-		      void *data)
+static int stream_value_done(struct json_stream *stream, bool decoded)
 {
-	int ret;
+	struct json_stream_frame *frame = stream_top(stream);
 
-	ret = append_bytes("\"", 1, data);
-	if (ret < 0) {
-		return ret;
+	stream->state = STREAM_COMMA_OR_END;
+
+	if (frame_is_array(frame)) {
+		(*frame->elements)++;
+		frame->val += frame->elem_size;
+
+		return 0;
 	}
 
-	ret = json_escape_internal(*str, append_bytes, data);
-	if (!ret) {
-		return append_bytes("\"", 1, data);
+	if (decoded) {
+		frame->decoded |= 1 << frame->field;
 	}
 
-	return ret;
+	return 0;
 }
 
-static int num_encode(const s32_t *num, json_append_bytes_t append_bytes,
-		      void *data)
+static int stream_pop(struct json_stream *stream)
 {
-	char buf[3 * sizeof(s32_t)];
-	int ret;
+	stream->depth--;
 
-	ret = snprintk(buf, sizeof(buf), "%d", *num);
-	if (ret < 0) {
-		return ret;
-	}
-	if (ret >= (int)sizeof(buf)) {
-		return -ENOMEM;
+	if (!stream->depth) {
+		stream->state = STREAM_DONE;
+		return 0;
 	}
 
-	return append_bytes(buf, (size_t)ret, data);
+	return stream_value_done(stream, true);
 }
 
-static int bool_encode(const bool *value, json_append_bytes_t append_bytes,
-		       void *data)
+/* Unknown values are skipped without being checked further */
+static int stream_skip(struct json_stream *stream,
+		       const struct json_token *token)
 {
-	if (*value) {
-		return append_bytes("true", 4, data);
-	}
+	switch (token->type) {
+	case JSON_TOK_OBJECT_START:
+	case JSON_TOK_LIST_START:
+		if (stream->skip == UINT8_MAX) {
+			return -E2BIG;
+		}
 
-	return append_bytes("false", 5, data);
-}
+		stream->skip++;
+		return 0;
+	case JSON_TOK_OBJECT_END:
+	case JSON_TOK_LIST_END:
+		if (--stream->skip) {
+			return 0;
+		}
 
-static int obj_encode(const struct json_obj_descr *descr, size_t descr_len,
-		      const void *val, json_append_bytes_t append_bytes,
-		      void *data);
+		return stream_value_done(stream, false);
+	default:
+		return 0;
+	}
+}
 
-static int encode(const struct json_obj_descr *descr, const void *val,
-		  json_append_bytes_t append_bytes, void *data)
+static int stream_key(struct json_stream *stream,
+		      const struct json_token *token)
 {
-	void *ptr = (char *)val + descr->offset;
+	struct json_stream_frame *frame = stream_top(stream);
+	size_t i;
 
-	switch (descr->type) {
+	if (!stream->partial) {
+		stream->key_len = 0;
+	}
+
+	/* Too long to match a field */
+	if (stream->key_len > sizeof(stream->key) ||
+	    token->len > sizeof(stream->key) - stream->key_len) {
+		stream->key_len = sizeof(stream->key) + 1;
+	} else {
+		memcpy(stream->key + stream->key_len, token->start,
+		       token->len);
+		stream->key_len += token->len;
+	}
+
+	stream->partial = token->partial;
+	if (stream->partial) {
+		return 0;
+	}
+
+	frame->field = -1;
+
+	for (i = 0; i < frame->descr_len; i++) {
+		/* Field has been decoded already, skip */
+		if (frame->decoded & (1 << i)) {
+			continue;
+		}
+
+		if (stream->key_len == frame->descr[i].field_name_len &&
+		    !memcmp(stream->key, frame->descr[i].field_name,
+			    stream->key_len)) {
+			frame->field = i;
+			break;
+		}
+	}
+
+	stream->state = STREAM_COLON;
+
+	return 0;
+}
+
+static int stream_string(struct json_stream *stream,
+			 const struct json_obj_descr *descr, void *field,
+			 const struct json_token *token)
+{
+	size_t room = stream->strings_size - stream->strings_used;
+
+	if (!stream->partial) {
+		stream->string_start = stream->strings_used;
+	}
+
+	stream->partial = token->partial;
+
+	if (!descr) {
+		return stream->partial ? 0 : stream_value_done(stream, false);
+	}
+
+	if (descr->type != JSON_TOK_STRING) {
+		return -EINVAL;
+	}
+
+	/* With room left for the NUL character */
+	if (token->len >= room) {
+		return -ENOMEM;
+	}
+
+	memcpy(stream->strings + stream->strings_used, token->start,
+	       token->len);
+	stream->strings_used += token->len;
+
+	if (stream->partial) {
+		return 0;
+	}
+
+	stream->strings[stream->strings_used++] = '\0';
+	*(char **)field = stream->strings + stream->string_start;
+
+	return stream_value_done(stream, true);
+}
+
+static int stream_number(struct json_stream *stream,
+			 const struct json_obj_descr *descr, void *field,
+			 const struct json_token *token)
+{
+	size_t i;
+
+	if (!stream->partial) {
+		stream->num = 0;
+		stream->num_flags = 0;
+	}
+
+	for (i = 0; i < token->len; i++) {
+		char chr = token->start[i];
+
+		if (isdigit(chr)) {
+			stream->num_flags |= NUM_DIGITS;
+
+			if (stream->num > (s64_t)INT32_MAX + 1) {
+				stream->num_flags |= NUM_RANGE;
+				continue;
+			}
+
+			stream->num = stream->num * 10 + chr - '0';
+		} else if (chr == '-' && !stream->num_flags) {
+			stream->num_flags |= NUM_NEGATIVE;
+		} else {
+			stream->num_flags |= NUM_INVALID;
+		}
+	}
+
+	stream->partial = token->partial;
+	if (stream->partial) {
+		return 0;
+	}
+
+	if (!descr) {
+		return stream_value_done(stream, false);
+	}
+
+	if (descr->type != JSON_TOK_NUMBER) {
+		return -EINVAL;
+	}
+
+	if ((stream->num_flags & NUM_INVALID) ||
+	    !(stream->num_flags & NUM_DIGITS)) {
+		return -EINVAL;
+	}
+
+	if (stream->num_flags & NUM_NEGATIVE) {
+		stream->num = -stream->num;
+	}
+
+	if ((stream->num_flags & NUM_RANGE) || stream->num > INT32_MAX ||
+	    stream->num < INT32_MIN) {
+		return -ERANGE;
+	}
+
+	*(s32_t *)field = stream->num;
+
+	return stream_value_done(stream, true);
+}
+
+static int stream_value(struct json_stream *stream,
+			const struct json_token *token)
+{
+	struct json_stream_frame *frame = stream_top(stream);
+	const struct json_obj_descr *descr = NULL;
+	void *field = NULL;
+
+	if (frame_is_array(frame)) {
+		if (*frame->elements == frame->descr_len) {
+			return -ENOSPC;
+		}
+
+		descr = frame->descr;
+		field = frame->val;
+	} else if (frame->field >= 0) {
+		descr = &frame->descr[frame->field];
+		field = frame->val + descr->offset;
+	}
+
+	switch (token->type) {
+	case JSON_TOK_OBJECT_START:
+		if (!descr) {
+			stream->skip = 1;
+			return 0;
+		}
+
+		if (descr->type != JSON_TOK_OBJECT_START) {
+			return -EINVAL;
+		}
+
+		return stream_push(stream, descr->sub_descr,
+				   descr->sub_descr_len, field);
+	case JSON_TOK_LIST_START:
+		if (!descr) {
+			stream->skip = 1;
+			return 0;
+		}
+
+		if (descr->type != JSON_TOK_LIST_START) {
+			return -EINVAL;
+		}
+
+		return stream_push_array(stream, descr, field, frame->val);
+	case JSON_TOK_STRING:
+		return stream_string(stream, descr, field, token);
+	case JSON_TOK_NUMBER:
+		return stream_number(stream, descr, field, token);
+	case JSON_TOK_TRUE:
+	case JSON_TOK_FALSE:
+		if (!descr) {
+			return stream_value_done(stream, false);
+		}
+
+		if (!equivalent_types(token->type, descr->type)) {
+			return -EINVAL;
+		}
+
+		*(bool *)field = token->type == JSON_TOK_TRUE;
+
+		return stream_value_done(stream, true);
+	case JSON_TOK_NULL:
+		if (frame_is_array(frame)) {
+			return -EINVAL;
+		}
+
+		return stream_value_done(stream, false);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int stream_token(const struct json_token *token, void *data)
+{
+	struct json_stream *stream = data;
+	struct json_stream_frame *frame;
+
+	if (stream->skip) {
+		return stream_skip(stream, token);
+	}
+
+	switch (stream->state) {
+	case STREAM_START:
+		if (token->type != JSON_TOK_OBJECT_START) {
+			return -EINVAL;
+		}
+
+		return stream_push(stream, stream->descr, stream->descr_len,
+				   stream->val);
+	case STREAM_KEY_OR_END:
+		if (token->type == JSON_TOK_OBJECT_END) {
+			return stream_pop(stream);
+		}
+
+		/* fallthrough */
+	case STREAM_KEY:
+		if (token->type != JSON_TOK_STRING) {
+			return -EINVAL;
+		}
+
+		return stream_key(stream, token);
+	case STREAM_COLON:
+		if (token->type != JSON_TOK_COLON) {
+			return -EINVAL;
+		}
+
+		stream->state = STREAM_VALUE;
+		return 0;
+	case STREAM_VALUE_OR_END:
+		if (token->type == JSON_TOK_LIST_END) {
+			return stream_pop(stream);
+		}
+
+		/* fallthrough */
+	case STREAM_VALUE:
+		return stream_value(stream, token);
+	case STREAM_COMMA_OR_END:
+		frame = stream_top(stream);
+
+		if (token->type == JSON_TOK_COMMA) {
+			stream->state = frame_is_array(frame) ?
+				STREAM_VALUE : STREAM_KEY;
+			return 0;
+		}
+
+		if (token->type == (frame_is_array(frame) ?
+				    JSON_TOK_LIST_END : JSON_TOK_OBJECT_END)) {
+			return stream_pop(stream);
+		}
+
+		return -EINVAL;
+	default:
+		/* Nothing but whitespace after the object */
+		return -EINVAL;
+	}
+}
+
+void json_stream_init(struct json_stream *stream,
+		      const struct json_obj_descr *descr, size_t descr_len,
+		      void *val, char *strings, size_t strings_size)
+{
+	memset(stream, 0, sizeof(*stream));
+
+	json_tokenizer_init(&stream->tokenizer, stream_token, stream);
+
+	stream->descr = descr;
+	stream->descr_len = descr_len;
+	stream->val = val;
+	stream->strings = strings;
+	stream->strings_size = strings_size;
+	stream->state = STREAM_START;
+}
+
+int json_stream_feed(struct json_stream *stream, const char *json,
+		     size_t len)
+{
+	int ret;
+
+	if (stream->error) {
+		return stream->error;
+	}
+
+	ret = json_tokenizer_feed(&stream->tokenizer, json, len);
+	if (ret < 0) {
+		stream->error = ret;
+		return ret;
+	}
+
+	if (stream->state != STREAM_DONE) {
+		return -EAGAIN;
+	}
+
+	return stream->stack[0].decoded;
+}
+
+static char escape_as(char chr)
+{
+	switch (chr) {
+	case '"':
+		return '"';
+	case '\\':
+		return '\\';
+	case '\b':
+		return 'b';
+	case '\f':
+		return 'f';
+	case '\n':
+		return 'n';
+	case '\r':
+		return 'r';
+	case '\t':
+		return 't';
+	}
+
+	return 0;
+}
+
+static int json_escape_internal(const char *str,
+				json_append_bytes_t append_bytes,
+				void *data)
+{
+	const char *cur;
+	int ret = 0;
+
+	for (cur = str; ret == 0 && *cur; cur++) {
+		char escaped = escape_as(*cur);
+
+		if (escaped) {
+			char bytes[2] = { '\\', escaped };
+
+			ret = append_bytes(bytes, 2, data);
+		} else {
+			ret = append_bytes(cur, 1, data);
+		}
+	}
+
+	return ret;
+}
+
+size_t json_calc_escaped_len(const char *str, size_t len)
+{
+	size_t escaped_len = len;
+	size_t pos;
+
+	for (pos = 0; pos < len; pos++) {
+		if (escape_as(str[pos])) {
+			escaped_len++;
+		}
+	}
+
+	return escaped_len;
+}
+
+ssize_t json_escape(char *str, size_t *len, size_t buf_size)
+{
+	char *next; /* Points after next character to escape. */
+	char *dest; /* Points after next place to write escaped character. */
+	size_t escaped_len = json_calc_escaped_len(str, *len);
+
+	if (escaped_len == *len) {
+		/*
+		 * If no escape is necessary, there is nothing to do.
+		 */
+		return 0;
+	}
+
+	if (escaped_len >= buf_size) {
+		return -ENOMEM;
+	}
+
+	/*
+	 * By walking backwards in the buffer from the end positions
+	 * of both the original and escaped strings, we avoid using
+	 * extra space. Characters in the original string are
+	 * overwritten only after they have already been escaped.
+	 */
+	str[escaped_len] = '\0';
+	for (next = &str[*len], dest = &str[escaped_len]; next != str;) {
+		char next_c = *(--next);
+		char escape = escape_as(next_c);
+
+		if (escape) {
+			*(--dest) = escape;
+			*(--dest) = '\\';
+		} else {
+			*(--dest) = next_c;
+		}
+	}
+	*len = escaped_len;
+
+	return 0;
+}
+
+static int encode(const struct json_obj_descr *descr, const void *val,
+		  json_append_bytes_t append_bytes, void *data);
+
+static int arr_encode(const struct json_obj_descr *elem_descr,
+		      const void *field, const void *val,
+		      json_append_bytes_t append_bytes, void *data)
+{
+	ptrdiff_t elem_size = get_elem_size(elem_descr);
+	/*
+	 * NOTE: Since an element descriptor's offset isn't meaningful
+	 * (array elements occur at multiple offsets in `val'), we use
+	 * its space in elem_descr to store the offset to the field
+	 * containing the number of elements.
+	 */
+	size_t n_elem = *(size_t *)((char *)val + elem_descr->offset);
+	size_t i;
+	int ret;
+
+	ret = append_bytes("[", 1, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (i = 0; i < n_elem; i++) {
+		/*
+		 * Though "field" points at the next element in the
+		 * array which we need to encode, the value in
+		 * elem_descr->offset is actually the offset of the
+		 * length field in the "parent" struct containing the
+		 * array.
+		 *
+		 * To patch things up, we lie to encode() about where
+		 * the field is by exactly the amount it will offset
+		 * it. This is a size optimization for struct
+		 * json_obj_descr: the alternative is to keep a
+		 * separate field next to element_descr which is an
+		 * offset to the length field in the parent struct,
+		 * but that would add a size_t to every descriptor.
+		 */
+		ret = encode(elem_descr, (char *)field - elem_descr->offset,
+			     append_bytes, data);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (i < n_elem - 1) {
+			ret = append_bytes(",", 1, data);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		field = (char *)field + elem_size;
+	}
+
+	return append_bytes("]", 1, data);
+}
+
+static int str_encode(const char **str, json_append_bytes_t append_bytes,
+		      void *data)
+{
+	int ret;
+
+	ret = append_bytes("\"", 1, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = json_escape_internal(*str, append_bytes, data);
+	if (!ret) {
+		return append_bytes("\"", 1, data);
+	}
+
+	return ret;
+}
+
+static int num_encode(const s32_t *num, json_append_bytes_t append_bytes,
+		      void *data)
+{
+	char buf[3 * sizeof(s32_t)];
+	int ret;
+
+	ret = snprintk(buf, sizeof(buf), "%d", *num);
+	if (ret < 0) {
+		return ret;
+	}
+	if (ret >= (int)sizeof(buf)) {
+		return -ENOMEM;
+	}
+
+	return append_bytes(buf, (size_t)ret, data);
+}
+
+static int bool_encode(const bool *value, json_append_bytes_t append_bytes,
+		       void *data)
+{
+	if (*value) {
+		return append_bytes("true", 4, data);
+	}
+
+	return append_bytes("false", 5, data);
+}
+
+static int obj_encode(const struct json_obj_descr *descr, size_t descr_len,
+		      const void *val, json_append_bytes_t append_bytes,
+		      void *data);
+
+static int encode(const struct json_obj_descr *descr, const void *val,
+		  json_append_bytes_t append_bytes, void *data)
+{
+	void *ptr = (char *)val + descr->offset;
+
+	switch (descr->type) {
+	case JSON_TOK_FALSE:
+	case JSON_TOK_TRUE:
+		return bool_encode(ptr, append_bytes, data);
+	case JSON_TOK_STRING:
+		return str_encode(ptr, append_bytes, data);
+	case JSON_TOK_LIST_START:
+		return arr_encode(descr->element_descr, ptr,
+				  val, append_bytes, data);
+	case JSON_TOK_OBJECT_START:
+		return obj_encode(descr->sub_descr, descr->sub_descr_len,
+				  ptr, append_bytes, data);
+	case JSON_TOK_NUMBER:
+		return num_encode(ptr, append_bytes, data);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int obj_encode(const struct json_obj_descr *descr, size_t descr_len,
+		      const void *val, json_append_bytes_t append_bytes,
+		      void *data)
+{
+	size_t i;
+	int ret;
+
+	ret = append_bytes("{", 1, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (i = 0; i < descr_len; i++) {
+		ret = str_encode((const char **)&descr[i].field_name,
+				 append_bytes, data);
+		if (ret < 0) {
+			return ret;
+		}
+
+		ret = append_bytes(":", 1, data);
+		if (ret < 0) {
+			return ret;
+		}
+
+		ret = encode(&descr[i], val, append_bytes, data);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (i < descr_len - 1) {
+			ret = append_bytes(",", 1, data);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+	}
+
+	return append_bytes("}", 1, data);
+}
+
+int json_obj_encode(const struct json_obj_descr *descr, size_t descr_len,
+		    const void *val, json_append_bytes_t append_bytes,
+		    void *data)
+{
+	int ret;
+
+	ret = obj_encode(descr, descr_len, val, append_bytes, data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return append_bytes("", 1, data);
+}
+
+struct appender {
+	char *buffer;
+	size_t used;
+	size_t size;
+};
+
+static int append_bytes_to_buf(const char *bytes, size_t len, void *data)
+{
+	struct appender *appender = data;
+
+	if (len > appender->size - appender->used) {
+		return -ENOMEM;
+	}
+
+	memcpy(appender->buffer + appender->used, bytes, len);
+	appender->used += len;
+	appender->buffer[appender->used] = '\0';
+
+	return 0;
+}
+
+int json_obj_encode_buf(const struct json_obj_descr *descr, size_t descr_len,
+			const void *val, char *buffer, size_t buf_size)
+{
+	struct appender appender = { .buffer = buffer, .size = buf_size };
+
+	return json_obj_encode(descr, descr_len, val, append_bytes_to_buf,
+			       &appender);
+}
+
+static int measure_bytes(const char *bytes, size_t len, void *data)
+{
+	ssize_t *total = data;
+
+	*total += (ssize_t)len;
+
+	return 0;
+}
+
+ssize_t json_calc_encoded_len(const struct json_obj_descr *descr,
+			      size_t descr_len, const void *val)
+{
+	ssize_t total = 0;
+	int ret;
+
+	ret = json_obj_encode(descr, descr_len, val, measure_bytes, &total);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return total;
+}
+
+static int plan_text(struct json_plan *plan, const char *text, size_t len)
+{
+	if (len > plan->text_size - plan->text_len) {
+		return -ENOMEM;
+	}
+
+	memcpy(plan->text + plan->text_len, text, len);
+	plan->text_len += len;
+
+	return 0;
+}
+
+/*
+ * The text appended since the last operation is pending, it becomes
+ * the text of the next operation.
+ */
+static int plan_op(struct json_plan *plan, size_t *pending, u8_t type,
+		   ptrdiff_t offset)
+{
+	struct json_plan_op *op;
+
+	if (plan->ops_len == plan->ops_size) {
+		return -ENOMEM;
+	}
+
+	if (plan->text_len - *pending > UINT16_MAX) {
+		return -E2BIG;
+	}
+
+	op = &plan->ops[plan->ops_len++];
+	op->text = plan->text + *pending;
+	op->text_len = plan->text_len - *pending;
+	op->type = type;
+	op->offset = offset;
+	op->count_offset = 0;
+	op->elem_size = 0;
+	op->body_len = 0;
+
+	*pending = plan->text_len;
+
+	return 0;
+}
+
+static int plan_key(struct json_plan *plan, const struct json_obj_descr *descr)
+{
+	size_t i;
+	int ret;
+
+	ret = plan_text(plan, "\"", 1);
+
+	for (i = 0; !ret && i < descr->field_name_len; i++) {
+		char escaped = escape_as(descr->field_name[i]);
+
+		if (escaped) {
+			char bytes[2] = { '\\', escaped };
+
+			ret = plan_text(plan, bytes, 2);
+		} else {
+			ret = plan_text(plan, &descr->field_name[i], 1);
+		}
+	}
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	return plan_text(plan, "\":", 2);
+}
+
+static int plan_obj(struct json_plan *plan, size_t *pending,
+		    const struct json_obj_descr *descr, size_t descr_len,
+		    ptrdiff_t base);
+
+static int plan_value(struct json_plan *plan, size_t *pending,
+		      const struct json_obj_descr *descr, ptrdiff_t base)
+{
+	const struct json_obj_descr *elem_descr;
+	ptrdiff_t elem_size;
+	size_t op, body;
+	int ret;
+
+	switch (descr->type) {
 	case JSON_TOK_FALSE:
 	case JSON_TOK_TRUE:
-		return bool_encode(ptr, append_bytes, data);
 	case JSON_TOK_STRING:
-		return str_encode(ptr, append_bytes, data);
-	case JSON_TOK_LIST_START:
-		return arr_encode(descr->element_descr, ptr,
-				  val, append_bytes, data);
-	case JSON_TOK_OBJECT_START:
-		return obj_encode(descr->sub_descr, descr->sub_descr_len,
-				  ptr, append_bytes, data);
 	case JSON_TOK_NUMBER:
-		return num_encode(ptr, append_bytes, data);
+		return plan_op(plan, pending, descr->type,
+			       base + descr->offset);
+	case JSON_TOK_OBJECT_START:
+		/* Nested objects are inlined, their offsets being adjusted */
+		return plan_obj(plan, pending, descr->sub_descr,
+				descr->sub_descr_len, base + descr->offset);
+	case JSON_TOK_LIST_START:
+		break;
 	default:
 		return -EINVAL;
 	}
+
+	/*
+	 * As in arr_encode(), the offset of the element descriptor is the
+	 * offset of the number of elements, the elements themselves being
+	 * encoded as values at offset 0.
+	 */
+	elem_descr = descr->element_descr;
+	elem_size = get_elem_size(elem_descr);
+	if (elem_size <= 0 || elem_size > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	ret = plan_text(plan, "[", 1);
+	if (ret < 0) {
+		return ret;
+	}
+
+	op = plan->ops_len;
+	ret = plan_op(plan, pending, JSON_TOK_LIST_START,
+		      base + descr->offset);
+	if (ret < 0) {
+		return ret;
+	}
+
+	plan->ops[op].count_offset = base + elem_descr->offset;
+	plan->ops[op].elem_size = elem_size;
+
+	body = plan->ops_len;
+	ret = plan_value(plan, pending, elem_descr, -elem_descr->offset);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* The text closing an element must be written for each of them */
+	if (plan->text_len != *pending) {
+		ret = plan_op(plan, pending, JSON_TOK_NONE, 0);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (plan->ops_len - body > UINT16_MAX) {
+		return -E2BIG;
+	}
+
+	plan->ops[op].body_len = plan->ops_len - body;
+
+	return plan_text(plan, "]", 1);
 }
 
-static int obj_encode(const struct json_obj_descr *descr, size_t descr_len,
-		      const void *val, json_append_bytes_t append_bytes,
-		      void *data)
+static int plan_obj(struct json_plan *plan, size_t *pending,
+		    const struct json_obj_descr *descr, size_t descr_len,
+		    ptrdiff_t base)
 {
 	size_t i;
 	int ret;
 
-	ret = append_bytes("{", 1, data);
+	ret = plan_text(plan, "{", 1);
 	if (ret < 0) {
 		return ret;
 	}
 
 	for (i = 0; i < descr_len; i++) {
-		ret = str_encode((const char **)&descr[i].field_name,
-				 append_bytes, data);
-		if (ret < 0) {
-			return ret;
+		if (i > 0) {
+			ret = plan_text(plan, ",", 1);
+			if (ret < 0) {
+				return ret;
+			}
 		}
 
-		ret = append_bytes(":", 1, data);
+		ret = plan_key(plan, &descr[i]);
 		if (ret < 0) {
 			return ret;
 		}
 
-		ret = encode(&descr[i], val, append_bytes, data);
+		ret = plan_value(plan, pending, &descr[i], base);
 		if (ret < 0) {
 			return ret;
 		}
+	}
 
-		if (i < descr_len - 1) {
-			ret = append_bytes(",", 1, data);
+	return plan_text(plan, "}", 1);
+}
+
+int json_plan_compile(struct json_plan *plan,
+		      const struct json_obj_descr *descr, size_t descr_len,
+		      struct json_plan_op *ops, size_t ops_size,
+		      char *text, size_t text_size)
+{
+	size_t pending = 0;
+	int ret;
+
+	plan->ops = ops;
+	plan->ops_len = 0;
+	plan->ops_size = ops_size;
+	plan->text = text;
+	plan->text_len = 0;
+	plan->text_size = text_size;
+
+	ret = plan_obj(plan, &pending, descr, descr_len, 0);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return plan_op(plan, &pending, JSON_TOK_NONE, 0);
+}
+
+/*
+ * The output is written between pos and end, flush() being called to
+ * make room when it is full. Without flush(), the output is only
+ * measured.
+ */
+struct plan_writer {
+	char *pos;
+	char *end;
+	int (*flush)(struct plan_writer *writer);
+	size_t len;
+	char *start;
+	json_append_bytes_t append_bytes;
+	void *data;
+#if defined(CONFIG_JSON_NET_PKT)
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	s32_t timeout;
+#endif
+};
+
+static int plan_write(struct plan_writer *writer, const char *bytes,
+		      size_t len)
+{
+	size_t n;
+	int ret;
+
+	if (!writer->flush) {
+		writer->len += len;
+		return 0;
+	}
+
+	while (len) {
+		if (writer->pos == writer->end) {
+			ret = writer->flush(writer);
 			if (ret < 0) {
 				return ret;
 			}
 		}
+
+		n = min(len, (size_t)(writer->end - writer->pos));
+		memcpy(writer->pos, bytes, n);
+		writer->pos += n;
+		bytes += n;
+		len -= n;
 	}
 
-	return append_bytes("}", 1, data);
+	return 0;
 }
 
-int json_obj_encode(const struct json_obj_descr *descr, size_t descr_len,
-		    const void *val, json_append_bytes_t append_bytes,
-		    void *data)
+static int plan_write_str(struct plan_writer *writer, const char *str)
 {
+	char bytes[2] = { '\\', 0 };
+	const char *run;
 	int ret;
 
-	ret = obj_encode(descr, descr_len, val, append_bytes, data);
+	ret = plan_write(writer, "\"", 1);
+
+	/* The runs of characters without escape are written at once */
+	for (run = str; !ret; str++) {
+		bytes[1] = escape_as(*str);
+		if (!bytes[1] && *str) {
+			continue;
+		}
+
+		ret = plan_write(writer, run, str - run);
+		if (ret < 0 || !*str) {
+			break;
+		}
+
+		ret = plan_write(writer, bytes, 2);
+		run = str + 1;
+	}
+
 	if (ret < 0) {
 		return ret;
 	}
 
-	return append_bytes("", 1, data);
+	return plan_write(writer, "\"", 1);
 }
 
-struct appender {
-	char *buffer;
-	size_t used;
-	size_t size;
-};
-
-static int append_bytes_to_buf(const char *bytes, size_t len, void *data)
+static int plan_write_num(struct plan_writer *writer, s32_t num)
 {
-	struct appender *appender = data;
+	char buf[3 * sizeof(s32_t)];
+	int ret;
 
-	if (len > appender->size - appender->used) {
+	ret = snprintk(buf, sizeof(buf), "%d", num);
+	if (ret < 0) {
+		return ret;
+	}
+	if (ret >= (int)sizeof(buf)) {
 		return -ENOMEM;
 	}
 
-	memcpy(appender->buffer + appender->used, bytes, len);
-	appender->used += len;
-	appender->buffer[appender->used] = '\0';
+	return plan_write(writer, buf, ret);
+}
+
+static int plan_run(const struct json_plan_op *op,
+		    const struct json_plan_op *last, const char *val,
+		    struct plan_writer *writer)
+{
+	const char *field;
+	size_t i, n_elem;
+	int ret;
+
+	for (; op < last; op++) {
+		ret = plan_write(writer, op->text, op->text_len);
+		if (ret < 0) {
+			return ret;
+		}
+
+		field = val + op->offset;
+
+		switch (op->type) {
+		case JSON_TOK_NONE:
+			break;
+		case JSON_TOK_FALSE:
+		case JSON_TOK_TRUE:
+			if (*(const bool *)field) {
+				ret = plan_write(writer, "true", 4);
+			} else {
+				ret = plan_write(writer, "false", 5);
+			}
+			break;
+		case JSON_TOK_STRING:
+			ret = plan_write_str(writer, *(const char **)field);
+			break;
+		case JSON_TOK_NUMBER:
+			ret = plan_write_num(writer, *(const s32_t *)field);
+			break;
+		case JSON_TOK_LIST_START:
+			n_elem = *(const size_t *)(val + op->count_offset);
+
+			for (i = 0; !ret && i < n_elem; i++) {
+				if (i > 0) {
+					ret = plan_write(writer, ",", 1);
+					if (ret < 0) {
+						break;
+					}
+				}
+
+				ret = plan_run(op + 1, op + 1 + op->body_len,
+					       field, writer);
+				field += op->elem_size;
+			}
+
+			op += op->body_len;
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		if (ret < 0) {
+			return ret;
+		}
+	}
 
 	return 0;
 }
 
-int json_obj_encode_buf(const struct json_obj_descr *descr, size_t descr_len,
-			const void *val, char *buffer, size_t buf_size)
+ssize_t json_plan_calc_len(const struct json_plan *plan, const void *val)
 {
-	struct appender appender = { .buffer = buffer, .size = buf_size };
+	struct plan_writer writer = { .len = 0 };
+	int ret;
 
-	return json_obj_encode(descr, descr_len, val, append_bytes_to_buf,
-			       &appender);
+	ret = plan_run(plan->ops, plan->ops + plan->ops_len, val, &writer);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* The terminating NUL character */
+	return writer.len + 1;
 }
 
-static int measure_bytes(const char *bytes, size_t len, void *data)
+static int plan_buf_full(struct plan_writer *writer)
 {
-	ssize_t *total = data;
+	return -ENOMEM;
+}
 
-	*total += (ssize_t)len;
+int json_plan_encode_buf(const struct json_plan *plan, const void *val,
+			 char *buffer, size_t buf_size)
+{
+	struct plan_writer writer = {
+		.pos = buffer,
+		.end = buffer + buf_size,
+		.flush = plan_buf_full,
+	};
+	int ret;
 
-	return 0;
+	ret = plan_run(plan->ops, plan->ops + plan->ops_len, val, &writer);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return plan_write(&writer, "", 1);
 }
 
-ssize_t json_calc_encoded_len(const struct json_obj_descr *descr,
-			      size_t descr_len, const void *val)
+static int plan_append(struct plan_writer *writer)
 {
-	ssize_t total = 0;
 	int ret;
 
-	ret = json_obj_encode(descr, descr_len, val, measure_bytes, &total);
+	ret = writer->append_bytes(writer->start, writer->pos - writer->start,
+				   writer->data);
+	writer->pos = writer->start;
+
+	return ret;
+}
+
+int json_plan_encode(const struct json_plan *plan, const void *val,
+		     json_append_bytes_t append_bytes, void *data)
+{
+	char batch[CONFIG_JSON_PLAN_BATCH_SIZE];
+	struct plan_writer writer = {
+		.pos = batch,
+		.end = batch + sizeof(batch),
+		.flush = plan_append,
+		.start = batch,
+		.append_bytes = append_bytes,
+		.data = data,
+	};
+	int ret;
+
+	ret = plan_run(plan->ops, plan->ops + plan->ops_len, val, &writer);
 	if (ret < 0) {
 		return ret;
 	}
 
-	return total;
+	ret = plan_write(&writer, "", 1);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return plan_append(&writer);
+}
+
+#if defined(CONFIG_JSON_NET_PKT)
+/* Commits what was written in the current fragment */
+static void plan_pkt_commit(struct plan_writer *writer)
+{
+	if (writer->frag) {
+		net_buf_add(writer->frag, writer->pos - writer->start);
+		writer->start = writer->pos;
+	}
+}
+
+static int plan_pkt_frag(struct plan_writer *writer)
+{
+	struct net_buf *frag;
+
+	plan_pkt_commit(writer);
+
+	frag = net_pkt_get_frag(writer->pkt, writer->timeout);
+	if (!frag) {
+		return -ENOMEM;
+	}
+
+	net_pkt_frag_add(writer->pkt, frag);
+
+	writer->frag = frag;
+	writer->start = net_buf_tail(frag);
+	writer->pos = writer->start;
+	writer->end = writer->start + net_buf_tailroom(frag);
+
+	return 0;
+}
+
+int json_plan_encode_pkt(const struct json_plan *plan, const void *val,
+			 struct net_pkt *pkt, s32_t timeout)
+{
+	struct plan_writer writer = {
+		.flush = plan_pkt_frag,
+		.pkt = pkt,
+		.timeout = timeout,
+	};
+	int ret;
+
+	if (pkt->frags) {
+		writer.frag = net_buf_frag_last(pkt->frags);
+		writer.start = net_buf_tail(writer.frag);
+		writer.pos = writer.start;
+		writer.end = writer.start + net_buf_tailroom(writer.frag);
+	}
+
+	ret = plan_run(plan->ops, plan->ops + plan->ops_len, val, &writer);
+
+	plan_pkt_commit(&writer);
+
+	return ret;
 }
+#endif
@@ -8,6 +8,7 @@
 #define __JSON_H
 
 #include <misc/util.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <zephyr/types.h>
 #include <sys/types.h>
@@ -418,6 +419,172 @@ int json_obj_parse(char *json, size_t len,
 	const struct json_obj_descr *descr, size_t descr_len,
 	void *val);
 
+/**
+ * @brief Token, or piece of token, produced by json_tokenizer_feed().
+ *
+ * Strings and numbers are passed in pieces pointing into the data
+ * being fed, without copying it: a token split across two calls to
+ * json_tokenizer_feed() is passed as one piece with @a partial set,
+ * followed by the rest. Strings are passed without their quotes and
+ * are not unescaped. The other tokens have no data.
+ */
+struct json_token {
+	enum json_tokens type;
+	const char *start;
+	size_t len;
+	bool partial;
+};
+
+/**
+ * @brief Callback receiving the tokens from json_tokenizer_feed().
+ *
+ * @param token Token, valid during the call only
+ * @param data User-provided pointer
+ *
+ * @return A negative number stops the tokenizer, and is returned by
+ * json_tokenizer_feed(), or 0 to continue.
+ */
+typedef int (*json_token_cb_t)(const struct json_token *token, void *data);
+
+/**
+ * @brief Incremental JSON tokenizer, resumed by each call to
+ * json_tokenizer_feed().
+ */
+struct json_tokenizer {
+	json_token_cb_t cb;
+	void *data;
+	const char *literal;
+	enum json_tokens literal_type;
+	u8_t state;
+	u8_t count;
+};
+
+/**
+ * @brief Initializes a tokenizer.
+ *
+ * @param tokenizer Tokenizer to be initialized
+ *
+ * @param cb Callback receiving the tokens
+ *
+ * @param data User-provided pointer passed to @param cb
+ */
+void json_tokenizer_init(struct json_tokenizer *tokenizer,
+			 json_token_cb_t cb, void *data);
+
+/**
+ * @brief Feeds the next chunk of JSON data to a tokenizer.
+ *
+ * The chunks can be cut anywhere, the tokens complete in a chunk are
+ * passed to the callback before returning. A number only ends with
+ * the next character, so the last piece of a number is passed with
+ * the data that follows it.
+ *
+ * @param tokenizer Tokenizer
+ *
+ * @param json Chunk of JSON data, not modified
+ *
+ * @param len Length of the chunk
+ *
+ * @return 0 if the chunk has been consumed, -EINVAL if it is not
+ * valid JSON, or the error returned by the callback. The tokenizer
+ * keeps failing after an error.
+ */
+int json_tokenizer_feed(struct json_tokenizer *tokenizer, const char *json,
+			size_t len);
+
+/**
+ * @brief Container being decoded by a json_stream.
+ */
+struct json_stream_frame {
+	const struct json_obj_descr *descr;
+	size_t descr_len;
+	char *val;
+	size_t *elements;
+	ptrdiff_t elem_size;
+	s32_t decoded;
+	s8_t field;
+};
+
+/**
+ * @brief Decoder of a JSON object fed chunk by chunk, according to a
+ * descriptor.
+ */
+struct json_stream {
+	struct json_tokenizer tokenizer;
+	struct json_stream_frame stack[CONFIG_JSON_STREAM_DEPTH];
+	const struct json_obj_descr *descr;
+	size_t descr_len;
+	void *val;
+	char *strings;
+	size_t strings_size;
+	size_t strings_used;
+	size_t string_start;
+	char key[CONFIG_JSON_STREAM_KEY_LEN];
+	size_t key_len;
+	s64_t num;
+	int error;
+	u8_t depth;
+	u8_t skip;
+	u8_t state;
+	u8_t num_flags;
+	bool partial;
+};
+
+/**
+ * @brief Initializes the decoding of an object fed chunk by chunk with
+ * json_stream_feed(), with the same descriptors as json_obj_parse().
+ *
+ * The JSON data does not have to be contiguous nor to stay valid
+ * after being fed, the strings being copied to @param strings. Unknown
+ * keys are skipped, whatever their value, and null values are ignored.
+ * Numbers with a fraction or an exponent are not supported.
+ *
+ * @param stream Decoder to be initialized
+ *
+ * @param descr Pointer to the descriptor array
+ *
+ * @param descr_len Number of elements in the descriptor array, with the
+ * same limit as json_obj_parse()
+ *
+ * @param val Pointer to the struct to hold the decoded values
+ *
+ * @param strings Buffer holding the decoded strings, NUL-terminated
+ *
+ * @param strings_size Size of the strings buffer
+ */
+void json_stream_init(struct json_stream *stream,
+		      const struct json_obj_descr *descr, size_t descr_len,
+		      void *val, char *strings, size_t strings_size);
+
+/**
+ * @brief Feeds the next chunk of a JSON object to a decoder.
+ *
+ * As an example, an object received in the fragments of a network
+ * packet is decoded with:
+ *
+ *    for (frag = pkt->frags; frag; frag = frag->frags) {
+ *       ret = json_stream_feed(&stream, frag->data, frag->len);
+ *       if (ret != -EAGAIN) {
+ *          break;
+ *       }
+ *    }
+ *
+ * @param stream Decoder
+ *
+ * @param json Chunk of JSON data, not modified
+ *
+ * @param len Length of the chunk
+ *
+ * @return -EAGAIN if the object is not complete yet, bitmap of decoded
+ * fields once it is complete (as returned by json_obj_parse()), or any
+ * other negative value on error: -EINVAL for invalid JSON or a value of
+ * the wrong type, -ERANGE for a number out of range, -ENOSPC for an
+ * array with too many elements, -ENOMEM if the strings do not fit, or
+ * -E2BIG if the objects and arrays are nested too deep.
+ */
+int json_stream_feed(struct json_stream *stream, const char *json,
+		     size_t len);
+
 /**
  * @brief Escapes the string so it can be used to encode JSON objects
  *
@@ -501,4 +668,154 @@ int json_obj_encode(const struct json_obj_descr *descr, size_t descr_len,
 		    const void *val, json_append_bytes_t append_bytes,
 		    void *data);
 
+/**
+ * @brief Operation of an encoding plan, built by json_plan_compile().
+ *
+ * Writes the text that precedes a value, that is the brackets, the
+ * separators and the keys, then the value itself.
+ */
+struct json_plan_op {
+	const char *text;
+	/** Offset of the value from the start of the enclosing value */
+	ptrdiff_t offset;
+	/** For an array, offset of its number of elements */
+	ptrdiff_t count_offset;
+	u16_t text_len;
+	/** For an array, size of an element */
+	u16_t elem_size;
+	/** For an array, number of operations encoding an element */
+	u16_t body_len;
+	/** Type of the value, JSON_TOK_NONE if the operation is only text */
+	u8_t type;
+};
+
+/**
+ * @brief Encoding plan, a descriptor array compiled into a flat list
+ * of operations.
+ *
+ * The nested objects are inlined and the keys are escaped once, when
+ * the plan is compiled. The text between two values is merged into a
+ * single operation.
+ */
+struct json_plan {
+	struct json_plan_op *ops;
+	size_t ops_len;
+	size_t ops_size;
+	char *text;
+	size_t text_len;
+	size_t text_size;
+};
+
+/**
+ * @brief Compiles a descriptor array into an encoding plan
+ *
+ * The plan refers to @a ops and @a text, which must outlive it, but not
+ * to the descriptors.
+ *
+ * @param plan Plan to be compiled
+ *
+ * @param descr Pointer to the descriptor array
+ *
+ * @param descr_len Number of elements in the descriptor array
+ *
+ * @param ops Array to store the operations of the plan
+ *
+ * @param ops_size Number of elements in @a ops
+ *
+ * @param text Buffer to store the text of the plan
+ *
+ * @param text_size Size of @a text, in bytes
+ *
+ * @return 0 if the plan has been compiled, -ENOMEM if @a ops or @a text
+ * is too small, -EINVAL for a descriptor of an unknown type, or -E2BIG
+ * for an array element needing too many operations.
+ */
+int json_plan_compile(struct json_plan *plan,
+		      const struct json_obj_descr *descr, size_t descr_len,
+		      struct json_plan_op *ops, size_t ops_size,
+		      char *text, size_t text_size);
+
+/**
+ * @brief Calculates the length of an object encoded with a plan
+ *
+ * Only the values are measured, the length of the text being known
+ * from the plan.
+ *
+ * @param plan Compiled plan
+ *
+ * @param val Struct holding the values
+ *
+ * @return Number of bytes necessary to encode the values, including
+ * the terminating NUL character as with json_calc_encoded_len(), if >0,
+ * an error code is returned.
+ */
+ssize_t json_plan_calc_len(const struct json_plan *plan, const void *val);
+
+/**
+ * @brief Encodes an object with a plan in a contiguous memory location
+ *
+ * @param plan Compiled plan
+ *
+ * @param val Struct holding the values
+ *
+ * @param buffer Buffer to store the JSON data
+ *
+ * @param buf_size Size of buffer, in bytes, with space for the terminating
+ * NUL character
+ *
+ * @return 0 if object has been successfully encoded, -ENOMEM if the
+ * buffer is too small.
+ */
+int json_plan_encode_buf(const struct json_plan *plan, const void *val,
+			 char *buffer, size_t buf_size);
+
+/**
+ * @brief Encodes an object with a plan using an arbitrary writer function
+ *
+ * The output is gathered in batches of up to
+ * CONFIG_JSON_PLAN_BATCH_SIZE bytes, each passed in one call to
+ * @a append_bytes. As with json_obj_encode(), the last call appends
+ * the terminating NUL character.
+ *
+ * @param plan Compiled plan
+ *
+ * @param val Struct holding the values
+ *
+ * @param append_bytes Function to append bytes to the output
+ *
+ * @param data Data pointer to be passed to the append_bytes callback
+ * function.
+ *
+ * @return 0 if object has been successfully encoded. A negative value
+ * indicates an error.
+ */
+int json_plan_encode(const struct json_plan *plan, const void *val,
+		     json_append_bytes_t append_bytes, void *data);
+
+#if defined(CONFIG_JSON_NET_PKT)
+struct net_pkt;
+
+/**
+ * @brief Encodes an object with a plan at the end of a network packet
+ *
+ * The JSON data is written directly in the tailroom of the last fragment
+ * of @a pkt, and in new fragments added to it when it is full. No
+ * terminating NUL character is added.
+ *
+ * @param plan Compiled plan
+ *
+ * @param val Struct holding the values
+ *
+ * @param pkt Network packet
+ *
+ * @param timeout Timeout to wait for a new fragment
+ *
+ * @return 0 if object has been successfully encoded, -ENOMEM if no
+ * fragment could be allocated. The data written before the error is
+ * left in the packet.
+ */
+int json_plan_encode_pkt(const struct json_plan *plan, const void *val,
+			 struct net_pkt *pkt, s32_t timeout);
+#endif
+
 #endif /* __JSON_H */
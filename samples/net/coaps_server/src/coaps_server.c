@@ -48,6 +48,14 @@
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/ssl_cookie.h"
 
+#if defined(MBEDTLS_SSL_CACHE_C)
+#include "mbedtls/ssl_cache.h"
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include "mbedtls/ssl_ticket.h"
+#endif
+
 #if defined(MBEDTLS_DEBUG_C)
 #include "mbedtls/debug.h"
 #define DEBUG_THRESHOLD 0
@@ -424,6 +432,12 @@ void dtls_server(void)
 	struct net_buf *frag;
 
 	mbedtls_ssl_cookie_ctx cookie_ctx;
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_context cache;
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_context ticket_ctx;
+#endif
 	mbedtls_entropy_context entropy;
 	mbedtls_ctr_drbg_context ctr_drbg;
 	mbedtls_ssl_context ssl;
@@ -488,6 +502,33 @@ void dtls_server(void)
 	mbedtls_ssl_conf_dtls_cookies(&conf, mbedtls_ssl_cookie_write,
 				      mbedtls_ssl_cookie_check, &cookie_ctx);
 
+	/* Let the clients resume their session with an abbreviated
+	 * handshake when they come back.
+	 */
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_init(&cache);
+	mbedtls_ssl_conf_session_cache(&conf, &cache, mbedtls_ssl_cache_get,
+				       mbedtls_ssl_cache_set);
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_init(&ticket_ctx);
+
+	ret = mbedtls_ssl_ticket_setup(&ticket_ctx, mbedtls_ctr_drbg_random,
+				       &ctr_drbg, MBEDTLS_CIPHER_AES_128_CCM,
+				       MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME);
+	if (ret != 0) {
+		mbedtls_printf(" failed!\n"
+			       " mbedtls_ssl_ticket_setup returned -0x%x\n",
+			       -ret);
+		goto exit;
+	}
+
+	mbedtls_ssl_conf_session_tickets_cb(&conf, mbedtls_ssl_ticket_write,
+					    mbedtls_ssl_ticket_parse,
+					    &ticket_ctx);
+#endif
+
 	ret = mbedtls_ssl_setup(&ssl, &conf);
 	if (ret != 0) {
 		mbedtls_printf(" failed!\n"
@@ -625,6 +666,12 @@ close_notify:
 	goto reset;
 
 exit:
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_free(&ticket_ctx);
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_free(&cache);
+#endif
 	mbedtls_ssl_free(&ssl);
 	mbedtls_ssl_config_free(&conf);
 	mbedtls_ctr_drbg_free(&ctr_drbg);
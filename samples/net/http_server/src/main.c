@@ -31,7 +31,8 @@
 
 /* Sets the network parameters */
 
-#define RESULT_BUF_SIZE 1024
+/* Split between the connections of the server */
+#define RESULT_BUF_SIZE 4096
 static u8_t http_result[RESULT_BUF_SIZE];
 
 #if defined(CONFIG_HTTPS)
@@ -284,8 +284,9 @@ connected:
 
 	/* The connect message will be sent to the MQTT server (broker).
 	 * If clean_session here is 0, the mqtt_ctx clean_session variable
-	 * will be set to 0 also. Please don't do that, set always to 1.
-	 * Clean session = 0 is not yet supported.
+	 * will be set to 0 also. The server then keeps the session between
+	 * connections, and the in-flight messages are sent again after a
+	 * reconnection if CONFIG_MQTT_INFLIGHT_WINDOW is set.
 	 */
 	client_ctx.connect_msg.client_id = MQTT_CLIENTID;
 	client_ctx.connect_msg.client_id_len = strlen(MQTT_CLIENTID);
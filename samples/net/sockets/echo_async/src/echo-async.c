@@ -0,0 +1,195 @@
+/* echo-async.c - Single thread echo server using sockets and poll() */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <misc/printk.h>
+
+#include <net/net_if.h>
+#include <net/socket.h>
+
+#define PORT 4242
+
+/* Listening TCP and bound UDP sockets of both families come first, the
+ * accepted connections are added after them.
+ */
+#define NUM_SERVERS 4
+#define MAX_FDS CONFIG_NET_SOCKETS_POLL_MAX
+
+static struct pollfd fds[MAX_FDS];
+static int nfds;
+
+static u8_t buf[1280];
+
+static void add_fd(int sock)
+{
+	fds[nfds].fd = sock;
+	fds[nfds].events = POLLIN;
+	fds[nfds].revents = 0;
+	nfds++;
+}
+
+static void del_fd(int i)
+{
+	close(fds[i].fd);
+
+	nfds--;
+	fds[i] = fds[nfds];
+}
+
+static int setup_addresses(void)
+{
+	struct in6_addr addr6;
+	struct in_addr addr4;
+
+	if (inet_pton(AF_INET6, CONFIG_NET_APP_MY_IPV6_ADDR, &addr6) != 1 ||
+	    !net_if_ipv6_addr_add(net_if_get_default(), &addr6,
+				  NET_ADDR_MANUAL, 0)) {
+		printk("Cannot set IPv6 address %s\n",
+		       CONFIG_NET_APP_MY_IPV6_ADDR);
+		return -EINVAL;
+	}
+
+	if (inet_pton(AF_INET, CONFIG_NET_APP_MY_IPV4_ADDR, &addr4) != 1 ||
+	    !net_if_ipv4_addr_add(net_if_get_default(), &addr4,
+				  NET_ADDR_MANUAL, 0)) {
+		printk("Cannot set IPv4 address %s\n",
+		       CONFIG_NET_APP_MY_IPV4_ADDR);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int setup_server(sa_family_t family, int type)
+{
+	struct sockaddr addr = { .family = family };
+	socklen_t addrlen;
+	int sock;
+
+	if (family == AF_INET6) {
+		net_sin6(&addr)->sin6_port = htons(PORT);
+		addrlen = sizeof(struct sockaddr_in6);
+	} else {
+		net_sin(&addr)->sin_port = htons(PORT);
+		addrlen = sizeof(struct sockaddr_in);
+	}
+
+	sock = socket(family, type,
+		      type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP);
+	if (sock < 0) {
+		printk("Cannot create socket (%d)\n", errno);
+		return -errno;
+	}
+
+	if (bind(sock, &addr, addrlen) < 0) {
+		printk("Cannot bind socket (%d)\n", errno);
+		return -errno;
+	}
+
+	if (type == SOCK_STREAM && listen(sock, 2) < 0) {
+		printk("Cannot listen (%d)\n", errno);
+		return -errno;
+	}
+
+	/* The server must never block on a single client */
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+
+	add_fd(sock);
+
+	return 0;
+}
+
+static void handle_accept(int sock)
+{
+	int client;
+
+	client = accept(sock, NULL, NULL);
+	if (client < 0) {
+		return;
+	}
+
+	if (nfds == MAX_FDS) {
+		printk("Too many connections, closing %d\n", client);
+		close(client);
+		return;
+	}
+
+	fcntl(client, F_SETFL, O_NONBLOCK);
+
+	add_fd(client);
+}
+
+static void handle_udp(int sock)
+{
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	ssize_t len;
+
+	len = recvfrom(sock, buf, sizeof(buf), 0, &addr, &addrlen);
+	if (len > 0) {
+		sendto(sock, buf, len, 0, &addr, addrlen);
+	}
+}
+
+/* Returns false once the connection should be closed */
+static bool handle_tcp(int sock)
+{
+	ssize_t len, sent, ret;
+
+	len = recv(sock, buf, sizeof(buf), 0);
+	if (len <= 0) {
+		return len < 0 && errno == EAGAIN;
+	}
+
+	for (sent = 0; sent < len; sent += ret) {
+		ret = send(sock, buf + sent, len - sent, 0);
+		if (ret < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void main(void)
+{
+	int i;
+
+	if (setup_addresses() < 0 ||
+	    setup_server(AF_INET6, SOCK_STREAM) < 0 ||
+	    setup_server(AF_INET, SOCK_STREAM) < 0 ||
+	    setup_server(AF_INET6, SOCK_DGRAM) < 0 ||
+	    setup_server(AF_INET, SOCK_DGRAM) < 0) {
+		return;
+	}
+
+	printk("Echo server listening on port %d\n", PORT);
+
+	while (1) {
+		if (poll(fds, nfds, -1) < 0) {
+			printk("poll failed (%d)\n", errno);
+			return;
+		}
+
+		/* Walk backwards so that del_fd() does not skip an entry */
+		for (i = nfds - 1; i >= 0; i--) {
+			if (!fds[i].revents) {
+				continue;
+			}
+
+			if (i < 2) {
+				handle_accept(fds[i].fd);
+			} else if (i < NUM_SERVERS) {
+				handle_udp(fds[i].fd);
+			} else if (!handle_tcp(fds[i].fd)) {
+				del_fd(i);
+			}
+		}
+	}
+}
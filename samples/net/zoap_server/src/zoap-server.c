@@ -23,6 +23,7 @@
 
 #include <net/zoap.h>
 #include <net/zoap_link_format.h>
+#include <net/zoap_server.h>
 
 #if defined(CONFIG_NET_L2_BLUETOOTH)
 #include <bluetooth/bluetooth.h>
@@ -46,18 +47,10 @@
 #define MY_IP6ADDR \
 	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x1 } } }
 
-#define NUM_OBSERVERS 3
-
-#define NUM_PENDINGS 3
-
 static struct net_context *context;
 
 static const u8_t plain_text_format;
 
-static struct zoap_observer observers[NUM_OBSERVERS];
-
-static struct zoap_pending pendings[NUM_PENDINGS];
-
 static struct net_context *context;
 
 static struct k_delayed_work observer_work;
@@ -66,7 +59,7 @@ static int obs_counter;
 
 static struct zoap_resource *resource_to_notify;
 
-struct k_delayed_work retransmit_work;
+static struct zoap_server server;
 
 static int test_del(struct zoap_resource *resource,
 		    struct zoap_packet *request,
@@ -112,8 +105,7 @@ static int test_del(struct zoap_resource *resource,
 	zoap_header_set_id(&response, id);
 	zoap_header_set_token(&response, token, tkl);
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int test_put(struct zoap_resource *resource,
@@ -165,8 +157,7 @@ static int test_put(struct zoap_resource *resource,
 	zoap_header_set_id(&response, id);
 	zoap_header_set_token(&response, token, tkl);
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int test_post(struct zoap_resource *resource,
@@ -229,8 +220,7 @@ static int test_post(struct zoap_resource *resource,
 				*p, strlen(*p));
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int location_query_post(struct zoap_resource *resource,
@@ -292,8 +282,7 @@ static int location_query_post(struct zoap_resource *resource,
 				*p, strlen(*p));
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int piggyback_get(struct zoap_resource *resource,
@@ -365,8 +354,7 @@ static int piggyback_get(struct zoap_resource *resource,
 		return -EINVAL;
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int query_get(struct zoap_resource *resource,
@@ -454,8 +442,7 @@ static int query_get(struct zoap_resource *resource,
 		return -EINVAL;
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int separate_get(struct zoap_resource *resource,
@@ -465,7 +452,6 @@ static int separate_get(struct zoap_resource *resource,
 	struct net_pkt *pkt;
 	struct net_buf *frag;
 	struct zoap_packet response;
-	struct zoap_pending *pending;
 	u8_t *payload, code, type, tkl;
 	const u8_t *token;
 	u16_t len, id;
@@ -501,8 +487,7 @@ static int separate_get(struct zoap_resource *resource,
 	zoap_header_set_id(&response, id);
 	zoap_header_set_token(&response, token, tkl);
 
-	r = net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	r = zoap_server_send(&server, &response, from);
 	if (r < 0) {
 		return -EINVAL;
 	}
@@ -554,25 +539,7 @@ done:
 		return -EINVAL;
 	}
 
-	if (type == ZOAP_TYPE_CON) {
-		pending = zoap_pending_next_unused(pendings, NUM_PENDINGS);
-		if (!pending) {
-			return -EINVAL;
-		}
-
-		r = zoap_pending_init(pending, &response, from);
-		if (r) {
-			return -EINVAL;
-		}
-
-		zoap_pending_cycle(pending);
-		pending = zoap_pending_next_to_expire(pendings, NUM_PENDINGS);
-
-		k_delayed_work_submit(&retransmit_work, pending->timeout);
-	}
-
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int large_get(struct zoap_resource *resource,
@@ -661,8 +628,7 @@ static int large_get(struct zoap_resource *resource,
 		memset(&ctx, 0, sizeof(ctx));
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int large_update_put(struct zoap_resource *resource,
@@ -741,8 +707,7 @@ static int large_update_put(struct zoap_resource *resource,
 		return -EINVAL;
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static int large_create_post(struct zoap_resource *resource,
@@ -812,31 +777,35 @@ static int large_create_post(struct zoap_resource *resource,
 		return -EINVAL;
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static void update_counter(struct k_work *work)
 {
+	char payload[24];
+	int len;
+
 	obs_counter++;
 
 	if (resource_to_notify) {
-		zoap_resource_notify(resource_to_notify);
+		/* The payload that coap-client expects */
+		len = snprintk(payload, sizeof(payload), "Counter: %d\n",
+			       obs_counter);
+
+		zoap_server_notify(&server, resource_to_notify,
+				   plain_text_format, payload, len);
 	}
 
 	k_delayed_work_submit(&observer_work, 5 * MSEC_PER_SEC);
 }
 
 static int send_notification_packet(const struct sockaddr *addr, u16_t age,
-				    socklen_t addrlen, u16_t id,
-				    const u8_t *token, u8_t tkl,
-				    bool is_response)
+				    u16_t id, const u8_t *token, u8_t tkl)
 {
 	struct zoap_packet response;
-	struct zoap_pending *pending;
 	struct net_pkt *pkt;
 	struct net_buf *frag;
-	u8_t *payload, type = ZOAP_TYPE_CON;
+	u8_t *payload;
 	u16_t len;
 	int r;
 
@@ -853,17 +822,8 @@ static int send_notification_packet(const struct sockaddr *addr, u16_t age,
 	/* FIXME: Could be that zoap_packet_init() sets some defaults */
 	zoap_header_set_version(&response, 1);
 
-	if (is_response) {
-		type = ZOAP_TYPE_ACK;
-	}
-
-	zoap_header_set_type(&response, type);
+	zoap_header_set_type(&response, ZOAP_TYPE_ACK);
 	zoap_header_set_code(&response, ZOAP_RESPONSE_CODE_CONTENT);
-
-	if (!is_response) {
-		id = zoap_next_id();
-	}
-
 	zoap_header_set_id(&response, id);
 	zoap_header_set_token(&response, token, tkl);
 
@@ -893,54 +853,28 @@ static int send_notification_packet(const struct sockaddr *addr, u16_t age,
 		return -EINVAL;
 	}
 
-	if (type == ZOAP_TYPE_CON) {
-		pending = zoap_pending_next_unused(pendings, NUM_PENDINGS);
-		if (!pending) {
-			return -EINVAL;
-		}
-
-		r = zoap_pending_init(pending, &response, addr);
-		if (r) {
-			return -EINVAL;
-		}
-
-		zoap_pending_cycle(pending);
-		pending = zoap_pending_next_to_expire(pendings, NUM_PENDINGS);
-
-		k_delayed_work_submit(&retransmit_work, pending->timeout);
-	}
-
-	return net_context_sendto(pkt, addr, addrlen, NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, addr);
 }
 
 static int obs_get(struct zoap_resource *resource,
 		   struct zoap_packet *request,
 		   const struct sockaddr *from)
 {
-	struct zoap_observer *observer;
 	const u8_t *token;
 	u8_t code, type;
 	u16_t id;
 	u8_t tkl;
-	bool observe = true;
+	int r;
 
-	if (!zoap_request_is_observe(request)) {
-		observe = false;
-		goto done;
+	r = zoap_server_observe(&server, resource, request, from);
+	if (r < 0) {
+		return r;
 	}
 
-	observer = zoap_observer_next_unused(observers, NUM_OBSERVERS);
-	if (!observer) {
-		return -ENOMEM;
+	if (r) {
+		resource_to_notify = resource;
 	}
 
-	zoap_observer_init(observer, request, from);
-
-	zoap_register_observer(resource, observer);
-
-	resource_to_notify = resource;
-
-done:
 	code = zoap_header_get_code(request);
 	type = zoap_header_get_type(request);
 	id = zoap_header_get_id(request);
@@ -950,17 +884,8 @@ done:
 	NET_INFO("type: %u code %u id %u\n", type, code, id);
 	NET_INFO("*******\n");
 
-	return send_notification_packet(from, observe ? resource->age : 0,
-					sizeof(struct sockaddr_in6), id,
-					token, tkl, true);
-}
-
-static void obs_notify(struct zoap_resource *resource,
-		       struct zoap_observer *observer)
-{
-	send_notification_packet(&observer->addr, resource->age,
-				 sizeof(observer->addr), 0,
-				 observer->token, observer->tkl, false);
+	return send_notification_packet(from, r ? resource->age : 0,
+					id, token, tkl);
 }
 
 static int core_get(struct zoap_resource *resource,
@@ -1008,8 +933,7 @@ static int core_get(struct zoap_resource *resource,
 		return -EINVAL;
 	}
 
-	return net_context_sendto(pkt, from, sizeof(struct sockaddr_in6),
-				  NULL, 0, NULL, NULL);
+	return zoap_server_send(&server, &response, from);
 }
 
 static const char * const test_path[] = { "test", NULL };
@@ -1071,7 +995,6 @@ static struct zoap_resource resources[] = {
 	},
 	{ .path = obs_path,
 	  .get = obs_get,
-	  .notify = obs_notify,
 	},
 	ZOAP_WELL_KNOWN_CORE_RESOURCE,
 	{ .get = core_get,
@@ -1089,31 +1012,12 @@ static struct zoap_resource resources[] = {
 	{ },
 };
 
-static struct zoap_resource *find_resouce_by_observer(
-	struct zoap_resource *resources, struct zoap_observer *o)
-{
-	struct zoap_resource *r;
-
-	for (r = resources; r && r->path; r++) {
-		sys_snode_t *node;
-
-		SYS_SLIST_FOR_EACH_NODE(&r->observers, node) {
-			if (&o->list == node) {
-				return r;
-			}
-		}
-	}
-
-	return NULL;
-}
-
 static void udp_receive(struct net_context *context,
 			struct net_pkt *pkt,
 			int status,
 			void *user_data)
 {
 	struct zoap_packet request;
-	struct zoap_pending *pending;
 	struct sockaddr_in6 from;
 	int r, header_len;
 
@@ -1135,34 +1039,8 @@ static void udp_receive(struct net_context *context,
 		return;
 	}
 
-	pending = zoap_pending_received(&request, pendings,
-					NUM_PENDINGS);
-	if (pending) {
-		net_pkt_unref(pkt);
-		return;
-	}
-
-	if (zoap_header_get_type(&request) == ZOAP_TYPE_RESET) {
-		struct zoap_resource *r;
-		struct zoap_observer *o;
-
-		o = zoap_find_observer_by_addr(observers, NUM_OBSERVERS,
-					       (struct sockaddr *)&from);
-		if (!o) {
-			goto not_found;
-		}
-
-		r = find_resouce_by_observer(resources, o);
-		if (!r) {
-			goto not_found;
-		}
-
-		zoap_remove_observer(r, o);
-	}
-
-not_found:
-	r = zoap_handle_request(&request, resources,
-				(const struct sockaddr *) &from);
+	r = zoap_server_handle(&server, &request,
+			       (const struct sockaddr *) &from);
 
 	net_pkt_unref(pkt);
 
@@ -1210,31 +1088,6 @@ static bool join_coap_multicast_group(void)
 	return true;
 }
 
-static void retransmit_request(struct k_work *work)
-{
-	struct zoap_pending *pending;
-	int r;
-
-	pending = zoap_pending_next_to_expire(pendings, NUM_PENDINGS);
-	if (!pending) {
-		return;
-	}
-
-	r = net_context_sendto(pending->pkt, &pending->addr,
-			       sizeof(struct sockaddr_in6),
-			       NULL, 0, NULL, NULL);
-	if (r < 0) {
-		return;
-	}
-
-	if (!zoap_pending_cycle(pending)) {
-		zoap_pending_clear(pending);
-		return;
-	}
-
-	k_delayed_work_submit(&retransmit_work, pending->timeout);
-}
-
 void main(void)
 {
 	static struct sockaddr_in6 any_addr = {
@@ -1278,7 +1131,11 @@ void main(void)
 		return;
 	}
 
-	k_delayed_work_init(&retransmit_work, retransmit_request);
+	r = zoap_server_init(&server, context, resources);
+	if (r) {
+		NET_ERR("Could not init the CoAP server\n");
+		return;
+	}
 
 	k_delayed_work_init(&observer_work, update_counter);
 	k_delayed_work_submit(&observer_work, 5 * MSEC_PER_SEC);
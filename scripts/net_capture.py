@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2017 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+"""Extract a network packet capture from a console log.
+
+With CONFIG_NET_CAPTURE_OUTPUT_CONSOLE, the device prints each pcapng
+block of a capture as a line of hex digits prefixed by "pcapng:". This
+script collects those lines from a saved console log, or from the
+standard input, and writes them to a pcapng file. The output is a
+classic pcap file instead if its name ends with ".pcap", which requires
+all the captured packets to have the same link type.
+
+Example, with the UART of the device on /dev/ttyACM0:
+
+    $ cat /dev/ttyACM0 | tee console.log
+    uart:~$ net capture start udp port 4242
+    ...
+    uart:~$ net capture stop
+    $ scripts/net_capture.py console.log capture.pcapng
+    $ wireshark capture.pcapng
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+PCAPNG_SHB = 0x0a0d0d0a
+PCAPNG_IDB = 0x00000001
+PCAPNG_EPB = 0x00000006
+PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d
+
+PCAP_MAGIC = 0xa1b2c3d4
+
+block_re = re.compile(r"pcapng:([0-9a-fA-F]+)")
+
+
+def read_blocks(log):
+    """Yield the (endian, type, block) of the valid blocks of the log."""
+    endian = None
+
+    for lineno, line in enumerate(log, 1):
+        match = block_re.search(line)
+        if not match:
+            continue
+
+        try:
+            block = bytes.fromhex(match.group(1))
+        except ValueError:
+            block = b""
+
+        if len(block) < 12 or len(block) % 4:
+            sys.stderr.write("line %d: truncated block, ignored\n" % lineno)
+            continue
+
+        if block[:4] == struct.pack("<I", PCAPNG_SHB):
+            magic = block[8:12]
+            if magic == struct.pack("<I", PCAPNG_BYTE_ORDER_MAGIC):
+                endian = "<"
+            elif magic == struct.pack(">I", PCAPNG_BYTE_ORDER_MAGIC):
+                endian = ">"
+            else:
+                sys.stderr.write("line %d: bad byte order magic\n" % lineno)
+                endian = None
+                continue
+
+        if not endian:
+            sys.stderr.write("line %d: block outside a section, ignored\n" %
+                             lineno)
+            continue
+
+        btype, blen = struct.unpack(endian + "II", block[:8])
+        end_len, = struct.unpack(endian + "I", block[-4:])
+        if blen != len(block) or end_len != len(block):
+            sys.stderr.write("line %d: corrupted block, ignored\n" % lineno)
+            continue
+
+        yield endian, btype, block
+
+
+def write_pcapng(blocks, out):
+    for endian, btype, block in blocks:
+        out.write(block)
+
+
+def write_pcap(blocks, out):
+    linktypes = []
+    snaplen = 0
+    header = False
+
+    for endian, btype, block in blocks:
+        if btype == PCAPNG_SHB:
+            linktypes = []
+        elif btype == PCAPNG_IDB:
+            linktype, _, ifsnaplen = struct.unpack(endian + "HHI",
+                                                   block[8:16])
+            linktypes.append(linktype)
+            snaplen = max(snaplen, ifsnaplen)
+        elif btype == PCAPNG_EPB:
+            iface, ts_high, ts_low, caplen, origlen = \
+                struct.unpack(endian + "IIIII", block[8:28])
+            linktype = linktypes[iface]
+
+            if not header:
+                out.write(struct.pack("<IHHiIII", PCAP_MAGIC, 2, 4, 0, 0,
+                                      snaplen or 65535, linktype))
+                header = linktype
+            elif header != linktype:
+                sys.exit("Packets have different link types, "
+                         "use the pcapng format")
+
+            # The device records the timestamps in milliseconds
+            ts = ((ts_high << 32) | ts_low) * 1000
+            out.write(struct.pack("<IIII", ts // 1000000, ts % 1000000,
+                                  caplen, origlen))
+            out.write(block[28:28 + caplen])
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"),
+                        default=sys.stdin,
+                        help="Console log, the standard input by default")
+    parser.add_argument("output", help="pcapng or pcap file to write")
+
+    args = parser.parse_args()
+
+    blocks = read_blocks(args.log)
+
+    with open(args.output, "wb") as out:
+        if args.output.endswith(".pcap"):
+            write_pcap(blocks, out)
+        else:
+            write_pcapng(blocks, out)
+
+
+if __name__ == "__main__":
+    main()
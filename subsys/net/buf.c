@@ -177,6 +177,10 @@ success:
 #if defined(CONFIG_NET_BUF_POOL_USAGE)
 	pool->avail_count--;
 	NET_BUF_ASSERT(pool->avail_count >= 0);
+
+	if (pool->avail_count < pool->min_avail_count) {
+		pool->min_avail_count = pool->avail_count;
+	}
 #endif
 
 	return buf;
@@ -300,6 +304,9 @@ struct net_buf *net_buf_clone(struct net_buf *buf, s32_t timeout)
 
 	NET_BUF_ASSERT(buf);
 
+	/* The pool of an external data buffer has no storage to copy to */
+	NET_BUF_ASSERT(!(buf->flags & NET_BUF_EXTERNAL_DATA));
+
 	pool = net_buf_pool_get(buf->pool_id);
 
 	clone = net_buf_alloc(pool, timeout);
@@ -85,6 +85,33 @@ static inline bool net_6lo_maddr_48_bit_compressible(struct in6_addr *addr)
 		 (addr->s6_addr[10] == 0x00));
 }
 
+static inline void relocate_ll_addr(struct net_linkaddr *lladdr,
+				    u8_t *from, u8_t *to, u8_t len)
+{
+	if (lladdr->addr >= from && lladdr->addr < from + len) {
+		lladdr->addr = to + (lladdr->addr - from);
+	}
+}
+
+/* The link layer header is found right in front of the IPv6 data, so it
+ * must follow when the start of the data moves. The link layer addresses
+ * can point into it, so they are updated too.
+ */
+static void relocate_ll_hdr(struct net_pkt *pkt, u8_t *to)
+{
+	u8_t *from = net_pkt_ll(pkt);
+	u8_t len = net_pkt_ll_reserve(pkt);
+
+	if (!len || from == to) {
+		return;
+	}
+
+	memmove(to, from, len);
+
+	relocate_ll_addr(net_pkt_ll_src(pkt), from, to, len);
+	relocate_ll_addr(net_pkt_ll_dst(pkt), from, to, len);
+}
+
 #if defined(CONFIG_NET_6LO_CONTEXT)
 /* RFC 6775, 4.2, 5.4.2, 5.4.3 and 7.2*/
 static inline void set_6lo_context(struct net_if *iface, u8_t index,
@@ -196,7 +223,7 @@ get_6lo_context_by_addr(struct net_if *iface, struct in6_addr *addr)
  * DSCP(6), ECN(2).
  */
 static inline u8_t compress_tfl(struct net_ipv6_hdr *ipv6,
-				   struct net_buf *frag,
+				   u8_t *iphc,
 				   u8_t offset)
 {
 	u8_t tcl;
@@ -209,35 +236,35 @@ static inline u8_t compress_tfl(struct net_ipv6_hdr *ipv6,
 			NET_DBG("Trafic class and Flow label elided");
 
 			/* Trafic class and Flow label elided */
-			IPHC[0] |= NET_6LO_IPHC_TF_11;
+			iphc[0] |= NET_6LO_IPHC_TF_11;
 		} else {
 			NET_DBG("Flow label elided");
 
 			/* Flow label elided */
-			IPHC[0] |= NET_6LO_IPHC_TF_10;
-			IPHC[offset++] = tcl;
+			iphc[0] |= NET_6LO_IPHC_TF_10;
+			iphc[offset++] = tcl;
 		}
 	} else {
 		if (((ipv6->vtc & 0x0F) == 0) && (ipv6->tcflow & 0x30)) {
 			NET_DBG("ECN + 2-bit Pad + Flow Label, DSCP is elided");
 
 			/* ECN + 2-bit Pad + Flow Label, DSCP is elided.*/
-			IPHC[0] |= NET_6LO_IPHC_TF_01;
-			IPHC[offset++] = (tcl & 0xC0) | (ipv6->tcflow & 0x0F);
+			iphc[0] |= NET_6LO_IPHC_TF_01;
+			iphc[offset++] = (tcl & 0xC0) | (ipv6->tcflow & 0x0F);
 
-			memcpy(&IPHC[offset], &ipv6->flow, 2);
+			memcpy(&iphc[offset], &ipv6->flow, 2);
 			offset += 2;
 		} else {
 			NET_DBG("ECN + DSCP + 4-bit Pad + Flow Label");
 
 			/* ECN + DSCP + 4-bit Pad + Flow Label */
-			IPHC[0] |= NET_6LO_IPHC_TF_00;
+			iphc[0] |= NET_6LO_IPHC_TF_00;
 
 			/* Elide the version field */
-			IPHC[offset++] = tcl;
-			IPHC[offset++] = ipv6->tcflow & 0x0F;
+			iphc[offset++] = tcl;
+			iphc[offset++] = ipv6->tcflow & 0x0F;
 
-			memcpy(&IPHC[offset], &ipv6->flow, 2);
+			memcpy(&iphc[offset], &ipv6->flow, 2);
 			offset += 2;
 		}
 	}
@@ -245,39 +272,41 @@ static inline u8_t compress_tfl(struct net_ipv6_hdr *ipv6,
 	return offset;
 }
 
+/* Hop limits that have a HLIM encoding of their own, indexed by it */
+static const u8_t hop_limits[] = {
+	[NET_6LO_IPHC_HLIM1] = 1,
+	[NET_6LO_IPHC_HLIM64] = 64,
+	[NET_6LO_IPHC_HLIM255] = 255,
+};
+
 /* Helper to compress Hop limit */
 static inline u8_t compress_hoplimit(struct net_ipv6_hdr *ipv6,
-					struct net_buf *frag,
+					u8_t *iphc,
 					u8_t offset)
 {
-	/* Hop Limit */
-	switch (ipv6->hop_limit) {
-	case 1:
-		IPHC[0] |= NET_6LO_IPHC_HLIM1;
-		break;
-	case 64:
-		IPHC[0] |= NET_6LO_IPHC_HLIM64;
-		break;
-	case 255:
-		IPHC[0] |= NET_6LO_IPHC_HLIM255;
-		break;
-	default:
-		IPHC[offset++] = ipv6->hop_limit;
-		break;
+	u8_t i;
+
+	for (i = NET_6LO_IPHC_HLIM1; i <= NET_6LO_IPHC_HLIM255; i++) {
+		if (ipv6->hop_limit == hop_limits[i]) {
+			iphc[0] |= i;
+			return offset;
+		}
 	}
 
+	iphc[offset++] = ipv6->hop_limit;
+
 	return offset;
 }
 
 /* Helper to compress Next header */
 static inline u8_t compress_nh(struct net_ipv6_hdr *ipv6,
-				  struct net_buf *frag, u8_t offset)
+				  u8_t *iphc, u8_t offset)
 {
 	/* Next header */
 	if (ipv6->nexthdr == IPPROTO_UDP) {
-		IPHC[0] |= NET_6LO_IPHC_NH_1;
+		iphc[0] |= NET_6LO_IPHC_NH_1;
 	} else {
-		IPHC[offset++] = ipv6->nexthdr;
+		iphc[offset++] = ipv6->nexthdr;
 	}
 
 	return offset;
@@ -286,15 +315,15 @@ static inline u8_t compress_nh(struct net_ipv6_hdr *ipv6,
 /* Helpers to compress Source Address */
 static inline u8_t compress_sa(struct net_ipv6_hdr *ipv6,
 				  struct net_pkt *pkt,
-				  struct net_buf *frag,
+				  u8_t *iphc,
 				  u8_t offset)
 {
 	if (net_is_ipv6_addr_unspecified(&ipv6->src)) {
 		NET_DBG("SAM_00, SAC_1 unspecified src address");
 
 		/* Unspecified IPv6 src address */
-		IPHC[1] |= NET_6LO_IPHC_SAC_1;
-		IPHC[1] |= NET_6LO_IPHC_SAM_00;
+		iphc[1] |= NET_6LO_IPHC_SAC_1;
+		iphc[1] |= NET_6LO_IPHC_SAM_00;
 
 		return offset;
 	}
@@ -309,9 +338,9 @@ static inline u8_t compress_sa(struct net_ipv6_hdr *ipv6,
 		if (net_6lo_addr_16_bit_compressible(&ipv6->src)) {
 			NET_DBG("SAM_10 src addr 16 bit compressible");
 
-			IPHC[1] |= NET_6LO_IPHC_SAM_10;
+			iphc[1] |= NET_6LO_IPHC_SAM_10;
 
-			memcpy(&IPHC[offset], &ipv6->src.s6_addr[14], 2);
+			memcpy(&iphc[offset], &ipv6->src.s6_addr[14], 2);
 			offset += 2;
 		} else {
 			if (!net_pkt_ll_src(pkt)) {
@@ -324,23 +353,23 @@ static inline u8_t compress_sa(struct net_ipv6_hdr *ipv6,
 				NET_DBG("SAM_11 src address is fully elided");
 
 				/* Address is fully elided */
-				IPHC[1] |= NET_6LO_IPHC_SAM_11;
+				iphc[1] |= NET_6LO_IPHC_SAM_11;
 			} else {
 				NET_DBG("SAM_01 src 64 bits are inlined");
 
 				/* Remaining 64 bits are in-line */
-				IPHC[1] |= NET_6LO_IPHC_SAM_01;
+				iphc[1] |= NET_6LO_IPHC_SAM_01;
 
-				memcpy(&IPHC[offset], &ipv6->src.s6_addr[8], 8);
+				memcpy(&iphc[offset], &ipv6->src.s6_addr[8], 8);
 				offset += 8;
 			}
 		}
 	} else {
 		NET_DBG("SAM_00 full src address is carried in-line");
 		/* full address is carried in-line */
-		IPHC[1] |= NET_6LO_IPHC_SAM_00;
+		iphc[1] |= NET_6LO_IPHC_SAM_00;
 
-		memcpy(&IPHC[offset], ipv6->src.s6_addr,
+		memcpy(&iphc[offset], ipv6->src.s6_addr,
 		       sizeof(struct in6_addr));
 		offset += sizeof(struct in6_addr);
 	}
@@ -351,37 +380,37 @@ static inline u8_t compress_sa(struct net_ipv6_hdr *ipv6,
 #if defined(CONFIG_NET_6LO_CONTEXT)
 static inline u8_t compress_sa_ctx(struct net_ipv6_hdr *ipv6,
 				      struct net_pkt *pkt,
-				      struct net_buf *frag,
+				      u8_t *iphc,
 				      u8_t offset,
 				      struct net_6lo_context *src)
 {
 	if (!src) {
-		return compress_sa(ipv6, pkt, frag, offset);
+		return compress_sa(ipv6, pkt, iphc, offset);
 	}
 
-	IPHC[1] |= NET_6LO_IPHC_SAC_1;
+	iphc[1] |= NET_6LO_IPHC_SAC_1;
 
 	/* Following 64 bits are 0000:00ff:fe00:XXXX */
 	if (net_6lo_addr_16_bit_compressible(&ipv6->src)) {
 		NET_DBG("SAM_10 src addr 16 bit compressible");
 
-		IPHC[1] |= NET_6LO_IPHC_SAM_10;
+		iphc[1] |= NET_6LO_IPHC_SAM_10;
 
-		memcpy(&IPHC[offset], &ipv6->src.s6_addr[14], 2);
+		memcpy(&iphc[offset], &ipv6->src.s6_addr[14], 2);
 		offset += 2;
 	} else if (net_ipv6_addr_based_on_ll(&ipv6->src,
 					     net_pkt_ll_src(pkt))) {
 		NET_DBG("SAM_11 src address is fully elided");
 
 		/* Address is fully elided */
-		IPHC[1] |= NET_6LO_IPHC_SAM_11;
+		iphc[1] |= NET_6LO_IPHC_SAM_11;
 	} else {
 		NET_DBG("SAM_01 src remaining 64 bits are inlined");
 
 		/* Remaining 64 bits are in-line */
-		IPHC[1] |= NET_6LO_IPHC_SAM_01;
+		iphc[1] |= NET_6LO_IPHC_SAM_01;
 
-		memcpy(&IPHC[offset], &ipv6->src.s6_addr[8], 8);
+		memcpy(&iphc[offset], &ipv6->src.s6_addr[8], 8);
 		offset += 8;
 	}
 
@@ -392,10 +421,10 @@ static inline u8_t compress_sa_ctx(struct net_ipv6_hdr *ipv6,
 /* Helpers to compress Destination Address */
 static inline u8_t compress_da_mcast(struct net_ipv6_hdr *ipv6,
 					struct net_pkt *pkt,
-					struct net_buf *frag,
+					u8_t *iphc,
 					u8_t offset)
 {
-	IPHC[1] |= NET_6LO_IPHC_M_1;
+	iphc[1] |= NET_6LO_IPHC_M_1;
 
 	NET_DBG("M_1 dst is mcast");
 
@@ -403,37 +432,37 @@ static inline u8_t compress_da_mcast(struct net_ipv6_hdr *ipv6,
 		NET_DBG("DAM_11 dst maddr 8 bit compressible");
 
 		/* last byte */
-		IPHC[1] |= NET_6LO_IPHC_DAM_11;
+		iphc[1] |= NET_6LO_IPHC_DAM_11;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[15], 1);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[15], 1);
 		offset++;
 	} else if (net_6lo_maddr_32_bit_compressible(&ipv6->dst)) {
 		NET_DBG("DAM_10 4 bytes: 2nd byte + last three bytes");
 
 		/* 4 bytes: 2nd byte + last three bytes */
-		IPHC[1] |= NET_6LO_IPHC_DAM_10;
+		iphc[1] |= NET_6LO_IPHC_DAM_10;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[1], 1);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[1], 1);
 		offset++;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[13], 3);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[13], 3);
 		offset += 3;
 	} else if (net_6lo_maddr_48_bit_compressible(&ipv6->dst)) {
 		NET_DBG("DAM_01 6 bytes: 2nd byte + last five bytes");
 
 		/* 6 bytes: 2nd byte + last five bytes */
-		IPHC[1] |= NET_6LO_IPHC_DAM_01;
+		iphc[1] |= NET_6LO_IPHC_DAM_01;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[1], 1);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[1], 1);
 		offset++;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[11], 5);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[11], 5);
 		offset += 5;
 	} else {
 		NET_DBG("DAM_00 dst complete addr inlined");
 
-		/* complete address IPHC[1] |= NET_6LO_IPHC_DAM_00 */
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[0], 16);
+		/* complete address iphc[1] |= NET_6LO_IPHC_DAM_00 */
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[0], 16);
 		offset += 16;
 	}
 
@@ -443,12 +472,12 @@ static inline u8_t compress_da_mcast(struct net_ipv6_hdr *ipv6,
 
 static inline u8_t compress_da(struct net_ipv6_hdr *ipv6,
 				  struct net_pkt *pkt,
-				  struct net_buf *frag,
+				  u8_t *iphc,
 				  u8_t offset)
 {
 	/* If destination address is multicast */
 	if (net_is_ipv6_addr_mcast(&ipv6->dst)) {
-		return compress_da_mcast(ipv6, pkt, frag, offset);
+		return compress_da_mcast(ipv6, pkt, iphc, offset);
 	}
 
 	/* If address is link-local prefix and padded with zeros */
@@ -461,9 +490,9 @@ static inline u8_t compress_da(struct net_ipv6_hdr *ipv6,
 		if (net_6lo_addr_16_bit_compressible(&ipv6->dst)) {
 			NET_DBG("DAM_10 dst addr 16 bit compressible");
 
-			IPHC[1] |= NET_6LO_IPHC_DAM_10;
+			iphc[1] |= NET_6LO_IPHC_DAM_10;
 
-			memcpy(&IPHC[offset], &ipv6->dst.s6_addr[14], 2);
+			memcpy(&iphc[offset], &ipv6->dst.s6_addr[14], 2);
 			offset += 2;
 		} else {
 			if (!net_pkt_ll_dst(pkt)) {
@@ -476,22 +505,22 @@ static inline u8_t compress_da(struct net_ipv6_hdr *ipv6,
 				NET_DBG("DAM_11 dst addr fully elided");
 
 				/* Address is fully elided */
-				IPHC[1] |= NET_6LO_IPHC_DAM_11;
+				iphc[1] |= NET_6LO_IPHC_DAM_11;
 			} else {
 				NET_DBG("DAM_01 remaining 64 bits are inlined");
 
 				/* Remaining 64 bits are in-line */
-				IPHC[1] |= NET_6LO_IPHC_DAM_01;
+				iphc[1] |= NET_6LO_IPHC_DAM_01;
 
-				memcpy(&IPHC[offset], &ipv6->dst.s6_addr[8], 8);
+				memcpy(&iphc[offset], &ipv6->dst.s6_addr[8], 8);
 				offset += 8;
 			}
 		}
 	} else {
 		NET_DBG("DAM_00 dst full addr inlined");
-		IPHC[1] |= NET_6LO_IPHC_DAM_00;
+		iphc[1] |= NET_6LO_IPHC_DAM_00;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[0], 16);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[0], 16);
 		offset += 16;
 	}
 
@@ -501,23 +530,23 @@ static inline u8_t compress_da(struct net_ipv6_hdr *ipv6,
 #if defined(CONFIG_NET_6LO_CONTEXT)
 static inline u8_t compress_da_ctx(struct net_ipv6_hdr *ipv6,
 				      struct net_pkt *pkt,
-				      struct net_buf *frag,
+				      u8_t *iphc,
 				      u8_t offset,
 				      struct net_6lo_context *dst)
 {
 	if (!dst) {
-		return compress_da(ipv6, pkt, frag, offset);
+		return compress_da(ipv6, pkt, iphc, offset);
 	}
 
-	IPHC[1] |= NET_6LO_IPHC_DAC_1;
+	iphc[1] |= NET_6LO_IPHC_DAC_1;
 
 	/* Following 64 bits are 0000:00ff:fe00:XXXX */
 	if (net_6lo_addr_16_bit_compressible(&ipv6->dst)) {
 		NET_DBG("DAM_10 dst addr 16 bit compressible");
 
-		IPHC[1] |= NET_6LO_IPHC_DAM_10;
+		iphc[1] |= NET_6LO_IPHC_DAM_10;
 
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[14], 2);
+		memcpy(&iphc[offset], &ipv6->dst.s6_addr[14], 2);
 		offset += 2;
 	} else {
 		if (net_ipv6_addr_based_on_ll(&ipv6->dst,
@@ -525,14 +554,14 @@ static inline u8_t compress_da_ctx(struct net_ipv6_hdr *ipv6,
 			NET_DBG("DAM_11 dst addr fully elided");
 
 			/* Address is fully elided */
-			IPHC[1] |= NET_6LO_IPHC_DAM_11;
+			iphc[1] |= NET_6LO_IPHC_DAM_11;
 		} else {
 			NET_DBG("DAM_01 remaining 64 bits are inlined");
 
 			/* Remaining 64 bits are in-line */
-			IPHC[1] |= NET_6LO_IPHC_DAM_01;
+			iphc[1] |= NET_6LO_IPHC_DAM_01;
 
-			memcpy(&IPHC[offset], &ipv6->dst.s6_addr[8], 8);
+			memcpy(&iphc[offset], &ipv6->dst.s6_addr[8], 8);
 			offset += 8;
 		}
 	}
@@ -543,7 +572,7 @@ static inline u8_t compress_da_ctx(struct net_ipv6_hdr *ipv6,
 
 /* Helper to compress Next header UDP */
 static inline u8_t compress_nh_udp(struct net_udp_hdr *udp,
-				      struct net_buf *frag, u8_t offset)
+				      u8_t *iphc, u8_t offset)
 {
 	u8_t tmp;
 
@@ -573,14 +602,14 @@ static inline u8_t compress_nh_udp(struct net_udp_hdr *udp,
 		/** src: first 16 bits elided, next 4 bits inlined
 		  * dst: first 16 bits elided, next 4 bits inlined
 		  */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_11;
+		iphc[offset] |= NET_6LO_NHC_UDP_PORT_11;
 		offset++;
 
 		tmp = (u8_t)(htons(udp->src_port));
 		tmp = tmp << 4;
 
 		tmp |= (((u8_t)(htons(udp->dst_port))) & 0x0F);
-		IPHC[offset++] = tmp;
+		iphc[offset++] = tmp;
 	} else if (((htons(udp->dst_port) >> 8) & 0xFF) ==
 		   NET_6LO_NHC_UDP_8_BIT_PORT) {
 
@@ -588,13 +617,13 @@ static inline u8_t compress_nh_udp(struct net_udp_hdr *udp,
 		/* dst: first 8 bits elided, next 8 bits inlined
 		 * src: fully carried inline
 		 */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_01;
+		iphc[offset] |= NET_6LO_NHC_UDP_PORT_01;
 		offset++;
 
-		memcpy(&IPHC[offset], &udp->src_port, 2);
+		memcpy(&iphc[offset], &udp->src_port, 2);
 		offset += 2;
 
-		IPHC[offset++] = (u8_t)(htons(udp->dst_port));
+		iphc[offset++] = (u8_t)(htons(udp->dst_port));
 	} else if (((htons(udp->src_port) >> 8) & 0xFF) ==
 		    NET_6LO_NHC_UDP_8_BIT_PORT) {
 
@@ -602,24 +631,24 @@ static inline u8_t compress_nh_udp(struct net_udp_hdr *udp,
 		/* src: first 8 bits elided, next 8 bits inlined
 		 * dst: fully carried inline
 		 */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_10;
+		iphc[offset] |= NET_6LO_NHC_UDP_PORT_10;
 		offset++;
 
-		IPHC[offset++] = (u8_t)(htons(udp->src_port));
+		iphc[offset++] = (u8_t)(htons(udp->src_port));
 
-		memcpy(&IPHC[offset], &udp->dst_port, 2);
+		memcpy(&iphc[offset], &udp->dst_port, 2);
 		offset += 2;
 	} else {
 		NET_DBG("Can not compress ports, ports are inlined");
 
 		/* can not compress ports, ports are inlined */
 		offset++;
-		memcpy(&IPHC[offset], &udp->src_port, 4);
+		memcpy(&iphc[offset], &udp->src_port, 4);
 		offset += 4;
 	}
 
 	/* All 16 bits of udp chksum are inlined, length is elided */
-	memcpy(&IPHC[offset], &udp->chksum, 2);
+	memcpy(&iphc[offset], &udp->chksum, 2);
 	offset += 2;
 
 	return offset;
@@ -628,7 +657,7 @@ static inline u8_t compress_nh_udp(struct net_udp_hdr *udp,
 #if defined(CONFIG_NET_6LO_CONTEXT)
 static inline bool is_src_and_dst_addr_ctx_based(struct net_ipv6_hdr *ipv6,
 						 struct net_pkt *pkt,
-						 struct net_buf *frag,
+						 u8_t *iphc,
 						 struct net_6lo_context **src,
 						 struct net_6lo_context **dst)
 {
@@ -649,17 +678,17 @@ static inline bool is_src_and_dst_addr_ctx_based(struct net_ipv6_hdr *ipv6,
 	}
 
 	NET_DBG("Context based compression");
-	IPHC[1] |= NET_6LO_IPHC_CID_1;
-	IPHC[2] = 0;
+	iphc[1] |= NET_6LO_IPHC_CID_1;
+	iphc[2] = 0;
 
 	if (*src) {
 		NET_DBG("Src addr context cid %d", (*src)->cid);
-		IPHC[2] = (*src)->cid << 4;
+		iphc[2] = (*src)->cid << 4;
 	}
 
 	if (*dst) {
 		NET_DBG("Dst addr context cid %d", (*dst)->cid);
-		IPHC[2] |= (*dst)->cid;
+		iphc[2] |= (*dst)->cid;
 	}
 
 	return true;
@@ -683,6 +712,7 @@ static inline bool compress_IPHC_header(struct net_pkt *pkt,
 	struct net_6lo_context *dst = NULL;
 #endif
 	struct net_ipv6_hdr *ipv6 = NET_IPV6_HDR(pkt);
+	u8_t iphc[NET_6LO_IPHC_MAX_LEN];
 	u8_t offset = 0;
 	struct net_udp_hdr *udp;
 	struct net_buf *frag;
@@ -701,46 +731,42 @@ static inline bool compress_IPHC_header(struct net_pkt *pkt,
 		return false;
 	}
 
-	frag = net_pkt_get_frag(pkt, K_FOREVER);
-
-	IPHC[offset++] = NET_6LO_DISPATCH_IPHC;
-	IPHC[offset++] = 0;
+	iphc[offset++] = NET_6LO_DISPATCH_IPHC;
+	iphc[offset++] = 0;
 
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	if (is_src_and_dst_addr_ctx_based(ipv6, pkt, frag, &src, &dst)) {
+	if (is_src_and_dst_addr_ctx_based(ipv6, pkt, iphc, &src, &dst)) {
 		offset++;
 	}
 #endif
 
 	/* Compress Traffic class and Flow lablel */
-	offset = compress_tfl(ipv6, frag, offset);
+	offset = compress_tfl(ipv6, iphc, offset);
 
 	/* Next Header */
-	offset = compress_nh(ipv6, frag, offset);
+	offset = compress_nh(ipv6, iphc, offset);
 
 	/* Hop limit */
-	offset = compress_hoplimit(ipv6, frag, offset);
+	offset = compress_hoplimit(ipv6, iphc, offset);
 
 	/* Source Address Compression */
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = compress_sa_ctx(ipv6, pkt, frag, offset, src);
+	offset = compress_sa_ctx(ipv6, pkt, iphc, offset, src);
 #else
-	offset = compress_sa(ipv6, pkt, frag, offset);
+	offset = compress_sa(ipv6, pkt, iphc, offset);
 #endif
 	if (!offset) {
-		net_pkt_frag_unref(frag);
 		return false;
 	}
 
 	/* Destination Address Compression */
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = compress_da_ctx(ipv6, pkt, frag, offset, dst);
+	offset = compress_da_ctx(ipv6, pkt, iphc, offset, dst);
 #else
-	offset = compress_da(ipv6, pkt, frag, offset);
+	offset = compress_da(ipv6, pkt, iphc, offset);
 #endif
 
 	if (!offset) {
-		net_pkt_frag_unref(frag);
 		return false;
 	}
 
@@ -753,27 +779,35 @@ static inline bool compress_IPHC_header(struct net_pkt *pkt,
 
 	/* UDP header compression */
 	udp = NET_UDP_HDR(pkt);
-	IPHC[offset] = NET_6LO_NHC_UDP_BARE;
-	offset = compress_nh_udp(udp, frag, offset);
+	iphc[offset] = NET_6LO_NHC_UDP_BARE;
+	offset = compress_nh_udp(udp, iphc, offset);
 
 	compressed += NET_UDPH_LEN;
 
 end:
-	net_buf_add(frag, offset);
-
-	/* Copy the rest of the data to compressed fragment */
-	memcpy(&IPHC[offset], pkt->frags->data + compressed,
-	       pkt->frags->len - compressed);
-	net_buf_add(frag, pkt->frags->len - compressed);
+	if (offset <= compressed) {
+		/* Write the compressed header over the end of the original
+		 * one and skip what is left of it, so that the payload
+		 * stays where it is.
+		 */
+		memcpy(pkt->frags->data + compressed - offset, iphc, offset);
+		net_buf_pull(pkt->frags, compressed - offset);
+	} else {
+		/* Only possible with all the fields carried in-line and
+		 * no UDP header, the compressed header gets a fragment
+		 * of its own then.
+		 */
+		frag = net_pkt_get_frag_len(pkt, offset, K_FOREVER);
 
-	/* Delete uncompressed(original) header fragment */
-	net_pkt_frag_del(pkt, NULL, pkt->frags);
+		memcpy(net_buf_add(frag, offset), iphc, offset);
 
-	/* Insert compressed header fragment */
-	net_pkt_frag_insert(pkt, frag);
+		net_buf_pull(pkt->frags, compressed);
+		if (!pkt->frags->len) {
+			net_pkt_frag_del(pkt, NULL, pkt->frags);
+		}
 
-	/* Compact the fragments, so that gaps will be filled */
-	net_pkt_compact(pkt);
+		net_pkt_frag_insert(pkt, frag);
+	}
 
 	if (fragment) {
 		return fragment(pkt, compressed - offset);
@@ -839,19 +873,12 @@ static inline u8_t uncompress_hoplimit(struct net_pkt *pkt,
 					  struct net_ipv6_hdr *ipv6,
 					  u8_t offset)
 {
-	switch (CIPHC[0] & NET_6LO_IPHC_HLIM255) {
-	case NET_6LO_IPHC_HLIM:
+	u8_t hlim = CIPHC[0] & NET_6LO_IPHC_HLIM255;
+
+	if (hlim == NET_6LO_IPHC_HLIM) {
 		ipv6->hop_limit = CIPHC[offset++];
-		break;
-	case NET_6LO_IPHC_HLIM1:
-		ipv6->hop_limit = 1;
-		break;
-	case NET_6LO_IPHC_HLIM64:
-		ipv6->hop_limit = 64;
-		break;
-	case NET_6LO_IPHC_HLIM255:
-		ipv6->hop_limit = 255;
-		break;
+	} else {
+		ipv6->hop_limit = hop_limits[hlim];
 	}
 
 	return offset;
@@ -1209,10 +1236,12 @@ static inline void uncompress_cid(struct net_pkt *pkt,
 
 static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 {
+	u8_t hdr[NET_IPV6UDPH_LEN];
+	struct net_ipv6_hdr *ipv6 = (struct net_ipv6_hdr *)hdr;
 	struct net_udp_hdr *udp = NULL;
+	u8_t hdr_len = NET_IPV6H_LEN;
 	u8_t offset = 2;
 	u8_t chksum = 0;
-	struct net_ipv6_hdr *ipv6;
 	struct net_buf *frag;
 	u16_t len;
 #if defined(CONFIG_NET_6LO_CONTEXT)
@@ -1230,13 +1259,6 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 #endif
 	}
 
-	frag = net_pkt_get_frag(pkt, NET_6LO_RX_PKT_TIMEOUT);
-	if (!frag) {
-		return false;
-	}
-
-	ipv6 = (struct net_ipv6_hdr *)(frag->data);
-
 	/* Version is always 6 */
 	ipv6->vtc = 0x60;
 	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
@@ -1261,7 +1283,7 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 	if (CIPHC[1] & NET_6LO_IPHC_SAC_1) {
 		if (!src) {
 			NET_ERR("SAC is set but src context doesn't exists");
-			goto fail;
+			return false;
 		}
 
 		offset = uncompress_sa_ctx(pkt, ipv6, offset, src);
@@ -1280,12 +1302,12 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 			 * Addresses. DAM_01, DAM_10 and DAM_11 are reserved.
 			 */
 			NET_ERR("DAC_1 and M_1 is not supported");
-			goto fail;
+			return false;
 		}
 
 		if (!dst) {
 			NET_ERR("DAC is set but dst context doesn't exists");
-			goto fail;
+			return false;
 		}
 
 		offset = uncompress_da_ctx(pkt, ipv6, offset, dst);
@@ -1296,8 +1318,6 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 	offset = uncompress_da(pkt, ipv6, offset);
 #endif
 
-	net_buf_add(frag, NET_IPV6H_LEN);
-
 	if (!(CIPHC[0] & NET_6LO_IPHC_NH_1)) {
 		NET_DBG("No following compressed header");
 		goto end;
@@ -1308,13 +1328,13 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 		 * Supports only UDP header (next header) compression.
 		 */
 		NET_ERR("Unsupported next header");
-		goto fail;
+		return false;
 	}
 
 	/* Uncompress UDP header */
 	ipv6->nexthdr = IPPROTO_UDP;
 
-	udp = (struct net_udp_hdr *)(frag->data + NET_IPV6H_LEN);
+	udp = (struct net_udp_hdr *)(hdr + NET_IPV6H_LEN);
 	chksum = CIPHC[offset] & NET_6LO_NHC_UDP_CHKSUM_1;
 	offset = uncompress_nh_udp(pkt, udp, offset);
 
@@ -1323,24 +1343,53 @@ static inline bool uncompress_IPHC_header(struct net_pkt *pkt)
 		offset += 2;
 	}
 
-	net_buf_add(frag, NET_UDPH_LEN);
+	hdr_len += NET_UDPH_LEN;
 
 end:
-	/* Move the data to beginning, no need for headers now */
-	NET_DBG("Removing %u bytes of compressed hdr", offset);
-	memmove(pkt->frags->data, pkt->frags->data + offset,
-		pkt->frags->len - offset);
-	pkt->frags->len -= offset;
-
-	/* Copying ll part, if any */
-	if (net_pkt_ll_reserve(pkt)) {
-		memcpy(frag->data - net_pkt_ll_reserve(pkt),
-		       net_pkt_ll(pkt), net_pkt_ll_reserve(pkt));
+	NET_DBG("Replacing %u bytes of compressed hdr with %u bytes",
+		offset, hdr_len);
+
+	frag = pkt->frags;
+
+	if (net_buf_headroom(frag) + offset >=
+	    net_pkt_ll_reserve(pkt) + hdr_len) {
+		/* There is room in front of the compressed header, write
+		 * the uncompressed one in its place and only move the link
+		 * layer header.
+		 */
+		relocate_ll_hdr(pkt, frag->data + offset - hdr_len -
+				net_pkt_ll_reserve(pkt));
+
+		net_buf_pull(frag, offset);
+		memcpy(net_buf_push(frag, hdr_len), hdr, hdr_len);
+	} else {
+		/* The rest of the first fragment is copied after the
+		 * uncompressed header, so that the headers that follow are
+		 * still found from the first fragment.
+		 */
+		frag = net_pkt_get_frag_len(pkt, hdr_len + frag->len - offset,
+					    NET_6LO_RX_PKT_TIMEOUT);
+		if (!frag) {
+			return false;
+		}
+
+		relocate_ll_hdr(pkt, frag->data - net_pkt_ll_reserve(pkt));
+
+		memcpy(net_buf_add(frag, hdr_len), hdr, hdr_len);
+		net_buf_pull(pkt->frags, offset);
+
+		len = min(pkt->frags->len, net_buf_tailroom(frag));
+		memcpy(net_buf_add(frag, len), pkt->frags->data, len);
+		net_buf_pull(pkt->frags, len);
+
+		if (!pkt->frags->len) {
+			net_pkt_frag_del(pkt, NULL, pkt->frags);
+		}
+
+		net_pkt_frag_insert(pkt, frag);
 	}
 
-	/* Insert the fragment (this one holds uncompressed headers) */
-	net_pkt_frag_insert(pkt, frag);
-	net_pkt_compact(pkt);
+	ipv6 = NET_IPV6_HDR(pkt);
 
 	/* Set IPv6 header and UDP (if next header is) length */
 	len = net_pkt_get_len(pkt) - NET_IPV6H_LEN;
@@ -1348,6 +1397,7 @@ end:
 	ipv6->len[1] = (u8_t)len;
 
 	if (ipv6->nexthdr == IPPROTO_UDP && udp) {
+		udp = NET_UDP_HDR(pkt);
 		udp->len = htons(len);
 
 		if (chksum) {
@@ -1356,10 +1406,6 @@ end:
 	}
 
 	return true;
-
-fail:
-	net_pkt_frag_unref(frag);
-	return false;
 }
 
 /* Adds IPv6 dispatch as first byte and adjust fragments  */
@@ -1368,15 +1414,13 @@ static inline bool compress_ipv6_header(struct net_pkt *pkt,
 {
 	struct net_buf *frag;
 
-	frag = net_pkt_get_frag(pkt, K_FOREVER);
-
-	frag->data[0] = NET_6LO_DISPATCH_IPV6;
-	net_buf_add(frag, 1);
-
-	net_pkt_frag_insert(pkt, frag);
-
-	/* Compact the fragments, so that gaps will be filled */
-	net_pkt_compact(pkt);
+	if (net_buf_headroom(pkt->frags) > net_pkt_ll_reserve(pkt)) {
+		*(u8_t *)net_buf_push(pkt->frags, 1) = NET_6LO_DISPATCH_IPV6;
+	} else {
+		frag = net_pkt_get_frag_len(pkt, 1, K_FOREVER);
+		net_buf_add_u8(frag, NET_6LO_DISPATCH_IPV6);
+		net_pkt_frag_insert(pkt, frag);
+	}
 
 	if (fragment) {
 		return fragment(pkt, -1);
@@ -1387,11 +1431,16 @@ static inline bool compress_ipv6_header(struct net_pkt *pkt,
 
 static inline bool uncompress_ipv6_header(struct net_pkt *pkt)
 {
-	struct net_buf *frag = pkt->frags;
+	/* Pull off IPv6 dispatch header, the link layer header is moved
+	 * over it instead of moving the data.
+	 */
+	relocate_ll_hdr(pkt, net_pkt_ll(pkt) + 1);
+	net_buf_pull(pkt->frags, 1);
 
-	/* Pull off IPv6 dispatch header and adjust data and length */
-	memmove(frag->data, frag->data + 1, frag->len - 1);
-	frag->len -= 1;
+	/* The dispatch had a fragment of its own */
+	if (!pkt->frags->len) {
+		net_pkt_frag_del(pkt, NULL, pkt->frags);
+	}
 
 	return true;
 }
@@ -25,8 +25,9 @@ typedef bool (*fragment_handler_t)(struct net_pkt *, int);
  *  @brief Compress IPv6 packet as per RFC 6282
  *
  *  @details After this IPv6 packet and next header(if UDP), headers
- *  are compressed as per RFC 6282. After header compression data
- *  will be adjusted according to remaining space in fragments.
+ *  are compressed as per RFC 6282. The compressed headers are written
+ *  over the end of the original ones in the first fragment, so the
+ *  payload is not moved and the fragments are not compacted.
  *
  *  @param Pointer to network packet
  *  @param iphc true for IPHC compression, false for IPv6 dispatch header
@@ -41,8 +42,10 @@ bool net_6lo_compress(struct net_pkt *pkt, bool iphc,
  *  @brief Uncompress IPv6 packet as per RFC 6282
  *
  *  @details After this IPv6 packet and next header(if UDP), headers
- *  are uncompressed as per RFC 6282. After header uncompression data
- *  will be adjusted according to remaining space in fragments.
+ *  are uncompressed as per RFC 6282. If the first fragment has enough
+ *  headroom the headers are uncompressed in place, otherwise they are
+ *  put in a new first fragment together with the rest of the data of
+ *  the old one. The link layer header is moved along in both cases.
  *
  *  @param Pointer to network packet
  *
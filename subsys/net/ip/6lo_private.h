@@ -84,9 +84,13 @@
 #define NET_6LO_NHC_UDP_8_BIT_PORT	0xF0
 #define NET_6LO_NHC_UDP_4_BIT_PORT	0xF0B
 
-#define IPHC ((frag)->data)
 #define CIPHC ((pkt->frags)->data)
 
+/* Longest IPHC header: dispatch and CID (3), TF (4), HLIM (1), src and
+ * dst addresses (32) and UDP NHC with ports and checksum (7).
+ */
+#define NET_6LO_IPHC_MAX_LEN		47
+
 #define NET_6LO_FRAG1_HDR_LEN		4
 #define NET_6LO_FRAGN_HDR_LEN		5
 
@@ -300,6 +300,8 @@ static inline enum net_verdict cache_check(enum net_ip_protocol proto,
 				net_pkt_family(pkt), *pos,
 				conn_cache[*pos].value);
 
+			net_stats_update_latency_rx(pkt, proto);
+
 			return conn->cb(conn, pkt, conn->user_data);
 		}
 	} else if (*cache_value > 0) {
@@ -850,8 +852,12 @@ enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_pkt *pkt)
 		/* If packet has a listener configured, then check also the
 		 * protocol checksum if that checking is enabled.
 		 * If the checksum calculation fails, then discard the message.
+		 * Nothing needs to be done if the hardware verified it already.
 		 */
-		if (IS_ENABLED(CONFIG_NET_UDP_CHECKSUM) &&
+		bool verify = !net_if_is_rx_chksum_offloaded(
+							net_pkt_iface(pkt));
+
+		if (verify && IS_ENABLED(CONFIG_NET_UDP_CHECKSUM) &&
 		    proto == IPPROTO_UDP) {
 			u16_t chksum_calc;
 
@@ -865,7 +871,7 @@ enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_pkt *pkt)
 
 			NET_UDP_HDR(pkt)->chksum = chksum;
 
-		} else if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
+		} else if (verify && IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 			   proto == IPPROTO_TCP) {
 			u16_t chksum_calc;
 
@@ -899,6 +905,8 @@ enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_pkt *pkt)
 			conns[best_match].rank);
 #endif /* CONFIG_NET_CONN_CACHE */
 
+		net_stats_update_latency_rx(pkt, proto);
+
 		if (conns[best_match].cb(&conns[best_match], pkt,
 			     conns[best_match].user_data) == NET_DROP) {
 			goto drop;
@@ -663,33 +663,26 @@ static void dhcpv4_timeout(struct k_work *work)
  * as per RFC 2132.
  */
 static enum net_verdict parse_options(struct net_if *iface,
-				      struct net_buf *frag,
-				      u16_t offset,
+				      struct net_pkt_cursor *cursor,
 				      enum dhcpv4_msg_type *msg_type)
 {
 	u8_t cookie[4];
 	u8_t length;
 	u8_t type;
-	u16_t pos;
-
-	frag = net_frag_read(frag, offset, &pos, sizeof(magic_cookie),
-			     (u8_t *)cookie);
-	if (!frag || memcmp(magic_cookie, cookie, sizeof(magic_cookie))) {
 
+	if (net_pkt_cursor_read(cursor, cookie, sizeof(magic_cookie)) ||
+	    memcmp(magic_cookie, cookie, sizeof(magic_cookie))) {
 		NET_DBG("Incorrect magic cookie");
 		return NET_DROP;
 	}
 
-	while (frag) {
-		frag = net_frag_read_u8(frag, pos, &pos, &type);
-
+	while (!net_pkt_cursor_read_u8(cursor, &type)) {
 		if (type == DHCPV4_OPTIONS_END) {
 			NET_DBG("options_end");
 			return NET_OK;
 		}
 
-		frag = net_frag_read_u8(frag, pos, &pos, &length);
-		if (!frag) {
+		if (net_pkt_cursor_read_u8(cursor, &length)) {
 			NET_ERR("option parsing, bad length");
 			return NET_DROP;
 		}
@@ -703,12 +696,12 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read(frag, pos, &pos, length,
-					     netmask.s4_addr);
-			if (!frag && pos) {
+			if (net_pkt_cursor_read(cursor, netmask.s4_addr,
+						length)) {
 				NET_ERR("options_subnet_mask, short packet");
 				return NET_DROP;
 			}
+
 			net_if_ipv4_set_netmask(iface, &netmask);
 			NET_DBG("options_subnet_mask %s",
 				net_sprint_ipv4_addr(&netmask));
@@ -728,9 +721,8 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read(frag, pos, &pos, 4, router.s4_addr);
-			frag = net_frag_skip(frag, pos, &pos, length - 4);
-			if (!frag && pos) {
+			if (net_pkt_cursor_read(cursor, router.s4_addr, 4) ||
+			    net_pkt_cursor_skip(cursor, length - 4)) {
 				NET_ERR("options_router, short packet");
 				return NET_DROP;
 			}
@@ -746,14 +738,14 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read_be32(frag, pos, &pos,
-						  &iface->dhcpv4.lease_time);
-			NET_DBG("options_lease_time: %u",
-				iface->dhcpv4.lease_time);
-			if (!iface->dhcpv4.lease_time) {
+			if (net_pkt_cursor_read_be32(cursor,
+					&iface->dhcpv4.lease_time) ||
+			    !iface->dhcpv4.lease_time) {
 				return NET_DROP;
 			}
 
+			NET_DBG("options_lease_time: %u",
+				iface->dhcpv4.lease_time);
 			break;
 		case DHCPV4_OPTIONS_RENEWAL:
 			if (length != 4) {
@@ -761,14 +753,14 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read_be32(frag, pos, &pos,
-						  &iface->dhcpv4.renewal_time);
-			NET_DBG("options_renewal: %u",
-				iface->dhcpv4.renewal_time);
-			if (!iface->dhcpv4.renewal_time) {
+			if (net_pkt_cursor_read_be32(cursor,
+					&iface->dhcpv4.renewal_time) ||
+			    !iface->dhcpv4.renewal_time) {
 				return NET_DROP;
 			}
 
+			NET_DBG("options_renewal: %u",
+				iface->dhcpv4.renewal_time);
 			break;
 		case DHCPV4_OPTIONS_REBINDING:
 			if (length != 4) {
@@ -776,14 +768,14 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read_be32(frag, pos, &pos,
-					&iface->dhcpv4.rebinding_time);
-			NET_DBG("options_rebinding: %u",
-				iface->dhcpv4.rebinding_time);
-			if (!iface->dhcpv4.rebinding_time) {
+			if (net_pkt_cursor_read_be32(cursor,
+					&iface->dhcpv4.rebinding_time) ||
+			    !iface->dhcpv4.rebinding_time) {
 				return NET_DROP;
 			}
 
+			NET_DBG("options_rebinding: %u",
+				iface->dhcpv4.rebinding_time);
 			break;
 		case DHCPV4_OPTIONS_SERVER_ID:
 			if (length != 4) {
@@ -791,8 +783,12 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read(frag, pos, &pos, length,
-					     iface->dhcpv4.server_id.s4_addr);
+			if (net_pkt_cursor_read(cursor,
+					iface->dhcpv4.server_id.s4_addr,
+					length)) {
+				return NET_DROP;
+			}
+
 			NET_DBG("options_server_id: %s",
 				net_sprint_ipv4_addr(&iface->dhcpv4.server_id));
 			break;
@@ -804,18 +800,21 @@ static enum net_verdict parse_options(struct net_if *iface,
 				return NET_DROP;
 			}
 
-			frag = net_frag_read_u8(frag, pos, &pos, &v);
+			if (net_pkt_cursor_read_u8(cursor, &v)) {
+				return NET_DROP;
+			}
+
 			*msg_type = v;
 			break;
 		}
 		default:
 			NET_DBG("option unknown: %d", type);
-			frag = net_frag_skip(frag, pos, &pos, length);
-			break;
-		}
 
-		if (!frag && pos) {
-			return NET_DROP;
+			if (net_pkt_cursor_skip(cursor, length)) {
+				return NET_DROP;
+			}
+
+			break;
 		}
 	}
 
@@ -921,12 +920,12 @@ static enum net_verdict net_dhcpv4_input(struct net_conn *conn,
 					 struct net_pkt *pkt,
 					 void *user_data)
 {
+	struct net_pkt_cursor cursor;
 	struct dhcp_msg *msg;
 	struct net_buf *frag;
 	struct net_if *iface;
 	enum dhcpv4_msg_type msg_type = 0;
 	u8_t min;
-	u16_t pos;
 
 	if (!conn) {
 		NET_DBG("Invalid connection");
@@ -983,13 +982,14 @@ static enum net_verdict net_dhcpv4_input(struct net_conn *conn,
 	       sizeof(msg->yiaddr));
 
 	/* SNAME, FILE are not used at the moment, skip it */
-	frag = net_frag_skip(frag, min, &pos, SIZE_OF_SNAME + SIZE_OF_FILE);
-	if (!frag && pos) {
+	net_pkt_cursor_init(&cursor, pkt);
+	if (net_pkt_cursor_seek(&cursor, pkt,
+				min + SIZE_OF_SNAME + SIZE_OF_FILE)) {
 		NET_DBG("short packet while skipping sname");
 		goto drop;
 	}
 
-	if (parse_options(iface, frag, pos, &msg_type) == NET_DROP) {
+	if (parse_options(iface, &cursor, &msg_type) == NET_DROP) {
 		NET_DBG("Invalid Options");
 		goto drop;
 	}
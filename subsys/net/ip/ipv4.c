@@ -92,6 +92,10 @@ int net_ipv4_finalize_raw(struct net_pkt *pkt, u8_t next_header)
 	NET_IPV4_HDR(pkt)->len[0] = total_len / 256;
 	NET_IPV4_HDR(pkt)->len[1] = total_len - NET_IPV4_HDR(pkt)->len[0] * 256;
 
+	if (net_if_is_tx_chksum_offloaded(net_pkt_iface(pkt))) {
+		return 0;
+	}
+
 	NET_IPV4_HDR(pkt)->chksum = 0;
 	NET_IPV4_HDR(pkt)->chksum = ~net_calc_chksum_ipv4(pkt);
 
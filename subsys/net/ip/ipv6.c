@@ -111,6 +111,64 @@ static inline struct net_nbr *get_nbr(int idx)
 	return &net_neighbor_pool[idx].nbr;
 }
 
+#define NBR_HASH_SIZE CONFIG_NET_IPV6_NBR_HASH_SIZE
+#define NBR_HASH_END 0xff
+
+/* Neighbors are chained from here by the hash of their IPv6 address so
+ * that the lookup done for every sent packet does not need to go through
+ * the whole neighbor table.
+ */
+static u8_t nbr_hash[NBR_HASH_SIZE] = {
+	[0 ... (NBR_HASH_SIZE - 1)] = NBR_HASH_END
+};
+
+/* Incremented whenever a neighbor is used, to find the least recently
+ * used one.
+ */
+static u32_t nbr_use_count;
+
+static inline u8_t nbr_index(struct net_nbr *nbr)
+{
+	return ((u8_t *)nbr - (u8_t *)net_neighbor_pool) /
+		sizeof(net_neighbor_pool[0]);
+}
+
+static inline u8_t nbr_hash_key(const struct in6_addr *addr)
+{
+	u32_t hash = 0;
+	int i;
+
+	/* Neighbors on the same link differ by the interface identifier */
+	for (i = 8; i < sizeof(struct in6_addr); i++) {
+		hash = hash * 33 + addr->s6_addr[i];
+	}
+
+	return hash % NBR_HASH_SIZE;
+}
+
+static void nbr_hash_add(struct net_nbr *nbr)
+{
+	u8_t key = nbr_hash_key(&net_ipv6_nbr_data(nbr)->addr);
+
+	net_ipv6_nbr_data(nbr)->hash_next = nbr_hash[key];
+	nbr_hash[key] = nbr_index(nbr);
+}
+
+static void nbr_hash_del(struct net_nbr *nbr)
+{
+	u8_t *prev = &nbr_hash[nbr_hash_key(&net_ipv6_nbr_data(nbr)->addr)];
+	u8_t idx = nbr_index(nbr);
+
+	while (*prev != NBR_HASH_END) {
+		if (*prev == idx) {
+			*prev = net_ipv6_nbr_data(nbr)->hash_next;
+			return;
+		}
+
+		prev = &net_ipv6_nbr_data(get_nbr(*prev))->hash_next;
+	}
+}
+
 static inline struct net_nbr *get_nbr_from_data(struct net_ipv6_nbr_data *data)
 {
 	int i;
@@ -176,21 +234,25 @@ static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 				  struct net_if *iface,
 				  struct in6_addr *addr)
 {
-	int i;
+	u8_t idx = nbr_hash[nbr_hash_key(addr)];
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	ARG_UNUSED(table);
 
-		if (!nbr->ref) {
-			continue;
-		}
+	while (idx != NBR_HASH_END) {
+		struct net_nbr *nbr = get_nbr(idx);
 
 		if (nbr->iface == iface &&
 		    net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, addr)) {
+			net_ipv6_nbr_data(nbr)->last_used = ++nbr_use_count;
+			net_stats_update_ipv6_nd_nbr_lookup(true);
 			return nbr;
 		}
+
+		idx = net_ipv6_nbr_data(nbr)->hash_next;
 	}
 
+	net_stats_update_ipv6_nd_nbr_lookup(false);
+
 	return NULL;
 }
 
@@ -291,6 +353,9 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 	ipv6_nbr_set_state(nbr, state);
 	net_ipv6_nbr_data(nbr)->is_router = is_router;
 	net_ipv6_nbr_data(nbr)->pending = NULL;
+	net_ipv6_nbr_data(nbr)->last_used = ++nbr_use_count;
+
+	nbr_hash_add(nbr);
 
 #if defined(CONFIG_NET_IPV6_ND)
 	k_delayed_work_init(&net_ipv6_nbr_data(nbr)->reachable,
@@ -300,17 +365,85 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 			    ns_reply_timeout);
 }
 
+/* Neighbors whose reachability is already in doubt go first */
+static inline int nbr_evict_rank(struct net_nbr *nbr)
+{
+	int rank;
+
+	switch (net_ipv6_nbr_data(nbr)->state) {
+	case NET_IPV6_NBR_STATE_STALE:
+		rank = 0;
+		break;
+	case NET_IPV6_NBR_STATE_DELAY:
+	case NET_IPV6_NBR_STATE_PROBE:
+		rank = 2;
+		break;
+	default:
+		rank = 4;
+		break;
+	}
+
+	return rank + net_ipv6_nbr_data(nbr)->is_router;
+}
+
+/* Free the least recently used neighbor that nobody else refers to
+ * so that a new neighbor can be added to a full table.
+ */
+static bool nbr_evict(void)
+{
+	struct net_nbr *victim = NULL;
+	u32_t now = nbr_use_count;
+	int i, rank, victim_rank = 0;
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		struct net_nbr *nbr = get_nbr(i);
+
+		/* Route nexthops and RPL parents hold a reference */
+		if (nbr->ref != 1) {
+			continue;
+		}
+
+		rank = nbr_evict_rank(nbr);
+
+		if (!victim || rank < victim_rank ||
+		    (rank == victim_rank &&
+		     now - net_ipv6_nbr_data(nbr)->last_used >
+		     now - net_ipv6_nbr_data(victim)->last_used)) {
+			victim = nbr;
+			victim_rank = rank;
+		}
+	}
+
+	if (!victim) {
+		return false;
+	}
+
+	NET_DBG("Evicting nbr %p state %s IPv6 %s", victim,
+		net_ipv6_nbr_state2str(net_ipv6_nbr_data(victim)->state),
+		net_sprint_ipv6_addr(&net_ipv6_nbr_data(victim)->addr));
+
+	net_stats_update_ipv6_nd_nbr_evict();
+
+	nbr_free(victim);
+
+	return true;
+}
+
 static struct net_nbr *nbr_new(struct net_if *iface,
 			       struct in6_addr *addr, bool is_router,
 			       enum net_ipv6_nbr_state state)
 {
 	struct net_nbr *nbr = net_nbr_get(&net_neighbor.table);
 
+	if (!nbr && nbr_evict()) {
+		nbr = net_nbr_get(&net_neighbor.table);
+	}
+
 	if (!nbr) {
 		return NULL;
 	}
 
-	nbr_init(nbr, iface, addr, true, state);
+	nbr_init(nbr, iface, addr, is_router, state);
 
 	NET_DBG("nbr %p iface %p state %d IPv6 %s",
 		nbr, iface, state, net_sprint_ipv6_addr(addr));
@@ -424,8 +557,8 @@ struct net_nbr *net_ipv6_nbr_add(struct net_if *iface,
 		if (memcmp(cached_lladdr->addr, lladdr->addr, lladdr->len)) {
 			dbg_update_neighbor_lladdr(lladdr, cached_lladdr, addr);
 
-			net_linkaddr_set(cached_lladdr, lladdr->addr,
-					 lladdr->len);
+			net_nbr_update_lladdr(nbr->idx, lladdr->addr,
+					      lladdr->len);
 
 			ipv6_nbr_set_state(nbr, NET_IPV6_NBR_STATE_STALE);
 		} else if (net_ipv6_nbr_data(nbr)->state ==
@@ -462,7 +595,10 @@ void net_neighbor_data_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Neighbor %p removed", nbr);
 
-	return;
+	nbr_hash_del(nbr);
+
+	/* Release the link layer address so that it can be reused */
+	net_nbr_unlink(nbr, NULL);
 }
 
 void net_neighbor_table_clear(struct net_nbr_table *table)
@@ -503,9 +639,9 @@ int net_ipv6_find_last_ext_hdr(struct net_pkt *pkt, u16_t *next_hdr_idx,
 			       u16_t *last_hdr_idx)
 {
 	struct net_ipv6_hdr *hdr = NET_IPV6_HDR(pkt);
-	struct net_buf *frag = pkt->frags;
+	struct net_pkt_cursor cursor;
 	int pos = 0;
-	u16_t offset, prev, tmp;
+	u16_t offset, prev;
 	u8_t next_hdr;
 	u8_t length;
 	u8_t next;
@@ -528,17 +664,16 @@ int net_ipv6_find_last_ext_hdr(struct net_pkt *pkt, u16_t *next_hdr_idx,
 
 	prev = pos;
 
-	while (frag) {
-		frag = net_frag_read_u8(frag, offset, &offset, &next_hdr);
-		if (!frag && offset == 0xffff) {
-			goto fail;
-		}
+	net_pkt_cursor_init(&cursor, pkt);
 
-		frag = net_frag_read_u8(frag, offset, &offset, &length);
-		if (!frag && offset == 0xffff) {
+	while (1) {
+		if (net_pkt_cursor_seek(&cursor, pkt, offset) ||
+		    net_pkt_cursor_read_u8(&cursor, &next_hdr) ||
+		    net_pkt_cursor_read_u8(&cursor, &length)) {
 			goto fail;
 		}
 
+		offset = cursor.offset;
 		length = length * 8 + 8;
 
 		/* TODO: Add here more IPv6 extension headers to check */
@@ -571,11 +706,10 @@ int net_ipv6_find_last_ext_hdr(struct net_pkt *pkt, u16_t *next_hdr_idx,
 			goto fail;
 		}
 
-		/* Get the next header value */
-		frag = net_frag_read_u8(frag, pos, &tmp, &next);
-		if (!frag && pos == 0xffff) {
-			goto fail;
-		}
+		/* The next header value is the first byte of the
+		 * extension header just processed.
+		 */
+		next = next_hdr;
 	}
 
 out:
@@ -682,6 +816,10 @@ int net_ipv6_finalize_raw(struct net_pkt *pkt, u8_t next_header)
 	NET_IPV6_HDR(pkt)->len[0] = total_len / 256;
 	NET_IPV6_HDR(pkt)->len[1] = total_len - NET_IPV6_HDR(pkt)->len[0] * 256;
 
+	if (net_if_is_tx_chksum_offloaded(net_pkt_iface(pkt))) {
+		return 0;
+	}
+
 #if defined(CONFIG_NET_UDP)
 	if (next_header == IPPROTO_UDP) {
 		NET_UDP_HDR(pkt)->chksum = 0;
@@ -1511,9 +1649,9 @@ static inline bool handle_na_neighbor(struct net_pkt *pkt,
 				cached_lladdr,
 				&NET_ICMPV6_NS_HDR(pkt)->tgt);
 
-			net_linkaddr_set(cached_lladdr,
-					 &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
-					 cached_lladdr->len);
+			net_nbr_update_lladdr(nbr->idx,
+					      &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
+					      cached_lladdr->len);
 		}
 
 		if (net_is_solicited(pkt)) {
@@ -1556,9 +1694,9 @@ static inline bool handle_na_neighbor(struct net_pkt *pkt,
 				cached_lladdr,
 				&NET_ICMPV6_NS_HDR(pkt)->tgt);
 
-			net_linkaddr_set(cached_lladdr,
-					 &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
-					 cached_lladdr->len);
+			net_nbr_update_lladdr(nbr->idx,
+					      &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
+					      cached_lladdr->len);
 		}
 
 		if (net_is_solicited(pkt)) {
@@ -1940,11 +2078,10 @@ int net_ipv6_start_rs(struct net_if *iface)
 	return net_ipv6_send_rs(iface);
 }
 
-static inline struct net_buf *handle_ra_neighbor(struct net_pkt *pkt,
-						 struct net_buf *frag,
-						 u8_t len,
-						 u16_t offset, u16_t *pos,
-						 struct net_nbr **nbr)
+static inline int handle_ra_neighbor(struct net_pkt *pkt,
+				     struct net_pkt_cursor *cursor,
+				     u8_t len,
+				     struct net_nbr **nbr)
 
 {
 	struct net_linkaddr lladdr;
@@ -1952,7 +2089,7 @@ static inline struct net_buf *handle_ra_neighbor(struct net_pkt *pkt,
 	u8_t padding;
 
 	if (!nbr) {
-		return NULL;
+		return -EINVAL;
 	}
 
 	llstorage.len = NET_LINK_ADDR_MAX_LENGTH;
@@ -1962,22 +2099,18 @@ static inline struct net_buf *handle_ra_neighbor(struct net_pkt *pkt,
 		lladdr.len = net_pkt_ll_src(pkt)->len;
 	}
 
-	frag = net_frag_read(frag, offset, pos, lladdr.len, lladdr.addr);
-	if (!frag && offset) {
-		return NULL;
+	if (net_pkt_cursor_read(cursor, lladdr.addr, lladdr.len)) {
+		return -ENODATA;
 	}
 
 	padding = len * 8 - 2 - lladdr.len;
-	if (padding) {
-		frag = net_frag_read(frag, *pos, pos, padding, NULL);
-		if (!frag && *pos) {
-			return NULL;
-		}
+	if (padding && net_pkt_cursor_skip(cursor, padding)) {
+		return -ENODATA;
 	}
 
 	*nbr = nbr_add(pkt, &lladdr, true, NET_IPV6_NBR_STATE_STALE);
 
-	return frag;
+	return 0;
 }
 
 static inline void handle_prefix_onlink(struct net_pkt *pkt,
@@ -2110,27 +2243,25 @@ static inline void handle_prefix_autonomous(struct net_pkt *pkt,
 	}
 }
 
-static inline struct net_buf *handle_ra_prefix(struct net_pkt *pkt,
-					       struct net_buf *frag,
-					       u8_t len,
-					       u16_t offset, u16_t *pos)
+static inline int handle_ra_prefix(struct net_pkt *pkt,
+				   struct net_pkt_cursor *cursor,
+				   u8_t len)
 {
 	struct net_icmpv6_nd_opt_prefix_info prefix_info;
 
 	prefix_info.type = NET_ICMPV6_ND_OPT_PREFIX_INFO;
 	prefix_info.len = len * 8 - 2;
 
-	frag = net_frag_read(frag, offset, pos, 1, &prefix_info.prefix_len);
-	frag = net_frag_read(frag, *pos, pos, 1, &prefix_info.flags);
-	frag = net_frag_read_be32(frag, *pos, pos, &prefix_info.valid_lifetime);
-	frag = net_frag_read_be32(frag, *pos, pos,
-				  &prefix_info.preferred_lifetime);
-	/* Skip reserved bytes */
-	frag = net_frag_skip(frag, *pos, pos, 4);
-	frag = net_frag_read(frag, *pos, pos, sizeof(struct in6_addr),
-			     prefix_info.prefix.s6_addr);
-	if (!frag && *pos) {
-		return NULL;
+	if (net_pkt_cursor_read_u8(cursor, &prefix_info.prefix_len) ||
+	    net_pkt_cursor_read_u8(cursor, &prefix_info.flags) ||
+	    net_pkt_cursor_read_be32(cursor, &prefix_info.valid_lifetime) ||
+	    net_pkt_cursor_read_be32(cursor,
+				     &prefix_info.preferred_lifetime) ||
+	    /* Skip reserved bytes */
+	    net_pkt_cursor_skip(cursor, 4) ||
+	    net_pkt_cursor_read(cursor, prefix_info.prefix.s6_addr,
+				sizeof(struct in6_addr))) {
+		return -ENODATA;
 	}
 
 	if (prefix_info.valid_lifetime >= prefix_info.preferred_lifetime &&
@@ -2147,22 +2278,23 @@ static inline struct net_buf *handle_ra_prefix(struct net_pkt *pkt,
 		}
 	}
 
-	return frag;
+	return 0;
 }
 
 #if defined(CONFIG_NET_6LO_CONTEXT)
 /* 6lowpan Context Option RFC 6775, 4.2 */
-static inline struct net_buf *handle_ra_6co(struct net_pkt *pkt,
-					    struct net_buf *frag,
-					    u8_t len,
-					    u16_t offset, u16_t *pos)
+static inline int handle_ra_6co(struct net_pkt *pkt,
+				struct net_pkt_cursor *cursor,
+				u8_t len)
 {
 	struct net_icmpv6_nd_opt_6co context;
 
 	context.type = NET_ICMPV6_ND_OPT_6CO;
 	context.len = len * 8 - 2;
 
-	frag = net_frag_read_u8(frag, offset, pos, &context.context_len);
+	if (net_pkt_cursor_read_u8(cursor, &context.context_len)) {
+		return -ENODATA;
+	}
 
 	/* RFC 6775, 4.2
 	 * Context Length: 8-bit unsigned integer.  The number of leading
@@ -2170,36 +2302,29 @@ static inline struct net_buf *handle_ra_6co(struct net_pkt *pkt,
 	 * from 0 to 128.  If it is more than 64, then the Length MUST be 3.
 	 */
 	if (context.context_len > 64 && len != 3) {
-		return NULL;
+		return -EINVAL;
 	}
 
 	if (context.context_len <= 64 && len != 2) {
-		return NULL;
+		return -EINVAL;
 	}
 
 	context.context_len = context.context_len / 8;
-	frag = net_frag_read_u8(frag, *pos, pos, &context.flag);
 
-	/* Skip reserved bytes */
-	frag = net_frag_skip(frag, *pos, pos, 2);
-	frag = net_frag_read_be16(frag, *pos, pos, &context.lifetime);
+	if (net_pkt_cursor_read_u8(cursor, &context.flag) ||
+	    /* Skip reserved bytes */
+	    net_pkt_cursor_skip(cursor, 2) ||
+	    net_pkt_cursor_read_be16(cursor, &context.lifetime)) {
+		return -ENODATA;
+	}
 
 	/* RFC 6775, 4.2 (Length field). Length can be 2 or 3 depending
-	 * on the length of context prefix field.
+	 * on the length of context prefix field. If length is 2 means
+	 * only 64 bits of context prefix is available, rest set to zeros.
 	 */
-	if (len == 3) {
-		frag = net_frag_read(frag, *pos, pos, sizeof(struct in6_addr),
-				     context.prefix.s6_addr);
-	} else if (len == 2) {
-		/* If length is 2 means only 64 bits of context prefix
-		 * is available, rest set to zeros.
-		 */
-		frag = net_frag_read(frag, *pos, pos, 8,
-				     context.prefix.s6_addr);
-	}
-
-	if (!frag && *pos) {
-		return NULL;
+	if (net_pkt_cursor_read(cursor, context.prefix.s6_addr,
+				len == 3 ? sizeof(struct in6_addr) : 8)) {
+		return -ENODATA;
 	}
 
 	/* context_len: The number of leading bits in the Context Prefix
@@ -2212,7 +2337,7 @@ static inline struct net_buf *handle_ra_6co(struct net_pkt *pkt,
 
 	net_6lo_set_context(net_pkt_iface(pkt), &context);
 
-	return frag;
+	return 0;
 }
 #endif
 
@@ -2221,7 +2346,7 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 	u16_t total_len = net_pkt_get_len(pkt);
 	struct net_nbr *nbr = NULL;
 	struct net_if_router *router;
-	struct net_buf *frag;
+	struct net_pkt_cursor cursor;
 	u16_t router_lifetime;
 	u32_t reachable_time;
 	u32_t retrans_timer;
@@ -2247,13 +2372,14 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 		goto drop;
 	}
 
-	frag = pkt->frags;
 	offset = sizeof(struct net_ipv6_hdr) + net_pkt_ipv6_ext_len(pkt) +
 		sizeof(struct net_icmp_hdr);
 
-	frag = net_frag_read_u8(frag, offset, &offset, &hop_limit);
-	frag = net_frag_skip(frag, offset, &offset, 1); /* flags */
-	if (!frag) {
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (net_pkt_cursor_seek(&cursor, pkt, offset) ||
+	    net_pkt_cursor_read_u8(&cursor, &hop_limit) ||
+	    net_pkt_cursor_skip(&cursor, 1)) { /* flags */
 		goto drop;
 	}
 
@@ -2263,10 +2389,9 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 			net_if_ipv6_get_hop_limit(net_pkt_iface(pkt)));
 	}
 
-	frag = net_frag_read_be16(frag, offset, &offset, &router_lifetime);
-	frag = net_frag_read_be32(frag, offset, &offset, &reachable_time);
-	frag = net_frag_read_be32(frag, offset, &offset, &retrans_timer);
-	if (!frag) {
+	if (net_pkt_cursor_read_be16(&cursor, &router_lifetime) ||
+	    net_pkt_cursor_read_be32(&cursor, &reachable_time) ||
+	    net_pkt_cursor_read_be32(&cursor, &retrans_timer)) {
 		goto drop;
 	}
 
@@ -2284,27 +2409,23 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 					      retrans_timer);
 	}
 
-	while (frag) {
-		frag = net_frag_read(frag, offset, &offset, 1, &type);
-		frag = net_frag_read(frag, offset, &offset, 1, &length);
-		if (!frag) {
+	while (cursor.frag) {
+		if (net_pkt_cursor_read_u8(&cursor, &type) ||
+		    net_pkt_cursor_read_u8(&cursor, &length)) {
 			goto drop;
 		}
 
 		switch (type) {
 		case NET_ICMPV6_ND_OPT_SLLAO:
-			frag = handle_ra_neighbor(pkt, frag, length, offset,
-						  &offset, &nbr);
-			if (!frag && offset) {
+			if (handle_ra_neighbor(pkt, &cursor, length, &nbr)) {
 				goto drop;
 			}
 
 			break;
 		case NET_ICMPV6_ND_OPT_MTU:
 			/* MTU has reserved 2 bytes, so skip it. */
-			frag = net_frag_skip(frag, offset, &offset, 2);
-			frag = net_frag_read_be32(frag, offset, &offset, &mtu);
-			if (!frag && offset) {
+			if (net_pkt_cursor_skip(&cursor, 2) ||
+			    net_pkt_cursor_read_be32(&cursor, &mtu)) {
 				goto drop;
 			}
 
@@ -2317,9 +2438,7 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 
 			break;
 		case NET_ICMPV6_ND_OPT_PREFIX_INFO:
-			frag = handle_ra_prefix(pkt, frag, length, offset,
-						&offset);
-			if (!frag && offset) {
+			if (handle_ra_prefix(pkt, &cursor, length)) {
 				goto drop;
 			}
 
@@ -2332,9 +2451,7 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 				goto drop;
 			}
 
-			frag = handle_ra_6co(pkt, frag, length, offset,
-					     &offset);
-			if (!frag && offset) {
+			if (handle_ra_6co(pkt, &cursor, length)) {
 				goto drop;
 			}
 
@@ -2357,9 +2474,7 @@ static enum net_verdict handle_ra_input(struct net_pkt *pkt)
 		default:
 			NET_DBG("Unknown ND option 0x%x", type);
 		skip:
-			frag = net_frag_skip(frag, offset, &offset,
-					     length * 8 - 2);
-			if (!frag && offset) {
+			if (net_pkt_cursor_skip(&cursor, length * 8 - 2)) {
 				goto drop;
 			}
 
@@ -2627,8 +2742,8 @@ static enum net_verdict handle_mld_query(struct net_pkt *pkt)
 	u16_t total_len = net_pkt_get_len(pkt);
 	struct in6_addr mcast;
 	u16_t max_rsp_code, num_src, pkt_len;
-	u16_t offset, pos;
-	struct net_buf *frag;
+	struct net_pkt_cursor cursor;
+	u16_t offset;
 
 	dbg_addr_recv("Multicast Listener Query",
 		      &NET_IPV6_HDR(pkt)->src,
@@ -2640,12 +2755,14 @@ static enum net_verdict handle_mld_query(struct net_pkt *pkt)
 	offset = net_pkt_icmp_data(pkt) - net_pkt_ip_data(pkt);
 	offset += sizeof(struct net_icmp_hdr);
 
-	frag = net_frag_read_be16(pkt->frags, offset, &pos, &max_rsp_code);
-	frag = net_frag_skip(frag, pos, &pos, 2); /* two reserved bytes */
-	frag = net_frag_read(frag, pos, &pos, sizeof(mcast), mcast.s6_addr);
-	frag = net_frag_skip(frag, pos, &pos, 2); /* skip S, QRV & QQIC */
-	frag = net_frag_read_be16(pkt->frags, pos, &pos, &num_src);
-	if (!frag && pos == 0xffff) {
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (net_pkt_cursor_seek(&cursor, pkt, offset) ||
+	    net_pkt_cursor_read_be16(&cursor, &max_rsp_code) ||
+	    net_pkt_cursor_skip(&cursor, 2) || /* two reserved bytes */
+	    net_pkt_cursor_read(&cursor, mcast.s6_addr, sizeof(mcast)) ||
+	    net_pkt_cursor_skip(&cursor, 2) || /* skip S, QRV & QQIC */
+	    net_pkt_cursor_read_be16(&cursor, &num_src)) {
 		goto drop;
 	}
 
@@ -2721,6 +2838,13 @@ static bool reassembly_init_done;
 static struct net_ipv6_reassembly
 reassembly[CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT];
 
+/* Fragments of all the pending reassemblies are tracked using these so
+ * that a packet split into many fragments can use the entries other
+ * reassemblies do not need.
+ */
+static struct net_ipv6_frag frag_entries[CONFIG_NET_IPV6_FRAGMENT_MAX_PKT];
+static sys_slist_t frag_free;
+
 static struct net_ipv6_reassembly *reassembly_get(u32_t id,
 						  struct in6_addr *src,
 						  struct in6_addr *dst)
@@ -2756,6 +2880,11 @@ static struct net_ipv6_reassembly *reassembly_get(u32_t id,
 	net_ipaddr_copy(&reassembly[avail].dst, dst);
 
 	reassembly[avail].id = id;
+	reassembly[avail].received = 0;
+	reassembly[avail].total_len = 0;
+	reassembly[avail].last_received = false;
+
+	sys_slist_init(&reassembly[avail].frags);
 
 	return &reassembly[avail];
 }
@@ -2764,11 +2893,13 @@ static bool reassembly_cancel(u32_t id,
 			      struct in6_addr *src,
 			      struct in6_addr *dst)
 {
-	int i, j;
+	int i;
 
 	NET_DBG("Cancel 0x%x", id);
 
 	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
+		struct net_ipv6_frag *entry;
+		sys_snode_t *node;
 		s32_t remaining;
 
 		if (reassembly[i].id != id ||
@@ -2787,17 +2918,16 @@ static bool reassembly_cancel(u32_t id,
 
 		reassembly[i].id = 0;
 
-		for (j = 0; j < NET_IPV6_FRAGMENTS_MAX_PKT; j++) {
-			if (!reassembly[i].pkt[j]) {
-				continue;
-			}
+		while ((node = sys_slist_get(&reassembly[i].frags))) {
+			entry = CONTAINER_OF(node, struct net_ipv6_frag, node);
 
-			NET_DBG("[%d] IPv6 reassembly pkt %p %zd bytes data",
-				j, reassembly[i].pkt[j],
-				net_pkt_get_len(reassembly[i].pkt[j]));
+			NET_DBG("IPv6 reassembly pkt %p offset %u %u bytes data",
+				entry->pkt, entry->offset, entry->len);
 
-			net_pkt_unref(reassembly[i].pkt[j]);
-			reassembly[i].pkt[j] = NULL;
+			net_pkt_unref(entry->pkt);
+			entry->pkt = NULL;
+
+			sys_slist_append(&frag_free, node);
 		}
 
 		return true;
@@ -2809,17 +2939,13 @@ static bool reassembly_cancel(u32_t id,
 static void reassembly_info(char *str, struct net_ipv6_reassembly *reass)
 {
 	char out[NET_IPV6_ADDR_LEN];
-	int i, len;
 
 	snprintk(out, sizeof(out), "%s", net_sprint_ipv6_addr(&reass->dst));
 
-	for (i = 0, len = 0; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		len += net_pkt_get_len(reass->pkt[i]);
-	}
-
-	NET_DBG("%s id 0x%x src %s dst %s remain %d ms len %d",
+	NET_DBG("%s id 0x%x src %s dst %s remain %d ms len %u/%u",
 		str, reass->id, net_sprint_ipv6_addr(&reass->src), out,
-		k_delayed_work_remaining_get(&reass->timer), len);
+		k_delayed_work_remaining_get(&reass->timer), reass->received,
+		reass->total_len);
 }
 
 static void reassembly_timeout(struct k_work *work)
@@ -2832,56 +2958,76 @@ static void reassembly_timeout(struct k_work *work)
 	reassembly_cancel(reass->id, &reass->src, &reass->dst);
 }
 
+/* Take the next fragment in offset order and return its entry to the
+ * shared pool.
+ */
+static struct net_pkt *reassembly_get_pkt(struct net_ipv6_reassembly *reass)
+{
+	struct net_ipv6_frag *entry;
+	struct net_pkt *pkt;
+	sys_snode_t *node;
+
+	node = sys_slist_get(&reass->frags);
+	if (!node) {
+		return NULL;
+	}
+
+	entry = CONTAINER_OF(node, struct net_ipv6_frag, node);
+	pkt = entry->pkt;
+	entry->pkt = NULL;
+
+	sys_slist_append(&frag_free, node);
+
+	return pkt;
+}
+
 static void reassemble_packet(struct net_ipv6_reassembly *reass)
 {
 	struct net_pkt *pkt;
 	struct net_buf *last;
 	u8_t next_hdr;
-	int i, len, ret;
+	int len, ret;
 	u16_t pos;
 
 	k_delayed_work_cancel(&reass->timer);
 
-	NET_ASSERT(reass->pkt[0]);
+	pkt = reassembly_get_pkt(reass);
+
+	NET_ASSERT(pkt);
 
-	last = net_buf_frag_last(reass->pkt[0]->frags);
+	last = net_buf_frag_last(pkt->frags);
 
-	/* We start from 2nd packet which is then appended to
-	 * the first one.
+	/* The rest of the fragments are appended to the first one in
+	 * the order of their offset.
 	 */
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
+	while (!sys_slist_is_empty(&reass->frags)) {
+		struct net_pkt *frag_pkt = reassembly_get_pkt(reass);
 		int removed_len;
 
-		pkt = reass->pkt[i];
-
 		/* Get rid of IPv6 and fragment header which are at
 		 * the beginning of the fragment.
 		 */
-		removed_len = net_pkt_ipv6_fragment_start(pkt) +
+		removed_len = net_pkt_ipv6_fragment_start(frag_pkt) +
 			sizeof(struct net_ipv6_frag_hdr) -
-			pkt->frags->data;
+			frag_pkt->frags->data;
 
 		NET_DBG("Removing %d bytes from start of pkt %p",
-			removed_len, pkt->frags);
+			removed_len, frag_pkt->frags);
 
 		NET_ASSERT(removed_len >= (sizeof(struct net_ipv6_hdr) +
 					   sizeof(struct net_ipv6_frag_hdr)));
 
-		net_buf_pull(pkt->frags, removed_len);
+		net_buf_pull(frag_pkt->frags, removed_len);
 
 		/* Attach the data to previous pkt */
-		last->frags = pkt->frags;
-		last = net_buf_frag_last(pkt->frags);
+		last->frags = frag_pkt->frags;
+		last = net_buf_frag_last(frag_pkt->frags);
 
-		pkt->frags = NULL;
-		reass->pkt[i] = NULL;
+		frag_pkt->frags = NULL;
 
-		net_pkt_unref(pkt);
+		net_pkt_unref(frag_pkt);
 	}
 
-	pkt = reass->pkt[0];
-	reass->pkt[0] = NULL;
-
 	/* Next we need to strip away the fragment header from the first packet
 	 * and set the various pointers and values in packet.
 	 */
@@ -2951,81 +3097,19 @@ void net_ipv6_frag_foreach(net_ipv6_frag_cb_t cb, void *user_data)
 	}
 }
 
-/* Verify that we have all the fragments received and in correct order.
- */
-static bool fragment_verify(struct net_ipv6_reassembly *reass)
-{
-	u16_t offset;
-	int i, prev_len;
-
-	prev_len = net_pkt_get_len(reass->pkt[0]);
-	offset = net_pkt_ipv6_fragment_offset(reass->pkt[0]);
-
-	NET_DBG("pkt %p offset %u", reass->pkt[0], offset);
-
-	if (offset != 0) {
-		return false;
-	}
-
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		offset = net_pkt_ipv6_fragment_offset(reass->pkt[i]);
-
-		NET_DBG("pkt %p offset %u prev_len %d", reass->pkt[i],
-			offset, prev_len);
-
-		if (prev_len < offset) {
-			/* Something wrong with the offset value */
-			return false;
-		}
-
-		prev_len = net_pkt_get_len(reass->pkt[i]);
-	}
-
-	return true;
-}
-
-static int shift_packets(struct net_ipv6_reassembly *reass, int pos)
-{
-	int i;
-
-	for (i = pos + 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Moving [%d] %p (offset 0x%x) to [%d]",
-				pos, reass->pkt[pos],
-				net_pkt_ipv6_fragment_offset(reass->pkt[pos]),
-				i);
-
-			/* Do we have enough space in packet array to make
-			 * the move?
-			 */
-			if (((i - pos) + 1) >
-			    (NET_IPV6_FRAGMENTS_MAX_PKT - i)) {
-				return -ENOMEM;
-			}
-
-			memmove(&reass->pkt[i], &reass->pkt[pos],
-				sizeof(void *) * (i - pos));
-
-			return 0;
-		}
-	}
-
-	return -EINVAL;
-}
-
 static enum net_verdict handle_fragment_hdr(struct net_pkt *pkt,
-					    struct net_buf *frag,
-					    int total_len,
-					    u16_t buf_offset)
+					    struct net_pkt_cursor *cursor,
+					    int total_len)
 {
 	struct net_ipv6_reassembly *reass = NULL;
-	u32_t id;
-	u16_t loc;
+	struct net_ipv6_frag *entry, *prev, *next;
+	sys_snode_t *node;
+	u32_t id, end;
 	u16_t offset;
 	u16_t flag;
+	u16_t len;
 	u8_t nexthdr;
 	u8_t more;
-	bool found;
 	int i;
 
 	if (!reassembly_init_done) {
@@ -3037,120 +3121,135 @@ static enum net_verdict handle_fragment_hdr(struct net_pkt *pkt,
 					    reassembly_timeout);
 		}
 
+		sys_slist_init(&frag_free);
+
+		for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
+			sys_slist_append(&frag_free, &frag_entries[i].node);
+		}
+
 		reassembly_init_done = true;
 	}
 
-	net_pkt_set_ipv6_fragment_start(pkt, frag->data + buf_offset);
+	net_pkt_set_ipv6_fragment_start(pkt, cursor->frag->data +
+					cursor->pos);
 
 	/* Each fragment has a fragment header. */
-	frag = net_frag_read_u8(frag, buf_offset, &loc, &nexthdr);
-	frag = net_frag_skip(frag, loc, &loc, 1); /* reserved */
-	frag = net_frag_read_be16(frag, loc, &loc, &flag);
-	frag = net_frag_read_be32(frag, loc, &loc, &id);
-	if (!frag && loc == 0xffff) {
-		goto drop;
-	}
-
-	reass = reassembly_get(id, &NET_IPV6_HDR(pkt)->src,
-			       &NET_IPV6_HDR(pkt)->dst);
-	if (!reass) {
-		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
-		goto drop;
+	if (net_pkt_cursor_read_u8(cursor, &nexthdr) ||
+	    net_pkt_cursor_skip(cursor, 1) || /* reserved */
+	    net_pkt_cursor_read_be16(cursor, &flag) ||
+	    net_pkt_cursor_read_be32(cursor, &id)) {
+		return NET_DROP;
 	}
 
 	offset = flag & 0xfff8;
 	more = flag & 0x01;
 
-	net_pkt_set_ipv6_fragment_offset(pkt, offset);
+	/* The fragment data starts right after the fragment header */
+	len = total_len - cursor->offset;
+	end = offset + len;
 
-	if (!reass->pkt[0]) {
-		NET_DBG("Storing pkt %p to slot %d offset 0x%x", pkt, 0,
-			offset);
-		reass->pkt[0] = pkt;
+	if (more && (len % 8)) {
+		/* Fragment length is not multiple of 8, discard
+		 * the packet and send parameter problem error.
+		 */
+		net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
+				      NET_ICMPV6_PARAM_PROB_OPTION, 0);
+		return NET_DROP;
+	}
 
-		reassembly_info("Reassembly 1st pkt", reass);
+	if (end > 0xffff) {
+		NET_DBG("Reassembled packet would be too long");
+		return NET_DROP;
+	}
 
-		/* Wait for more fragments to receive. */
-		goto accept;
+	reass = reassembly_get(id, &NET_IPV6_HDR(pkt)->src,
+			       &NET_IPV6_HDR(pkt)->dst);
+	if (!reass) {
+		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
+		return NET_DROP;
 	}
 
-	/* The fragments might come in wrong order so place them
-	 * in reassembly chain in correct order.
-	 */
-	for (i = 0, found = false; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Storing pkt %p to slot %d offset 0x%x", pkt,
-				i, offset);
-			reass->pkt[i] = pkt;
-			found = true;
-			break;
-		}
+	net_pkt_set_ipv6_fragment_offset(pkt, offset);
 
-		if (net_pkt_ipv6_fragment_offset(reass->pkt[i]) < offset) {
-			continue;
+	/* Find the fragments before and after this one. Fragments mostly
+	 * arrive in order so check the end of the list first.
+	 */
+	prev = SYS_SLIST_PEEK_TAIL_CONTAINER(&reass->frags, prev, node);
+	if (prev && prev->offset < offset) {
+		next = NULL;
+	} else {
+		prev = NULL;
+		next = SYS_SLIST_PEEK_HEAD_CONTAINER(&reass->frags, next,
+						     node);
+		while (next && next->offset < offset) {
+			prev = next;
+			next = SYS_SLIST_PEEK_NEXT_CONTAINER(next, node);
 		}
+	}
 
-		/* Make room for this fragment, if there is no room, then
-		 * discard the whole reassembly.
-		 */
-		if (shift_packets(reass, i)) {
-			break;
-		}
+	if (next && next->offset == offset && next->len == len) {
+		NET_DBG("Duplicate fragment offset 0x%x for 0x%x", offset,
+			reass->id);
+		return NET_DROP;
+	}
 
-		NET_DBG("Storing %p (offset 0x%x) to [%d]", pkt, offset, i);
-		reass->pkt[i] = pkt;
-		found = true;
-		break;
+	/* Overlapping fragments are not allowed (RFC 5722), nor data
+	 * after the last fragment.
+	 */
+	if ((prev && prev->offset + prev->len > offset) ||
+	    (next && end > next->offset) ||
+	    (reass->last_received && end > reass->total_len) ||
+	    (!more && (reass->last_received || next))) {
+		NET_DBG("Invalid fragment offset 0x%x len %u for 0x%x",
+			offset, len, reass->id);
+		goto drop;
 	}
 
-	if (!found) {
+	node = sys_slist_get(&frag_free);
+	if (!node) {
 		/* We could not add this fragment into our saved fragment
 		 * list. We must discard the whole packet at this point.
 		 */
-		NET_DBG("No slots available for 0x%x", reass->id);
+		NET_DBG("No fragment entries available for 0x%x", reass->id);
 		goto drop;
 	}
 
-	if (more) {
-		if (net_pkt_get_len(pkt) % 8) {
-			/* Fragment length is not multiple of 8, discard
-			 * the packet and send parameter problem error.
-			 */
-			net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
-					      NET_ICMPV6_PARAM_PROB_OPTION, 0);
-			goto drop;
-		}
+	entry = CONTAINER_OF(node, struct net_ipv6_frag, node);
+	entry->pkt = pkt;
+	entry->offset = offset;
+	entry->len = len;
 
-		reassembly_info("Reassembly nth pkt", reass);
+	NET_DBG("Storing pkt %p offset 0x%x len %u after %p", pkt, offset,
+		len, prev ? prev->pkt : NULL);
 
-		NET_DBG("More fragments to be received");
-		goto accept;
-	}
+	sys_slist_insert(&reass->frags, prev ? &prev->node : NULL,
+			 &entry->node);
 
-	reassembly_info("Reassembly last pkt", reass);
+	reass->received += len;
 
-	if (!fragment_verify(reass)) {
-		NET_DBG("Reassembled IPv6 verify failed, dropping id %u",
-			reass->id);
+	if (!more) {
+		reass->last_received = true;
+		reass->total_len = end;
+	}
 
-		/* Let the caller release the already inserted pkt */
-		if (i < NET_IPV6_FRAGMENTS_MAX_PKT) {
-			reass->pkt[i] = NULL;
-		}
+	/* As overlaps are not accepted, all the data is there when the
+	 * amount of it matches the length known from the last fragment.
+	 */
+	if (!reass->last_received || reass->received != reass->total_len) {
+		reassembly_info("Reassembly pkt", reass);
 
-		goto drop;
+		NET_DBG("More fragments to be received");
+		return NET_OK;
 	}
 
-	/* The last fragment received, reassemble the packet */
+	reassembly_info("Reassembly last pkt", reass);
+
 	reassemble_packet(reass);
 
-accept:
 	return NET_OK;
 
 drop:
-	if (reass) {
-		reassembly_cancel(reass->id, &reass->src, &reass->dst);
-	}
+	reassembly_cancel(reass->id, &reass->src, &reass->dst);
 
 	return NET_DROP;
 }
@@ -3532,103 +3631,83 @@ static inline struct net_pkt *check_unknown_option(struct net_pkt *pkt,
 	return pkt;
 }
 
-static inline struct net_buf *handle_ext_hdr_options(struct net_pkt *pkt,
-						     struct net_buf *frag,
-						     int total_len,
-						     u16_t len,
-						     u16_t offset,
-						     u16_t *pos,
-						     enum net_verdict *verdict)
+static inline enum net_verdict handle_ext_hdr_options(
+						struct net_pkt *pkt,
+						struct net_pkt_cursor *cursor,
+						int total_len,
+						u16_t len)
 {
 	u8_t opt_type, opt_len;
-	u16_t length = 0, loc;
+	u16_t length = 0;
 #if defined(CONFIG_NET_RPL)
 	bool result;
+	u16_t pos;
 #endif
 
 	if (len > total_len) {
 		NET_DBG("Corrupted packet, extension header %d too long "
 			"(max %d bytes)", len, total_len);
-		*verdict = NET_DROP;
-		return NULL;
+		return NET_DROP;
 	}
 
 	length += 2;
 
-	/* Each extension option has type and length */
-	frag = net_frag_read_u8(frag, offset, &loc, &opt_type);
-	frag = net_frag_read_u8(frag, loc, &loc, &opt_len);
-	if (!frag && loc == 0xffff) {
-		goto drop;
-	}
+	while (length < len) {
+		if (net_pkt_cursor_read_u8(cursor, &opt_type)) {
+			goto drop;
+		}
 
-	while (frag && (length < len)) {
-		switch (opt_type) {
-		case NET_IPV6_EXT_HDR_OPT_PAD1:
+		/* PAD1 is the only option without a length field */
+		if (opt_type == NET_IPV6_EXT_HDR_OPT_PAD1) {
 			NET_DBG("PAD1 option");
 			length++;
-			loc++;
-			break;
+			continue;
+		}
+
+		if (net_pkt_cursor_read_u8(cursor, &opt_len)) {
+			goto drop;
+		}
+
+		switch (opt_type) {
 		case NET_IPV6_EXT_HDR_OPT_PADN:
 			NET_DBG("PADN option");
-			length += opt_len + 2;
-			loc += opt_len + 2;
 			break;
 #if defined(CONFIG_NET_RPL)
 		case NET_IPV6_EXT_HDR_OPT_RPL:
 			NET_DBG("Processing RPL option");
-			frag = net_rpl_verify_header(pkt, frag, loc, &loc,
-						     &result);
+			net_rpl_verify_header(pkt, cursor->frag, cursor->pos,
+					      &pos, &result);
 			if (!result) {
 				NET_DBG("RPL option error, packet dropped");
 				goto drop;
 			}
 
-			if (!frag && *pos == 0xffff) {
-				goto drop;
-			}
-
-			*verdict = NET_CONTINUE;
-			return frag;
+			break;
 #endif
 		default:
 			if (!check_unknown_option(pkt, opt_type, length)) {
 				goto drop;
 			}
 
-			length += opt_len + 2;
-
-			/* No need to +2 here as loc already contains option
-			 * header len.
-			 */
-			loc += opt_len;
-
 			break;
 		}
 
-		if (length >= len) {
-			break;
-		}
-
-		frag = net_frag_read_u8(frag, loc, &loc, &opt_type);
-		frag = net_frag_read_u8(frag, loc, &loc, &opt_len);
-		if (!frag && loc == 0xffff) {
+		/* Skip the option data */
+		if (net_pkt_cursor_skip(cursor, opt_len)) {
 			goto drop;
 		}
+
+		length += opt_len + 2;
 	}
 
 	if (length != len) {
 		goto drop;
 	}
 
-	*pos += length;
-
-	*verdict = NET_CONTINUE;
-	return frag;
+	return NET_CONTINUE;
 
 drop:
-	*verdict = NET_DROP;
-	return NULL;
+	return NET_DROP;
 }
 
 static inline bool is_upper_layer_protocol_header(u8_t proto)
@@ -3642,11 +3721,11 @@ enum net_verdict net_ipv6_process_pkt(struct net_pkt *pkt)
 	struct net_ipv6_hdr *hdr = NET_IPV6_HDR(pkt);
 	int real_len = net_pkt_get_len(pkt);
 	int pkt_len = (hdr->len[0] << 8) + hdr->len[1] + sizeof(*hdr);
-	struct net_buf *frag;
+	struct net_pkt_cursor cursor;
 	u8_t start_of_ext, prev_hdr;
 	u8_t next, next_hdr, length;
 	u8_t first_option;
-	u16_t offset, total_len = 0;
+	u16_t total_len = 0;
 	u8_t ext_bitmap;
 
 	if (real_len != pkt_len) {
@@ -3723,28 +3802,30 @@ enum net_verdict net_ipv6_process_pkt(struct net_pkt *pkt)
 	}
 
 	/* Go through the extensions */
-	frag = pkt->frags;
+	net_pkt_cursor_init(&cursor, pkt);
+	if (net_pkt_cursor_seek(&cursor, pkt, sizeof(struct net_ipv6_hdr))) {
+		goto drop;
+	}
+
 	next = hdr->nexthdr;
 	first_option = next;
 	ext_bitmap = 0;
-	offset = sizeof(struct net_ipv6_hdr);
 	prev_hdr = &NET_IPV6_HDR(pkt)->nexthdr - &NET_IPV6_HDR(pkt)->vtc;
 
-	while (frag) {
+	while (cursor.frag) {
 		enum net_verdict verdict;
 
 		if (is_upper_layer_protocol_header(next)) {
 			NET_DBG("IPv6 next header %d", next);
-			net_pkt_set_ipv6_ext_len(pkt, offset -
+			net_pkt_set_ipv6_ext_len(pkt, cursor.offset -
 						 sizeof(struct net_ipv6_hdr));
 			goto upper_proto;
 		}
 
-		start_of_ext = offset;
+		start_of_ext = cursor.offset;
 
-		frag = net_frag_read_u8(frag, offset, &offset, &next_hdr);
-		frag = net_frag_read_u8(frag, offset, &offset, &length);
-		if (!frag && offset == 0xffff) {
+		if (net_pkt_cursor_read_u8(&cursor, &next_hdr) ||
+		    net_pkt_cursor_read_u8(&cursor, &length)) {
 			goto drop;
 		}
 
@@ -3782,9 +3863,8 @@ enum net_verdict net_ipv6_process_pkt(struct net_pkt *pkt)
 
 			ext_bitmap |= NET_IPV6_EXT_HDR_BITMAP_HBHO;
 
-			frag = handle_ext_hdr_options(pkt, frag, real_len,
-						      length, offset, &offset,
-						      &verdict);
+			verdict = handle_ext_hdr_options(pkt, &cursor, real_len,
+							 length);
 			break;
 
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
@@ -3795,8 +3875,12 @@ enum net_verdict net_ipv6_process_pkt(struct net_pkt *pkt)
 			 * we need to step back two bytes and start from the
 			 * beginning of the fragment header.
 			 */
-			return handle_fragment_hdr(pkt, frag, real_len,
-						   offset - 2);
+			if (net_pkt_cursor_seek(&cursor, pkt,
+						cursor.offset - 2)) {
+				goto drop;
+			}
+
+			return handle_fragment_hdr(pkt, &cursor, real_len);
 #endif
 		default:
 			goto bad_hdr;
@@ -3841,7 +3925,7 @@ bad_hdr:
 	 */
 	net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
 			      NET_ICMPV6_PARAM_PROB_NEXTHEADER,
-			      offset - 1);
+			      cursor.offset - 1);
 
 	NET_DBG("Unknown next header type");
 	net_stats_update_ip_errors_protoerr();
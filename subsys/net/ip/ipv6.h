@@ -94,12 +94,18 @@ struct net_ipv6_nbr_data {
 	/** State of the neighbor discovery */
 	enum net_ipv6_nbr_state state;
 
+	/** Use counter value when the neighbor was last used */
+	u32_t last_used;
+
 	/** Link metric for the neighbor */
 	u16_t link_metric;
 
 	/** How many times we have sent NS */
 	u8_t ns_count;
 
+	/** Next neighbor in the same hash bucket */
+	u8_t hash_next;
+
 	/** Is the neighbor a router */
 	bool is_router;
 };
@@ -370,13 +376,20 @@ static inline void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 #endif
 
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
-/* We do not have to accept larger than 1500 byte IPv6 packet (RFC 2460 ch 5).
- * This means that we should receive everything within first two fragments.
- * The first one being 1280 bytes and the second one 220 bytes.
- */
-#if !defined(NET_IPV6_FRAGMENTS_MAX_PKT)
-#define NET_IPV6_FRAGMENTS_MAX_PKT 2
-#endif
+/** Received IPv6 fragment waiting for the rest of the packet. */
+struct net_ipv6_frag {
+	/** Next fragment of the same packet in offset order */
+	sys_snode_t node;
+
+	/** The received fragment */
+	struct net_pkt *pkt;
+
+	/** Offset of the fragment data in the reassembled packet */
+	u16_t offset;
+
+	/** Length of the fragment data */
+	u16_t len;
+};
 
 /** Store pending IPv6 fragment information that is needed for reassembly. */
 struct net_ipv6_reassembly {
@@ -392,11 +405,20 @@ struct net_ipv6_reassembly {
 	 */
 	struct k_delayed_work timer;
 
-	/** Pointers to pending fragments */
-	struct net_pkt *pkt[NET_IPV6_FRAGMENTS_MAX_PKT];
+	/** Received fragments sorted by offset */
+	sys_slist_t frags;
 
 	/** IPv6 fragment identification */
 	u32_t id;
+
+	/** Amount of fragment data received so far */
+	u16_t received;
+
+	/** Length of the reassembled data, known after the last fragment */
+	u16_t total_len;
+
+	/** Has the last fragment been received */
+	bool last_received;
 };
 
 /**
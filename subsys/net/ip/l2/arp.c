@@ -121,6 +121,7 @@ static inline struct net_pkt *prepare_arp(struct net_if *iface,
 	net_pkt_frag_add(pkt, frag);
 	net_pkt_set_iface(pkt, iface);
 	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_priority(pkt, NET_PRIORITY_NC);
 
 	hdr = NET_ARP_HDR(pkt);
 	eth = NET_ETH_HDR(pkt);
@@ -388,6 +389,7 @@ static inline struct net_pkt *prepare_arp_reply(struct net_if *iface,
 	net_pkt_frag_add(pkt, frag);
 	net_pkt_set_iface(pkt, iface);
 	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_priority(pkt, NET_PRIORITY_NC);
 
 	hdr = NET_ARP_HDR(pkt);
 	eth = NET_ETH_HDR(pkt);
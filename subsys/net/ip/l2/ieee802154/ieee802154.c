@@ -179,7 +179,10 @@ enum net_verdict ieee802154_manage_recv_packet(struct net_if *iface,
 
 #ifdef CONFIG_NET_L2_IEEE802154_FRAGMENT
 	verdict = ieee802154_reassemble(pkt);
-	if (verdict == NET_DROP) {
+	if (verdict != NET_CONTINUE) {
+		/* Either dropped, or consumed as a fragment that was
+		 * cached or forwarded, so pkt must not be touched anymore.
+		 */
 		goto out;
 	}
 #else
@@ -208,6 +211,11 @@ static inline bool ieee802154_manage_send_packet(struct net_if *iface,
 	ret = net_6lo_compress(pkt, true, ieee802154_fragment);
 #else
 	ret = net_6lo_compress(pkt, true, NULL);
+
+	/* The payload is left where it was by the compression */
+	if (ret && pkt->frags->frags) {
+		net_pkt_compact(pkt);
+	}
 #endif
 
 	pkt_hexdump(pkt, false);
@@ -25,6 +25,15 @@
 #include "6lo.h"
 #include "6lo_private.h"
 
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD)
+#include <net/ieee802154.h>
+
+#include "ieee802154_frame.h"
+#include "ipv6.h"
+#include "nbr.h"
+#include "route.h"
+#endif
+
 #define FRAG_REASSEMBLY_TIMEOUT (MSEC_PER_SEC * \
 				 CONFIG_NET_L2_IEEE802154_REASSEMBLY_TIMEOUT)
 #define REASS_CACHE_SIZE CONFIG_NET_L2_IEEE802154_FRAGMENT_REASS_CACHE_SIZE
@@ -186,16 +195,31 @@ static inline u8_t move_frag_data(struct net_buf *frag,
 
 static inline void compact_frag(struct net_buf *frag, u8_t moved)
 {
-	u8_t remaining = frag->len - moved;
-
-	/* Move remaining data next to fragmentation header,
-	 * (leave space for header).
+	/* The source fragment is only read from, so just skip the data
+	 * that was moved. This also works for fragments that refer to
+	 * read-only application data.
 	 */
-	if (remaining) {
-		memmove(frag->data, frag->data + moved, remaining);
+	net_buf_pull(frag, moved);
+}
+
+/* Header compression leaves the payload where it was, so a packet that
+ * fits in one frame can still be spread over several fragments. Use the
+ * room freed by the compression and pull the rest in from the following
+ * fragments.
+ */
+static void single_fragment(struct net_pkt *pkt)
+{
+	struct net_buf *frag = pkt->frags;
+	u16_t headroom = net_buf_headroom(frag) - net_pkt_ll_reserve(pkt);
+
+	if (net_buf_tailroom(frag) < net_pkt_get_len(pkt) - frag->len) {
+		net_buf_push(frag, headroom);
+		memmove(frag->data, frag->data + headroom,
+			frag->len - headroom);
+		frag->len -= headroom;
 	}
 
-	frag->len = remaining;
+	net_pkt_compact(pkt);
 }
 
 /**
@@ -237,9 +261,16 @@ bool ieee802154_fragment(struct net_pkt *pkt, int hdr_diff)
 		return false;
 	}
 
-	/* If it is a single fragment do not add fragmentation header */
-	if (!pkt->frags->frags) {
-		return true;
+	/* If it fits in a single frame do not add fragmentation header */
+	if (net_pkt_get_len(pkt) <=
+	    pkt->frags->size - net_pkt_ll_reserve(pkt)) {
+		if (pkt->frags->frags) {
+			single_fragment(pkt);
+		}
+
+		if (!pkt->frags->frags) {
+			return true;
+		}
 	}
 
 	/* Datagram_size: total length before compression */
@@ -260,6 +291,9 @@ bool ieee802154_fragment(struct net_pkt *pkt, int hdr_diff)
 	 */
 	while (1) {
 		if (!room) {
+			/* The compressed headers are only in the first one */
+			first = !offset;
+
 			/* Prepare new fragment based on offset */
 			frag = prepare_new_fragment(pkt, offset);
 			if (!frag) {
@@ -280,7 +314,6 @@ bool ieee802154_fragment(struct net_pkt *pkt, int hdr_diff)
 
 		/* Move data from next fragment to current fragment */
 		move = move_frag_data(frag, next, max, first, hdr_diff, &room);
-		first = false;
 
 		/* Compact the next fragment */
 		compact_frag(next, move);
@@ -306,10 +339,30 @@ static inline u16_t get_datagram_tag(u8_t *ptr)
 	return (ptr[0] << 8) | ptr[1];
 }
 
-static inline void remove_frag_header(struct net_buf *frag, u8_t hdr_len)
+static inline void move_ll_addr(struct net_linkaddr *lladdr,
+				u8_t *ll, u8_t len, u8_t moved)
+{
+	if (lladdr->addr >= ll && lladdr->addr < ll + len) {
+		lladdr->addr += moved;
+	}
+}
+
+/* Instead of moving the payload, move the link layer header over the
+ * fragmentation header and skip it.
+ */
+static inline void remove_frag_header(struct net_pkt *pkt, u8_t hdr_len)
 {
-	memmove(frag->data, frag->data + hdr_len, frag->len - hdr_len);
-	frag->len -= hdr_len;
+	u8_t *ll = net_pkt_ll(pkt);
+	u8_t len = net_pkt_ll_reserve(pkt);
+
+	if (len) {
+		memmove(ll + hdr_len, ll, len);
+
+		move_ll_addr(net_pkt_ll_src(pkt), ll, len, hdr_len);
+		move_ll_addr(net_pkt_ll_dst(pkt), ll, len, hdr_len);
+	}
+
+	net_buf_pull(pkt->frags, hdr_len);
 }
 
 static void update_protocol_header_lengths(struct net_pkt *pkt, u16_t size)
@@ -443,6 +496,465 @@ static inline bool copy_frag(struct net_pkt *pkt,
 	return true;
 }
 
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD)
+#define FRAG_FORWARD_LABELS CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD_LABELS
+
+/**
+ *  Virtual reassembly buffer, see draft-ietf-6lo-minimal-fragment.
+ *  When the first fragment of a datagram that is routed through us is
+ *  received, it is sent on to the next hop right away. A label then
+ *  maps the datagram tag used by the previous hop to the one used
+ *  towards the next hop, so that the following fragments are switched
+ *  without being reassembled.
+ */
+struct frag_label {
+	struct k_delayed_work timer;	/* Forwarding timer */
+	struct net_if *iface;		/* Interface towards next hop */
+	struct net_linkaddr_storage src; /* Previous hop */
+	struct in6_addr next_hop;	/* Next hop address */
+	u8_t dst[IEEE802154_EXT_ADDR_LENGTH]; /* Next hop link address */
+	u16_t size;			/* Datagram size */
+	u16_t in_tag;			/* Datagram tag from previous hop */
+	u16_t out_tag;			/* Datagram tag towards next hop */
+	u16_t forwarded;		/* Datagram bytes sent on so far */
+	bool active;			/* Fragments are still switched */
+	bool used;			/* Slot taken until the timer is done */
+};
+
+/**
+ *  Labels are looked up and claimed by the RX path, and released by
+ *  their timer from the system work queue, both with interrupts locked.
+ *  A label whose timeout is already queued stays used until the timeout
+ *  runs, so that it cannot release the next datagram using the slot.
+ */
+static struct frag_label labels[FRAG_FORWARD_LABELS];
+
+static inline void clear_label(struct frag_label *label)
+{
+	int key;
+
+	key = irq_lock();
+
+	label->active = false;
+
+	if (k_delayed_work_cancel(&label->timer) != -EINPROGRESS) {
+		label->used = false;
+	}
+
+	irq_unlock(key);
+}
+
+/**
+ *  If the rest of the datagram did not follow within the reassembly
+ *  timeout, forget about it.
+ */
+static void label_timeout(struct k_work *work)
+{
+	struct frag_label *label = CONTAINER_OF(work, struct frag_label,
+						timer);
+	int key;
+
+	NET_DBG("Forwarding datagram tag %u timed out", label->in_tag);
+
+	key = irq_lock();
+
+	label->active = false;
+	label->used = false;
+
+	irq_unlock(key);
+}
+
+static inline struct frag_label *get_label(struct net_linkaddr_storage *src,
+					   u16_t size, u16_t tag)
+{
+	struct frag_label *label = NULL;
+	int i, key;
+
+	key = irq_lock();
+
+	for (i = 0; i < FRAG_FORWARD_LABELS; i++) {
+		if (labels[i].active && labels[i].size == size &&
+		    labels[i].in_tag == tag &&
+		    labels[i].src.len == src->len &&
+		    !memcmp(labels[i].src.addr, src->addr, src->len)) {
+			label = &labels[i];
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	return label;
+}
+
+static inline struct frag_label *set_label(struct net_if *iface,
+					   struct net_linkaddr_storage *src,
+					   u16_t size, u16_t tag)
+{
+	struct frag_label *label = NULL;
+	int i, key;
+
+	key = irq_lock();
+
+	for (i = 0; i < FRAG_FORWARD_LABELS; i++) {
+		if (!labels[i].used) {
+			label = &labels[i];
+			label->used = true;
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	if (!label) {
+		return NULL;
+	}
+
+	label->iface = iface;
+	label->src = *src;
+	label->size = size;
+	label->in_tag = tag;
+	label->out_tag = ++datagram_tag;
+	label->forwarded = 0;
+
+	k_delayed_work_init(&label->timer, label_timeout);
+	k_delayed_work_submit(&label->timer, FRAG_REASSEMBLY_TIMEOUT);
+
+	label->active = true;
+
+	return label;
+}
+
+/* Neighbor the datagram is sent to, or NULL if it is not routed */
+static struct net_nbr *get_next_hop(struct net_if *iface,
+				   struct in6_addr *dst)
+{
+	struct net_route_entry *route;
+	struct in6_addr *nexthop;
+	struct net_nbr *nbr;
+
+	nbr = net_ipv6_nbr_lookup(iface, dst);
+	if (!nbr) {
+		route = net_route_lookup(iface, dst);
+		if (!route) {
+			return NULL;
+		}
+
+		nexthop = net_route_get_nexthop(route);
+		if (!nexthop) {
+			return NULL;
+		}
+
+		nbr = net_ipv6_nbr_lookup(iface, nexthop);
+	}
+
+	if (!nbr || nbr->idx == NET_NBR_LLADDR_UNKNOWN) {
+		return NULL;
+	}
+
+	/* Data frames are only built towards extended addresses, so the
+	 * datagram is reassembled and routed by IPv6 instead.
+	 */
+	if (net_nbr_get_lladdr(nbr->idx)->len != IEEE802154_EXT_ADDR_LENGTH) {
+		NET_DBG("Next hop has no extended address, not forwarding");
+		return NULL;
+	}
+
+	return nbr;
+}
+
+static inline struct net_pkt *forward_pkt_new(struct frag_label *label)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_get_reserve_tx(
+		ieee802154_compute_header_size(label->iface, &label->next_hop),
+		K_NO_WAIT);
+	if (!pkt) {
+		return NULL;
+	}
+
+	net_pkt_set_iface(pkt, label->iface);
+	net_pkt_set_family(pkt, AF_INET6);
+
+	return pkt;
+}
+
+/**
+ *  Add a fragment to the forwarded packet, with the fragmentation
+ *  header towards the next hop already in place. Offset is in bytes.
+ */
+static struct net_buf *forward_frag_new(struct net_pkt *pkt,
+					struct frag_label *label,
+					u16_t offset)
+{
+	struct net_buf *frag;
+	u8_t pos = 0;
+
+	frag = net_pkt_get_frag(pkt, K_NO_WAIT);
+	if (!frag) {
+		return NULL;
+	}
+
+	if (offset) {
+		frag->data[pos] = NET_6LO_DISPATCH_FRAGN;
+	} else {
+		frag->data[pos] = NET_6LO_DISPATCH_FRAG1;
+	}
+
+	set_datagram_size(frag->data, label->size);
+	pos += NET_6LO_FRAG_DATAGRAM_SIZE_LEN;
+
+	set_datagram_tag(frag->data + pos, label->out_tag);
+	pos += NET_6LO_FRAG_DATAGRAM_OFFSET_LEN;
+
+	if (offset) {
+		frag->data[pos++] = offset >> 3;
+	}
+
+	net_buf_add(frag, pos);
+	net_pkt_frag_add(pkt, frag);
+
+	return frag;
+}
+
+/**
+ *  Add len bytes of the datagram, starting at offset, to the forwarded
+ *  packet. The next hop might fit less data in a frame than the previous
+ *  one did, in that case the data is spread over several fragments.
+ */
+static bool forward_data(struct net_pkt *pkt, struct frag_label *label,
+			 struct net_pkt_cursor *cursor, u16_t offset,
+			 u16_t len)
+{
+	struct net_buf *frag;
+	u16_t chunk;
+
+	while (len) {
+		frag = forward_frag_new(pkt, label, offset);
+		if (!frag) {
+			return false;
+		}
+
+		chunk = net_buf_tailroom(frag);
+		if (chunk < len) {
+			/* All fragments but the last are multiples of 8 */
+			chunk &= 0xF8;
+		} else {
+			chunk = len;
+		}
+
+		if (!chunk || net_pkt_cursor_read(cursor,
+						  net_buf_add(frag, chunk),
+						  chunk)) {
+			return false;
+		}
+
+		offset += chunk;
+		len -= chunk;
+	}
+
+	return true;
+}
+
+/* Turn every fragment into a data frame to the next hop and send */
+static bool forward_send(struct net_pkt *pkt, struct frag_label *label)
+{
+	struct ieee802154_context *ctx = net_if_l2_data(label->iface);
+	struct net_linkaddr dst;
+	struct net_buf *frag;
+
+	dst.addr = label->dst;
+	dst.len = sizeof(label->dst);
+	dst.type = NET_LINK_IEEE802154;
+
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		if (!ieee802154_create_data_frame(ctx, &dst, frag,
+						  net_pkt_ll_reserve(pkt))) {
+			return false;
+		}
+	}
+
+	net_if_queue_tx(label->iface, pkt);
+
+	return true;
+}
+
+/**
+ *  The first fragment is uncompressed already. If the datagram is not
+ *  for us and there is a route for it, compress the headers again for
+ *  the next hop and send it on. The interface identifiers might have
+ *  been elided against the link addresses of the previous hop, so the
+ *  compressed headers can grow. Whatever does not fit anymore is sent
+ *  in a fragment of its own.
+ */
+static enum net_verdict forward_frag1(struct net_pkt *pkt,
+				      struct net_linkaddr_storage *src,
+				      u16_t size, u16_t tag)
+{
+	struct net_ipv6_hdr *hdr = NET_IPV6_HDR(pkt);
+	struct net_if *iface = net_pkt_iface(pkt);
+	struct net_pkt *fwd = NULL;
+	struct net_pkt_cursor cursor;
+	struct frag_label *label;
+	struct net_linkaddr_storage *lladdr;
+	struct net_buf *frag;
+	struct net_nbr *nbr;
+	u16_t len, hdr_len, compressed, move = 0;
+
+	/* Leave expiring datagrams to IPv6 so that it reports them */
+	if (net_is_ipv6_addr_mcast(&hdr->dst) ||
+	    net_is_my_ipv6_addr(&hdr->dst) || hdr->hop_limit <= 1) {
+		return NET_CONTINUE;
+	}
+
+	/* Some of the other fragments were received first */
+	if (get_reass_cache(size, tag)) {
+		return NET_CONTINUE;
+	}
+
+	nbr = get_next_hop(iface, &hdr->dst);
+	if (!nbr) {
+		return NET_CONTINUE;
+	}
+
+	label = set_label(iface, src, size, tag);
+	if (!label) {
+		NET_DBG("No free label, reassembling tag %u", tag);
+		return NET_CONTINUE;
+	}
+
+	lladdr = net_nbr_get_lladdr(nbr->idx);
+	memcpy(label->dst, lladdr->addr, sizeof(label->dst));
+	net_ipaddr_copy(&label->next_hop, &net_ipv6_nbr_data(nbr)->addr);
+
+	/* Uncompressed length of the datagram covered by this fragment */
+	len = net_pkt_get_len(pkt);
+	hdr_len = NET_IPV6H_LEN;
+
+	if (hdr->nexthdr == IPPROTO_UDP) {
+		hdr_len += NET_UDPH_LEN;
+	}
+
+	hdr->hop_limit--;
+
+	net_pkt_ll_src(pkt)->addr = net_if_get_link_addr(iface)->addr;
+	net_pkt_ll_src(pkt)->len = net_if_get_link_addr(iface)->len;
+	net_pkt_ll_dst(pkt)->addr = label->dst;
+	net_pkt_ll_dst(pkt)->len = sizeof(label->dst);
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
+
+	if (!net_6lo_compress(pkt, true, NULL)) {
+		NET_ERR("Could not compress first frag for next hop");
+		goto drop;
+	}
+
+	fwd = forward_pkt_new(label);
+	if (!fwd) {
+		goto drop;
+	}
+
+	frag = forward_frag_new(fwd, label, 0);
+	if (!frag) {
+		goto drop;
+	}
+
+	compressed = net_pkt_get_len(pkt);
+
+	if (compressed > net_buf_tailroom(frag)) {
+		move = ROUND_UP(compressed - net_buf_tailroom(frag), 8);
+
+		/* Offsets of the other fragments are multiples of 8 */
+		if ((len & 0x07) || move > len - hdr_len) {
+			NET_DBG("First frag does not fit after compression");
+			goto drop;
+		}
+	}
+
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (net_pkt_cursor_read(&cursor, net_buf_add(frag, compressed - move),
+				compressed - move) ||
+	    !forward_data(fwd, label, &cursor, len - move, move)) {
+		goto drop;
+	}
+
+	if (!forward_send(fwd, label)) {
+		goto drop;
+	}
+
+	NET_DBG("Forwarding tag %u as %u (%u bytes)", tag, label->out_tag,
+		len);
+
+	label->forwarded = len;
+	if (label->forwarded >= label->size) {
+		clear_label(label);
+	}
+
+	net_pkt_unref(pkt);
+
+	return NET_OK;
+
+drop:
+	if (fwd) {
+		net_pkt_unref(fwd);
+	}
+
+	clear_label(label);
+
+	return NET_DROP;
+}
+
+/* Following fragments are switched as they are, only with a new tag */
+static enum net_verdict forward_fragn(struct net_pkt *pkt,
+				      struct net_linkaddr_storage *src,
+				      u16_t size, u16_t tag, u16_t offset)
+{
+	struct net_pkt *fwd = NULL;
+	struct net_pkt_cursor cursor;
+	struct frag_label *label;
+	u16_t len;
+
+	label = get_label(src, size, tag);
+	if (!label) {
+		return NET_CONTINUE;
+	}
+
+	len = net_pkt_get_len(pkt);
+
+	fwd = forward_pkt_new(label);
+	if (!fwd) {
+		goto drop;
+	}
+
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (!forward_data(fwd, label, &cursor, offset, len) ||
+	    !forward_send(fwd, label)) {
+		goto drop;
+	}
+
+	label->forwarded += len;
+	if (label->forwarded >= label->size) {
+		NET_DBG("Datagram tag %u forwarded", tag);
+		clear_label(label);
+	}
+
+	net_pkt_unref(pkt);
+
+	return NET_OK;
+
+drop:
+	if (fwd) {
+		net_pkt_unref(fwd);
+	}
+
+	clear_label(label);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD */
+
 /**
  *  Parse size and tag from the fragment, check if we have any cache
  *  related to it. If not create a new cache.
@@ -460,6 +972,16 @@ static inline enum net_verdict add_frag_to_cache(struct net_pkt *pkt,
 	u16_t tag;
 	u16_t offset = 0;
 	u8_t pos = 0;
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD)
+	struct net_linkaddr_storage src = { 0 };
+	enum net_verdict verdict;
+
+	/* Link address of previous hop is gone once uncompressed */
+	if (net_pkt_ll_src(pkt)->addr) {
+		net_linkaddr_set(&src, net_pkt_ll_src(pkt)->addr,
+				 net_pkt_ll_src(pkt)->len);
+	}
+#endif
 
 	/* Parse total size of packet */
 	size = get_datagram_size(pkt->frags->data);
@@ -475,7 +997,16 @@ static inline enum net_verdict add_frag_to_cache(struct net_pkt *pkt,
 	}
 
 	/* Remove frag header and update data */
-	remove_frag_header(pkt->frags, pos);
+	remove_frag_header(pkt, pos);
+
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD)
+	if (!first) {
+		verdict = forward_fragn(pkt, &src, size, tag, offset);
+		if (verdict != NET_CONTINUE) {
+			return verdict;
+		}
+	}
+#endif
 
 	/* Uncompress the IP headers */
 	if (first && !net_6lo_uncompress(pkt)) {
@@ -485,6 +1016,15 @@ static inline enum net_verdict add_frag_to_cache(struct net_pkt *pkt,
 		return NET_DROP;
 	}
 
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD)
+	if (first) {
+		verdict = forward_frag1(pkt, &src, size, tag);
+		if (verdict != NET_CONTINUE) {
+			return verdict;
+		}
+	}
+#endif
+
 	/* If there are no fragments in the cache means this frag
 	 * is the first one. So cache Rx pkt otherwise not.
 	 * Write data fragment data to cached Rx based on offset parameter.
@@ -39,12 +39,14 @@ bool ieee802154_fragment(struct net_pkt *pkt, int hdr_diff);
  *  comes in number of fragments. This function will reassemble them all as
  *  per data tag, data offset and data size. First packet is uncompressed
  *  immediately after reception.
+ *  With CONFIG_NET_L2_IEEE802154_FRAGMENT_FORWARD, fragments of datagrams
+ *  that are routed to another node are sent on to the next hop instead.
  *
  *  @param Pointer to network fragment, which gets updated to full reassembled
  *         packet when verdict is NET_CONTINUE
  *
  *  @return NET_CONTINUE reassembly done, pkt is complete
- *          NET_OK waiting for other fragments,
+ *          NET_OK waiting for other fragments or fragment forwarded,
  *          NET_DROP invalid fragment.
  */
 
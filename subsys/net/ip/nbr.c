@@ -21,6 +21,69 @@
 
 NET_NBR_LLADDR_INIT(net_neighbor_lladdr, CONFIG_NET_IPV6_MAX_NEIGHBORS);
 
+#define LLADDR_HASH_SIZE CONFIG_NET_IPV6_NBR_HASH_SIZE
+
+/* Used link layer addresses are chained from here by their hash so that
+ * finding an address does not need to compare every entry.
+ */
+static u8_t lladdr_hash[LLADDR_HASH_SIZE] = {
+	[0 ... (LLADDR_HASH_SIZE - 1)] = NET_NBR_LLADDR_UNKNOWN
+};
+
+static inline u8_t lladdr_hash_key(const u8_t *addr, u8_t len)
+{
+	u32_t hash = len;
+
+	while (len--) {
+		hash = hash * 33 + addr[len];
+	}
+
+	return hash % LLADDR_HASH_SIZE;
+}
+
+static void lladdr_hash_add(u8_t idx)
+{
+	struct net_nbr_lladdr *entry = &net_neighbor_lladdr[idx];
+	u8_t key = lladdr_hash_key(entry->lladdr.addr, entry->lladdr.len);
+
+	entry->next = lladdr_hash[key];
+	lladdr_hash[key] = idx;
+}
+
+static void lladdr_hash_del(u8_t idx)
+{
+	struct net_nbr_lladdr *entry = &net_neighbor_lladdr[idx];
+	u8_t *prev = &lladdr_hash[lladdr_hash_key(entry->lladdr.addr,
+						  entry->lladdr.len)];
+
+	while (*prev != NET_NBR_LLADDR_UNKNOWN) {
+		if (*prev == idx) {
+			*prev = entry->next;
+			return;
+		}
+
+		prev = &net_neighbor_lladdr[*prev].next;
+	}
+}
+
+static u8_t lladdr_find(const u8_t *addr, u8_t len)
+{
+	u8_t idx = lladdr_hash[lladdr_hash_key(addr, len)];
+
+	while (idx != NET_NBR_LLADDR_UNKNOWN) {
+		struct net_nbr_lladdr *entry = &net_neighbor_lladdr[idx];
+
+		if (entry->lladdr.len == len &&
+		    !memcmp(entry->lladdr.addr, addr, len)) {
+			break;
+		}
+
+		idx = entry->next;
+	}
+
+	return idx;
+}
+
 #if defined(CONFIG_NET_DEBUG_IPV6_NBR_CACHE)
 void net_nbr_unref_debug(struct net_nbr *nbr, const char *caller, int line)
 #define net_nbr_unref(nbr) net_nbr_unref_debug(nbr, __func__, __LINE__)
@@ -59,9 +122,11 @@ struct net_nbr *net_nbr_ref(struct net_nbr *nbr)
 	return nbr;
 }
 
-static inline struct net_nbr *get_nbr(struct net_nbr *start, int idx)
+static inline struct net_nbr *get_nbr(struct net_nbr_table *table, int idx)
 {
-	NET_ASSERT(idx < CONFIG_NET_IPV6_MAX_NEIGHBORS);
+	struct net_nbr *start = table->nbr;
+
+	NET_ASSERT(idx < table->nbr_count);
 
 	return (struct net_nbr *)((void *)start +
 			((sizeof(struct net_nbr) +
@@ -72,8 +137,8 @@ struct net_nbr *net_nbr_get(struct net_nbr_table *table)
 {
 	int i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(table->nbr, i);
+	for (i = 0; i < table->nbr_count; i++) {
+		struct net_nbr *nbr = get_nbr(table, i);
 
 		if (!nbr->ref) {
 			nbr->data = nbr->__nbr;
@@ -89,29 +154,29 @@ int net_nbr_link(struct net_nbr *nbr, struct net_if *iface,
 		 struct net_linkaddr *lladdr)
 {
 	int i, avail = -1;
+	u8_t idx;
 
 	if (nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
 		return -EALREADY;
 	}
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		if (avail < 0 && !net_neighbor_lladdr[i].ref) {
-			avail = i;
-		}
+	idx = lladdr_find(lladdr->addr, lladdr->len);
+	if (idx != NET_NBR_LLADDR_UNKNOWN) {
+		/* We found same lladdr in nbr cache so just
+		 * increase the ref count.
+		 */
+		net_neighbor_lladdr[idx].ref++;
 
-		if (net_neighbor_lladdr[i].ref &&
-		    !memcmp(lladdr->addr,
-			    net_neighbor_lladdr[i].lladdr.addr,
-			    lladdr->len)) {
-			/* We found same lladdr in nbr cache so just
-			 * increase the ref count.
-			 */
-			net_neighbor_lladdr[i].ref++;
+		nbr->idx = idx;
+		nbr->iface = iface;
 
-			nbr->idx = i;
-			nbr->iface = iface;
+		return 0;
+	}
 
-			return 0;
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		if (!net_neighbor_lladdr[i].ref) {
+			avail = i;
+			break;
 		}
 	}
 
@@ -129,6 +194,8 @@ int net_nbr_link(struct net_nbr *nbr, struct net_if *iface,
 			 lladdr->len);
 	net_neighbor_lladdr[avail].lladdr.len = lladdr->len;
 
+	lladdr_hash_add(avail);
+
 	nbr->iface = iface;
 
 	return 0;
@@ -148,6 +215,8 @@ int net_nbr_unlink(struct net_nbr *nbr, struct net_linkaddr *lladdr)
 	net_neighbor_lladdr[nbr->idx].ref--;
 
 	if (!net_neighbor_lladdr[nbr->idx].ref) {
+		lladdr_hash_del(nbr->idx);
+
 		memset(net_neighbor_lladdr[nbr->idx].lladdr.addr, 0,
 		       sizeof(net_neighbor_lladdr[nbr->idx].lladdr.addr));
 	}
@@ -162,15 +231,19 @@ struct net_nbr *net_nbr_lookup(struct net_nbr_table *table,
 			       struct net_if *iface,
 			       struct net_linkaddr *lladdr)
 {
+	u8_t idx;
 	int i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(table->nbr, i);
+	idx = lladdr_find(lladdr->addr, lladdr->len);
+	if (idx == NET_NBR_LLADDR_UNKNOWN) {
+		return NULL;
+	}
+
+	/* Only the index needs to be compared from now on */
+	for (i = 0; i < table->nbr_count; i++) {
+		struct net_nbr *nbr = get_nbr(table, i);
 
-		if (nbr->ref && nbr->iface == iface &&
-		    net_neighbor_lladdr[nbr->idx].ref &&
-		    !memcmp(net_neighbor_lladdr[nbr->idx].lladdr.addr,
-			    lladdr->addr, lladdr->len)) {
+		if (nbr->ref && nbr->idx == idx && nbr->iface == iface) {
 			return nbr;
 		}
 	}
@@ -187,16 +260,35 @@ struct net_linkaddr_storage *net_nbr_get_lladdr(u8_t idx)
 	return &net_neighbor_lladdr[idx].lladdr;
 }
 
+void net_nbr_update_lladdr(u8_t idx, u8_t *addr, u8_t len)
+{
+	NET_ASSERT(idx < CONFIG_NET_IPV6_MAX_NEIGHBORS);
+
+	if (net_neighbor_lladdr[idx].ref) {
+		lladdr_hash_del(idx);
+	}
+
+	net_linkaddr_set(&net_neighbor_lladdr[idx].lladdr, addr, len);
+
+	if (net_neighbor_lladdr[idx].ref) {
+		lladdr_hash_add(idx);
+	}
+}
+
 void net_nbr_clear_table(struct net_nbr_table *table)
 {
 	int i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(table->nbr, i);
-		struct net_linkaddr lladdr = {
-			.addr = net_neighbor_lladdr[i].lladdr.addr,
-			.len = net_neighbor_lladdr[i].lladdr.len
-		};
+	for (i = 0; i < table->nbr_count; i++) {
+		struct net_nbr *nbr = get_nbr(table, i);
+		struct net_linkaddr lladdr;
+
+		if (nbr->idx == NET_NBR_LLADDR_UNKNOWN) {
+			continue;
+		}
+
+		lladdr.addr = net_neighbor_lladdr[nbr->idx].lladdr.addr;
+		lladdr.len = net_neighbor_lladdr[nbr->idx].lladdr.len;
 
 		net_nbr_unlink(nbr, &lladdr);
 	}
@@ -211,8 +303,8 @@ void net_nbr_print(struct net_nbr_table *table)
 {
 	int i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(table->nbr, i);
+	for (i = 0; i < table->nbr_count; i++) {
+		struct net_nbr *nbr = get_nbr(table, i);
 
 		if (!nbr->ref) {
 			continue;
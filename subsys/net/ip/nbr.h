@@ -32,6 +32,9 @@ struct net_nbr_lladdr {
 
 	/** Reference count. */
 	u8_t ref;
+
+	/** Index of the next address in the same hash bucket. */
+	u8_t next;
 };
 
 #define NET_NBR_LLADDR_INIT(_name, _count)	\
@@ -92,6 +95,9 @@ struct net_nbr_table {
 	/** Link to a neighbor pool */
 	struct net_nbr *nbr;
 
+	/** Number of neighbors in the pool */
+	const u16_t nbr_count;
+
 	/** Function to be called when the table is cleared. */
 	void (*const clear)(struct net_nbr_table *table);
 };
@@ -108,6 +114,7 @@ struct net_nbr_table {
 		.table = {						\
 			.clear = _clear,				\
 			.nbr = (struct net_nbr *)_pool,			\
+			.nbr_count = ARRAY_SIZE(_pool),			\
 		}							\
 	}
 
@@ -191,6 +198,15 @@ int net_nbr_unlink(struct net_nbr *nbr, struct net_linkaddr *lladdr);
  */
 struct net_linkaddr_storage *net_nbr_get_lladdr(u8_t idx);
 
+/**
+ * @brief Change the link layer address stored in a specific lladdr
+ * table index. All the neighbors linked to the index see the new address.
+ * @param idx Link layer address index in ll table.
+ * @param addr New link layer address
+ * @param len Length of the link layer address
+ */
+void net_nbr_update_lladdr(u8_t idx, u8_t *addr, u8_t len);
+
 /**
  * @brief Clear table from all neighbors. After this the linking between
  * lladdr and neighbor is removed.
@@ -0,0 +1,648 @@
+/** @file
+ * @brief Network packet capture
+ *
+ * The packets are copied to a ring buffer by the RX and TX paths, and
+ * a low priority thread writes them out as pcapng blocks.
+ */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_CAPTURE)
+#define SYS_LOG_DOMAIN "net/capture"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <misc/util.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/net_l2.h>
+#include <net/ethernet.h>
+#include <net/net_capture.h>
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_FILE)
+#include <fs.h>
+#endif
+
+#include "net_private.h"
+
+/* See http://www.tcpdump.org/linktypes.html */
+#define LINKTYPE_ETHERNET		1
+#define LINKTYPE_RAW			101
+#define LINKTYPE_IEEE802_15_4_NOFCS	230
+
+/* pcapng block types and options, see
+ * https://github.com/pcapng/pcapng
+ */
+#define PCAPNG_SHB			0x0a0d0d0a
+#define PCAPNG_IDB			0x00000001
+#define PCAPNG_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC		0x1a2b3c4d
+#define PCAPNG_OPT_END			0
+#define PCAPNG_OPT_IF_TSRESOL		9
+#define PCAPNG_OPT_EPB_FLAGS		2
+#define PCAPNG_EPB_FLAGS_INBOUND	1
+#define PCAPNG_EPB_FLAGS_OUTBOUND	2
+
+struct pcapng_shb {
+	u32_t type;
+	u32_t len;
+	u32_t magic;
+	u16_t major;
+	u16_t minor;
+	u32_t section_len[2];
+	u32_t len_end;
+};
+
+struct pcapng_idb {
+	u32_t type;
+	u32_t len;
+	u16_t linktype;
+	u16_t reserved;
+	u32_t snaplen;
+	u16_t tsresol_code;
+	u16_t tsresol_len;
+	u8_t tsresol;
+	u8_t tsresol_pad[3];
+	u32_t opt_end;
+	u32_t len_end;
+};
+
+struct pcapng_epb {
+	u32_t type;
+	u32_t len;
+	u32_t iface;
+	u32_t ts_high;
+	u32_t ts_low;
+	u32_t caplen;
+	u32_t origlen;
+};
+
+struct pcapng_epb_end {
+	u16_t flags_code;
+	u16_t flags_len;
+	u32_t flags;
+	u32_t opt_end;
+	u32_t len_end;
+};
+
+enum capture_type {
+	CAPTURE_RX,
+	CAPTURE_TX,
+	CAPTURE_START,
+	CAPTURE_STOP,
+
+	/* Packet record still being copied, replaced by CAPTURE_RX or
+	 * CAPTURE_TX once complete.
+	 */
+	CAPTURE_PENDING,
+};
+
+/* Header of a record in the ring, followed by the captured bytes */
+struct capture_hdr {
+	/** Uptime in milliseconds */
+	u32_t timestamp;
+
+	/** Length of the packet */
+	u16_t orig_len;
+
+	/** Number of bytes that follow, padded to 4 bytes */
+	u16_t len;
+
+	/** enum capture_type */
+	u8_t type;
+
+	/** Index of the network interface */
+	u8_t iface;
+
+	/** Snap length of a CAPTURE_START record */
+	u16_t snaplen;
+};
+
+#define RING_SIZE CONFIG_NET_CAPTURE_BUF_SIZE
+#define RING_MASK (RING_SIZE - 1)
+#define RECORD_SIZE(len) (sizeof(struct capture_hdr) + ROUND_UP(len, 4))
+
+/* Output block, large enough for an EPB of CONFIG_NET_CAPTURE_SNAPLEN
+ * bytes of packet data.
+ */
+#define BLOCK_SIZE (sizeof(struct pcapng_epb) +				\
+		    ROUND_UP(CONFIG_NET_CAPTURE_SNAPLEN, 4) +		\
+		    sizeof(struct pcapng_epb_end))
+
+/* The ring has several producers, the RX path that can run in interrupt
+ * context and the TX threads. They reserve their records by moving tail
+ * with interrupts locked, and copy the packet data once unlocked. The
+ * capture thread is the only consumer and reads the records without
+ * locking, as head is only changed by it, stopping at the first record
+ * still pending. The free running positions wrap around, which requires
+ * the size of the ring to be a power of two.
+ */
+BUILD_ASSERT_MSG((RING_SIZE & RING_MASK) == 0,
+		 "NET_CAPTURE_BUF_SIZE must be a power of two");
+
+static u8_t ring[RING_SIZE] __aligned(4);
+static u32_t ring_head;
+static u32_t ring_tail;
+
+static struct {
+	struct net_capture_filter filter;
+	struct net_capture_stats stats;
+	u16_t snaplen;
+	bool running;
+} capture;
+
+static K_SEM_DEFINE(capture_sem, 0, 1);
+
+NET_STACK_DEFINE(CAPTURE, capture_stack, CONFIG_NET_CAPTURE_STACK_SIZE,
+		 CONFIG_NET_CAPTURE_STACK_SIZE);
+static struct k_thread capture_thread_data;
+
+static u32_t block[BLOCK_SIZE / sizeof(u32_t)];
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_FILE)
+static fs_file_t capture_file;
+static bool capture_file_open;
+#endif
+
+static void ring_write(u32_t pos, const void *data, size_t len)
+{
+	u32_t offset = pos & RING_MASK;
+	size_t part = min(len, RING_SIZE - offset);
+
+	memcpy(&ring[offset], data, part);
+	memcpy(ring, (const u8_t *)data + part, len - part);
+}
+
+static void ring_read(u32_t pos, void *data, size_t len)
+{
+	u32_t offset = pos & RING_MASK;
+	size_t part = min(len, RING_SIZE - offset);
+
+	memcpy(data, &ring[offset], part);
+	memcpy((u8_t *)data + part, ring, len - part);
+}
+
+static inline u32_t ring_space(void)
+{
+	return RING_SIZE - (ring_tail - ring_head);
+}
+
+/* Offset of the IP header from the start of the first fragment, or -1
+ * if the IP header cannot be read directly.
+ */
+static int capture_ip_offset(struct net_if *iface, bool sent)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (iface->l2 == &NET_L2_GET_NAME(ETHERNET)) {
+		/* Once sent, the header is in the link layer reserve */
+		return sent ? 0 : sizeof(struct net_eth_hdr);
+	}
+#endif
+
+#if defined(CONFIG_NET_L2_DUMMY)
+	if (iface->l2 == &NET_L2_GET_NAME(DUMMY)) {
+		return 0;
+	}
+#endif
+
+	return -1;
+}
+
+static u16_t capture_linktype(struct net_if *iface)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (iface->l2 == &NET_L2_GET_NAME(ETHERNET)) {
+		return LINKTYPE_ETHERNET;
+	}
+#endif
+
+#if defined(CONFIG_NET_L2_IEEE802154)
+	if (iface->l2 == &NET_L2_GET_NAME(IEEE802154)) {
+		return LINKTYPE_IEEE802_15_4_NOFCS;
+	}
+#endif
+
+	return LINKTYPE_RAW;
+}
+
+static bool capture_match(struct net_if *iface, struct net_pkt *pkt,
+			  bool sent)
+{
+	struct net_capture_filter *filter = &capture.filter;
+	sa_family_t family;
+	u16_t src, dst;
+	int offset, len;
+	u8_t *ip, proto;
+	u8_t hdr_len;
+
+	if (filter->iface && filter->iface != iface) {
+		return false;
+	}
+
+	if (!filter->family && !filter->proto && !filter->port) {
+		return true;
+	}
+
+	offset = capture_ip_offset(iface, sent);
+	if (offset < 0) {
+		return false;
+	}
+
+	ip = pkt->frags->data + offset;
+	len = pkt->frags->len - offset;
+
+	if (len >= NET_IPV4H_LEN && (ip[0] & 0xf0) == 0x40) {
+		family = AF_INET;
+		proto = ip[9];
+		hdr_len = (ip[0] & 0x0f) << 2;
+	} else if (len >= NET_IPV6H_LEN && (ip[0] & 0xf0) == 0x60) {
+		family = AF_INET6;
+		proto = ip[6];
+		hdr_len = NET_IPV6H_LEN;
+	} else {
+		return false;
+	}
+
+	if ((filter->family && filter->family != family) ||
+	    (filter->proto && filter->proto != proto)) {
+		return false;
+	}
+
+	if (!filter->port) {
+		return true;
+	}
+
+	if ((proto != IPPROTO_UDP && proto != IPPROTO_TCP) ||
+	    len < hdr_len + 2 * sizeof(u16_t)) {
+		return false;
+	}
+
+	src = (ip[hdr_len] << 8) | ip[hdr_len + 1];
+	dst = (ip[hdr_len + 2] << 8) | ip[hdr_len + 3];
+
+	return src == filter->port || dst == filter->port;
+}
+
+/* Copies the first len bytes of pkt to the ring at pos */
+static void capture_copy(u32_t pos, struct net_pkt *pkt, u16_t len)
+{
+	struct net_buf *frag;
+	u16_t part;
+	u8_t *data;
+
+	/* The link layer header is in the reserve of the first fragment */
+	frag = pkt->frags;
+	data = net_pkt_ll(pkt);
+	part = net_pkt_ll_reserve(pkt) + frag->len;
+
+	while (len) {
+		part = min(part, len);
+
+		ring_write(pos, data, part);
+		pos += part;
+		len -= part;
+
+		frag = frag->frags;
+		if (!frag) {
+			break;
+		}
+
+		data = frag->data;
+		part = frag->len;
+	}
+}
+
+/* Adds a record to the ring, followed by the first hdr->len bytes of pkt
+ * if it is given. Returns false if the ring does not have room for it
+ * plus reserve bytes.
+ */
+static bool capture_put(struct capture_hdr *hdr, struct net_pkt *pkt,
+			u32_t reserve)
+{
+	volatile u8_t *type;
+	u32_t pos, size;
+	int key;
+
+	size = RECORD_SIZE(hdr->len);
+
+	key = irq_lock();
+
+	if (pkt && !capture.running) {
+		/* Stopped since net_capture_pkt() checked it */
+		irq_unlock(key);
+		return true;
+	}
+
+	if (ring_space() < size + reserve) {
+		if (pkt) {
+			capture.stats.dropped++;
+		}
+
+		irq_unlock(key);
+		return false;
+	}
+
+	pos = ring_tail;
+	ring_tail += size;
+
+	if (!pkt) {
+		ring_write(pos, hdr, sizeof(*hdr));
+		irq_unlock(key);
+
+		k_sem_give(&capture_sem);
+
+		return true;
+	}
+
+	/* The packet data is copied once interrupts are unlocked, the
+	 * record being pending until then.
+	 */
+	type = &ring[(pos + offsetof(struct capture_hdr, type)) & RING_MASK];
+
+	ring_write(pos, hdr, sizeof(*hdr));
+	*type = CAPTURE_PENDING;
+
+	capture.stats.captured++;
+
+	irq_unlock(key);
+
+	capture_copy(pos + sizeof(*hdr), pkt, hdr->len);
+
+	compiler_barrier();
+	*type = hdr->type;
+
+	k_sem_give(&capture_sem);
+
+	return true;
+}
+
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt, bool sent)
+{
+	struct capture_hdr hdr;
+	size_t len;
+
+	if (!capture.running || !pkt->frags ||
+	    !capture_match(iface, pkt, sent)) {
+		return;
+	}
+
+	len = net_pkt_ll_reserve(pkt) + net_pkt_get_len(pkt);
+
+	hdr.timestamp = k_uptime_get_32();
+	hdr.orig_len = min(len, UINT16_MAX);
+	hdr.len = min(len, capture.snaplen);
+	hdr.type = sent ? CAPTURE_TX : CAPTURE_RX;
+	hdr.iface = net_if_get_by_iface(iface);
+	hdr.snaplen = 0;
+
+	/* Keep room for the record written by net_capture_stop() */
+	capture_put(&hdr, pkt, RECORD_SIZE(0));
+}
+
+#if defined(CONFIG_NET_CAPTURE_OUTPUT_FILE)
+static void capture_output_open(void)
+{
+	int ret;
+
+	ret = fs_open(&capture_file, CONFIG_NET_CAPTURE_FILE_NAME);
+	if (ret < 0) {
+		NET_ERR("Cannot open %s (%d)", CONFIG_NET_CAPTURE_FILE_NAME,
+			ret);
+		return;
+	}
+
+	fs_truncate(&capture_file, 0);
+
+	capture_file_open = true;
+}
+
+static void capture_output(const void *data, size_t len)
+{
+	if (capture_file_open) {
+		fs_write(&capture_file, data, len);
+	}
+}
+
+static void capture_output_close(void)
+{
+	if (capture_file_open) {
+		fs_close(&capture_file);
+		capture_file_open = false;
+	}
+}
+#else
+#define capture_output_open(...)
+#define capture_output_close(...)
+
+/* Each block is printed on its own line, so that console output that
+ * gets mixed with it only spoils that block.
+ */
+static void capture_output(const void *data, size_t len)
+{
+	const u8_t *ptr = data;
+	char hex[2 * 32 + 1];
+	size_t i, part;
+	char *out;
+
+	printk("pcapng:");
+
+	while (len) {
+		part = min(len, sizeof(hex) / 2);
+
+		for (i = 0, out = hex; i < part; i++) {
+			out = net_byte_to_hex(out, ptr[i], 'a', true);
+		}
+
+		printk("%s", hex);
+
+		ptr += part;
+		len -= part;
+	}
+
+	printk("\n");
+}
+#endif /* CONFIG_NET_CAPTURE_OUTPUT_FILE */
+
+static void capture_write_idb(struct net_if *iface, void *user_data)
+{
+	struct pcapng_idb *idb = (struct pcapng_idb *)block;
+
+	memset(idb, 0, sizeof(*idb));
+
+	idb->type = PCAPNG_IDB;
+	idb->len = sizeof(*idb);
+	idb->linktype = capture_linktype(iface);
+	idb->snaplen = POINTER_TO_UINT(user_data);
+	idb->tsresol_code = PCAPNG_OPT_IF_TSRESOL;
+	idb->tsresol_len = 1;
+	idb->tsresol = 3; /* Milliseconds */
+	idb->opt_end = PCAPNG_OPT_END;
+	idb->len_end = sizeof(*idb);
+
+	capture_output(idb, sizeof(*idb));
+}
+
+/* A new section, that describes all the interfaces so that their index
+ * can be used as the interface ID of the packet blocks.
+ */
+static void capture_write_header(u16_t snaplen)
+{
+	struct pcapng_shb *shb = (struct pcapng_shb *)block;
+
+	shb->type = PCAPNG_SHB;
+	shb->len = sizeof(*shb);
+	shb->magic = PCAPNG_BYTE_ORDER_MAGIC;
+	shb->major = 1;
+	shb->minor = 0;
+	shb->section_len[0] = 0xffffffff;
+	shb->section_len[1] = 0xffffffff;
+	shb->len_end = sizeof(*shb);
+
+	capture_output(shb, sizeof(*shb));
+
+	net_if_foreach(capture_write_idb, UINT_TO_POINTER((u32_t)snaplen));
+}
+
+static void capture_write_packet(struct capture_hdr *hdr, u32_t pos)
+{
+	struct pcapng_epb *epb = (struct pcapng_epb *)block;
+	struct pcapng_epb_end *end;
+	u32_t len = ROUND_UP(hdr->len, 4);
+
+	epb->type = PCAPNG_EPB;
+	epb->len = sizeof(*epb) + len + sizeof(*end);
+	epb->iface = hdr->iface;
+	epb->ts_high = 0;
+	epb->ts_low = hdr->timestamp;
+	epb->caplen = hdr->len;
+	epb->origlen = hdr->orig_len;
+
+	/* The padding is read from the ring as well */
+	ring_read(pos, epb + 1, len);
+	memset((u8_t *)(epb + 1) + hdr->len, 0, len - hdr->len);
+
+	end = (struct pcapng_epb_end *)((u8_t *)(epb + 1) + len);
+	end->flags_code = PCAPNG_OPT_EPB_FLAGS;
+	end->flags_len = sizeof(end->flags);
+	end->flags = hdr->type == CAPTURE_TX ? PCAPNG_EPB_FLAGS_OUTBOUND :
+		PCAPNG_EPB_FLAGS_INBOUND;
+	end->opt_end = PCAPNG_OPT_END;
+	end->len_end = epb->len;
+
+	capture_output(epb, epb->len);
+}
+
+static void capture_thread(void)
+{
+	struct capture_hdr hdr;
+
+	while (1) {
+		k_sem_take(&capture_sem, K_FOREVER);
+
+		while (ring_head != ring_tail) {
+			ring_read(ring_head, &hdr, sizeof(hdr));
+
+			/* Its producer gives the semaphore once done */
+			if (hdr.type == CAPTURE_PENDING) {
+				break;
+			}
+
+			switch (hdr.type) {
+			case CAPTURE_START:
+				capture_output_open();
+				capture_write_header(hdr.snaplen);
+				break;
+			case CAPTURE_STOP:
+				capture_output_close();
+				break;
+			default:
+				capture_write_packet(&hdr,
+						     ring_head + sizeof(hdr));
+				break;
+			}
+
+			ring_head += RECORD_SIZE(hdr.len);
+		}
+	}
+}
+
+int net_capture_start(const struct net_capture_filter *filter,
+		      u16_t snaplen)
+{
+	struct capture_hdr hdr;
+
+	if (capture.running) {
+		return -EALREADY;
+	}
+
+	if (filter) {
+		capture.filter = *filter;
+	} else {
+		memset(&capture.filter, 0, sizeof(capture.filter));
+	}
+
+	if (!snaplen || snaplen > CONFIG_NET_CAPTURE_SNAPLEN) {
+		snaplen = CONFIG_NET_CAPTURE_SNAPLEN;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.type = CAPTURE_START;
+	hdr.snaplen = snaplen;
+
+	if (!capture_put(&hdr, NULL, RECORD_SIZE(0))) {
+		return -ENOMEM;
+	}
+
+	memset(&capture.stats, 0, sizeof(capture.stats));
+	capture.snaplen = snaplen;
+	capture.running = true;
+
+	return 0;
+}
+
+int net_capture_stop(void)
+{
+	struct capture_hdr hdr;
+
+	if (!capture.running) {
+		return -EALREADY;
+	}
+
+	capture.running = false;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.type = CAPTURE_STOP;
+
+	/* Packet records always leave room for this one */
+	capture_put(&hdr, NULL, 0);
+
+	return 0;
+}
+
+bool net_capture_is_running(void)
+{
+	return capture.running;
+}
+
+void net_capture_get_stats(struct net_capture_stats *stats)
+{
+	*stats = capture.stats;
+}
+
+void net_capture_init(void)
+{
+	k_thread_create(&capture_thread_data, capture_stack,
+			K_THREAD_STACK_SIZEOF(capture_stack),
+			(k_thread_entry_t)capture_thread, NULL, NULL, NULL,
+			K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+}
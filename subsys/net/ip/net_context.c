@@ -82,6 +82,9 @@ static enum net_verdict packet_received(struct net_conn *conn,
 static void set_appdata_values(struct net_pkt *pkt, enum net_ip_protocol proto);
 
 #if defined(CONFIG_NET_TCP)
+static int tcp_listen(struct net_context *context, int backlog);
+static void tcp_listen_release(struct net_context *context);
+
 static struct sockaddr *create_sockaddr(struct net_pkt *pkt,
 					struct sockaddr *addr)
 {
@@ -383,6 +386,13 @@ int net_context_unref(struct net_context *context)
 		return old_rc - 1;
 	}
 
+#if defined(CONFIG_NET_TCP)
+	if (context->tcp &&
+	    net_context_get_state(context) == NET_CONTEXT_LISTENING) {
+		tcp_listen_release(context);
+	}
+#endif /* CONFIG_NET_TCP */
+
 	k_sem_take(&contexts_lock, K_FOREVER);
 
 #if defined(CONFIG_NET_TCP)
@@ -645,8 +655,6 @@ static inline struct net_context *find_context(void *conn_handler)
 
 int net_context_listen(struct net_context *context, int backlog)
 {
-	ARG_UNUSED(backlog);
-
 	NET_ASSERT(PART_OF_ARRAY(contexts, context));
 
 	if (!net_context_is_used(context)) {
@@ -662,10 +670,7 @@ int net_context_listen(struct net_context *context, int backlog)
 
 #if defined(CONFIG_NET_TCP)
 	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
-		net_tcp_change_state(context->tcp, NET_TCP_LISTEN);
-		net_context_set_state(context, NET_CONTEXT_LISTENING);
-
-		return 0;
+		return tcp_listen(context, backlog);
 	}
 #endif
 
@@ -1237,12 +1242,6 @@ int net_context_connect(struct net_context *context,
 
 #if defined(CONFIG_NET_TCP)
 
-static void ack_timer_cancel(struct net_tcp *tcp)
-{
-	tcp->ack_timer_cancelled = true;
-	k_delayed_work_cancel(&tcp->ack_timer);
-}
-
 static void ack_timeout(struct k_work *work)
 {
 	/* This means that we did not receive ACK response in time. */
@@ -1297,6 +1296,32 @@ static void pkt_get_sockaddr(sa_family_t family, struct net_pkt *pkt,
 #endif
 }
 
+/* Answers a segment received by a listening context */
+static int send_reset_reply(struct net_context *context, struct net_pkt *pkt,
+			    struct sockaddr *remote, u32_t seq)
+{
+	struct sockaddr_ptr local;
+	struct net_pkt *reply;
+	int ret;
+
+	pkt_get_sockaddr(net_context_get_family(context), pkt, &local);
+
+	ret = net_tcp_prepare_reset_reply(context->tcp, &local, remote, seq,
+					  &reply);
+	if (ret) {
+		return ret;
+	}
+
+	net_tcp_print_send_info("RST", reply, NET_TCP_HDR(reply)->dst_port);
+
+	ret = net_send_data(reply);
+	if (ret < 0) {
+		net_pkt_unref(reply);
+	}
+
+	return ret;
+}
+
 #if defined(CONFIG_NET_CONTEXT_NET_PKT_POOL)
 static inline void copy_pool_vars(struct net_context *new_context,
 				  struct net_context *listen_context)
@@ -1308,251 +1333,534 @@ static inline void copy_pool_vars(struct net_context *new_context,
 #define copy_pool_vars(...)
 #endif /* CONFIG_NET_CONTEXT_NET_PKT_POOL */
 
-/* This callback is called when we are waiting connections and we receive
- * a packet. We need to check if we are receiving proper msg (SYN) here.
- * The ACK could also be received, in which case we have an established
- * connection.
+/* A connection request that waits for the final ACK of the handshake.
+ * This is all that is kept for a half-open connection, the net_context
+ * and net_tcp are only allocated once the handshake completes.
+ */
+struct tcp_syn_entry {
+	/** Listening context, NULL if the entry is free */
+	struct net_context *listener;
+
+	/** Address and port of the peer */
+	struct sockaddr remote;
+
+	/** Our initial sequence number */
+	u32_t iss;
+
+	/** Initial sequence number of the peer */
+	u32_t irs;
+
+	/** Uptime in milliseconds when the entry expires */
+	u32_t expiry;
+};
+
+static struct tcp_syn_entry syn_table[CONFIG_NET_TCP_SYN_BACKLOG];
+
+static inline bool syn_entry_is_used(struct tcp_syn_entry *entry, u32_t now)
+{
+	return entry->listener && (s32_t)(entry->expiry - now) > 0;
+}
+
+static bool syn_entry_match(struct tcp_syn_entry *entry,
+			    struct sockaddr *remote)
+{
+	if (entry->remote.family != remote->family ||
+	    net_sin(&entry->remote)->sin_port != net_sin(remote)->sin_port) {
+		return false;
+	}
+
+#if defined(CONFIG_NET_IPV6)
+	if (remote->family == AF_INET6) {
+		return net_ipv6_addr_cmp(&net_sin6(&entry->remote)->sin6_addr,
+					 &net_sin6(remote)->sin6_addr);
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV4)
+	if (remote->family == AF_INET) {
+		return net_ipv4_addr_cmp(&net_sin(&entry->remote)->sin_addr,
+					 &net_sin(remote)->sin_addr);
+	}
+#endif
+
+	return false;
+}
+
+static struct tcp_syn_entry *syn_entry_find(struct net_context *listener,
+					    struct sockaddr *remote)
+{
+	u32_t now = k_uptime_get_32();
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(syn_table); i++) {
+		if (syn_table[i].listener == listener &&
+		    syn_entry_is_used(&syn_table[i], now) &&
+		    syn_entry_match(&syn_table[i], remote)) {
+			return &syn_table[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct tcp_syn_entry *syn_entry_alloc(struct net_context *listener,
+					     struct sockaddr *remote)
+{
+	struct tcp_syn_entry *entry = NULL;
+	u32_t now = k_uptime_get_32();
+	int i, key;
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(syn_table); i++) {
+		if (!syn_entry_is_used(&syn_table[i], now)) {
+			entry = &syn_table[i];
+			entry->listener = listener;
+			entry->expiry = now + ACK_TIMEOUT;
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	if (entry) {
+		memcpy(&entry->remote, remote, sizeof(entry->remote));
+	}
+
+	return entry;
+}
+
+static inline void syn_entry_free(struct tcp_syn_entry *entry)
+{
+	entry->listener = NULL;
+}
+
+#if defined(CONFIG_NET_TCP_SYN_COOKIES)
+/* A cookie stays valid for one to two periods of 2^16 ms */
+#define SYN_COOKIE_PERIOD_SHIFT 16
+
+static u32_t syn_cookie_secret;
+
+static u32_t syn_cookie_hash(u32_t hash, const void *data, size_t len)
+{
+	const u8_t *ptr = data;
+
+	/* Jenkins one-at-a-time hash */
+	while (len--) {
+		hash += *ptr++;
+		hash += hash << 10;
+		hash ^= hash >> 6;
+	}
+
+	return hash;
+}
+
+static inline u32_t syn_cookie_period(void)
+{
+	return k_uptime_get_32() >> SYN_COOKIE_PERIOD_SHIFT;
+}
+
+/* Returns the initial sequence number that encodes the connection
+ * requested by pkt, see RFC 4987 chapter 3.6. The MSS of the peer is
+ * not encoded as this stack does not use it.
+ */
+static u32_t syn_cookie_get(struct net_pkt *pkt, u32_t irs, u32_t period)
+{
+	u32_t hash = syn_cookie_secret;
+
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(pkt) == AF_INET6) {
+		/* Source and destination addresses */
+		hash = syn_cookie_hash(hash, &NET_IPV6_HDR(pkt)->src,
+				       2 * sizeof(struct in6_addr));
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(pkt) == AF_INET) {
+		hash = syn_cookie_hash(hash, &NET_IPV4_HDR(pkt)->src,
+				       2 * sizeof(struct in_addr));
+	}
+#endif
+
+	/* Source and destination ports */
+	hash = syn_cookie_hash(hash, NET_TCP_HDR(pkt), 2 * sizeof(u16_t));
+	hash = syn_cookie_hash(hash, &irs, sizeof(irs));
+	hash = syn_cookie_hash(hash, &period, sizeof(period));
+
+	hash += hash << 3;
+	hash ^= hash >> 11;
+	hash += hash << 15;
+
+	return hash;
+}
+
+static bool syn_cookie_check(struct net_pkt *pkt, u32_t irs, u32_t iss)
+{
+	u32_t period = syn_cookie_period();
+
+	return iss == syn_cookie_get(pkt, irs, period) ||
+	       iss == syn_cookie_get(pkt, irs, period - 1);
+}
+#endif /* CONFIG_NET_TCP_SYN_COOKIES */
+
+/* Drops the half-open and the not yet accepted connections of a
+ * listening context that is released.
+ */
+static void tcp_listen_release(struct net_context *context)
+{
+	struct net_tcp *tcp = context->tcp;
+	struct net_context *new_context;
+	sys_snode_t *node;
+	int i, key;
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(syn_table); i++) {
+		if (syn_table[i].listener == context) {
+			syn_entry_free(&syn_table[i]);
+		}
+	}
+
+	irq_unlock(key);
+
+	while ((node = sys_slist_get(&tcp->accept_q))) {
+		new_context = CONTAINER_OF(node, struct net_tcp,
+					   accept_node)->context;
+
+		send_reset(new_context, &new_context->remote);
+		net_context_unref(new_context);
+	}
+
+	tcp->accept_q_len = 0;
+}
+
+static inline socklen_t tcp_remote_len(struct net_context *context)
+{
+	if (context->remote.family == AF_INET6) {
+		return sizeof(struct sockaddr_in6);
+	}
+
+	return sizeof(struct sockaddr_in);
+}
+
+/* Passes the connections established before accept_cb was set */
+static void tcp_accept_q_drain(struct net_context *context)
+{
+	struct net_tcp *tcp = context->tcp;
+	struct net_context *new_context;
+	sys_snode_t *node;
+	int key;
+
+	while (1) {
+		key = irq_lock();
+
+		node = sys_slist_get(&tcp->accept_q);
+		if (node) {
+			tcp->accept_q_len--;
+		}
+
+		irq_unlock(key);
+
+		if (!node) {
+			break;
+		}
+
+		new_context = CONTAINER_OF(node, struct net_tcp,
+					   accept_node)->context;
+
+		tcp->accept_cb(new_context, &new_context->remote,
+			       tcp_remote_len(new_context), 0,
+			       context->user_data);
+	}
+}
+
+/* Creates the context of a connection whose handshake was completed by
+ * the ACK in pkt.
+ */
+static struct net_context *tcp_accepted_context(struct net_context *context,
+						struct net_pkt *pkt,
+						u32_t iss, u32_t irs)
+{
+	struct net_context *new_context;
+	struct sockaddr local_addr;
+	struct sockaddr remote_addr;
+	int ret;
+
+	ret = net_context_get(net_pkt_family(pkt), SOCK_STREAM, IPPROTO_TCP,
+			      &new_context);
+	if (ret < 0) {
+		NET_DBG("Cannot get accepted context, connection reset");
+		return NULL;
+	}
+
+	k_delayed_work_init(&new_context->tcp->ack_timer, ack_timeout);
+
+	new_context->tcp->recv_max_ack = iss + 1;
+	new_context->tcp->send_seq = iss + 1;
+	new_context->tcp->send_ack = irs + 1;
+
+#if defined(CONFIG_NET_IPV6)
+	if (net_context_get_family(context) == AF_INET6) {
+		struct sockaddr_in6 *local_addr6 = net_sin6(&local_addr);
+		struct sockaddr_in6 *remote_addr6 = net_sin6(&remote_addr);
+
+		remote_addr6->sin6_family = AF_INET6;
+		local_addr6->sin6_family = AF_INET6;
+
+		local_addr6->sin6_port = NET_TCP_HDR(pkt)->dst_port;
+		remote_addr6->sin6_port = NET_TCP_HDR(pkt)->src_port;
+
+		net_ipaddr_copy(&local_addr6->sin6_addr,
+				&NET_IPV6_HDR(pkt)->dst);
+		net_ipaddr_copy(&remote_addr6->sin6_addr,
+				&NET_IPV6_HDR(pkt)->src);
+	} else
+#endif /* CONFIG_NET_IPV6 */
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_context_get_family(context) == AF_INET) {
+		struct sockaddr_in *local_addr4 = net_sin(&local_addr);
+		struct sockaddr_in *remote_addr4 = net_sin(&remote_addr);
+
+		remote_addr4->sin_family = AF_INET;
+		local_addr4->sin_family = AF_INET;
+
+		local_addr4->sin_port = NET_TCP_HDR(pkt)->dst_port;
+		remote_addr4->sin_port = NET_TCP_HDR(pkt)->src_port;
+
+		net_ipaddr_copy(&local_addr4->sin_addr,
+				&NET_IPV4_HDR(pkt)->dst);
+		net_ipaddr_copy(&remote_addr4->sin_addr,
+				&NET_IPV4_HDR(pkt)->src);
+	} else
+#endif /* CONFIG_NET_IPV4 */
+	{
+		NET_ASSERT_INFO(false, "Invalid protocol family %d",
+				net_context_get_family(context));
+		goto fail;
+	}
+
+	ret = net_context_bind(new_context, &local_addr, sizeof(local_addr));
+	if (ret < 0) {
+		NET_DBG("Cannot bind accepted context, connection reset");
+		goto fail;
+	}
+
+	new_context->flags |= NET_CONTEXT_REMOTE_ADDR_SET;
+
+	memcpy(&new_context->remote, &remote_addr, sizeof(remote_addr));
+
+	ret = net_tcp_register(&new_context->remote,
+			       &local_addr,
+			       ntohs(net_sin(&new_context->remote)->sin_port),
+			       ntohs(net_sin(&local_addr)->sin_port),
+			       tcp_established,
+			       new_context,
+			       &new_context->conn_handler);
+	if (ret < 0) {
+		NET_DBG("Cannot register accepted TCP handler (%d)", ret);
+		goto fail;
+	}
+
+	copy_pool_vars(new_context, context);
+
+	net_tcp_change_state(new_context->tcp, NET_TCP_SYN_RCVD);
+	net_tcp_change_state(new_context->tcp, NET_TCP_ESTABLISHED);
+	net_context_set_state(new_context, NET_CONTEXT_CONNECTED);
+
+	return new_context;
+
+fail:
+	net_context_unref(new_context);
+
+	return NULL;
+}
+
+/* This callback is called for the segments received by a listening
+ * context. A SYN is answered with a SYN-ACK and remembered in syn_table,
+ * or encoded in a SYN cookie if the table is full. The final ACK of the
+ * handshake then creates the context of the new connection.
  */
 NET_CONN_CB(tcp_syn_rcvd)
 {
 	struct net_context *context = (struct net_context *)user_data;
-	struct net_tcp *tcp;
 	struct sockaddr_ptr pkt_src_addr;
+	struct net_context *new_context;
+	struct tcp_syn_entry *entry;
+	struct sockaddr peer;
+	struct net_tcp *tcp;
+	u32_t seq, ack;
+	bool queued;
+	u8_t flags;
+	int key;
 
 	NET_ASSERT(context && context->tcp);
 
 	tcp = context->tcp;
 
-	switch (net_tcp_get_state(tcp)) {
-	case NET_TCP_LISTEN:
-		net_context_set_iface(context, net_pkt_iface(pkt));
-		break;
-	case NET_TCP_SYN_RCVD:
-		if (net_pkt_iface(pkt) != net_context_get_iface(context)) {
-			return NET_DROP;
-		}
-		break;
-	default:
+	if (net_tcp_get_state(tcp) != NET_TCP_LISTEN) {
 		NET_DBG("Context %p in wrong state %d",
 			context, tcp->state);
 		return NET_DROP;
 	}
 
+	/* Replies are sent through the interface of the request */
+	net_context_set_iface(context, net_pkt_iface(pkt));
 	net_pkt_set_context(pkt, context);
 
 	NET_ASSERT(net_pkt_iface(pkt));
 
+	if (!create_sockaddr(pkt, &peer)) {
+		return NET_DROP;
+	}
+
+	entry = syn_entry_find(context, &peer);
+	flags = NET_TCP_FLAGS(pkt);
+	seq = sys_get_be32(NET_TCP_HDR(pkt)->seq);
+	ack = sys_get_be32(NET_TCP_HDR(pkt)->ack);
+
 	/*
-	 * If we receive SYN, we send SYN-ACK and go to SYN_RCVD state.
+	 * If we receive SYN, we send SYN-ACK. A retransmitted SYN gets
+	 * the same SYN-ACK again.
 	 */
-	if (NET_TCP_FLAGS(pkt) == NET_TCP_SYN) {
-		struct sockaddr peer, *remote;
-
+	if (flags == NET_TCP_SYN) {
 		net_tcp_print_recv_info("SYN", pkt, NET_TCP_HDR(pkt)->src_port);
 
-		net_tcp_change_state(tcp, NET_TCP_SYN_RCVD);
+		if (!entry) {
+			entry = syn_entry_alloc(context, &peer);
+			if (entry) {
+				entry->iss = sys_rand32_get();
+			}
+		}
 
-		remote = create_sockaddr(pkt, &peer);
+		if (entry) {
+			entry->irs = seq;
+			entry->expiry = k_uptime_get_32() + ACK_TIMEOUT;
+			tcp->send_seq = entry->iss;
+		} else {
+#if defined(CONFIG_NET_TCP_SYN_COOKIES)
+			NET_DBG("SYN table full, sending SYN cookie");
+			tcp->send_seq = syn_cookie_get(pkt, seq,
+						       syn_cookie_period());
+#else
+			NET_DBG("SYN table full, dropping SYN");
+			net_stats_update_tcp_seg_conndrop();
+			return NET_DROP;
+#endif
+		}
 
-		/* FIXME: Is this the correct place to set tcp->send_ack? */
-		context->tcp->send_ack =
-			sys_get_be32(NET_TCP_HDR(pkt)->seq) + 1;
-		context->tcp->recv_max_ack = context->tcp->send_seq + 1;
+		tcp->send_ack = seq + 1;
 
 		pkt_get_sockaddr(net_context_get_family(context),
 				 pkt, &pkt_src_addr);
-		send_syn_ack(context, &pkt_src_addr, remote);
-
-		/* We might be entering this section multiple times
-		 * if the SYN is sent more than once. So we need to cancel
-		 * any pending timers.
-		 */
-		ack_timer_cancel(tcp);
-
-		k_delayed_work_init(&tcp->ack_timer, ack_timeout);
-		k_delayed_work_submit(&tcp->ack_timer, ACK_TIMEOUT);
-
-		tcp->ack_timer_cancelled = false;
+		send_syn_ack(context, &pkt_src_addr, &peer);
 
 		return NET_DROP;
 	}
 
 	/*
-	 * See RFC 793 chapter 3.4 "Reset Processing" and RFC 793, page 65
-	 * for more details. If RST is received in SYN_RCVD state, go back
-	 * to LISTEN state. No other states are valid for this function.
+	 * See RFC 793 chapter 3.4 "Reset Processing". An RST can only
+	 * refer to a SYN-ACK we sent, and it must have a valid seq field.
 	 */
-	if (NET_TCP_FLAGS(pkt) == NET_TCP_RST) {
-
-		/* We only accept an RST packet that has valid seq field
-		 * and ignore RST received in LISTEN state.
-		 */
-		if (!net_tcp_validate_seq(tcp, pkt) ||
-		    net_tcp_get_state(tcp) == NET_TCP_LISTEN) {
+	if (flags & NET_TCP_RST) {
+		if (!entry || seq != entry->irs + 1) {
 			net_stats_update_tcp_seg_rsterr();
 			return NET_DROP;
 		}
 
 		net_stats_update_tcp_seg_rst();
 
-		ack_timer_cancel(tcp);
-
 		net_tcp_print_recv_info("RST", pkt, NET_TCP_HDR(pkt)->src_port);
 
-		if (net_tcp_get_state(tcp) == NET_TCP_SYN_RCVD) {
-			net_tcp_change_state(tcp, NET_TCP_LISTEN);
-		} else {
-			NET_DBG("TCP socket not in SYN RCVD state, closing");
-			net_tcp_change_state(tcp, NET_TCP_CLOSED);
-		}
+		syn_entry_free(entry);
 
 		return NET_DROP;
 	}
 
 	/*
-	 * If we receive ACK, we go to ESTABLISHED state.
+	 * If we receive the ACK of our SYN-ACK, the connection is
+	 * established. The ACK can already carry data.
 	 */
-	if (NET_TCP_FLAGS(pkt) == NET_TCP_ACK) {
-		struct net_context *new_context;
-		struct sockaddr local_addr;
-		struct sockaddr remote_addr;
-		struct net_tcp *tmp_tcp;
-		socklen_t addrlen;
-		int ret;
+	if ((flags & ~NET_TCP_PSH) != NET_TCP_ACK) {
+		return NET_DROP;
+	}
 
-		/* We can only receive ACK if we have already received SYN.
-		 * So if we are not in SYN_RCVD state, then it is an error.
-		 */
-		if (net_tcp_get_state(tcp) != NET_TCP_SYN_RCVD) {
-			ack_timer_cancel(tcp);
-			NET_DBG("Not in SYN_RCVD state, sending RST");
+	net_tcp_print_recv_info("ACK", pkt, NET_TCP_HDR(pkt)->src_port);
+
+	if (entry) {
+		if (ack != entry->iss + 1 || seq != entry->irs + 1) {
+			NET_DBG("Invalid ACK, sending RST");
+			syn_entry_free(entry);
 			goto reset;
 		}
-
-		net_tcp_print_recv_info("ACK", pkt, NET_TCP_HDR(pkt)->src_port);
-
-		if (!context->tcp->accept_cb) {
-			NET_DBG("No accept callback, connection reset.");
+	} else {
+#if defined(CONFIG_NET_TCP_SYN_COOKIES)
+		if (!syn_cookie_check(pkt, seq - 1, ack - 1)) {
+			NET_DBG("Invalid SYN cookie, sending RST");
 			goto reset;
 		}
+#else
+		NET_DBG("No connection request, sending RST");
+		goto reset;
+#endif
+	}
 
-		/* We create a new context that starts to wait data.
+	if (!tcp->accept_cb && tcp->accept_q_len >= tcp->backlog) {
+		/* The peer considers the connection established, it would
+		 * wait forever for a SYN-ACK retransmission.
 		 */
-		ret = net_context_get(net_pkt_family(pkt),
-				      SOCK_STREAM, IPPROTO_TCP,
-				      &new_context);
-		if (ret < 0) {
-			NET_DBG("Cannot get accepted context, "
-				"connection reset");
-			goto conndrop;
-		}
-
-		new_context->tcp->recv_max_ack = context->tcp->recv_max_ack;
-		new_context->tcp->send_seq = context->tcp->send_seq;
-		new_context->tcp->send_ack = context->tcp->send_ack;
-
-#if defined(CONFIG_NET_IPV6)
-		if (net_context_get_family(context) == AF_INET6) {
-			struct sockaddr_in6 *local_addr6 =
-				net_sin6(&local_addr);
-			struct sockaddr_in6 *remote_addr6 =
-				net_sin6(&remote_addr);
+		NET_DBG("Accept queue of %p full, sending RST", context);
 
-			remote_addr6->sin6_family = AF_INET6;
-			local_addr6->sin6_family = AF_INET6;
-
-			local_addr6->sin6_port = NET_TCP_HDR(pkt)->dst_port;
-			remote_addr6->sin6_port = NET_TCP_HDR(pkt)->src_port;
-
-			net_ipaddr_copy(&local_addr6->sin6_addr,
-					&NET_IPV6_HDR(pkt)->dst);
-			net_ipaddr_copy(&remote_addr6->sin6_addr,
-					&NET_IPV6_HDR(pkt)->src);
-			addrlen = sizeof(struct sockaddr_in6);
-		} else
-#endif /* CONFIG_NET_IPV6 */
-
-#if defined(CONFIG_NET_IPV4)
-		if (net_context_get_family(context) == AF_INET) {
-			struct sockaddr_in *local_addr4 =
-				net_sin(&local_addr);
-			struct sockaddr_in *remote_addr4 =
-				net_sin(&remote_addr);
-
-			remote_addr4->sin_family = AF_INET;
-			local_addr4->sin_family = AF_INET;
-
-			local_addr4->sin_port = NET_TCP_HDR(pkt)->dst_port;
-			remote_addr4->sin_port = NET_TCP_HDR(pkt)->src_port;
-
-			net_ipaddr_copy(&local_addr4->sin_addr,
-					&NET_IPV4_HDR(pkt)->dst);
-			net_ipaddr_copy(&remote_addr4->sin_addr,
-					&NET_IPV4_HDR(pkt)->src);
-			addrlen = sizeof(struct sockaddr_in);
-		} else
-#endif /* CONFIG_NET_IPV4 */
-		{
-			NET_ASSERT_INFO(false, "Invalid protocol family %d",
-					net_context_get_family(context));
-			net_context_unref(new_context);
-			return NET_DROP;
+		if (entry) {
+			syn_entry_free(entry);
 		}
 
-		ret = net_context_bind(new_context, &local_addr,
-				       sizeof(local_addr));
-		if (ret < 0) {
-			NET_DBG("Cannot bind accepted context, "
-				"connection reset");
-			net_context_unref(new_context);
-			goto conndrop;
+		goto conndrop;
+	}
+
+	new_context = tcp_accepted_context(context, pkt, ack - 1, seq - 1);
+	if (!new_context) {
+		if (entry) {
+			syn_entry_free(entry);
 		}
 
-		new_context->flags |= NET_CONTEXT_REMOTE_ADDR_SET;
+		goto conndrop;
+	}
 
-		memcpy(&new_context->remote, &remote_addr,
-		       sizeof(remote_addr));
+	if (entry) {
+		syn_entry_free(entry);
+	}
 
-		ret = net_tcp_register(&new_context->remote,
-			       &local_addr,
-			       ntohs(net_sin(&new_context->remote)->sin_port),
-			       ntohs(net_sin(&local_addr)->sin_port),
-			       tcp_established,
-			       new_context,
-			       &new_context->conn_handler);
-		if (ret < 0) {
-			NET_DBG("Cannot register accepted TCP handler (%d)",
-				ret);
-			net_context_unref(new_context);
-			goto conndrop;
-		}
+	key = irq_lock();
 
-		/* Swap the newly-created TCP states with the one that
-		 * was used to establish this connection. The new TCP
-		 * must be listening to accept other connections.
-		 */
-		tmp_tcp = new_context->tcp;
-		tmp_tcp->accept_cb = tcp->accept_cb;
-		tcp->accept_cb = NULL;
-		new_context->tcp = tcp;
-		copy_pool_vars(new_context, context);
-		context->tcp = tmp_tcp;
+	queued = !tcp->accept_cb;
+	if (queued) {
+		sys_slist_append(&tcp->accept_q,
+				 &new_context->tcp->accept_node);
+		tcp->accept_q_len++;
+	}
 
-		tcp->context = new_context;
-		tmp_tcp->context = context;
+	irq_unlock(key);
 
-		net_tcp_change_state(tmp_tcp, NET_TCP_LISTEN);
+	if (queued) {
+		/* The data is not acknowledged, the peer sends it again */
+		return NET_DROP;
+	}
 
-		net_tcp_change_state(new_context->tcp, NET_TCP_ESTABLISHED);
-		net_context_set_state(new_context, NET_CONTEXT_CONNECTED);
+	tcp->accept_cb(new_context, &new_context->remote,
+		       tcp_remote_len(new_context), 0, context->user_data);
 
-		ack_timer_cancel(tcp);
+	/* The data goes to the new connection, if the application kept
+	 * it and registered for its data when accepting it.
+	 */
+	set_appdata_values(pkt, IPPROTO_TCP);
 
-		context->tcp->accept_cb(new_context,
-					&new_context->remote,
-					addrlen,
-					0,
-					context->user_data);
+	if (net_pkt_appdatalen(pkt) && net_context_is_used(new_context) &&
+	    new_context->recv_cb) {
+		return tcp_established((struct net_conn *)
+				       new_context->conn_handler,
+				       pkt, new_context);
 	}
 
 	return NET_DROP;
@@ -1561,63 +1869,27 @@ conndrop:
 	net_stats_update_tcp_seg_conndrop();
 
 reset:
-	{
-		struct sockaddr peer;
-
-		send_reset(tcp->context, create_sockaddr(pkt, &peer));
-	}
+	/* The RST takes its sequence number from the ACK field */
+	send_reset_reply(context, pkt, &peer, ack);
 
 	return NET_DROP;
 }
 
-#endif /* CONFIG_NET_TCP */
-
-int net_context_accept(struct net_context *context,
-		       net_tcp_accept_cb_t cb,
-		       s32_t timeout,
-		       void *user_data)
+static int tcp_listen(struct net_context *context, int backlog)
 {
-#if defined(CONFIG_NET_TCP)
 	struct sockaddr local_addr;
 	struct sockaddr *laddr = NULL;
 	u16_t lport = 0;
 	int ret;
-#endif /* CONFIG_NET_TCP */
-
-	NET_ASSERT(PART_OF_ARRAY(contexts, context));
-
-	if (!net_context_is_used(context)) {
-		return -EBADF;
-	}
-
-#if defined(CONFIG_NET_OFFLOAD)
-	if (net_if_is_ip_offloaded(net_context_get_iface(context))) {
-		return net_offload_accept(
-			net_context_get_iface(context),
-			context,
-			cb,
-			timeout,
-			user_data);
-	}
-#endif /* CONFIG_NET_OFFLOAD */
-
-	if ((net_context_get_state(context) != NET_CONTEXT_LISTENING) &&
-	    (net_context_get_type(context) != SOCK_STREAM)) {
-		NET_DBG("Invalid socket, state %d type %d",
-			net_context_get_state(context),
-			net_context_get_type(context));
-		return -EINVAL;
-	}
 
-#if defined(CONFIG_NET_TCP)
-	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
-		NET_ASSERT(context->tcp);
+	/* The accept queue is only used until a callback is given to
+	 * net_context_accept(), as connections are then passed to it
+	 * as soon as they are established.
+	 */
+	context->tcp->backlog = backlog > 0 ? min(backlog, UINT8_MAX) : 1;
 
-		if (net_tcp_get_state(context->tcp) != NET_TCP_LISTEN) {
-			NET_DBG("Context %p in wrong state %d, should be %d",
-				context, context->tcp->state, NET_TCP_LISTEN);
-			return -EINVAL;
-		}
+	if (net_tcp_get_state(context->tcp) == NET_TCP_LISTEN) {
+		return 0;
 	}
 
 	local_addr.family = net_context_get_family(context);
@@ -1662,11 +1934,70 @@ int net_context_accept(struct net_context *context,
 		return ret;
 	}
 
+	net_tcp_change_state(context->tcp, NET_TCP_LISTEN);
+	net_context_set_state(context, NET_CONTEXT_LISTENING);
+
+	return 0;
+}
+
+#endif /* CONFIG_NET_TCP */
+
+int net_context_accept(struct net_context *context,
+		       net_tcp_accept_cb_t cb,
+		       s32_t timeout,
+		       void *user_data)
+{
+#if defined(CONFIG_NET_TCP)
+	int key;
+#endif /* CONFIG_NET_TCP */
+
+	NET_ASSERT(PART_OF_ARRAY(contexts, context));
+
+	if (!net_context_is_used(context)) {
+		return -EBADF;
+	}
+
+#if defined(CONFIG_NET_OFFLOAD)
+	if (net_if_is_ip_offloaded(net_context_get_iface(context))) {
+		return net_offload_accept(
+			net_context_get_iface(context),
+			context,
+			cb,
+			timeout,
+			user_data);
+	}
+#endif /* CONFIG_NET_OFFLOAD */
+
+	if ((net_context_get_state(context) != NET_CONTEXT_LISTENING) &&
+	    (net_context_get_type(context) != SOCK_STREAM)) {
+		NET_DBG("Invalid socket, state %d type %d",
+			net_context_get_state(context),
+			net_context_get_type(context));
+		return -EINVAL;
+	}
+
+#if defined(CONFIG_NET_TCP)
+	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
+		NET_ASSERT(context->tcp);
+
+		if (net_tcp_get_state(context->tcp) != NET_TCP_LISTEN) {
+			NET_DBG("Context %p in wrong state %d, should be %d",
+				context, context->tcp->state, NET_TCP_LISTEN);
+			return -EINVAL;
+		}
+	}
+
 	context->user_data = user_data;
 
 	/* accept callback is only valid for TCP contexts */
 	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
+		key = irq_lock();
 		context->tcp->accept_cb = cb;
+		irq_unlock(key);
+
+		if (cb) {
+			tcp_accept_q_drain(context);
+		}
 	}
 #endif /* CONFIG_NET_TCP */
 
@@ -1911,6 +2242,77 @@ int net_context_sendto(struct net_pkt *pkt,
 	return sendto(pkt, dst_addr, addrlen, cb, timeout, token, user_data);
 }
 
+static void release_iov(const struct net_iovec *iov, int iovcnt,
+			net_context_release_cb_t release_cb, void *user_data)
+{
+	int i;
+
+	if (!release_cb) {
+		return;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		release_cb(iov[i].base, iov[i].len, user_data);
+	}
+}
+
+int net_context_sendv(struct net_context *context,
+		      const struct net_iovec *iov,
+		      int iovcnt,
+		      net_context_release_cb_t release_cb,
+		      const struct sockaddr *dst_addr,
+		      socklen_t addrlen,
+		      net_context_send_cb_t cb,
+		      s32_t timeout,
+		      void *token,
+		      void *user_data)
+{
+	struct net_pkt *pkt;
+	int ret, i;
+
+	NET_ASSERT(PART_OF_ARRAY(contexts, context));
+
+	if (!iov || iovcnt <= 0) {
+		return -EINVAL;
+	}
+
+	pkt = net_pkt_get_tx(context, timeout);
+	if (!pkt) {
+		release_iov(iov, iovcnt, release_cb, user_data);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		ret = net_pkt_append_ext(pkt, iov[i].base, iov[i].len,
+					 release_cb, user_data, timeout);
+		if (ret < 0) {
+			/* The entries already attached are released when
+			 * the packet is freed.
+			 */
+			release_iov(&iov[i], iovcnt - i, release_cb, user_data);
+			goto fail;
+		}
+	}
+
+	if (dst_addr) {
+		ret = net_context_sendto(pkt, dst_addr, addrlen, cb, timeout,
+					 token, user_data);
+	} else {
+		ret = net_context_send(pkt, cb, timeout, token, user_data);
+	}
+
+	if (ret < 0) {
+		goto fail;
+	}
+
+	return ret;
+
+fail:
+	net_pkt_unref(pkt);
+
+	return ret;
+}
+
 static void set_appdata_values(struct net_pkt *pkt, enum net_ip_protocol proto)
 {
 	size_t total_len = net_pkt_get_len(pkt);
@@ -2141,5 +2543,9 @@ void net_context_init(void)
 {
 	k_sem_init(&contexts_lock, 0, UINT_MAX);
 
+#if defined(CONFIG_NET_TCP_SYN_COOKIES)
+	syn_cookie_secret = sys_rand32_get();
+#endif
+
 	k_sem_give(&contexts_lock);
 }
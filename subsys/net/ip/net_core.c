@@ -165,6 +165,8 @@ static void net_rx_thread(void)
 
 		pkt = k_fifo_get(&rx_queue, K_FOREVER);
 
+		net_stats_update_latency_queue_stamp(pkt);
+
 		net_analyze_stack("RX thread", rx_stack,
 				  K_THREAD_STACK_SIZEOF(rx_stack));
 
@@ -345,6 +347,10 @@ int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 
 	net_pkt_set_iface(pkt, iface);
 
+	net_stats_update_latency_stamp(pkt);
+
+	net_capture_pkt(iface, pkt, false);
+
 	k_fifo_put(&rx_queue, pkt);
 
 	return 0;
@@ -393,6 +399,8 @@ static int net_init(struct device *unused)
 
 	net_mgmt_event_init();
 
+	net_capture_init();
+
 	init_rx_queue();
 
 #if CONFIG_NET_DHCPV4
@@ -42,9 +42,36 @@ static struct net_if_router routers[CONFIG_NET_MAX_ROUTERS];
  */
 static sys_slist_t link_callbacks;
 
+#if !defined(CONFIG_NET_TX_THREAD_PER_IF)
 NET_STACK_DEFINE(TX, tx_stack, CONFIG_NET_TX_STACK_SIZE,
 		 CONFIG_NET_TX_STACK_SIZE);
 static struct k_thread tx_thread_data;
+#endif
+
+/* Priority to traffic class mapping, indexed by packet priority. The
+ * values are taken from IEEE 802.1Q table 8-5 recommendations.
+ */
+static const u8_t prio2tc_map[NET_MAX_PRIORITIES] = {
+#if NET_TC_TX_COUNT == 1
+	0, 0, 0, 0, 0, 0, 0, 0
+#elif NET_TC_TX_COUNT == 2
+	0, 0, 0, 0, 1, 1, 1, 1
+#elif NET_TC_TX_COUNT == 3
+	0, 0, 0, 0, 1, 1, 2, 2
+#elif NET_TC_TX_COUNT == 4
+	0, 0, 1, 1, 2, 2, 3, 3
+#elif NET_TC_TX_COUNT == 5
+	0, 0, 1, 1, 2, 2, 3, 4
+#elif NET_TC_TX_COUNT == 6
+	1, 0, 2, 2, 3, 3, 4, 5
+#elif NET_TC_TX_COUNT == 7
+	1, 0, 2, 3, 4, 4, 5, 6
+#elif NET_TC_TX_COUNT == 8
+	1, 0, 2, 3, 4, 5, 6, 7
+#else
+#error "Invalid NET_TC_TX_COUNT value"
+#endif
+};
 
 #if defined(CONFIG_NET_DEBUG_IF)
 #define debug_check_packet(pkt)						    \
@@ -81,6 +108,78 @@ static inline void net_context_send_cb(struct net_context *context,
 	}
 }
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+static void net_if_update_tx_latency(struct net_if *iface,
+				     struct net_context *context,
+				     u32_t stamp, u32_t queue_stamp)
+{
+	enum net_ip_protocol proto = 0;
+
+	if (!stamp) {
+		return;
+	}
+
+	if (context) {
+		proto = net_context_get_ip_proto(context);
+	}
+
+	net_stats_update_latency(iface, NET_STATS_LATENCY_TX_QUEUE, proto,
+				 queue_stamp - stamp);
+	net_stats_update_latency(iface, NET_STATS_LATENCY_TX_DRIVER, proto,
+				 k_cycle_get_32() - queue_stamp);
+}
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
+int net_if_tx_priority2tc(enum net_priority prio)
+{
+	if (prio >= NET_MAX_PRIORITIES) {
+		prio = NET_PRIORITY_BE;
+	}
+
+	return prio2tc_map[prio];
+}
+
+void net_if_queue_tx(struct net_if *iface, struct net_pkt *pkt)
+{
+	int tc = net_if_tx_priority2tc(net_pkt_priority(pkt));
+
+	NET_DBG("iface %p pkt %p prio %d tc %d", iface, pkt,
+		net_pkt_priority(pkt), tc);
+
+	k_fifo_put(&iface->tx_queue[tc], pkt);
+}
+
+static inline struct net_pkt *net_if_tx_dequeue(struct net_if *iface)
+{
+	struct net_pkt *pkt;
+	int tc;
+
+	/* Strict priority, the highest traffic class is always served
+	 * first so control traffic never waits behind bulk data.
+	 */
+	for (tc = NET_TC_TX_COUNT - 1; tc >= 0; tc--) {
+		pkt = k_fifo_get(&iface->tx_queue[tc], K_NO_WAIT);
+		if (pkt) {
+			return pkt;
+		}
+	}
+
+	return NULL;
+}
+
+static inline bool net_if_tx_queues_empty(struct net_if *iface)
+{
+	int tc;
+
+	for (tc = 0; tc < NET_TC_TX_COUNT; tc++) {
+		if (!k_fifo_is_empty(&iface->tx_queue[tc])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static bool net_if_tx(struct net_if *iface)
 {
 	const struct net_if_api *api = iface->dev->driver_api;
@@ -92,12 +191,21 @@ static bool net_if_tx(struct net_if *iface)
 #if defined(CONFIG_NET_STATISTICS)
 	size_t pkt_len;
 #endif
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	u32_t stamp, queue_stamp;
+#endif
 
-	pkt = k_fifo_get(&iface->tx_queue, K_NO_WAIT);
+	pkt = net_if_tx_dequeue(iface);
 	if (!pkt) {
 		return false;
 	}
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	/* The driver owns the packet once send() is called */
+	stamp = pkt->stamp;
+	queue_stamp = k_cycle_get_32();
+#endif
+
 	debug_check_packet(pkt);
 
 	dst = net_pkt_ll_dst(pkt);
@@ -108,6 +216,8 @@ static bool net_if_tx(struct net_if *iface)
 #if defined(CONFIG_NET_STATISTICS)
 		pkt_len = net_pkt_get_len(pkt);
 #endif
+		net_capture_pkt(iface, pkt, true);
+
 		status = api->send(iface, pkt);
 	} else {
 		/* Drop packet if interface is not up */
@@ -119,6 +229,10 @@ static bool net_if_tx(struct net_if *iface)
 		net_pkt_unref(pkt);
 	} else {
 		net_stats_update_bytes_sent(pkt_len);
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+		net_if_update_tx_latency(iface, context, stamp, queue_stamp);
+#endif
 	}
 
 	if (context) {
@@ -137,7 +251,7 @@ static bool net_if_tx(struct net_if *iface)
 
 static void net_if_flush_tx(struct net_if *iface)
 {
-	if (k_fifo_is_empty(&iface->tx_queue)) {
+	if (net_if_tx_queues_empty(iface)) {
 		return;
 	}
 
@@ -163,15 +277,12 @@ static void net_if_process_events(struct k_poll_event *event, int ev_count)
 		case K_POLL_STATE_SIGNALED:
 			break;
 		case K_POLL_STATE_FIFO_DATA_AVAILABLE:
-		{
-			struct net_if *iface;
-
-			iface = CONTAINER_OF(event->fifo, struct net_if,
-					     tx_queue);
-			net_if_tx(iface);
-
+			/* The event tag holds the traffic class of the
+			 * queue, which leads back to the interface.
+			 */
+			net_if_tx(CONTAINER_OF(event->fifo - event->tag,
+					       struct net_if, tx_queue));
 			break;
-		}
 		case K_POLL_STATE_NOT_READY:
 			break;
 		default:
@@ -180,22 +291,50 @@ static void net_if_process_events(struct k_poll_event *event, int ev_count)
 	}
 }
 
-static int net_if_prepare_events(void)
+static int net_if_prepare_events(struct net_if *iface,
+				 struct k_poll_event *events)
 {
-	struct net_if *iface;
-	int ev_count = 0;
+	int tc;
 
-	for (iface = __net_if_start; iface != __net_if_end; iface++) {
-		k_poll_event_init(&__net_if_event_start[ev_count],
+	for (tc = 0; tc < NET_TC_TX_COUNT; tc++) {
+		k_poll_event_init(&events[tc],
 				  K_POLL_TYPE_FIFO_DATA_AVAILABLE,
 				  K_POLL_MODE_NOTIFY_ONLY,
-				  &iface->tx_queue);
-		ev_count++;
+				  &iface->tx_queue[tc]);
+		events[tc].tag = tc;
 	}
 
-	return ev_count;
+	return NET_TC_TX_COUNT;
 }
 
+#if defined(CONFIG_NET_TX_THREAD_PER_IF)
+static void net_if_tx_thread(struct net_if *iface)
+{
+	NET_DBG("Starting TX thread for iface %p (stack %zu bytes)",
+		iface, iface->tx_stack_size);
+
+	while (1) {
+		int ev_count;
+
+		ev_count = net_if_prepare_events(iface, iface->tx_events);
+
+		k_poll(iface->tx_events, ev_count, K_FOREVER);
+
+		net_if_process_events(iface->tx_events, ev_count);
+
+		k_yield();
+	}
+}
+
+static void net_if_tx_thread_start(struct net_if *iface)
+{
+	k_thread_create(&iface->tx_thread, iface->tx_stack,
+			iface->tx_stack_size,
+			(k_thread_entry_t)net_if_tx_thread,
+			iface, NULL, NULL, K_PRIO_COOP(7),
+			K_ESSENTIAL, K_NO_WAIT);
+}
+#else
 static void net_if_tx_thread(struct k_sem *startup_sync)
 {
 	NET_DBG("Starting TX thread (stack %d bytes)",
@@ -205,9 +344,13 @@ static void net_if_tx_thread(struct k_sem *startup_sync)
 	k_sem_give(startup_sync);
 
 	while (1) {
-		int ev_count;
+		struct net_if *iface;
+		int ev_count = 0;
 
-		ev_count = net_if_prepare_events();
+		for (iface = __net_if_start; iface != __net_if_end; iface++) {
+			ev_count += net_if_prepare_events(iface,
+					&__net_if_event_start[ev_count]);
+		}
 
 		k_poll(__net_if_event_start, ev_count, K_FOREVER);
 
@@ -216,20 +359,101 @@ static void net_if_tx_thread(struct k_sem *startup_sync)
 		k_yield();
 	}
 }
+#endif /* CONFIG_NET_TX_THREAD_PER_IF */
 
 static inline void init_iface(struct net_if *iface)
 {
 	const struct net_if_api *api = iface->dev->driver_api;
+	int tc;
 
 	NET_ASSERT(api && api->init && api->send);
 
 	NET_DBG("On iface %p", iface);
 
-	k_fifo_init(&iface->tx_queue);
+	for (tc = 0; tc < NET_TC_TX_COUNT; tc++) {
+		k_fifo_init(&iface->tx_queue[tc]);
+	}
 
 	api->init(iface);
+
+#if defined(CONFIG_NET_TX_THREAD_PER_IF)
+	net_if_tx_thread_start(iface);
+#endif
+}
+
+#if NET_TC_TX_COUNT > 1
+/* DSCP class selector (the three topmost DSCP bits) to priority */
+static const u8_t dscp_cs2prio_map[8] = {
+	NET_PRIORITY_BE, NET_PRIORITY_BK, NET_PRIORITY_EE, NET_PRIORITY_CA,
+	NET_PRIORITY_VI, NET_PRIORITY_VO, NET_PRIORITY_IC, NET_PRIORITY_NC
+};
+
+/* Return true if the TCP segment carries no payload, i.e. it is a pure
+ * ACK or a SYN/FIN/RST control segment.
+ */
+static bool tcp_is_control_segment(struct net_pkt *pkt, u16_t ip_len)
+{
+	u16_t hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv6_ext_len(pkt);
+
+	if (pkt->frags->len < hdr_len + sizeof(struct net_tcp_hdr)) {
+		return false;
+	}
+
+	hdr_len += (NET_TCP_HDR(pkt)->offset >> 4) << 2;
+
+	return ip_len <= hdr_len;
 }
 
+/* Select the priority of an outgoing packet that the caller has not
+ * prioritized explicitly. Neighbor discovery, RPL and MLD (all ICMPv6)
+ * are network control, payload-less TCP segments are internetwork
+ * control and everything else follows the DSCP class selector.
+ */
+static void net_if_tx_classify(struct net_pkt *pkt)
+{
+	u8_t tclass, proto;
+	u16_t ip_len;
+
+	if (net_pkt_priority(pkt) != NET_PRIORITY_BE || !pkt->frags) {
+		return;
+	}
+
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(pkt) == AF_INET6) {
+		struct net_ipv6_hdr *hdr = NET_IPV6_HDR(pkt);
+
+		tclass = ((hdr->vtc & 0x0f) << 4) | (hdr->tcflow >> 4);
+		proto = hdr->nexthdr;
+		ip_len = ((hdr->len[0] << 8) | hdr->len[1]) +
+			sizeof(struct net_ipv6_hdr);
+	} else
+#endif
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(pkt) == AF_INET) {
+		struct net_ipv4_hdr *hdr = NET_IPV4_HDR(pkt);
+
+		tclass = hdr->tos;
+		proto = hdr->proto;
+		ip_len = (hdr->len[0] << 8) | hdr->len[1];
+	} else
+#endif
+	{
+		return;
+	}
+
+	if (proto == IPPROTO_ICMPV6) {
+		net_pkt_set_priority(pkt, NET_PRIORITY_NC);
+	} else if (proto == IPPROTO_TCP &&
+		   tcp_is_control_segment(pkt, ip_len)) {
+		net_pkt_set_priority(pkt, NET_PRIORITY_IC);
+	} else {
+		net_pkt_set_priority(pkt, dscp_cs2prio_map[tclass >> 5]);
+	}
+}
+#else
+#define net_if_tx_classify(...)
+#endif /* NET_TC_TX_COUNT > 1 */
+
 enum net_verdict net_if_send_data(struct net_if *iface, struct net_pkt *pkt)
 {
 	struct net_context *context = net_pkt_context(pkt);
@@ -257,6 +481,10 @@ enum net_verdict net_if_send_data(struct net_if *iface, struct net_pkt *pkt)
 		net_pkt_ll_src(pkt)->len = net_pkt_ll_if(pkt)->len;
 	}
 
+	net_if_tx_classify(pkt);
+
+	net_stats_update_latency_stamp(pkt);
+
 #if defined(CONFIG_NET_IPV6)
 	/* If the ll dst address is not set check if it is present in the nbr
 	 * cache.
@@ -1690,11 +1918,16 @@ void net_if_init(struct k_sem *startup_sync)
 		return;
 	}
 
+#if defined(CONFIG_NET_TX_THREAD_PER_IF)
+	/* Every interface got its own TX thread in init_iface() */
+	k_sem_give(startup_sync);
+#else
 	k_thread_create(&tx_thread_data, tx_stack,
 			K_THREAD_STACK_SIZEOF(tx_stack),
 			(k_thread_entry_t)net_if_tx_thread,
 			startup_sync, NULL, NULL, K_PRIO_COOP(7),
 			K_ESSENTIAL, K_NO_WAIT);
+#endif
 }
 
 void net_if_post_init(void)
@@ -37,6 +37,13 @@
 #define NET_BUF_TX_COUNT	CONFIG_NET_BUF_TX_COUNT
 #define NET_BUF_DATA_LEN	CONFIG_NET_BUF_DATA_SIZE
 #define NET_BUF_USER_DATA_LEN	CONFIG_NET_BUF_USER_DATA_SIZE
+#define NET_BUF_EXT_COUNT	CONFIG_NET_BUF_EXT_COUNT
+#define NET_BUF_RX_SMALL_COUNT	CONFIG_NET_BUF_RX_SMALL_COUNT
+#define NET_BUF_TX_SMALL_COUNT	CONFIG_NET_BUF_TX_SMALL_COUNT
+#define NET_BUF_SMALL_DATA_LEN	CONFIG_NET_BUF_SMALL_DATA_SIZE
+#define NET_BUF_RX_LARGE_COUNT	CONFIG_NET_BUF_RX_LARGE_COUNT
+#define NET_BUF_TX_LARGE_COUNT	CONFIG_NET_BUF_TX_LARGE_COUNT
+#define NET_BUF_LARGE_DATA_LEN	CONFIG_NET_BUF_LARGE_DATA_SIZE
 
 #if defined(CONFIG_NET_TCP)
 #define APP_PROTO_LEN NET_TCPH_LEN
@@ -78,6 +85,16 @@
 #error "Too small net_buf fragment size"
 #endif
 
+#if (NET_BUF_RX_SMALL_COUNT > 0 || NET_BUF_TX_SMALL_COUNT > 0) && \
+	NET_BUF_SMALL_DATA_LEN >= NET_BUF_DATA_LEN
+#error "Small net_buf fragments must be smaller than normal ones"
+#endif
+
+#if (NET_BUF_RX_LARGE_COUNT > 0 || NET_BUF_TX_LARGE_COUNT > 0) && \
+	NET_BUF_LARGE_DATA_LEN <= NET_BUF_DATA_LEN
+#error "Large net_buf fragments must be bigger than normal ones"
+#endif
+
 K_MEM_SLAB_DEFINE(rx_pkts, sizeof(struct net_pkt), NET_PKT_RX_COUNT, 4);
 K_MEM_SLAB_DEFINE(tx_pkts, sizeof(struct net_pkt), NET_PKT_TX_COUNT, 4);
 
@@ -88,6 +105,68 @@ NET_BUF_POOL_DEFINE(rx_bufs, NET_BUF_RX_COUNT, NET_BUF_DATA_LEN,
 NET_BUF_POOL_DEFINE(tx_bufs, NET_BUF_TX_COUNT, NET_BUF_DATA_LEN,
 		    NET_BUF_USER_DATA_LEN, NULL);
 
+/* Optional size classes around the normal data fragments. Used by
+ * net_pkt_get_frag_len() when the caller knows how much data it has.
+ */
+#if NET_BUF_RX_SMALL_COUNT > 0
+NET_BUF_POOL_DEFINE(rx_small_bufs, NET_BUF_RX_SMALL_COUNT,
+		    NET_BUF_SMALL_DATA_LEN, NET_BUF_USER_DATA_LEN, NULL);
+#endif
+
+#if NET_BUF_TX_SMALL_COUNT > 0
+NET_BUF_POOL_DEFINE(tx_small_bufs, NET_BUF_TX_SMALL_COUNT,
+		    NET_BUF_SMALL_DATA_LEN, NET_BUF_USER_DATA_LEN, NULL);
+#endif
+
+#if NET_BUF_RX_LARGE_COUNT > 0
+NET_BUF_POOL_DEFINE(rx_large_bufs, NET_BUF_RX_LARGE_COUNT,
+		    NET_BUF_LARGE_DATA_LEN, NET_BUF_USER_DATA_LEN, NULL);
+#endif
+
+#if NET_BUF_TX_LARGE_COUNT > 0
+NET_BUF_POOL_DEFINE(tx_large_bufs, NET_BUF_TX_LARGE_COUNT,
+		    NET_BUF_LARGE_DATA_LEN, NET_BUF_USER_DATA_LEN, NULL);
+#endif
+
+/* Size classes sorted from the smallest to the biggest fragment */
+static struct net_buf_pool * const rx_data_pools[] = {
+#if NET_BUF_RX_SMALL_COUNT > 0
+	&rx_small_bufs,
+#endif
+	&rx_bufs,
+#if NET_BUF_RX_LARGE_COUNT > 0
+	&rx_large_bufs,
+#endif
+};
+
+static struct net_buf_pool * const tx_data_pools[] = {
+#if NET_BUF_TX_SMALL_COUNT > 0
+	&tx_small_bufs,
+#endif
+	&tx_bufs,
+#if NET_BUF_TX_LARGE_COUNT > 0
+	&tx_large_bufs,
+#endif
+};
+
+#if NET_BUF_EXT_COUNT > 0
+/* Bookkeeping of a fragment that refers to application owned data. It is
+ * stored in the user data area of the fragment.
+ */
+struct net_pkt_ext_data {
+	net_context_release_cb_t cb;
+	void *user_data;
+	const void *data;
+	u16_t len;
+};
+
+static void ext_frag_destroy(struct net_buf *frag);
+
+/* The external data pool carries no storage, only the buffer headers. */
+NET_BUF_POOL_DEFINE(ext_bufs, NET_BUF_EXT_COUNT, 0,
+		    sizeof(struct net_pkt_ext_data), ext_frag_destroy);
+#endif /* NET_BUF_EXT_COUNT > 0 */
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 
 #define NET_FRAG_CHECK_IF_NOT_IN_USE(frag, ref)				\
@@ -114,6 +193,9 @@ struct net_pkt_alloc {
 
 #define MAX_NET_PKT_ALLOCS (NET_PKT_RX_COUNT + NET_PKT_TX_COUNT + \
 			    NET_BUF_RX_COUNT + NET_BUF_TX_COUNT + \
+			    NET_BUF_EXT_COUNT + \
+			    NET_BUF_RX_SMALL_COUNT + NET_BUF_TX_SMALL_COUNT + \
+			    NET_BUF_RX_LARGE_COUNT + NET_BUF_TX_LARGE_COUNT + \
 			    CONFIG_NET_DEBUG_NET_PKT_EXTERNALS)
 
 static struct net_pkt_alloc net_pkt_allocs[MAX_NET_PKT_ALLOCS];
@@ -231,6 +313,36 @@ const char *net_pkt_pool2str(struct net_buf_pool *pool)
 		return "TDATA";
 	}
 
+#if NET_BUF_RX_SMALL_COUNT > 0
+	if (pool == &rx_small_bufs) {
+		return "RSDATA";
+	}
+#endif
+
+#if NET_BUF_TX_SMALL_COUNT > 0
+	if (pool == &tx_small_bufs) {
+		return "TSDATA";
+	}
+#endif
+
+#if NET_BUF_RX_LARGE_COUNT > 0
+	if (pool == &rx_large_bufs) {
+		return "RLDATA";
+	}
+#endif
+
+#if NET_BUF_TX_LARGE_COUNT > 0
+	if (pool == &tx_large_bufs) {
+		return "TLDATA";
+	}
+#endif
+
+#if NET_BUF_EXT_COUNT > 0
+	if (pool == &ext_bufs) {
+		return "XDATA";
+	}
+#endif
+
 	return "EDATA";
 }
 
@@ -422,6 +534,84 @@ struct net_buf *net_pkt_get_frag(struct net_pkt *pkt,
 #endif
 }
 
+/* Index of the smallest size class that can hold size bytes, or the
+ * biggest class if none of them can.
+ */
+static int data_pool_fit(struct net_buf_pool * const *pools, int count,
+			 size_t size)
+{
+	int i;
+
+	for (i = 0; i < count - 1; i++) {
+		if (pools[i]->buf_size >= size) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+#if defined(CONFIG_NET_DEBUG_NET_PKT)
+struct net_buf *net_pkt_get_frag_len_debug(struct net_pkt *pkt, u16_t len,
+					   s32_t timeout,
+					   const char *caller, int line)
+#else
+struct net_buf *net_pkt_get_frag_len(struct net_pkt *pkt, u16_t len,
+				     s32_t timeout)
+#endif
+{
+	u16_t reserve = net_pkt_ll_reserve(pkt);
+	struct net_buf_pool * const *pools;
+	struct net_buf *frag;
+	int count, best, i;
+
+#if defined(CONFIG_NET_CONTEXT_NET_PKT_POOL)
+	if (net_pkt_context(pkt) && net_pkt_context(pkt)->data_pool) {
+#if defined(CONFIG_NET_DEBUG_NET_PKT)
+		return net_pkt_get_frag_debug(pkt, timeout, caller, line);
+#else
+		return net_pkt_get_frag(pkt, timeout);
+#endif
+	}
+#endif /* CONFIG_NET_CONTEXT_NET_PKT_POOL */
+
+	if (pkt->slab == &rx_pkts) {
+		pools = rx_data_pools;
+		count = ARRAY_SIZE(rx_data_pools);
+	} else {
+		pools = tx_data_pools;
+		count = ARRAY_SIZE(tx_data_pools);
+	}
+
+	best = data_pool_fit(pools, count, (size_t)reserve + len);
+
+	/* Rather hand out a bigger fragment than wait for the best fitting
+	 * size class to get free fragments.
+	 */
+	if (best < count - 1) {
+		for (i = best; i < count; i++) {
+#if defined(CONFIG_NET_DEBUG_NET_PKT)
+			frag = net_pkt_get_reserve_data_debug(pools[i], reserve,
+							      K_NO_WAIT,
+							      caller, line);
+#else
+			frag = net_pkt_get_reserve_data(pools[i], reserve,
+							K_NO_WAIT);
+#endif
+			if (frag) {
+				return frag;
+			}
+		}
+	}
+
+#if defined(CONFIG_NET_DEBUG_NET_PKT)
+	return net_pkt_get_reserve_data_debug(pools[best], reserve, timeout,
+					      caller, line);
+#else
+	return net_pkt_get_reserve_data(pools[best], reserve, timeout);
+#endif
+}
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 struct net_pkt *net_pkt_get_reserve_rx_debug(u16_t reserve_head,
 					     s32_t timeout,
@@ -1073,7 +1263,12 @@ bool net_pkt_compact(struct net_pkt *pkt)
 	prev = NULL;
 
 	while (frag) {
-		if (frag->frags) {
+		if (frag->frags &&
+		    (frag->frags->flags & NET_BUF_EXTERNAL_DATA)) {
+			/* Application owned data is never copied nor
+			 * moved, so the next fragment is kept as is.
+			 */
+		} else if (frag->frags) {
 			/* Copy amount of data from next fragment to this
 			 * fragment.
 			 */
@@ -1147,7 +1342,7 @@ static inline u16_t net_pkt_append_bytes(struct net_pkt *pkt,
 			return added_len;
 		}
 
-		frag = net_pkt_get_frag(pkt, timeout);
+		frag = net_pkt_get_frag_len(pkt, len, timeout);
 		if (!frag) {
 			return added_len;
 		}
@@ -1169,7 +1364,7 @@ u16_t net_pkt_append(struct net_pkt *pkt, u16_t len, const u8_t *data,
 	}
 
 	if (!pkt->frags) {
-		frag = net_pkt_get_frag(pkt, timeout);
+		frag = net_pkt_get_frag_len(pkt, len, timeout);
 		if (!frag) {
 			return 0;
 		}
@@ -1180,28 +1375,83 @@ u16_t net_pkt_append(struct net_pkt *pkt, u16_t len, const u8_t *data,
 	return net_pkt_append_bytes(pkt, data, len, timeout);
 }
 
-/* Helper routine to retrieve single byte from fragment and move
- * offset. If required byte is last byte in framgent then return
- * next fragment and set offset = 0.
- */
-static inline struct net_buf *net_frag_read_byte(struct net_buf *frag,
-						 u16_t offset,
-						 u16_t *pos,
-						 u8_t *data)
+#if NET_BUF_EXT_COUNT > 0
+static void ext_frag_destroy(struct net_buf *frag)
 {
-	if (data) {
-		*data = frag->data[offset];
+	struct net_pkt_ext_data *ext = net_buf_user_data(frag);
+	net_context_release_cb_t cb = ext->cb;
+	void *user_data = ext->user_data;
+	const void *data = ext->data;
+	u16_t len = ext->len;
+
+	net_buf_destroy(frag);
+
+	if (cb) {
+		cb(data, len, user_data);
 	}
+}
+#endif /* NET_BUF_EXT_COUNT > 0 */
+
+int net_pkt_append_ext(struct net_pkt *pkt, const void *data, u16_t len,
+		       net_context_release_cb_t cb, void *user_data,
+		       s32_t timeout)
+{
+#if NET_BUF_EXT_COUNT > 0
+	struct net_pkt_ext_data *ext;
+	struct net_buf *frag;
 
-	*pos = offset + 1;
+	if (!pkt || !data) {
+		return -EINVAL;
+	}
 
-	if (*pos >= frag->len) {
-		*pos = 0;
+	if (k_is_in_isr()) {
+		timeout = K_NO_WAIT;
+	}
 
-		return frag->frags;
+	frag = net_buf_alloc(&ext_bufs, timeout);
+	if (!frag) {
+		return -ENOMEM;
 	}
 
-	return frag;
+#if defined(CONFIG_NET_DEBUG_NET_PKT)
+	net_pkt_alloc_add(frag, false, __func__, __LINE__);
+
+	NET_DBG("%s [%d] frag %p data %p len %u", pool2str(&ext_bufs),
+		get_frees(&ext_bufs), frag, data, len);
+#endif
+
+	ext = net_buf_user_data(frag);
+	ext->cb = cb;
+	ext->user_data = user_data;
+	ext->data = data;
+	ext->len = len;
+
+	frag->flags |= NET_BUF_EXTERNAL_DATA;
+	frag->data = (u8_t *)data;
+	frag->len = len;
+
+	net_pkt_frag_add(pkt, frag);
+
+	return 0;
+#else
+	/* No external data fragments configured, fall back to copying the
+	 * data. It is not referenced after this so it can be released
+	 * right away.
+	 */
+	if (!pkt || !data) {
+		return -EINVAL;
+	}
+
+	if (!net_pkt_append_all(pkt, len, data, timeout)) {
+		return -ENOMEM;
+	}
+
+	if (cb) {
+		cb(data, len, user_data);
+	}
+
+	return 0;
+#endif /* NET_BUF_EXT_COUNT > 0 */
 }
 
 /* Helper function to adjust offset in net_frag_read() call
@@ -1235,32 +1485,166 @@ static inline struct net_buf *adjust_offset(struct net_buf *frag,
 	return NULL;
 }
 
+/* Move the cursor to the next fragment if the current one has been
+ * consumed, skipping any empty fragments.
+ */
+static inline void cursor_next_frag(struct net_pkt_cursor *cursor)
+{
+	while (cursor->frag && cursor->pos >= cursor->frag->len) {
+		cursor->pos -= cursor->frag->len;
+		cursor->frag = cursor->frag->frags;
+	}
+}
+
+/* Copy len bytes out of (if rdata is set) or into (if wdata is set) the
+ * fragments at cursor, one memcpy() per fragment.
+ */
+static int cursor_copy(struct net_pkt_cursor *cursor, u8_t *rdata,
+		       const u8_t *wdata, u16_t len)
+{
+	struct net_pkt_cursor orig = *cursor;
+	int ret = -ENODATA;
+
+	while (len) {
+		u16_t count;
+
+		if (!cursor->frag) {
+			goto error;
+		}
+
+		count = min(len, cursor->frag->len - cursor->pos);
+
+		if (rdata) {
+			memcpy(rdata, cursor->frag->data + cursor->pos, count);
+			rdata += count;
+		} else if (wdata) {
+			if (cursor->frag->flags & NET_BUF_EXTERNAL_DATA) {
+				ret = -EPERM;
+				goto error;
+			}
+
+			memcpy(cursor->frag->data + cursor->pos, wdata, count);
+			wdata += count;
+		}
+
+		cursor->pos += count;
+		cursor->offset += count;
+		len -= count;
+
+		cursor_next_frag(cursor);
+	}
+
+	return 0;
+
+error:
+	*cursor = orig;
+
+	return ret;
+}
+
+void net_pkt_cursor_init(struct net_pkt_cursor *cursor, struct net_pkt *pkt)
+{
+	cursor->frag = pkt->frags;
+	cursor->pos = 0;
+	cursor->offset = 0;
+
+	cursor_next_frag(cursor);
+}
+
+int net_pkt_cursor_seek(struct net_pkt_cursor *cursor, struct net_pkt *pkt,
+			u16_t offset)
+{
+	struct net_pkt_cursor orig = *cursor;
+
+	if (offset < cursor->offset) {
+		net_pkt_cursor_init(cursor, pkt);
+	}
+
+	/* Whole fragments can be skipped without touching the data */
+	while (cursor->frag &&
+	       cursor->offset + cursor->frag->len - cursor->pos <= offset) {
+		cursor->offset += cursor->frag->len - cursor->pos;
+		cursor->pos = 0;
+		cursor->frag = cursor->frag->frags;
+	}
+
+	if (cursor->offset == offset) {
+		cursor_next_frag(cursor);
+		return 0;
+	}
+
+	if (!cursor->frag) {
+		*cursor = orig;
+		return -ENODATA;
+	}
+
+	cursor->pos += offset - cursor->offset;
+	cursor->offset = offset;
+
+	return 0;
+}
+
+int net_pkt_cursor_read(struct net_pkt_cursor *cursor, void *data,
+			u16_t len)
+{
+	return cursor_copy(cursor, data, NULL, len);
+}
+
+int net_pkt_cursor_read_be16(struct net_pkt_cursor *cursor, u16_t *value)
+{
+	u8_t v16[2];
+	int ret;
+
+	ret = cursor_copy(cursor, v16, NULL, sizeof(v16));
+	if (!ret) {
+		*value = v16[0] << 8 | v16[1];
+	}
+
+	return ret;
+}
+
+int net_pkt_cursor_read_be32(struct net_pkt_cursor *cursor, u32_t *value)
+{
+	u8_t v32[4];
+	int ret;
+
+	ret = cursor_copy(cursor, v32, NULL, sizeof(v32));
+	if (!ret) {
+		*value = v32[0] << 24 | v32[1] << 16 | v32[2] << 8 | v32[3];
+	}
+
+	return ret;
+}
+
+int net_pkt_cursor_write(struct net_pkt_cursor *cursor, const void *data,
+			 u16_t len)
+{
+	return cursor_copy(cursor, NULL, data, len);
+}
+
 struct net_buf *net_frag_read(struct net_buf *frag, u16_t offset,
 			     u16_t *pos, u16_t len, u8_t *data)
 {
-	u16_t copy = 0;
+	struct net_pkt_cursor cursor;
 
 	frag = adjust_offset(frag, offset, pos);
 	if (!frag) {
 		goto error;
 	}
 
-	while (len-- > 0 && frag) {
-		if (data) {
-			frag = net_frag_read_byte(frag, *pos,
-						  pos, data + copy++);
-		} else {
-			frag = net_frag_read_byte(frag, *pos, pos, NULL);
-		}
+	cursor.frag = frag;
+	cursor.pos = *pos;
+	cursor.offset = 0;
 
-		/* Error: Still reamining length to be read, but no data. */
-		if (!frag && len) {
-			NET_ERR("Not enough data to read");
-			goto error;
-		}
+	/* Error: Still remaining length to be read, but no data. */
+	if (cursor_copy(&cursor, data, NULL, len) < 0) {
+		NET_ERR("Not enough data to read");
+		goto error;
 	}
 
-	return frag;
+	*pos = cursor.pos;
+
+	return cursor.frag;
 
 error:
 	*pos = 0xffff;
@@ -1648,6 +2032,23 @@ void net_pkt_get_info(struct k_mem_slab **rx,
 	}
 }
 
+void net_pkt_data_pool_foreach(net_pkt_pool_cb_t cb, void *user_data)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rx_data_pools); i++) {
+		cb(rx_data_pools[i], user_data);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tx_data_pools); i++) {
+		cb(tx_data_pools[i], user_data);
+	}
+
+#if NET_BUF_EXT_COUNT > 0
+	cb(&ext_bufs, user_data);
+#endif
+}
+
 #if defined(CONFIG_NET_DEBUG_NET_PKT)
 void net_pkt_print(void)
 {
@@ -23,6 +23,15 @@ enum net_verdict net_ipv4_process_pkt(struct net_pkt *pkt);
 enum net_verdict net_ipv6_process_pkt(struct net_pkt *pkt);
 extern void net_ipv6_init(void);
 
+#if defined(CONFIG_NET_CAPTURE)
+extern void net_capture_init(void);
+extern void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt,
+			    bool sent);
+#else
+#define net_capture_init(...)
+#define net_capture_pkt(...)
+#endif
+
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_pkt *pkt,
 				 u16_t pkt_len);
@@ -34,6 +43,24 @@ extern char *net_sprint_ll_addr_buf(const u8_t *ll, u8_t ll_len,
 				    char *buf, int buflen);
 extern u16_t net_calc_chksum(struct net_pkt *pkt, u8_t proto);
 
+/**
+ * @brief Update a checksum after part of the checksummed data changed.
+ *
+ * @details Incremental update as described in RFC 1624, so the packet
+ * does not need to be walked again when only a few header bytes are
+ * rewritten. The changed area must start at an even offset from the
+ * start of the checksummed data.
+ *
+ * @param chksum Current checksum field value (network byte order)
+ * @param old_data Data before the change
+ * @param new_data Data after the change
+ * @param len Length of the changed area, must be even
+ *
+ * @return New checksum field value (network byte order)
+ */
+extern u16_t net_calc_chksum_update(u16_t chksum, const u8_t *old_data,
+				    const u8_t *new_data, u16_t len);
+
 #if defined(CONFIG_NET_IPV4)
 extern u16_t net_calc_chksum_ipv4(struct net_pkt *pkt);
 #endif /* CONFIG_NET_IPV4 */
@@ -35,6 +35,10 @@
 #include <net/http.h>
 #endif
 
+#if defined(CONFIG_NET_CAPTURE)
+#include <net/net_capture.h>
+#endif
+
 #include "net_shell.h"
 #include "net_stats.h"
 
@@ -95,7 +99,8 @@ static void iface_cb(struct net_if *iface, void *user_data)
 
 	ARG_UNUSED(user_data);
 
-	printk("Interface %p\n", iface);
+	printk("Interface %p (index %d)\n", iface,
+	       net_if_get_by_iface(iface));
 	printk("====================\n");
 
 	printk("Link addr : %s\n", net_sprint_ll_addr(iface->link_addr.addr,
@@ -340,6 +345,10 @@ static inline void net_shell_print_statistics(void)
 	       GET_STAT(ipv6_nd.recv),
 	       GET_STAT(ipv6_nd.sent),
 	       GET_STAT(ipv6_nd.drop));
+	printk("IPv6 ND nbr lookup %d\tmiss\t%d\tevict\t%d\n",
+	       GET_STAT(ipv6_nd.nbr_lookup),
+	       GET_STAT(ipv6_nd.nbr_miss),
+	       GET_STAT(ipv6_nd.nbr_evict));
 #endif /* CONFIG_NET_IPV6_ND */
 #if defined(CONFIG_NET_STATISTICS_MLD)
 	printk("IPv6 MLD recv  %d\tsent\t%d\tdrop\t%d\n",
@@ -442,6 +451,67 @@ static inline void net_shell_print_statistics(void)
 	printk("Bytes sent     %u\n", GET_STAT(bytes.sent));
 	printk("Processing err %d\n", GET_STAT(processing_error));
 }
+
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+static const char * const latency_stage_str[] = {
+	[NET_STATS_LATENCY_RX_QUEUE] = "RX queue ",
+	[NET_STATS_LATENCY_RX_STACK] = "RX stack ",
+	[NET_STATS_LATENCY_TX_QUEUE] = "TX queue ",
+	[NET_STATS_LATENCY_TX_DRIVER] = "TX driver",
+};
+
+static const char * const latency_proto_str[] = {
+	[NET_STATS_LATENCY_UDP] = "UDP  ",
+	[NET_STATS_LATENCY_TCP] = "TCP  ",
+	[NET_STATS_LATENCY_OTHER] = "other",
+};
+
+static void iface_latency_cb(struct net_if *iface, void *user_data)
+{
+	struct net_stats_latency_hist *hist;
+	bool reset = POINTER_TO_INT(user_data);
+	int stage, proto, i;
+
+	if (reset) {
+		memset(&iface->latency, 0, sizeof(iface->latency));
+		return;
+	}
+
+	printk("\nInterface %p (%s)\n", iface, iface->dev->config->name);
+
+	for (stage = 0; stage < NET_STATS_LATENCY_STAGES; stage++) {
+		for (proto = 0; proto < NET_STATS_LATENCY_PROTOS; proto++) {
+			hist = &iface->latency.hist[stage][proto];
+
+			if (!hist->count) {
+				continue;
+			}
+
+			printk("%s %s count %u\tavg %u\tmax %u\n",
+			       latency_stage_str[stage],
+			       latency_proto_str[proto], hist->count,
+			       (u32_t)(hist->sum / hist->count), hist->max);
+
+			for (i = 0; i < NET_STATS_LATENCY_BUCKETS; i++) {
+				printk(" %u", hist->buckets[i]);
+			}
+
+			printk("\n");
+		}
+	}
+}
+
+static void net_shell_print_latency(bool reset)
+{
+	if (!reset) {
+		printk("Latencies in cycles, bucket 0 counts the ones below "
+		       "%u, each next bucket doubles the limit\n",
+		       1 << CONFIG_NET_STATISTICS_LATENCY_SHIFT);
+	}
+
+	net_if_foreach(iface_latency_cb, INT_TO_POINTER(reset));
+}
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
 #endif /* CONFIG_NET_STATISTICS */
 
 static void get_addresses(struct net_context *context,
@@ -587,8 +657,8 @@ static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
 			 void *user_data)
 {
 	int *count = user_data;
+	struct net_ipv6_frag *entry;
 	char src[ADDR_LEN];
-	int i;
 
 	if (!*count) {
 		printk("\nIPv6 reassembly Id         Remain Src             \tDst\n");
@@ -600,23 +670,25 @@ static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
 	       reass, reass->id, k_delayed_work_remaining_get(&reass->timer),
 	       src, net_sprint_ipv6_addr(&reass->dst));
 
-	for (i = 0; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			struct net_buf *frag = reass->pkt[i]->frags;
+	printk("Received %u of %u bytes\n", reass->received,
+	       reass->last_received ? reass->total_len : 0);
 
-			printk("[%d] pkt %p->", i, reass->pkt[i]);
+	SYS_SLIST_FOR_EACH_CONTAINER(&reass->frags, entry, node) {
+		struct net_buf *frag = entry->pkt->frags;
 
-			while (frag) {
-				printk("%p", frag);
+		printk("[%u-%u] pkt %p->", entry->offset,
+		       entry->offset + entry->len, entry->pkt);
 
-				frag = frag->frags;
-				if (frag) {
-					printk("->");
-				}
-			}
+		while (frag) {
+			printk("%p", frag);
 
-			printk("\n");
+			frag = frag->frags;
+			if (frag) {
+				printk("->");
+			}
 		}
+
+		printk("\n");
 	}
 
 	(*count)++;
@@ -697,6 +769,89 @@ int net_shell_cmd_allocs(int argc, char *argv[])
 	return 0;
 }
 
+#if defined(CONFIG_NET_CAPTURE)
+static int shell_capture_start(int argc, char *argv[])
+{
+	struct net_capture_filter filter;
+	u16_t snaplen = 0;
+	int arg = 2;
+	int ret;
+
+	memset(&filter, 0, sizeof(filter));
+
+	while (argv[arg]) {
+		if (!strcmp(argv[arg], "ipv4")) {
+			filter.family = AF_INET;
+		} else if (!strcmp(argv[arg], "ipv6")) {
+			filter.family = AF_INET6;
+		} else if (!strcmp(argv[arg], "udp")) {
+			filter.proto = IPPROTO_UDP;
+		} else if (!strcmp(argv[arg], "tcp")) {
+			filter.proto = IPPROTO_TCP;
+		} else if (!strcmp(argv[arg], "icmp")) {
+			filter.proto = IPPROTO_ICMP;
+		} else if (!strcmp(argv[arg], "icmpv6")) {
+			filter.proto = IPPROTO_ICMPV6;
+		} else if (argv[arg + 1] && !strcmp(argv[arg], "iface")) {
+			filter.iface = net_if_get_by_index(
+				strtol(argv[++arg], NULL, 10));
+			if (!filter.iface) {
+				printk("Invalid interface index %s\n",
+				       argv[arg]);
+				return 0;
+			}
+		} else if (argv[arg + 1] && !strcmp(argv[arg], "port")) {
+			filter.port = strtol(argv[++arg], NULL, 10);
+		} else if (argv[arg + 1] && !strcmp(argv[arg], "snaplen")) {
+			snaplen = strtol(argv[++arg], NULL, 10);
+		} else {
+			printk("Invalid argument %s\n", argv[arg]);
+			return 0;
+		}
+
+		arg++;
+	}
+
+	ret = net_capture_start(&filter, snaplen);
+	if (ret < 0) {
+		printk("Cannot start capture (%d)\n", ret);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_NET_CAPTURE */
+
+int net_shell_cmd_capture(int argc, char *argv[])
+{
+#if defined(CONFIG_NET_CAPTURE)
+	struct net_capture_stats stats;
+	int arg = 1;
+
+	if (argv[arg] && !strcmp(argv[arg], "start")) {
+		return shell_capture_start(argc, argv);
+	}
+
+	if (argv[arg] && !strcmp(argv[arg], "stop")) {
+		if (net_capture_stop() < 0) {
+			printk("Capture not running\n");
+		}
+	}
+
+	net_capture_get_stats(&stats);
+
+	printk("Capture %s, %u packets captured, %u dropped\n",
+	       net_capture_is_running() ? "running" : "stopped",
+	       stats.captured, stats.dropped);
+#else
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	printk("Enable CONFIG_NET_CAPTURE to capture packets.\n");
+#endif /* CONFIG_NET_CAPTURE */
+
+	return 0;
+}
+
 int net_shell_cmd_conn(int argc, char *argv[])
 {
 	int count = 0;
@@ -794,12 +949,18 @@ static void dns_result_cb(enum dns_resolve_status status,
 		return;
 	}
 
-	if (status == DNS_EAI_FAIL) {
+	if (status == DNS_EAI_FAIL || status == DNS_EAI_NONAME) {
 		printk("No such name found.\n");
 		*first = false;
 		return;
 	}
 
+	if (status == DNS_EAI_NODATA) {
+		printk("No address of this type found.\n");
+		*first = false;
+		return;
+	}
+
 	printk("Unhandled status %d received\n", status);
 }
 
@@ -849,9 +1010,67 @@ static void print_dns_info(struct dns_resolve_context *ctx)
 			       ctx->queries[i].id,
 			       ctx->queries[i].query,
 			       remaining);
+		} else if (ctx->queries[i].query_type ==
+			   DNS_QUERY_TYPE_A_AAAA) {
+			printk("\tIPv4/IPv6[%u]: %s remaining %d\n",
+			       ctx->queries[i].id,
+			       ctx->queries[i].query,
+			       remaining);
 		}
 	}
 }
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+static void dns_cache_cb(const struct dns_cache_info *info, void *user_data)
+{
+	int *count = user_data;
+	int i;
+
+	printk("%-4s %5u s  %s",
+	       info->type == DNS_QUERY_TYPE_A ? "A" : "AAAA",
+	       info->ttl, info->name);
+
+	if (info->status == DNS_EAI_NONAME) {
+		printk("  (no such name)\n");
+	} else if (info->status == DNS_EAI_NODATA) {
+		printk("  (no address)\n");
+	} else {
+		printk("\n");
+	}
+
+	for (i = 0; i < info->count; i++) {
+		if (info->addr[i].family == AF_INET) {
+			printk("\t%s\n", net_sprint_ipv4_addr(
+				       &net_sin(&info->addr[i])->sin_addr));
+		} else {
+			printk("\t%s\n", net_sprint_ipv6_addr(
+				       &net_sin6(&info->addr[i])->sin6_addr));
+		}
+	}
+
+	(*count)++;
+}
+
+static void print_dns_cache(void)
+{
+	struct dns_cache_stats stats;
+	int count = 0;
+
+	printk("Type TTL      Name\n");
+
+	dns_cache_foreach(dns_cache_cb, &count);
+
+	if (!count) {
+		printk("No cached names.\n");
+	}
+
+	dns_cache_get_stats(&stats);
+
+	printk("Hits %u negative hits %u misses %u inserts %u "
+	       "evictions %u\n", stats.hits, stats.negative_hits,
+	       stats.misses, stats.inserts, stats.evictions);
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
 #endif
 
 int net_shell_cmd_dns(int argc, char *argv[])
@@ -904,6 +1123,25 @@ int net_shell_cmd_dns(int argc, char *argv[])
 		return 0;
 	}
 
+	if (strcmp(argv[arg], "cache") == 0) {
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		print_dns_cache();
+#else
+		printk("DNS cache not supported.\n");
+#endif
+		return 0;
+	}
+
+	if (strcmp(argv[arg], "flush") == 0) {
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		dns_cache_flush();
+		printk("DNS cache flushed.\n");
+#else
+		printk("DNS cache not supported.\n");
+#endif
+		return 0;
+	}
+
 	host = argv[arg++];
 
 	if (argv[arg]) {
@@ -917,9 +1155,12 @@ int net_shell_cmd_dns(int argc, char *argv[])
 		} else if (strcmp(type, "AAAA") == 0) {
 			qtype = DNS_QUERY_TYPE_AAAA;
 			printk("IPv6 address type\n");
+		} else if (strcmp(type, "A+AAAA") == 0) {
+			qtype = DNS_QUERY_TYPE_A_AAAA;
+			printk("IPv4 or IPv6 address type\n");
 		} else {
 			printk("Unknown query type, specify either "
-			       "A or AAAA\n");
+			       "A, AAAA or A+AAAA\n");
 			return 0;
 		}
 	}
@@ -1112,15 +1353,32 @@ static void context_info(struct net_context *context, void *user_data)
 #endif /* CONFIG_NET_CONTEXT_NET_PKT_POOL */
 }
 
+/* The utilization of the pools only needs their usage tracking, not
+ * the debugging of the packet allocations.
+ */
+static void data_pool_info(struct net_buf_pool *pool, void *user_data)
+{
+#if defined(CONFIG_NET_BUF_POOL_USAGE)
+	int used = pool->buf_count - pool->avail_count;
+	int peak = pool->buf_count - pool->min_avail_count;
+
+	printk("%-16s\t%d\t%d\t%d\t%d\t%d\t%d%%\n",
+	       pool->name, pool->buf_size, pool->buf_count, used, peak,
+	       pool->pool_size,
+	       pool->buf_count ? peak * 100 / pool->buf_count : 0);
+#else
+	printk("%d\t%d\t%p\n", pool->buf_size, pool->buf_count, pool);
+#endif /* CONFIG_NET_BUF_POOL_USAGE */
+}
+
 int net_shell_cmd_mem(int argc, char *argv[])
 {
 	struct k_mem_slab *rx, *tx;
-	struct net_buf_pool *rx_data, *tx_data;
 
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-	net_pkt_get_info(&rx, &tx, &rx_data, &tx_data);
+	net_pkt_get_info(&rx, &tx, NULL, NULL);
 
 	printk("Fragment length %d bytes\n", CONFIG_NET_BUF_DATA_SIZE);
 
@@ -1136,21 +1394,11 @@ int net_shell_cmd_mem(int argc, char *argv[])
 	printk("TX\t\t%zu\t%d\t%u\t%p\n",
 	       tx->num_blocks * tx->block_size,
 	       tx->num_blocks, k_mem_slab_num_free_get(tx), tx);
-
-	printk("RX DATA (%s)\t%d\t%d\t%d\t%p\n",
-	       rx_data->name, rx_data->pool_size, rx_data->buf_count,
-	       rx_data->avail_count, rx_data);
-
-	printk("TX DATA (%s)\t%d\t%d\t%d\t%p\n",
-	       tx_data->name, tx_data->pool_size, tx_data->buf_count,
-	       tx_data->avail_count, tx_data);
 #else
 	printk("Name    \tCount\tAddress\n");
 
 	printk("RX      \t%d\t%p\n", rx->num_blocks, rx);
 	printk("TX      \t%d\t%p\n", tx->num_blocks, tx);
-	printk("RX DATA \t%d\t%p\n", rx_data->buf_count, rx_data);
-	printk("TX DATA \t%d\t%p\n", tx_data->buf_count, tx_data);
 #endif /* CONFIG_NET_DEBUG_NET_PKT */
 
 	if (IS_ENABLED(CONFIG_NET_CONTEXT_NET_PKT_POOL)) {
@@ -1164,6 +1412,15 @@ int net_shell_cmd_mem(int argc, char *argv[])
 		}
 	}
 
+	printk("\nData fragment pools:\n");
+#if defined(CONFIG_NET_BUF_POOL_USAGE)
+	printk("Name\t\t\tFrag\tCount\tUsed\tPeak\tSize\tPeak%%\n");
+#else
+	printk("Frag\tCount\tAddress\n");
+#endif
+
+	net_pkt_data_pool_foreach(data_pool_info, NULL);
+
 	return 0;
 }
 
@@ -1484,10 +1741,19 @@ int net_shell_cmd_stacks(int argc, char *argv[])
 
 int net_shell_cmd_stats(int argc, char *argv[])
 {
-	ARG_UNUSED(argc);
-	ARG_UNUSED(argv);
-
 #if defined(CONFIG_NET_STATISTICS)
+	int arg = 1;
+
+	if (argv[arg] && !strcmp(argv[arg], "latency")) {
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+		net_shell_print_latency(argv[arg + 1] &&
+					!strcmp(argv[arg + 1], "reset"));
+#else
+		printk("Latency statistics not compiled in.\n");
+#endif
+		return 0;
+	}
+
 	net_shell_print_statistics();
 #else
 	printk("Network statistics not compiled in.\n");
@@ -1778,12 +2044,20 @@ static struct shell_cmd net_commands[] = {
 	/* Keep the commands in alphabetical order */
 	{ "allocs", net_shell_cmd_allocs,
 		"\n\tPrint network memory allocations" },
+	{ "capture", net_shell_cmd_capture,
+		"\n\tShow packet capture status\n"
+		"capture start [iface <index>] [ipv4|ipv6] "
+		"[udp|tcp|icmp|icmpv6] [port <port>] [snaplen <len>]\n"
+		"\tStart capturing packets\n"
+		"capture stop\n\tStop capturing packets" },
 	{ "conn", net_shell_cmd_conn,
 		"\n\tPrint information about network connections" },
 	{ "dns", net_shell_cmd_dns, "\n\tShow how DNS is configure\n"
 		"dns cancel\n\tCancel all pending requests\n"
-		"dns <hostname> [A or AAAA]\n\tQuery IPv4 address (default) or "
-		"IPv6 address for a  host name" },
+		"dns cache\n\tShow cached names and cache statistics\n"
+		"dns flush\n\tRemove all names from the cache\n"
+		"dns <hostname> [A or AAAA or A+AAAA]\n\tQuery IPv4 address "
+		"(default), IPv6 address or both for a  host name" },
 	{ "http", net_shell_cmd_http,
 		"\n\tPrint information about active HTTP connections\n"
 		"http monitor\n\tStart monitoring HTTP connections\n"
@@ -1798,7 +2072,9 @@ static struct shell_cmd net_commands[] = {
 	{ "route", net_shell_cmd_route, "\n\tShow network route" },
 	{ "stacks", net_shell_cmd_stacks,
 		"\n\tShow network stacks information" },
-	{ "stats", net_shell_cmd_stats, "\n\tShow network statistics" },
+	{ "stats", net_shell_cmd_stats, "\n\tShow network statistics\n"
+		"stats latency\n\tShow packet latency histograms\n"
+		"stats latency reset\n\tClear packet latency histograms" },
 	{ "tcp", net_shell_cmd_tcp, "connect <ip> port\n\tConnect to TCP peer\n"
 		"tcp send <data>\n\tSend data to peer using TCP\n"
 		"tcp close\n\tClose TCP connection" },
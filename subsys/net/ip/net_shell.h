@@ -20,6 +20,7 @@ void net_shell_init(void);
 #endif /* CONFIG_NET_SHELL */
 
 int net_shell_cmd_allocs(int argc, char *argv[]);
+int net_shell_cmd_capture(int argc, char *argv[]);
 int net_shell_cmd_conn(int argc, char *argv[]);
 int net_shell_cmd_dns(int argc, char *argv[]);
 int net_shell_cmd_iface(int argc, char *argv[]);
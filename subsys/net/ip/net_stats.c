@@ -14,6 +14,7 @@
 #include <string.h>
 #include <errno.h>
 #include <net/net_core.h>
+#include <net/net_if.h>
 
 #include "net_stats.h"
 
@@ -43,6 +44,10 @@ static inline void stats(void)
 			 GET_STAT(ipv6_nd.recv),
 			 GET_STAT(ipv6_nd.sent),
 			 GET_STAT(ipv6_nd.drop));
+		NET_INFO("IPv6 ND nbr lookup %d\tmiss\t%d\tevict\t%d",
+			 GET_STAT(ipv6_nd.nbr_lookup),
+			 GET_STAT(ipv6_nd.nbr_miss),
+			 GET_STAT(ipv6_nd.nbr_evict));
 #endif /* CONFIG_NET_STATISTICS_IPV6_ND */
 #if defined(CONFIG_NET_STATISTICS_MLD)
 		NET_INFO("IPv6 MLD recv  %d\tsent\t%d\tdrop\t%d",
@@ -166,6 +171,44 @@ void net_print_statistics(void)
 
 #endif /* CONFIG_NET_STATISTICS_PERIODIC_OUTPUT */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+
+void net_stats_update_latency(struct net_if *iface,
+			      enum net_stats_latency_stage stage,
+			      enum net_ip_protocol proto,
+			      u32_t cycles)
+{
+	struct net_stats_latency_hist *hist;
+	int bucket;
+
+	switch (proto) {
+	case IPPROTO_UDP:
+		hist = &iface->latency.hist[stage][NET_STATS_LATENCY_UDP];
+		break;
+	case IPPROTO_TCP:
+		hist = &iface->latency.hist[stage][NET_STATS_LATENCY_TCP];
+		break;
+	default:
+		hist = &iface->latency.hist[stage][NET_STATS_LATENCY_OTHER];
+		break;
+	}
+
+	bucket = find_msb_set(cycles >> CONFIG_NET_STATISTICS_LATENCY_SHIFT);
+	if (bucket >= NET_STATS_LATENCY_BUCKETS) {
+		bucket = NET_STATS_LATENCY_BUCKETS - 1;
+	}
+
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->sum += cycles;
+
+	if (cycles > hist->max) {
+		hist->max = cycles;
+	}
+}
+
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #if defined(CONFIG_NET_STATISTICS_USER_API)
 
 static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
@@ -174,8 +217,6 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 	size_t len_chk = 0;
 	void *src = NULL;
 
-	ARG_UNUSED(iface);
-
 	switch (NET_MGMT_GET_COMMAND(mgmt_request)) {
 	case NET_REQUEST_STATS_CMD_GET_ALL:
 		len_chk = sizeof(struct net_stats);
@@ -234,6 +275,16 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		len_chk = sizeof(struct net_stats_rpl);
 		src = &net_stats.rpl;
 		break;
+#endif
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+	case NET_REQUEST_STATS_CMD_GET_LATENCY:
+		if (!iface) {
+			return -ENOENT;
+		}
+
+		len_chk = sizeof(struct net_stats_latency);
+		src = &iface->latency;
+		break;
 #endif
 	}
 
@@ -241,7 +292,7 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		return -EINVAL;
 	}
 
-	memcpy(src, data, len);
+	memcpy(data, src, len);
 
 	return 0;
 }
@@ -293,4 +344,9 @@ NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_RPL,
 				  net_stats_get);
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_LATENCY,
+				  net_stats_get);
+#endif
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
@@ -90,10 +90,26 @@ static inline void net_stats_update_ipv6_nd_drop(void)
 {
 	net_stats.ipv6_nd.drop++;
 }
+
+static inline void net_stats_update_ipv6_nd_nbr_lookup(bool found)
+{
+	net_stats.ipv6_nd.nbr_lookup++;
+
+	if (!found) {
+		net_stats.ipv6_nd.nbr_miss++;
+	}
+}
+
+static inline void net_stats_update_ipv6_nd_nbr_evict(void)
+{
+	net_stats.ipv6_nd.nbr_evict++;
+}
 #else
 #define net_stats_update_ipv6_nd_sent()
 #define net_stats_update_ipv6_nd_recv()
 #define net_stats_update_ipv6_nd_drop()
+#define net_stats_update_ipv6_nd_nbr_lookup(...)
+#define net_stats_update_ipv6_nd_nbr_evict()
 #endif /* CONFIG_NET_STATISTICS_IPV6_ND */
 
 #if defined(CONFIG_NET_STATISTICS_IPV4)
@@ -390,6 +406,55 @@ static inline void net_stats_update_ipv6_mld_drop(void)
 #define net_stats_update_ipv6_mld_drop()
 #endif /* CONFIG_NET_STATISTICS_MLD */
 
+#if defined(CONFIG_NET_STATISTICS_LATENCY)
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+
+void net_stats_update_latency(struct net_if *iface,
+			      enum net_stats_latency_stage stage,
+			      enum net_ip_protocol proto,
+			      u32_t cycles);
+
+/* Called when the packet enters the RX or the TX path */
+static inline void net_stats_update_latency_stamp(struct net_pkt *pkt)
+{
+	pkt->stamp = k_cycle_get_32();
+	pkt->queue_stamp = 0;
+}
+
+/* Called when the RX thread takes the packet out of its queue */
+static inline void net_stats_update_latency_queue_stamp(struct net_pkt *pkt)
+{
+	pkt->queue_stamp = k_cycle_get_32();
+}
+
+/* Called when the packet is passed to its UDP or TCP handler */
+static inline void net_stats_update_latency_rx(struct net_pkt *pkt,
+					       enum net_ip_protocol proto)
+{
+	u32_t now = k_cycle_get_32();
+
+	/* Looped back packets never went through the RX queue */
+	if (!pkt->stamp || !pkt->queue_stamp) {
+		return;
+	}
+
+	net_stats_update_latency(net_pkt_iface(pkt),
+				 NET_STATS_LATENCY_RX_QUEUE, proto,
+				 pkt->queue_stamp - pkt->stamp);
+	net_stats_update_latency(net_pkt_iface(pkt),
+				 NET_STATS_LATENCY_RX_STACK, proto,
+				 now - pkt->queue_stamp);
+
+	pkt->stamp = 0;
+}
+#else
+#define net_stats_update_latency(...)
+#define net_stats_update_latency_stamp(...)
+#define net_stats_update_latency_queue_stamp(...)
+#define net_stats_update_latency_rx(...)
+#endif /* CONFIG_NET_STATISTICS_LATENCY */
+
 #if defined(CONFIG_NET_STATISTICS_PERIODIC_OUTPUT)
 /* A simple periodic statistic printer, used only in net core */
 void net_print_statistics(void);
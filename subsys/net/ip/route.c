@@ -39,7 +39,226 @@
 /* We keep track of the routes in a separate list so that we can remove
  * the oldest routes (at tail) if needed.
  */
-static sys_slist_t routes;
+static sys_dlist_t routes = SYS_DLIST_STATIC_INIT(&routes);
+
+/* Routes are looked up with a path compressed binary trie. Each node
+ * stores a prefix and the routes that have exactly that prefix. A node
+ * without routes is only kept as a branching point for its two children,
+ * so there are at most two nodes per route.
+ */
+struct net_route_trie_node {
+	struct net_route_trie_node *parent;
+	struct net_route_trie_node *child[2];
+	sys_slist_t entries;
+	struct in6_addr prefix;
+	u8_t prefix_len;
+};
+
+#if defined(CONFIG_NET_ROUTE_MCAST)
+#define MAX_TRIE_NODES (2 * (CONFIG_NET_MAX_ROUTES + \
+			     CONFIG_NET_MAX_MCAST_ROUTES))
+#else
+#define MAX_TRIE_NODES (2 * CONFIG_NET_MAX_ROUTES)
+#endif
+
+static struct net_route_trie_node trie_nodes[MAX_TRIE_NODES];
+
+/* Free nodes are chained through child[0] */
+static struct net_route_trie_node *trie_free;
+
+static struct net_route_trie_node *route_trie;
+
+/* Result of the last lookup. Packets of a flow tend to come in bursts so
+ * this saves the trie walk for most of them.
+ */
+static struct {
+	struct net_if *iface;
+	struct net_route_entry *route;
+	struct in6_addr dst;
+} route_cache;
+
+static inline int addr_bit(const struct in6_addr *addr, u8_t bit)
+{
+	return (addr->s6_addr[bit / 8] >> (7 - (bit % 8))) & 0x01;
+}
+
+/* Return how many leading bits of the two addresses are the same, at most
+ * max. The first from bits are known to be the same already.
+ */
+static u8_t common_prefix_len(const struct in6_addr *a,
+			      const struct in6_addr *b,
+			      u8_t from, u8_t max)
+{
+	u8_t len;
+	int i;
+
+	for (i = from / 8, len = i * 8; len < max; i++, len += 8) {
+		u8_t diff = a->s6_addr[i] ^ b->s6_addr[i];
+
+		if (diff) {
+			len += __builtin_clz(diff) - 24;
+			break;
+		}
+	}
+
+	return min(len, max);
+}
+
+static struct net_route_trie_node *trie_node_alloc(const struct in6_addr *addr,
+						   u8_t prefix_len)
+{
+	struct net_route_trie_node *node = trie_free;
+	int i;
+
+	if (!node) {
+		return NULL;
+	}
+
+	trie_free = node->child[0];
+
+	memset(node, 0, sizeof(*node));
+	sys_slist_init(&node->entries);
+
+	/* Only the prefix bits are stored, the rest stay zero */
+	for (i = 0; i < prefix_len / 8; i++) {
+		node->prefix.s6_addr[i] = addr->s6_addr[i];
+	}
+
+	if (prefix_len % 8) {
+		node->prefix.s6_addr[i] = addr->s6_addr[i] &
+			(0xff << (8 - prefix_len % 8));
+	}
+
+	node->prefix_len = prefix_len;
+
+	return node;
+}
+
+static inline void trie_node_free(struct net_route_trie_node *node)
+{
+	node->child[0] = trie_free;
+	trie_free = node;
+}
+
+/* Find the node of the given prefix, or create it */
+static struct net_route_trie_node *trie_insert(struct net_route_trie_node **root,
+					       const struct in6_addr *addr,
+					       u8_t prefix_len)
+{
+	struct net_route_trie_node **link = root;
+	struct net_route_trie_node *parent = NULL;
+	struct net_route_trie_node *node, *new, *glue;
+	u8_t common;
+
+	while (*link) {
+		node = *link;
+
+		common = common_prefix_len(addr, &node->prefix,
+					   parent ? parent->prefix_len : 0,
+					   min(prefix_len, node->prefix_len));
+		if (common == node->prefix_len) {
+			if (prefix_len == node->prefix_len) {
+				return node;
+			}
+
+			parent = node;
+			link = &node->child[addr_bit(addr, node->prefix_len)];
+			continue;
+		}
+
+		new = trie_node_alloc(addr, prefix_len);
+		if (!new) {
+			return NULL;
+		}
+
+		if (common == prefix_len) {
+			/* The new prefix covers the existing node */
+			new->child[addr_bit(&node->prefix, prefix_len)] = node;
+			new->parent = parent;
+			node->parent = new;
+			*link = new;
+
+			return new;
+		}
+
+		/* The prefixes diverge, branch at the first different bit */
+		glue = trie_node_alloc(addr, common);
+		if (!glue) {
+			trie_node_free(new);
+			return NULL;
+		}
+
+		glue->child[addr_bit(addr, common)] = new;
+		glue->child[addr_bit(&node->prefix, common)] = node;
+		glue->parent = parent;
+		new->parent = glue;
+		node->parent = glue;
+		*link = glue;
+
+		return new;
+	}
+
+	new = trie_node_alloc(addr, prefix_len);
+	if (new) {
+		new->parent = parent;
+		*link = new;
+	}
+
+	return new;
+}
+
+/* Find the node of exactly the given prefix */
+static struct net_route_trie_node *trie_find(struct net_route_trie_node *node,
+					     const struct in6_addr *addr,
+					     u8_t prefix_len)
+{
+	u8_t checked = 0;
+
+	while (node && node->prefix_len <= prefix_len) {
+		if (common_prefix_len(addr, &node->prefix, checked,
+				      node->prefix_len) != node->prefix_len) {
+			return NULL;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			return node;
+		}
+
+		checked = node->prefix_len;
+		node = node->child[addr_bit(addr, node->prefix_len)];
+	}
+
+	return NULL;
+}
+
+/* Drop the node, and then its parents, as long as they have no routes
+ * and are not needed for branching.
+ */
+static void trie_prune(struct net_route_trie_node **root,
+		       struct net_route_trie_node *node)
+{
+	while (node && sys_slist_is_empty(&node->entries) &&
+	       !(node->child[0] && node->child[1])) {
+		struct net_route_trie_node *parent = node->parent;
+		struct net_route_trie_node *child;
+
+		child = node->child[0] ? node->child[0] : node->child[1];
+
+		if (!parent) {
+			*root = child;
+		} else {
+			parent->child[parent->child[1] == node] = child;
+		}
+
+		if (child) {
+			child->parent = parent;
+		}
+
+		trie_node_free(node);
+
+		node = parent;
+	}
+}
 
 static void net_route_nexthop_remove(struct net_nbr *nbr)
 {
@@ -256,39 +475,76 @@ static int nbr_nexthop_put(struct net_nbr *nbr)
 /* Route was accessed, so place it in front of the routes list */
 static inline void update_route_access(struct net_route_entry *route)
 {
-	sys_slist_find_and_remove(&routes, &route->node);
-	sys_slist_prepend(&routes, &route->node);
+	sys_dlist_remove(&route->node);
+	sys_dlist_prepend(&routes, &route->node);
+}
+
+static struct net_route_entry *route_find(struct net_if *iface,
+					  struct in6_addr *addr,
+					  u8_t prefix_len)
+{
+	struct net_route_trie_node *node;
+	struct net_route_entry *route;
+
+	node = trie_find(route_trie, addr, prefix_len);
+	if (!node) {
+		return NULL;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&node->entries, route, prefix_node) {
+		if (route->iface == iface) {
+			return route;
+		}
+	}
+
+	return NULL;
 }
 
 struct net_route_entry *net_route_lookup(struct net_if *iface,
 					 struct in6_addr *dst)
 {
+	struct net_route_trie_node *node = route_trie;
 	struct net_route_entry *route, *found = NULL;
-	u8_t longest_match = 0;
-	int i;
+	u8_t checked = 0;
 
-	for (i = 0; i < CONFIG_NET_MAX_ROUTES && longest_match < 128; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	if (route_cache.route && route_cache.iface == iface &&
+	    net_ipv6_addr_cmp(&route_cache.dst, dst)) {
+		found = route_cache.route;
+		goto out;
+	}
 
-		if (!nbr->ref) {
-			continue;
+	/* Walk down the trie, the last matching node with a route for the
+	 * interface has the longest prefix.
+	 */
+	while (node) {
+		if (common_prefix_len(dst, &node->prefix, checked,
+				      node->prefix_len) != node->prefix_len) {
+			break;
 		}
 
-		if (iface && nbr->iface != iface) {
-			continue;
+		SYS_SLIST_FOR_EACH_CONTAINER(&node->entries, route,
+					     prefix_node) {
+			if (!iface || route->iface == iface) {
+				found = route;
+				break;
+			}
 		}
 
-		route = net_route_data(nbr);
-
-		if (route->prefix_len >= longest_match &&
-		    net_is_ipv6_prefix((u8_t *)dst,
-				       (u8_t *)&route->addr,
-				       route->prefix_len)) {
-			found = route;
-			longest_match = route->prefix_len;
+		if (node->prefix_len == 128) {
+			break;
 		}
+
+		checked = node->prefix_len;
+		node = node->child[addr_bit(dst, node->prefix_len)];
+	}
+
+	if (found) {
+		route_cache.iface = iface;
+		route_cache.route = found;
+		net_ipaddr_copy(&route_cache.dst, dst);
 	}
 
+out:
 	if (found) {
 		net_route_info("Found", found, dst);
 
@@ -331,7 +587,7 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	NET_DBG("Nexthop %s lladdr is %s", net_sprint_ipv6_addr(nexthop),
 		net_sprint_ll_addr(nexthop_lladdr->addr, nexthop_lladdr->len));
 
-	route = net_route_lookup(iface, addr);
+	route = route_find(iface, addr, prefix_len);
 	if (route) {
 		/* Update nexthop if not the same */
 		struct in6_addr *nexthop_addr;
@@ -351,9 +607,7 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	nbr = nbr_new(iface, addr, prefix_len);
 	if (!nbr) {
 		/* Remove the oldest route and try again */
-		sys_snode_t *last = sys_slist_peek_tail(&routes);
-
-		sys_slist_find_and_remove(&routes, last);
+		sys_dnode_t *last = sys_dlist_peek_tail(&routes);
 
 		route = CONTAINER_OF(last,
 				     struct net_route_entry,
@@ -390,15 +644,28 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	tmp = get_nexthop_route();
 	if (!tmp) {
 		NET_ERR("No nexthop route available!");
+		nbr_free(nbr);
 		return NULL;
 	}
 
-	nexthop_route = net_nexthop_data(tmp);
-
 	route = net_route_data(nbr);
 	route->iface = iface;
 
-	sys_slist_prepend(&routes, &route->node);
+	route->trie = trie_insert(&route_trie, addr, prefix_len);
+	if (!route->trie) {
+		NET_ERR("No route trie node available!");
+		net_nbr_unref(tmp);
+		nbr_free(nbr);
+		return NULL;
+	}
+
+	nexthop_route = net_nexthop_data(tmp);
+
+	sys_slist_prepend(&route->trie->entries, &route->prefix_node);
+
+	route_cache.route = NULL;
+
+	sys_dlist_prepend(&routes, &route->node);
 
 	tmp = nbr_nexthop_get(iface, nexthop);
 
@@ -425,13 +692,19 @@ int net_route_del(struct net_route_entry *route)
 		return -EINVAL;
 	}
 
-	sys_slist_find_and_remove(&routes, &route->node);
-
 	nbr = net_route_get_nbr(route);
 	if (!nbr) {
 		return -ENOENT;
 	}
 
+	sys_dlist_remove(&route->node);
+
+	sys_slist_find_and_remove(&route->trie->entries, &route->prefix_node);
+	trie_prune(&route_trie, route->trie);
+	route->trie = NULL;
+
+	route_cache.route = NULL;
+
 	net_route_info("Deleted", route, &route->addr);
 
 	net_mgmt_event_notify(NET_EVENT_IPV6_ROUTE_DEL, nbr->iface);
@@ -596,6 +869,12 @@ int net_route_foreach(net_route_cb_t cb, void *user_data)
 static
 struct net_route_entry_mcast route_mcast_entries[CONFIG_NET_MAX_MCAST_ROUTES];
 
+/* Multicast routes are found from their own trie, using the whole group
+ * address as the prefix.
+ */
+static struct net_route_trie_node *mcast_trie;
+static struct net_route_entry_mcast *mcast_cache;
+
 int net_route_mcast_foreach(net_route_mcast_cb_t cb,
 			    struct in6_addr *skip,
 			    void *user_data)
@@ -622,12 +901,32 @@ int net_route_mcast_foreach(net_route_mcast_cb_t cb,
 struct net_route_entry_mcast *net_route_mcast_add(struct net_if *iface,
 						  struct in6_addr *group)
 {
+	struct net_route_entry_mcast *route;
+	struct net_route_trie_node *node;
 	int i;
 
+	node = trie_find(mcast_trie, group, 128);
+	if (node) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&node->entries, route,
+					     prefix_node) {
+			if (route->iface == iface) {
+				return route;
+			}
+		}
+	}
+
 	for (i = 0; i < CONFIG_NET_MAX_MCAST_ROUTES; i++) {
-		struct net_route_entry_mcast *route = &route_mcast_entries[i];
+		route = &route_mcast_entries[i];
 
 		if (!route->is_used) {
+			route->trie = trie_insert(&mcast_trie, group, 128);
+			if (!route->trie) {
+				return NULL;
+			}
+
+			sys_slist_prepend(&route->trie->entries,
+					  &route->prefix_node);
+
 			net_ipaddr_copy(&route->group, group);
 
 			route->iface = iface;
@@ -653,25 +952,36 @@ bool net_route_mcast_del(struct net_route_entry_mcast *route)
 
 	route->is_used = false;
 
+	if (route->trie) {
+		sys_slist_find_and_remove(&route->trie->entries,
+					  &route->prefix_node);
+		trie_prune(&mcast_trie, route->trie);
+		route->trie = NULL;
+	}
+
+	mcast_cache = NULL;
+
 	return true;
 }
 
 struct net_route_entry_mcast *
 net_route_mcast_lookup(struct in6_addr *group)
 {
-	int i;
+	struct net_route_trie_node *node;
 
-	for (i = 0; i < CONFIG_NET_MAX_MCAST_ROUTES; i++) {
-		struct net_route_entry_mcast *route = &route_mcast_entries[i];
+	if (mcast_cache && net_ipv6_addr_cmp(group, &mcast_cache->group)) {
+		return mcast_cache;
+	}
 
-		if (!route->is_used) {
-			if (net_ipv6_addr_cmp(group, &route->group)) {
-				return route;
-			}
-		}
+	node = trie_find(mcast_trie, group, 128);
+	if (!node) {
+		return NULL;
 	}
 
-	return NULL;
+	mcast_cache = CONTAINER_OF(sys_slist_peek_head(&node->entries),
+				   struct net_route_entry_mcast, prefix_node);
+
+	return mcast_cache;
 }
 #endif /* CONFIG_NET_ROUTE_MCAST */
 
@@ -761,6 +1071,12 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
 
 void net_route_init(void)
 {
+	int i;
+
+	for (i = 0; i < MAX_TRIE_NODES; i++) {
+		trie_node_free(&trie_nodes[i]);
+	}
+
 	NET_DBG("Allocated %d routing entries (%zu bytes)",
 		CONFIG_NET_MAX_ROUTES, sizeof(net_route_entries_pool));
 
@@ -15,6 +15,7 @@
 
 #include <kernel.h>
 #include <misc/slist.h>
+#include <misc/dlist.h>
 
 #include <net/net_ip.h>
 
@@ -39,6 +40,9 @@ struct net_route_nexthop {
 	struct net_nbr *nbr;
 };
 
+/* Node of the longest prefix match lookup trie, see route.c */
+struct net_route_trie_node;
+
 /**
  * @brief Route entry to a specific neighbor.
  */
@@ -48,7 +52,13 @@ struct net_route_entry {
 	 * we can remove it if we run out of available routes.
 	 * The oldest one is the last entry in the list.
 	 */
-	sys_snode_t node;
+	sys_dnode_t node;
+
+	/** Node in the list of routes that have the same prefix. */
+	sys_snode_t prefix_node;
+
+	/** Lookup trie node that holds the prefix of this route. */
+	struct net_route_trie_node *trie;
 
 	/** List of neighbors that the routes go through. */
 	sys_slist_t nexthop;
@@ -168,6 +178,12 @@ void net_route_init(void);
  * @brief Multicast route entry.
  */
 struct net_route_entry_mcast {
+	/** Node in the list of routes that have the same group. */
+	sys_snode_t prefix_node;
+
+	/** Lookup trie node that holds the group of this route. */
+	struct net_route_trie_node *trie;
+
 	/** Network interface for the route. */
 	struct net_if *iface;
 
@@ -207,7 +223,8 @@ int net_route_mcast_foreach(net_route_mcast_cb_t cb,
  * @param iface Network interface to use.
  * @param group IPv6 multicast address.
  *
- * @return Multicast routing entry.
+ * @return Multicast routing entry. If there already is an entry for this
+ * group and interface, it is returned instead of creating a new one.
  */
 struct net_route_entry_mcast *net_route_mcast_add(struct net_if *iface,
 						  struct in6_addr *group);
@@ -2134,9 +2134,10 @@ static void send_mcast_dao_cb(struct net_route_entry_mcast *route,
 			      void *user_data)
 {
 	struct net_rpl_instance *instance = user_data;
+	struct net_if *iface = instance->iface;
 
 	/* Don't send if it's also our own address, done that already */
-	if (!net_route_mcast_lookup(&route->group)) {
+	if (!net_if_ipv6_maddr_lookup(&route->group, &iface)) {
 		net_rpl_dao_send(instance->iface,
 				 instance->current_dag->preferred_parent,
 				 &route->group,
@@ -631,6 +631,26 @@ int net_tcp_prepare_reset(struct net_tcp *tcp,
 	return 0;
 }
 
+int net_tcp_prepare_reset_reply(struct net_tcp *tcp,
+				struct sockaddr_ptr *local,
+				const struct sockaddr *remote,
+				u32_t seq, struct net_pkt **pkt)
+{
+	struct tcp_segment segment = { 0 };
+
+	segment.seq = seq;
+	segment.flags = NET_TCP_RST;
+	segment.src_addr = local;
+	segment.dst_addr = remote;
+
+	*pkt = prepare_segment(tcp, &segment, NULL);
+	if (!*pkt) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 const char * const net_tcp_state_str(enum net_tcp_state state)
 {
 #if defined(CONFIG_NET_DEBUG_TCP)
@@ -702,6 +722,14 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 {
 	struct net_context *ctx = net_pkt_context(pkt);
 	struct net_tcp_hdr *tcphdr = NET_TCP_HDR(pkt);
+	u8_t old_hdr[sizeof(tcphdr->ack) + sizeof(tcphdr->offset) +
+		     sizeof(tcphdr->flags)];
+
+	/* Remember the ACK, offset and flags fields so that the checksum
+	 * can be updated incrementally instead of recalculating it over
+	 * the whole segment.
+	 */
+	memcpy(old_hdr, tcphdr->ack, sizeof(old_hdr));
 
 	sys_put_be32(ctx->tcp->send_ack, tcphdr->ack);
 
@@ -720,6 +748,12 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 
 	ctx->tcp->sent_ack = ctx->tcp->send_ack;
 
+	if (memcmp(old_hdr, tcphdr->ack, sizeof(old_hdr))) {
+		tcphdr->chksum = net_calc_chksum_update(tcphdr->chksum,
+							old_hdr, tcphdr->ack,
+							sizeof(old_hdr));
+	}
+
 	net_pkt_set_sent(pkt, true);
 
 	/* We must have special handling for some network technologies that
@@ -905,7 +939,8 @@ static void validate_state_transition(enum net_tcp_state current,
 {
 	static const u16_t valid_transitions[] = {
 		[NET_TCP_CLOSED] = 1 << NET_TCP_LISTEN |
-			1 << NET_TCP_SYN_SENT,
+			1 << NET_TCP_SYN_SENT |
+			1 << NET_TCP_SYN_RCVD,
 		[NET_TCP_LISTEN] = 1 << NET_TCP_SYN_RCVD |
 			1 << NET_TCP_SYN_SENT,
 		[NET_TCP_SYN_RCVD] = 1 << NET_TCP_FIN_WAIT_1 |
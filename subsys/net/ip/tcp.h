@@ -145,6 +145,20 @@ struct net_tcp {
 	 */
 	net_tcp_accept_cb_t accept_cb;
 
+	/** Established connections that have not been passed to accept_cb
+	 * yet, only used by a listening context.
+	 */
+	sys_slist_t accept_q;
+
+	/** Node in the accept_q of the listening context */
+	sys_snode_t accept_node;
+
+	/** Max length of accept_q, set by net_context_listen() */
+	u8_t backlog;
+
+	/** Current length of accept_q */
+	u8_t accept_q_len;
+
 	/**
 	 * Semaphore to signal TCP connection completion
 	 */
@@ -271,6 +285,24 @@ int net_tcp_prepare_ack(struct net_tcp *tcp, const struct sockaddr *remote,
 int net_tcp_prepare_reset(struct net_tcp *tcp, const struct sockaddr *remote,
 			  struct net_pkt **pkt);
 
+/**
+ * @brief Prepare a TCP RST message answering an ACK that does not
+ * belong to any connection, see RFC 793 chapter 3.4. The sequence
+ * numbers of the TCP context are left untouched.
+ *
+ * @param tcp TCP context that received the ACK
+ * @param local Local address the ACK was sent to
+ * @param remote Peer address
+ * @param seq Acknowledgment number of the ACK
+ * @param pkt Network buffer
+ *
+ * @return 0 if ok, < 0 if error
+ */
+int net_tcp_prepare_reset_reply(struct net_tcp *tcp,
+				struct sockaddr_ptr *local,
+				const struct sockaddr *remote,
+				u32_t seq, struct net_pkt **pkt);
+
 typedef void (*net_tcp_cb_t)(struct net_tcp *tcp, void *user_data);
 
 /**
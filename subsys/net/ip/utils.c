@@ -373,28 +373,108 @@ int net_addr_pton(sa_family_t family, const char *src,
 	return 0;
 }
 
-static u16_t calc_chksum(u16_t sum, const u8_t *ptr, u16_t len)
+/* Fold a 64-bit one's complement accumulator into 16 bits. */
+static inline u16_t chksum_fold(u64_t acc)
 {
-	u16_t tmp;
-	const u8_t *end;
+	acc = (acc >> 32) + (acc & 0xffffffff);
+	acc = (acc >> 32) + (acc & 0xffffffff);
+	acc = (acc >> 16) + (acc & 0xffff);
+	acc = (acc >> 16) + (acc & 0xffff);
+	acc = (acc >> 16) + (acc & 0xffff);
 
-	end = ptr + len - 1;
+	return acc;
+}
 
-	while (ptr < end) {
-		tmp = (ptr[0] << 8) + ptr[1];
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
-		}
+/* Sum the buffer as native endian words. As the one's complement sum is
+ * byte order independent (RFC 1071), the result only needs a byte swap
+ * on little endian CPUs to match the network byte order sum. The bulk
+ * of the data is read as aligned 32-bit words into a 64-bit accumulator
+ * so that no carry checking is needed inside the loop.
+ */
+static u16_t calc_chksum_native(const u8_t *ptr, u16_t len)
+{
+	const u32_t *ptr32;
+	u64_t acc = 0;
+	bool odd = false;
+	u16_t sum;
+
+	if (!len) {
+		return 0;
+	}
+
+	/* If the buffer starts at an odd address, the words we sum are
+	 * shifted by one byte compared to the packet words, which is
+	 * compensated by swapping the bytes of the result.
+	 */
+	if ((uintptr_t)ptr & 1) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		acc = *ptr << 8;
+#else
+		acc = *ptr;
+#endif
+		odd = true;
+		ptr++;
+		len--;
+	}
+
+	if (len >= 2 && ((uintptr_t)ptr & 2)) {
+		acc += *(const u16_t *)ptr;
 		ptr += 2;
+		len -= 2;
 	}
 
-	if (ptr == end) {
-		tmp = ptr[0] << 8;
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
-		}
+	ptr32 = (const u32_t *)ptr;
+
+	while (len >= 32) {
+		acc += ptr32[0];
+		acc += ptr32[1];
+		acc += ptr32[2];
+		acc += ptr32[3];
+		acc += ptr32[4];
+		acc += ptr32[5];
+		acc += ptr32[6];
+		acc += ptr32[7];
+		ptr32 += 8;
+		len -= 32;
+	}
+
+	while (len >= 4) {
+		acc += *ptr32++;
+		len -= 4;
+	}
+
+	ptr = (const u8_t *)ptr32;
+
+	if (len >= 2) {
+		acc += *(const u16_t *)ptr;
+		ptr += 2;
+		len -= 2;
+	}
+
+	if (len) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		acc += *ptr;
+#else
+		acc += *ptr << 8;
+#endif
+	}
+
+	sum = chksum_fold(acc);
+
+	if (odd) {
+		sum = (sum << 8) | (sum >> 8);
+	}
+
+	return sum;
+}
+
+static u16_t calc_chksum(u16_t sum, const u8_t *ptr, u16_t len)
+{
+	u16_t tmp = ntohs(calc_chksum_native(ptr, len));
+
+	sum += tmp;
+	if (sum < tmp) {
+		sum++;
 	}
 
 	return sum;
@@ -488,6 +568,25 @@ u16_t net_calc_chksum(struct net_pkt *pkt, u8_t proto)
 	return sum;
 }
 
+u16_t net_calc_chksum_update(u16_t chksum, const u8_t *old_data,
+			     const u8_t *new_data, u16_t len)
+{
+	u16_t sum, tmp;
+
+	/* RFC 1624 eqn. 3, HC' = ~(~HC + ~m + m'). The sum of the
+	 * complemented old words is the complement of their sum.
+	 */
+	sum = calc_chksum(~ntohs(chksum), new_data, len);
+
+	tmp = ~calc_chksum(0, old_data, len);
+	sum += tmp;
+	if (sum < tmp) {
+		sum++;
+	}
+
+	return htons(~sum);
+}
+
 #if defined(CONFIG_NET_IPV4)
 u16_t net_calc_chksum_ipv4(struct net_pkt *pkt)
 {
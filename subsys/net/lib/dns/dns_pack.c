@@ -12,6 +12,10 @@
 #define DNS_LABEL_MAX_SIZE	63
 #define DNS_ANSWER_MIN_SIZE	12
 #define DNS_COMMON_UINT_SIZE	2
+/* RR type + class + ttl + rdlength */
+#define DNS_RR_FIXED_SIZE	(DNS_ANSWER_MIN_SIZE - DNS_COMMON_UINT_SIZE)
+/* SOA RDATA: MNAME and RNAME (one octet each at least) and 5 integers */
+#define DNS_SOA_MIN_SIZE	(2 * DNS_LABEL_LEN_SIZE + 5 * 4)
 
 #define DNS_HEADER_ID_LEN	2
 #define DNS_HEADER_FLAGS_LEN	2
@@ -404,3 +408,88 @@ int dns_copy_qname(u8_t *buf, u16_t *len, u16_t size,
 
 	return rc;
 }
+
+/* Returns the size of the domain name at pos, a compression pointer ends
+ * the name.
+ */
+static int dns_name_size(struct dns_msg_t *dns_msg, u16_t pos)
+{
+	u16_t start = pos;
+	u8_t lb_size;
+
+	while (pos < dns_msg->msg_size) {
+		lb_size = dns_msg->msg[pos];
+
+		if (lb_size == 0) {
+			return pos + DNS_LABEL_LEN_SIZE - start;
+		}
+
+		/* See: RFC 1035, 4.1.4. Message compression */
+		if (lb_size > DNS_LABEL_MAX_SIZE) {
+			if (pos + DNS_COMMON_UINT_SIZE > dns_msg->msg_size) {
+				break;
+			}
+
+			return pos + DNS_COMMON_UINT_SIZE - start;
+		}
+
+		pos += DNS_LABEL_LEN_SIZE + lb_size;
+	}
+
+	return -ENOMEM;
+}
+
+int dns_unpack_negative_ttl(struct dns_msg_t *dns_msg, u32_t *ttl)
+{
+	u16_t pos = dns_msg->answer_offset;
+	u16_t rdlength;
+	u32_t minimum;
+	u8_t *answer;
+	int dname_size;
+	int count;
+
+	count = dns_unpack_header_ancount(dns_msg->msg) +
+		dns_header_nscount(dns_msg->msg);
+
+	while (count-- > 0) {
+		dname_size = dns_name_size(dns_msg, pos);
+		if (dname_size < 0) {
+			return dname_size;
+		}
+
+		answer = dns_msg->msg + pos;
+
+		if (pos + dname_size + DNS_RR_FIXED_SIZE > dns_msg->msg_size) {
+			return -ENOMEM;
+		}
+
+		rdlength = dns_answer_rdlength(dname_size, answer);
+
+		pos += dname_size + DNS_RR_FIXED_SIZE;
+		if (pos + rdlength > dns_msg->msg_size) {
+			return -ENOMEM;
+		}
+
+		if (dns_answer_type(dname_size, answer) == DNS_RR_TYPE_SOA &&
+		    dns_answer_class(dname_size, answer) == DNS_CLASS_IN) {
+			if (rdlength < DNS_SOA_MIN_SIZE) {
+				return -ENOMEM;
+			}
+
+			/* MINIMUM is the last field of the RDATA */
+			minimum = ntohl(UNALIGNED_GET((u32_t *)
+					(dns_msg->msg + pos + rdlength - 4)));
+
+			*ttl = dns_answer_ttl(dname_size, answer);
+			if (*ttl > minimum) {
+				*ttl = minimum;
+			}
+
+			return 0;
+		}
+
+		pos += rdlength;
+	}
+
+	return -ENOENT;
+}
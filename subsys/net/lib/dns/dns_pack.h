@@ -54,6 +54,7 @@ enum dns_rr_type {
 	DNS_RR_TYPE_INVALID = 0,
 	DNS_RR_TYPE_A	= 1,		/* IPv4  */
 	DNS_RR_TYPE_CNAME = 5,		/* CNAME */
+	DNS_RR_TYPE_SOA = 6,		/* SOA   */
 	DNS_RR_TYPE_AAAA = 28		/* IPv6  */
 };
 
@@ -200,6 +201,14 @@ static inline int dns_unpack_query_qclass(u8_t *question)
 	return ntohs(UNALIGNED_GET((u16_t *)(question + 2)));
 }
 
+/** It returns the QTYPE of a response unpacked by dns_unpack_response_query */
+static inline int dns_unpack_response_qtype(struct dns_msg_t *dns_msg)
+{
+	/* QTYPE and QCLASS are the last 4 bytes of the question */
+	return dns_unpack_query_qtype(dns_msg->msg +
+				      dns_msg->answer_offset - 4);
+}
+
 static inline int dns_answer_type(u16_t dname_size, u8_t *answer)
 {
 	/** Future versions must consider byte 0
@@ -308,6 +317,23 @@ int dns_msg_pack_query(u8_t *buf, u16_t *len, u16_t size,
  */
 int dns_unpack_response_query(struct dns_msg_t *dns_msg);
 
+/**
+ * Finds out how long a negative response can be cached
+ *
+ * RFC 2308, 5. Caching Negative Answers: a negative response is cached for
+ * the TTL of the SOA record in its authority section, but not longer than
+ * the MINIMUM field of that SOA record. The answer section is walked too
+ * as it may carry a CNAME chain before the SOA.
+ *
+ * @param dns_msg Structure containing the message, the answer_offset must
+ * point after the question. See dns_unpack_response_query.
+ * @param ttl TTL of the negative answer
+ * @retval 0 on success
+ * @retval -ENOENT if there is no SOA record in the message
+ * @retval -ENOMEM if the message is malformed
+ */
+int dns_unpack_negative_ttl(struct dns_msg_t *dns_msg, u32_t *ttl);
+
 /**
  * Copies the qname from dns_msg to buf
  *
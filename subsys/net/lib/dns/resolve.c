@@ -28,6 +28,7 @@
 static int dns_write(struct dns_resolve_context *ctx,
 		     int server_idx,
 		     int query_idx,
+		     enum dns_query_type query_type,
 		     struct net_buf *dns_data,
 		     struct net_buf *dns_qname);
 
@@ -69,8 +70,283 @@ NET_BUF_POOL_DEFINE(dns_msg_pool, DNS_RESOLVER_BUF_CTR,
 NET_BUF_POOL_DEFINE(dns_qname_pool, DNS_RESOLVER_BUF_CTR, DNS_MAX_NAME_LEN,
 		    0, NULL);
 
+/* Address types that a pending query is waiting an answer for */
+#define DNS_PENDING_A		BIT(0)
+#define DNS_PENDING_AAAA	BIT(1)
+
 static struct dns_resolve_context dns_default_ctx;
 
+static inline u8_t dns_query_pending(enum dns_query_type type)
+{
+	switch (type) {
+	case DNS_QUERY_TYPE_A:
+		return DNS_PENDING_A;
+	case DNS_QUERY_TYPE_AAAA:
+		return DNS_PENDING_AAAA;
+	case DNS_QUERY_TYPE_A_AAAA:
+		return DNS_PENDING_A | DNS_PENDING_AAAA;
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+union dns_cache_addr {
+	struct in_addr in;
+	struct in6_addr in6;
+};
+
+struct dns_cache_entry {
+	/** Uptime in ms when the entry expires, 0 if it was never used */
+	s64_t expires;
+
+	/** Name that was resolved */
+	char name[CONFIG_DNS_RESOLVER_CACHE_NAME_LEN + 1];
+
+	/** IPv4 or IPv6 addresses, depending on the type */
+	union dns_cache_addr addr[CONFIG_DNS_RESOLVER_CACHE_ADDRESSES];
+
+	/** Either DNS_QUERY_TYPE_A or DNS_QUERY_TYPE_AAAA */
+	enum dns_query_type type;
+
+	/** 0, DNS_EAI_NONAME or DNS_EAI_NODATA */
+	s8_t status;
+
+	/** Number of valid addresses */
+	u8_t count;
+};
+
+static struct dns_cache_entry dns_cache[CONFIG_DNS_RESOLVER_CACHE_ENTRIES];
+static struct dns_cache_stats dns_cache_stats;
+
+static inline bool dns_cache_match(struct dns_cache_entry *entry,
+				   const char *name,
+				   enum dns_query_type type,
+				   s64_t now)
+{
+	return entry->expires > now && entry->type == type &&
+		!strcmp(entry->name, name);
+}
+
+/* Copies the cached answer to entry, returns false if there is none */
+static bool dns_cache_find(const char *name, enum dns_query_type type,
+			   struct dns_cache_entry *entry)
+{
+	s64_t now = k_uptime_get();
+	unsigned int key;
+	bool found = false;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(dns_cache); i++) {
+		if (dns_cache_match(&dns_cache[i], name, type, now)) {
+			*entry = dns_cache[i];
+			found = true;
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	return found;
+}
+
+static void dns_cache_add(struct dns_cache_entry *answer, u32_t ttl)
+{
+	struct dns_cache_entry *entry = NULL;
+	s64_t now = k_uptime_get();
+	unsigned int key;
+	int i;
+
+	if (!ttl) {
+		return;
+	}
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(dns_cache); i++) {
+		if (dns_cache_match(&dns_cache[i], answer->name, answer->type,
+				    now)) {
+			entry = &dns_cache[i];
+			break;
+		}
+
+		/* Otherwise replace the entry that expires first, which
+		 * is an unused one if there is any.
+		 */
+		if (!entry || dns_cache[i].expires < entry->expires) {
+			entry = &dns_cache[i];
+		}
+	}
+
+	if (i == ARRAY_SIZE(dns_cache) && entry->expires > now) {
+		dns_cache_stats.evictions++;
+	}
+
+	*entry = *answer;
+	entry->expires = now + (s64_t)ttl * MSEC_PER_SEC;
+
+	dns_cache_stats.inserts++;
+
+	irq_unlock(key);
+
+	NET_DBG("Cached %s type %d status %d for %u s", answer->name,
+		answer->type, answer->status, ttl);
+}
+
+static bool dns_cache_prepare(struct dns_cache_entry *answer,
+			      const char *name,
+			      enum dns_query_type type)
+{
+	size_t len = strlen(name);
+
+	if (len > CONFIG_DNS_RESOLVER_CACHE_NAME_LEN) {
+		return false;
+	}
+
+	memcpy(answer->name, name, len + 1);
+	answer->type = type;
+	answer->status = 0;
+	answer->count = 0;
+
+	return true;
+}
+
+static void dns_cache_get_addr(struct dns_cache_entry *entry, int idx,
+			       struct sockaddr *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+
+	if (entry->type == DNS_QUERY_TYPE_A) {
+		addr->family = AF_INET;
+		net_ipaddr_copy(&net_sin(addr)->sin_addr, &entry->addr[idx].in);
+	} else {
+		addr->family = AF_INET6;
+		net_ipaddr_copy(&net_sin6(addr)->sin6_addr,
+				&entry->addr[idx].in6);
+	}
+}
+
+/* Answers the query from the cache if possible. Otherwise returns the
+ * address types that must be queried from the server, and sets status
+ * if the other ones have a cached negative answer.
+ */
+static u8_t dns_cache_resolve(const char *name, enum dns_query_type type,
+			      dns_resolve_cb_t cb, void *user_data,
+			      enum dns_resolve_status *status)
+{
+	static const enum dns_query_type types[] = {
+		DNS_QUERY_TYPE_A, DNS_QUERY_TYPE_AAAA
+	};
+	u8_t pending = dns_query_pending(type);
+	struct dns_cache_entry entry;
+	struct dns_addrinfo info;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(types); i++) {
+		if (!(pending & dns_query_pending(types[i])) ||
+		    !dns_cache_find(name, types[i], &entry)) {
+			continue;
+		}
+
+		if (entry.status) {
+			pending &= ~dns_query_pending(types[i]);
+			*status = entry.status;
+			continue;
+		}
+
+		dns_cache_stats.hits++;
+
+		memset(&info, 0, sizeof(info));
+
+		if (entry.type == DNS_QUERY_TYPE_A) {
+			info.ai_family = AF_INET;
+			info.ai_addrlen = sizeof(struct sockaddr_in);
+		} else {
+			info.ai_family = AF_INET6;
+			info.ai_addrlen = sizeof(struct sockaddr_in6);
+		}
+
+		for (j = 0; j < entry.count; j++) {
+			dns_cache_get_addr(&entry, j, &info.ai_addr);
+			cb(DNS_EAI_INPROGRESS, &info, user_data);
+		}
+
+		cb(DNS_EAI_ALLDONE, NULL, user_data);
+
+		return 0;
+	}
+
+	if (!pending) {
+		dns_cache_stats.negative_hits++;
+		cb(*status, NULL, user_data);
+
+		return 0;
+	}
+
+	dns_cache_stats.misses++;
+
+	return pending;
+}
+
+void dns_cache_foreach(dns_cache_cb_t cb, void *user_data)
+{
+	struct dns_cache_entry entry;
+	struct dns_cache_info info;
+	unsigned int key;
+	s64_t now;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(dns_cache); i++) {
+		now = k_uptime_get();
+
+		key = irq_lock();
+		entry = dns_cache[i];
+		irq_unlock(key);
+
+		if (entry.expires <= now) {
+			continue;
+		}
+
+		info.name = entry.name;
+		info.type = entry.type;
+		info.status = entry.status;
+		info.ttl = (entry.expires - now + MSEC_PER_SEC - 1) /
+			MSEC_PER_SEC;
+		info.count = entry.count;
+
+		for (j = 0; j < entry.count; j++) {
+			dns_cache_get_addr(&entry, j, &info.addr[j]);
+		}
+
+		cb(&info, user_data);
+	}
+}
+
+void dns_cache_flush(void)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	memset(dns_cache, 0, sizeof(dns_cache));
+	irq_unlock(key);
+}
+
+void dns_cache_get_stats(struct dns_cache_stats *stats)
+{
+	*stats = dns_cache_stats;
+}
+#else
+static inline u8_t dns_cache_resolve(const char *name,
+				     enum dns_query_type type,
+				     dns_resolve_cb_t cb, void *user_data,
+				     enum dns_resolve_status *status)
+{
+	return dns_query_pending(type);
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 int dns_resolve_init(struct dns_resolve_context *ctx, const char *servers[])
 {
 #if defined(CONFIG_NET_IPV6)
@@ -366,7 +642,9 @@ static int dns_read(struct dns_resolve_context *ctx,
 {
 	/* Helper struct to track the dns msg received from the server */
 	struct dns_msg_t dns_msg;
-	u32_t ttl; /* RR ttl, so far it is not passed to caller */
+	enum dns_resolve_status status = 0;
+	enum dns_query_type query_type;
+	u32_t ttl, min_ttl = UINT32_MAX;
 	u8_t *src, *addr;
 	int address_size;
 	/* index that points to the current answer being analyzed */
@@ -374,8 +652,13 @@ static int dns_read(struct dns_resolve_context *ctx,
 	int data_len;
 	int offset;
 	int items;
+	int rcode;
 	int ret;
 	int server_idx, query_idx;
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct dns_cache_entry answer;
+	bool cache;
+#endif
 
 	data_len = min(net_pkt_appdatalen(pkt), DNS_RESOLVER_MAX_BUF_SIZE);
 	offset = net_pkt_get_len(pkt) - data_len;
@@ -405,15 +688,27 @@ static int dns_read(struct dns_resolve_context *ctx,
 		goto quit;
 	}
 
-	if (dns_header_rcode(dns_msg.msg) == DNS_HEADER_REFUSED) {
+	rcode = dns_header_rcode(dns_msg.msg);
+	if (rcode == DNS_HEADER_REFUSED) {
 		ret = DNS_EAI_FAIL;
 		goto quit;
 	}
 
-	ret = dns_unpack_response_header(&dns_msg, *dns_id);
-	if (ret < 0) {
-		ret = DNS_EAI_FAIL;
-		goto quit;
+	/* RFC 2308, 2. Negative responses: either the name does not exist
+	 * or it has no address of the queried type.
+	 */
+	if (dns_header_qr(dns_msg.msg) == DNS_RESPONSE &&
+	    (rcode == DNS_HEADER_NAMEERROR ||
+	     (rcode == DNS_HEADER_NOERROR &&
+	      dns_unpack_header_ancount(dns_msg.msg) == 0))) {
+		status = rcode == DNS_HEADER_NAMEERROR ?
+			DNS_EAI_NONAME : DNS_EAI_NODATA;
+	} else {
+		ret = dns_unpack_response_header(&dns_msg, *dns_id);
+		if (ret < 0) {
+			ret = DNS_EAI_FAIL;
+			goto quit;
+		}
 	}
 
 	if (dns_header_qdcount(dns_msg.msg) != 1) {
@@ -427,34 +722,49 @@ static int dns_read(struct dns_resolve_context *ctx,
 		goto quit;
 	}
 
-	if (ctx->queries[query_idx].query_type == DNS_QUERY_TYPE_A) {
+	query_type = dns_unpack_response_qtype(&dns_msg);
+
+	if (!(ctx->queries[query_idx].pending &
+	      dns_query_pending(query_type))) {
+		/* Already answered, so just drop it */
+		ret = 0;
+		goto quit;
+	}
+
+	ctx->queries[query_idx].pending &= ~dns_query_pending(query_type);
+
+	if (query_type == DNS_QUERY_TYPE_A) {
 		address_size = DNS_IPV4_LEN;
 		addr = (u8_t *)&net_sin(&info->ai_addr)->sin_addr;
 		info->ai_family = AF_INET;
 		info->ai_addr.family = AF_INET;
 		info->ai_addrlen = sizeof(struct sockaddr_in);
-	} else if (ctx->queries[query_idx].query_type == DNS_QUERY_TYPE_AAAA) {
+	} else {
 		address_size = DNS_IPV6_LEN;
 		addr = (u8_t *)&net_sin6(&info->ai_addr)->sin6_addr;
 		info->ai_family = AF_INET6;
 		info->ai_addr.family = AF_INET6;
 		info->ai_addrlen = sizeof(struct sockaddr_in6);
-	} else {
-		ret = DNS_EAI_FAMILY;
-		goto quit;
 	}
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	cache = dns_cache_prepare(&answer, ctx->queries[query_idx].query,
+				  query_type);
+#endif
+
 	/* while loop to traverse the response */
 	answer_ptr = DNS_QUERY_POS;
 	items = 0;
 	server_idx = 0;
-	while (server_idx < dns_header_ancount(dns_msg.msg)) {
+	while (!status && server_idx < dns_header_ancount(dns_msg.msg)) {
 		ret = dns_unpack_answer(&dns_msg, answer_ptr, &ttl);
 		if (ret < 0) {
 			ret = DNS_EAI_FAIL;
 			goto quit;
 		}
 
+		min_ttl = min(min_ttl, ttl);
+
 		switch (dns_msg.response_type) {
 		case DNS_RESPONSE_IP:
 			if (dns_msg.response_length < address_size) {
@@ -467,6 +777,13 @@ static int dns_read(struct dns_resolve_context *ctx,
 
 			memcpy(addr, src, address_size);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			if (answer.count < ARRAY_SIZE(answer.addr)) {
+				memcpy(&answer.addr[answer.count++], src,
+				       address_size);
+			}
+#endif
+
 			ctx->queries[query_idx].cb(DNS_EAI_INPROGRESS, info,
 					ctx->queries[query_idx].user_data);
 			items++;
@@ -511,8 +828,45 @@ static int dns_read(struct dns_resolve_context *ctx,
 	}
 
 	if (items == 0) {
-		ret = DNS_EAI_NODATA;
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		/* Negative answers without a SOA record are not cached */
+		if (status && cache &&
+		    !dns_unpack_negative_ttl(&dns_msg, &ttl)) {
+			answer.status = status;
+			dns_cache_add(&answer,
+				      min(ttl,
+					  CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL));
+		}
+#endif
+
+		if (!status) {
+			status = DNS_EAI_NODATA;
+		}
+
+		if (ctx->queries[query_idx].pending) {
+			/* Wait for the other address type to be answered */
+			ctx->queries[query_idx].status = status;
+			ret = 0;
+			goto quit;
+		}
+
+		/* Both address types were queried, and the name exists if
+		 * either one of them says so.
+		 */
+		if (ctx->queries[query_idx].status == DNS_EAI_NODATA) {
+			status = DNS_EAI_NODATA;
+		}
+
+		ret = status;
 	} else {
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		if (cache) {
+			dns_cache_add(&answer,
+				      min(min_ttl,
+					  CONFIG_DNS_RESOLVER_CACHE_MAX_TTL));
+		}
+#endif
+
 		ret = DNS_EAI_ALLDONE;
 	}
 
@@ -580,6 +934,7 @@ static void cb_recv(struct net_context *net_ctx,
 
 	/* Query again if we got CNAME */
 	if (ret == DNS_EAI_AGAIN) {
+		enum dns_query_type type;
 		int failure = 0;
 		int j;
 
@@ -588,12 +943,16 @@ static void cb_recv(struct net_context *net_ctx,
 			goto free_buf;
 		}
 
+		type = info.ai_family == AF_INET ?
+			DNS_QUERY_TYPE_A : DNS_QUERY_TYPE_AAAA;
+		ctx->queries[i].pending |= dns_query_pending(type);
+
 		for (j = 0; j < CONFIG_DNS_RESOLVER_MAX_SERVERS; j++) {
 			if (!ctx->servers[j].net_ctx) {
 				continue;
 			}
 
-			ret = dns_write(ctx, j, i, dns_data, dns_cname);
+			ret = dns_write(ctx, j, i, type, dns_data, dns_cname);
 			if (ret < 0) {
 				failure++;
 			}
@@ -637,10 +996,10 @@ free_buf:
 static int dns_write(struct dns_resolve_context *ctx,
 		     int server_idx,
 		     int query_idx,
+		     enum dns_query_type query_type,
 		     struct net_buf *dns_data,
 		     struct net_buf *dns_qname)
 {
-	enum dns_query_type query_type;
 	struct net_context *net_ctx;
 	struct sockaddr *server;
 	struct net_pkt *pkt;
@@ -651,7 +1010,6 @@ static int dns_write(struct dns_resolve_context *ctx,
 	net_ctx = ctx->servers[server_idx].net_ctx;
 	server = &ctx->servers[server_idx].dns_server;
 	dns_id = ctx->queries[query_idx].id;
-	query_type = ctx->queries[query_idx].query_type;
 
 	ret = dns_msg_pack_query(dns_data->data, &dns_data->len, dns_data->size,
 				 dns_qname->data, dns_qname->len, dns_id,
@@ -716,6 +1074,34 @@ quit:
 	return ret;
 }
 
+/* Sends a query for each address type the query is waiting for */
+static int dns_write_pending(struct dns_resolve_context *ctx,
+			     int server_idx,
+			     int query_idx,
+			     struct net_buf *dns_data,
+			     struct net_buf *dns_qname)
+{
+	static const enum dns_query_type types[] = {
+		DNS_QUERY_TYPE_A, DNS_QUERY_TYPE_AAAA
+	};
+	int ret, i;
+
+	for (i = 0; i < ARRAY_SIZE(types); i++) {
+		if (!(ctx->queries[query_idx].pending &
+		      dns_query_pending(types[i]))) {
+			continue;
+		}
+
+		ret = dns_write(ctx, server_idx, query_idx, types[i],
+				dns_data, dns_qname);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 int dns_resolve_cancel(struct dns_resolve_context *ctx, u16_t dns_id)
 {
 	int i;
@@ -755,10 +1141,12 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 		     void *user_data,
 		     s32_t timeout)
 {
+	enum dns_resolve_status status = DNS_EAI_NONAME;
 	struct net_buf *dns_data;
 	struct net_buf *dns_qname = NULL;
 	int ret, i, j = 0;
 	int failure = 0;
+	u8_t pending;
 
 	if (!ctx || !ctx->is_used || !query || !cb) {
 		return -EINVAL;
@@ -770,6 +1158,19 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 		return -EINVAL;
 	}
 
+	if (!dns_query_pending(type)) {
+		return -EINVAL;
+	}
+
+	pending = dns_cache_resolve(query, type, cb, user_data, &status);
+	if (!pending) {
+		if (dns_id) {
+			*dns_id = 0;
+		}
+
+		return 0;
+	}
+
 	i = get_cb_slot(ctx);
 	if (i < 0) {
 		return -EAGAIN;
@@ -779,6 +1180,8 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 	ctx->queries[i].timeout = timeout;
 	ctx->queries[i].query = query;
 	ctx->queries[i].query_type = type;
+	ctx->queries[i].status = status;
+	ctx->queries[i].pending = pending;
 	ctx->queries[i].user_data = user_data;
 	ctx->queries[i].ctx = ctx;
 
@@ -819,7 +1222,7 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 			continue;
 		}
 
-		ret = dns_write(ctx, j, i, dns_data, dns_qname);
+		ret = dns_write_pending(ctx, j, i, dns_data, dns_qname);
 		if (ret < 0) {
 			failure++;
 			continue;
@@ -914,6 +914,11 @@ static int https_init(struct http_client_ctx *ctx)
 	mbedtls_x509_crt_init(&ctx->https.mbedtls.ca_cert);
 #endif
 
+#if defined(CONFIG_HTTPS_CLIENT_SESSION_REUSE)
+	mbedtls_ssl_session_init(&ctx->https.mbedtls.session);
+	ctx->https.mbedtls.session_saved = false;
+#endif
+
 #if defined(MBEDTLS_DEBUG_C) && defined(CONFIG_NET_DEBUG_HTTP)
 	mbedtls_debug_set_threshold(DEBUG_THRESHOLD);
 	mbedtls_ssl_conf_dbg(&ctx->https.mbedtls.conf, my_debug, NULL);
@@ -988,6 +993,36 @@ exit:
 	return ret;
 }
 
+#if defined(CONFIG_HTTPS_CLIENT_SESSION_REUSE)
+static void session_save(struct http_client_ctx *ctx)
+{
+	int ret;
+
+	/* The session copies the server certificate and the ticket, the
+	 * earlier ones must be freed.
+	 */
+	mbedtls_ssl_session_free(&ctx->https.mbedtls.session);
+
+	ret = mbedtls_ssl_get_session(&ctx->https.mbedtls.ssl,
+				      &ctx->https.mbedtls.session);
+	if (ret != 0) {
+		print_error("mbedtls_ssl_get_session returned -0x%x", ret);
+		mbedtls_ssl_session_free(&ctx->https.mbedtls.session);
+	}
+
+	ctx->https.mbedtls.session_saved = (ret == 0);
+}
+
+void https_client_session_clear(struct http_client_ctx *ctx)
+{
+	mbedtls_ssl_session_free(&ctx->https.mbedtls.session);
+	ctx->https.mbedtls.session_saved = false;
+}
+#else
+#define session_save(...)
+#define https_client_session_clear(...)
+#endif /* CONFIG_HTTPS_CLIENT_SESSION_REUSE */
+
 static void https_handler(struct http_client_ctx *ctx,
 			  struct k_sem *startup_sync)
 {
@@ -1035,6 +1070,20 @@ reset:
 	mbedtls_ssl_set_bio(&ctx->https.mbedtls.ssl, ctx, ssl_tx,
 			    ssl_rx, NULL);
 
+#if defined(CONFIG_HTTPS_CLIENT_SESSION_REUSE)
+	/* If the server still knows the session, the handshake skips the
+	 * key exchange and the certificate verification.
+	 */
+	if (ctx->https.mbedtls.session_saved) {
+		ret = mbedtls_ssl_set_session(&ctx->https.mbedtls.ssl,
+					      &ctx->https.mbedtls.session);
+		if (ret != 0) {
+			print_error("mbedtls_ssl_set_session returned -0x%x",
+				    ret);
+		}
+	}
+#endif
+
 	/* SSL handshake. The ssl_rx() function will be called next by
 	 * mbedtls library. The ssl_rx() will block and wait that data is
 	 * received by ssl_received() and passed to it via fifo. After
@@ -1053,11 +1102,16 @@ reset:
 			if (ret < 0) {
 				print_error("mbedtls_ssl_handshake returned "
 					    "-0x%x", ret);
+
+				/* Do not try the same session again */
+				https_client_session_clear(ctx);
 				goto close;
 			}
 		}
 	} while (ret != 0);
 
+	session_save(ctx);
+
 	ret = http_request(ctx, &req, BUF_ALLOC_TIMEOUT);
 
 	k_mem_pool_free(&tx_data->block);
@@ -1185,6 +1239,8 @@ static void https_shutdown(struct http_client_ctx *ctx)
 	mbedtls_x509_crt_free(&ctx->https.mbedtls.ca_cert);
 #endif
 
+	https_client_session_clear(ctx);
+
 	tcp_disconnect(ctx);
 
 	NET_DBG("HTTPS thread %p stopped for %p", ctx->https.tid, ctx);
@@ -1467,16 +1523,13 @@ static inline int set_remote_addr(struct http_client_ctx *ctx,
 			NET_ERR("Invalid IPv4 or IPv6 address %s", server);
 			return -EINVAL;
 #else
-			ret = resolve_name(ctx, server, DNS_QUERY_TYPE_A);
+			ret = resolve_name(ctx, server, DNS_QUERY_TYPE_A_AAAA);
 			if (ret < 0) {
-				ret = resolve_name(ctx, server,
-						   DNS_QUERY_TYPE_AAAA);
-				if (ret < 0) {
-					NET_ERR("Cannot resolve %s (%d)",
-						server, ret);
-					return ret;
-				}
+				NET_ERR("Cannot resolve %s (%d)", server, ret);
+				return ret;
+			}
 
+			if (ctx->tcp.remote.family == AF_INET6) {
 				goto ipv6;
 			}
 
@@ -52,14 +52,22 @@ static void https_disable(struct http_server_ctx *ctx);
 				"\r\n"
 
 #define HTTP_STATUS_400_BR	"HTTP/1.1 400 Bad Request\r\n" \
+				"Transfer-Encoding: chunked\r\n" \
 				"\r\n"
 
 #define HTTP_STATUS_403_FBD	"HTTP/1.1 403 Forbidden\r\n" \
+				"Transfer-Encoding: chunked\r\n" \
 				"\r\n"
 
 #define HTTP_STATUS_404_NF	"HTTP/1.1 404 Not Found\r\n" \
+				"Transfer-Encoding: chunked\r\n" \
 				"\r\n"
 
+/* Values of http_server_conn.last_cb */
+#define LAST_CB_NONE	0
+#define LAST_CB_FIELD	1
+#define LAST_CB_VALUE	2
+
 #if defined(CONFIG_NET_DEBUG_HTTP_CONN)
 /** List of HTTP connections */
 static sys_slist_t http_conn;
@@ -69,6 +77,8 @@ static void *mon_user_data;
 
 static void http_server_conn_add(struct http_server_ctx *ctx)
 {
+	/* The context is added again by each request it serves */
+	sys_slist_find_and_remove(&http_conn, &ctx->node);
 	sys_slist_prepend(&http_conn, &ctx->node);
 
 	if (ctx_mon) {
@@ -150,30 +160,82 @@ static int http_add_chunk(struct net_pkt *pkt, s32_t timeout, const char *str)
 	return 0;
 }
 
-static void req_timer_cancel(struct http_server_ctx *ctx)
+static void conn_reset(struct http_server_conn *conn)
+{
+	memset(conn->field_values, 0, sizeof(conn->field_values));
+
+	conn->field_values_ctr = 0;
+	conn->url = NULL;
+	conn->url_len = 0;
+	conn->head_len = 0;
+	conn->last_cb = LAST_CB_NONE;
+}
+
+static void conn_open(struct http_server_conn *conn,
+		      struct net_context *net_ctx)
 {
-	ctx->req.timer_cancelled = true;
-	k_delayed_work_cancel(&ctx->req.timer);
+	conn_reset(conn);
 
-	NET_DBG("Context %p request timer cancelled", ctx);
+	conn->data_len = 0;
+	conn->parsed = 0;
+	conn->keep_alive = 0;
+	conn->closing = 0;
+	conn->releasing = 0;
+
+	http_parser_init(&conn->parser, HTTP_REQUEST);
+	conn->parser.data = conn;
+
+	conn->net_ctx = net_ctx;
 }
 
-static void req_timeout(struct k_work *work)
+static void conn_close(struct http_server_conn *conn)
 {
-	struct http_server_ctx *ctx = CONTAINER_OF(work,
-						   struct http_server_ctx,
-						   req.timer);
+	struct net_context *net_ctx;
+	int key;
 
-	if (ctx->req.timer_cancelled) {
+	/* The connection can be closed by the RX thread, and by the
+	 * timer from the system work queue. The connection stays in use,
+	 * and cannot be reopened, until the one closing it is done.
+	 */
+	key = irq_lock();
+
+	net_ctx = conn->net_ctx;
+	if (!net_ctx || conn->releasing) {
+		irq_unlock(key);
+		return;
+	}
+
+	/* A timeout already queued would close the next connection, so it
+	 * is left to close this one.
+	 */
+	if (k_delayed_work_cancel(&conn->timer) == -EINPROGRESS) {
+		irq_unlock(key);
 		return;
 	}
 
-	NET_DBG("Context %p request timeout", ctx);
+	conn->releasing = 1;
+
+	irq_unlock(key);
 
-	net_context_unref(ctx->req.net_ctx);
-	ctx->req.net_ctx = NULL;
+	NET_DBG("Context %p connection %p closed", conn->ctx, conn);
 
-	http_server_conn_del(ctx);
+	http_server_conn_del(conn->ctx);
+
+	net_context_put(net_ctx);
+
+	key = irq_lock();
+	conn->net_ctx = NULL;
+	conn->releasing = 0;
+	irq_unlock(key);
+}
+
+static void conn_timeout(struct k_work *work)
+{
+	struct http_server_conn *conn = CONTAINER_OF(work,
+						     struct http_server_conn,
+						     timer);
+
+	conn_close(conn);
 }
 
 static void pkt_sent(struct net_context *context,
@@ -182,36 +244,38 @@ static void pkt_sent(struct net_context *context,
 		     void *user_data)
 {
 	s32_t timeout = POINTER_TO_INT(token);
-	struct http_server_ctx *ctx = user_data;
-
-	req_timer_cancel(ctx);
-
-	if (timeout == K_NO_WAIT) {
-		/* We can just close the context after the packet is sent. */
-		net_context_unref(context);
-		http_server_conn_del(ctx);
-	} else if (timeout > 0) {
-		NET_DBG("Context %p starting timer", ctx);
-
-		k_delayed_work_submit(&ctx->req.timer, timeout);
+	struct http_server_conn *conn = user_data;
 
-		ctx->req.timer_cancelled = false;
+	if (conn->net_ctx != context) {
+		return;
 	}
 
 	/* Note that if the timeout is K_FOREVER, we do not close
-	 * the connection.
+	 * the connection. A connection that is done is not closed
+	 * from here either, as this is called from within the
+	 * callbacks of the context.
 	 */
+	if (timeout != K_FOREVER) {
+		NET_DBG("Connection %p starting timer", conn);
+
+		k_delayed_work_submit(&conn->timer, timeout);
+	}
 }
 
 int http_response_wait(struct http_server_ctx *ctx, const char *http_header,
 		       const char *html_payload, s32_t timeout)
 {
+	struct http_server_conn *conn = ctx->req.conn;
 	struct net_pkt *pkt;
 	int ret = -EINVAL;
 
-	pkt = net_pkt_get_tx(ctx->req.net_ctx, ctx->timeout);
+	if (!conn || !conn->net_ctx || conn->closing || conn->releasing) {
+		return -ENOTCONN;
+	}
+
+	pkt = net_pkt_get_tx(conn->net_ctx, ctx->timeout);
 	if (!pkt) {
-		return ret;
+		goto exit_routine;
 	}
 
 	ret = http_add_header(pkt, ctx->timeout, http_header);
@@ -220,9 +284,11 @@ int http_response_wait(struct http_server_ctx *ctx, const char *http_header,
 	}
 
 	if (html_payload) {
-		ret = http_add_chunk(pkt, ctx->timeout, html_payload);
-		if (ret != 0) {
-			goto exit_routine;
+		if (*html_payload) {
+			ret = http_add_chunk(pkt, ctx->timeout, html_payload);
+			if (ret != 0) {
+				goto exit_routine;
+			}
 		}
 
 		/* like EOF */
@@ -234,7 +300,18 @@ int http_response_wait(struct http_server_ctx *ctx, const char *http_header,
 
 	net_pkt_set_appdatalen(pkt, net_buf_frags_len(pkt->frags));
 
-	ret = ctx->send_data(pkt, pkt_sent, 0, INT_TO_POINTER(timeout), ctx);
+	/* The client knows where a chunked payload ends, so it can send
+	 * its next request on the same connection.
+	 */
+	if (timeout == K_NO_WAIT) {
+		if (conn->keep_alive && html_payload) {
+			timeout = CONFIG_HTTP_SERVER_KEEPALIVE_TIMEOUT;
+		} else {
+			conn->closing = 1;
+		}
+	}
+
+	ret = ctx->send_data(pkt, pkt_sent, 0, INT_TO_POINTER(timeout), conn);
 	if (ret != 0) {
 		goto exit_routine;
 	}
@@ -246,6 +323,12 @@ exit_routine:
 		net_pkt_unref(pkt);
 	}
 
+	if (ret != 0) {
+		/* The client would wait forever for the missing response */
+		conn->closing = 1;
+		k_delayed_work_submit(&conn->timer, K_NO_WAIT);
+	}
+
 	return ret;
 }
 
@@ -257,17 +340,20 @@ int http_response(struct http_server_ctx *ctx, const char *http_header,
 
 int http_response_400(struct http_server_ctx *ctx, const char *html_payload)
 {
-	return http_response(ctx, HTTP_STATUS_400_BR, html_payload);
+	return http_response(ctx, HTTP_STATUS_400_BR,
+			     html_payload ? html_payload : "");
 }
 
 int http_response_403(struct http_server_ctx *ctx, const char *html_payload)
 {
-	return http_response(ctx, HTTP_STATUS_403_FBD, html_payload);
+	return http_response(ctx, HTTP_STATUS_403_FBD,
+			     html_payload ? html_payload : "");
 }
 
 int http_response_404(struct http_server_ctx *ctx, const char *html_payload)
 {
-	return http_response(ctx, HTTP_STATUS_404_NF, html_payload);
+	return http_response(ctx, HTTP_STATUS_404_NF,
+			     html_payload ? html_payload : "");
 }
 
 int http_server_set_local_addr(struct sockaddr *addr, const char *myaddr,
@@ -328,29 +414,140 @@ int http_server_set_local_addr(struct sockaddr *addr, const char *myaddr,
 	return 0;
 }
 
+static u8_t url_trie_node(struct http_server_urls *my, const char *str,
+			  u16_t len, u8_t url)
+{
+	struct http_url_node *node;
+
+	NET_ASSERT(my->trie_len < HTTP_URL_TRIE_NODES);
+
+	node = &my->trie[my->trie_len];
+
+	node->str = str;
+	node->len = len;
+	node->url = url;
+	node->child = 0;
+	node->sibling = 0;
+
+	return my->trie_len++;
+}
+
+static void url_trie_insert(struct http_server_urls *my, u8_t idx)
+{
+	const char *str = my->urls[idx].root;
+	u16_t len = my->urls[idx].root_len;
+	struct http_url_node *node = &my->trie[0];
+	u8_t *next;
+	u16_t i;
+
+	if (!my->trie_len) {
+		url_trie_node(my, NULL, 0, 0);
+	}
+
+	while (len) {
+		/* The children of a node all start with a different
+		 * character.
+		 */
+		for (next = &node->child; *next;
+		     next = &my->trie[*next].sibling) {
+			if (my->trie[*next].str[0] == str[0]) {
+				break;
+			}
+		}
+
+		if (!*next) {
+			*next = url_trie_node(my, str, len, idx + 1);
+			return;
+		}
+
+		node = &my->trie[*next];
+
+		for (i = 1; i < node->len && i < len; i++) {
+			if (node->str[i] != str[i]) {
+				break;
+			}
+		}
+
+		if (i < node->len) {
+			/* The URL only shares the start of the node, which
+			 * is split in two.
+			 */
+			u8_t child = url_trie_node(my, node->str + i,
+						   node->len - i, node->url);
+
+			my->trie[child].child = node->child;
+
+			node->child = child;
+			node->len = i;
+			node->url = 0;
+		}
+
+		str += i;
+		len -= i;
+	}
+
+	node->url = idx + 1;
+}
+
+/* The nodes point to the URL strings, so the tree is built again when
+ * one of them is removed.
+ */
+static void url_trie_build(struct http_server_urls *my)
+{
+	int i;
+
+	my->trie_len = 0;
+
+	url_trie_node(my, NULL, 0, 0);
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_NUM_URLS; i++) {
+		if (my->urls[i].is_used) {
+			url_trie_insert(my, i);
+		}
+	}
+}
+
 struct http_root_url *http_server_add_url(struct http_server_urls *my,
 					  const char *url, u8_t flags,
 					  http_url_cb_t write_cb)
 {
-	int i;
+	size_t len = strlen(url);
+	int i, free = -1;
+
+	if (!len) {
+		return NULL;
+	}
 
 	for (i = 0; i < CONFIG_HTTP_SERVER_NUM_URLS; i++) {
-		if (my->urls[i].is_used) {
+		if (!my->urls[i].is_used) {
+			if (free < 0) {
+				free = i;
+			}
+
 			continue;
 		}
 
-		my->urls[i].is_used = true;
-		my->urls[i].root = url;
-
-		/* This will speed-up some future operations */
-		my->urls[i].root_len = strlen(url);
-		my->urls[i].flags = flags;
-		my->urls[i].write_cb = write_cb;
+		if (my->urls[i].root_len == len &&
+		    !memcmp(my->urls[i].root, url, len)) {
+			return NULL;
+		}
+	}
 
-		return &my->urls[i];
+	if (free < 0) {
+		return NULL;
 	}
 
-	return NULL;
+	my->urls[free].is_used = true;
+	my->urls[free].root = url;
+
+	/* This will speed-up some future operations */
+	my->urls[free].root_len = len;
+	my->urls[free].flags = flags;
+	my->urls[free].write_cb = write_cb;
+
+	url_trie_insert(my, free);
+
+	return &my->urls[free];
 }
 
 int http_server_del_url(struct http_server_urls *my, const char *url)
@@ -369,6 +566,8 @@ int http_server_del_url(struct http_server_urls *my, const char *url)
 		my->urls[i].is_used = false;
 		my->urls[i].root = NULL;
 
+		url_trie_build(my);
+
 		return 0;
 	}
 
@@ -473,17 +672,34 @@ static inline void new_server(struct http_server_ctx *ctx,
 #endif /* CONFIG_NET_DEBUG_HTTP */
 }
 
+/* The request is parsed as it is received, so the parser callbacks can
+ * be called several times for the same string when it is split between
+ * packets. The data stays in the connection buffer until the request
+ * has been served, so the second call just extends the string.
+ */
 static int on_header_field(struct http_parser *parser,
 			   const char *at, size_t length)
 {
-	struct http_server_ctx *ctx = parser->data;
+	struct http_server_conn *conn = parser->data;
+	struct http_field_value *field;
+
+	if (conn->last_cb == LAST_CB_FIELD) {
+		field = &conn->field_values[conn->field_values_ctr - 1];
+		field->key_len = at + length - field->key;
+
+		return 0;
+	}
 
-	if (ctx->req.field_values_ctr >= CONFIG_HTTP_HEADER_FIELD_ITEMS) {
+	if (conn->field_values_ctr >= CONFIG_HTTP_HEADER_FIELD_ITEMS) {
+		conn->last_cb = LAST_CB_NONE;
 		return 0;
 	}
 
-	ctx->req.field_values[ctx->req.field_values_ctr].key = at;
-	ctx->req.field_values[ctx->req.field_values_ctr].key_len = length;
+	field = &conn->field_values[conn->field_values_ctr++];
+	field->key = at;
+	field->key_len = length;
+
+	conn->last_cb = LAST_CB_FIELD;
 
 	return 0;
 }
@@ -491,28 +707,64 @@ static int on_header_field(struct http_parser *parser,
 static int on_header_value(struct http_parser *parser,
 			   const char *at, size_t length)
 {
-	struct http_server_ctx *ctx = parser->data;
+	struct http_server_conn *conn = parser->data;
+	struct http_field_value *field;
 
-	if (ctx->req.field_values_ctr >= CONFIG_HTTP_HEADER_FIELD_ITEMS) {
+	if (conn->last_cb == LAST_CB_NONE) {
 		return 0;
 	}
 
-	ctx->req.field_values[ctx->req.field_values_ctr].value = at;
-	ctx->req.field_values[ctx->req.field_values_ctr].value_len = length;
+	field = &conn->field_values[conn->field_values_ctr - 1];
+
+	if (conn->last_cb == LAST_CB_VALUE) {
+		field->value_len = at + length - field->value;
+	} else {
+		field->value = at;
+		field->value_len = length;
+	}
 
-	ctx->req.field_values_ctr++;
+	conn->last_cb = LAST_CB_VALUE;
 
 	return 0;
 }
 
 static int on_url(struct http_parser *parser, const char *at, size_t length)
 {
-	struct http_server_ctx *ctx = parser->data;
+	struct http_server_conn *conn = parser->data;
 
-	ctx->req.url = at;
-	ctx->req.url_len = length;
+	if (conn->url) {
+		conn->url_len = at + length - conn->url;
+	} else {
+		conn->url = at;
+		conn->url_len = length;
+	}
 
-	http_server_conn_add(ctx);
+	return 0;
+}
+
+static int on_body(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_server_conn *conn = parser->data;
+
+	if (!conn->head_len) {
+		conn->head_len = (const u8_t *)at - conn->buf;
+	}
+
+	return 0;
+}
+
+static int on_message_complete(struct http_parser *parser)
+{
+	struct http_server_conn *conn = parser->data;
+
+	/* The TLS session is torn down after each HTTPS request */
+	conn->keep_alive = http_should_keep_alive(parser) &&
+		!conn->ctx->is_https;
+
+	/* Stop the parser, so that the request is served before the
+	 * next one in the buffer is parsed.
+	 */
+	http_parser_pause(parser, 1);
 
 	return 0;
 }
@@ -524,67 +776,97 @@ static int parser_init(struct http_server_ctx *ctx)
 	ctx->req.settings.on_header_field = on_header_field;
 	ctx->req.settings.on_header_value = on_header_value;
 	ctx->req.settings.on_url = on_url;
-
-	http_parser_init(&ctx->req.parser, HTTP_REQUEST);
-
-	ctx->req.parser.data = ctx;
+	ctx->req.settings.on_body = on_body;
+	ctx->req.settings.on_message_complete = on_message_complete;
 
 	return 0;
 }
 
-static int http_url_cmp(const char *url, u16_t url_len,
-			const char *root_url, u16_t root_url_len)
+static void conns_init(struct http_server_ctx *ctx, int count, size_t buf_len)
 {
-	if (url_len < root_url_len) {
-		return -EINVAL;
-	}
+	struct http_server_conn *conn;
+	int i;
 
-	if (memcmp(url, root_url, root_url_len) == 0) {
-		if (url_len == root_url_len) {
-			return 0;
-		}
+	for (i = 0; i < count; i++) {
+		conn = &ctx->conns[i];
 
-		/* Here we evaluate the following conditions:
-		 * root_url = /images, url = /images/ -> OK
-		 * root_url = /images/, url = /images/img.png -> OK
-		 * root_url = /images/, url = /images_and_docs -> ERROR
-		 */
-		if (url_len > root_url_len) {
-			if (root_url[root_url_len - 1] == '/') {
-				return 0;
-			}
+		conn->ctx = ctx;
+		conn->net_ctx = NULL;
 
-			if (url[root_url_len] == '/') {
-				return 0;
-			}
-		}
+		/* Keep room for a nul byte after the data */
+		conn->buf = ctx->req.request_buf + i * buf_len;
+		conn->buf_len = buf_len - 1;
+
+		k_delayed_work_init(&conn->timer, conn_timeout);
 	}
+}
 
-	return -EINVAL;
+static void conns_close(struct http_server_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		conn_close(&ctx->conns[i]);
+	}
+}
+
+static bool url_boundary(struct http_root_url *root_url,
+			 const char *url, u16_t url_len, u16_t pos)
+{
+	/* Here we evaluate the following conditions:
+	 * root_url = /images, url = /images/ -> OK
+	 * root_url = /images, url = /images?size=2 -> OK
+	 * root_url = /images/, url = /images/img.png -> OK
+	 * root_url = /images/, url = /images_and_docs -> ERROR
+	 */
+	return pos == url_len || url[pos] == '/' || url[pos] == '?' ||
+		root_url->root[root_url->root_len - 1] == '/';
 }
 
 static struct http_root_url *http_url_find(struct http_server_ctx *http_ctx)
 {
 	u16_t url_len = http_ctx->req.url_len;
 	const char *url = http_ctx->req.url;
-	struct http_root_url *root_url;
+	struct http_server_urls *my = http_ctx->urls;
+	struct http_root_url *found = NULL;
+	struct http_url_node *node = &my->trie[0];
+	u16_t pos = 0;
 	u8_t i;
-	int ret;
 
-	for (i = 0; i < CONFIG_HTTP_SERVER_NUM_URLS; i++) {
-		root_url = &http_ctx->urls->urls[i];
-		if (!root_url->is_used) {
-			continue;
+	/* Go down the tree as long as the URL matches, the deepest
+	 * registered URL that was passed is the most specific one.
+	 */
+	while (1) {
+		if (node->url &&
+		    url_boundary(&my->urls[node->url - 1], url, url_len, pos)) {
+			found = &my->urls[node->url - 1];
 		}
 
-		ret = http_url_cmp(url, url_len,
-				   root_url->root, root_url->root_len);
-		if (!ret) {
-			return root_url;
+		if (pos == url_len) {
+			break;
+		}
+
+		for (i = node->child; i; i = my->trie[i].sibling) {
+			if (my->trie[i].str[0] == url[pos]) {
+				break;
+			}
+		}
+
+		if (!i) {
+			break;
 		}
+
+		node = &my->trie[i];
+
+		if (url_len - pos < node->len ||
+		    memcmp(url + pos, node->str, node->len)) {
+			break;
+		}
+
+		pos += node->len;
 	}
 
-	return NULL;
+	return found;
 }
 
 static int http_process_recv(struct http_server_ctx *http_ctx)
@@ -615,120 +897,260 @@ out:
 	return ret;
 }
 
+/* Make the request of the connection the one seen by the handlers */
+static void conn_select(struct http_server_conn *conn)
+{
+	struct http_server_ctx *ctx = conn->ctx;
+
+	ctx->req.conn = conn;
+	ctx->req.net_ctx = conn->net_ctx;
+	ctx->req.parser = conn->parser;
+	ctx->req.url = conn->url;
+	ctx->req.url_len = conn->url_len;
+	ctx->req.field_values_ctr = conn->field_values_ctr;
+
+	memcpy(ctx->req.field_values, conn->field_values,
+	       sizeof(ctx->req.field_values));
+}
+
+static void conn_serve(struct http_server_conn *conn)
+{
+	struct http_server_ctx *ctx = conn->ctx;
+
+	conn_select(conn);
+
+	http_server_conn_add(ctx);
+
+	if (http_process_recv(ctx) == -ENOENT) {
+		http_response_404(ctx, NULL);
+	}
+
+	/* The data of the following requests is moved to the start of
+	 * the buffer.
+	 */
+	conn->data_len -= conn->parsed;
+	memmove(conn->buf, conn->buf + conn->parsed, conn->data_len);
+	conn->parsed = 0;
+
+	conn_reset(conn);
+
+	http_parser_pause(&conn->parser, 0);
+}
+
+static int conn_parse(struct http_server_conn *conn)
+{
+	struct http_server_ctx *ctx = conn->ctx;
+	size_t parsed;
+
+	while (conn->parsed < conn->data_len) {
+		parsed = http_parser_execute(&conn->parser, &ctx->req.settings,
+					     conn->buf + conn->parsed,
+					     conn->data_len - conn->parsed);
+		conn->parsed += parsed;
+
+		switch (HTTP_PARSER_ERRNO(&conn->parser)) {
+		case HPE_OK:
+			break;
+		case HPE_PAUSED:
+			conn_serve(conn);
+			if (conn->closing) {
+				return -ECONNRESET;
+			}
+
+			continue;
+		default:
+			NET_DBG("Parsed %zu bytes, error %s (%s)",
+				conn->parsed,
+				http_errno_name(conn->parser.http_errno),
+				http_errno_description(
+					conn->parser.http_errno));
+			goto fail;
+		}
+
+		/* Only the request line and the header fields are kept */
+		if (conn->head_len) {
+			conn->data_len = conn->head_len;
+			conn->parsed = conn->head_len;
+		}
+	}
+
+	if (conn->data_len < conn->buf_len) {
+		return 0;
+	}
+
+	NET_DBG("Request header does not fit in %zu bytes", conn->buf_len);
+
+fail:
+	conn->keep_alive = 0;
+
+	conn_select(conn);
+	http_response_400(ctx, NULL);
+
+	return -EINVAL;
+}
+
+static int conn_recv(struct http_server_conn *conn, const u8_t *data,
+		     size_t len)
+{
+	size_t part;
+	int ret;
+
+	while (len) {
+		if (conn->closing) {
+			return -ECONNRESET;
+		}
+
+		part = min(len, conn->buf_len - conn->data_len);
+
+		memcpy(conn->buf + conn->data_len, data, part);
+		conn->data_len += part;
+		conn->buf[conn->data_len] = '\0';
+
+		data += part;
+		len -= part;
+
+		ret = conn_parse(conn);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 static void http_recv(struct net_context *net_ctx,
 		      struct net_pkt *pkt, int status,
 		      void *user_data)
 {
-	struct http_server_ctx *http_ctx = user_data;
+	struct http_server_conn *conn = user_data;
+	struct http_server_ctx *http_ctx = conn->ctx;
 	struct net_buf *frag;
-	size_t start = http_ctx->req.data_len;
-	int parsed_len;
-	int header_len;
-	u16_t len = 0, recv_len;
+	u16_t offset;
+	int key;
 
 	if (!pkt) {
-		NET_DBG("Connection closed by peer");
+		/* Only the RX thread reopens a connection, so it still
+		 * belongs to net_ctx when closed here.
+		 */
+		if (conn->net_ctx == net_ctx) {
+			NET_DBG("Connection closed by peer");
+			conn_close(conn);
+		}
+
 		return;
 	}
 
-	if (!http_ctx->enabled) {
+	if (!http_ctx->enabled || conn->net_ctx != net_ctx) {
 		goto quit;
 	}
 
-	recv_len = net_pkt_appdatalen(pkt);
-	if (recv_len == 0) {
+	if (net_pkt_appdatalen(pkt) == 0) {
 		/* don't print info about zero-length app data buffers */
 		goto quit;
 	}
 
 	if (status) {
 		NET_DBG("Status %d <%s>", status, RC_STR(status));
-		goto out;
+		goto quit;
 	}
 
-	/* Get rid of possible IP headers in the first fragment. */
-	frag = pkt->frags;
-
-	header_len = net_pkt_appdata(pkt) - frag->data;
-
 	NET_DBG("Received %d bytes data", net_pkt_appdatalen(pkt));
 
-	/* After this pull, the frag->data points directly to application data.
+	/* A timeout already queued, or a close in progress, wins over the
+	 * data. A closing connection keeps its timer running.
 	 */
-	net_buf_pull(frag, header_len);
+	key = irq_lock();
 
-	while (frag) {
-		/* If this fragment cannot be copied to result buf,
-		 * then parse what we have which will cause the callback to be
-		 * called in function on_body(), and continue copying.
-		 */
-		if (http_ctx->req.data_len + frag->len >
-		    http_ctx->req.request_buf_len) {
+	if (conn->releasing ||
+	    (!conn->closing &&
+	     k_delayed_work_cancel(&conn->timer) == -EINPROGRESS)) {
+		irq_unlock(key);
+		goto quit;
+	}
 
-			/* If the caller has not supplied a callback, then
-			 * we cannot really continue if the request buffer
-			 * overflows. Set the data_len to mark how many bytes
-			 * should be needed in the response_buf.
-			 */
-			if (http_process_recv(http_ctx) < 0) {
-				http_ctx->req.data_len = net_pkt_get_len(pkt);
-				goto out;
-			}
+	irq_unlock(key);
 
-			parsed_len =
-				http_parser_execute(&http_ctx->req.parser,
-						    &http_ctx->req.settings,
-						    http_ctx->req.request_buf +
-						    start,
-						    len);
-			if (parsed_len <= 0) {
-				goto fail;
-			}
+	/* Skip the IP headers in the first fragment */
+	frag = pkt->frags;
+	offset = net_pkt_appdata(pkt) - frag->data;
 
-			http_ctx->req.data_len = 0;
-			len = 0;
-			start = 0;
+	while (frag) {
+		if (conn_recv(conn, frag->data + offset,
+			      frag->len - offset) < 0) {
+			break;
 		}
 
-		memcpy(http_ctx->req.request_buf + http_ctx->req.data_len,
-		       frag->data, frag->len);
-
-		http_ctx->req.data_len += frag->len;
-		len += frag->len;
+		offset = 0;
 		frag = frag->frags;
 	}
 
-out:
-	parsed_len = http_parser_execute(&http_ctx->req.parser,
-					 &http_ctx->req.settings,
-					 http_ctx->req.request_buf + start,
-					 len);
-	if (parsed_len < 0) {
-fail:
-		NET_DBG("Received %u bytes, only parsed %d bytes (%s %s)",
-			recv_len, parsed_len,
-			http_errno_name(http_ctx->req.parser.http_errno),
-			http_errno_description(
-				http_ctx->req.parser.http_errno));
-	}
+	/* The timer is left alone if a response has started it, or if
+	 * the timeout of that response closed the connection meanwhile.
+	 */
+	key = irq_lock();
 
-	if (http_ctx->req.parser.http_errno != HPE_OK) {
-		http_response_400(http_ctx, NULL);
-	} else {
-		http_process_recv(http_ctx);
+	if (!conn->closing && !conn->releasing && conn->net_ctx == net_ctx &&
+	    !k_delayed_work_remaining_get(&conn->timer)) {
+		k_delayed_work_submit(&conn->timer,
+				      CONFIG_HTTP_SERVER_KEEPALIVE_TIMEOUT);
 	}
 
+	irq_unlock(key);
+
 quit:
-	http_parser_init(&http_ctx->req.parser, HTTP_REQUEST);
-	http_ctx->req.data_len = 0;
 	net_pkt_unref(pkt);
 }
 
+static struct http_server_conn *conn_get(struct http_server_ctx *http_ctx)
+{
+	struct http_server_conn *conn, *idle = NULL;
+	int i;
+
+	/* The HTTPS thread serves one TLS session at a time. If we receive
+	 * a new connection, then close the earlier one. Otherwise it is
+	 * possible that the context will be left into TCP ESTABLISHED state
+	 * and would never be released.
+	 */
+	if (http_ctx->is_https) {
+		conn = &http_ctx->conns[0];
+		conn_close(conn);
+
+		return conn->net_ctx ? NULL : conn;
+	}
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		conn = &http_ctx->conns[i];
+
+		if (!conn->net_ctx) {
+			return conn;
+		}
+
+		if (!idle && conn->keep_alive && !conn->data_len &&
+		    !conn->closing) {
+			idle = conn;
+		}
+	}
+
+	/* A client waiting between two requests can reconnect later */
+	if (idle) {
+		NET_DBG("Closing idle connection %p", idle);
+		conn_close(idle);
+
+		/* Unless its timeout is still to close it */
+		if (idle->net_ctx) {
+			return NULL;
+		}
+	}
+
+	return idle;
+}
+
 static void accept_cb(struct net_context *net_ctx,
 		      struct sockaddr *addr, socklen_t addrlen,
 		      int status, void *data)
 {
 	struct http_server_ctx *http_ctx = data;
+	struct http_server_conn *conn;
 
 	ARG_UNUSED(addr);
 	ARG_UNUSED(addrlen);
@@ -738,24 +1160,23 @@ static void accept_cb(struct net_context *net_ctx,
 		return;
 	}
 
-	/* If we receive a HTTP request and if the earlier context is still
-	 * active and it is not the same as the new one, then close the earlier
-	 * one. Otherwise it is possible that the context will be left into
-	 * TCP ESTABLISHED state and would never be released. Example of this
-	 * is that we had IPv4 connection active and then IPv6 connection is
-	 * established, in this case we disconnect the IPv4 here.
-	 */
-	if (http_ctx->req.net_ctx && http_ctx->req.net_ctx != net_ctx &&
-	    net_context_get_state(http_ctx->req.net_ctx) ==
-						      NET_CONTEXT_CONNECTED) {
-		net_context_unref(http_ctx->req.net_ctx);
+	conn = conn_get(http_ctx);
+	if (!conn) {
+		NET_DBG("No free connection for %p", net_ctx);
+		net_context_put(net_ctx);
+		return;
 	}
 
-	http_ctx->req.net_ctx = net_ctx;
+	conn_open(conn, net_ctx);
 
 	new_client(http_ctx, net_ctx, addr);
 
-	net_context_recv(net_ctx, http_ctx->recv_cb, K_NO_WAIT, http_ctx);
+	net_context_recv(net_ctx, http_ctx->recv_cb, K_NO_WAIT, conn);
+
+	if (!http_ctx->is_https) {
+		k_delayed_work_submit(&conn->timer,
+				      CONFIG_HTTP_SERVER_KEEPALIVE_TIMEOUT);
+	}
 }
 
 static int set_net_ctx(struct http_server_ctx *http_ctx,
@@ -771,7 +1192,7 @@ static int set_net_ctx(struct http_server_ctx *http_ctx,
 		goto out;
 	}
 
-	ret = net_context_listen(ctx, 0);
+	ret = net_context_listen(ctx, CONFIG_HTTP_SERVER_CONNECTIONS);
 	if (ret < 0) {
 		NET_ERR("Cannot listen context (%d)", ret);
 		goto out;
@@ -927,12 +1348,12 @@ bool http_server_disable(struct http_server_ctx *http_ctx)
 
 	NET_ASSERT(http_ctx);
 
-	req_timer_cancel(http_ctx);
-
 	old = http_ctx->enabled;
 
 	http_ctx->enabled = false;
 
+	conns_close(http_ctx);
+
 #if defined(CONFIG_HTTPS)
 	if (http_ctx->is_https) {
 		https_disable(http_ctx);
@@ -955,31 +1376,33 @@ int http_server_init(struct http_server_ctx *http_ctx,
 		return -EINVAL;
 	}
 
-	if (!request_buf || request_buf_len == 0) {
+	if (!request_buf ||
+	    request_buf_len < CONFIG_HTTP_SERVER_CONNECTIONS * 2) {
 		NET_ERR("Request buf must be set");
 		return -EINVAL;
 	}
 
-	ret = init_net(http_ctx, server_addr, HTTP_DEFAULT_PORT);
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (server_banner) {
-		new_server(http_ctx, server_banner, server_addr);
-	}
-
 	http_ctx->req.request_buf = request_buf;
 	http_ctx->req.request_buf_len = request_buf_len;
-	http_ctx->req.data_len = 0;
 	http_ctx->urls = urls;
 	http_ctx->recv_cb = http_recv;
 	http_ctx->send_data = net_context_send;
 
-	k_delayed_work_init(&http_ctx->req.timer, req_timeout);
+	conns_init(http_ctx, CONFIG_HTTP_SERVER_CONNECTIONS,
+		   request_buf_len / CONFIG_HTTP_SERVER_CONNECTIONS);
 
 	parser_init(http_ctx);
 
+	ret = init_net(http_ctx, server_addr, HTTP_DEFAULT_PORT);
+	if (ret < 0) {
+		http_ctx->urls = NULL;
+		return ret;
+	}
+
+	if (server_banner) {
+		new_server(http_ctx, server_banner, server_addr);
+	}
+
 	return 0;
 }
 
@@ -1004,6 +1427,7 @@ void http_server_release(struct http_server_ctx *http_ctx)
 	}
 #endif
 
+	http_ctx->req.conn = NULL;
 	http_ctx->req.net_ctx = NULL;
 	http_ctx->urls = NULL;
 }
@@ -1060,6 +1484,15 @@ static void my_debug(void *ctx, int level,
 
 #define BUF_ALLOC_TIMEOUT 100
 
+#if defined(MBEDTLS_SSL_TICKET_C)
+/* The session tickets are encrypted with an AEAD cipher */
+#if defined(MBEDTLS_GCM_C)
+#define TICKET_CIPHER MBEDTLS_CIPHER_AES_128_GCM
+#else
+#define TICKET_CIPHER MBEDTLS_CIPHER_AES_128_CCM
+#endif
+#endif /* MBEDTLS_SSL_TICKET_C */
+
 /* Receive encrypted data from network. Put that data into fifo
  * that will be read by https thread.
  */
@@ -1068,7 +1501,8 @@ static void ssl_received(struct net_context *context,
 			 int status,
 			 void *user_data)
 {
-	struct http_server_ctx *http_ctx = user_data;
+	struct http_server_conn *conn = user_data;
+	struct http_server_ctx *http_ctx = conn->ctx;
 	struct rx_fifo_block *rx_data = NULL;
 	struct k_mem_block block;
 	int ret;
@@ -1224,10 +1658,15 @@ static void ssl_sent(struct net_context *context,
 static int ssl_tx(void *context, const unsigned char *buf, size_t size)
 {
 	struct http_server_ctx *ctx = context;
+	struct net_context *net_ctx = ctx->conns[0].net_ctx;
 	struct net_pkt *send_buf;
 	int ret, len;
 
-	send_buf = net_pkt_get_tx(ctx->req.net_ctx, BUF_ALLOC_TIMEOUT);
+	if (!net_ctx) {
+		return MBEDTLS_ERR_NET_CONN_RESET;
+	}
+
+	send_buf = net_pkt_get_tx(net_ctx, BUF_ALLOC_TIMEOUT);
 	if (!send_buf) {
 		return MBEDTLS_ERR_SSL_ALLOC_FAILED;
 	}
@@ -1279,14 +1718,18 @@ static int https_send(struct net_pkt *pkt,
 		      void *token,
 		      void *user_data)
 {
-	struct http_server_ctx *ctx = user_data;
+	struct http_server_conn *conn = user_data;
+	struct http_server_ctx *ctx = conn->ctx;
+	u8_t *buf;
 	int ret;
 	u16_t len;
 
 	len = net_pkt_appdatalen(pkt);
 
-	ret = net_frag_linearize(ctx->req.request_buf,
-				 ctx->req.request_buf_len,
+	/* The response goes to the second half of the request buffer */
+	buf = conn->buf + conn->buf_len + 1;
+
+	ret = net_frag_linearize(buf, ctx->req.request_buf_len / 2,
 				 pkt, net_pkt_ip_hdr_len(pkt),
 				 len);
 	if (ret < 0) {
@@ -1300,8 +1743,7 @@ static int https_send(struct net_pkt *pkt,
 	}
 
 	do {
-		ret = mbedtls_ssl_write(&ctx->https.mbedtls.ssl,
-					ctx->req.request_buf, len);
+		ret = mbedtls_ssl_write(&ctx->https.mbedtls.ssl, buf, len);
 		if (ret == MBEDTLS_ERR_NET_CONN_RESET) {
 			print_error("peer closed the connection -0x%x", ret);
 			goto out;
@@ -1319,15 +1761,22 @@ static int https_send(struct net_pkt *pkt,
 
 out:
 	if (cb) {
-		cb(net_pkt_context(pkt), ret, token, user_data);
+		cb(net_pkt_context(pkt), ret < 0 ? ret : 0, token, user_data);
 	}
 
-	return ret;
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* The data was encrypted to other packets */
+	net_pkt_unref(pkt);
+
+	return 0;
 }
 
 static void https_handler(struct http_server_ctx *ctx)
 {
-	size_t len;
+	u8_t data[128];
 	int ret;
 
 	NET_DBG("HTTPS handler starting");
@@ -1406,6 +1855,36 @@ static void https_handler(struct http_server_ctx *ctx)
 	}
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
+	/* The clients that come back can resume their session with an
+	 * abbreviated handshake, which skips the key exchange.
+	 */
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_init(&ctx->https.mbedtls.cache);
+	mbedtls_ssl_conf_session_cache(&ctx->https.mbedtls.conf,
+				       &ctx->https.mbedtls.cache,
+				       mbedtls_ssl_cache_get,
+				       mbedtls_ssl_cache_set);
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_init(&ctx->https.mbedtls.ticket_ctx);
+
+	ret = mbedtls_ssl_ticket_setup(&ctx->https.mbedtls.ticket_ctx,
+				       mbedtls_ctr_drbg_random,
+				       &ctx->https.mbedtls.ctr_drbg,
+				       TICKET_CIPHER,
+				       MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME);
+	if (ret != 0) {
+		print_error("mbedtls_ssl_ticket_setup returned -0x%x", ret);
+		goto exit;
+	}
+
+	mbedtls_ssl_conf_session_tickets_cb(&ctx->https.mbedtls.conf,
+					    mbedtls_ssl_ticket_write,
+					    mbedtls_ssl_ticket_parse,
+					    &ctx->https.mbedtls.ticket_ctx);
+#endif
+
 	ret = mbedtls_ssl_setup(&ctx->https.mbedtls.ssl,
 				&ctx->https.mbedtls.conf);
 	if (ret != 0) {
@@ -1438,11 +1917,8 @@ reset:
 	/* Read the HTTPS Request */
 	NET_DBG("Read HTTPS request");
 	do {
-		len = ctx->req.request_buf_len - 1;
-		memset(ctx->req.request_buf, 0, ctx->req.request_buf_len);
-
-		ret = mbedtls_ssl_read(&ctx->https.mbedtls.ssl,
-				       ctx->req.request_buf, len);
+		ret = mbedtls_ssl_read(&ctx->https.mbedtls.ssl, data,
+				       sizeof(data));
 		if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
 		    ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
 			continue;
@@ -1467,24 +1943,13 @@ reset:
 			goto close;
 		}
 
-		ret = http_parser_execute(&ctx->req.parser,
-					  &ctx->req.settings,
-					  ctx->req.request_buf,
-					  ret);
-	} while (ret < 0);
-
-	/* Write the Response */
-	NET_DBG("Write HTTPS response");
-
-	if (ctx->req.parser.http_errno != HPE_OK) {
-		http_response_400(ctx, NULL);
-	} else {
-		http_process_recv(ctx);
-	}
+		/* The response is written when the request is complete, the
+		 * connection is then closing.
+		 */
+		ret = conn_recv(&ctx->conns[0], data, ret);
+	} while (ret >= 0);
 
 close:
-	http_parser_init(&ctx->req.parser, HTTP_REQUEST);
-
 	mbedtls_ssl_close_notify(&ctx->https.mbedtls.ssl);
 
 	goto reset;
@@ -1519,6 +1984,13 @@ static void https_disable(struct http_server_ctx *ctx)
 	mbedtls_ctr_drbg_free(&ctx->https.mbedtls.ctr_drbg);
 	mbedtls_entropy_free(&ctx->https.mbedtls.entropy);
 
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_free(&ctx->https.mbedtls.cache);
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_free(&ctx->https.mbedtls.ticket_ctx);
+#endif
+
 	/* Empty the fifo just in case there is any received packets
 	 * still there.
 	 */
@@ -1581,7 +2053,7 @@ int https_server_init(struct http_server_ctx *ctx,
 		return -EALREADY;
 	}
 
-	if (!request_buf || request_buf_len == 0) {
+	if (!request_buf || request_buf_len < 4) {
 		NET_ERR("Request buf must be set");
 		return -EINVAL;
 	}
@@ -1591,18 +2063,8 @@ int https_server_init(struct http_server_ctx *ctx,
 		return -EINVAL;
 	}
 
-	ret = init_net(ctx, server_addr, HTTPS_DEFAULT_PORT);
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (server_banner) {
-		new_server(ctx, server_banner, server_addr);
-	}
-
 	ctx->req.request_buf = request_buf;
 	ctx->req.request_buf_len = request_buf_len;
-	ctx->req.data_len = 0;
 	ctx->urls = urls;
 	ctx->is_https = true;
 	ctx->https.stack = https_stack;
@@ -1621,10 +2083,23 @@ int https_server_init(struct http_server_ctx *ctx,
 	ctx->send_data = https_send;
 	ctx->recv_cb = ssl_received;
 
-	k_delayed_work_init(&ctx->req.timer, req_timeout);
+	/* A single connection, the second half of the buffer holds the
+	 * response before it is encrypted.
+	 */
+	conns_init(ctx, 1, request_buf_len / 2);
 
 	parser_init(ctx);
 
+	ret = init_net(ctx, server_addr, HTTPS_DEFAULT_PORT);
+	if (ret < 0) {
+		ctx->urls = NULL;
+		return ret;
+	}
+
+	if (server_banner) {
+		new_server(ctx, server_banner, server_addr);
+	}
+
 	/* Then mbedtls specific initialization */
 	return https_init(ctx);
 }
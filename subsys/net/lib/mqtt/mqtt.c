@@ -10,6 +10,8 @@
 #include <net/net_ip.h>
 #include <net/net_pkt.h>
 #include <net/buf.h>
+#include <misc/byteorder.h>
+#include <string.h>
 #include <errno.h>
 
 #define MSG_SIZE	CONFIG_MQTT_MSG_MAX_SIZE
@@ -21,7 +23,306 @@
  */
 NET_BUF_POOL_DEFINE(mqtt_msg_pool, MQTT_BUF_CTR, MSG_SIZE, 0, NULL);
 
-#define MQTT_PUBLISHER_MIN_MSG_SIZE	2
+/* Memory pool used to reassemble the incoming messages that are split between
+ * several TCP segments. A buffer is held by a context until the end of the
+ * message, so it is kept apart from the pool used to send the messages.
+ */
+NET_BUF_POOL_DEFINE(mqtt_rx_pool, MQTT_BUF_CTR, MSG_SIZE, 0, NULL);
+
+/* Fixed header: packet type byte and up to 4 Remaining Length bytes */
+#define MQTT_FIXED_HEADER_MAX_SIZE	5
+
+/* States of the incoming message decoder */
+enum mqtt_rx_state {
+	/* Reading the fixed header of a new message */
+	MQTT_RX_FIXED_HEADER,
+	/* Reading the rest of a message, to parse it as a whole */
+	MQTT_RX_BODY,
+	/* Reading the topic length of a PUBLISH message */
+	MQTT_RX_TOPIC_LEN,
+	/* Reading the topic and the packet id of a PUBLISH message */
+	MQTT_RX_PUBLISH_HEADER,
+	/* Passing the payload of a PUBLISH message to the application */
+	MQTT_RX_PAYLOAD,
+	/* Discarding the rest of a message */
+	MQTT_RX_SKIP,
+};
+
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+#define INFLIGHT_WINDOW	CONFIG_MQTT_INFLIGHT_WINDOW
+
+/* Copies of the QoS 1 and QoS 2 PUBLISH messages waiting for an
+ * acknowledgement, kept to send them again when the session is resumed.
+ */
+NET_BUF_POOL_DEFINE(mqtt_inflight_pool, INFLIGHT_WINDOW * MQTT_BUF_CTR,
+		    MSG_SIZE, 0, NULL);
+#endif
+
+static void mqtt_rx_reset(struct mqtt_ctx *ctx)
+{
+	if (ctx->rx_buf) {
+		net_buf_unref(ctx->rx_buf);
+		ctx->rx_buf = NULL;
+	}
+
+	ctx->rx_state = MQTT_RX_FIXED_HEADER;
+	ctx->rx_remaining = 0;
+}
+
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+/**
+ * Sends a copy of a packed MQTT message
+ *
+ * @param [in] ctx MQTT context
+ * @param [in] data Packed message
+ * @param [in] len Length of the message
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if a tx buffer is not available
+ * @retval -EIO on network error
+ */
+static
+int mqtt_tx_copy(struct mqtt_ctx *ctx, u8_t *data, u16_t len)
+{
+	struct net_pkt *tx;
+	int rc;
+
+	tx = net_pkt_get_tx(ctx->net_ctx, ctx->net_timeout);
+	if (tx == NULL) {
+		return -ENOMEM;
+	}
+
+	if (!net_pkt_append_all(tx, len, data, ctx->net_timeout)) {
+		net_pkt_unref(tx);
+		return -ENOMEM;
+	}
+
+	rc = net_context_send(tx, NULL, ctx->net_timeout, NULL, NULL);
+	if (rc < 0) {
+		net_pkt_unref(tx);
+	}
+
+	return rc;
+}
+
+/* The window is a hash table indexed by the Packet Identifier, collisions
+ * are resolved by probing the next slots.
+ */
+static
+struct mqtt_inflight *inflight_find(struct mqtt_ctx *ctx, u16_t pkt_id)
+{
+	struct mqtt_inflight *slot;
+	int i;
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		slot = &ctx->inflight[(pkt_id + i) % INFLIGHT_WINDOW];
+
+		if (slot->wait != MQTT_INVALID && slot->pkt_id == pkt_id) {
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+static
+struct mqtt_inflight *inflight_alloc(struct mqtt_ctx *ctx, u16_t pkt_id)
+{
+	struct mqtt_inflight *slot;
+	int i;
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		slot = &ctx->inflight[(pkt_id + i) % INFLIGHT_WINDOW];
+
+		if (slot->wait == MQTT_INVALID) {
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+static
+void inflight_release(struct mqtt_ctx *ctx, struct mqtt_inflight *slot)
+{
+	if (slot->buf) {
+		net_buf_unref(slot->buf);
+		slot->buf = NULL;
+	}
+
+	slot->wait = MQTT_INVALID;
+
+	k_sem_give(&ctx->inflight_sem);
+}
+
+static
+void inflight_clear(struct mqtt_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < INFLIGHT_WINDOW; i++) {
+		if (ctx->inflight[i].wait != MQTT_INVALID) {
+			inflight_release(ctx, &ctx->inflight[i]);
+		}
+	}
+}
+
+/**
+ * Sends the in-flight messages again, in the order they were first sent.
+ * See MQTT 4.4 Message delivery retry
+ *
+ * @param [in] ctx MQTT context
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if a tx buffer is not available
+ * @retval -EIO on network error
+ */
+static
+int inflight_resend(struct mqtt_ctx *ctx)
+{
+	struct mqtt_inflight *slot, *next, *prev = NULL;
+	int rc = 0;
+	int i;
+
+	do {
+		next = NULL;
+
+		for (i = 0; i < INFLIGHT_WINDOW; i++) {
+			slot = &ctx->inflight[i];
+
+			if (slot->wait == MQTT_INVALID) {
+				continue;
+			}
+
+			if (prev && (s32_t)(slot->seq - prev->seq) <= 0) {
+				continue;
+			}
+
+			if (!next || (s32_t)(slot->seq - next->seq) < 0) {
+				next = slot;
+			}
+		}
+
+		if (!next) {
+			break;
+		}
+
+		prev = next;
+
+		if (next->wait == MQTT_PUBCOMP) {
+			rc = mqtt_tx_pubrel(ctx, next->pkt_id);
+		} else {
+			/* Set the DUP flag, see MQTT 3.3.1.1 */
+			next->buf->data[0] |= 0x08;
+			rc = mqtt_tx_copy(ctx, next->buf->data, next->buf->len);
+		}
+	} while (rc >= 0);
+
+	return rc < 0 ? rc : 0;
+}
+
+/**
+ * Sends a QoS 1 or QoS 2 MQTT PUBLISH msg and keeps a copy of it until it
+ * is acknowledged
+ *
+ * @param [in] ctx MQTT context
+ * @param [in] msg MQTT PUBLISH msg
+ *
+ * @retval 0 on success
+ * @retval -EAGAIN if the window is still full after the network timeout
+ * @retval -EINVAL
+ * @retval -ENOMEM
+ * @retval -EIO
+ */
+static
+int inflight_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
+{
+	struct mqtt_inflight *slot;
+	struct net_buf *buf;
+	int rc;
+
+	if (k_sem_take(&ctx->inflight_sem, ctx->net_timeout) != 0) {
+		return -EAGAIN;
+	}
+
+	/* The Packet Identifier is not released yet, see MQTT 2.3.1 */
+	if (inflight_find(ctx, msg->pkt_id)) {
+		k_sem_give(&ctx->inflight_sem);
+		return -EINVAL;
+	}
+
+	buf = net_buf_alloc(&mqtt_inflight_pool, ctx->net_timeout);
+	if (buf == NULL) {
+		k_sem_give(&ctx->inflight_sem);
+		return -ENOMEM;
+	}
+
+	rc = mqtt_pack_publish(buf->data, &buf->len, buf->size, msg);
+	if (rc != 0) {
+		net_buf_unref(buf);
+		k_sem_give(&ctx->inflight_sem);
+		return -EINVAL;
+	}
+
+	/* The acknowledgement may be received before the send returns */
+	slot = inflight_alloc(ctx, msg->pkt_id);
+	slot->buf = buf;
+	slot->pkt_id = msg->pkt_id;
+	slot->seq = ctx->inflight_seq++;
+	slot->wait = msg->qos == MQTT_QoS1 ? MQTT_PUBACK : MQTT_PUBREC;
+
+	rc = mqtt_tx_copy(ctx, buf->data, buf->len);
+	if (rc < 0) {
+		inflight_release(ctx, slot);
+	}
+
+	return rc;
+}
+
+/**
+ * Matches an acknowledgement with an in-flight message
+ *
+ * @param [in] ctx MQTT context
+ * @param [in] pkt_id Packet Identifier of the acknowledgement
+ * @param [in] type MQTT_PUBACK, MQTT_PUBREC or MQTT_PUBCOMP
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if no message waits for this acknowledgement
+ */
+static
+int inflight_ack(struct mqtt_ctx *ctx, u16_t pkt_id, enum mqtt_packet type)
+{
+	struct mqtt_inflight *slot;
+
+	slot = inflight_find(ctx, pkt_id);
+	if (!slot) {
+		return -EINVAL;
+	}
+
+	/* A PUBREC msg may be received again if our PUBREL msg was lost */
+	if (type == MQTT_PUBREC && slot->wait == MQTT_PUBCOMP) {
+		return 0;
+	}
+
+	if (slot->wait != type) {
+		return -EINVAL;
+	}
+
+	if (type == MQTT_PUBREC) {
+		/* Only the PUBREL msg is sent again from now on */
+		net_buf_unref(slot->buf);
+		slot->buf = NULL;
+		slot->wait = MQTT_PUBCOMP;
+	} else {
+		inflight_release(ctx, slot);
+	}
+
+	return 0;
+}
+#else
+#define inflight_clear(...)
+#define inflight_resend(...) 0
+#endif
 
 int mqtt_tx_connect(struct mqtt_ctx *ctx, struct mqtt_connect_msg *msg)
 {
@@ -98,6 +399,9 @@ int mqtt_tx_disconnect(struct mqtt_ctx *ctx)
 	ctx->connected = 0;
 	tx = NULL;
 
+	/* A message that is still partially received is dropped */
+	mqtt_rx_reset(ctx);
+
 	if (ctx->disconnect) {
 		ctx->disconnect(ctx);
 	}
@@ -204,6 +508,12 @@ int mqtt_tx_publish(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
 	struct net_pkt *tx = NULL;
 	int rc;
 
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+	if (msg->qos != MQTT_QoS0) {
+		return inflight_publish(ctx, msg);
+	}
+#endif
+
 	data = net_buf_alloc(&mqtt_msg_pool, ctx->net_timeout);
 	if (data == NULL) {
 		return -ENOMEM;
@@ -396,8 +706,16 @@ int mqtt_rx_connack(struct mqtt_ctx *ctx, struct net_buf *rx, int clean_session)
 		break;
 	/* previous session */
 	case 0:
-		/* TODO */
-		/* FALLTHROUGH */
+		/* server connection return code is OK, the server may or may
+		 * not have kept the session
+		 */
+		if (connect_rc == 0) {
+			rc = 0;
+		} else {
+			rc = -EINVAL;
+			goto exit_connect;
+		}
+		break;
 	default:
 		rc = -EINVAL;
 		goto exit_connect;
@@ -405,6 +723,15 @@ int mqtt_rx_connack(struct mqtt_ctx *ctx, struct net_buf *rx, int clean_session)
 
 	ctx->connected = 1;
 
+	/* The unacknowledged messages are sent again when the session is
+	 * resumed, and discarded otherwise. See MQTT 3.2.2.2
+	 */
+	if (session) {
+		rc = inflight_resend(ctx);
+	} else {
+		inflight_clear(ctx);
+	}
+
 	if (ctx->connect) {
 		ctx->connect(ctx);
 	}
@@ -467,6 +794,15 @@ int mqtt_rx_pub_msgs(struct mqtt_ctx *ctx, struct net_buf *rx,
 		return -EINVAL;
 	}
 
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+	if (type != MQTT_PUBREL) {
+		rc = inflight_ack(ctx, pkt_id, type);
+		if (rc != 0) {
+			return -EINVAL;
+		}
+	}
+#endif
+
 	/* Only MQTT_APP_SUBSCRIBER, MQTT_APP_PUBLISHER_SUBSCRIBER and
 	 * MQTT_APP_SERVER apps must receive the MQTT_PUBREL msg.
 	 */
@@ -590,27 +926,33 @@ int mqtt_rx_unsuback(struct mqtt_ctx *ctx, struct net_buf *rx)
 	return 0;
 }
 
-int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
+/**
+ * Passes a received MQTT PUBLISH message to the application, and answers it
+ * according to its QoS
+ *
+ * @param ctx MQTT context
+ * @param msg MQTT PUBLISH message
+ *
+ * @retval 0 on success
+ * @retval -EINVAL
+ * @retval -ENOMEM
+ */
+static
+int mqtt_rx_publish_done(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg)
 {
-	struct mqtt_publish_msg msg;
 	int rc;
 
-	rc = mqtt_unpack_publish(rx->data, rx->len, &msg);
-	if (rc != 0) {
-		return -EINVAL;
-	}
-
-	rc = ctx->publish_rx(ctx, &msg, msg.pkt_id, MQTT_PUBLISH);
+	rc = ctx->publish_rx(ctx, msg, msg->pkt_id, MQTT_PUBLISH);
 	if (rc != 0) {
 		return -EINVAL;
 	}
 
-	switch (msg.qos) {
+	switch (msg->qos) {
 	case MQTT_QoS2:
-		rc = mqtt_tx_pubrec(ctx, msg.pkt_id);
+		rc = mqtt_tx_pubrec(ctx, msg->pkt_id);
 		break;
 	case MQTT_QoS1:
-		rc = mqtt_tx_puback(ctx, msg.pkt_id);
+		rc = mqtt_tx_puback(ctx, msg->pkt_id);
 		break;
 	case MQTT_QoS0:
 		break;
@@ -621,82 +963,40 @@ int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
 	return rc;
 }
 
-/**
- * Linearizes an IP fragmented packet
- *
- * @param [in] ctx MQTT context structure
- * @param [in] rx RX IP stack packet
- * @param [in] min_size Min message size allowed. This allows us to exit if the
- * rx packet is shorter than the expected msg size
- *
- * @retval Data buffer
- * @retval NULL on error
- */
-static
-struct net_buf *mqtt_linearize_packet(struct mqtt_ctx *ctx, struct net_pkt *rx,
-				      u16_t min_size)
+int mqtt_rx_publish(struct mqtt_ctx *ctx, struct net_buf *rx)
 {
-	struct net_buf *data = NULL;
-	u16_t data_len;
-	u16_t offset;
+	struct mqtt_publish_msg msg;
 	int rc;
 
-	/* CONFIG_MQTT_MSG_MAX_SIZE is defined via Kconfig. So here it's
-	 * determined if the input packet could fit our data buffer or if
-	 * it has the expected size.
-	 */
-	data_len = net_pkt_appdatalen(rx);
-	if (data_len < min_size || data_len > CONFIG_MQTT_MSG_MAX_SIZE) {
-		return NULL;
-	}
-
-	data = net_buf_alloc(&mqtt_msg_pool, ctx->net_timeout);
-	if (data == NULL) {
-		return NULL;
-	}
-
-	offset = net_pkt_get_len(rx) - data_len;
-	rc = net_frag_linear_copy(data, rx->frags, offset, data_len);
+	rc = mqtt_unpack_publish(rx->data, rx->len, &msg);
 	if (rc != 0) {
-		goto exit_error;
+		return -EINVAL;
 	}
 
-	return data;
-
-exit_error:
-	net_pkt_frag_unref(data);
-
-	return NULL;
+	return mqtt_rx_publish_done(ctx, &msg);
 }
 
 /**
- * Calls the appropriate rx routine for the MQTT message contained in rx
+ * Calls the appropriate rx routine for the MQTT message contained in data
  *
  * @details On error, this routine will execute the 'ctx->malformed' callback
  * (if defined)
  *
  * @param ctx MQTT context
- * @param rx RX packet
+ * @param data Data buffer holding the whole message
  *
  * @retval 0 on success
  * @retval -EINVAL if an unknown message is received
- * @retval -ENOMEM if no data buffer is available
  * @retval mqtt_rx_connack, mqtt_rx_pingresp, mqtt_rx_puback, mqtt_rx_pubcomp,
  *         mqtt_rx_publish, mqtt_rx_pubrec, mqtt_rx_pubrel and mqtt_rx_suback
  *         return codes
  */
 static
-int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
+int mqtt_rx_message(struct mqtt_ctx *ctx, struct net_buf *data)
 {
 	u16_t pkt_type = MQTT_INVALID;
-	struct net_buf *data = NULL;
 	int rc = -EINVAL;
 
-	data = mqtt_linearize_packet(ctx, rx, MQTT_PUBLISHER_MIN_MSG_SIZE);
-	if (!data) {
-		return -ENOMEM;
-	}
-
 	pkt_type = MQTT_PACKET_TYPE(data->data[0]);
 
 	switch (pkt_type) {
@@ -737,7 +1037,359 @@ int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
 		ctx->malformed(ctx, pkt_type);
 	}
 
-	net_pkt_frag_unref(data);
+	return rc;
+}
+
+/**
+ * Discards the rest of the current message
+ *
+ * @param ctx MQTT context
+ * @param rc Error to report
+ *
+ * @retval rc
+ */
+static
+int mqtt_rx_skip(struct mqtt_ctx *ctx, int rc)
+{
+	u16_t pkt_type = MQTT_INVALID;
+
+	if (ctx->rx_buf && ctx->rx_buf->len) {
+		pkt_type = MQTT_PACKET_TYPE(ctx->rx_buf->data[0]);
+	}
+
+	if (ctx->malformed) {
+		ctx->malformed(ctx, pkt_type);
+	}
+
+	if (ctx->rx_remaining) {
+		net_buf_unref(ctx->rx_buf);
+		ctx->rx_buf = NULL;
+		ctx->rx_state = MQTT_RX_SKIP;
+	} else {
+		mqtt_rx_reset(ctx);
+	}
+
+	return rc;
+}
+
+/**
+ * Handles the end of the fixed header of a message, and selects how the rest
+ * of the message is read
+ *
+ * @param ctx MQTT context
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the fixed header is invalid
+ * @retval -EMSGSIZE if the message is too large
+ * @retval mqtt_rx_message return codes, for messages without payload
+ */
+static
+int mqtt_rx_fixed_header(struct mqtt_ctx *ctx)
+{
+	struct net_buf *buf = ctx->rx_buf;
+	u32_t mult = 1;
+	u16_t i;
+	int rc;
+
+	if (buf->len < 2) {
+		return 0;
+	}
+
+	/* Continuation bit: more Remaining Length bytes follow */
+	if (buf->data[buf->len - 1] & 0x80) {
+		if (buf->len == MQTT_FIXED_HEADER_MAX_SIZE) {
+			return mqtt_rx_skip(ctx, -EINVAL);
+		}
+
+		return 0;
+	}
+
+	ctx->rx_remaining = 0;
+
+	for (i = 1; i < buf->len; i++) {
+		ctx->rx_remaining += (buf->data[i] & 0x7f) * mult;
+		mult *= 128;
+	}
+
+	if (MQTT_PACKET_TYPE(buf->data[0]) == MQTT_PUBLISH &&
+	    ctx->publish_payload) {
+		ctx->rx_state = MQTT_RX_TOPIC_LEN;
+		ctx->rx_need = sizeof(u16_t);
+	} else {
+		if (ctx->rx_remaining > net_buf_tailroom(buf)) {
+			return mqtt_rx_skip(ctx, -EMSGSIZE);
+		}
+
+		ctx->rx_state = MQTT_RX_BODY;
+		ctx->rx_need = ctx->rx_remaining;
+	}
+
+	if (ctx->rx_need > ctx->rx_remaining) {
+		return mqtt_rx_skip(ctx, -EINVAL);
+	}
+
+	if (ctx->rx_state == MQTT_RX_BODY && !ctx->rx_need) {
+		rc = mqtt_rx_message(ctx, buf);
+		mqtt_rx_reset(ctx);
+
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Handles the end of the topic and packet id of a PUBLISH message, the
+ * payload is then passed to the application as it is received
+ *
+ * @param ctx MQTT context
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the message is invalid
+ * @retval -EMSGSIZE if the topic is too large
+ * @retval mqtt_rx_publish_done return codes, for an empty payload
+ */
+static
+int mqtt_rx_publish_header(struct mqtt_ctx *ctx)
+{
+	struct mqtt_publish_msg *msg = &ctx->rx_publish;
+	struct net_buf *buf = ctx->rx_buf;
+	u8_t type = buf->data[0];
+	int rc;
+
+	if (ctx->rx_state == MQTT_RX_TOPIC_LEN) {
+		msg->dup = (type & 0x08) >> 3;
+		msg->qos = (type & 0x06) >> 1;
+		msg->retain = type & 0x01;
+
+		if (msg->qos > MQTT_QoS2) {
+			return mqtt_rx_skip(ctx, -EINVAL);
+		}
+
+		msg->topic_len = sys_get_be16(buf->data + buf->len -
+					      sizeof(u16_t));
+		msg->topic = (char *)net_buf_tail(buf);
+
+		ctx->rx_state = MQTT_RX_PUBLISH_HEADER;
+		ctx->rx_need = msg->topic_len;
+
+		if (msg->qos != MQTT_QoS0) {
+			ctx->rx_need += sizeof(u16_t);
+		}
+
+		if (ctx->rx_need > net_buf_tailroom(buf)) {
+			return mqtt_rx_skip(ctx, -EMSGSIZE);
+		}
+
+		if (ctx->rx_need > ctx->rx_remaining) {
+			return mqtt_rx_skip(ctx, -EINVAL);
+		}
+
+		if (ctx->rx_need) {
+			return 0;
+		}
+	}
+
+	if (msg->qos != MQTT_QoS0) {
+		msg->pkt_id = sys_get_be16(buf->data + buf->len -
+					   sizeof(u16_t));
+	} else {
+		msg->pkt_id = 0;
+	}
+
+	msg->msg = NULL;
+	msg->msg_len = 0;
+
+	ctx->rx_payload_len = ctx->rx_remaining;
+	ctx->rx_state = MQTT_RX_PAYLOAD;
+
+	if (ctx->rx_remaining) {
+		return 0;
+	}
+
+	rc = mqtt_rx_publish_done(ctx, msg);
+	if (rc != 0) {
+		return mqtt_rx_skip(ctx, rc);
+	}
+
+	mqtt_rx_reset(ctx);
+
+	return 0;
+}
+
+/**
+ * Passes a part of the payload of a PUBLISH message to the application,
+ * without copying it
+ *
+ * @param ctx MQTT context
+ * @param data Payload data, inside a network buffer
+ * @param len Length of the data
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the application rejected the message
+ * @retval mqtt_rx_publish_done return codes, for the last part
+ */
+static
+int mqtt_rx_payload(struct mqtt_ctx *ctx, u8_t *data, u16_t len)
+{
+	struct mqtt_publish_msg *msg = &ctx->rx_publish;
+	u32_t offset = ctx->rx_payload_len - ctx->rx_remaining;
+	int rc;
+
+	msg->msg = data;
+	msg->msg_len = len;
+
+	rc = ctx->publish_payload(ctx, msg, offset, ctx->rx_payload_len);
+
+	ctx->rx_remaining -= len;
+
+	if (rc != 0) {
+		return mqtt_rx_skip(ctx, -EINVAL);
+	}
+
+	if (ctx->rx_remaining) {
+		return 0;
+	}
+
+	msg->msg = NULL;
+	msg->msg_len = 0;
+
+	rc = mqtt_rx_publish_done(ctx, msg);
+	if (rc != 0) {
+		return mqtt_rx_skip(ctx, rc);
+	}
+
+	mqtt_rx_reset(ctx);
+
+	return 0;
+}
+
+/**
+ * Feeds the decoder with a part of the incoming MQTT stream
+ *
+ * @details The decoder keeps its state between calls, so messages may be
+ * split at any byte, and several messages may be passed in one call.
+ *
+ * @param ctx MQTT context
+ * @param data Stream data
+ * @param len Length of the data
+ *
+ * @retval 0 on success
+ * @retval -ENOMEM if no data buffer is available
+ * @retval Error of the last message that failed otherwise
+ */
+static
+int mqtt_rx_stream(struct mqtt_ctx *ctx, u8_t *data, u16_t len)
+{
+	int rc = 0;
+	u16_t size;
+	int ret;
+
+	while (len) {
+		switch (ctx->rx_state) {
+		case MQTT_RX_FIXED_HEADER:
+			if (!ctx->rx_buf) {
+				ctx->rx_buf = net_buf_alloc(&mqtt_rx_pool,
+							    ctx->net_timeout);
+				if (!ctx->rx_buf) {
+					return -ENOMEM;
+				}
+			}
+
+			net_buf_add_u8(ctx->rx_buf, *data);
+			size = 1;
+
+			ret = mqtt_rx_fixed_header(ctx);
+			break;
+		case MQTT_RX_BODY:
+		case MQTT_RX_TOPIC_LEN:
+		case MQTT_RX_PUBLISH_HEADER:
+			size = min(len, ctx->rx_need);
+
+			net_buf_add_mem(ctx->rx_buf, data, size);
+			ctx->rx_need -= size;
+			ctx->rx_remaining -= size;
+
+			if (ctx->rx_need) {
+				ret = 0;
+			} else if (ctx->rx_state == MQTT_RX_BODY) {
+				ret = mqtt_rx_message(ctx, ctx->rx_buf);
+				mqtt_rx_reset(ctx);
+			} else {
+				ret = mqtt_rx_publish_header(ctx);
+			}
+			break;
+		case MQTT_RX_PAYLOAD:
+			size = min(len, ctx->rx_remaining);
+
+			ret = mqtt_rx_payload(ctx, data, size);
+			break;
+		case MQTT_RX_SKIP:
+		default:
+			size = min(len, ctx->rx_remaining);
+
+			ctx->rx_remaining -= size;
+			if (!ctx->rx_remaining) {
+				mqtt_rx_reset(ctx);
+			}
+
+			ret = 0;
+			break;
+		}
+
+		if (ret != 0) {
+			rc = ret;
+		}
+
+		data += size;
+		len -= size;
+	}
+
+	return rc;
+}
+
+/**
+ * Parses the MQTT messages contained in the rx packet
+ *
+ * @details The data is read from the fragments of the packet, and the
+ * messages may span several packets.
+ *
+ * @param ctx MQTT context
+ * @param rx RX packet
+ *
+ * @retval 0 on success
+ * @retval mqtt_rx_stream return codes
+ */
+static
+int mqtt_parser(struct mqtt_ctx *ctx, struct net_pkt *rx)
+{
+	struct net_buf *frag;
+	u16_t offset;
+	int rc = 0;
+	int ret;
+
+	offset = net_pkt_get_len(rx) - net_pkt_appdatalen(rx);
+
+	for (frag = rx->frags; frag; frag = frag->frags) {
+		if (offset >= frag->len) {
+			offset -= frag->len;
+			continue;
+		}
+
+		ret = mqtt_rx_stream(ctx, frag->data + offset,
+				     frag->len - offset);
+
+		/* The rest of the packet cannot be parsed without a buffer */
+		if (ret == -ENOMEM) {
+			return ret;
+		}
+
+		if (ret != 0) {
+			rc = ret;
+		}
+
+		offset = 0;
+	}
 
 	return rc;
 }
@@ -767,13 +1419,22 @@ lb_exit:
 
 int mqtt_init(struct mqtt_ctx *ctx, enum mqtt_app app_type)
 {
-	/* So far, only clean session = 1 is supported */
+	/* Updated by mqtt_tx_connect */
 	ctx->clean_session = 1;
 	ctx->connected = 0;
 
 	ctx->app_type = app_type;
 	ctx->rcv = mqtt_parser;
 
+	ctx->rx_buf = NULL;
+	mqtt_rx_reset(ctx);
+
+#if CONFIG_MQTT_INFLIGHT_WINDOW > 0
+	memset(ctx->inflight, 0, sizeof(ctx->inflight));
+	ctx->inflight_seq = 0;
+	k_sem_init(&ctx->inflight_sem, INFLIGHT_WINDOW, INFLIGHT_WINDOW);
+#endif
+
 	/* Install the receiver callback, timeout is set to K_NO_WAIT.
 	 * In this case, no return code is evaluated.
 	 */
@@ -781,3 +1442,15 @@ int mqtt_init(struct mqtt_ctx *ctx, enum mqtt_app app_type)
 
 	return 0;
 }
+
+int mqtt_reconnect(struct mqtt_ctx *ctx, struct net_context *net_ctx)
+{
+	ctx->net_ctx = net_ctx;
+	ctx->connected = 0;
+
+	mqtt_rx_reset(ctx);
+
+	(void)net_context_recv(ctx->net_ctx, mqtt_recv, K_NO_WAIT, ctx);
+
+	return 0;
+}
@@ -0,0 +1,849 @@
+/** @file
+ * @brief BSD Sockets compatible API
+ *
+ * Sockets on top of net_context. The callbacks of net_context only queue
+ * the received packets and accepted connections, and the application
+ * consumes them from its own thread.
+ */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(CONFIG_NET_DEBUG_SOCKETS)
+#define SYS_LOG_DOMAIN "net/sock"
+#define NET_LOG_ENABLED 1
+#endif
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <string.h>
+#include <kernel.h>
+#include <atomic.h>
+
+#include <net/net_context.h>
+#include <net/net_pkt.h>
+#include <net/socket.h>
+
+/* Socket flags */
+enum {
+	/* Calls do not block */
+	SOCK_NONBLOCK,
+
+	/* Packets are being queued to recv_q */
+	SOCK_RECEIVING,
+
+	/* accept_q is used instead of recv_q */
+	SOCK_LISTENING,
+
+	/* The peer closed the connection */
+	SOCK_EOF,
+
+	/* The connection was reset, the net_context is gone */
+	SOCK_RESET,
+
+	/* The socket is allocated */
+	SOCK_USED,
+};
+
+struct net_socket {
+	/* k_fifo uses the first word, needed for accept_q */
+	void *fifo_reserved;
+
+	/* NULL once the connection was reset */
+	struct net_context *ctx;
+
+	union {
+		/* Received net_pkt, for connected or datagram sockets */
+		struct k_fifo recv_q;
+
+		/* Accepted net_socket, for listening sockets */
+		struct k_fifo accept_q;
+	};
+
+	atomic_t flags;
+};
+
+static struct net_socket sockets[CONFIG_NET_MAX_CONTEXTS];
+
+#define SET_ERRNO(ret)			\
+	do {				\
+		int _err = (ret);	\
+		if (_err < 0) {		\
+			errno = -_err;	\
+			return -1;	\
+		}			\
+	} while (0)
+
+static struct net_socket *sock_alloc(struct net_context *ctx)
+{
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < ARRAY_SIZE(sockets); i++) {
+		if (!atomic_test_bit(&sockets[i].flags, SOCK_USED)) {
+			sockets[i].flags = ATOMIC_INIT(BIT(SOCK_USED));
+			sockets[i].ctx = ctx;
+			break;
+		}
+	}
+
+	irq_unlock(key);
+
+	if (i == ARRAY_SIZE(sockets)) {
+		return NULL;
+	}
+
+	k_fifo_init(&sockets[i].recv_q);
+
+	return &sockets[i];
+}
+
+static void sock_free(struct net_socket *sock)
+{
+	sock->ctx = NULL;
+	atomic_set(&sock->flags, 0);
+}
+
+static inline int sock_fd(struct net_socket *sock)
+{
+	return sock - sockets;
+}
+
+static struct net_socket *sock_get(int fd)
+{
+	if (fd < 0 || fd >= ARRAY_SIZE(sockets) ||
+	    !atomic_test_bit(&sockets[fd].flags, SOCK_USED)) {
+		errno = EBADF;
+		return NULL;
+	}
+
+	return &sockets[fd];
+}
+
+/* Returns the net_context of a socket, or NULL with errno set if the
+ * connection was reset.
+ */
+static struct net_context *sock_ctx(struct net_socket *sock)
+{
+	struct net_context *ctx = sock->ctx;
+
+	if (!ctx) {
+		errno = ECONNRESET;
+	}
+
+	return ctx;
+}
+
+static inline s32_t sock_timeout(struct net_socket *sock, int flags)
+{
+	if (atomic_test_bit(&sock->flags, SOCK_NONBLOCK) ||
+	    (flags & ZSOCK_MSG_DONTWAIT)) {
+		return K_NO_WAIT;
+	}
+
+	return K_FOREVER;
+}
+
+/* Removes the IP and transport headers so that the packet can be read
+ * as a stream.
+ */
+static void sock_pull_headers(struct net_pkt *pkt)
+{
+	u8_t *appdata = net_pkt_appdata(pkt);
+	struct net_buf *frag;
+
+	while ((frag = pkt->frags)) {
+		if (appdata >= frag->data && appdata < frag->data + frag->len) {
+			net_buf_pull(frag, appdata - frag->data);
+			break;
+		}
+
+		net_pkt_frag_del(pkt, NULL, frag);
+	}
+}
+
+static void sock_received_cb(struct net_context *ctx,
+			     struct net_pkt *pkt,
+			     int status,
+			     void *user_data)
+{
+	struct net_socket *sock = user_data;
+
+	if (!pkt) {
+		/* The context is released once this callback returns */
+		if (status == -ECONNRESET) {
+			atomic_set_bit(&sock->flags, SOCK_RESET);
+			sock->ctx = NULL;
+		}
+
+		/* Wake up any reader or poller so that they see EOF */
+		atomic_set_bit(&sock->flags, SOCK_EOF);
+		k_fifo_cancel_wait(&sock->recv_q);
+		return;
+	}
+
+	if (net_context_get_type(ctx) == SOCK_STREAM) {
+		sock_pull_headers(pkt);
+	}
+
+	NET_DBG("sock %d queue pkt %p len %u", sock_fd(sock), pkt,
+		net_pkt_appdatalen(pkt));
+
+	k_fifo_put(&sock->recv_q, pkt);
+}
+
+static int sock_start_recv(struct net_socket *sock)
+{
+	int ret;
+
+	if (atomic_test_and_set_bit(&sock->flags, SOCK_RECEIVING)) {
+		return 0;
+	}
+
+	ret = net_context_recv(sock->ctx, sock_received_cb, K_NO_WAIT, sock);
+	if (ret < 0) {
+		atomic_clear_bit(&sock->flags, SOCK_RECEIVING);
+	}
+
+	return ret;
+}
+
+static void sock_flush(struct net_socket *sock)
+{
+	void *item;
+
+	while ((item = k_fifo_get(&sock->recv_q, K_NO_WAIT))) {
+		if (atomic_test_bit(&sock->flags, SOCK_LISTENING)) {
+			zsock_close(sock_fd(item));
+		} else {
+			net_pkt_unref(item);
+		}
+	}
+}
+
+int zsock_socket(int family, int type, int proto)
+{
+	struct net_socket *sock;
+	struct net_context *ctx;
+
+	SET_ERRNO(net_context_get(family, type, proto, &ctx));
+
+	sock = sock_alloc(ctx);
+	if (!sock) {
+		net_context_put(ctx);
+		errno = ENFILE;
+		return -1;
+	}
+
+	return sock_fd(sock);
+}
+
+int zsock_close(int fd)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+
+	if (!sock) {
+		return -1;
+	}
+
+	ctx = sock->ctx;
+
+	/* A reset connection has already released its context */
+	if (ctx) {
+		net_context_put(ctx);
+	}
+
+	sock_flush(sock);
+	sock_free(sock);
+
+	return 0;
+}
+
+int zsock_bind(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+
+	if (!sock) {
+		return -1;
+	}
+
+	ctx = sock_ctx(sock);
+	if (!ctx) {
+		return -1;
+	}
+
+	SET_ERRNO(net_context_bind(ctx, addr, addrlen));
+
+	/* Datagrams may arrive as soon as the socket is bound */
+	if (net_context_get_type(ctx) == SOCK_DGRAM) {
+		SET_ERRNO(sock_start_recv(sock));
+	}
+
+	return 0;
+}
+
+static void sock_connected_cb(struct net_context *ctx, int status,
+			      void *user_data)
+{
+	struct net_socket *sock = user_data;
+
+	if (!status) {
+		sock_start_recv(sock);
+	}
+
+	/* Let a poller waiting for ZSOCK_POLLOUT know */
+	k_fifo_cancel_wait(&sock->recv_q);
+}
+
+int zsock_connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+	s32_t timeout;
+
+	if (!sock) {
+		return -1;
+	}
+
+	ctx = sock_ctx(sock);
+	if (!ctx) {
+		return -1;
+	}
+
+	if (net_context_get_type(ctx) == SOCK_DGRAM) {
+		SET_ERRNO(net_context_connect(ctx, addr, addrlen, NULL,
+					      K_NO_WAIT, NULL));
+		SET_ERRNO(sock_start_recv(sock));
+
+		return 0;
+	}
+
+	timeout = atomic_test_bit(&sock->flags, SOCK_NONBLOCK) ?
+		K_NO_WAIT : CONFIG_NET_SOCKETS_CONNECT_TIMEOUT;
+
+	SET_ERRNO(net_context_connect(ctx, addr, addrlen,
+				      sock_connected_cb, timeout, sock));
+
+	if (net_context_get_state(ctx) != NET_CONTEXT_CONNECTED) {
+		errno = EINPROGRESS;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void sock_accepted_cb(struct net_context *new_ctx,
+			     struct sockaddr *addr,
+			     socklen_t addrlen,
+			     int status,
+			     void *user_data)
+{
+	struct net_socket *sock = user_data;
+	struct net_socket *new_sock;
+
+	if (status) {
+		return;
+	}
+
+	new_sock = sock_alloc(new_ctx);
+	if (!new_sock) {
+		NET_DBG("No free socket for the new connection");
+		net_context_put(new_ctx);
+		return;
+	}
+
+	/* Queue the data that arrives before accept() is called */
+	if (sock_start_recv(new_sock) < 0) {
+		net_context_put(new_ctx);
+		sock_free(new_sock);
+		return;
+	}
+
+	NET_DBG("sock %d accepted sock %d", sock_fd(sock), sock_fd(new_sock));
+
+	k_fifo_put(&sock->accept_q, new_sock);
+}
+
+int zsock_listen(int fd, int backlog)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+
+	if (!sock) {
+		return -1;
+	}
+
+	ctx = sock_ctx(sock);
+	if (!ctx) {
+		return -1;
+	}
+
+	SET_ERRNO(net_context_listen(ctx, backlog));
+
+	atomic_set_bit(&sock->flags, SOCK_LISTENING);
+
+	SET_ERRNO(net_context_accept(ctx, sock_accepted_cb, K_NO_WAIT, sock));
+
+	return 0;
+}
+
+static void sock_copy_addr(struct sockaddr *addr, socklen_t *addrlen,
+			   const struct sockaddr *src)
+{
+	socklen_t len;
+
+	if (!addr || !addrlen) {
+		return;
+	}
+
+	if (src->family == AF_INET6) {
+		len = sizeof(struct sockaddr_in6);
+	} else {
+		len = sizeof(struct sockaddr_in);
+	}
+
+	memcpy(addr, src, min(*addrlen, len));
+	*addrlen = len;
+}
+
+/* Waits until fifo has an item or was cancelled, returns -EAGAIN on
+ * timeout.
+ */
+static int sock_wait(struct k_fifo *fifo, s32_t timeout)
+{
+	struct k_poll_event event;
+
+	if (timeout == K_NO_WAIT) {
+		return -EAGAIN;
+	}
+
+	k_poll_event_init(&event, K_POLL_TYPE_FIFO_DATA_AVAILABLE,
+			  K_POLL_MODE_NOTIFY_ONLY, fifo);
+
+	return k_poll(&event, 1, timeout);
+}
+
+int zsock_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_socket *new_sock;
+	struct net_context *new_ctx;
+
+	if (!sock) {
+		return -1;
+	}
+
+	if (!atomic_test_bit(&sock->flags, SOCK_LISTENING)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	new_sock = k_fifo_get(&sock->accept_q, sock_timeout(sock, 0));
+	if (!new_sock) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	/* A connection reset before being accepted is still returned, its
+	 * first recv() reporting the reset.
+	 */
+	new_ctx = new_sock->ctx;
+	if (new_ctx) {
+		sock_copy_addr(addr, addrlen, &new_ctx->remote);
+	} else if (addrlen) {
+		*addrlen = 0;
+	}
+
+	return sock_fd(new_sock);
+}
+
+ssize_t zsock_sendto(int fd, const void *buf, size_t len, int flags,
+		     const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+	struct net_pkt *pkt;
+	s32_t timeout;
+	int ret;
+
+	if (!sock) {
+		return -1;
+	}
+
+	ctx = sock_ctx(sock);
+	if (!ctx) {
+		return -1;
+	}
+
+	timeout = sock_timeout(sock, flags);
+
+	pkt = net_pkt_get_tx(ctx, timeout);
+	if (!pkt) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	len = net_pkt_append(pkt, min(len, UINT16_MAX), buf, timeout);
+	if (!len) {
+		net_pkt_unref(pkt);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (dest_addr) {
+		ret = net_context_sendto(pkt, dest_addr, addrlen, NULL,
+					 timeout, NULL, NULL);
+	} else {
+		ret = net_context_send(pkt, NULL, timeout, NULL, NULL);
+	}
+
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+		errno = -ret;
+		return -1;
+	}
+
+	/* Replies to a datagram can only be received once it is bound */
+	if (net_context_get_type(ctx) == SOCK_DGRAM) {
+		SET_ERRNO(sock_start_recv(sock));
+	}
+
+	return len;
+}
+
+ssize_t zsock_send(int fd, const void *buf, size_t len, int flags)
+{
+	return zsock_sendto(fd, buf, len, flags, NULL, 0);
+}
+
+/* Returns the offset of the application data from the start of pkt */
+static int sock_appdata_offset(struct net_pkt *pkt)
+{
+	u8_t *appdata = net_pkt_appdata(pkt);
+	struct net_buf *frag;
+	int offset = 0;
+
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		if (appdata >= frag->data && appdata < frag->data + frag->len) {
+			return offset + (appdata - frag->data);
+		}
+
+		offset += frag->len;
+	}
+
+	return -EINVAL;
+}
+
+static void sock_get_src_addr(struct net_pkt *pkt, struct sockaddr *addr,
+			      socklen_t *addrlen)
+{
+	struct sockaddr src = { .family = net_pkt_family(pkt) };
+
+#if defined(CONFIG_NET_IPV4)
+	if (src.family == AF_INET) {
+		net_ipaddr_copy(&net_sin(&src)->sin_addr,
+				&NET_IPV4_HDR(pkt)->src);
+		net_sin(&src)->sin_port = NET_UDP_HDR(pkt)->src_port;
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV6)
+	if (src.family == AF_INET6) {
+		net_ipaddr_copy(&net_sin6(&src)->sin6_addr,
+				&NET_IPV6_HDR(pkt)->src);
+		net_sin6(&src)->sin6_port = NET_UDP_HDR(pkt)->src_port;
+	}
+#endif
+
+	sock_copy_addr(addr, addrlen, &src);
+}
+
+static ssize_t sock_recv_dgram(struct net_socket *sock, u8_t *buf,
+			       size_t max_len, int flags,
+			       struct sockaddr *src_addr, socklen_t *addrlen)
+{
+	s32_t timeout = sock_timeout(sock, flags);
+	struct net_pkt *pkt;
+	u16_t pos;
+	int offset;
+
+	while (!(pkt = k_fifo_peek_head(&sock->recv_q))) {
+		if (sock_wait(&sock->recv_q, timeout) == -EAGAIN) {
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+
+	if (!(flags & ZSOCK_MSG_PEEK)) {
+		k_fifo_get(&sock->recv_q, K_NO_WAIT);
+	}
+
+	max_len = min(max_len, net_pkt_appdatalen(pkt));
+
+	offset = sock_appdata_offset(pkt);
+	if (offset < 0) {
+		max_len = 0;
+	} else if (max_len) {
+		net_frag_read(pkt->frags, offset, &pos, max_len, buf);
+	}
+
+	sock_get_src_addr(pkt, src_addr, addrlen);
+
+	if (!(flags & ZSOCK_MSG_PEEK)) {
+		net_pkt_unref(pkt);
+	}
+
+	return max_len;
+}
+
+/* Copies up to len bytes of data from the start of pkt, removing them
+ * from pkt unless peeking.
+ */
+static size_t sock_pkt_read(struct net_pkt *pkt, u8_t *buf, size_t len,
+			    bool peek)
+{
+	struct net_buf *frag = pkt->frags;
+	size_t copied = 0;
+	size_t n;
+
+	len = min(len, net_pkt_appdatalen(pkt));
+
+	while (frag && copied < len) {
+		n = min(frag->len, len - copied);
+		memcpy(buf + copied, frag->data, n);
+		copied += n;
+
+		if (peek) {
+			frag = frag->frags;
+		} else if (n < frag->len) {
+			net_buf_pull(frag, n);
+		} else {
+			net_pkt_frag_del(pkt, NULL, frag);
+			frag = pkt->frags;
+		}
+	}
+
+	if (!peek) {
+		net_pkt_set_appdatalen(pkt, net_pkt_appdatalen(pkt) - copied);
+	}
+
+	return copied;
+}
+
+static ssize_t sock_recv_stream(struct net_socket *sock, u8_t *buf,
+				size_t max_len, int flags)
+{
+	s32_t timeout = sock_timeout(sock, flags);
+	bool peek = flags & ZSOCK_MSG_PEEK;
+	struct net_pkt *pkt;
+	size_t recv_len = 0;
+
+	while (!(pkt = k_fifo_peek_head(&sock->recv_q))) {
+		if (atomic_test_bit(&sock->flags, SOCK_RESET)) {
+			errno = ECONNRESET;
+			return -1;
+		}
+
+		if (atomic_test_bit(&sock->flags, SOCK_EOF)) {
+			return 0;
+		}
+
+		if (sock_wait(&sock->recv_q, timeout) == -EAGAIN) {
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+
+	/* Drain as many queued packets as fit, but never block again */
+	while (pkt && recv_len < max_len) {
+		recv_len += sock_pkt_read(pkt, buf + recv_len,
+					  max_len - recv_len, peek);
+
+		if (peek) {
+			break;
+		}
+
+		if (net_pkt_appdatalen(pkt)) {
+			break;
+		}
+
+		k_fifo_get(&sock->recv_q, K_NO_WAIT);
+		net_pkt_unref(pkt);
+
+		pkt = k_fifo_peek_head(&sock->recv_q);
+	}
+
+	return recv_len;
+}
+
+ssize_t zsock_recvfrom(int fd, void *buf, size_t max_len, int flags,
+		       struct sockaddr *src_addr, socklen_t *addrlen)
+{
+	struct net_socket *sock = sock_get(fd);
+	struct net_context *ctx;
+
+	if (!sock) {
+		return -1;
+	}
+
+	/* Only stream connections get reset, the data queued before the
+	 * reset still being returned.
+	 */
+	ctx = sock->ctx;
+	if (!ctx) {
+		return sock_recv_stream(sock, buf, max_len, flags);
+	}
+
+	if (net_context_get_type(ctx) == SOCK_DGRAM) {
+		return sock_recv_dgram(sock, buf, max_len, flags, src_addr,
+				       addrlen);
+	}
+
+	sock_copy_addr(src_addr, addrlen, &ctx->remote);
+
+	return sock_recv_stream(sock, buf, max_len, flags);
+}
+
+ssize_t zsock_recv(int fd, void *buf, size_t max_len, int flags)
+{
+	return zsock_recvfrom(fd, buf, max_len, flags, NULL, NULL);
+}
+
+int zsock_fcntl(int fd, int cmd, int flags)
+{
+	struct net_socket *sock = sock_get(fd);
+
+	if (!sock) {
+		return -1;
+	}
+
+	switch (cmd) {
+	case ZSOCK_F_GETFL:
+		return atomic_test_bit(&sock->flags, SOCK_NONBLOCK) ?
+			ZSOCK_O_NONBLOCK : 0;
+
+	case ZSOCK_F_SETFL:
+		if (flags & ZSOCK_O_NONBLOCK) {
+			atomic_set_bit(&sock->flags, SOCK_NONBLOCK);
+		} else {
+			atomic_clear_bit(&sock->flags, SOCK_NONBLOCK);
+		}
+
+		return 0;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static short sock_revents(struct net_socket *sock, short events)
+{
+	struct net_context *ctx;
+	short revents = 0;
+
+	if (!sock) {
+		return ZSOCK_POLLNVAL;
+	}
+
+	ctx = sock->ctx;
+	if (!ctx || atomic_test_bit(&sock->flags, SOCK_RESET)) {
+		return ZSOCK_POLLERR;
+	}
+
+	if ((events & ZSOCK_POLLIN) &&
+	    (!k_fifo_is_empty(&sock->recv_q) ||
+	     atomic_test_bit(&sock->flags, SOCK_EOF))) {
+		revents |= ZSOCK_POLLIN;
+	}
+
+	/* Sending only blocks while waiting for buffers, which is not
+	 * worth waiting for here, so a socket is writable once connected.
+	 */
+	if ((events & ZSOCK_POLLOUT) &&
+	    net_context_get_state(ctx) != NET_CONTEXT_CONNECTING) {
+		revents |= ZSOCK_POLLOUT;
+	}
+
+	if (atomic_test_bit(&sock->flags, SOCK_EOF)) {
+		revents |= ZSOCK_POLLHUP;
+	}
+
+	return revents;
+}
+
+int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout)
+{
+	struct k_poll_event events[CONFIG_NET_SOCKETS_POLL_MAX];
+	struct net_socket *sock;
+	int i, count, ready = 0;
+	s32_t poll_timeout;
+
+	if (timeout < 0) {
+		poll_timeout = K_FOREVER;
+	} else {
+		poll_timeout = K_MSEC(timeout);
+	}
+
+	for (i = 0, count = 0; i < nfds; i++) {
+		sock = sock_get(fds[i].fd);
+
+		fds[i].revents = sock_revents(sock, fds[i].events);
+		if (fds[i].revents) {
+			ready++;
+			continue;
+		}
+
+		if (!(fds[i].events & (ZSOCK_POLLIN | ZSOCK_POLLOUT))) {
+			continue;
+		}
+
+		if (count == ARRAY_SIZE(events)) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		/* Incoming data, connections, EOF and the completion of a
+		 * connect() all wake up a waiter of recv_q.
+		 */
+		k_poll_event_init(&events[count++],
+				  K_POLL_TYPE_FIFO_DATA_AVAILABLE,
+				  K_POLL_MODE_NOTIFY_ONLY, &sock->recv_q);
+	}
+
+	/* With nothing to wait for, the timeout is only a delay, and an
+	 * infinite one would never return.
+	 */
+	if (ready || !count) {
+		if (!ready && timeout > 0) {
+			k_sleep(K_MSEC(timeout));
+		}
+
+		return ready;
+	}
+
+	if (k_poll(events, count, poll_timeout) == -EAGAIN) {
+		return 0;
+	}
+
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = sock_revents(sock_get(fds[i].fd),
+					      fds[i].events);
+		if (fds[i].revents) {
+			ready++;
+		}
+	}
+
+	return ready;
+}
+
+int zsock_inet_pton(sa_family_t family, const char *src, void *dst)
+{
+	return net_addr_pton(family, src, dst) == 0 ? 1 : 0;
+}
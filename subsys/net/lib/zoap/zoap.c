@@ -18,6 +18,8 @@
 
 #include <net/zoap.h>
 
+#include "zoap_internal.h"
+
 struct option_context {
 	u8_t *buf;
 	int delta;
@@ -516,8 +518,8 @@ static bool uri_path_eq(const struct zoap_packet *zpkt,
 	return i == count && !path[i];
 }
 
-static zoap_method_t method_from_code(const struct zoap_resource *resource,
-				      u8_t code)
+zoap_method_t _zoap_method_from_code(const struct zoap_resource *resource,
+				     u8_t code)
 {
 	switch (code) {
 	case ZOAP_METHOD_GET:
@@ -560,7 +562,7 @@ int zoap_handle_request(struct zoap_packet *zpkt,
 		}
 
 		code = zoap_header_get_code(zpkt);
-		method = method_from_code(resource, code);
+		method = _zoap_method_from_code(resource, code);
 
 		if (!method) {
 			return 0;
@@ -585,7 +587,7 @@ unsigned int zoap_option_value_to_int(const struct zoap_option *option)
 		return (option->value[2] << 0) | (option->value[1] << 8) |
 			(option->value[0] << 16);
 	case 4:
-		return (option->value[2] << 0) | (option->value[2] << 8) |
+		return (option->value[3] << 0) | (option->value[2] << 8) |
 			(option->value[1] << 16) | (option->value[0] << 24);
 	default:
 		return 0;
@@ -739,8 +741,8 @@ void zoap_remove_observer(struct zoap_resource *resource,
 	sys_slist_find_and_remove(&resource->observers, &observer->list);
 }
 
-static bool sockaddr_equal(const struct sockaddr *a,
-			   const struct sockaddr *b)
+bool _zoap_sockaddr_equal(const struct sockaddr *a,
+			  const struct sockaddr *b)
 {
 	/*
 	 * FIXME: Should we consider ipv6-mapped ipv4 addresses as equal to
@@ -789,7 +791,7 @@ struct zoap_observer *zoap_find_observer_by_addr(
 	for (i = 0; i < len; i++) {
 		struct zoap_observer *o = &observers[i];
 
-		if (sockaddr_equal(&o->addr, addr)) {
+		if (_zoap_sockaddr_equal(&o->addr, addr)) {
 			return o;
 		}
 	}
@@ -898,8 +900,8 @@ int zoap_add_option_int(struct zoap_packet *zpkt, u16_t code,
 		sys_put_be16(val, data);
 		len = 2;
 	} else if (val < 0xFFFFFF) {
-		sys_put_be16(val, data);
-		data[2] = val >> 16;
+		data[0] = val >> 16;
+		sys_put_be16(val, &data[1]);
 		len = 3;
 	} else {
 		sys_put_be32(val, data);
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * @brief Helpers shared by the zoap sources, not part of the API.
+ */
+
+#ifndef __ZOAP_INTERNAL_H__
+#define __ZOAP_INTERNAL_H__
+
+#include <stdbool.h>
+#include <net/net_ip.h>
+#include <net/zoap.h>
+
+zoap_method_t _zoap_method_from_code(const struct zoap_resource *resource,
+				     u8_t code);
+
+bool _zoap_sockaddr_equal(const struct sockaddr *a,
+			  const struct sockaddr *b);
+
+#endif /* __ZOAP_INTERNAL_H__ */
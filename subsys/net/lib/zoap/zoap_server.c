@@ -0,0 +1,1237 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <kernel.h>
+#include <drivers/rand32.h>
+#include <net/buf.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/net_context.h>
+
+#include <net/zoap.h>
+#include <net/zoap_server.h>
+
+#include "zoap_internal.h"
+
+#define PKT_WAIT_TIME K_SECONDS(1)
+
+/* RFC 7252, section 4.8 */
+#define MAX_RETRANSMIT 4
+
+#define MAX_PATH_SEGMENTS 16
+
+/* RFC 7641, section 4.4 */
+#define MAX_OBSERVE_SEQ 0xFFFFFF
+
+#define CON_INTERVAL CONFIG_ZOAP_SERVER_NOTIFY_CON_INTERVAL
+
+struct notify_meta {
+	u32_t seq;
+	u16_t format;
+};
+
+NET_BUF_POOL_DEFINE(notify_payloads, CONFIG_ZOAP_SERVER_NOTIFY_PAYLOADS,
+		    CONFIG_ZOAP_SERVER_NOTIFY_PAYLOAD_SIZE,
+		    sizeof(struct notify_meta), NULL);
+
+static void observer_remove(struct zoap_server *server,
+			    struct zoap_server_observer *o);
+static void notify_schedule(struct zoap_server *server);
+
+static socklen_t addr_len(const struct sockaddr *addr)
+{
+	if (addr->family == AF_INET6) {
+		return sizeof(struct sockaddr_in6);
+	}
+
+	return sizeof(struct sockaddr_in);
+}
+
+static void payload_release(const void *data, u16_t len, void *user_data)
+{
+	net_buf_unref(user_data);
+}
+
+/* The payload of a notification is shared by all the observers, it is
+ * referenced by the packet instead of being copied.
+ */
+static int payload_append(struct net_pkt *pkt, struct net_buf *payload)
+{
+	int r;
+
+	if (!payload->len) {
+		return 0;
+	}
+
+	r = net_pkt_append_ext(pkt, payload->data, payload->len,
+			       payload_release, net_buf_ref(payload),
+			       PKT_WAIT_TIME);
+	if (r < 0) {
+		net_buf_unref(payload);
+	}
+
+	return r;
+}
+
+/* The messages kept for retransmission are never passed to the stack,
+ * which inserts its headers in the fragments, a copy is sent instead.
+ */
+static int send_copy(struct zoap_server *server, struct net_buf *msg,
+		     struct net_buf *payload, const struct sockaddr *addr)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	int r;
+
+	pkt = net_pkt_get_tx(server->context, PKT_WAIT_TIME);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	for (; msg; msg = msg->frags) {
+		frag = net_pkt_get_data(server->context, PKT_WAIT_TIME);
+		if (!frag) {
+			net_pkt_unref(pkt);
+			return -ENOMEM;
+		}
+
+		net_pkt_frag_add(pkt, frag);
+
+		if (msg->len > net_buf_tailroom(frag)) {
+			net_pkt_unref(pkt);
+			return -EMSGSIZE;
+		}
+
+		net_buf_add_mem(frag, msg->data, msg->len);
+	}
+
+	if (payload) {
+		r = payload_append(pkt, payload);
+		if (r < 0) {
+			net_pkt_unref(pkt);
+			return r;
+		}
+	}
+
+	r = net_context_sendto(pkt, addr, addr_len(addr), NULL, 0, NULL, NULL);
+	if (r < 0) {
+		net_pkt_unref(pkt);
+	}
+
+	return r;
+}
+
+static int trie_insert(struct zoap_server *server,
+		       struct zoap_resource *resource)
+{
+	struct zoap_server_node *node = &server->nodes[0];
+	const char * const *path;
+
+	for (path = resource->path; *path; path++) {
+		size_t len = strlen(*path);
+		u8_t child;
+
+		if (len > UINT8_MAX) {
+			return -EINVAL;
+		}
+
+		for (child = node->child; child;
+		     child = server->nodes[child].next) {
+			if (server->nodes[child].len == len &&
+			    !memcmp(server->nodes[child].segment, *path, len)) {
+				break;
+			}
+		}
+
+		if (!child) {
+			if (server->node_count ==
+			    CONFIG_ZOAP_SERVER_RESOURCE_NODES) {
+				return -ENOMEM;
+			}
+
+			child = server->node_count++;
+
+			server->nodes[child].segment = *path;
+			server->nodes[child].len = len;
+			server->nodes[child].next = node->child;
+			node->child = child;
+		}
+
+		node = &server->nodes[child];
+	}
+
+	/* Like zoap_handle_request(), the first resource of a path wins */
+	if (!node->resource) {
+		node->resource = resource;
+	}
+
+	return 0;
+}
+
+static struct zoap_resource *trie_lookup(struct zoap_server *server,
+					 const struct zoap_packet *zpkt)
+{
+	struct zoap_option options[MAX_PATH_SEGMENTS];
+	struct zoap_server_node *node = &server->nodes[0];
+	int i, count;
+
+	count = zoap_find_options(zpkt, ZOAP_OPTION_URI_PATH, options,
+				  MAX_PATH_SEGMENTS);
+	if (count < 0) {
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		u8_t child;
+
+		for (child = node->child; child;
+		     child = server->nodes[child].next) {
+			if (server->nodes[child].len == options[i].len &&
+			    !memcmp(server->nodes[child].segment,
+				    options[i].value, options[i].len)) {
+				break;
+			}
+		}
+
+		if (!child) {
+			return NULL;
+		}
+
+		node = &server->nodes[child];
+	}
+
+	return node->resource;
+}
+
+static void heap_swap(struct zoap_server *server, int a, int b)
+{
+	struct zoap_server_pending *p = server->heap[a];
+
+	server->heap[a] = server->heap[b];
+	server->heap[b] = p;
+
+	server->heap[a]->index = a;
+	server->heap[b]->index = b;
+}
+
+static void heap_up(struct zoap_server *server, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (server->heap[parent]->expiry <= server->heap[i]->expiry) {
+			break;
+		}
+
+		heap_swap(server, i, parent);
+		i = parent;
+	}
+}
+
+static void heap_down(struct zoap_server *server, int i)
+{
+	while (true) {
+		int child = 2 * i + 1;
+
+		if (child >= server->heap_len) {
+			break;
+		}
+
+		if (child + 1 < server->heap_len &&
+		    server->heap[child + 1]->expiry <
+		    server->heap[child]->expiry) {
+			child++;
+		}
+
+		if (server->heap[i]->expiry <= server->heap[child]->expiry) {
+			break;
+		}
+
+		heap_swap(server, i, child);
+		i = child;
+	}
+}
+
+static void heap_remove(struct zoap_server *server,
+			struct zoap_server_pending *p)
+{
+	int i = p->index;
+
+	server->heap_len--;
+
+	if (i == server->heap_len) {
+		return;
+	}
+
+	server->heap[i] = server->heap[server->heap_len];
+	server->heap[i]->index = i;
+
+	heap_down(server, i);
+	heap_up(server, i);
+}
+
+static void retransmit_schedule(struct zoap_server *server)
+{
+	unsigned int key;
+	s64_t delay;
+
+	key = irq_lock();
+
+	if (!server->heap_len) {
+		irq_unlock(key);
+		return;
+	}
+
+	delay = server->heap[0]->expiry - k_uptime_get();
+
+	irq_unlock(key);
+
+	k_delayed_work_submit(&server->retransmit, delay > 0 ? delay : 0);
+}
+
+static void retransmit(struct k_work *work)
+{
+	struct zoap_server *server = CONTAINER_OF(work, struct zoap_server,
+						  retransmit);
+	struct zoap_server_observer *observer;
+	struct zoap_server_pending *p;
+	struct net_buf *payload;
+	struct sockaddr addr;
+	struct net_pkt *pkt;
+	unsigned int key;
+
+	while (true) {
+		key = irq_lock();
+
+		if (!server->heap_len ||
+		    server->heap[0]->expiry > k_uptime_get()) {
+			irq_unlock(key);
+			break;
+		}
+
+		p = server->heap[0];
+		pkt = p->pending.pkt;
+		payload = p->payload;
+
+		/* The last timeout has expired without an ACK, an observer
+		 * not acknowledging its notifications is no longer
+		 * interested (RFC 7641, section 4.5).
+		 */
+		if (p->retries == MAX_RETRANSMIT) {
+			observer = p->observer;
+
+			heap_remove(server, p);
+			p->pending.pkt = NULL;
+			p->pending.timeout = 0;
+			p->observer = NULL;
+			p->payload = NULL;
+
+			irq_unlock(key);
+
+			net_pkt_unref(pkt);
+
+			if (payload) {
+				net_buf_unref(payload);
+			}
+
+			/* Releases the other observers of the endpoint */
+			if (observer) {
+				observer_remove(server, observer);
+				notify_schedule(server);
+			}
+
+			continue;
+		}
+
+		p->retries++;
+		p->pending.timeout *= 2;
+		p->expiry += p->pending.timeout;
+		heap_down(server, 0);
+
+		net_pkt_ref(pkt);
+		memcpy(&addr, &p->pending.addr, sizeof(addr));
+
+		if (payload) {
+			net_buf_ref(payload);
+		}
+
+		irq_unlock(key);
+
+		send_copy(server, pkt->frags, payload, &addr);
+		net_pkt_unref(pkt);
+
+		if (payload) {
+			net_buf_unref(payload);
+		}
+	}
+
+	retransmit_schedule(server);
+}
+
+static int pending_add(struct zoap_server *server,
+		       const struct zoap_packet *zpkt,
+		       const struct sockaddr *addr,
+		       struct zoap_server_observer *observer,
+		       struct net_buf *payload)
+{
+	struct zoap_server_pending *p = NULL;
+	s32_t timeout;
+	unsigned int key;
+	bool first;
+	int i;
+
+	/* RFC 7252, section 4.2: ACK_TIMEOUT * ACK_RANDOM_FACTOR */
+	timeout = CONFIG_ZOAP_SERVER_ACK_TIMEOUT +
+		sys_rand32_get() % (CONFIG_ZOAP_SERVER_ACK_TIMEOUT / 2 + 1);
+
+	key = irq_lock();
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_PENDINGS; i++) {
+		if (!server->pendings[i].pending.pkt) {
+			p = &server->pendings[i];
+			break;
+		}
+	}
+
+	if (!p) {
+		irq_unlock(key);
+		return -ENOMEM;
+	}
+
+	zoap_pending_init(&p->pending, zpkt, addr);
+	net_pkt_ref(zpkt->pkt);
+
+	p->observer = observer;
+	p->payload = payload ? net_buf_ref(payload) : NULL;
+
+	p->pending.timeout = timeout;
+	p->expiry = k_uptime_get() + timeout;
+	p->retries = 0;
+
+	p->index = server->heap_len++;
+	server->heap[p->index] = p;
+	heap_up(server, p->index);
+
+	first = server->heap[0] == p;
+
+	irq_unlock(key);
+
+	if (first) {
+		retransmit_schedule(server);
+	}
+
+	return 0;
+}
+
+static u8_t addr_hash(const struct sockaddr *addr)
+{
+	const u8_t *p;
+	u32_t hash = 2166136261U;
+	u16_t port;
+	int i, len;
+
+	if (addr->family == AF_INET6) {
+		p = net_sin6(addr)->sin6_addr.s6_addr;
+		len = sizeof(struct in6_addr);
+		port = net_sin6(addr)->sin6_port;
+	} else {
+		p = (const u8_t *)&net_sin(addr)->sin_addr;
+		len = sizeof(struct in_addr);
+		port = net_sin(addr)->sin_port;
+	}
+
+	/* FNV-1a */
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ p[i]) * 16777619U;
+	}
+
+	hash = (hash ^ (port & 0xff)) * 16777619U;
+	hash = (hash ^ (port >> 8)) * 16777619U;
+
+	return hash % CONFIG_ZOAP_SERVER_OBSERVERS;
+}
+
+static struct zoap_server_observer *observer_find(
+	struct zoap_server *server, const struct sockaddr *addr,
+	const u8_t *token, u8_t tkl)
+{
+	struct zoap_server_observer *o;
+	u8_t i;
+
+	for (i = server->buckets[addr_hash(addr)]; i; i = o->next) {
+		o = &server->observers[i - 1];
+
+		if (o->observer.tkl == tkl &&
+		    !memcmp(o->observer.token, token, tkl) &&
+		    _zoap_sockaddr_equal(&o->observer.addr, addr)) {
+			return o;
+		}
+	}
+
+	return NULL;
+}
+
+/* A RESET to a non-confirmable notification only matches its message
+ * ID and endpoint.
+ */
+static struct zoap_server_observer *observer_find_by_id(
+	struct zoap_server *server, const struct sockaddr *addr, u16_t id)
+{
+	struct zoap_server_observer *o;
+	u8_t i;
+
+	for (i = server->buckets[addr_hash(addr)]; i; i = o->next) {
+		o = &server->observers[i - 1];
+
+		if (o->id == id &&
+		    _zoap_sockaddr_equal(&o->observer.addr, addr)) {
+			return o;
+		}
+	}
+
+	return NULL;
+}
+
+/* RFC 7641, section 4.5.1: a single confirmable notification at a time
+ * per endpoint, whatever the resource.
+ */
+static bool endpoint_busy(struct zoap_server *server,
+			  const struct zoap_server_observer *observer)
+{
+	const struct sockaddr *addr = &observer->observer.addr;
+	struct zoap_server_observer *o;
+	u8_t i;
+
+	for (i = server->buckets[addr_hash(addr)]; i; i = o->next) {
+		o = &server->observers[i - 1];
+
+		if (o->inflight &&
+		    _zoap_sockaddr_equal(&o->observer.addr, addr)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void observer_remove(struct zoap_server *server,
+			    struct zoap_server_observer *o)
+{
+	struct net_buf *payload;
+	unsigned int key;
+	u8_t *link;
+	int i;
+
+	key = irq_lock();
+
+	if (!o->resource) {
+		irq_unlock(key);
+		return;
+	}
+
+	link = &server->buckets[addr_hash(&o->observer.addr)];
+	while (*link && &server->observers[*link - 1] != o) {
+		link = &server->observers[*link - 1].next;
+	}
+
+	if (*link) {
+		*link = o->next;
+	}
+
+	zoap_remove_observer(o->resource, &o->observer);
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_PENDINGS; i++) {
+		if (server->pendings[i].observer == o) {
+			server->pendings[i].observer = NULL;
+		}
+	}
+
+	payload = o->payload;
+
+	o->resource = NULL;
+	o->payload = NULL;
+	o->inflight = false;
+
+	irq_unlock(key);
+
+	if (payload) {
+		net_buf_unref(payload);
+	}
+}
+
+/* Only the header is built for each observer, the payload follows it
+ * in a fragment shared with the notifications to the other observers.
+ */
+static int notify_send(struct zoap_server *server,
+		       struct zoap_server_observer *o,
+		       const struct zoap_observer *to,
+		       struct net_buf *payload, bool con)
+{
+	struct notify_meta *meta = net_buf_user_data(payload);
+	struct zoap_packet zpkt;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u16_t id, len;
+	int r;
+
+	pkt = net_pkt_get_tx(server->context, PKT_WAIT_TIME);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	frag = net_pkt_get_data(server->context, PKT_WAIT_TIME);
+	if (!frag) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	net_pkt_frag_add(pkt, frag);
+
+	r = zoap_packet_init(&zpkt, pkt);
+	if (r < 0) {
+		goto fail;
+	}
+
+	id = zoap_next_id();
+
+	zoap_header_set_version(&zpkt, 1);
+	zoap_header_set_type(&zpkt, con ? ZOAP_TYPE_CON : ZOAP_TYPE_NON_CON);
+	zoap_header_set_code(&zpkt, ZOAP_RESPONSE_CODE_CONTENT);
+	zoap_header_set_id(&zpkt, id);
+	zoap_header_set_token(&zpkt, to->token, to->tkl);
+
+	r = zoap_add_option_int(&zpkt, ZOAP_OPTION_OBSERVE, meta->seq);
+	if (r < 0) {
+		goto fail;
+	}
+
+	r = zoap_add_option_int(&zpkt, ZOAP_OPTION_CONTENT_FORMAT,
+				meta->format);
+	if (r < 0) {
+		goto fail;
+	}
+
+	/* Only writes the payload marker */
+	if (payload->len && !zoap_packet_get_payload(&zpkt, &len)) {
+		r = -ENOMEM;
+		goto fail;
+	}
+
+	o->id = id;
+
+	if (con) {
+		r = pending_add(server, &zpkt, &to->addr, o, payload);
+		if (r < 0) {
+			goto fail;
+		}
+
+		/* Retransmitted if this one fails */
+		send_copy(server, pkt->frags, payload, &to->addr);
+		net_pkt_unref(pkt);
+
+		return 0;
+	}
+
+	r = payload_append(pkt, payload);
+	if (r < 0) {
+		goto fail;
+	}
+
+	r = net_context_sendto(pkt, &to->addr, addr_len(&to->addr),
+			       NULL, 0, NULL, NULL);
+	if (r < 0) {
+		net_pkt_unref(pkt);
+	}
+
+	return r;
+
+fail:
+	net_pkt_unref(pkt);
+
+	return r;
+}
+
+static void notify_schedule(struct zoap_server *server)
+{
+	unsigned int key;
+	s64_t delay;
+
+	key = irq_lock();
+
+	if (server->notify_armed) {
+		irq_unlock(key);
+		return;
+	}
+
+	server->notify_armed = true;
+	delay = server->notify_next - k_uptime_get();
+
+	irq_unlock(key);
+
+	k_delayed_work_submit(&server->notify, delay > 0 ? delay : 0);
+}
+
+/* Sends a burst of notifications, starting with the observer following
+ * the last one served so that none of them starves.
+ */
+static void notify(struct k_work *work)
+{
+	struct zoap_server *server = CONTAINER_OF(work, struct zoap_server,
+						  notify);
+	struct zoap_server_observer *o;
+	struct zoap_observer to;
+	struct net_buf *payload;
+	bool con, more = false;
+	unsigned int key;
+	int i, sent = 0;
+	int r;
+
+	/* Set first, the ACK of a confirmable notification reschedules the
+	 * work while it is sending.
+	 */
+	key = irq_lock();
+	server->notify_armed = false;
+	server->notify_next = k_uptime_get() +
+		CONFIG_ZOAP_SERVER_NOTIFY_INTERVAL;
+	irq_unlock(key);
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_OBSERVERS; i++) {
+		o = &server->observers[server->notify_cursor];
+
+		key = irq_lock();
+
+		/* Held until the ACK of the confirmable notification */
+		if (!o->resource || !o->payload ||
+		    endpoint_busy(server, o)) {
+			irq_unlock(key);
+			goto next;
+		}
+
+		if (sent == CONFIG_ZOAP_SERVER_NOTIFY_BURST) {
+			irq_unlock(key);
+			more = true;
+			break;
+		}
+
+		payload = o->payload;
+		o->payload = NULL;
+
+		con = ++o->non_count >= CON_INTERVAL;
+		if (con) {
+			o->non_count = 0;
+			o->inflight = true;
+		}
+
+		memcpy(&to, &o->observer, sizeof(to));
+
+		irq_unlock(key);
+
+		r = notify_send(server, o, &to, payload, con);
+		if (r < 0) {
+			key = irq_lock();
+
+			/* The next one is confirmable again */
+			if (con) {
+				o->non_count = CON_INTERVAL - 1;
+				o->inflight = false;
+			}
+
+			/* Tried again with the next burst, unless a newer
+			 * state is already waiting.
+			 */
+			if (r == -ENOMEM) {
+				if (o->resource && !o->payload) {
+					o->payload = payload;
+					payload = NULL;
+				}
+
+				more = true;
+			}
+
+			irq_unlock(key);
+		}
+
+		if (payload) {
+			net_buf_unref(payload);
+		}
+
+		if (more) {
+			break;
+		}
+
+		sent++;
+
+next:
+		server->notify_cursor = (server->notify_cursor + 1) %
+			CONFIG_ZOAP_SERVER_OBSERVERS;
+	}
+
+	if (more) {
+		notify_schedule(server);
+	}
+}
+
+/* RFC 7252, section 4.4: the ACK or RESET matches the message ID and
+ * the endpoint of the confirmable message.
+ */
+static void pending_received(struct zoap_server *server,
+			     const struct zoap_packet *zpkt,
+			     const struct sockaddr *from)
+{
+	struct zoap_server_observer *observer;
+	struct zoap_server_pending *p = NULL;
+	u16_t id = zoap_header_get_id(zpkt);
+	bool reset = zoap_header_get_type(zpkt) == ZOAP_TYPE_RESET;
+	struct net_buf *payload;
+	struct net_pkt *pkt;
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_PENDINGS; i++) {
+		if (server->pendings[i].pending.pkt &&
+		    server->pendings[i].pending.id == id &&
+		    _zoap_sockaddr_equal(&server->pendings[i].pending.addr,
+					 from)) {
+			p = &server->pendings[i];
+			break;
+		}
+	}
+
+	if (!p) {
+		observer = reset ? observer_find_by_id(server, from, id) : NULL;
+
+		irq_unlock(key);
+
+		if (observer) {
+			observer_remove(server, observer);
+		}
+
+		return;
+	}
+
+	heap_remove(server, p);
+
+	pkt = p->pending.pkt;
+	payload = p->payload;
+	observer = p->observer;
+
+	p->pending.pkt = NULL;
+	p->pending.timeout = 0;
+	p->observer = NULL;
+	p->payload = NULL;
+
+	if (observer) {
+		observer->inflight = false;
+	}
+
+	irq_unlock(key);
+
+	net_pkt_unref(pkt);
+
+	if (payload) {
+		net_buf_unref(payload);
+	}
+
+	if (!observer) {
+		return;
+	}
+
+	if (reset) {
+		observer_remove(server, observer);
+	}
+
+	notify_schedule(server);
+}
+
+static bool token_eq(const struct zoap_packet *zpkt,
+		     const struct zoap_server_exchange *e)
+{
+	const u8_t *token;
+	u8_t tkl;
+
+	token = zoap_header_get_token(zpkt, &tkl);
+
+	return tkl == e->tkl && !memcmp(token, e->token, tkl);
+}
+
+static struct zoap_server_exchange *exchange_find(
+	struct zoap_server *server, const struct zoap_packet *zpkt,
+	const struct sockaddr *from)
+{
+	u16_t id = zoap_header_get_id(zpkt);
+	s64_t now = k_uptime_get();
+	int i;
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_EXCHANGES; i++) {
+		struct zoap_server_exchange *e = &server->exchanges[i];
+
+		if (e->id != id || e->expiry <= now) {
+			continue;
+		}
+
+		if (token_eq(zpkt, e) && _zoap_sockaddr_equal(&e->addr, from)) {
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+/* The oldest exchange is replaced, even if it has not expired yet */
+static struct zoap_server_exchange *exchange_add(
+	struct zoap_server *server, const struct zoap_packet *zpkt,
+	const struct sockaddr *from)
+{
+	struct zoap_server_exchange *e;
+	const u8_t *token;
+
+	e = &server->exchanges[server->exchange_next];
+
+	server->exchange_next = (server->exchange_next + 1) %
+		CONFIG_ZOAP_SERVER_EXCHANGES;
+
+	if (e->response) {
+		net_buf_unref(e->response);
+		e->response = NULL;
+	}
+
+	token = zoap_header_get_token(zpkt, &e->tkl);
+	memcpy(e->token, token, e->tkl);
+	memcpy(&e->addr, from, addr_len(from));
+
+	e->id = zoap_header_get_id(zpkt);
+	e->code = zoap_header_get_code(zpkt);
+	e->expiry = k_uptime_get() +
+		K_SECONDS(CONFIG_ZOAP_SERVER_EXCHANGE_LIFETIME);
+
+	return e;
+}
+
+/* Piggybacked responses carry the message ID of the request, the
+ * others its token.
+ */
+static bool exchange_record(struct zoap_server *server,
+			    const struct zoap_packet *zpkt,
+			    const struct sockaddr *addr)
+{
+	struct zoap_server_exchange *e = server->current;
+	u8_t type;
+
+	if (!e || e->response || !_zoap_sockaddr_equal(&e->addr, addr)) {
+		return false;
+	}
+
+	type = zoap_header_get_type(zpkt);
+
+	if (type == ZOAP_TYPE_ACK || type == ZOAP_TYPE_RESET) {
+		if (zoap_header_get_id(zpkt) != e->id) {
+			return false;
+		}
+	} else if (!token_eq(zpkt, e)) {
+		return false;
+	}
+
+	e->response = net_buf_ref(zpkt->pkt->frags);
+
+	return true;
+}
+
+int zoap_server_init(struct zoap_server *server,
+		     struct net_context *context,
+		     struct zoap_resource *resources)
+{
+	struct zoap_resource *resource;
+	int r;
+
+	memset(server, 0, sizeof(*server));
+
+	server->context = context;
+
+	/* The root node */
+	server->node_count = 1;
+
+	for (resource = resources; resource && resource->path; resource++) {
+		r = trie_insert(server, resource);
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	k_delayed_work_init(&server->retransmit, retransmit);
+	k_delayed_work_init(&server->notify, notify);
+
+	return 0;
+}
+
+int zoap_server_handle(struct zoap_server *server, struct zoap_packet *zpkt,
+		       const struct sockaddr *from)
+{
+	struct zoap_server_exchange *e;
+	struct zoap_resource *resource;
+	zoap_method_t method;
+	struct net_buf *response;
+	u8_t type, code;
+	int r;
+
+	type = zoap_header_get_type(zpkt);
+	code = zoap_header_get_code(zpkt);
+
+	if (type == ZOAP_TYPE_ACK || type == ZOAP_TYPE_RESET) {
+		pending_received(server, zpkt, from);
+		return 0;
+	}
+
+	if (code == ZOAP_CODE_EMPTY || (code & ~ZOAP_REQUEST_MASK)) {
+		return 0;
+	}
+
+	e = exchange_find(server, zpkt, from);
+	if (e) {
+		if (e->response) {
+			response = net_buf_ref(e->response);
+			r = send_copy(server, response, NULL, from);
+			net_buf_unref(response);
+
+			return r;
+		}
+
+		if (e->code == ZOAP_METHOD_POST) {
+			return -EALREADY;
+		}
+	} else {
+		e = exchange_add(server, zpkt, from);
+	}
+
+	resource = trie_lookup(server, zpkt);
+	if (!resource) {
+		return -ENOENT;
+	}
+
+	method = _zoap_method_from_code(resource, code);
+	if (!method) {
+		return 0;
+	}
+
+	server->current = e;
+	r = method(resource, zpkt, from);
+	server->current = NULL;
+
+	return r;
+}
+
+int zoap_server_send(struct zoap_server *server, struct zoap_packet *zpkt,
+		     const struct sockaddr *addr)
+{
+	struct net_pkt *pkt = zpkt->pkt;
+	bool kept = false;
+	int r;
+
+	if (zoap_header_get_type(zpkt) == ZOAP_TYPE_CON) {
+		r = pending_add(server, zpkt, addr, NULL, NULL);
+		if (r < 0) {
+			net_pkt_unref(pkt);
+			return r;
+		}
+
+		kept = true;
+	}
+
+	if (exchange_record(server, zpkt, addr)) {
+		kept = true;
+	}
+
+	if (!kept) {
+		r = net_context_sendto(pkt, addr, addr_len(addr),
+				       NULL, 0, NULL, NULL);
+		if (r < 0) {
+			net_pkt_unref(pkt);
+		}
+
+		return r;
+	}
+
+	r = send_copy(server, pkt->frags, NULL, addr);
+	net_pkt_unref(pkt);
+
+	return r;
+}
+
+int zoap_server_observe(struct zoap_server *server,
+			struct zoap_resource *resource,
+			const struct zoap_packet *request,
+			const struct sockaddr *from)
+{
+	struct zoap_server_observer *o = NULL;
+	struct zoap_option option;
+	const u8_t *token;
+	unsigned int key;
+	u8_t tkl, hash;
+	int i, r;
+
+	r = zoap_find_options(request, ZOAP_OPTION_OBSERVE, &option, 1);
+	if (r <= 0) {
+		return 0;
+	}
+
+	token = zoap_header_get_token(request, &tkl);
+
+	key = irq_lock();
+
+	o = observer_find(server, from, token, tkl);
+
+	/* RFC 7641, section 2: 0 registers, 1 deregisters */
+	switch (zoap_option_value_to_int(&option)) {
+	case 0:
+		break;
+	case 1:
+		irq_unlock(key);
+
+		if (o) {
+			observer_remove(server, o);
+		}
+
+		return 0;
+	default:
+		irq_unlock(key);
+		return 0;
+	}
+
+	if (o) {
+		if (o->resource != resource) {
+			zoap_remove_observer(o->resource, &o->observer);
+			zoap_register_observer(resource, &o->observer);
+			o->resource = resource;
+		}
+
+		irq_unlock(key);
+		return 1;
+	}
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_OBSERVERS; i++) {
+		if (!server->observers[i].resource) {
+			o = &server->observers[i];
+			break;
+		}
+	}
+
+	if (!o) {
+		irq_unlock(key);
+		return -ENOMEM;
+	}
+
+	memcpy(o->observer.token, token, tkl);
+	o->observer.tkl = tkl;
+	memcpy(&o->observer.addr, from, addr_len(from));
+
+	o->resource = resource;
+	o->non_count = 0;
+	o->inflight = false;
+
+	zoap_register_observer(resource, &o->observer);
+
+	hash = addr_hash(from);
+	o->next = server->buckets[hash];
+	server->buckets[hash] = i + 1;
+
+	irq_unlock(key);
+
+	return 1;
+}
+
+int zoap_server_notify(struct zoap_server *server,
+		       struct zoap_resource *resource,
+		       u16_t content_format,
+		       const void *payload, u16_t len)
+{
+	struct zoap_server_observer *o;
+	struct notify_meta *meta;
+	struct net_buf *buf, *old;
+	unsigned int key;
+
+	if (len > CONFIG_ZOAP_SERVER_NOTIFY_PAYLOAD_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	buf = net_buf_alloc(&notify_payloads, K_NO_WAIT);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	net_buf_add_mem(buf, payload, len);
+
+	meta = net_buf_user_data(buf);
+	meta->format = content_format;
+
+	key = irq_lock();
+
+	resource->age = (resource->age + 1) & MAX_OBSERVE_SEQ;
+	meta->seq = resource->age;
+
+	/* The observers are all struct zoap_server_observer */
+	SYS_SLIST_FOR_EACH_CONTAINER(&resource->observers, o, observer.list) {
+		old = o->payload;
+		o->payload = net_buf_ref(buf);
+
+		if (old) {
+			net_buf_unref(old);
+		}
+	}
+
+	irq_unlock(key);
+
+	net_buf_unref(buf);
+
+	notify_schedule(server);
+
+	return 0;
+}
+
+void zoap_server_release(struct zoap_server *server)
+{
+	int i;
+
+	k_delayed_work_cancel(&server->retransmit);
+	k_delayed_work_cancel(&server->notify);
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_PENDINGS; i++) {
+		struct zoap_server_pending *p = &server->pendings[i];
+
+		if (p->pending.pkt) {
+			zoap_pending_clear(&p->pending);
+		}
+
+		if (p->payload) {
+			net_buf_unref(p->payload);
+		}
+
+		p->observer = NULL;
+		p->payload = NULL;
+	}
+
+	server->heap_len = 0;
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_EXCHANGES; i++) {
+		if (server->exchanges[i].response) {
+			net_buf_unref(server->exchanges[i].response);
+		}
+	}
+
+	memset(server->exchanges, 0, sizeof(server->exchanges));
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_OBSERVERS; i++) {
+		observer_remove(server, &server->observers[i]);
+	}
+
+	server->notify_armed = false;
+}
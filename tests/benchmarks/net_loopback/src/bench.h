@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <zephyr.h>
+#include <net/net_ip.h>
+#include <net/net_pkt.h>
+#include <net/net_l2.h>
+
+/* Our own addresses, and the ones of the peer. The packets sent to the
+ * peer are looped back by the interface, coming from the peer.
+ */
+#define MY_IPV4_ADDR "192.0.2.1"
+#define PEER_IPV4_ADDR "192.0.2.2"
+#define MY_IPV6_ADDR "2001:db8::1"
+#define PEER_IPV6_ADDR "2001:db8::2"
+
+#define BENCH_ROUNDS 200
+#define BENCH_MAX_SIZE 1024
+
+/* Timeout of a single receive, in milliseconds */
+#define BENCH_TIMEOUT 1000
+
+struct bench_run {
+	const char *name;
+	sa_family_t family;
+	size_t size;
+	struct net_dummy_loopback_stats stats;
+	u32_t start;
+	u32_t cycles;
+	int rounds;
+	u32_t latency[BENCH_ROUNDS];
+};
+
+extern u8_t bench_data[BENCH_MAX_SIZE];
+extern u8_t bench_buf[BENCH_MAX_SIZE];
+
+void bench_addr(sa_family_t family, struct sockaddr *addr, bool peer,
+		u16_t port);
+socklen_t bench_addr_len(sa_family_t family);
+u16_t bench_port(void);
+int bench_wait(int sock);
+
+void bench_start(struct bench_run *run, const char *name,
+		 sa_family_t family, size_t size);
+void bench_sample(struct bench_run *run, u32_t latency);
+void bench_end(struct bench_run *run);
+
+int bench_udp_echo(sa_family_t family, size_t size);
+int bench_tcp_bulk(sa_family_t family, size_t size);
+int bench_tcp_rr(sa_family_t family, size_t size);
+int bench_coap(sa_family_t family, size_t size);
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+#include <tc_util.h>
+
+#include <net/net_pkt.h>
+#include <net/net_context.h>
+#include <net/socket.h>
+#include <net/zoap.h>
+#include <net/zoap_server.h>
+
+#include "bench.h"
+
+#define COAP_PORT 5683
+
+/* A CoAP message is built in a single fragment, leave room for the
+ * header and the options.
+ */
+#define COAP_MAX_PAYLOAD (CONFIG_NET_BUF_DATA_SIZE - 32)
+
+static struct net_context *server_ctx;
+static struct zoap_server server;
+static size_t payload_size;
+
+static int bench_get(struct zoap_resource *resource,
+		     struct zoap_packet *request,
+		     const struct sockaddr *from)
+{
+	struct zoap_packet response;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	const u8_t *token;
+	u8_t *payload, tkl;
+	u16_t len;
+	int r;
+
+	pkt = net_pkt_get_tx(server_ctx, K_NO_WAIT);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	frag = net_pkt_get_data(server_ctx, K_NO_WAIT);
+	if (!frag) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	net_pkt_frag_add(pkt, frag);
+
+	r = zoap_packet_init(&response, pkt);
+	if (r < 0) {
+		goto fail;
+	}
+
+	token = zoap_header_get_token(request, &tkl);
+
+	zoap_header_set_version(&response, 1);
+	zoap_header_set_type(&response, ZOAP_TYPE_ACK);
+	zoap_header_set_code(&response, ZOAP_RESPONSE_CODE_CONTENT);
+	zoap_header_set_id(&response, zoap_header_get_id(request));
+	zoap_header_set_token(&response, token, tkl);
+
+	payload = zoap_packet_get_payload(&response, &len);
+	if (!payload || len < payload_size) {
+		r = -ENOMEM;
+		goto fail;
+	}
+
+	memcpy(payload, bench_data, payload_size);
+
+	r = zoap_packet_set_used(&response, payload_size);
+	if (r < 0) {
+		goto fail;
+	}
+
+	return zoap_server_send(&server, &response, from);
+
+fail:
+	net_pkt_unref(pkt);
+
+	return r;
+}
+
+static const char * const bench_path[] = { "bench", NULL };
+
+static struct zoap_resource resources[] = {
+	{ .get = bench_get, .path = bench_path },
+	{ },
+};
+
+static void server_recv(struct net_context *context, struct net_pkt *pkt,
+			int status, void *user_data)
+{
+	struct zoap_packet request;
+	struct sockaddr from;
+	int header_len;
+
+	memset(&from, 0, sizeof(from));
+	from.family = net_pkt_family(pkt);
+
+	if (from.family == AF_INET6) {
+		net_ipaddr_copy(&net_sin6(&from)->sin6_addr,
+				&NET_IPV6_HDR(pkt)->src);
+		net_sin6(&from)->sin6_port = NET_UDP_HDR(pkt)->src_port;
+	} else {
+		net_ipaddr_copy(&net_sin(&from)->sin_addr,
+				&NET_IPV4_HDR(pkt)->src);
+		net_sin(&from)->sin_port = NET_UDP_HDR(pkt)->src_port;
+	}
+
+	header_len = net_pkt_appdata(pkt) - pkt->frags->data;
+	net_buf_pull(pkt->frags, header_len);
+
+	if (!zoap_packet_parse(&request, pkt)) {
+		zoap_server_handle(&server, &request, &from);
+	}
+
+	net_pkt_unref(pkt);
+}
+
+static int server_start(sa_family_t family)
+{
+	struct sockaddr addr;
+	int ret;
+
+	bench_addr(family, &addr, false, COAP_PORT);
+
+	ret = net_context_get(family, SOCK_DGRAM, IPPROTO_UDP, &server_ctx);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = net_context_bind(server_ctx, &addr, bench_addr_len(family));
+	if (!ret) {
+		ret = net_context_recv(server_ctx, server_recv, 0, NULL);
+	}
+
+	if (!ret) {
+		ret = zoap_server_init(&server, server_ctx, resources);
+	}
+
+	if (ret < 0) {
+		net_context_put(server_ctx);
+		server_ctx = NULL;
+	}
+
+	return ret;
+}
+
+/* Every round, the client sends a confirmable GET, answered by the
+ * server engine with a piggybacked response of the given size. The
+ * latency is the round trip time.
+ */
+int bench_coap(sa_family_t family, size_t size)
+{
+	/* Version 1, CON, no token, GET, Uri-Path "bench" */
+	u8_t request[] = { 0x40, 0x01, 0x00, 0x00,
+			   0xb5, 'b', 'e', 'n', 'c', 'h' };
+	struct sockaddr client_addr, peer_addr;
+	socklen_t addrlen = bench_addr_len(family);
+	struct bench_run run;
+	int client, i, ret;
+	ssize_t len;
+	u16_t id;
+	u32_t start;
+
+	if (size > COAP_MAX_PAYLOAD) {
+		TC_PRINT("| CoAP GET | %s | %5zu | skipped, larger than a "
+			 "fragment\n", family == AF_INET6 ? "IPv6" : "IPv4",
+			 size);
+		return 0;
+	}
+
+	payload_size = size;
+
+	bench_addr(family, &client_addr, false, bench_port());
+	bench_addr(family, &peer_addr, true, COAP_PORT);
+
+	client = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+	if (client < 0) {
+		return -ENOMEM;
+	}
+
+	if (bind(client, &client_addr, addrlen) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	ret = server_start(family);
+	if (ret < 0) {
+		goto out;
+	}
+
+	bench_start(&run, "CoAP GET", family, size);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = k_cycle_get_32();
+
+		id = zoap_next_id();
+		request[2] = id >> 8;
+		request[3] = id;
+
+		if (sendto(client, request, sizeof(request), 0, &peer_addr,
+			   addrlen) != sizeof(request)) {
+			ret = -errno;
+			break;
+		}
+
+		ret = bench_wait(client);
+		if (ret < 0) {
+			break;
+		}
+
+		/* ACK with the same message ID and 2.05 Content */
+		len = recv(client, bench_buf, sizeof(bench_buf), 0);
+		if (len < 4 || bench_buf[0] != 0x60 || bench_buf[1] != 0x45 ||
+		    bench_buf[2] != request[2] || bench_buf[3] != request[3]) {
+			ret = -EINVAL;
+			break;
+		}
+
+		bench_sample(&run, k_cycle_get_32() - start);
+	}
+
+	bench_end(&run);
+
+out:
+	if (server_ctx) {
+		zoap_server_release(&server);
+		net_context_put(server_ctx);
+		server_ctx = NULL;
+	}
+
+	close(client);
+
+	return ret;
+}
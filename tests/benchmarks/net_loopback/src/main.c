@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <tc_util.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/socket.h>
+
+#include "bench.h"
+
+u8_t bench_data[BENCH_MAX_SIZE];
+u8_t bench_buf[BENCH_MAX_SIZE];
+
+/* The payload sizes are chosen to span one, two and eight fragments of
+ * the default CONFIG_NET_BUF_DATA_SIZE.
+ */
+static const size_t sizes[] = { 16, 200, BENCH_MAX_SIZE };
+
+static u16_t next_port = 10000;
+
+void bench_addr(sa_family_t family, struct sockaddr *addr, bool peer,
+		u16_t port)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->family = family;
+
+	if (family == AF_INET6) {
+		inet_pton(AF_INET6, peer ? PEER_IPV6_ADDR : MY_IPV6_ADDR,
+			  &net_sin6(addr)->sin6_addr);
+		net_sin6(addr)->sin6_port = htons(port);
+	} else {
+		inet_pton(AF_INET, peer ? PEER_IPV4_ADDR : MY_IPV4_ADDR,
+			  &net_sin(addr)->sin_addr);
+		net_sin(addr)->sin_port = htons(port);
+	}
+}
+
+socklen_t bench_addr_len(sa_family_t family)
+{
+	return family == AF_INET6 ? sizeof(struct sockaddr_in6) :
+		sizeof(struct sockaddr_in);
+}
+
+/* Every run uses new ports, the connections of the previous runs may
+ * not be released yet.
+ */
+u16_t bench_port(void)
+{
+	return next_port++;
+}
+
+int bench_wait(int sock)
+{
+	struct pollfd pollfd = { .fd = sock, .events = POLLIN };
+
+	if (poll(&pollfd, 1, BENCH_TIMEOUT) != 1) {
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+void bench_start(struct bench_run *run, const char *name,
+		 sa_family_t family, size_t size)
+{
+	run->name = name;
+	run->family = family;
+	run->size = size;
+	run->rounds = 0;
+
+	net_dummy_loopback_stats(&run->stats);
+
+	run->start = k_cycle_get_32();
+}
+
+void bench_sample(struct bench_run *run, u32_t latency)
+{
+	if (run->rounds < BENCH_ROUNDS) {
+		run->latency[run->rounds++] = latency;
+	}
+}
+
+static void sort(u32_t *values, int count)
+{
+	u32_t value;
+	int i, j;
+
+	for (i = 1; i < count; i++) {
+		value = values[i];
+
+		for (j = i; j > 0 && values[j - 1] > value; j--) {
+			values[j] = values[j - 1];
+		}
+
+		values[j] = value;
+	}
+}
+
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC);
+}
+
+/* The packets are the ones looped back by the interface, including the
+ * TCP acknowledgements and the handshakes.
+ */
+void bench_end(struct bench_run *run)
+{
+	struct net_dummy_loopback_stats stats;
+	u32_t packets, dropped;
+	u64_t rate;
+
+	run->cycles = k_cycle_get_32() - run->start;
+
+	net_dummy_loopback_stats(&stats);
+	packets = stats.looped - run->stats.looped;
+	dropped = stats.dropped - run->stats.dropped;
+
+	if (!packets || !run->cycles || !run->rounds) {
+		TC_PRINT("| %s | %s | %5zu | no packet\n", run->name,
+			 run->family == AF_INET6 ? "IPv6" : "IPv4",
+			 run->size);
+		return;
+	}
+
+	rate = (u64_t)packets * sys_clock_hw_cycles_per_sec / run->cycles;
+
+	sort(run->latency, run->rounds);
+
+	TC_PRINT("| %s | %s | %5zu | %7u pkt/s | %7u cycles/pkt | "
+		 "%5u %5u %5u us | %u dropped\n", run->name,
+		 run->family == AF_INET6 ? "IPv6" : "IPv4", run->size,
+		 (u32_t)rate, run->cycles / packets,
+		 cycles_to_us(run->latency[run->rounds / 2]),
+		 cycles_to_us(run->latency[run->rounds * 90 / 100]),
+		 cycles_to_us(run->latency[run->rounds * 99 / 100]),
+		 dropped);
+}
+
+static int init_iface(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct sockaddr addr;
+
+	bench_addr(AF_INET6, &addr, false, 0);
+	if (!net_if_ipv6_addr_add(iface, &net_sin6(&addr)->sin6_addr,
+				  NET_ADDR_MANUAL, 0)) {
+		return -ENOMEM;
+	}
+
+	bench_addr(AF_INET, &addr, false, 0);
+	if (!net_if_ipv4_addr_add(iface, &net_sin(&addr)->sin_addr,
+				  NET_ADDR_MANUAL, 0)) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int run_family(sa_family_t family)
+{
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		ret = bench_udp_echo(family, sizes[i]);
+		if (ret < 0) {
+			TC_ERROR("UDP echo of %zu bytes failed (%d)\n",
+				 sizes[i], ret);
+			return ret;
+		}
+
+		ret = bench_tcp_rr(family, sizes[i]);
+		if (ret < 0) {
+			TC_ERROR("TCP request/response of %zu bytes failed "
+				 "(%d)\n", sizes[i], ret);
+			return ret;
+		}
+
+		ret = bench_tcp_bulk(family, sizes[i]);
+		if (ret < 0) {
+			TC_ERROR("TCP bulk of %zu bytes failed (%d)\n",
+				 sizes[i], ret);
+			return ret;
+		}
+
+		ret = bench_coap(family, sizes[i]);
+		if (ret < 0) {
+			TC_ERROR("CoAP of %zu bytes failed (%d)\n",
+				 sizes[i], ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void main(void)
+{
+	int i, result = TC_PASS;
+
+	TC_START("Network loopback benchmark");
+
+	for (i = 0; i < sizeof(bench_data); i++) {
+		bench_data[i] = i;
+	}
+
+	if (init_iface() < 0) {
+		TC_ERROR("Cannot add the addresses\n");
+		result = TC_FAIL;
+		goto end;
+	}
+
+	TC_PRINT("%d rounds per run, %d byte fragments, latency "
+		 "percentiles 50 90 99\n", BENCH_ROUNDS,
+		 CONFIG_NET_BUF_DATA_SIZE);
+
+	if (run_family(AF_INET) < 0 || run_family(AF_INET6) < 0) {
+		result = TC_FAIL;
+	}
+
+end:
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
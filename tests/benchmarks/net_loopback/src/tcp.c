@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+
+#include <net/socket.h>
+
+#include "bench.h"
+
+/* Segments sent by the client before the server reads them */
+#define BULK_BURST 4
+
+/* The client connects to the peer, the connection is accepted by the
+ * listener bound to our own address.
+ */
+static int tcp_connect(sa_family_t family, int *listener, int *client,
+		       int *server)
+{
+	struct sockaddr server_addr, peer_addr;
+	socklen_t addrlen = bench_addr_len(family);
+	u16_t port = bench_port();
+	int ret;
+
+	bench_addr(family, &server_addr, false, port);
+	bench_addr(family, &peer_addr, true, port);
+
+	*server = -1;
+
+	*listener = socket(family, SOCK_STREAM, IPPROTO_TCP);
+	*client = socket(family, SOCK_STREAM, IPPROTO_TCP);
+	if (*listener < 0 || *client < 0) {
+		return -ENOMEM;
+	}
+
+	if (bind(*listener, &server_addr, addrlen) < 0 ||
+	    listen(*listener, 1) < 0 ||
+	    connect(*client, &peer_addr, addrlen) < 0) {
+		return -errno;
+	}
+
+	ret = bench_wait(*listener);
+	if (ret < 0) {
+		return ret;
+	}
+
+	*server = accept(*listener, NULL, NULL);
+	if (*server < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void tcp_close(int listener, int client, int server)
+{
+	if (client >= 0) {
+		close(client);
+	}
+
+	if (server >= 0) {
+		close(server);
+	}
+
+	if (listener >= 0) {
+		close(listener);
+	}
+}
+
+/* Reads exactly len bytes from the stream */
+static int tcp_read(int sock, u8_t *buf, size_t len)
+{
+	ssize_t n;
+	int ret;
+
+	while (len) {
+		ret = bench_wait(sock);
+		if (ret < 0) {
+			return ret;
+		}
+
+		n = recv(sock, buf, len, 0);
+		if (n <= 0) {
+			return n < 0 ? -errno : -ECONNRESET;
+		}
+
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Every round, the client sends a request that the server answers with
+ * a response of the same size. The latency is the transaction time.
+ */
+int bench_tcp_rr(sa_family_t family, size_t size)
+{
+	struct bench_run run;
+	int listener, client, server, i, ret;
+	u32_t start;
+
+	ret = tcp_connect(family, &listener, &client, &server);
+	if (ret < 0) {
+		goto out;
+	}
+
+	bench_start(&run, "TCP rr  ", family, size);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = k_cycle_get_32();
+
+		if (send(client, bench_data, size, 0) != size) {
+			ret = -errno;
+			break;
+		}
+
+		ret = tcp_read(server, bench_buf, size);
+		if (ret < 0) {
+			break;
+		}
+
+		if (send(server, bench_buf, size, 0) != size) {
+			ret = -errno;
+			break;
+		}
+
+		ret = tcp_read(client, bench_buf, size);
+		if (ret < 0) {
+			break;
+		}
+
+		bench_sample(&run, k_cycle_get_32() - start);
+	}
+
+	bench_end(&run);
+
+	if (!ret && memcmp(bench_buf, bench_data, size)) {
+		ret = -EINVAL;
+	}
+
+out:
+	tcp_close(listener, client, server);
+
+	return ret;
+}
+
+/* The client sends bursts of segments of the given size, read by the
+ * server once the burst is sent. The latency is the time to transfer a
+ * burst.
+ */
+int bench_tcp_bulk(sa_family_t family, size_t size)
+{
+	struct bench_run run;
+	int listener, client, server, i, j, ret;
+	u32_t start;
+
+	ret = tcp_connect(family, &listener, &client, &server);
+	if (ret < 0) {
+		goto out;
+	}
+
+	bench_start(&run, "TCP bulk", family, size);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = k_cycle_get_32();
+
+		for (j = 0; j < BULK_BURST; j++) {
+			if (send(client, bench_data, size, 0) != size) {
+				ret = -errno;
+				goto end;
+			}
+		}
+
+		for (j = 0; j < BULK_BURST; j++) {
+			ret = tcp_read(server, bench_buf, size);
+			if (ret < 0) {
+				goto end;
+			}
+		}
+
+		bench_sample(&run, k_cycle_get_32() - start);
+	}
+
+end:
+	bench_end(&run);
+
+out:
+	tcp_close(listener, client, server);
+
+	return ret;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+
+#include <net/socket.h>
+
+#include "bench.h"
+
+/* Every round, the client sends a datagram that the server sends back.
+ * The latency is the round trip time.
+ */
+int bench_udp_echo(sa_family_t family, size_t size)
+{
+	struct sockaddr server_addr, client_addr, peer_addr, from;
+	socklen_t addrlen = bench_addr_len(family);
+	socklen_t from_len;
+	struct bench_run run;
+	int server, client, i, ret = 0;
+	u16_t port = bench_port();
+	u32_t start;
+
+	bench_addr(family, &server_addr, false, port);
+	bench_addr(family, &client_addr, false, bench_port());
+	bench_addr(family, &peer_addr, true, port);
+
+	server = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+	client = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+	if (server < 0 || client < 0) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (bind(server, &server_addr, addrlen) < 0 ||
+	    bind(client, &client_addr, addrlen) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	bench_start(&run, "UDP echo", family, size);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = k_cycle_get_32();
+
+		if (sendto(client, bench_data, size, 0, &peer_addr,
+			   addrlen) != size) {
+			ret = -errno;
+			break;
+		}
+
+		ret = bench_wait(server);
+		if (ret < 0) {
+			break;
+		}
+
+		from_len = sizeof(from);
+		if (recvfrom(server, bench_buf, sizeof(bench_buf), 0, &from,
+			     &from_len) != size) {
+			ret = -EMSGSIZE;
+			break;
+		}
+
+		if (sendto(server, bench_buf, size, 0, &from,
+			   from_len) != size) {
+			ret = -errno;
+			break;
+		}
+
+		ret = bench_wait(client);
+		if (ret < 0) {
+			break;
+		}
+
+		if (recv(client, bench_buf, sizeof(bench_buf), 0) != size) {
+			ret = -EMSGSIZE;
+			break;
+		}
+
+		bench_sample(&run, k_cycle_get_32() - start);
+	}
+
+	bench_end(&run);
+
+	if (!ret && memcmp(bench_buf, bench_data, size)) {
+		ret = -EINVAL;
+	}
+
+out:
+	if (server >= 0) {
+		close(server);
+	}
+
+	if (client >= 0) {
+		close(client);
+	}
+
+	return ret;
+}
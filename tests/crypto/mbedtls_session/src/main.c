@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#if !defined(CONFIG_MBEDTLS_CFG_FILE)
+#include "mbedtls/config.h"
+#else
+#include CONFIG_MBEDTLS_CFG_FILE
+#endif
+
+#include <mbedtls/platform.h>
+#include <mbedtls/memory_buffer_alloc.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/certs.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
+
+#define HANDSHAKE_COUNT 5
+
+/* Upper bound of the handshake steps, in case the peers get stuck */
+#define MAX_ROUNDS 100
+
+/* The records of a TLS flight, exchanged in memory between the peers */
+struct pipe {
+	unsigned char buf[4096];
+	size_t len;
+
+	/* Bytes written since the last reset */
+	size_t total;
+};
+
+/* The pipes written and read by a peer */
+struct link {
+	struct pipe *tx;
+	struct pipe *rx;
+};
+
+static unsigned char heap[40000];
+
+static struct pipe to_server;
+static struct pipe to_client;
+
+static struct link client_link = { &to_server, &to_client };
+static struct link server_link = { &to_client, &to_server };
+
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_x509_crt ca_cert;
+static mbedtls_x509_crt srv_cert;
+static mbedtls_pk_context srv_key;
+
+static mbedtls_ssl_config cli_conf;
+static mbedtls_ssl_config srv_conf;
+static mbedtls_ssl_context client;
+static mbedtls_ssl_context server;
+
+static mbedtls_ssl_cache_context cache;
+static mbedtls_ssl_ticket_context ticket_ctx;
+
+static int pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+	struct pipe *pipe = ((struct link *)ctx)->tx;
+
+	if (len > sizeof(pipe->buf) - pipe->len) {
+		len = sizeof(pipe->buf) - pipe->len;
+	}
+
+	if (!len) {
+		return MBEDTLS_ERR_SSL_WANT_WRITE;
+	}
+
+	memcpy(pipe->buf + pipe->len, buf, len);
+	pipe->len += len;
+	pipe->total += len;
+
+	return len;
+}
+
+static int pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+	struct pipe *pipe = ((struct link *)ctx)->rx;
+
+	if (len > pipe->len) {
+		len = pipe->len;
+	}
+
+	if (!len) {
+		return MBEDTLS_ERR_SSL_WANT_READ;
+	}
+
+	memcpy(buf, pipe->buf, len);
+	memmove(pipe->buf, pipe->buf + len, pipe->len - len);
+	pipe->len -= len;
+
+	return len;
+}
+
+static int entropy_source(void *data, unsigned char *output, size_t len)
+{
+	u32_t seed;
+
+	ARG_UNUSED(data);
+
+	while (len) {
+		size_t chunk = min(len, sizeof(seed));
+
+		seed = sys_rand32_get();
+		memcpy(output, &seed, chunk);
+
+		output += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static bool handshake_pending(int ret)
+{
+	return ret == MBEDTLS_ERR_SSL_WANT_READ ||
+	       ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+/* Run a handshake, and return the number of bytes sent by the server.
+ * The client resumes the session if there is one.
+ */
+static size_t handshake(mbedtls_ssl_session *session)
+{
+	int cli_ret = MBEDTLS_ERR_SSL_WANT_WRITE;
+	int srv_ret = MBEDTLS_ERR_SSL_WANT_READ;
+	int rounds;
+
+	zassert_equal(mbedtls_ssl_session_reset(&client), 0,
+		      "Cannot reset client");
+	zassert_equal(mbedtls_ssl_session_reset(&server), 0,
+		      "Cannot reset server");
+
+	to_server.len = to_server.total = 0;
+	to_client.len = to_client.total = 0;
+
+	if (session) {
+		zassert_equal(mbedtls_ssl_set_session(&client, session), 0,
+			      "Cannot set session");
+	}
+
+	for (rounds = 0; rounds < MAX_ROUNDS; rounds++) {
+		if (cli_ret) {
+			cli_ret = mbedtls_ssl_handshake(&client);
+			zassert_true(!cli_ret || handshake_pending(cli_ret),
+				     "Client handshake failed");
+		}
+
+		if (srv_ret) {
+			srv_ret = mbedtls_ssl_handshake(&server);
+			zassert_true(!srv_ret || handshake_pending(srv_ret),
+				     "Server handshake failed");
+		}
+
+		if (!cli_ret && !srv_ret) {
+			break;
+		}
+	}
+
+	zassert_true(rounds < MAX_ROUNDS, "Handshake stuck");
+
+	return to_client.total;
+}
+
+/* Not a pass/fail test for the timing, compares the cost of a full
+ * handshake with the cost of resuming the session. The resumption is
+ * checked with the size of the server flights, that no longer carry the
+ * certificate.
+ */
+static void measure(const char *name)
+{
+	mbedtls_ssl_session session;
+	size_t full_len, resumed_len = 0;
+	u32_t start, cycles_full, cycles_resumed;
+	int i;
+
+	mbedtls_ssl_session_init(&session);
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < HANDSHAKE_COUNT; i++) {
+		full_len = handshake(NULL);
+	}
+
+	cycles_full = k_cycle_get_32() - start;
+
+	zassert_equal(mbedtls_ssl_get_session(&client, &session), 0,
+		      "Cannot get session");
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < HANDSHAKE_COUNT; i++) {
+		resumed_len = handshake(&session);
+
+		zassert_true(resumed_len < full_len / 2, "Session not resumed");
+	}
+
+	cycles_resumed = k_cycle_get_32() - start;
+
+	mbedtls_ssl_session_free(&session);
+
+	printk("%s: %u cycles per full handshake (%zu bytes), "
+	       "%u cycles per resumed handshake (%zu bytes)\n", name,
+	       cycles_full / HANDSHAKE_COUNT, full_len,
+	       cycles_resumed / HANDSHAKE_COUNT, resumed_len);
+}
+
+static void test_init(void)
+{
+	mbedtls_memory_buffer_alloc_init(heap, sizeof(heap));
+
+	mbedtls_ctr_drbg_init(&ctr_drbg);
+	zassert_equal(mbedtls_ctr_drbg_seed(&ctr_drbg, entropy_source, NULL,
+					    NULL, 0), 0,
+		      "Cannot seed the random generator");
+
+	mbedtls_x509_crt_init(&ca_cert);
+	zassert_equal(mbedtls_x509_crt_parse(&ca_cert,
+				(const unsigned char *)mbedtls_test_cas_pem,
+				mbedtls_test_cas_pem_len), 0,
+		      "Cannot parse CA certificate");
+
+	mbedtls_x509_crt_init(&srv_cert);
+	zassert_equal(mbedtls_x509_crt_parse(&srv_cert,
+				(const unsigned char *)mbedtls_test_srv_crt,
+				mbedtls_test_srv_crt_len), 0,
+		      "Cannot parse server certificate");
+
+	mbedtls_pk_init(&srv_key);
+	zassert_equal(mbedtls_pk_parse_key(&srv_key,
+				(const unsigned char *)mbedtls_test_srv_key,
+				mbedtls_test_srv_key_len, NULL, 0), 0,
+		      "Cannot parse server key");
+
+	mbedtls_ssl_config_init(&cli_conf);
+	zassert_equal(mbedtls_ssl_config_defaults(&cli_conf,
+						  MBEDTLS_SSL_IS_CLIENT,
+						  MBEDTLS_SSL_TRANSPORT_STREAM,
+						  MBEDTLS_SSL_PRESET_DEFAULT),
+		      0, "Cannot configure client");
+	mbedtls_ssl_conf_rng(&cli_conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	mbedtls_ssl_conf_authmode(&cli_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_ca_chain(&cli_conf, &ca_cert, NULL);
+
+	mbedtls_ssl_config_init(&srv_conf);
+	zassert_equal(mbedtls_ssl_config_defaults(&srv_conf,
+						  MBEDTLS_SSL_IS_SERVER,
+						  MBEDTLS_SSL_TRANSPORT_STREAM,
+						  MBEDTLS_SSL_PRESET_DEFAULT),
+		      0, "Cannot configure server");
+	mbedtls_ssl_conf_rng(&srv_conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	zassert_equal(mbedtls_ssl_conf_own_cert(&srv_conf, &srv_cert,
+						&srv_key), 0,
+		      "Cannot set server certificate");
+
+	mbedtls_ssl_cache_init(&cache);
+
+	mbedtls_ssl_ticket_init(&ticket_ctx);
+	zassert_equal(mbedtls_ssl_ticket_setup(&ticket_ctx,
+					       mbedtls_ctr_drbg_random,
+					       &ctr_drbg,
+					       MBEDTLS_CIPHER_AES_128_GCM,
+					       MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME),
+		      0, "Cannot set up tickets");
+
+	mbedtls_ssl_init(&client);
+	zassert_equal(mbedtls_ssl_setup(&client, &cli_conf), 0,
+		      "Cannot set up client");
+	zassert_equal(mbedtls_ssl_set_hostname(&client, "localhost"), 0,
+		      "Cannot set hostname");
+	mbedtls_ssl_set_bio(&client, &client_link, pipe_send, pipe_recv, NULL);
+
+	mbedtls_ssl_init(&server);
+	zassert_equal(mbedtls_ssl_setup(&server, &srv_conf), 0,
+		      "Cannot set up server");
+	mbedtls_ssl_set_bio(&server, &server_link, pipe_send, pipe_recv, NULL);
+}
+
+static void test_session_cache(void)
+{
+	mbedtls_ssl_conf_session_tickets(&cli_conf,
+					 MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+	mbedtls_ssl_conf_session_cache(&srv_conf, &cache,
+				       mbedtls_ssl_cache_get,
+				       mbedtls_ssl_cache_set);
+	mbedtls_ssl_conf_session_tickets_cb(&srv_conf, NULL, NULL, NULL);
+
+	measure("Session cache");
+}
+
+static void test_session_tickets(void)
+{
+	mbedtls_ssl_conf_session_tickets(&cli_conf,
+					 MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+	mbedtls_ssl_conf_session_cache(&srv_conf, NULL, NULL, NULL);
+	mbedtls_ssl_conf_session_tickets_cb(&srv_conf,
+					    mbedtls_ssl_ticket_write,
+					    mbedtls_ssl_ticket_parse,
+					    &ticket_ctx);
+
+	measure("Session tickets");
+}
+
+static void test_release(void)
+{
+	mbedtls_ssl_free(&client);
+	mbedtls_ssl_free(&server);
+	mbedtls_ssl_ticket_free(&ticket_ctx);
+	mbedtls_ssl_cache_free(&cache);
+	mbedtls_ssl_config_free(&cli_conf);
+	mbedtls_ssl_config_free(&srv_conf);
+	mbedtls_pk_free(&srv_key);
+	mbedtls_x509_crt_free(&srv_cert);
+	mbedtls_x509_crt_free(&ca_cert);
+	mbedtls_ctr_drbg_free(&ctr_drbg);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(mbedtls_session_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_session_cache),
+			 ztest_unit_test(test_session_tickets),
+			 ztest_unit_test(test_release));
+
+	ztest_run_test_suite(mbedtls_session_tests);
+}
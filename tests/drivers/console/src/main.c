@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <ztest.h>
+
+#include <drivers/console/console_batch.h>
+
+#define LONG_INTERVAL 1000
+#define SHORT_INTERVAL 20
+
+static struct console_batch batch;
+static u8_t buf[8];
+static int flushes;
+
+static void flush(struct console_batch *b)
+{
+	zassert_equal_ptr(b, &batch, "Wrong batch flushed");
+	flushes++;
+}
+
+/* Every test resets the batch at the end, which stops its timer before
+ * the next test initializes it again.
+ */
+static void setup(u32_t threshold, s32_t interval)
+{
+	flushes = 0;
+	zassert_equal(console_batch_init(&batch, buf, sizeof(buf), threshold,
+					 interval, flush), 0,
+		      "Cannot initialize");
+}
+
+static void put(const char *str)
+{
+	while (*str) {
+		zassert_equal(console_batch_put(&batch, *str++), 0,
+			      "Cannot put");
+	}
+}
+
+static void drain(void)
+{
+	u8_t *data;
+	u32_t len;
+
+	while ((len = console_batch_peek(&batch, &data))) {
+		console_batch_consume(&batch, len);
+	}
+}
+
+static void test_init(void)
+{
+	zassert_equal(console_batch_init(&batch, buf, 6, 4, LONG_INTERVAL,
+					 flush), -EINVAL,
+		      "Size not a power of two accepted");
+}
+
+static void test_threshold(void)
+{
+	setup(4, LONG_INTERVAL);
+
+	put("abc");
+	zassert_equal(flushes, 0, "Flushed below the threshold");
+
+	put("d");
+	zassert_equal(flushes, 1, "Not flushed at the threshold");
+
+	/* Only once per batch */
+	put("ef");
+	zassert_equal(flushes, 1, "Flushed twice");
+
+	drain();
+
+	put("ghij");
+	zassert_equal(flushes, 2, "Next batch not flushed");
+
+	console_batch_reset(&batch);
+}
+
+static void test_interval(void)
+{
+	setup(4, SHORT_INTERVAL);
+
+	put("a");
+	zassert_equal(flushes, 0, "Flushed before the interval");
+
+	k_sleep(2 * SHORT_INTERVAL);
+	zassert_equal(flushes, 1, "Not flushed after the interval");
+
+	/* The batch was already notified */
+	put("bcd");
+	zassert_equal(flushes, 1, "Flushed twice");
+
+	drain();
+
+	/* Nothing pending, nothing to flush */
+	k_sleep(2 * SHORT_INTERVAL);
+	zassert_equal(flushes, 1, "Empty batch flushed");
+
+	console_batch_reset(&batch);
+}
+
+static void test_wrap_around(void)
+{
+	u8_t *data;
+	u32_t len;
+
+	setup(sizeof(buf), LONG_INTERVAL);
+
+	put("012345");
+	drain();
+
+	put("abcde");
+
+	len = console_batch_peek(&batch, &data);
+	zassert_equal(len, 2, "Chunk not stopped at the end of the buffer");
+	zassert_true(!memcmp(data, "ab", len), "Wrong data");
+
+	/* Nothing is removed until consumed */
+	len = console_batch_peek(&batch, &data);
+	zassert_equal(len, 2, "Chunk changed by peek");
+
+	console_batch_consume(&batch, len);
+
+	len = console_batch_peek(&batch, &data);
+	zassert_equal(len, 3, "Wrong wrapped chunk length");
+	zassert_equal_ptr(data, buf, "Chunk not at the start of the buffer");
+	zassert_true(!memcmp(data, "cde", len), "Wrong wrapped data");
+
+	console_batch_consume(&batch, len);
+
+	zassert_equal(console_batch_peek(&batch, &data), 0, "Not empty");
+
+	console_batch_reset(&batch);
+}
+
+static void test_drop(void)
+{
+	u8_t *data;
+	int i;
+
+	setup(sizeof(buf), LONG_INTERVAL);
+
+	for (i = 0; i < sizeof(buf); i++) {
+		zassert_equal(console_batch_put(&batch, i), 0, "Cannot put");
+	}
+
+	zassert_equal(console_batch_put(&batch, 'x'), -ENOSPC,
+		      "Put in a full batch");
+	zassert_equal(console_batch_put(&batch, 'y'), -ENOSPC,
+		      "Put in a full batch");
+	zassert_equal(console_batch_dropped(&batch), 2, "Wrong dropped count");
+
+	/* The oldest output is kept */
+	zassert_equal(console_batch_peek(&batch, &data), sizeof(buf),
+		      "Wrong pending length");
+	zassert_equal(data[0], 0, "Oldest output lost");
+
+	console_batch_consume(&batch, 1);
+	zassert_equal(console_batch_put(&batch, 'z'), 0, "Cannot put");
+	zassert_equal(console_batch_dropped(&batch), 2, "Wrong dropped count");
+
+	console_batch_reset(&batch);
+}
+
+static void test_reset(void)
+{
+	u8_t *data;
+
+	setup(4, SHORT_INTERVAL);
+
+	put("ab");
+	console_batch_reset(&batch);
+
+	zassert_equal(console_batch_peek(&batch, &data), 0,
+		      "Output left after reset");
+	zassert_equal(console_batch_dropped(&batch), 0,
+		      "Reset output counted as dropped");
+
+	/* The interval was stopped with the batch */
+	k_sleep(2 * SHORT_INTERVAL);
+	zassert_equal(flushes, 0, "Reset batch flushed");
+
+	/* and the next batch is notified again */
+	put("cdef");
+	zassert_equal(flushes, 1, "Not flushed after reset");
+
+	console_batch_reset(&batch);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(console_batch_test,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_threshold),
+			 ztest_unit_test(test_interval),
+			 ztest_unit_test(test_wrap_around),
+			 ztest_unit_test(test_drop),
+			 ztest_unit_test(test_reset));
+
+	ztest_run_test_suite(console_batch_test);
+}
@@ -9,6 +9,10 @@
 #include <ztest.h>
 #include <json.h>
 
+#if defined(CONFIG_JSON_NET_PKT)
+#include <net/net_pkt.h>
+#endif
+
 struct test_nested {
 	int nested_int;
 	bool nested_bool;
@@ -452,6 +456,550 @@ static void test_json_escape_bounds_check(void)
 	zassert_equal(ret, -ENOMEM, "Bounds check OK");
 }
 
+static const char stream_encoded[] = "{\"some_string\":\"zephyr 123\","
+	"\"some_int\":\t42\n,"
+	"\"some_bool\":true    \t  \r\n,"
+	"\"unknown\":{\"a\":[1,{\"b\":null}],\"c\":\"x\"},"
+	"\"some_nested_struct\":{\"nested_int\":-1234,"
+	"\"nested_bool\":false,"
+	"\"nested_string\":\"this should be escaped: \\t\"},"
+	"\"some_array\":[11,22, 33,\t45,\n299],"
+	"\"another_b!@l\":true,"
+	"\"if\":false,"
+	"\"skipped\":-12.5e3,"
+	"\"another-array\":[2,3,5,7],"
+	"\"4nother_ne$+\":{\"nested_int\":1234,"
+	"\"nested_bool\":true,"
+	"\"nested_string\":\"no escape \\u00e9\"}"
+	"}";
+
+/* Feeds @a json by chunks of @a chunk bytes, each chunk being
+ * overwritten once fed.
+ */
+static int stream_feed(const char *json, size_t len, size_t chunk,
+		       const struct json_obj_descr *descr, size_t descr_len,
+		       void *val, char *strings, size_t strings_size)
+{
+	struct json_stream stream;
+	char buf[64];
+	size_t pos, n;
+	int ret = -EAGAIN;
+
+	json_stream_init(&stream, descr, descr_len, val, strings,
+			 strings_size);
+
+	for (pos = 0; pos < len && ret == -EAGAIN; pos += n) {
+		n = min(min(len - pos, chunk), sizeof(buf));
+
+		memcpy(buf, json + pos, n);
+		ret = json_stream_feed(&stream, buf, n);
+		memset(buf, '!', n);
+	}
+
+	return ret;
+}
+
+static void test_json_stream_decoding(void)
+{
+	const int expected_array[] = { 11, 22, 33, 45, 299 };
+	const int expected_other_array[] = { 2, 3, 5, 7 };
+	struct test_struct ts;
+	char strings[96];
+	size_t chunk;
+	int ret;
+
+	for (chunk = 1; chunk <= sizeof(stream_encoded); chunk++) {
+		memset(&ts, 0, sizeof(ts));
+
+		ret = stream_feed(stream_encoded, sizeof(stream_encoded) - 1,
+				  chunk, test_descr, ARRAY_SIZE(test_descr),
+				  &ts, strings, sizeof(strings));
+
+		zassert_equal(ret, (1 << ARRAY_SIZE(test_descr)) - 1,
+			      "All fields decoded correctly");
+
+		zassert_true(!strcmp(ts.some_string, "zephyr 123"),
+			     "String decoded correctly");
+		zassert_equal(ts.some_int, 42,
+			      "Positive integer decoded correctly");
+		zassert_equal(ts.some_bool, true, "Boolean decoded correctly");
+		zassert_equal(ts.some_nested_struct.nested_int, -1234,
+			      "Nested negative integer decoded correctly");
+		zassert_equal(ts.some_nested_struct.nested_bool, false,
+			      "Nested boolean value decoded correctly");
+		zassert_true(!strcmp(ts.some_nested_struct.nested_string,
+				     "this should be escaped: \\t"),
+			     "Nested string decoded correctly");
+		zassert_equal(ts.some_array_len, 5,
+			      "Array has correct number of items");
+		zassert_true(!memcmp(ts.some_array, expected_array,
+				     sizeof(expected_array)),
+			     "Array decoded with expected values");
+		zassert_true(ts.another_bxxl,
+			     "Named boolean (special chars) decoded correctly");
+		zassert_false(ts.if_, "Named boolean (reserved word) "
+			      "decoded correctly");
+		zassert_equal(ts.another_array_len, 4,
+			      "Named array has correct number of items");
+		zassert_true(!memcmp(ts.another_array, expected_other_array,
+				     sizeof(expected_other_array)),
+			     "Decoded named array with expected values");
+		zassert_equal(ts.xnother_nexx.nested_int, 1234,
+			      "Named nested integer decoded correctly");
+		zassert_equal(ts.xnother_nexx.nested_bool, true,
+			      "Named nested boolean decoded correctly");
+		zassert_true(!strcmp(ts.xnother_nexx.nested_string,
+				     "no escape \\u00e9"),
+			     "Named nested string decoded correctly");
+	}
+}
+
+static void test_json_stream_obj_arr_decoding(void)
+{
+	const char encoded[] = "{\"elements\":["
+		"{\"name\":\"Simón Bolívar\",\"height\":168},"
+		"{\"height\":160,\"name\":\"Muggsy Bogues\"},"
+		"{\"name\":\"Pelé\",\"height\":173}"
+		"]}";
+	struct obj_array oa;
+	char strings[64];
+	int ret;
+
+	ret = stream_feed(encoded, sizeof(encoded) - 1, 7, obj_array_descr,
+			  ARRAY_SIZE(obj_array_descr), &oa, strings,
+			  sizeof(strings));
+
+	zassert_equal(ret, (1 << ARRAY_SIZE(obj_array_descr)) - 1,
+		      "Array of object fields decoded correctly");
+	zassert_equal(oa.num_elements, 3,
+		      "Number of object fields decoded correctly");
+	zassert_true(!strcmp(oa.elements[0].name, "Simón Bolívar"),
+		     "Element 0 name decoded correctly");
+	zassert_equal(oa.elements[0].height, 168,
+		      "Element 0 height decoded correctly");
+	zassert_true(!strcmp(oa.elements[1].name, "Muggsy Bogues"),
+		     "Element 1 name decoded correctly");
+	zassert_equal(oa.elements[1].height, 160,
+		      "Element 1 height decoded correctly");
+	zassert_true(!strcmp(oa.elements[2].name, "Pelé"),
+		     "Element 2 name decoded correctly");
+	zassert_equal(oa.elements[2].height, 173,
+		      "Element 2 height decoded correctly");
+}
+
+static void check_stream_error(const char *json, int expected)
+{
+	struct test_struct ts;
+	char strings[32];
+	int ret;
+
+	ret = stream_feed(json, strlen(json), 3, test_descr,
+			  ARRAY_SIZE(test_descr), &ts, strings,
+			  sizeof(strings));
+	zassert_equal(ret, expected, json);
+}
+
+static void test_json_stream_errors(void)
+{
+	check_stream_error("{\"some_string\":\"\\uABC@\"}", -EINVAL);
+	check_stream_error("{\"some_string\"", -EAGAIN);
+	check_stream_error("{\"some_string\",}", -EINVAL);
+	check_stream_error("{\"some_string\":false}", -EINVAL);
+	check_stream_error("{\"some_bool\":tru}", -EINVAL);
+	check_stream_error("{\"some_bool\":true,}", -EINVAL);
+	check_stream_error("{\"some_bool\":true} {", -EINVAL);
+	check_stream_error("[]", -EINVAL);
+	check_stream_error("{\"some_int\":1.5}", -EINVAL);
+	check_stream_error("{\"some_int\":-}", -EINVAL);
+	check_stream_error("{\"some_int\":2147483648}", -ERANGE);
+	check_stream_error("{\"some_int\":-2147483649}", -ERANGE);
+	check_stream_error("{\"some_array\":[1,2,]}", -EINVAL);
+	check_stream_error("{\"some_array\":[1 2]}", -EINVAL);
+	check_stream_error("{\"some_array\":[null]}", -EINVAL);
+	check_stream_error("{\"another-array\":[1,2,3,4,5,6,7,8,9,10,11]}",
+			   -ENOSPC);
+	check_stream_error("{\"some_string\":"
+			   "\"this one is longer than the string buffer\"}",
+			   -ENOMEM);
+
+	check_stream_error("{}", 0);
+	check_stream_error("{\"key_not_in_descr\":123456}", 0);
+	check_stream_error("{\"some_int\":null}", 0);
+	check_stream_error("{\"some_int\":-2147483648}", 2);
+	check_stream_error("{\"some_array\":[]}", 16);
+	check_stream_error("{\"a_key_longer_than_any_field_name_of_test_descr\""
+			   ":[[[[[[[[[[[[1]]]]]]]]]]]],\"if\":true}", 64);
+}
+
+struct token_check {
+	char tokens[32];
+	size_t count;
+	char string[32];
+	size_t len;
+};
+
+static int token_cb(const struct json_token *token, void *data)
+{
+	struct token_check *check = data;
+
+	if (token->type == JSON_TOK_STRING || token->type == JSON_TOK_NUMBER) {
+		memcpy(check->string + check->len, token->start, token->len);
+		check->len += token->len;
+
+		if (token->partial) {
+			return 0;
+		}
+	}
+
+	check->tokens[check->count++] = token->type;
+
+	return 0;
+}
+
+/* The tokens split between two chunks are passed in pieces, pointing
+ * into the chunks.
+ */
+static void test_json_tokenizer(void)
+{
+	const char *chunks[] = { "{\"ke", "y\":[tr", "ue,-1", "2", ",\"\\u00",
+				 "e9\",", "null]}" };
+	struct json_tokenizer tokenizer;
+	struct token_check check = { };
+	int i;
+
+	json_tokenizer_init(&tokenizer, token_cb, &check);
+
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		zassert_equal(json_tokenizer_feed(&tokenizer, chunks[i],
+						  strlen(chunks[i])), 0,
+			      "Chunk not accepted");
+	}
+
+	zassert_true(!strcmp(check.tokens, "{\":[t,0,\",n]}"),
+		     "Wrong tokens");
+	zassert_equal(check.len, strlen("key-12\\u00e9"), "Wrong pieces");
+	zassert_true(!memcmp(check.string, "key-12\\u00e9", check.len),
+		     "Wrong pieces");
+
+	zassert_equal(json_tokenizer_feed(&tokenizer, "x", 1), -EINVAL,
+		      "Invalid token accepted");
+	zassert_equal(json_tokenizer_feed(&tokenizer, "{", 1), -EINVAL,
+		      "Error not kept");
+}
+
+#define BENCHMARK_OBJECTS 100
+#define BENCHMARK_CHUNK 64
+
+/* Not a pass/fail test, compares json_obj_parse(), which needs the
+ * payload in a contiguous and writable buffer, with json_stream_feed()
+ * fed by chunks as they would arrive in network buffers.
+ */
+static void test_json_stream_benchmark(void)
+{
+	static const char payload[] = "{\"some_string\":\"zephyr 123\","
+		"\"some_int\":42,\"some_bool\":true,"
+		"\"some_nested_struct\":{\"nested_int\":-1234,"
+		"\"nested_bool\":false,\"nested_string\":"
+		"\"this should be escaped: \\t\"},"
+		"\"some_array\":[1,4,8,16,32],"
+		"\"another_b!@l\":true,"
+		"\"if\":false,"
+		"\"another-array\":[2,3,5,7],"
+		"\"4nother_ne$+\":{\"nested_int\":1234,"
+		"\"nested_bool\":true,"
+		"\"nested_string\":\"no escape necessary\"}"
+		"}";
+	static char linear[sizeof(payload)];
+	struct json_stream stream;
+	struct test_struct ts;
+	u32_t start, cycles_parse, cycles_stream;
+	char strings[96];
+	size_t pos, n;
+	int i, ret = -EAGAIN;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCHMARK_OBJECTS; i++) {
+		/* The chunks are linearized into a buffer first */
+		for (pos = 0; pos < sizeof(payload) - 1; pos += n) {
+			n = min(sizeof(payload) - 1 - pos, BENCHMARK_CHUNK);
+			memcpy(linear + pos, payload + pos, n);
+		}
+
+		ret = json_obj_parse(linear, sizeof(payload) - 1, test_descr,
+				     ARRAY_SIZE(test_descr), &ts);
+		zassert_equal(ret, (1 << ARRAY_SIZE(test_descr)) - 1,
+			      "Object not decoded");
+	}
+
+	cycles_parse = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCHMARK_OBJECTS; i++) {
+		json_stream_init(&stream, test_descr, ARRAY_SIZE(test_descr),
+				 &ts, strings, sizeof(strings));
+
+		for (pos = 0; pos < sizeof(payload) - 1; pos += n) {
+			n = min(sizeof(payload) - 1 - pos, BENCHMARK_CHUNK);
+			ret = json_stream_feed(&stream, payload + pos, n);
+		}
+
+		zassert_equal(ret, (1 << ARRAY_SIZE(test_descr)) - 1,
+			      "Object not decoded");
+	}
+
+	cycles_stream = k_cycle_get_32() - start;
+
+	printk("%d objects of %d bytes: %u cycles per object with "
+	       "json_obj_parse(), %u cycles per object with "
+	       "json_stream_feed()\n", BENCHMARK_OBJECTS,
+	       (int)sizeof(payload) - 1, cycles_parse / BENCHMARK_OBJECTS,
+	       cycles_stream / BENCHMARK_OBJECTS);
+}
+
+static const struct test_struct plan_ts = {
+	.some_string = "zephyr 123",
+	.some_int = 42,
+	.some_bool = true,
+	.some_nested_struct = {
+		.nested_int = -1234,
+		.nested_bool = false,
+		.nested_string = "this should be escaped: \t"
+	},
+	.some_array = { 1, 4, 8, 16, 32 },
+	.some_array_len = 5,
+	.another_bxxl = true,
+	.if_ = false,
+	.another_array = { 2, 3, 5, 7 },
+	.another_array_len = 4,
+	.xnother_nexx = {
+		.nested_int = 1234,
+		.nested_bool = true,
+		.nested_string = "no escape necessary",
+	},
+};
+
+static const char plan_encoded[] = "{\"some_string\":\"zephyr 123\","
+	"\"some_int\":42,\"some_bool\":true,"
+	"\"some_nested_struct\":{\"nested_int\":-1234,"
+	"\"nested_bool\":false,\"nested_string\":"
+	"\"this should be escaped: \\t\"},"
+	"\"some_array\":[1,4,8,16,32],"
+	"\"another_b!@l\":true,"
+	"\"if\":false,"
+	"\"another-array\":[2,3,5,7],"
+	"\"4nother_ne$+\":{\"nested_int\":1234,"
+	"\"nested_bool\":true,"
+	"\"nested_string\":\"no escape necessary\"}"
+	"}";
+
+struct plan_output {
+	char buffer[sizeof(plan_encoded)];
+	size_t used;
+	int calls;
+};
+
+static int plan_append(const char *bytes, size_t len, void *data)
+{
+	struct plan_output *output = data;
+
+	if (len > sizeof(output->buffer) - output->used) {
+		return -ENOMEM;
+	}
+
+	memcpy(output->buffer + output->used, bytes, len);
+	output->used += len;
+	output->calls++;
+
+	return 0;
+}
+
+static void test_json_plan_encoding(void)
+{
+	struct json_plan_op ops[24];
+	char text[256];
+	struct json_plan plan;
+	struct plan_output output = { .used = 0 };
+	char buffer[sizeof(plan_encoded)];
+	int ret;
+
+	ret = json_plan_compile(&plan, test_descr, ARRAY_SIZE(test_descr),
+				ops, ARRAY_SIZE(ops), text, sizeof(text));
+	zassert_equal(ret, 0, "Plan compiled");
+
+	zassert_equal(json_plan_calc_len(&plan, &plan_ts),
+		      sizeof(plan_encoded), "Length calculated");
+
+	ret = json_plan_encode_buf(&plan, &plan_ts, buffer, sizeof(buffer));
+	zassert_equal(ret, 0, "Encoding function returned no errors");
+	zassert_true(!strcmp(buffer, plan_encoded),
+		     "Encoded contents consistent");
+
+	ret = json_plan_encode_buf(&plan, &plan_ts, buffer,
+				   sizeof(buffer) - 1);
+	zassert_equal(ret, -ENOMEM, "Buffer overflow not detected");
+
+	ret = json_plan_encode(&plan, &plan_ts, plan_append, &output);
+	zassert_equal(ret, 0, "Encoding function returned no errors");
+	zassert_equal(output.used, sizeof(plan_encoded),
+		      "Terminating NUL not appended");
+	zassert_true(!strcmp(output.buffer, plan_encoded),
+		     "Encoded contents consistent");
+	zassert_equal(output.calls, (sizeof(plan_encoded) +
+				     CONFIG_JSON_PLAN_BATCH_SIZE - 1) /
+		      CONFIG_JSON_PLAN_BATCH_SIZE,
+		      "Output not appended in full batches");
+}
+
+static void test_json_plan_obj_arr_encoding(void)
+{
+	struct obj_array oa = {
+		.elements = {
+			[0] = { .name = "Simón Bolívar",   .height = 168 },
+			[1] = { .name = "Muggsy Bogues",   .height = 160 },
+			[2] = { .name = "Pelé",            .height = 173 },
+		},
+		.num_elements = 3,
+	};
+	const char encoded[] = "{\"elements\":["
+		"{\"name\":\"Simón Bolívar\",\"height\":168},"
+		"{\"name\":\"Muggsy Bogues\",\"height\":160},"
+		"{\"name\":\"Pelé\",\"height\":173}"
+		"]}";
+	struct json_plan_op ops[8];
+	char text[64];
+	struct json_plan plan;
+	char buffer[sizeof(encoded)];
+	int ret;
+
+	ret = json_plan_compile(&plan, obj_array_descr,
+				ARRAY_SIZE(obj_array_descr), ops,
+				ARRAY_SIZE(ops), text, sizeof(text));
+	zassert_equal(ret, 0, "Plan compiled");
+
+	ret = json_plan_encode_buf(&plan, &oa, buffer, sizeof(buffer));
+	zassert_equal(ret, 0, "Encoding array of object returned no errors");
+	zassert_true(!strcmp(buffer, encoded),
+		     "Encoded array of objects is consistent");
+
+	oa.num_elements = 0;
+
+	ret = json_plan_encode_buf(&plan, &oa, buffer, sizeof(buffer));
+	zassert_equal(ret, 0, "Encoding empty array returned no errors");
+	zassert_true(!strcmp(buffer, "{\"elements\":[]}"),
+		     "Encoded empty array is consistent");
+}
+
+static void test_json_plan_compile_errors(void)
+{
+	struct json_plan_op ops[24];
+	char text[256];
+	struct json_plan plan;
+	int ret;
+
+	ret = json_plan_compile(&plan, test_descr, ARRAY_SIZE(test_descr),
+				ops, 4, text, sizeof(text));
+	zassert_equal(ret, -ENOMEM, "Too many operations not detected");
+
+	ret = json_plan_compile(&plan, test_descr, ARRAY_SIZE(test_descr),
+				ops, ARRAY_SIZE(ops), text, 32);
+	zassert_equal(ret, -ENOMEM, "Text overflow not detected");
+}
+
+#if defined(CONFIG_JSON_NET_PKT)
+static void test_json_plan_pkt_encoding(void)
+{
+	struct json_plan_op ops[24];
+	char text[256];
+	struct json_plan plan;
+	char buffer[sizeof(plan_encoded)];
+	struct net_pkt *pkt;
+	int ret;
+
+	ret = json_plan_compile(&plan, test_descr, ARRAY_SIZE(test_descr),
+				ops, ARRAY_SIZE(ops), text, sizeof(text));
+	zassert_equal(ret, 0, "Plan compiled");
+
+	pkt = net_pkt_get_reserve_tx(0, K_NO_WAIT);
+	zassert_not_null(pkt, "No packet available");
+
+	ret = json_plan_encode_pkt(&plan, &plan_ts, pkt, K_NO_WAIT);
+	zassert_equal(ret, 0, "Encoding function returned no errors");
+	zassert_equal(net_pkt_get_len(pkt), sizeof(plan_encoded) - 1,
+		      "Packet has the wrong length");
+	zassert_not_null(pkt->frags->frags, "Packet has a single fragment");
+
+	ret = net_frag_linearize(buffer, sizeof(buffer), pkt, 0,
+				 sizeof(plan_encoded) - 1);
+	zassert_equal(ret, sizeof(plan_encoded) - 1, "Packet not linearized");
+	buffer[ret] = '\0';
+	zassert_true(!strcmp(buffer, plan_encoded),
+		     "Encoded contents consistent");
+
+	net_pkt_unref(pkt);
+}
+#else
+static void test_json_plan_pkt_encoding(void)
+{
+	/* Covered when built with prj_net.conf */
+}
+#endif /* CONFIG_JSON_NET_PKT */
+
+#define BENCHMARK_ENCODINGS 100
+
+/* Not a pass/fail test, compares the sizing and the encoding from the
+ * descriptors with json_obj_encode_buf() and from a compiled plan.
+ */
+static void test_json_plan_benchmark(void)
+{
+	struct json_plan_op ops[24];
+	char text[256];
+	struct json_plan plan;
+	char buffer[sizeof(plan_encoded)];
+	u32_t start, cycles_descr, cycles_plan;
+	ssize_t len;
+	int i, ret;
+
+	ret = json_plan_compile(&plan, test_descr, ARRAY_SIZE(test_descr),
+				ops, ARRAY_SIZE(ops), text, sizeof(text));
+	zassert_equal(ret, 0, "Plan compiled");
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCHMARK_ENCODINGS; i++) {
+		len = json_calc_encoded_len(test_descr,
+					    ARRAY_SIZE(test_descr), &plan_ts);
+		zassert_equal(len, sizeof(plan_encoded), "Wrong length");
+
+		ret = json_obj_encode_buf(test_descr, ARRAY_SIZE(test_descr),
+					  &plan_ts, buffer, sizeof(buffer));
+		zassert_equal(ret, 0, "Object not encoded");
+	}
+
+	cycles_descr = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCHMARK_ENCODINGS; i++) {
+		len = json_plan_calc_len(&plan, &plan_ts);
+		zassert_equal(len, sizeof(plan_encoded), "Wrong length");
+
+		ret = json_plan_encode_buf(&plan, &plan_ts, buffer,
+					   sizeof(buffer));
+		zassert_equal(ret, 0, "Object not encoded");
+	}
+
+	cycles_plan = k_cycle_get_32() - start;
+
+	printk("%d objects of %d bytes sized and encoded: %u cycles per "
+	       "object with json_obj_encode_buf(), %u cycles per object "
+	       "with json_plan_encode_buf()\n", BENCHMARK_ENCODINGS,
+	       (int)sizeof(plan_encoded) - 1,
+	       cycles_descr / BENCHMARK_ENCODINGS,
+	       cycles_plan / BENCHMARK_ENCODINGS);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(lib_json_test,
@@ -468,7 +1016,17 @@ void test_main(void)
 			 ztest_unit_test(test_json_escape_one),
 			 ztest_unit_test(test_json_escape_empty),
 			 ztest_unit_test(test_json_escape_no_op),
-			 ztest_unit_test(test_json_escape_bounds_check)
+			 ztest_unit_test(test_json_escape_bounds_check),
+			 ztest_unit_test(test_json_stream_decoding),
+			 ztest_unit_test(test_json_stream_obj_arr_decoding),
+			 ztest_unit_test(test_json_stream_errors),
+			 ztest_unit_test(test_json_tokenizer),
+			 ztest_unit_test(test_json_stream_benchmark),
+			 ztest_unit_test(test_json_plan_encoding),
+			 ztest_unit_test(test_json_plan_obj_arr_encoding),
+			 ztest_unit_test(test_json_plan_compile_errors),
+			 ztest_unit_test(test_json_plan_pkt_encoding),
+			 ztest_unit_test(test_json_plan_benchmark)
 			 );
 
 	ztest_run_test_suite(lib_json_test);
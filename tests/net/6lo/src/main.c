@@ -864,6 +864,132 @@ end:
 	return result;
 }
 
+/* Received frames have no room in front of the compressed header, so
+ * the uncompressed one has to go to a fragment of its own.
+ */
+static void drop_headroom(struct net_buf *frag)
+{
+	u16_t headroom = net_buf_headroom(frag);
+	u16_t len = frag->len;
+	u8_t *data = frag->data;
+
+	net_buf_push(frag, headroom);
+	memmove(frag->data, data, len);
+	frag->len = len;
+}
+
+static int test_6lo_no_headroom(struct net_6lo_data *data)
+{
+	struct net_pkt *pkt;
+	int result = TC_FAIL;
+
+	pkt = create_pkt(data);
+	if (!pkt) {
+		TC_PRINT("%s: failed to create buffer\n", __func__);
+		return TC_FAIL;
+	}
+
+	if (!net_6lo_compress(pkt, data->iphc, NULL)) {
+		TC_PRINT("compression failed\n");
+		goto end;
+	}
+
+	drop_headroom(pkt->frags);
+
+	if (!net_6lo_uncompress(pkt)) {
+		TC_PRINT("uncompression failed\n");
+		goto end;
+	}
+
+	if (compare_data(pkt, data)) {
+		result = TC_PASS;
+	}
+
+end:
+	net_pkt_unref(pkt);
+	return result;
+}
+
+#define BENCH_ROUNDS 100
+
+static int bench_6lo(const char *name, struct net_6lo_data *data)
+{
+	u32_t compress = 0, in_place = 0, copy = 0;
+	struct net_pkt *pkt;
+	u32_t start;
+	int i;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		pkt = create_pkt(data);
+		if (!pkt) {
+			return TC_FAIL;
+		}
+
+		start = k_cycle_get_32();
+		if (!net_6lo_compress(pkt, data->iphc, NULL)) {
+			net_pkt_unref(pkt);
+			return TC_FAIL;
+		}
+		compress += k_cycle_get_32() - start;
+
+		/* Every other round the frame is uncompressed as if it was
+		 * received from a radio.
+		 */
+		if (i & 1) {
+			drop_headroom(pkt->frags);
+		}
+
+		start = k_cycle_get_32();
+		if (!net_6lo_uncompress(pkt)) {
+			net_pkt_unref(pkt);
+			return TC_FAIL;
+		}
+
+		if (i & 1) {
+			copy += k_cycle_get_32() - start;
+		} else {
+			in_place += k_cycle_get_32() - start;
+		}
+
+		if (!compare_data(pkt, data)) {
+			net_pkt_unref(pkt);
+			return TC_FAIL;
+		}
+
+		net_pkt_unref(pkt);
+	}
+
+	TC_PRINT("%s: compress %u, uncompress in place %u, "
+		 "with copy %u cycles per packet\n", name,
+		 compress / BENCH_ROUNDS, in_place / (BENCH_ROUNDS / 2),
+		 copy / (BENCH_ROUNDS / 2));
+
+	return TC_PASS;
+}
+
+static int test_6lo_bench(void)
+{
+	if (bench_6lo("sam00_dam00", &test_data_1) ||
+	    bench_6lo("sam10_dam10", &test_data_3) ||
+	    bench_6lo("sam11_dam11", &test_data_13) ||
+	    bench_6lo("ipv6_dispatch_big", &test_data_10)) {
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_6lo_no_headroom_all(void)
+{
+	if (test_6lo_no_headroom(&test_data_1) ||
+	    test_6lo_no_headroom(&test_data_7) ||
+	    test_6lo_no_headroom(&test_data_13)) {
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
 /* tests names are based on traffic class, flow label, source address mode
  * (sam), destination address mode (dam), based on udp source and destination
  * ports compressible type.
@@ -899,6 +1025,15 @@ static const struct {
 #endif
 };
 
+/* Tests that are not run on a single test data */
+static const struct {
+	const char *name;
+	int (*func)(void);
+} func_tests[] = {
+	{ "test_6lo_no_headroom", test_6lo_no_headroom_all },
+	{ "test_6lo_bench", test_6lo_bench },
+};
+
 void main(void)
 {
 	int count, pass;
@@ -921,7 +1056,19 @@ void main(void)
 		}
 	}
 
+	for (count = 0; count < ARRAY_SIZE(func_tests); count++) {
+		TC_START(func_tests[count].name);
+
+		if (func_tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
 	net_pkt_print();
 
-	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests) + ARRAY_SIZE(func_tests)) ?
+		       TC_FAIL : TC_PASS));
 }
@@ -0,0 +1,232 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+
+#include <ztest.h>
+
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/net_l2.h>
+#include <net/net_capture.h>
+
+#include "net_private.h"
+
+#define LL_RESERVE 14
+
+/* Offsets in an Enhanced Packet Block */
+#define EPB_TYPE 0
+#define EPB_CAPLEN 20
+#define EPB_ORIGLEN 24
+#define EPB_DATA 28
+
+#define PCAPNG_EPB 6
+
+#define MAX_EPBS 4
+
+/* The console output is scanned for the "pcapng:" lines, the packet
+ * blocks being decoded to be checked.
+ */
+static int (*orig_printk_hook)(int);
+static char line[2 * (EPB_DATA + CONFIG_NET_CAPTURE_SNAPLEN + 16) + 16];
+static int line_len;
+
+static u8_t epbs[MAX_EPBS][EPB_DATA + CONFIG_NET_CAPTURE_SNAPLEN + 16];
+static int epb_count;
+
+extern void __printk_hook_install(int (*fn)(int));
+extern void *__printk_get_hook(void);
+
+static u8_t hex_nibble(char c)
+{
+	return c <= '9' ? c - '0' : c - 'a' + 10;
+}
+
+static void decode_line(void)
+{
+	static const char prefix[] = "pcapng:";
+	char *hex = line + sizeof(prefix) - 1;
+	int len = (line_len - (sizeof(prefix) - 1)) / 2;
+	int i;
+
+	if (line_len < sizeof(prefix) - 1 ||
+	    memcmp(line, prefix, sizeof(prefix) - 1) ||
+	    len > sizeof(epbs[0]) || epb_count == MAX_EPBS) {
+		return;
+	}
+
+	for (i = 0; i < len; i++) {
+		epbs[epb_count][i] = hex_nibble(hex[2 * i]) << 4 |
+			hex_nibble(hex[2 * i + 1]);
+	}
+
+	if (sys_get_le32(&epbs[epb_count][EPB_TYPE]) == PCAPNG_EPB) {
+		epb_count++;
+	}
+}
+
+static int capture_printk_hook(int c)
+{
+	if (c == '\n') {
+		decode_line();
+		line_len = 0;
+	} else if (line_len < sizeof(line)) {
+		line[line_len++] = c;
+	}
+
+	return orig_printk_hook(c);
+}
+
+static int dummy_send(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+	return 0;
+}
+
+static void dummy_iface_init(struct net_if *iface)
+{
+	static u8_t mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_ETHERNET);
+}
+
+static int dummy_init(struct device *dev)
+{
+	return 0;
+}
+
+static struct net_if_api dummy_api = {
+	.init = dummy_iface_init,
+	.send = dummy_send,
+};
+
+NET_DEVICE_INIT(net_capture_test, "net_capture_test", dummy_init, NULL,
+		NULL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &dummy_api,
+		DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static inline u8_t pattern(int offset, u8_t seed)
+{
+	return offset ^ seed;
+}
+
+/* Builds a packet whose link layer header is in the reserve of the
+ * first fragment, followed by fragments of the given lengths.
+ */
+static struct net_pkt *build_pkt(const u16_t *lens, int count, u8_t seed)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	int i, j, offset;
+	u8_t *data;
+
+	pkt = net_pkt_get_reserve_tx(LL_RESERVE, K_FOREVER);
+	zassert_not_null(pkt, "No TX packet");
+
+	for (i = 0; i < count; i++) {
+		frag = net_pkt_get_frag(pkt, K_FOREVER);
+		zassert_not_null(frag, "No fragment");
+		zassert_true(net_buf_tailroom(frag) >= lens[i],
+			     "Fragment too small");
+		net_pkt_frag_add(pkt, frag);
+	}
+
+	data = net_pkt_ll(pkt);
+	for (offset = 0; offset < LL_RESERVE; offset++) {
+		data[offset] = pattern(offset, seed);
+	}
+
+	for (i = 0, frag = pkt->frags; i < count; i++, frag = frag->frags) {
+		data = net_buf_add(frag, lens[i]);
+
+		for (j = 0; j < lens[i]; j++) {
+			data[j] = pattern(offset++, seed);
+		}
+	}
+
+	return pkt;
+}
+
+static void check_epb(int index, u16_t caplen, u16_t origlen, u8_t seed)
+{
+	u8_t *epb = epbs[index];
+	int i;
+
+	zassert_equal(sys_get_le32(&epb[EPB_CAPLEN]), caplen,
+		      "Wrong captured length");
+	zassert_equal(sys_get_le32(&epb[EPB_ORIGLEN]), origlen,
+		      "Wrong original length");
+
+	for (i = 0; i < caplen; i++) {
+		zassert_equal(epb[EPB_DATA + i], pattern(i, seed),
+			      "Wrong captured data");
+	}
+
+	/* The block is padded with zeros */
+	for (; i < ROUND_UP(caplen, 4); i++) {
+		zassert_equal(epb[EPB_DATA + i], 0, "Wrong padding");
+	}
+}
+
+static void capture(const u16_t *lens, int count, u8_t seed)
+{
+	struct net_pkt *pkt;
+
+	pkt = build_pkt(lens, count, seed);
+	net_capture_pkt(net_if_get_default(), pkt, true);
+	net_pkt_unref(pkt);
+}
+
+static void test_capture_fragments(void)
+{
+	/* Snap length cutting through the middle fragment */
+	static const u16_t lens1[] = { 114, 128, 40 };
+	/* Snap length longer than the packet */
+	static const u16_t lens2[] = { 50, 100 };
+	/* Snap length cutting through the second of equal fragments */
+	static const u16_t lens3[] = { 100, 100, 100 };
+	struct net_capture_stats stats;
+
+	orig_printk_hook = __printk_get_hook();
+	__printk_hook_install(capture_printk_hook);
+
+	zassert_equal(net_capture_start(NULL, 200), 0, "Cannot start");
+	capture(lens1, ARRAY_SIZE(lens1), 0x11);
+	capture(lens2, ARRAY_SIZE(lens2), 0x22);
+	zassert_equal(net_capture_stop(), 0, "Cannot stop");
+
+	zassert_equal(net_capture_start(NULL, 150), 0, "Cannot start");
+	capture(lens3, ARRAY_SIZE(lens3), 0x33);
+	zassert_equal(net_capture_stop(), 0, "Cannot stop");
+
+	net_capture_get_stats(&stats);
+	zassert_equal(stats.captured, 1, "Wrong captured count");
+	zassert_equal(stats.dropped, 0, "Packets dropped");
+
+	/* Let the capture thread write the blocks */
+	k_sleep(K_MSEC(200));
+
+	__printk_hook_install(orig_printk_hook);
+
+	zassert_equal(epb_count, 3, "Wrong number of packet blocks");
+
+	check_epb(0, 200, LL_RESERVE + 114 + 128 + 40, 0x11);
+	check_epb(1, LL_RESERVE + 50 + 100, LL_RESERVE + 50 + 100, 0x22);
+	check_epb(2, 150, LL_RESERVE + 100 + 100 + 100, 0x33);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_capture_test,
+			 ztest_unit_test(test_capture_fragments));
+
+	ztest_run_test_suite(net_capture_test);
+}
@@ -58,10 +58,12 @@ static bool recv_cb_timeout_called;
 static int test_token, timeout_token;
 
 static struct k_sem wait_data;
+static struct k_sem wait_release;
 
 #define WAIT_TIME 250
 #define WAIT_TIME_LONG MSEC_PER_SEC
 #define SENDING 93244
+#define SENDING_IOV 93245
 #define MY_PORT 1969
 #define PEER_PORT 16233
 
@@ -628,6 +630,65 @@ static bool net_ctx_sendto_v4(void)
 	return true;
 }
 
+static const char iov_hdr[] = "Zero copy ";
+static int iov_released;
+
+static void iov_release_cb(const void *data, u16_t len, void *user_data)
+{
+	if (POINTER_TO_INT(user_data) != AF_INET6) {
+		TC_ERROR("Release user data mismatch\n");
+		cb_failure = true;
+	}
+
+	iov_released++;
+
+	k_sem_give(&wait_release);
+}
+
+static bool net_ctx_sendv_v6(void)
+{
+	struct net_iovec iov[] = {
+		{ .base = iov_hdr, .len = sizeof(iov_hdr) - 1 },
+		{ .base = test_data, .len = strlen(test_data) },
+	};
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(PEER_PORT),
+		.sin6_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				   0, 0, 0, 0, 0, 0, 0, 0x2 } } },
+	};
+	int ret, i;
+
+	iov_released = 0;
+	test_token = SENDING_IOV;
+
+	ret = net_context_sendv(udp_v6_ctx, iov, ARRAY_SIZE(iov),
+				iov_release_cb, (struct sockaddr *)&addr,
+				sizeof(struct sockaddr_in6), send_cb, 0,
+				INT_TO_POINTER(test_token),
+				INT_TO_POINTER(AF_INET6));
+	if (ret) {
+		TC_ERROR("Context sendv IPv6 UDP test failed (%d)\n", ret);
+		return false;
+	}
+
+	/* The buffers are given back once the driver has freed the packet */
+	for (i = 0; i < ARRAY_SIZE(iov); i++) {
+		if (k_sem_take(&wait_release, WAIT_TIME)) {
+			TC_ERROR("Timeout while waiting buffer release\n");
+			return false;
+		}
+	}
+
+	if (iov_released != ARRAY_SIZE(iov) || cb_failure) {
+		TC_ERROR("Buffers released %d times, expected %d\n",
+			 iov_released, (int)ARRAY_SIZE(iov));
+		return false;
+	}
+
+	return true;
+}
+
 static void recv_cb(struct net_context *context,
 		    struct net_pkt *pkt,
 		    int status,
@@ -1124,6 +1185,17 @@ static int tester_send(struct net_if *iface, struct net_pkt *pkt)
 		return 0;
 	}
 
+	if (test_token == SENDING_IOV) {
+		/* The payload must still be the caller's own memory */
+		struct net_buf *last = net_buf_frag_last(pkt->frags);
+
+		if (last->data != (u8_t *)test_data ||
+		    last->len != strlen(test_data)) {
+			TC_ERROR("Payload was copied\n");
+			test_failed = true;
+		}
+	}
+
 out:
 	net_pkt_unref(pkt);
 
@@ -1188,6 +1260,7 @@ static bool test_init(void)
 
 	/* The semaphore is there to wait the data to be received. */
 	k_sem_init(&wait_data, 0, UINT_MAX);
+	k_sem_init(&wait_release, 0, UINT_MAX);
 
 	return true;
 }
@@ -1215,6 +1288,7 @@ static const struct {
 	{ "net_context_send IPv4", net_ctx_send_v4 },
 	{ "net_context_sendto IPv6", net_ctx_sendto_v6 },
 	{ "net_context_sendto IPv4", net_ctx_sendto_v4 },
+	{ "net_context_sendv IPv6", net_ctx_sendv_v6 },
 	{ "net_context_recv IPv6", net_ctx_recv_v6 },
 	{ "net_context_recv IPv4", net_ctx_recv_v4 },
 	{ "net_context_recv IPv6 fail", net_ctx_recv_v6_fail },
@@ -0,0 +1,555 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <misc/printk.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/ieee802154_radio.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+
+#include "6lo.h"
+#include "6lo_private.h"
+#include "ieee802154_frame.h"
+#include "ieee802154_fragment.h"
+#include "ipv6.h"
+#include "route.h"
+#include "udp.h"
+
+#define PAYLOAD_LEN 300
+#define DATAGRAM_LEN (NET_IPV6UDPH_LEN + PAYLOAD_LEN)
+#define SRC_PORT 0x4000
+#define DST_PORT 0x4001
+#define MAX_FRAMES 16
+#define WAIT_TIME 250
+
+/* Link addresses in big endian, as the IPv6 stack uses them */
+static u8_t prev_mac[] = { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static u8_t my_mac[] = { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static u8_t next_mac[] = { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x03 };
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+static struct in6_addr origin_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					   0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr routed_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0,
+					   0, 0, 0, 0, 0, 0, 0, 0x5 } } };
+static struct in6_addr route_prefix = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0,
+					    0, 0, 0, 0, 0, 0, 0, 0 } } };
+static struct in6_addr next_hop = { { { 0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+					0x02, 0x12, 0x4b, 0x00,
+					0x00, 0x00, 0x00, 0x03 } } };
+
+/* The uncompressed datagram the fragments are made of */
+static u8_t datagram[DATAGRAM_LEN];
+
+struct frame {
+	u8_t data[IEEE802154_MTU];
+	u8_t len;
+	u32_t cycles;
+};
+
+/* Frames the fake radio was asked to send */
+static struct frame frames[MAX_FRAMES];
+static int frame_count;
+static struct k_sem wait_tx;
+
+static struct k_sem wait_udp;
+static size_t udp_len;
+
+static struct net_if *iface;
+static u8_t sequence;
+
+static int fake_cca(struct device *dev)
+{
+	return 0;
+}
+
+static int fake_set_channel(struct device *dev, u16_t channel)
+{
+	return 0;
+}
+
+static int fake_set_pan_id(struct device *dev, u16_t pan_id)
+{
+	return 0;
+}
+
+static int fake_set_short_addr(struct device *dev, u16_t short_addr)
+{
+	return 0;
+}
+
+static int fake_set_ieee_addr(struct device *dev, const u8_t *ieee_addr)
+{
+	return 0;
+}
+
+static int fake_set_txpower(struct device *dev, s16_t dbm)
+{
+	return 0;
+}
+
+static int fake_tx(struct device *dev, struct net_pkt *pkt,
+		   struct net_buf *frag)
+{
+	u8_t len = net_pkt_ll_reserve(pkt) + frag->len;
+
+	if (frame_count < MAX_FRAMES && len <= IEEE802154_MTU) {
+		frames[frame_count].cycles = k_cycle_get_32();
+		frames[frame_count].len = len;
+		memcpy(frames[frame_count].data,
+		       frag->data - net_pkt_ll_reserve(pkt), len);
+		frame_count++;
+	}
+
+	k_sem_give(&wait_tx);
+
+	return 0;
+}
+
+static int fake_start(struct device *dev)
+{
+	return 0;
+}
+
+static int fake_stop(struct device *dev)
+{
+	return 0;
+}
+
+static void fake_iface_init(struct net_if *iface)
+{
+	struct ieee802154_context *ctx = net_if_l2_data(iface);
+
+	net_if_set_link_addr(iface, my_mac, sizeof(my_mac),
+			     NET_LINK_IEEE802154);
+
+	ctx->pan_id = 0xabcd;
+	ctx->channel = 26;
+
+	ieee802154_init(iface);
+}
+
+static int fake_init(struct device *dev)
+{
+	return 0;
+}
+
+static struct ieee802154_radio_api fake_radio_api = {
+	.iface_api.init	= fake_iface_init,
+	.iface_api.send	= ieee802154_radio_send,
+
+	.cca		= fake_cca,
+	.set_channel	= fake_set_channel,
+	.set_pan_id	= fake_set_pan_id,
+	.set_short_addr	= fake_set_short_addr,
+	.set_ieee_addr	= fake_set_ieee_addr,
+	.set_txpower	= fake_set_txpower,
+	.start		= fake_start,
+	.stop		= fake_stop,
+	.tx		= fake_tx,
+};
+
+NET_DEVICE_INIT(fake_fwd, "fake_ieee802154_fwd",
+		fake_init, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&fake_radio_api, IEEE802154_L2,
+		NET_L2_GET_CTX_TYPE(IEEE802154_L2), 125);
+
+static enum net_verdict udp_received(struct net_conn *conn,
+				     struct net_pkt *pkt,
+				     void *user_data)
+{
+	udp_len = net_pkt_get_len(pkt);
+
+	net_pkt_unref(pkt);
+
+	k_sem_give(&wait_udp);
+
+	return NET_OK;
+}
+
+static bool wait_frames(int count)
+{
+	while (frame_count < count) {
+		if (k_sem_take(&wait_tx, WAIT_TIME)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void setup_datagram(struct in6_addr *dst)
+{
+	struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)datagram;
+	struct net_udp_hdr *udp =
+		(struct net_udp_hdr *)(datagram + NET_IPV6H_LEN);
+	int i;
+
+	memset(datagram, 0, NET_IPV6UDPH_LEN);
+
+	hdr->vtc = 0x60;
+	hdr->len[0] = (DATAGRAM_LEN - NET_IPV6H_LEN) >> 8;
+	hdr->len[1] = (u8_t)(DATAGRAM_LEN - NET_IPV6H_LEN);
+	hdr->nexthdr = IPPROTO_UDP;
+	hdr->hop_limit = 64;
+	net_ipaddr_copy(&hdr->src, &origin_addr);
+	net_ipaddr_copy(&hdr->dst, dst);
+
+	udp->src_port = htons(SRC_PORT);
+	udp->dst_port = htons(DST_PORT);
+	udp->len = htons(DATAGRAM_LEN - NET_IPV6H_LEN);
+
+	for (i = NET_IPV6UDPH_LEN; i < DATAGRAM_LEN; i++) {
+		datagram[i] = i;
+	}
+}
+
+static u8_t mhr_len(bool short_addr)
+{
+	/* Frame control, sequence, PAN id and both addresses */
+	return short_addr ? 9 : 21;
+}
+
+/* The datagram as the previous hop would have sent it */
+static struct net_pkt *create_fragments(bool short_addr)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u16_t pos = 0;
+	u16_t chksum;
+
+	pkt = net_pkt_get_reserve_tx(mhr_len(short_addr), K_FOREVER);
+	zassert_not_null(pkt, "No TX packet");
+
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_family(pkt, AF_INET6);
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV6H_LEN);
+
+	net_pkt_ll_src(pkt)->addr = prev_mac;
+	net_pkt_ll_src(pkt)->len = sizeof(prev_mac);
+	net_pkt_ll_dst(pkt)->addr = my_mac;
+	net_pkt_ll_dst(pkt)->len = sizeof(my_mac);
+
+	while (pos < DATAGRAM_LEN) {
+		u16_t len;
+
+		frag = net_pkt_get_frag(pkt, K_FOREVER);
+		len = min(net_buf_tailroom(frag), DATAGRAM_LEN - pos);
+
+		memcpy(net_buf_add(frag, len), datagram + pos, len);
+		net_pkt_frag_add(pkt, frag);
+
+		pos += len;
+	}
+
+	chksum = ~net_calc_chksum_udp(pkt);
+	NET_UDP_HDR(pkt)->chksum = chksum;
+	memcpy(datagram + NET_IPV6H_LEN + 6, &chksum, sizeof(chksum));
+
+	zassert_true(net_6lo_compress(pkt, true, ieee802154_fragment),
+		     "Compression failed");
+
+	return pkt;
+}
+
+static void recv_fragment(struct net_buf *frag, bool short_addr)
+{
+	struct net_pkt *pkt;
+	struct net_buf *buf;
+	u8_t *mhr;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+	zassert_not_null(pkt, "No RX packet");
+
+	net_pkt_set_ll_reserve(pkt, 0);
+
+	buf = net_pkt_get_frag(pkt, K_FOREVER);
+	net_pkt_frag_add(pkt, buf);
+
+	mhr = net_buf_add(buf, mhr_len(short_addr));
+
+	/* Data frame, PAN id compression */
+	mhr[0] = 0x41;
+	mhr[2] = sequence++;
+	mhr[3] = 0xcd;
+	mhr[4] = 0xab;
+
+	if (short_addr) {
+		mhr[1] = 0x88;
+		sys_put_le16(0x0002, &mhr[5]);
+		sys_put_le16(0x0001, &mhr[7]);
+	} else {
+		mhr[1] = 0xcc;
+		sys_memcpy_swap(&mhr[5], my_mac, sizeof(my_mac));
+		sys_memcpy_swap(&mhr[13], prev_mac, sizeof(prev_mac));
+	}
+
+	memcpy(net_buf_add(buf, frag->len), frag->data, frag->len);
+
+	zassert_equal(net_recv_data(iface, pkt), 0, "Cannot receive");
+}
+
+/* Uncompress a forwarded first fragment and check it against the
+ * datagram, returns the number of datagram bytes it carried.
+ */
+static u16_t check_frag1(u8_t *data, u8_t len)
+{
+	u8_t buf[NET_IPV6UDPH_LEN + IEEE802154_MTU];
+	struct net_pkt_cursor cursor;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u16_t pkt_len;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+	frag = net_pkt_get_frag(pkt, K_FOREVER);
+	memcpy(net_buf_add(frag, len), data, len);
+	net_pkt_frag_add(pkt, frag);
+
+	net_pkt_ll_src(pkt)->addr = my_mac;
+	net_pkt_ll_src(pkt)->len = sizeof(my_mac);
+	net_pkt_ll_dst(pkt)->addr = next_mac;
+	net_pkt_ll_dst(pkt)->len = sizeof(next_mac);
+
+	zassert_true(net_6lo_uncompress(pkt), "Cannot uncompress");
+
+	pkt_len = net_pkt_get_len(pkt);
+	zassert_true(pkt_len > NET_IPV6UDPH_LEN && pkt_len <= sizeof(buf),
+		     "Wrong first fragment length");
+
+	net_pkt_cursor_init(&cursor, pkt);
+	zassert_equal(net_pkt_cursor_read(&cursor, buf, pkt_len), 0,
+		      "Cannot read first fragment");
+
+	net_pkt_unref(pkt);
+
+	zassert_equal(((struct net_ipv6_hdr *)buf)->hop_limit, 63,
+		      "Hop limit not decremented");
+	zassert_true(!memcmp(buf + 6, datagram + 6, 1 + 32),
+		     "IPv6 header mismatch");
+	zassert_true(!memcmp(buf + NET_IPV6H_LEN, datagram + NET_IPV6H_LEN,
+			     4), "UDP ports mismatch");
+	zassert_true(!memcmp(buf + NET_IPV6H_LEN + 6,
+			     datagram + NET_IPV6H_LEN + 6, 2),
+		     "UDP checksum mismatch");
+	zassert_true(!memcmp(buf + NET_IPV6UDPH_LEN,
+			     datagram + NET_IPV6UDPH_LEN,
+			     pkt_len - NET_IPV6UDPH_LEN), "Payload mismatch");
+
+	return pkt_len;
+}
+
+/* Check that the frames sent to the next hop carry the whole datagram */
+static void check_forwarded(u16_t in_tag)
+{
+	struct ieee802154_mpdu mpdu;
+	u16_t total = 0;
+	u16_t out_tag = 0;
+	int i;
+
+	for (i = 0; i < frame_count; i++) {
+		u8_t *payload;
+		u8_t len;
+		u16_t tag;
+
+		zassert_true(ieee802154_validate_frame(frames[i].data,
+						       frames[i].len, &mpdu),
+			     "Invalid frame");
+		zassert_equal(mpdu.mhr.fs->fc.dst_addr_mode,
+			      IEEE802154_ADDR_MODE_EXTENDED,
+			      "Not sent to an extended address");
+		zassert_equal(mpdu.mhr.dst_addr->plain.addr.ext_addr[0],
+			      next_mac[7], "Not sent to next hop");
+
+		payload = mpdu.payload;
+		len = frames[i].len - (payload - frames[i].data);
+
+		zassert_equal(((payload[0] & 0x07) << 8) | payload[1],
+			      DATAGRAM_LEN, "Wrong datagram size");
+
+		tag = (payload[2] << 8) | payload[3];
+		if (!i) {
+			out_tag = tag;
+		}
+
+		zassert_equal(tag, out_tag, "Tag changed");
+		zassert_not_equal(tag, in_tag, "Tag of previous hop used");
+
+		if ((payload[0] & 0xf8) == NET_6LO_DISPATCH_FRAG1) {
+			zassert_equal(i, 0, "First fragment not first");
+
+			total += check_frag1(payload + NET_6LO_FRAG1_HDR_LEN,
+					     len - NET_6LO_FRAG1_HDR_LEN);
+		} else {
+			u16_t offset = payload[4] << 3;
+
+			zassert_equal(payload[0] & 0xf8,
+				      NET_6LO_DISPATCH_FRAGN, "Not a fragment");
+
+			len -= NET_6LO_FRAGN_HDR_LEN;
+
+			zassert_true(offset + len <= DATAGRAM_LEN,
+				     "Fragment past datagram");
+			zassert_true(!memcmp(payload + NET_6LO_FRAGN_HDR_LEN,
+					     datagram + offset, len),
+				     "Fragment data mismatch");
+
+			total += len;
+		}
+	}
+
+	zassert_equal(total, DATAGRAM_LEN, "Datagram not complete");
+}
+
+static void forward_datagram(bool short_addr)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u32_t start, first;
+	u16_t in_tag;
+	int count = 0;
+	int before;
+
+	frame_count = 0;
+	k_sem_reset(&wait_tx);
+
+	setup_datagram(&routed_addr);
+	pkt = create_fragments(short_addr);
+
+	in_tag = (pkt->frags->data[2] << 8) | pkt->frags->data[3];
+
+	for (frag = pkt->frags; frag; frag = frag->frags, count++) {
+		before = frame_count;
+
+		start = k_cycle_get_32();
+		recv_fragment(frag, short_addr);
+
+		/* Every fragment is sent on before the next one arrives,
+		 * there is no waiting for the whole datagram.
+		 */
+		zassert_true(wait_frames(before + 1), "Fragment not forwarded");
+
+		first = frames[before].cycles - start;
+		printk("Fragment %d forwarded in %u cycles\n", count, first);
+	}
+
+	net_pkt_unref(pkt);
+
+	/* Give time for fragments that had to be split */
+	k_sleep(50);
+
+	printk("%d fragments forwarded as %d frames\n", count, frame_count);
+
+	check_forwarded(in_tag);
+}
+
+static void setup(void)
+{
+	struct net_linkaddr lladdr;
+	struct device *dev;
+
+	k_sem_init(&wait_tx, 0, UINT_MAX);
+	k_sem_init(&wait_udp, 0, UINT_MAX);
+
+	dev = device_get_binding("fake_ieee802154_fwd");
+	zassert_not_null(dev, "No fake device");
+
+	iface = net_if_lookup_by_dev(dev);
+	zassert_not_null(iface, "No fake interface");
+
+	zassert_not_null(net_if_ipv6_addr_add(iface, &my_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+
+	lladdr.addr = next_mac;
+	lladdr.len = sizeof(next_mac);
+	lladdr.type = NET_LINK_IEEE802154;
+
+	zassert_not_null(net_ipv6_nbr_add(iface, &next_hop, &lladdr, false,
+					  NET_IPV6_NBR_STATE_REACHABLE),
+			 "Cannot add next hop");
+
+	zassert_not_null(net_route_add(iface, &route_prefix, 64, &next_hop),
+			 "Cannot add route");
+}
+
+static void forward(void)
+{
+	forward_datagram(false);
+}
+
+static void forward_split(void)
+{
+	/* With short addresses the previous hop fits more data in a
+	 * frame than we can towards an extended address, and the hop
+	 * limit does not compress anymore once decremented, so the
+	 * fragments have to be split.
+	 */
+	forward_datagram(true);
+}
+
+static void forward_labels_released(void)
+{
+	/* All the labels were used by now */
+	forward_datagram(false);
+}
+
+static void local_reassembly(void)
+{
+	static struct net_conn_handle *handle;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	zassert_equal(net_udp_register(NULL, NULL, SRC_PORT, DST_PORT,
+				       udp_received, NULL, &handle), 0,
+		      "Cannot register UDP handler");
+
+	frame_count = 0;
+	k_sem_reset(&wait_tx);
+
+	setup_datagram(&my_addr);
+	pkt = create_fragments(false);
+
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		recv_fragment(frag, false);
+	}
+
+	net_pkt_unref(pkt);
+
+	zassert_equal(k_sem_take(&wait_udp, WAIT_TIME), 0,
+		      "Datagram not received");
+	zassert_equal(udp_len, DATAGRAM_LEN, "Wrong datagram length");
+	zassert_equal(frame_count, 0, "Local datagram forwarded");
+
+	net_udp_unregister(handle);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(ieee802154_fragment_forward,
+			 ztest_unit_test(setup),
+			 ztest_unit_test(forward),
+			 ztest_unit_test(forward_split),
+			 ztest_unit_test(forward_labels_released),
+			 ztest_unit_test(local_reassembly)
+		);
+
+	ztest_run_test_suite(ieee802154_fragment_forward);
+}
@@ -681,11 +681,253 @@ static void send_ipv6_fragment(void)
 	}
 }
 
+#define RECV_PAYLOAD_LEN 1200
+#define RECV_FRAG_LEN 248
+#define RECV_FRAG_COUNT ((8 + RECV_PAYLOAD_LEN + RECV_FRAG_LEN - 1) / \
+			 RECV_FRAG_LEN)
+#define RECV_LOCAL_PORT 6000
+#define RECV_REMOTE_PORT 5000
+
+/* UDP header and payload of the datagram that is sent in fragments */
+static u8_t recv_datagram[8 + RECV_PAYLOAD_LEN];
+static struct k_sem wait_recv;
+static int recv_count;
+static bool recv_ok;
+
+static enum net_verdict udp_frag_received(struct net_conn *conn,
+					  struct net_pkt *pkt,
+					  void *user_data)
+{
+	struct net_pkt_cursor cursor;
+	u8_t data[RECV_FRAG_LEN];
+	u16_t pos;
+
+	DBG("Reassembled data %p received\n", pkt);
+
+	recv_ok = net_pkt_get_len(pkt) ==
+		sizeof(struct net_ipv6_hdr) + sizeof(recv_datagram);
+
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (net_pkt_cursor_seek(&cursor, pkt, sizeof(struct net_ipv6_hdr))) {
+		recv_ok = false;
+	}
+
+	for (pos = 0; recv_ok && pos < sizeof(recv_datagram);
+	     pos += sizeof(data)) {
+		u16_t len = min(sizeof(data), sizeof(recv_datagram) - pos);
+
+		if (net_pkt_cursor_read(&cursor, data, len) ||
+		    memcmp(data, &recv_datagram[pos], len)) {
+			recv_ok = false;
+		}
+	}
+
+	recv_count++;
+
+	net_pkt_unref(pkt);
+
+	k_sem_give(&wait_recv);
+
+	return NET_OK;
+}
+
+static u16_t calc_udp_chksum(const struct in6_addr *src,
+			     const struct in6_addr *dst,
+			     const u8_t *data, u16_t len)
+{
+	u32_t sum = IPPROTO_UDP + len;
+	int i;
+
+	for (i = 0; i < sizeof(struct in6_addr); i += 2) {
+		sum += (src->s6_addr[i] << 8) + src->s6_addr[i + 1];
+		sum += (dst->s6_addr[i] << 8) + dst->s6_addr[i + 1];
+	}
+
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += (data[i] << 8) + data[i + 1];
+	}
+
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	sum = ~sum & 0xffff;
+
+	return sum ? sum : 0xffff;
+}
+
+static void recv_setup(void)
+{
+	static struct net_conn_handle *handle;
+	struct sockaddr remote_addr = { 0 };
+	struct sockaddr local_addr = { 0 };
+	u16_t chksum;
+	int i, ret;
+
+	k_sem_init(&wait_recv, 0, UINT_MAX);
+
+	recv_datagram[0] = RECV_REMOTE_PORT >> 8;
+	recv_datagram[1] = RECV_REMOTE_PORT & 0xff;
+	recv_datagram[2] = RECV_LOCAL_PORT >> 8;
+	recv_datagram[3] = RECV_LOCAL_PORT & 0xff;
+	recv_datagram[4] = sizeof(recv_datagram) >> 8;
+	recv_datagram[5] = sizeof(recv_datagram) & 0xff;
+
+	for (i = 8; i < sizeof(recv_datagram); i++) {
+		recv_datagram[i] = i;
+	}
+
+	chksum = calc_udp_chksum(&my_addr2, &my_addr1, recv_datagram,
+				 sizeof(recv_datagram));
+	recv_datagram[6] = chksum >> 8;
+	recv_datagram[7] = chksum & 0xff;
+
+	net_ipaddr_copy(&net_sin6(&local_addr)->sin6_addr, &my_addr1);
+	local_addr.family = AF_INET6;
+
+	net_ipaddr_copy(&net_sin6(&remote_addr)->sin6_addr, &my_addr2);
+	remote_addr.family = AF_INET6;
+
+	ret = net_udp_register(&remote_addr, &local_addr, RECV_REMOTE_PORT,
+			       RECV_LOCAL_PORT, udp_frag_received,
+			       NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP handler");
+}
+
+/* Feed one fragment of the test datagram to iface1 as if it was
+ * received from the network.
+ */
+static void recv_fragment(u32_t id, u16_t offset, u16_t len)
+{
+	struct net_ipv6_frag_hdr frag_hdr;
+	struct net_ipv6_hdr hdr;
+	struct net_pkt *pkt;
+	bool more;
+
+	more = offset + len < sizeof(recv_datagram);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.vtc = 0x60;
+	hdr.len[0] = (sizeof(frag_hdr) + len) >> 8;
+	hdr.len[1] = (sizeof(frag_hdr) + len) & 0xff;
+	hdr.nexthdr = NET_IPV6_NEXTHDR_FRAG;
+	hdr.hop_limit = 64;
+	net_ipaddr_copy(&hdr.src, &my_addr2);
+	net_ipaddr_copy(&hdr.dst, &my_addr1);
+
+	frag_hdr.nexthdr = IPPROTO_UDP;
+	frag_hdr.reserved = 0;
+	frag_hdr.offset = htons(offset | more);
+	frag_hdr.id = htonl(id);
+
+	pkt = net_pkt_get_reserve_rx(0, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "No RX packet");
+
+	zassert_true(net_pkt_append_all(pkt, sizeof(hdr), (u8_t *)&hdr,
+					ALLOC_TIMEOUT), "Append failed");
+	zassert_true(net_pkt_append_all(pkt, sizeof(frag_hdr),
+					(u8_t *)&frag_hdr, ALLOC_TIMEOUT),
+		     "Append failed");
+	zassert_true(net_pkt_append_all(pkt, len, &recv_datagram[offset],
+					ALLOC_TIMEOUT), "Append failed");
+
+	zassert_equal(net_recv_data(iface1, pkt), 0, "Cannot receive");
+}
+
+static void recv_fragment_nth(u32_t id, int n)
+{
+	u16_t offset = n * RECV_FRAG_LEN;
+
+	recv_fragment(id, offset, min(RECV_FRAG_LEN,
+				      sizeof(recv_datagram) - offset));
+}
+
+static void frag_count_cb(struct net_ipv6_reassembly *reass,
+			  void *user_data)
+{
+	(*(int *)user_data)++;
+}
+
+static int pending_reassemblies(void)
+{
+	int count = 0;
+
+	/* Let the RX thread process what was fed to it */
+	k_sleep(50);
+
+	net_ipv6_frag_foreach(frag_count_cb, &count);
+
+	return count;
+}
+
 static void recv_ipv6_fragment(void)
 {
-	/* TODO: Verify that we can receive individual fragments and
-	 * then reassemble them back.
+	static const int order[] = { 3, 0, 4, 2, 1 };
+	int i;
+
+	recv_setup();
+
+	zassert_equal(ARRAY_SIZE(order), RECV_FRAG_COUNT, "Wrong order");
+
+	/* More fragments than there used to be room for in one
+	 * reassembly, and out of order.
 	 */
+	recv_count = 0;
+
+	for (i = 0; i < ARRAY_SIZE(order); i++) {
+		recv_fragment_nth(0x1234, order[i]);
+	}
+
+	zassert_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+		      "Reassembled packet not received");
+	zassert_true(recv_ok, "Reassembled packet corrupted");
+	zassert_equal(recv_count, 1, "Wrong number of packets");
+	zassert_equal(pending_reassemblies(), 0, "Reassembly pending");
+}
+
+static void recv_ipv6_fragment_concurrent(void)
+{
+	int i;
+
+	/* Two packets share the fragment entries */
+	recv_count = 0;
+
+	for (i = RECV_FRAG_COUNT - 1; i >= 0; i--) {
+		recv_fragment_nth(0x2000, i);
+		recv_fragment_nth(0x2001, RECV_FRAG_COUNT - 1 - i);
+	}
+
+	for (i = 0; i < 2; i++) {
+		zassert_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+			      "Reassembled packet not received");
+		zassert_true(recv_ok, "Reassembled packet corrupted");
+	}
+
+	zassert_equal(recv_count, 2, "Wrong number of packets");
+	zassert_equal(pending_reassemblies(), 0, "Reassembly pending");
+}
+
+static void recv_ipv6_fragment_overlap(void)
+{
+	recv_count = 0;
+
+	recv_fragment_nth(0x3000, 0);
+	zassert_equal(pending_reassemblies(), 1, "Reassembly not started");
+
+	/* The same fragment again is ignored */
+	recv_fragment_nth(0x3000, 0);
+	zassert_equal(pending_reassemblies(), 1, "Duplicate not ignored");
+
+	/* Overlapping data cancels the whole reassembly (RFC 5722) */
+	recv_fragment(0x3000, RECV_FRAG_LEN - 8, RECV_FRAG_LEN);
+	zassert_equal(pending_reassemblies(), 0, "Reassembly not cancelled");
+
+	zassert_equal(recv_count, 0, "Unexpected packet");
 }
 
 void test_main(void)
@@ -696,7 +938,9 @@ void test_main(void)
 			 ztest_unit_test(find_last_ipv6_fragment_hbho_udp),
 			 ztest_unit_test(find_last_ipv6_fragment_hbho_frag),
 			 ztest_unit_test(send_ipv6_fragment),
-			 ztest_unit_test(recv_ipv6_fragment)
+			 ztest_unit_test(recv_ipv6_fragment),
+			 ztest_unit_test(recv_ipv6_fragment_concurrent),
+			 ztest_unit_test(recv_ipv6_fragment_overlap)
 			 );
 
 	ztest_run_test_suite(net_ipv6_fragment_test);
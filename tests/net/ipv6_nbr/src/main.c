@@ -0,0 +1,362 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <linker/sections.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+#include "ipv6.h"
+#include "nbr.h"
+#include "net_stats.h"
+
+#define MAX_NBR CONFIG_NET_IPV6_MAX_NEIGHBORS
+#define BENCH_ROUNDS 16
+
+static struct net_if *iface;
+
+static struct net_nbr *nbrs[MAX_NBR];
+static struct in6_addr nbr_addr[MAX_NBR];
+static u8_t nbr_mac[MAX_NBR][sizeof(struct net_eth_addr)];
+
+struct net_ipv6_nbr_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_ipv6_nbr_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_ipv6_nbr_iface_init(struct net_if *iface)
+{
+	struct net_ipv6_nbr_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr,
+			     sizeof(struct net_eth_addr), NET_LINK_ETHERNET);
+}
+
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_ipv6_nbr_test net_ipv6_nbr_test_data;
+
+static struct net_if_api net_ipv6_nbr_if_api = {
+	.init = net_ipv6_nbr_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT(net_ipv6_nbr_test, "net_ipv6_nbr_test",
+		net_ipv6_nbr_dev_init, &net_ipv6_nbr_test_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_ipv6_nbr_if_api, DUMMY_L2,
+		NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+/* Local table for testing the link layer address hash */
+NET_NBR_POOL_INIT(test_lladdr_pool, 2, 0, NULL, 0);
+
+NET_NBR_TABLE_INIT(NET_NBR_LOCAL, test_lladdr, test_lladdr_pool, NULL);
+
+static struct net_nbr *add_nbr(int i, u16_t id,
+			       enum net_ipv6_nbr_state state)
+{
+	struct net_linkaddr lladdr;
+
+	net_ipv6_addr_create(&nbr_addr[i], 0xfe80, 0, 0, 0,
+			     0x0200, 0x5eff, 0xfe00, id);
+
+	nbr_mac[i][0] = 0x00;
+	nbr_mac[i][1] = 0x00;
+	nbr_mac[i][2] = 0x5E;
+	nbr_mac[i][3] = 0x00;
+	nbr_mac[i][4] = id >> 8;
+	nbr_mac[i][5] = id;
+
+	lladdr.addr = nbr_mac[i];
+	lladdr.len = sizeof(nbr_mac[i]);
+
+	nbrs[i] = net_ipv6_nbr_add(iface, &nbr_addr[i], &lladdr, false, state);
+
+	return nbrs[i];
+}
+
+static void test_setup(void)
+{
+	iface = net_if_get_default();
+	zassert_not_null(iface, "No interface");
+}
+
+static void test_lladdr_hash(void)
+{
+	u8_t mac1[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0xa1 };
+	u8_t mac2[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0xa2 };
+	struct net_linkaddr lladdr1 = { .addr = mac1, .len = sizeof(mac1) };
+	struct net_linkaddr lladdr2 = { .addr = mac2, .len = sizeof(mac2) };
+	struct net_linkaddr short_lladdr = { .addr = mac1, .len = 2 };
+	struct net_nbr *nbr1, *nbr2;
+
+	nbr1 = net_nbr_get(&net_test_lladdr.table);
+	nbr2 = net_nbr_get(&net_test_lladdr.table);
+	zassert_not_null(nbr1, "No neighbor");
+	zassert_not_null(nbr2, "No neighbor");
+	zassert_is_null(net_nbr_get(&net_test_lladdr.table),
+			"Table size not respected");
+
+	zassert_equal(net_nbr_link(nbr1, iface, &lladdr1), 0, "Link failed");
+	zassert_equal_ptr(net_nbr_lookup(&net_test_lladdr.table, iface,
+					 &lladdr1), nbr1, "Not found");
+	zassert_is_null(net_nbr_lookup(&net_test_lladdr.table, iface,
+				       &short_lladdr), "Length not checked");
+
+	/* The same address is shared */
+	zassert_equal(net_nbr_link(nbr2, iface, &lladdr1), 0, "Link failed");
+	zassert_equal(nbr1->idx, nbr2->idx, "Address not shared");
+
+	/* Changing the address is seen by both and the hash follows */
+	net_nbr_update_lladdr(nbr1->idx, mac2, sizeof(mac2));
+	zassert_is_null(net_nbr_lookup(&net_test_lladdr.table, iface,
+				       &lladdr1), "Old address found");
+	zassert_not_null(net_nbr_lookup(&net_test_lladdr.table, iface,
+					&lladdr2), "New address not found");
+
+	zassert_equal(net_nbr_unlink(nbr1, NULL), 0, "Unlink failed");
+	zassert_equal(net_nbr_unlink(nbr2, NULL), 0, "Unlink failed");
+	zassert_is_null(net_nbr_lookup(&net_test_lladdr.table, iface,
+				       &lladdr2), "Unlinked address found");
+
+	net_nbr_unref(nbr1);
+	net_nbr_unref(nbr2);
+}
+
+static void test_lookup(void)
+{
+	struct in6_addr addr;
+	int i;
+
+	for (i = 0; i < MAX_NBR; i++) {
+		zassert_not_null(add_nbr(i, 0x100 + i,
+					 NET_IPV6_NBR_STATE_REACHABLE),
+				 "Cannot add neighbor");
+	}
+
+	for (i = 0; i < MAX_NBR; i++) {
+		zassert_equal_ptr(net_ipv6_nbr_lookup(iface, &nbr_addr[i]),
+				  nbrs[i], "Wrong neighbor");
+		zassert_equal_ptr(net_ipv6_get_nbr(iface, nbrs[i]->idx),
+				  nbrs[i], "Wrong neighbor for lladdr");
+	}
+
+	/* Same interface identifier with another prefix lands in the same
+	 * bucket but must not match.
+	 */
+	net_ipaddr_copy(&addr, &nbr_addr[0]);
+	addr.s6_addr[0] = 0x20;
+	zassert_is_null(net_ipv6_nbr_lookup(iface, &addr), "Unexpected match");
+
+	/* Adding an existing neighbor returns the same entry */
+	zassert_equal_ptr(add_nbr(0, 0x100, NET_IPV6_NBR_STATE_REACHABLE),
+			  nbrs[0], "Neighbor duplicated");
+}
+
+static void test_evict_stale(void)
+{
+#if defined(CONFIG_NET_STATISTICS_IPV6_ND)
+	u32_t evicted = GET_STAT(ipv6_nd.nbr_evict);
+#endif
+	struct net_linkaddr lladdr = {
+		.addr = nbr_mac[5],
+		.len = sizeof(nbr_mac[5]),
+	};
+	struct in6_addr stale_addr;
+	int i;
+
+	/* Same address with a new lladdr makes the neighbor stale */
+	nbr_mac[5][0] = 0x02;
+	zassert_equal_ptr(net_ipv6_nbr_add(iface, &nbr_addr[5], &lladdr,
+					   false,
+					   NET_IPV6_NBR_STATE_REACHABLE),
+			  nbrs[5], "Neighbor duplicated");
+	zassert_equal(net_ipv6_nbr_data(nbrs[5])->state,
+		      NET_IPV6_NBR_STATE_STALE, "Not stale");
+
+	/* Neighbor 0 is the least recently used one */
+	for (i = 1; i < MAX_NBR; i++) {
+		net_ipv6_nbr_lookup(iface, &nbr_addr[i]);
+	}
+
+	/* The table is full, the stale one goes even if it was used
+	 * more recently.
+	 */
+	net_ipaddr_copy(&stale_addr, &nbr_addr[5]);
+
+	zassert_not_null(add_nbr(5, 0x200, NET_IPV6_NBR_STATE_REACHABLE),
+			 "Neighbor not added to full table");
+	zassert_is_null(net_ipv6_nbr_lookup(iface, &stale_addr),
+			"Stale neighbor not evicted");
+	zassert_equal_ptr(net_ipv6_nbr_lookup(iface, &nbr_addr[0]), nbrs[0],
+			  "Wrong neighbor evicted");
+
+#if defined(CONFIG_NET_STATISTICS_IPV6_ND)
+	zassert_equal(GET_STAT(ipv6_nd.nbr_evict), evicted + 1,
+		      "Eviction not counted");
+#endif
+}
+
+static void test_evict_lru(void)
+{
+	struct in6_addr lru_addr;
+	int i;
+
+	/* Everything is reachable, neighbor 2 is the oldest one */
+	for (i = 0; i < MAX_NBR; i++) {
+		if (i != 2) {
+			net_ipv6_nbr_lookup(iface, &nbr_addr[i]);
+		}
+	}
+
+	net_ipaddr_copy(&lru_addr, &nbr_addr[2]);
+
+	zassert_not_null(add_nbr(2, 0x300, NET_IPV6_NBR_STATE_REACHABLE),
+			 "Neighbor not added to full table");
+	zassert_is_null(net_ipv6_nbr_lookup(iface, &lru_addr),
+			"LRU neighbor not evicted");
+
+	for (i = 0; i < MAX_NBR; i++) {
+		zassert_equal_ptr(net_ipv6_nbr_lookup(iface, &nbr_addr[i]),
+				  nbrs[i], "Wrong neighbor evicted");
+	}
+}
+
+static void test_evict_referenced(void)
+{
+	u8_t mac[] = { 0x00, 0x00, 0x5E, 0x00, 0x04, 0x00 };
+	struct net_linkaddr lladdr = { .addr = mac, .len = sizeof(mac) };
+	struct in6_addr addr;
+	int i;
+
+	/* Neighbors used by someone else, like a route, are never evicted */
+	for (i = 0; i < MAX_NBR; i++) {
+		net_nbr_ref(nbrs[i]);
+	}
+
+	net_ipv6_addr_create(&addr, 0xfe80, 0, 0, 0, 0, 0, 0, 0x400);
+	zassert_is_null(net_ipv6_nbr_add(iface, &addr, &lladdr, false,
+					 NET_IPV6_NBR_STATE_REACHABLE),
+			"Referenced neighbor evicted");
+
+	for (i = 0; i < MAX_NBR; i++) {
+		net_nbr_unref(nbrs[i]);
+		zassert_equal_ptr(net_ipv6_nbr_lookup(iface, &nbr_addr[i]),
+				  nbrs[i], "Neighbor lost");
+	}
+}
+
+/* The lookup as it was done before the hash, for comparison */
+static struct net_nbr *linear_lookup(struct in6_addr *addr)
+{
+	int i;
+
+	for (i = 0; i < MAX_NBR; i++) {
+		struct net_nbr *nbr = nbrs[i];
+
+		if (!nbr->ref) {
+			continue;
+		}
+
+		if (nbr->iface == iface &&
+		    net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, addr)) {
+			return nbr;
+		}
+	}
+
+	return NULL;
+}
+
+static void test_bench(void)
+{
+	u32_t start, hash_cycles, linear_cycles;
+	int i, j;
+
+	for (i = 0; i < MAX_NBR; i++) {
+		zassert_equal_ptr(linear_lookup(&nbr_addr[i]), nbrs[i],
+				  "Wrong linear neighbor");
+	}
+
+	start = k_cycle_get_32();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < MAX_NBR; i++) {
+			net_ipv6_nbr_lookup(iface, &nbr_addr[i]);
+		}
+	}
+	hash_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < MAX_NBR; i++) {
+			linear_lookup(&nbr_addr[i]);
+		}
+	}
+	linear_cycles = k_cycle_get_32() - start;
+
+	printk("Neighbor lookup with %d neighbors and %d buckets: "
+	       "hash %u, linear %u cycles\n", MAX_NBR,
+	       CONFIG_NET_IPV6_NBR_HASH_SIZE,
+	       hash_cycles / (BENCH_ROUNDS * MAX_NBR),
+	       linear_cycles / (BENCH_ROUNDS * MAX_NBR));
+
+#if defined(CONFIG_NET_STATISTICS_IPV6_ND)
+	printk("Neighbor lookups %u miss %u evict %u\n",
+	       GET_STAT(ipv6_nd.nbr_lookup), GET_STAT(ipv6_nd.nbr_miss),
+	       GET_STAT(ipv6_nd.nbr_evict));
+#endif
+
+	for (i = 0; i < MAX_NBR; i++) {
+		zassert_true(net_ipv6_nbr_rm(iface, &nbr_addr[i]),
+			     "Cannot remove neighbor");
+		zassert_is_null(net_ipv6_nbr_lookup(iface, &nbr_addr[i]),
+				"Neighbor not removed");
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_ipv6_nbr_test,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_lladdr_hash),
+			 ztest_unit_test(test_lookup),
+			 ztest_unit_test(test_evict_stale),
+			 ztest_unit_test(test_evict_lru),
+			 ztest_unit_test(test_evict_referenced),
+			 ztest_unit_test(test_bench));
+
+	ztest_run_test_suite(net_ipv6_nbr_test);
+}
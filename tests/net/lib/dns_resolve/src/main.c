@@ -30,6 +30,11 @@
 
 #define NAME4 "4.zephyr.test"
 #define NAME6 "6.zephyr.test"
+#define NAME_CACHE "c.zephyr.test"
+#define NAME_NEGATIVE "n.zephyr.test"
+#define NAME_NO_SOA "s.zephyr.test"
+#define NAME_EXPIRE "e.zephyr.test"
+#define NAME_PARALLEL "p.zephyr.test"
 
 #define DNS_TIMEOUT 500 /* ms */
 
@@ -59,6 +64,26 @@ static struct k_sem wait_data2;
 static u16_t current_dns_id;
 static struct dns_addrinfo addrinfo;
 
+/* When set, the queries are answered with a real DNS response that is
+ * built according to these.
+ */
+static bool reply_query;
+static int queries_sent;
+
+struct dns_reply {
+	u8_t rcode;
+	bool address;
+	bool soa;
+	u32_t ttl;
+};
+
+static struct dns_reply reply_a;
+static struct dns_reply reply_aaaa;
+
+static const u8_t reply_addr4[] = { 192, 0, 2, 10 };
+static const u8_t reply_addr6[] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				    0, 0, 0, 0, 0, 0, 0, 0x10 };
+
 /* this must be higher that the DNS_TIMEOUT */
 #define WAIT_TIME (DNS_TIMEOUT + 300)
 
@@ -115,6 +140,90 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -1;
 }
 
+static void put_be16(u8_t *buf, u16_t val)
+{
+	buf[0] = val >> 8;
+	buf[1] = val;
+}
+
+static void put_be32(u8_t *buf, u32_t val)
+{
+	put_be16(buf, val >> 16);
+	put_be16(buf + 2, val);
+}
+
+/* Adds a resource record owned by the question name */
+static u16_t put_rr(u8_t *buf, u16_t type, u32_t ttl, const u8_t *rdata,
+		    u16_t rdlength)
+{
+	buf[0] = 0xc0;
+	buf[1] = 0x0c;
+	put_be16(buf + 2, type);
+	put_be16(buf + 4, 1);
+	put_be32(buf + 6, ttl);
+	put_be16(buf + 10, rdlength);
+	memcpy(buf + 12, rdata, rdlength);
+
+	return 12 + rdlength;
+}
+
+static void send_reply(struct net_pkt *pkt)
+{
+	struct net_context *net_ctx = net_pkt_context(pkt);
+	const struct dns_reply *reply;
+	u8_t soa[22] = { 0 };
+	struct net_pkt *rx;
+	struct net_buf *frag;
+	u16_t offset, pos, len, qtype;
+	u8_t msg[128];
+
+	queries_sent++;
+
+	offset = net_pkt_ip_hdr_len(pkt) + NET_UDPH_LEN;
+	len = net_pkt_get_len(pkt) - offset;
+	zassert_true(len + 64 <= sizeof(msg), "Too long query");
+
+	frag = net_frag_read(pkt->frags, offset, &pos, len, msg);
+	zassert_false(!frag && pos == 0xffff, "Cannot read query");
+
+	/* QTYPE and QCLASS end the question */
+	qtype = (msg[len - 4] << 8) | msg[len - 3];
+	reply = qtype == DNS_QUERY_TYPE_A ? &reply_a : &reply_aaaa;
+
+	/* QR, RD and RA flags */
+	msg[2] = 0x81;
+	msg[3] = 0x80 | reply->rcode;
+
+	if (reply->address) {
+		put_be16(msg + 6, 1);
+
+		if (qtype == DNS_QUERY_TYPE_A) {
+			len += put_rr(msg + len, qtype, reply->ttl,
+				      reply_addr4, sizeof(reply_addr4));
+		} else {
+			len += put_rr(msg + len, qtype, reply->ttl,
+				      reply_addr6, sizeof(reply_addr6));
+		}
+	}
+
+	if (reply->soa) {
+		/* Root MNAME and RNAME, then MINIMUM is the last field.
+		 * The record TTL is longer so MINIMUM must be used.
+		 */
+		put_be32(soa + sizeof(soa) - 4, reply->ttl);
+
+		put_be16(msg + 8, 1);
+		len += put_rr(msg + len, 6, reply->ttl * 10, soa, sizeof(soa));
+	}
+
+	rx = net_pkt_get_reserve_rx(0, K_FOREVER);
+	zassert_true(net_pkt_append_all(rx, len, msg, K_FOREVER),
+		     "Cannot create reply");
+	net_pkt_set_appdatalen(rx, len);
+
+	net_ctx->recv_cb(net_ctx, rx, 0, dns_resolve_get_default());
+}
+
 static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
 {
 	if (!pkt->frags) {
@@ -122,6 +231,11 @@ static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
 		return -ENODATA;
 	}
 
+	if (reply_query) {
+		send_reply(pkt);
+		goto out;
+	}
+
 	if (!timeout_query) {
 		struct net_if_test *data = iface->dev->driver_data;
 		struct dns_resolve_context *ctx;
@@ -633,6 +747,183 @@ static void dns_query_ipv6(void)
 	}
 }
 
+struct cache_result {
+	int status;
+	int count;
+	int family;
+};
+
+static void dns_cache_result_cb(enum dns_resolve_status status,
+				struct dns_addrinfo *info,
+				void *user_data)
+{
+	struct cache_result *result = user_data;
+
+	if (status == DNS_EAI_INPROGRESS) {
+		result->count++;
+		result->family = info->ai_family;
+		return;
+	}
+
+	result->status = status;
+
+	k_sem_give(&wait_data2);
+}
+
+static void cache_query(const char *name, enum dns_query_type type,
+			struct cache_result *result)
+{
+	int ret;
+
+	memset(result, 0, sizeof(*result));
+
+	reply_query = true;
+
+	ret = dns_get_addr_info(name, type, NULL, dns_cache_result_cb,
+				result, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "Cannot create query");
+
+	k_yield(); /* mandatory so that net_if send func gets to run */
+
+	if (k_sem_take(&wait_data2, WAIT_TIME)) {
+		zassert_true(false, "Timeout while waiting data");
+	}
+
+	reply_query = false;
+}
+
+static void dns_cache_positive(void)
+{
+	struct dns_cache_stats before, after;
+	struct cache_result result;
+	int sent = queries_sent;
+
+	reply_a = (struct dns_reply){ .address = true, .ttl = 60 };
+
+	dns_cache_get_stats(&before);
+
+	cache_query(NAME_CACHE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Query failed");
+	zassert_equal(result.count, 1, "Invalid number of addresses");
+	zassert_equal(queries_sent, sent + 1, "Query not sent");
+
+	cache_query(NAME_CACHE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Cached query failed");
+	zassert_equal(result.count, 1, "Invalid number of cached addresses");
+	zassert_equal(result.family, AF_INET, "Invalid cached family");
+	zassert_equal(queries_sent, sent + 1, "Cached query was sent");
+
+	dns_cache_get_stats(&after);
+	zassert_equal(after.misses, before.misses + 1, "Invalid misses");
+	zassert_equal(after.hits, before.hits + 1, "Invalid hits");
+	zassert_equal(after.inserts, before.inserts + 1, "Invalid inserts");
+}
+
+static void dns_cache_negative(void)
+{
+	struct dns_cache_stats before, after;
+	struct cache_result result;
+	int sent = queries_sent;
+
+	reply_a = (struct dns_reply){ .rcode = 3, .soa = true, .ttl = 60 };
+
+	dns_cache_get_stats(&before);
+
+	cache_query(NAME_NEGATIVE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_NONAME, "Name was found");
+
+	cache_query(NAME_NEGATIVE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_NONAME, "Cached name was found");
+	zassert_equal(queries_sent, sent + 1, "Cached query was sent");
+
+	dns_cache_get_stats(&after);
+	zassert_equal(after.negative_hits, before.negative_hits + 1,
+		      "Invalid negative hits");
+}
+
+static void dns_cache_negative_no_soa(void)
+{
+	struct cache_result result;
+	int sent = queries_sent;
+
+	reply_a = (struct dns_reply){ .ttl = 60 };
+
+	cache_query(NAME_NO_SOA, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_NODATA, "Address was found");
+
+	cache_query(NAME_NO_SOA, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_NODATA, "Address was found");
+	zassert_equal(queries_sent, sent + 2, "Answer without SOA cached");
+}
+
+static void dns_cache_expire(void)
+{
+	struct cache_result result;
+	int sent = queries_sent;
+
+	reply_a = (struct dns_reply){ .address = true, .ttl = 1 };
+
+	cache_query(NAME_EXPIRE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Query failed");
+
+	k_sleep(K_SECONDS(1) + 100);
+
+	cache_query(NAME_EXPIRE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Query failed");
+	zassert_equal(queries_sent, sent + 2, "Expired answer was used");
+}
+
+static void dns_query_parallel(void)
+{
+	struct cache_result result;
+	int sent = queries_sent;
+
+	reply_a = (struct dns_reply){ .soa = true, .ttl = 60 };
+	reply_aaaa = (struct dns_reply){ .address = true, .ttl = 60 };
+
+	cache_query(NAME_PARALLEL, DNS_QUERY_TYPE_A_AAAA, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Query failed");
+	zassert_equal(result.count, 1, "Invalid number of addresses");
+	zassert_equal(result.family, AF_INET6, "IPv6 address not found");
+	zassert_equal(queries_sent, sent + 2, "Both types not queried");
+
+	/* The negative A and the positive AAAA answers are both cached */
+	cache_query(NAME_PARALLEL, DNS_QUERY_TYPE_A_AAAA, &result);
+	zassert_equal(result.family, AF_INET6, "IPv6 address not cached");
+
+	cache_query(NAME_PARALLEL, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_NODATA, "IPv4 address found");
+	zassert_equal(queries_sent, sent + 2, "Cached query was sent");
+}
+
+static void dns_cache_count_cb(const struct dns_cache_info *info,
+			       void *user_data)
+{
+	(*(int *)user_data)++;
+}
+
+static void dns_cache_flush_all(void)
+{
+	struct cache_result result;
+	int sent = queries_sent;
+	int count = 0;
+
+	dns_cache_foreach(dns_cache_count_cb, &count);
+	zassert_true(count > 0, "Cache is empty");
+
+	dns_cache_flush();
+
+	count = 0;
+	dns_cache_foreach(dns_cache_count_cb, &count);
+	zassert_equal(count, 0, "Cache not flushed");
+
+	reply_a = (struct dns_reply){ .address = true, .ttl = 60 };
+
+	cache_query(NAME_CACHE, DNS_QUERY_TYPE_A, &result);
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Query failed");
+	zassert_equal(queries_sent, sent + 1, "Flushed answer was used");
+}
+
 void test_main(void)
 {
 	ztest_test_suite(dns_tests,
@@ -650,7 +941,13 @@ void test_main(void)
 			 ztest_unit_test(dns_query_ipv4_cancel),
 			 ztest_unit_test(dns_query_ipv6_cancel),
 			 ztest_unit_test(dns_query_ipv4),
-			 ztest_unit_test(dns_query_ipv6));
+			 ztest_unit_test(dns_query_ipv6),
+			 ztest_unit_test(dns_cache_positive),
+			 ztest_unit_test(dns_cache_negative),
+			 ztest_unit_test(dns_cache_negative_no_soa),
+			 ztest_unit_test(dns_cache_expire),
+			 ztest_unit_test(dns_query_parallel),
+			 ztest_unit_test(dns_cache_flush_all));
 
 	ztest_run_test_suite(dns_tests);
 }
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/socket.h>
+#include <net/http.h>
+
+#define MY_IPV4_ADDR "192.0.2.1"
+
+#define SERVER_PORT 8080
+
+#define REQUEST_COUNT 50
+
+#define HTTP_STATUS_200_OK	"HTTP/1.1 200 OK\r\n" \
+				"Content-Type: text/plain\r\n" \
+				"Transfer-Encoding: chunked\r\n" \
+				"\r\n"
+
+#define LAST_CHUNK "0\r\n\r\n"
+
+struct net_if_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+/* The clients connect to our own address, so all the traffic is looped
+ * back by the IP stack and never reaches the driver.
+ */
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_test net_iface_data;
+
+static struct net_if_api net_iface_api = {
+	.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_http_server_test, "net_http_server_test",
+		net_iface_dev_init, &net_iface_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_iface_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static struct http_server_ctx http_ctx;
+static struct http_server_urls http_urls;
+static u8_t http_request_buf[CONFIG_HTTP_SERVER_CONNECTIONS * 512];
+
+static struct sockaddr server_addr;
+
+/* The handlers answer with their own name */
+static int respond_api(struct http_server_ctx *ctx)
+{
+	return http_response(ctx, HTTP_STATUS_200_OK, "api");
+}
+
+static int respond_status(struct http_server_ctx *ctx)
+{
+	return http_response(ctx, HTTP_STATUS_200_OK, "status");
+}
+
+static int respond_index(struct http_server_ctx *ctx)
+{
+	return http_response(ctx, HTTP_STATUS_200_OK, "index");
+}
+
+static int respond_default(struct http_server_ctx *ctx)
+{
+	return http_response(ctx, HTTP_STATUS_200_OK, "default");
+}
+
+static int client_connect(void)
+{
+	int sock;
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(sock >= 0, "Cannot create socket");
+
+	zassert_equal(connect(sock, &server_addr, sizeof(struct sockaddr_in)),
+		      0, "Cannot connect");
+
+	return sock;
+}
+
+static void client_send(int sock, const char *data)
+{
+	zassert_equal(send(sock, data, strlen(data), 0), strlen(data),
+		      "Cannot send request");
+}
+
+static void client_get(int sock, const char *url, bool keep_alive)
+{
+	client_send(sock, "GET ");
+	client_send(sock, url);
+	client_send(sock, " HTTP/1.1\r\nHost: " MY_IPV4_ADDR "\r\n");
+
+	if (!keep_alive) {
+		client_send(sock, "Connection: close\r\n");
+	}
+
+	client_send(sock, "\r\n");
+}
+
+static int count_responses(const char *buf)
+{
+	int count = 0;
+
+	while ((buf = strstr(buf, LAST_CHUNK))) {
+		buf += sizeof(LAST_CHUNK) - 1;
+		count++;
+	}
+
+	return count;
+}
+
+/* The server answers from the thread that sends the request, the
+ * responses are normally queued when the request has been sent.
+ */
+static void client_read(int sock, char *buf, size_t size, int count)
+{
+	size_t len = 0;
+	ssize_t ret;
+	int tries;
+
+	buf[0] = '\0';
+
+	for (tries = 0; tries < 10 && count_responses(buf) < count; tries++) {
+		ret = recv(sock, buf + len, size - len - 1, MSG_DONTWAIT);
+		if (ret > 0) {
+			len += ret;
+			buf[len] = '\0';
+		} else {
+			k_sleep(10);
+		}
+	}
+
+	zassert_equal(count_responses(buf), count, "Missing responses");
+}
+
+/* Send a request on a new connection, and check which handler has
+ * answered it.
+ */
+static void check_url(const char *url, const char *handler)
+{
+	char buf[256];
+	char *body;
+	int sock;
+
+	sock = client_connect();
+
+	client_get(sock, url, false);
+	client_read(sock, buf, sizeof(buf), 1);
+
+	zassert_not_null(strstr(buf, "HTTP/1.1 200 OK"), "Wrong status");
+
+	body = strstr(buf, "\r\n\r\n");
+	zassert_not_null(body, "No header end");
+
+	/* The body is made of a single chunk */
+	body = strstr(body, "\r\n") + 2;
+	body = strstr(body, "\r\n") + 2;
+
+	zassert_equal(strncmp(body, handler, strlen(handler)), 0,
+		      "Wrong handler");
+
+	close(sock);
+
+	/* Let the system work queue close the server side */
+	k_yield();
+}
+
+static void test_init(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr4;
+
+	zassert_equal(inet_pton(AF_INET, MY_IPV4_ADDR, &addr4), 1,
+		      "inet_pton failed");
+	zassert_not_null(net_if_ipv4_addr_add(iface, &addr4,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add IPv4 address");
+
+	zassert_not_null(http_server_add_url(&http_urls, "/api", 0,
+					     respond_api),
+			 "Cannot add URL");
+	zassert_not_null(http_server_add_url(&http_urls, "/api/status", 0,
+					     respond_status),
+			 "Cannot add URL");
+	zassert_not_null(http_server_add_url(&http_urls, "/index.html", 0,
+					     respond_index),
+			 "Cannot add URL");
+	zassert_is_null(http_server_add_url(&http_urls, "/api", 0,
+					    respond_api),
+			"Duplicate URL accepted");
+	zassert_not_null(http_server_add_default(&http_urls,
+						 respond_default),
+			 "Cannot add default URL");
+
+	server_addr.family = AF_INET;
+	zassert_equal(http_server_set_local_addr(&server_addr, MY_IPV4_ADDR,
+						 SERVER_PORT), 0,
+		      "Cannot set server address");
+
+	zassert_equal(http_server_init(&http_ctx, &http_urls, &server_addr,
+				       http_request_buf,
+				       sizeof(http_request_buf), NULL), 0,
+		      "Cannot init HTTP server");
+
+	http_server_enable(&http_ctx);
+}
+
+static void test_url_match(void)
+{
+	check_url("/", "default");
+	check_url("/api", "api");
+	check_url("/api/", "api");
+	check_url("/api/status", "status");
+	check_url("/api/status?verbose=1", "status");
+	check_url("/api/statuses", "api");
+	check_url("/apis", "default");
+	check_url("/index.html?x", "index");
+	check_url("/index", "default");
+}
+
+static void test_url_del(void)
+{
+	zassert_equal(http_server_del_url(&http_urls, "/api"), 0,
+		      "Cannot delete URL");
+
+	check_url("/api/", "default");
+	check_url("/api/status", "status");
+
+	zassert_not_null(http_server_add_url(&http_urls, "/api", 0,
+					     respond_api),
+			 "Cannot add URL");
+
+	check_url("/api/", "api");
+}
+
+static void test_pipelining(void)
+{
+	static const char requests[] =
+		"GET /api HTTP/1.1\r\nHost: " MY_IPV4_ADDR "\r\n\r\n"
+		"GET /api/status HTTP/1.1\r\nHost: " MY_IPV4_ADDR "\r\n\r\n"
+		"GET /index.html HTTP/1.1\r\nHost: " MY_IPV4_ADDR "\r\n\r\n";
+	char buf[512];
+	char *api, *status, *index;
+	int sock;
+
+	sock = client_connect();
+
+	client_send(sock, requests);
+	client_read(sock, buf, sizeof(buf), 3);
+
+	/* The responses come in the order of the requests */
+	api = strstr(buf, "api");
+	status = strstr(buf, "status");
+	index = strstr(buf, "index");
+
+	zassert_true(api && status && index, "Missing responses");
+	zassert_true(api < status && status < index, "Wrong order");
+
+	/* The connection stays open */
+	client_get(sock, "/api", true);
+	client_read(sock, buf, sizeof(buf), 1);
+
+	close(sock);
+	k_yield();
+}
+
+static void test_concurrent(void)
+{
+	int sock[CONFIG_HTTP_SERVER_CONNECTIONS];
+	char buf[256];
+	int i, extra;
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		sock[i] = client_connect();
+	}
+
+	/* The requests are split between several packets, and interleaved
+	 * between the connections.
+	 */
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		client_send(sock[i], "GET /api/sta");
+	}
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		client_send(sock[i], "tus HTTP/1.1\r\nHo");
+		client_send(sock[i], "st: " MY_IPV4_ADDR "\r\n\r\n");
+	}
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		client_read(sock[i], buf, sizeof(buf), 1);
+
+		zassert_not_null(strstr(buf, "status"), "Wrong handler");
+	}
+
+	/* All the connections are idle, one of them is closed to serve a
+	 * new client.
+	 */
+	extra = client_connect();
+
+	client_get(extra, "/api", false);
+	client_read(extra, buf, sizeof(buf), 1);
+
+	zassert_not_null(strstr(buf, "api"), "Wrong handler");
+
+	close(extra);
+
+	for (i = 0; i < CONFIG_HTTP_SERVER_CONNECTIONS; i++) {
+		close(sock[i]);
+	}
+
+	k_yield();
+}
+
+/* Not a pass/fail test, compares the cost of the requests sent on a
+ * persistent connection with the cost of a new connection per request.
+ */
+static void test_keep_alive_cycles(void)
+{
+	u32_t start, cycles_keep_alive, cycles_close;
+	char buf[256];
+	int sock, i;
+
+	start = k_cycle_get_32();
+
+	sock = client_connect();
+
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		client_get(sock, "/api/status", true);
+		client_read(sock, buf, sizeof(buf), 1);
+	}
+
+	close(sock);
+
+	cycles_keep_alive = k_cycle_get_32() - start;
+
+	k_yield();
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		sock = client_connect();
+
+		client_get(sock, "/api/status", false);
+		client_read(sock, buf, sizeof(buf), 1);
+
+		close(sock);
+		k_yield();
+	}
+
+	cycles_close = k_cycle_get_32() - start;
+
+	printk("%d requests, %u cycles per request with keep-alive, "
+	       "%u cycles per request with a connection each\n",
+	       REQUEST_COUNT, cycles_keep_alive / REQUEST_COUNT,
+	       cycles_close / REQUEST_COUNT);
+}
+
+static void test_release(void)
+{
+	http_server_release(&http_ctx);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(http_server_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_url_match),
+			 ztest_unit_test(test_url_del),
+			 ztest_unit_test(test_pipelining),
+			 ztest_unit_test(test_concurrent),
+			 ztest_unit_test(test_keep_alive_cycles),
+			 ztest_unit_test(test_release));
+
+	ztest_run_test_suite(http_server_tests);
+}
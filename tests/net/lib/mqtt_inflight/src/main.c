@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/net_context.h>
+#include <net/socket.h>
+#include <net/mqtt.h>
+#include <mqtt_pkt.h>
+
+#define MY_IPV4_ADDR "192.0.2.1"
+
+#define BROKER_PORT 1883
+
+/* Delay of the acknowledgements sent by the broker */
+#define BROKER_RTT K_MSEC(20)
+
+#define PUBLISH_COUNT 32
+#define PENDING_COUNT 4
+
+#define TIMEOUT K_SECONDS(2)
+
+struct net_if_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+/* The client connects to our own address, so all the traffic is looped
+ * back by the IP stack and never reaches the driver.
+ */
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_test net_iface_data;
+
+static struct net_if_api net_iface_api = {
+	.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_mqtt_inflight_test, "net_mqtt_inflight_test",
+		net_iface_dev_init, &net_iface_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_iface_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+/* Broker stand-in: answers the CONNECT, PUBLISH and PUBREL messages, and
+ * delays the acknowledgements by BROKER_RTT to emulate a remote broker.
+ */
+static K_THREAD_STACK_DEFINE(broker_stack, 2048);
+static struct k_thread broker_thread;
+
+static struct sockaddr broker_addr;
+
+/* Acknowledgements are not sent while set */
+static bool broker_drop;
+
+/* Value of Session Present sent in the CONNACK messages */
+static bool broker_session;
+
+static int broker_dup_count;
+static u16_t broker_dup_ids[PENDING_COUNT];
+
+static u8_t broker_acks[256];
+static u16_t broker_acks_len;
+
+static void broker_ack(enum mqtt_packet type, u16_t pkt_id)
+{
+	u16_t len;
+	int rc;
+
+	zassert_true(broker_acks_len + 4 <= sizeof(broker_acks),
+		     "Too many acknowledgements");
+
+	switch (type) {
+	case MQTT_PUBACK:
+		rc = mqtt_pack_puback(broker_acks + broker_acks_len, &len, 4,
+				      pkt_id);
+		break;
+	case MQTT_PUBREC:
+		rc = mqtt_pack_pubrec(broker_acks + broker_acks_len, &len, 4,
+				      pkt_id);
+		break;
+	case MQTT_PUBCOMP:
+		rc = mqtt_pack_pubcomp(broker_acks + broker_acks_len, &len, 4,
+				       pkt_id);
+		break;
+	default:
+		rc = -EINVAL;
+	}
+
+	zassert_equal(rc, 0, "Cannot pack acknowledgement");
+
+	broker_acks_len += len;
+}
+
+/* Handle a whole message, return false when the client disconnects */
+static bool broker_handle(int sock, u8_t *msg, u16_t len, u16_t offset)
+{
+	enum mqtt_packet type = MQTT_PACKET_TYPE(msg[0]);
+	enum mqtt_qos qos;
+	u8_t connack[4];
+	u16_t pkt_id;
+
+	switch (type) {
+	case MQTT_CONNECT:
+		zassert_equal(mqtt_pack_connack(connack, &len, sizeof(connack),
+						broker_session, 0), 0,
+			      "Cannot pack CONNACK");
+		zassert_equal(send(sock, connack, len, 0), len,
+			      "Cannot send CONNACK");
+		break;
+	case MQTT_PUBLISH:
+		qos = (msg[0] >> 1) & 0x03;
+		if (qos == MQTT_QoS0) {
+			break;
+		}
+
+		/* Packet Identifier after the topic */
+		offset += 2 + sys_get_be16(msg + offset);
+		pkt_id = sys_get_be16(msg + offset);
+
+		if (msg[0] & 0x08) {
+			zassert_true(broker_dup_count < PENDING_COUNT,
+				     "Too many duplicates");
+			broker_dup_ids[broker_dup_count++] = pkt_id;
+		}
+
+		if (!broker_drop) {
+			broker_ack(qos == MQTT_QoS1 ? MQTT_PUBACK :
+				   MQTT_PUBREC, pkt_id);
+		}
+		break;
+	case MQTT_PUBREL:
+		if (!broker_drop) {
+			broker_ack(MQTT_PUBCOMP, sys_get_be16(msg + offset));
+		}
+		break;
+	case MQTT_DISCONNECT:
+		return false;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+/* Handle the whole messages of buf, and return the number of bytes used */
+static u16_t broker_parse(int sock, u8_t *buf, u16_t len, bool *connected)
+{
+	u16_t used = 0;
+
+	while (*connected && len - used >= 2) {
+		u8_t *msg = buf + used;
+		u32_t rlen = 0;
+		u16_t i = 1;
+
+		do {
+			rlen |= (msg[i] & 0x7f) << (7 * (i - 1));
+		} while ((msg[i++] & 0x80) && i < len - used);
+
+		if (i + rlen > len - used) {
+			break;
+		}
+
+		*connected = broker_handle(sock, msg, i + rlen, i);
+		used += i + rlen;
+	}
+
+	return used;
+}
+
+static void broker(void *p1, void *p2, void *p3)
+{
+	u8_t buf[512];
+	u16_t len;
+	int server, sock;
+	bool connected;
+	ssize_t ret;
+
+	server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(server >= 0, "Cannot create socket");
+	zassert_equal(bind(server, &broker_addr, sizeof(struct sockaddr_in)),
+		      0, "Cannot bind");
+	zassert_equal(listen(server, 1), 0, "Cannot listen");
+
+	while (1) {
+		sock = accept(server, NULL, NULL);
+		zassert_true(sock >= 0, "Cannot accept");
+
+		connected = true;
+		len = 0;
+
+		while (connected) {
+			ret = recv(sock, buf + len, sizeof(buf) - len, 0);
+			if (ret <= 0) {
+				break;
+			}
+
+			len += ret;
+
+			/* Gather all the messages already sent */
+			while ((ret = recv(sock, buf + len, sizeof(buf) - len,
+					   MSG_DONTWAIT)) > 0) {
+				len += ret;
+			}
+
+			ret = broker_parse(sock, buf, len, &connected);
+			memmove(buf, buf + ret, len - ret);
+			len -= ret;
+
+			if (broker_acks_len) {
+				k_sleep(BROKER_RTT);
+
+				send(sock, broker_acks, broker_acks_len, 0);
+				broker_acks_len = 0;
+			}
+		}
+
+		close(sock);
+	}
+}
+
+static struct mqtt_ctx mqtt;
+static struct net_context *net_ctx;
+
+static K_SEM_DEFINE(acked, 0, PUBLISH_COUNT);
+
+static int publish_tx_cb(struct mqtt_ctx *ctx, u16_t pkt_id,
+			 enum mqtt_packet type)
+{
+	if (type != MQTT_PUBREC) {
+		k_sem_give(&acked);
+	}
+
+	return 0;
+}
+
+static void client_connect(u8_t clean_session)
+{
+	struct mqtt_connect_msg msg = {
+		.clean_session = clean_session,
+		.client_id = "zephyr",
+		.client_id_len = 6,
+	};
+	int i;
+
+	zassert_equal(net_context_get(AF_INET, SOCK_STREAM, IPPROTO_TCP,
+				      &net_ctx), 0,
+		      "Cannot get network context");
+	zassert_equal(net_context_connect(net_ctx, &broker_addr,
+					  sizeof(struct sockaddr_in), NULL,
+					  TIMEOUT, NULL), 0,
+		      "Cannot connect");
+
+	if (mqtt.publish_tx) {
+		mqtt_reconnect(&mqtt, net_ctx);
+	} else {
+		mqtt.net_ctx = net_ctx;
+		mqtt.net_timeout = TIMEOUT;
+		mqtt.publish_tx = publish_tx_cb;
+
+		zassert_equal(mqtt_init(&mqtt, MQTT_APP_PUBLISHER), 0,
+			      "Cannot init MQTT");
+	}
+
+	zassert_equal(mqtt_tx_connect(&mqtt, &msg), 0,
+		      "Cannot send CONNECT");
+
+	for (i = 0; i < 10 && !mqtt.connected; i++) {
+		k_sleep(K_MSEC(10));
+	}
+
+	zassert_true(mqtt.connected, "Not connected");
+}
+
+static void client_disconnect(void)
+{
+	zassert_equal(mqtt_tx_disconnect(&mqtt), 0,
+		      "Cannot send DISCONNECT");
+
+	/* Let the broker close its side */
+	k_sleep(K_MSEC(10));
+
+	net_context_put(net_ctx);
+	net_ctx = NULL;
+}
+
+static void publish(u16_t pkt_id, enum mqtt_qos qos)
+{
+	struct mqtt_publish_msg msg = {
+		.qos = qos,
+		.pkt_id = pkt_id,
+		.topic = "sensors",
+		.topic_len = 7,
+		.msg = (u8_t *)"data",
+		.msg_len = 4,
+	};
+
+	zassert_equal(mqtt_tx_publish(&mqtt, &msg), 0, "Cannot publish");
+}
+
+static void wait_acks(int count)
+{
+	while (count--) {
+		zassert_equal(k_sem_take(&acked, TIMEOUT), 0,
+			      "Message not acknowledged");
+	}
+}
+
+static void test_init(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr4;
+
+	zassert_equal(inet_pton(AF_INET, MY_IPV4_ADDR, &addr4), 1,
+		      "inet_pton failed");
+	zassert_not_null(net_if_ipv4_addr_add(iface, &addr4,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add IPv4 address");
+
+	broker_addr.family = AF_INET;
+	net_sin(&broker_addr)->sin_port = htons(BROKER_PORT);
+	net_ipaddr_copy(&net_sin(&broker_addr)->sin_addr, &addr4);
+
+	/* Same priority as the test thread, so that each of them runs
+	 * until it blocks.
+	 */
+	k_thread_create(&broker_thread, broker_stack,
+			K_THREAD_STACK_SIZEOF(broker_stack), broker,
+			NULL, NULL, NULL,
+			K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1), 0, 0);
+	k_yield();
+
+	client_connect(1);
+}
+
+/* Not a pass/fail test for the timing, compares the throughput of QoS 1
+ * messages sent one at a time with the throughput of the window.
+ */
+static void test_throughput(void)
+{
+	u32_t start, stop_and_wait, window;
+	int i;
+
+	start = k_uptime_get_32();
+
+	for (i = 0; i < PUBLISH_COUNT; i++) {
+		publish(i + 1, MQTT_QoS1);
+		wait_acks(1);
+	}
+
+	stop_and_wait = k_uptime_get_32() - start;
+
+	start = k_uptime_get_32();
+
+	for (i = 0; i < PUBLISH_COUNT; i++) {
+		publish(i + 1, MQTT_QoS1);
+	}
+
+	wait_acks(PUBLISH_COUNT);
+
+	window = k_uptime_get_32() - start;
+
+	printk("%d QoS 1 messages, %u ms one at a time, %u ms with a window "
+	       "of %d\n", PUBLISH_COUNT, stop_and_wait, window,
+	       CONFIG_MQTT_INFLIGHT_WINDOW);
+}
+
+static void test_qos2(void)
+{
+	int i;
+
+	for (i = 0; i < PUBLISH_COUNT; i++) {
+		publish(i + 1, MQTT_QoS2);
+	}
+
+	wait_acks(PUBLISH_COUNT);
+
+	zassert_equal(k_sem_count_get(&mqtt.inflight_sem),
+		      CONFIG_MQTT_INFLIGHT_WINDOW, "Messages still in flight");
+}
+
+static void test_duplicate_id(void)
+{
+	struct mqtt_publish_msg msg = {
+		.qos = MQTT_QoS1,
+		.pkt_id = 1,
+		.topic = "sensors",
+		.topic_len = 7,
+		.msg = (u8_t *)"data",
+		.msg_len = 4,
+	};
+
+	broker_drop = true;
+
+	publish(1, MQTT_QoS1);
+	zassert_equal(mqtt_tx_publish(&mqtt, &msg), -EINVAL,
+		      "Packet Identifier used twice");
+
+	client_disconnect();
+	broker_drop = false;
+
+	/* The server has no session, the message is discarded */
+	broker_session = false;
+	client_connect(0);
+
+	zassert_equal(k_sem_count_get(&mqtt.inflight_sem),
+		      CONFIG_MQTT_INFLIGHT_WINDOW, "Messages still in flight");
+}
+
+/* The unacknowledged messages are sent again, in order, when the session
+ * is resumed.
+ */
+static void test_resend(void)
+{
+	static const u16_t ids[PENDING_COUNT] = { 40, 8, 24, 16 };
+	int i;
+
+	broker_drop = true;
+
+	for (i = 0; i < PENDING_COUNT; i++) {
+		publish(ids[i], i % 2 ? MQTT_QoS2 : MQTT_QoS1);
+	}
+
+	client_disconnect();
+	broker_drop = false;
+	broker_dup_count = 0;
+
+	broker_session = true;
+	client_connect(0);
+
+	wait_acks(PENDING_COUNT);
+
+	zassert_equal(broker_dup_count, PENDING_COUNT, "Messages not resent");
+	for (i = 0; i < PENDING_COUNT; i++) {
+		zassert_equal(broker_dup_ids[i], ids[i], "Wrong order");
+	}
+
+	zassert_equal(k_sem_count_get(&mqtt.inflight_sem),
+		      CONFIG_MQTT_INFLIGHT_WINDOW, "Messages still in flight");
+}
+
+static void test_release(void)
+{
+	client_disconnect();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(mqtt_inflight_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_throughput),
+			 ztest_unit_test(test_qos2),
+			 ztest_unit_test(test_duplicate_id),
+			 ztest_unit_test(test_resend),
+			 ztest_unit_test(test_release));
+
+	ztest_run_test_suite(mqtt_inflight_tests);
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ztest.h>
+
+#include <net/net_pkt.h>
+#include <net/net_context.h>
+#include <net/mqtt.h>
+#include <mqtt_pkt.h>
+
+#define TOPIC		"sensors"
+#define PAYLOAD_LEN	300
+#define SUBACK_ID	1
+#define PUBACK_ID	7
+
+/* Fragments carrying a header before the MQTT data, to check that only
+ * the application data is parsed.
+ */
+#define HEADER_LEN	8
+
+static struct net_context *net_ctx;
+static struct mqtt_ctx mqtt;
+
+static u8_t stream[512];
+static u16_t stream_len;
+
+static u8_t payload[PAYLOAD_LEN];
+static u8_t received[PAYLOAD_LEN];
+
+/* Packet being parsed, the payload parts must point inside it */
+static struct net_pkt *current_pkt;
+
+static int connect_count;
+static int subscribe_count;
+static int puback_count;
+static int publish_count;
+static int malformed_count;
+static u32_t payload_received;
+
+static void connect_cb(struct mqtt_ctx *ctx)
+{
+	connect_count++;
+}
+
+static int publish_tx_cb(struct mqtt_ctx *ctx, u16_t pkt_id,
+			 enum mqtt_packet type)
+{
+	zassert_equal(type, MQTT_PUBACK, "Wrong type");
+	zassert_equal(pkt_id, PUBACK_ID, "Wrong packet id");
+
+	puback_count++;
+
+	return 0;
+}
+
+static bool in_pkt(const u8_t *data, u16_t len)
+{
+	struct net_buf *frag;
+
+	for (frag = current_pkt->frags; frag; frag = frag->frags) {
+		if (data >= frag->data && data + len <= frag->data + frag->len) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int publish_payload_cb(struct mqtt_ctx *ctx,
+			      struct mqtt_publish_msg *msg,
+			      u32_t offset, u32_t total)
+{
+	zassert_equal(total, PAYLOAD_LEN, "Wrong payload length");
+	zassert_equal(offset, payload_received, "Wrong payload offset");
+	zassert_true(offset + msg->msg_len <= total, "Payload overflow");
+	zassert_true(in_pkt(msg->msg, msg->msg_len), "Payload was copied");
+
+	zassert_equal(msg->topic_len, strlen(TOPIC), "Wrong topic length");
+	zassert_equal(memcmp(msg->topic, TOPIC, msg->topic_len), 0,
+		      "Wrong topic");
+
+	memcpy(received + offset, msg->msg, msg->msg_len);
+	payload_received += msg->msg_len;
+
+	return 0;
+}
+
+static int publish_rx_cb(struct mqtt_ctx *ctx, struct mqtt_publish_msg *msg,
+			 u16_t pkt_id, enum mqtt_packet type)
+{
+	zassert_equal(type, MQTT_PUBLISH, "Wrong type");
+	zassert_equal(msg->qos, MQTT_QoS0, "Wrong QoS");
+	zassert_equal(msg->topic_len, strlen(TOPIC), "Wrong topic length");
+	zassert_equal(memcmp(msg->topic, TOPIC, msg->topic_len), 0,
+		      "Wrong topic");
+
+	if (ctx->publish_payload) {
+		zassert_is_null(msg->msg, "Payload passed twice");
+		zassert_equal(payload_received, PAYLOAD_LEN,
+			      "Incomplete payload");
+	} else {
+		memcpy(received, msg->msg, msg->msg_len);
+		payload_received = msg->msg_len;
+	}
+
+	publish_count++;
+
+	return 0;
+}
+
+static int subscribe_cb(struct mqtt_ctx *ctx, u16_t pkt_id, u8_t items,
+			enum mqtt_qos qos[])
+{
+	zassert_equal(pkt_id, SUBACK_ID, "Wrong packet id");
+	zassert_equal(items, 1, "Wrong number of topics");
+
+	subscribe_count++;
+
+	return 0;
+}
+
+static void malformed_cb(struct mqtt_ctx *ctx, u16_t pkt_type)
+{
+	malformed_count++;
+}
+
+static void reset_counters(void)
+{
+	mqtt.connected = 0;
+
+	connect_count = 0;
+	subscribe_count = 0;
+	puback_count = 0;
+	publish_count = 0;
+	malformed_count = 0;
+	payload_received = 0;
+
+	memset(received, 0, sizeof(received));
+}
+
+static void stream_add(u8_t *msg, u16_t len)
+{
+	zassert_true(stream_len + len <= sizeof(stream), "Stream too long");
+
+	memcpy(stream + stream_len, msg, len);
+	stream_len += len;
+}
+
+static void stream_add_publish(u16_t payload_len)
+{
+	struct mqtt_publish_msg msg = {
+		.qos = MQTT_QoS0,
+		.topic = TOPIC,
+		.topic_len = strlen(TOPIC),
+		.msg = payload,
+		.msg_len = payload_len,
+	};
+	u8_t buf[PAYLOAD_LEN + 16];
+	u16_t len;
+
+	zassert_equal(mqtt_pack_publish(buf, &len, sizeof(buf), &msg), 0,
+		      "Cannot pack PUBLISH");
+	stream_add(buf, len);
+}
+
+/* CONNACK, SUBACK, PUBLISH, PINGRESP and PUBACK */
+static void stream_build(u16_t payload_len)
+{
+	enum mqtt_qos qos = MQTT_QoS0;
+	u8_t buf[8];
+	u16_t len;
+
+	stream_len = 0;
+
+	zassert_equal(mqtt_pack_connack(buf, &len, sizeof(buf), 0, 0), 0,
+		      "Cannot pack CONNACK");
+	stream_add(buf, len);
+
+	zassert_equal(mqtt_pack_suback(buf, &len, sizeof(buf), SUBACK_ID,
+				       1, &qos), 0,
+		      "Cannot pack SUBACK");
+	stream_add(buf, len);
+
+	stream_add_publish(payload_len);
+
+	zassert_equal(mqtt_pack_pingresp(buf, &len, sizeof(buf)), 0,
+		      "Cannot pack PINGRESP");
+	stream_add(buf, len);
+
+	zassert_equal(mqtt_pack_puback(buf, &len, sizeof(buf), PUBACK_ID), 0,
+		      "Cannot pack PUBACK");
+	stream_add(buf, len);
+}
+
+/* Pass the stream to the parser in packets made of frags fragments of
+ * frag_len bytes each.
+ */
+static void stream_feed(u16_t frag_len, int frags)
+{
+	u16_t offset = 0;
+
+	while (offset < stream_len) {
+		struct net_pkt *pkt;
+		struct net_buf *frag;
+		u16_t len = 0;
+		int i;
+
+		pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+		zassert_not_null(pkt, "Cannot get packet");
+
+		frag = net_pkt_get_frag(pkt, K_FOREVER);
+		zassert_not_null(frag, "Cannot get fragment");
+		memset(net_buf_add(frag, HEADER_LEN), 0xff, HEADER_LEN);
+		net_pkt_frag_add(pkt, frag);
+
+		for (i = 0; i < frags && offset < stream_len; i++) {
+			u16_t size = min(frag_len, stream_len - offset);
+
+			frag = net_pkt_get_frag(pkt, K_FOREVER);
+			zassert_not_null(frag, "Cannot get fragment");
+			net_buf_add_mem(frag, stream + offset, size);
+			net_pkt_frag_add(pkt, frag);
+
+			offset += size;
+			len += size;
+		}
+
+		net_pkt_set_appdatalen(pkt, len);
+
+		current_pkt = pkt;
+		mqtt.rcv(&mqtt, pkt);
+		current_pkt = NULL;
+
+		net_pkt_unref(pkt);
+	}
+}
+
+static void check_stream(void)
+{
+	zassert_equal(malformed_count, 0, "Message rejected");
+	zassert_equal(connect_count, 1, "CONNACK not parsed");
+	zassert_equal(subscribe_count, 1, "SUBACK not parsed");
+	zassert_equal(publish_count, 1, "PUBLISH not parsed");
+	zassert_equal(puback_count, 1, "PUBACK not parsed");
+}
+
+static void test_init(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(payload); i++) {
+		payload[i] = i;
+	}
+
+	zassert_equal(net_context_get(AF_INET, SOCK_DGRAM, IPPROTO_UDP,
+				      &net_ctx), 0,
+		      "Cannot get network context");
+
+	mqtt.net_ctx = net_ctx;
+	mqtt.net_timeout = K_NO_WAIT;
+	mqtt.connect = connect_cb;
+	mqtt.publish_tx = publish_tx_cb;
+	mqtt.publish_rx = publish_rx_cb;
+	mqtt.subscribe = subscribe_cb;
+	mqtt.malformed = malformed_cb;
+
+	zassert_equal(mqtt_init(&mqtt, MQTT_APP_PUBLISHER_SUBSCRIBER), 0,
+		      "Cannot init MQTT");
+}
+
+/* The payload is passed in parts, straight from the fragments, whatever
+ * the boundaries of the packets are.
+ */
+static void test_payload_parts(void)
+{
+	static const u16_t frag_lens[] = { 1, 2, 3, 7, 64, 128 };
+	int i, frags;
+
+	mqtt.publish_payload = publish_payload_cb;
+
+	stream_build(PAYLOAD_LEN);
+
+	for (i = 0; i < ARRAY_SIZE(frag_lens); i++) {
+		for (frags = 1; frags <= 3; frags++) {
+			reset_counters();
+
+			stream_feed(frag_lens[i], frags);
+
+			check_stream();
+			zassert_equal(memcmp(received, payload, PAYLOAD_LEN), 0,
+				      "Wrong payload");
+		}
+	}
+}
+
+/* Without the payload callback, the messages are reassembled */
+static void test_whole_message(void)
+{
+	mqtt.publish_payload = NULL;
+
+	stream_build(64);
+
+	reset_counters();
+	stream_feed(5, 2);
+
+	check_stream();
+	zassert_equal(payload_received, 64, "Wrong payload length");
+	zassert_equal(memcmp(received, payload, 64), 0, "Wrong payload");
+}
+
+/* A message that does not fit is discarded, the following messages are
+ * still parsed.
+ */
+static void test_too_large(void)
+{
+	mqtt.publish_payload = NULL;
+
+	stream_build(PAYLOAD_LEN);
+
+	reset_counters();
+	stream_feed(32, 2);
+
+	zassert_equal(malformed_count, 1, "Large message not discarded");
+	zassert_equal(publish_count, 0, "Large message parsed");
+	zassert_equal(connect_count, 1, "CONNACK not parsed");
+	zassert_equal(subscribe_count, 1, "SUBACK not parsed");
+	zassert_equal(puback_count, 1, "PUBACK not parsed");
+}
+
+static void test_release(void)
+{
+	net_context_put(net_ctx);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(mqtt_stream_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_payload_parts),
+			 ztest_unit_test(test_whole_message),
+			 ztest_unit_test(test_too_large),
+			 ztest_unit_test(test_release));
+
+	ztest_run_test_suite(mqtt_stream_tests);
+}
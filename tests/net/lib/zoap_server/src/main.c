@@ -0,0 +1,1128 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/net_context.h>
+#include <net/zoap.h>
+#include <net/zoap_server.h>
+
+#define MY_IPV4_ADDR "192.0.2.1"
+
+#define SERVER_PORT 5683
+#define CLIENT_PORT 5684
+
+#define REQUEST_COUNT 100
+
+#define NOTIFY_ROUNDS 10
+
+#define OBSERVERS CONFIG_ZOAP_SERVER_OBSERVERS
+
+#define NOTIFY_BURSTS \
+	((OBSERVERS + CONFIG_ZOAP_SERVER_NOTIFY_BURST - 1) / \
+	 CONFIG_ZOAP_SERVER_NOTIFY_BURST)
+
+/* Time after which all the observers have been notified */
+#define NOTIFY_TIME K_MSEC(CONFIG_ZOAP_SERVER_NOTIFY_INTERVAL * \
+			   (NOTIFY_BURSTS + 1) + 100)
+
+/* Time after which the first retransmission has happened, the ACK
+ * timeout being randomized up to 1.5 times its value.
+ */
+#define FIRST_RETRANSMISSION K_MSEC(CONFIG_ZOAP_SERVER_ACK_TIMEOUT * 2)
+
+/* Time after which the server has given up, after 4 retransmissions */
+#define LAST_TIMEOUT K_MSEC(CONFIG_ZOAP_SERVER_ACK_TIMEOUT * 3 / 2 * 31 + 200)
+
+struct net_if_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+/* The client sends to our own address, so all the traffic is looped
+ * back by the IP stack and never reaches the driver.
+ */
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_test net_iface_data;
+
+static struct net_if_api net_iface_api = {
+	.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_zoap_server_test, "net_zoap_server_test",
+		net_iface_dev_init, &net_iface_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_iface_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static struct net_context *server_ctx;
+static struct net_context *client_ctx;
+
+static struct sockaddr server_addr;
+static struct sockaddr client_addr;
+
+static struct zoap_server server;
+
+/* Last response received by the client */
+static struct {
+	u8_t data[128];
+	u16_t len;
+	u16_t id;
+	u8_t type;
+	u8_t code;
+} last;
+
+/* Notifications received by each observer, the last one being an extra
+ * observer that does not fit in the server.
+ */
+static struct {
+	const u8_t *shared;
+	char payload[16];
+	int count;
+	int seq;
+	u16_t id;
+} observed[OBSERVERS + 1];
+
+static s64_t notify_first;
+static s64_t notify_last;
+static int notifications;
+static bool auto_ack;
+
+static int responses;
+static int handled;
+static int server_result;
+static struct zoap_resource *last_resource;
+
+static const u8_t token_a[8] = { 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a' };
+static const u8_t token_b[8] = { 'b', 'b', 'b', 'b', 'b', 'b', 'b', 'b' };
+
+static void client_ack(u16_t id);
+
+static int response_send(struct zoap_packet *request,
+			 const struct sockaddr *from, u8_t type, u8_t code)
+{
+	struct zoap_packet response;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	const u8_t *token;
+	u8_t *payload, tkl;
+	u16_t len, id;
+	int r;
+
+	pkt = net_pkt_get_tx(server_ctx, K_FOREVER);
+	frag = net_pkt_get_data(server_ctx, K_FOREVER);
+	net_pkt_frag_add(pkt, frag);
+
+	zassert_equal(zoap_packet_init(&response, pkt), 0,
+		      "Cannot init response");
+
+	if (type == ZOAP_TYPE_ACK) {
+		id = zoap_header_get_id(request);
+	} else {
+		id = zoap_next_id();
+	}
+
+	token = zoap_header_get_token(request, &tkl);
+
+	zoap_header_set_version(&response, 1);
+	zoap_header_set_type(&response, type);
+	zoap_header_set_code(&response, code);
+	zoap_header_set_id(&response, id);
+
+	if (code != ZOAP_CODE_EMPTY) {
+		zoap_header_set_token(&response, token, tkl);
+
+		/* A response built again differs from the first one */
+		payload = zoap_packet_get_payload(&response, &len);
+		zassert_not_null(payload, "No room for payload");
+
+		r = snprintk((char *)payload, len, "%d", handled);
+		zoap_packet_set_used(&response, r);
+	}
+
+	return zoap_server_send(&server, &response, from);
+}
+
+static int piggyback_get(struct zoap_resource *resource,
+			 struct zoap_packet *request,
+			 const struct sockaddr *from)
+{
+	u8_t type = zoap_header_get_type(request);
+
+	last_resource = resource;
+	handled++;
+
+	return response_send(request, from,
+			     type == ZOAP_TYPE_CON ?
+			     ZOAP_TYPE_ACK : ZOAP_TYPE_NON_CON,
+			     ZOAP_RESPONSE_CODE_CONTENT);
+}
+
+/* An empty ACK, then the response as a confirmable message */
+static int separate_get(struct zoap_resource *resource,
+			struct zoap_packet *request,
+			const struct sockaddr *from)
+{
+	int r;
+
+	last_resource = resource;
+	handled++;
+
+	r = response_send(request, from, ZOAP_TYPE_ACK, ZOAP_CODE_EMPTY);
+	if (r < 0) {
+		return r;
+	}
+
+	return response_send(request, from, ZOAP_TYPE_CON,
+			     ZOAP_RESPONSE_CODE_CONTENT);
+}
+
+/* Methods that do not answer, nothing can be replayed */
+static int silent_method(struct zoap_resource *resource,
+			 struct zoap_packet *request,
+			 const struct sockaddr *from)
+{
+	last_resource = resource;
+	handled++;
+
+	return 0;
+}
+
+static int observe_get(struct zoap_resource *resource,
+		       struct zoap_packet *request,
+		       const struct sockaddr *from)
+{
+	int r;
+
+	last_resource = resource;
+	handled++;
+
+	r = zoap_server_observe(&server, resource, request, from);
+	if (r < 0) {
+		return r;
+	}
+
+	return response_send(request, from, ZOAP_TYPE_ACK,
+			     ZOAP_RESPONSE_CODE_CONTENT);
+}
+
+static const char * const test_path[] = { "test", NULL };
+static const char * const segments_path[] = { "seg1", "seg2", "seg3", NULL };
+static const char * const segment_path[] = { "seg1", "seg4", NULL };
+static const char * const separate_path[] = { "separate", NULL };
+static const char * const silent_path[] = { "silent", NULL };
+static const char * const observe_path[] = { "observe", NULL };
+
+static struct zoap_resource resources[] = {
+	{ .get = piggyback_get,
+	  .path = test_path },
+	{ .get = piggyback_get,
+	  .path = segments_path },
+	{ .get = piggyback_get,
+	  .path = segment_path },
+	{ .get = separate_get,
+	  .path = separate_path },
+	{ .get = silent_method,
+	  .post = silent_method,
+	  .path = silent_path },
+	{ .get = observe_get,
+	  .path = observe_path },
+	{ },
+};
+
+/* The resources of samples/net/zoap_server, for the benchmark */
+static const char * const large_path[] = { "large", NULL };
+static const char * const location_query_path[] = { "location-query", NULL };
+static const char * const large_update_path[] = { "large-update", NULL };
+static const char * const large_create_path[] = { "large-create", NULL };
+static const char * const obs_path[] = { "obs", NULL };
+static const char * const well_known_path[] = { ".well-known", "core", NULL };
+static const char * const core_1_path[] = { "core1", NULL };
+static const char * const core_2_path[] = { "core2", NULL };
+static const char * const query_path[] = { "query", NULL };
+
+static struct zoap_resource sample_resources[] = {
+	{ .get = silent_method,
+	  .post = silent_method,
+	  .del = silent_method,
+	  .put = silent_method,
+	  .path = test_path },
+	{ .get = silent_method, .path = segments_path },
+	{ .get = silent_method, .path = query_path },
+	{ .get = silent_method, .path = separate_path },
+	{ .get = silent_method, .path = large_path },
+	{ .post = silent_method, .path = location_query_path },
+	{ .put = silent_method, .path = large_update_path },
+	{ .post = silent_method, .path = large_create_path },
+	{ .get = silent_method, .path = obs_path },
+	{ .get = silent_method, .path = well_known_path },
+	{ .get = silent_method, .path = core_1_path },
+	{ .get = silent_method, .path = core_2_path },
+	{ },
+};
+
+static struct zoap_server sample_server;
+
+static void server_recv(struct net_context *context, struct net_pkt *pkt,
+			int status, void *user_data)
+{
+	struct zoap_packet request;
+	struct sockaddr from;
+	int header_len;
+
+	from.family = AF_INET;
+	net_ipaddr_copy(&net_sin(&from)->sin_addr, &NET_IPV4_HDR(pkt)->src);
+	net_sin(&from)->sin_port = NET_UDP_HDR(pkt)->src_port;
+
+	header_len = net_pkt_appdata(pkt) - pkt->frags->data;
+	net_buf_pull(pkt->frags, header_len);
+
+	zassert_equal(zoap_packet_parse(&request, pkt), 0,
+		      "Cannot parse request");
+
+	server_result = zoap_server_handle(&server, &request, &from);
+
+	net_pkt_unref(pkt);
+}
+
+static void notification_recv(struct zoap_packet *response,
+			      const struct net_buf *shared)
+{
+	struct zoap_option option;
+	const u8_t *token;
+	u8_t *payload;
+	u16_t len;
+	u8_t tkl;
+	int i;
+
+	if (zoap_find_options(response, ZOAP_OPTION_OBSERVE, &option, 1) <= 0) {
+		return;
+	}
+
+	token = zoap_header_get_token(response, &tkl);
+	zassert_equal(tkl, sizeof(token_a), "Wrong token");
+	zassert_equal(token[0], 'o', "Wrong token");
+
+	i = token[1];
+	zassert_true(i <= OBSERVERS, "Wrong token");
+
+	observed[i].count++;
+	observed[i].seq = zoap_option_value_to_int(&option);
+	observed[i].id = last.id;
+	observed[i].shared = shared ? shared->data : NULL;
+
+	memset(observed[i].payload, 0, sizeof(observed[i].payload));
+
+	payload = zoap_packet_get_payload(response, &len);
+	if (payload) {
+		memcpy(observed[i].payload, payload,
+		       min(len, sizeof(observed[i].payload) - 1));
+	}
+
+	notify_last = k_uptime_get();
+
+	if (!notifications++) {
+		notify_first = notify_last;
+	}
+}
+
+/* The payload of the notifications is in another fragment, the message
+ * is copied into a single fragment to be parsed.
+ */
+static void client_recv(struct net_context *context, struct net_pkt *pkt,
+			int status, void *user_data)
+{
+	struct zoap_packet response;
+	struct net_buf *frag, *shared = NULL;
+	struct net_pkt *copy;
+	int header_len, len;
+
+	header_len = net_pkt_appdata(pkt) - pkt->frags->data;
+	net_buf_pull(pkt->frags, header_len);
+
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		if (frag->flags & NET_BUF_EXTERNAL_DATA) {
+			shared = frag;
+		}
+	}
+
+	len = net_frag_linearize(last.data, sizeof(last.data), pkt, 0,
+				 net_buf_frags_len(pkt->frags));
+	zassert_true(len > 0, "Cannot linearize response");
+
+	copy = net_pkt_get_tx(client_ctx, K_FOREVER);
+	frag = net_pkt_get_data(client_ctx, K_FOREVER);
+	net_pkt_frag_add(copy, frag);
+	net_buf_add_mem(frag, last.data, len);
+
+	zassert_equal(zoap_packet_parse(&response, copy), 0,
+		      "Cannot parse response");
+
+	last.type = zoap_header_get_type(&response);
+	last.code = zoap_header_get_code(&response);
+	last.id = zoap_header_get_id(&response);
+	last.len = len;
+
+	responses++;
+
+	notification_recv(&response, shared);
+
+	net_pkt_unref(copy);
+	net_pkt_unref(pkt);
+
+	if (auto_ack && last.type == ZOAP_TYPE_CON) {
+		client_ack(last.id);
+	}
+}
+
+static void request_init(struct zoap_packet *zpkt, u8_t type, u8_t code,
+			 u16_t id, const u8_t *token,
+			 const char * const *path)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_tx(client_ctx, K_FOREVER);
+	frag = net_pkt_get_data(client_ctx, K_FOREVER);
+	net_pkt_frag_add(pkt, frag);
+
+	zassert_equal(zoap_packet_init(zpkt, pkt), 0, "Cannot init request");
+
+	zoap_header_set_version(zpkt, 1);
+	zoap_header_set_type(zpkt, type);
+	zoap_header_set_code(zpkt, code);
+	zoap_header_set_id(zpkt, id);
+
+	if (token) {
+		zoap_header_set_token(zpkt, token, sizeof(token_a));
+	}
+
+	for (; path && *path; path++) {
+		zassert_equal(zoap_add_option(zpkt, ZOAP_OPTION_URI_PATH,
+					      *path, strlen(*path)), 0,
+			      "Cannot add path");
+	}
+}
+
+/* The server answers from the sending thread, the response has been
+ * received when this returns.
+ */
+static void client_send(u8_t type, u8_t code, u16_t id, const u8_t *token,
+			const char * const *path)
+{
+	struct zoap_packet request;
+
+	request_init(&request, type, code, id, token, path);
+
+	server_result = 0;
+
+	zassert_equal(net_context_sendto(request.pkt, &server_addr,
+					 sizeof(struct sockaddr_in),
+					 NULL, 0, NULL, NULL), 0,
+		      "Cannot send request");
+}
+
+static void client_get(u16_t id, const u8_t *token, const char * const *path)
+{
+	client_send(ZOAP_TYPE_CON, ZOAP_METHOD_GET, id, token, path);
+}
+
+static void client_ack(u16_t id)
+{
+	client_send(ZOAP_TYPE_ACK, ZOAP_CODE_EMPTY, id, NULL, NULL);
+}
+
+static void client_observe(u16_t id, int observer, unsigned int observe)
+{
+	struct zoap_packet request;
+	u8_t token[8] = { 'o', observer };
+
+	request_init(&request, ZOAP_TYPE_CON, ZOAP_METHOD_GET, id, token,
+		     NULL);
+
+	/* The options are sorted, Observe comes before Uri-Path */
+	zassert_equal(zoap_add_option_int(&request, ZOAP_OPTION_OBSERVE,
+					  observe), 0,
+		      "Cannot add Observe");
+	zassert_equal(zoap_add_option(&request, ZOAP_OPTION_URI_PATH,
+				      observe_path[0],
+				      strlen(observe_path[0])), 0,
+		      "Cannot add path");
+
+	server_result = 0;
+
+	zassert_equal(net_context_sendto(request.pkt, &server_addr,
+					 sizeof(struct sockaddr_in),
+					 NULL, 0, NULL, NULL), 0,
+		      "Cannot send request");
+}
+
+static void reset_counters(void)
+{
+	responses = 0;
+	handled = 0;
+	last_resource = NULL;
+
+	memset(observed, 0, sizeof(observed));
+	notifications = 0;
+}
+
+static void test_init(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr4;
+
+	zassert_equal(net_addr_pton(AF_INET, MY_IPV4_ADDR, &addr4), 0,
+		      "Invalid address");
+	zassert_not_null(net_if_ipv4_addr_add(iface, &addr4,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add IPv4 address");
+
+	server_addr.family = AF_INET;
+	net_ipaddr_copy(&net_sin(&server_addr)->sin_addr, &addr4);
+	net_sin(&server_addr)->sin_port = htons(SERVER_PORT);
+
+	client_addr.family = AF_INET;
+	net_ipaddr_copy(&net_sin(&client_addr)->sin_addr, &addr4);
+	net_sin(&client_addr)->sin_port = htons(CLIENT_PORT);
+
+	zassert_equal(net_context_get(AF_INET, SOCK_DGRAM, IPPROTO_UDP,
+				      &server_ctx), 0,
+		      "Cannot get server context");
+	zassert_equal(net_context_bind(server_ctx, &server_addr,
+				       sizeof(struct sockaddr_in)), 0,
+		      "Cannot bind server context");
+	zassert_equal(net_context_recv(server_ctx, server_recv, 0, NULL), 0,
+		      "Cannot receive on server context");
+
+	zassert_equal(net_context_get(AF_INET, SOCK_DGRAM, IPPROTO_UDP,
+				      &client_ctx), 0,
+		      "Cannot get client context");
+	zassert_equal(net_context_bind(client_ctx, &client_addr,
+				       sizeof(struct sockaddr_in)), 0,
+		      "Cannot bind client context");
+	zassert_equal(net_context_recv(client_ctx, client_recv, 0, NULL), 0,
+		      "Cannot receive on client context");
+
+	zassert_equal(zoap_server_init(&server, server_ctx, resources), 0,
+		      "Cannot init server");
+	zassert_equal(zoap_server_init(&sample_server, server_ctx,
+				       sample_resources), 0,
+		      "Cannot init sample server");
+}
+
+static void check_dispatch(const char * const *path,
+			   struct zoap_resource *resource)
+{
+	static u16_t id = 1;
+
+	reset_counters();
+
+	client_send(ZOAP_TYPE_NON_CON, ZOAP_METHOD_GET, id++, token_a, path);
+
+	if (!resource) {
+		zassert_equal(server_result, -ENOENT, "Resource found");
+		zassert_equal(handled, 0, "Method called");
+		return;
+	}
+
+	zassert_equal(server_result, 0, "Request failed");
+	zassert_equal_ptr(last_resource, resource, "Wrong resource");
+}
+
+static void test_dispatch(void)
+{
+	static const char * const unknown_path[] = { "unknown", NULL };
+	static const char * const prefix_path[] = { "seg1", "seg2", NULL };
+	static const char * const longer_path[] = {
+		"seg1", "seg2", "seg3", "seg4", NULL };
+	static const char * const partial_path[] = { "tes", NULL };
+
+	check_dispatch(test_path, &resources[0]);
+	check_dispatch(segments_path, &resources[1]);
+	check_dispatch(segment_path, &resources[2]);
+	check_dispatch(separate_path, &resources[3]);
+	check_dispatch(silent_path, &resources[4]);
+
+	check_dispatch(NULL, NULL);
+	check_dispatch(unknown_path, NULL);
+	check_dispatch(prefix_path, NULL);
+	check_dispatch(longer_path, NULL);
+	check_dispatch(partial_path, NULL);
+}
+
+/* A duplicated request is answered with the same response, without
+ * calling the method again.
+ */
+static void test_duplicate(void)
+{
+	u8_t first[sizeof(last.data)];
+	u16_t first_len;
+
+	reset_counters();
+
+	client_get(0x100, token_a, test_path);
+
+	zassert_equal(responses, 1, "No response");
+	zassert_equal(last.type, ZOAP_TYPE_ACK, "Response not piggybacked");
+	zassert_equal(last.id, 0x100, "Wrong response id");
+
+	memcpy(first, last.data, last.len);
+	first_len = last.len;
+
+	client_get(0x100, token_a, test_path);
+
+	zassert_equal(handled, 1, "Duplicate handled again");
+	zassert_equal(responses, 2, "Response not replayed");
+	zassert_equal(last.len, first_len, "Different response");
+	zassert_equal(memcmp(last.data, first, first_len), 0,
+		      "Different response");
+
+	/* Same message ID with another token, a new request */
+	client_get(0x100, token_b, test_path);
+
+	zassert_equal(handled, 2, "New request not handled");
+	zassert_equal(responses, 3, "No response");
+
+	/* The non-confirmable requests are deduplicated as well */
+	client_send(ZOAP_TYPE_NON_CON, ZOAP_METHOD_GET, 0x101, token_a,
+		    test_path);
+	client_send(ZOAP_TYPE_NON_CON, ZOAP_METHOD_GET, 0x101, token_a,
+		    test_path);
+
+	zassert_equal(handled, 3, "Duplicate handled again");
+	zassert_equal(responses, 5, "Response not replayed");
+}
+
+/* Without a response to replay, only the idempotent methods run
+ * again.
+ */
+static void test_duplicate_unanswered(void)
+{
+	reset_counters();
+
+	client_send(ZOAP_TYPE_CON, ZOAP_METHOD_POST, 0x110, token_a,
+		    silent_path);
+	client_send(ZOAP_TYPE_CON, ZOAP_METHOD_POST, 0x110, token_a,
+		    silent_path);
+
+	zassert_equal(handled, 1, "Duplicate POST handled again");
+	zassert_equal(server_result, -EALREADY, "Duplicate POST accepted");
+
+	client_get(0x111, token_a, silent_path);
+	client_get(0x111, token_a, silent_path);
+
+	zassert_equal(handled, 3, "Duplicate GET not handled");
+	zassert_equal(responses, 0, "Unexpected response");
+}
+
+/* Only the most recent requests are remembered */
+static void test_exchange_eviction(void)
+{
+	int i;
+
+	reset_counters();
+
+	for (i = 0; i <= CONFIG_ZOAP_SERVER_EXCHANGES; i++) {
+		client_get(0x120 + i, token_a, test_path);
+	}
+
+	zassert_equal(handled, CONFIG_ZOAP_SERVER_EXCHANGES + 1,
+		      "Requests not handled");
+
+	/* The first one has been forgotten */
+	client_get(0x120, token_a, test_path);
+
+	zassert_equal(handled, CONFIG_ZOAP_SERVER_EXCHANGES + 2,
+		      "Forgotten request not handled");
+
+	client_get(0x120 + CONFIG_ZOAP_SERVER_EXCHANGES, token_a, test_path);
+
+	zassert_equal(handled, CONFIG_ZOAP_SERVER_EXCHANGES + 2,
+		      "Duplicate handled again");
+}
+
+static void test_retransmit(void)
+{
+	u16_t con_id;
+
+	reset_counters();
+
+	client_get(0x130, token_a, separate_path);
+
+	zassert_equal(responses, 2, "Missing responses");
+	zassert_equal(last.type, ZOAP_TYPE_CON, "Response not confirmable");
+	zassert_equal(server.heap_len, 1, "Response not pending");
+
+	con_id = last.id;
+
+	k_sleep(FIRST_RETRANSMISSION);
+
+	zassert_equal(responses, 3, "Response not retransmitted");
+	zassert_equal(last.id, con_id, "Wrong retransmission");
+
+	client_ack(con_id);
+
+	zassert_equal(server.heap_len, 0, "Response still pending");
+
+	k_sleep(FIRST_RETRANSMISSION * 2);
+
+	zassert_equal(responses, 3, "Acknowledged response retransmitted");
+
+	/* The duplicated request gets the empty ACK again */
+	client_get(0x130, token_a, separate_path);
+
+	zassert_equal(handled, 1, "Duplicate handled again");
+	zassert_equal(responses, 4, "ACK not replayed");
+	zassert_equal(last.type, ZOAP_TYPE_ACK, "Wrong replay");
+	zassert_equal(last.code, ZOAP_CODE_EMPTY, "Wrong replay");
+	zassert_equal(server.heap_len, 0, "Unexpected retransmission");
+}
+
+/* The server retransmits every message from its single timer, and gives
+ * up after the last timeout.
+ */
+static void test_retransmit_give_up(void)
+{
+	int i;
+
+	reset_counters();
+
+	for (i = 0; i < CONFIG_ZOAP_SERVER_PENDINGS; i++) {
+		client_get(0x140 + i, token_a, separate_path);
+	}
+
+	zassert_equal(responses, 2 * CONFIG_ZOAP_SERVER_PENDINGS,
+		      "Missing responses");
+	zassert_equal(server.heap_len, CONFIG_ZOAP_SERVER_PENDINGS,
+		      "Responses not pending");
+
+	/* No slot left for another confirmable message */
+	client_get(0x140 + i, token_a, separate_path);
+
+	zassert_equal(server_result, -ENOMEM, "Pending slot available");
+
+	k_sleep(LAST_TIMEOUT);
+
+	zassert_equal(server.heap_len, 0, "Responses still pending");
+	zassert_equal(responses, 1 + 6 * CONFIG_ZOAP_SERVER_PENDINGS,
+		      "Wrong number of retransmissions");
+}
+
+static struct zoap_resource *observed_resource = &resources[5];
+
+static void test_observe_register(void)
+{
+	int i;
+
+	reset_counters();
+
+	for (i = 0; i < OBSERVERS; i++) {
+		client_observe(0x300 + i, i, 0);
+
+		zassert_equal(server_result, 0, "Observer not registered");
+	}
+
+	/* The same token and address refresh the observer */
+	client_observe(0x300 + i, 0, 0);
+
+	zassert_equal(server_result, 0, "Observer not refreshed");
+
+	client_observe(0x301 + i, OBSERVERS, 0);
+
+	zassert_equal(server_result, -ENOMEM, "Too many observers");
+
+	/* Deregistration frees the slot */
+	client_observe(0x302 + i, OBSERVERS - 1, 1);
+	client_observe(0x303 + i, OBSERVERS, 0);
+
+	zassert_equal(server_result, 0, "Observer not registered");
+
+	client_observe(0x304 + i, OBSERVERS, 1);
+	client_observe(0x305 + i, OBSERVERS - 1, 0);
+
+	zassert_equal(server_result, 0, "Observer not registered");
+	zassert_equal(handled, OBSERVERS + 6, "Requests not handled");
+	zassert_equal(notifications, 0, "Unexpected notification");
+}
+
+static void notify_state(const char *payload)
+{
+	zassert_equal(zoap_server_notify(&server, observed_resource, 0,
+					 payload, strlen(payload)), 0,
+		      "Cannot notify");
+}
+
+static void check_observers(const char *payload, int count)
+{
+	int i;
+
+	for (i = 0; i < OBSERVERS; i++) {
+		zassert_equal(observed[i].count, count,
+			      "Wrong number of notifications");
+		zassert_equal(observed[i].seq, observed_resource->age,
+			      "Wrong sequence number");
+		zassert_equal(strcmp(observed[i].payload, payload), 0,
+			      "Wrong payload");
+	}
+}
+
+/* The payload is shared by all the notifications, which are spread
+ * over several bursts.
+ */
+static void test_observe_fan_out(void)
+{
+	int i;
+
+	reset_counters();
+	auto_ack = true;
+
+	notify_state("state 1");
+
+	zassert_equal(notifications, 0, "Notification not deferred");
+
+	k_sleep(NOTIFY_TIME);
+
+	check_observers("state 1", 1);
+	zassert_equal(observed[OBSERVERS].count, 0, "Removed observer");
+
+	for (i = 0; i < OBSERVERS; i++) {
+		zassert_not_null(observed[i].shared, "Payload copied");
+		zassert_equal_ptr(observed[i].shared, observed[0].shared,
+				  "Payload not shared");
+	}
+
+	/* One tick of tolerance */
+	zassert_true(notify_last - notify_first >=
+		     CONFIG_ZOAP_SERVER_NOTIFY_INTERVAL *
+		     (NOTIFY_BURSTS - 1) - 10,
+		     "Notifications not paced");
+}
+
+/* An observer that did not get a state only gets the newer one */
+static void test_observe_coalesce(void)
+{
+	reset_counters();
+
+	notify_state("state 2");
+	notify_state("state 3");
+
+	k_sleep(NOTIFY_TIME);
+
+	check_observers("state 3", 1);
+}
+
+/* A single confirmable notification at a time to an endpoint, nothing
+ * else is sent to it until the ACK.
+ */
+static void test_observe_con(void)
+{
+	u16_t con_id;
+	int i, held;
+
+	reset_counters();
+
+	/* Until the notification that is confirmable */
+	for (i = 2; i < CONFIG_ZOAP_SERVER_NOTIFY_CON_INTERVAL; i++) {
+		notify_state("state 4");
+		k_sleep(NOTIFY_TIME);
+	}
+
+	reset_counters();
+	auto_ack = false;
+
+	notify_state("state 5");
+
+	/* Before the retransmission */
+	k_sleep(K_MSEC(CONFIG_ZOAP_SERVER_ACK_TIMEOUT / 2));
+
+	zassert_equal(notifications, 1, "Notifications not held");
+	zassert_equal(last.type, ZOAP_TYPE_CON, "Notification not confirmable");
+
+	con_id = last.id;
+
+	notify_state("state 6");
+
+	k_sleep(K_MSEC(10));
+
+	zassert_equal(notifications, 1, "Notifications not held");
+
+	auto_ack = true;
+	client_ack(con_id);
+
+	k_sleep(NOTIFY_TIME);
+
+	zassert_equal(server.heap_len, 0, "Notifications not acknowledged");
+
+	for (i = 0, held = 0; i < OBSERVERS; i++) {
+		zassert_equal(strcmp(observed[i].payload, "state 6"), 0,
+			      "Wrong payload");
+
+		if (observed[i].count == 1) {
+			held++;
+		}
+	}
+
+	zassert_equal(held, OBSERVERS - 1, "Notifications not coalesced");
+}
+
+/* A RESET to a notification removes the observer */
+static void test_observe_reset(void)
+{
+	reset_counters();
+
+	notify_state("state 7");
+	k_sleep(NOTIFY_TIME);
+
+	check_observers("state 7", 1);
+
+	client_send(ZOAP_TYPE_RESET, ZOAP_CODE_EMPTY,
+		    observed[OBSERVERS - 1].id, NULL, NULL);
+
+	reset_counters();
+
+	notify_state("state 8");
+	k_sleep(NOTIFY_TIME);
+
+	zassert_equal(notifications, OBSERVERS - 1, "Observer not removed");
+	zassert_equal(observed[OBSERVERS - 1].count, 0,
+		      "Observer not removed");
+}
+
+static void notification_send(int observer, const u8_t *payload, u16_t len)
+{
+	struct zoap_packet zpkt;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u8_t token[8] = { 'o', observer };
+	u16_t room;
+	u8_t *data;
+
+	pkt = net_pkt_get_tx(server_ctx, K_FOREVER);
+	frag = net_pkt_get_data(server_ctx, K_FOREVER);
+	net_pkt_frag_add(pkt, frag);
+
+	zassert_equal(zoap_packet_init(&zpkt, pkt), 0, "Cannot init");
+
+	zoap_header_set_version(&zpkt, 1);
+	zoap_header_set_type(&zpkt, ZOAP_TYPE_NON_CON);
+	zoap_header_set_code(&zpkt, ZOAP_RESPONSE_CODE_CONTENT);
+	zoap_header_set_id(&zpkt, zoap_next_id());
+	zoap_header_set_token(&zpkt, token, sizeof(token));
+
+	zoap_add_option_int(&zpkt, ZOAP_OPTION_OBSERVE, observed_resource->age);
+	zoap_add_option_int(&zpkt, ZOAP_OPTION_CONTENT_FORMAT, 0);
+
+	data = zoap_packet_get_payload(&zpkt, &room);
+	zassert_true(data && room >= len, "No room for payload");
+
+	memcpy(data, payload, len);
+	zoap_packet_set_used(&zpkt, len);
+
+	zoap_server_send(&server, &zpkt, &client_addr);
+}
+
+/* Runs the notification work from the test thread, without the pacing,
+ * to measure its cost.
+ */
+static void notify_flush(int expected)
+{
+	int i;
+
+	for (i = 0; i < OBSERVERS && notifications < expected; i++) {
+		k_delayed_work_cancel(&server.notify);
+		server.notify_armed = false;
+		server.notify_next = 0;
+
+		server.notify.work.handler(&server.notify.work);
+	}
+
+	k_delayed_work_cancel(&server.notify);
+	server.notify_armed = false;
+}
+
+/* Not a pass/fail test, compares the cost of a notification to all the
+ * observers, each one with its own copy of the payload as
+ * samples/net/zoap_server used to do, and with the shared payload of
+ * zoap_server_notify().
+ */
+static void test_notify_rate(void)
+{
+	u8_t payload[64];
+	u32_t start, cycles_copy, cycles_shared;
+	int i, j, count = 0;
+
+	memset(payload, 'x', sizeof(payload));
+
+	reset_counters();
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < NOTIFY_ROUNDS; i++) {
+		for (j = 0; j < OBSERVERS; j++) {
+			if (!server.observers[j].resource) {
+				continue;
+			}
+
+			notification_send(server.observers[j].observer.token[1],
+					  payload, sizeof(payload));
+			count++;
+		}
+	}
+
+	cycles_copy = k_cycle_get_32() - start;
+
+	zassert_equal(notifications, count, "Missing notifications");
+
+	reset_counters();
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < NOTIFY_ROUNDS; i++) {
+		zassert_equal(zoap_server_notify(&server, observed_resource, 0,
+						 payload, sizeof(payload)), 0,
+			      "Cannot notify");
+		notify_flush(count / NOTIFY_ROUNDS * (i + 1));
+	}
+
+	cycles_shared = k_cycle_get_32() - start;
+
+	zassert_equal(notifications, count, "Missing notifications");
+
+	printk("%d notifications of %d bytes: %u cycles per notification "
+	       "with a copy of the payload, %u cycles per notification "
+	       "with a shared payload\n", count, (int)sizeof(payload),
+	       cycles_copy / count, cycles_shared / count);
+}
+
+/* Not a pass/fail test, compares the cost of the dispatch of a request
+ * through the server with zoap_handle_request(), with the resources of
+ * samples/net/zoap_server, then measures the rate of requests answered
+ * through the IP stack.
+ */
+static void test_request_rate(void)
+{
+	u32_t start, cycles_linear, cycles_server, cycles_loopback;
+	struct zoap_packet request;
+	int i;
+
+	request_init(&request, ZOAP_TYPE_NON_CON, ZOAP_METHOD_GET, 0,
+		     token_a, core_2_path);
+
+	reset_counters();
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		zoap_handle_request(&request, sample_resources, &client_addr);
+	}
+
+	cycles_linear = k_cycle_get_32() - start;
+
+	zassert_equal_ptr(last_resource, &sample_resources[11],
+			  "Wrong resource");
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		zoap_header_set_id(&request, i);
+		zoap_server_handle(&sample_server, &request, &client_addr);
+	}
+
+	cycles_server = k_cycle_get_32() - start;
+
+	zassert_equal(handled, 2 * REQUEST_COUNT, "Requests not handled");
+
+	net_pkt_unref(request.pkt);
+
+	reset_counters();
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < REQUEST_COUNT; i++) {
+		client_get(0x200 + i, token_a, segments_path);
+	}
+
+	cycles_loopback = k_cycle_get_32() - start;
+
+	zassert_equal(responses, REQUEST_COUNT, "Missing responses");
+
+	printk("%d requests, dispatch: %u cycles per request with "
+	       "zoap_handle_request(), %u cycles per request with "
+	       "zoap_server_handle()\n", REQUEST_COUNT,
+	       cycles_linear / REQUEST_COUNT, cycles_server / REQUEST_COUNT);
+	printk("%u cycles per request answered through the IP stack\n",
+	       cycles_loopback / REQUEST_COUNT);
+}
+
+static void test_release(void)
+{
+	zoap_server_release(&server);
+	zoap_server_release(&sample_server);
+
+	net_context_put(client_ctx);
+	net_context_put(server_ctx);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(zoap_server_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_dispatch),
+			 ztest_unit_test(test_duplicate),
+			 ztest_unit_test(test_duplicate_unanswered),
+			 ztest_unit_test(test_exchange_eviction),
+			 ztest_unit_test(test_retransmit),
+			 ztest_unit_test(test_retransmit_give_up),
+			 ztest_unit_test(test_observe_register),
+			 ztest_unit_test(test_observe_fan_out),
+			 ztest_unit_test(test_observe_coalesce),
+			 ztest_unit_test(test_observe_con),
+			 ztest_unit_test(test_observe_reset),
+			 ztest_unit_test(test_notify_rate),
+			 ztest_unit_test(test_request_rate),
+			 ztest_unit_test(test_release));
+
+	ztest_run_test_suite(zoap_server_tests);
+}
@@ -1072,6 +1072,288 @@ static void test_fragment_split(void)
 		      "Frag B data mismatch");
 }
 
+/* IPv6 + UDP + CoAP confirmable GET /sensors/temp with a two byte token
+ * and a small payload.
+ */
+static const u8_t coap_msg[] = {
+	0x60, 0x00, 0x00, 0x00, 0x00, 0x21, 0x11, 0x40,
+	0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+	/* UDP */
+	0xc3, 0x50, 0x16, 0x33, 0x00, 0x21, 0x00, 0x00,
+	/* CoAP header, message id 0x1234, token 0xbeef */
+	0x42, 0x01, 0x12, 0x34, 0xbe, 0xef,
+	/* Uri-Path "sensors", Uri-Path "temp" */
+	0xb7, 's', 'e', 'n', 's', 'o', 'r', 's',
+	0x04, 't', 'e', 'm', 'p',
+	/* Payload */
+	0xff, 'h', 'e', 'l', 'l', 'o',
+};
+
+#define COAP_HDR_OFFSET (sizeof(struct ipv6_hdr) + sizeof(struct udp_hdr))
+#define COAP_PAYLOAD_LEN 5
+#define PARSE_ROUNDS 100
+
+struct coap_parsed {
+	u16_t dst_port;
+	u16_t id;
+	u8_t code;
+	u8_t options;
+	u16_t payload_len;
+};
+
+static struct net_pkt *create_frag_pkt(const u8_t *data, u16_t len,
+				       int count)
+{
+	u16_t chunk = (len + count - 1) / count;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+
+	while (len) {
+		u16_t copy = min(chunk, len);
+
+		frag = net_pkt_get_reserve_rx_data(0, K_FOREVER);
+		memcpy(net_buf_add(frag, copy), data, copy);
+		net_pkt_frag_add(pkt, frag);
+
+		data += copy;
+		len -= copy;
+	}
+
+	return pkt;
+}
+
+static int parse_with_cursor(struct net_pkt *pkt, struct coap_parsed *out)
+{
+	struct net_pkt_cursor cursor;
+	u8_t nexthdr, first, opt;
+
+	memset(out, 0, sizeof(*out));
+
+	net_pkt_cursor_init(&cursor, pkt);
+
+	if (net_pkt_cursor_skip(&cursor, 6) ||
+	    net_pkt_cursor_read_u8(&cursor, &nexthdr) ||
+	    nexthdr != IPPROTO_UDP ||
+	    net_pkt_cursor_skip(&cursor, 1 + 2 * sizeof(struct in6_addr)) ||
+	    net_pkt_cursor_skip(&cursor, 2) ||
+	    net_pkt_cursor_read_be16(&cursor, &out->dst_port) ||
+	    net_pkt_cursor_skip(&cursor, 4) ||
+	    net_pkt_cursor_read_u8(&cursor, &first) ||
+	    net_pkt_cursor_read_u8(&cursor, &out->code) ||
+	    net_pkt_cursor_read_be16(&cursor, &out->id) ||
+	    net_pkt_cursor_skip(&cursor, first & 0x0f)) {
+		return -EINVAL;
+	}
+
+	while (!net_pkt_cursor_read_u8(&cursor, &opt)) {
+		if (opt == 0xff) {
+			out->payload_len = net_pkt_get_len(pkt) -
+				cursor.offset;
+			return 0;
+		}
+
+		if (net_pkt_cursor_skip(&cursor, opt & 0x0f)) {
+			return -EINVAL;
+		}
+
+		out->options++;
+	}
+
+	return 0;
+}
+
+/* The same parser written the way the offset based accessors are
+ * typically used: every field is read from the start of the packet.
+ */
+static int read_at(struct net_pkt *pkt, u16_t offset, void *data, u16_t len)
+{
+	struct net_buf *frag;
+	u16_t pos;
+
+	frag = net_frag_read(pkt->frags, offset, &pos, len, data);
+	if (!frag && pos == 0xffff) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int parse_with_offsets(struct net_pkt *pkt, struct coap_parsed *out)
+{
+	u16_t offset = COAP_HDR_OFFSET;
+	u8_t nexthdr, first, opt;
+	u8_t be[2];
+
+	memset(out, 0, sizeof(*out));
+
+	if (read_at(pkt, 6, &nexthdr, 1) || nexthdr != IPPROTO_UDP ||
+	    read_at(pkt, sizeof(struct ipv6_hdr) + 2, be, 2)) {
+		return -EINVAL;
+	}
+
+	out->dst_port = be[0] << 8 | be[1];
+
+	if (read_at(pkt, offset, &first, 1) ||
+	    read_at(pkt, offset + 1, &out->code, 1) ||
+	    read_at(pkt, offset + 2, be, 2)) {
+		return -EINVAL;
+	}
+
+	out->id = be[0] << 8 | be[1];
+	offset += 4 + (first & 0x0f);
+
+	while (!read_at(pkt, offset++, &opt, 1)) {
+		if (opt == 0xff) {
+			out->payload_len = net_pkt_get_len(pkt) - offset;
+			return 0;
+		}
+
+		offset += opt & 0x0f;
+		out->options++;
+	}
+
+	return 0;
+}
+
+static void check_parsed(struct coap_parsed *parsed)
+{
+	zassert_equal(parsed->dst_port, 5683, "Wrong port");
+	zassert_equal(parsed->code, 0x01, "Wrong code");
+	zassert_equal(parsed->id, 0x1234, "Wrong message id");
+	zassert_equal(parsed->options, 2, "Wrong option count");
+	zassert_equal(parsed->payload_len, COAP_PAYLOAD_LEN,
+		      "Wrong payload length");
+}
+
+static void test_pkt_cursor(void)
+{
+	struct net_pkt_cursor cursor, tmp;
+	u8_t data[sizeof(coap_msg)];
+	struct net_pkt *pkt;
+	u32_t be32;
+	u8_t u8;
+
+	/* 8 bytes in each fragment so that fields straddle fragments */
+	pkt = create_frag_pkt(coap_msg, sizeof(coap_msg), 10);
+	zassert_equal(pkt->frags->len, 8, "Unexpected fragment size");
+
+	net_pkt_cursor_init(&cursor, pkt);
+	zassert_equal_ptr(cursor.frag, pkt->frags, "Wrong start fragment");
+	zassert_equal(cursor.offset, 0, "Wrong start offset");
+
+	/* Read over a fragment boundary */
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, 7), 0, "Seek failed");
+	zassert_equal(net_pkt_cursor_read_be32(&cursor, &be32), 0,
+		      "Read failed");
+	zassert_equal(be32, 0x4020010d, "Wrong value");
+	zassert_equal(cursor.offset, 11, "Wrong offset");
+	zassert_equal_ptr(cursor.frag, pkt->frags->frags, "Wrong fragment");
+	zassert_equal(cursor.pos, 3, "Wrong position");
+
+	/* Ending exactly at a fragment boundary moves to the next one */
+	zassert_equal(net_pkt_cursor_read_be32(&cursor, &be32), 0,
+		      "Read failed");
+	zassert_equal(be32, 0xb8000000, "Wrong value");
+	zassert_equal(net_pkt_cursor_skip(&cursor, 1), 0, "Skip failed");
+	zassert_equal(cursor.offset, 16, "Wrong offset");
+	zassert_equal_ptr(cursor.frag, pkt->frags->frags->frags,
+			  "Wrong fragment");
+	zassert_equal(cursor.pos, 0, "Wrong position");
+
+	/* Peek does not move the cursor */
+	tmp = cursor;
+	zassert_equal(net_pkt_cursor_peek(&cursor, data, 3), 0,
+		      "Peek failed");
+	zassert_true(!memcmp(&cursor, &tmp, sizeof(cursor)),
+		     "Peek moved cursor");
+
+	/* Seek backwards and read the whole packet */
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, 0), 0, "Seek failed");
+	zassert_equal(net_pkt_cursor_read(&cursor, data, sizeof(data)), 0,
+		      "Read failed");
+	zassert_true(!memcmp(data, coap_msg, sizeof(data)), "Data mismatch");
+	zassert_is_null(cursor.frag, "Cursor not at end");
+	zassert_equal(net_pkt_cursor_read_u8(&cursor, &u8), -ENODATA,
+		      "Read past end");
+
+	/* A failing read leaves the cursor where it was */
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, sizeof(data) - 2), 0,
+		      "Seek failed");
+	tmp = cursor;
+	zassert_equal(net_pkt_cursor_read_be32(&cursor, &be32), -ENODATA,
+		      "Read past end");
+	zassert_true(!memcmp(&cursor, &tmp, sizeof(cursor)),
+		     "Failed read moved cursor");
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, sizeof(data) + 1),
+		      -ENODATA, "Seek past end");
+
+	/* Overwrite the UDP checksum and the start of the CoAP header,
+	 * which live in two different fragments.
+	 */
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, COAP_HDR_OFFSET - 2),
+		      0, "Seek failed");
+	zassert_equal(net_pkt_cursor_write_be32(&cursor, 0xabcd1234), 0,
+		      "Write failed");
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, COAP_HDR_OFFSET - 2),
+		      0, "Seek failed");
+	zassert_equal(net_pkt_cursor_read_be32(&cursor, &be32), 0,
+		      "Read failed");
+	zassert_equal(be32, 0xabcd1234, "Write not visible");
+
+	/* Writes never extend the packet */
+	zassert_equal(net_pkt_cursor_seek(&cursor, pkt, sizeof(data) - 1), 0,
+		      "Seek failed");
+	zassert_equal(net_pkt_cursor_write_be16(&cursor, 0), -ENODATA,
+		      "Write past end");
+
+	net_pkt_unref(pkt);
+}
+
+static void bench_parse(int frag_count)
+{
+	struct coap_parsed parsed;
+	u32_t start, cursor_cycles, offset_cycles;
+	struct net_pkt *pkt;
+	int i;
+
+	pkt = create_frag_pkt(coap_msg, sizeof(coap_msg), frag_count);
+
+	zassert_equal(parse_with_cursor(pkt, &parsed), 0, "Parse failed");
+	check_parsed(&parsed);
+
+	zassert_equal(parse_with_offsets(pkt, &parsed), 0, "Parse failed");
+	check_parsed(&parsed);
+
+	start = k_cycle_get_32();
+	for (i = 0; i < PARSE_ROUNDS; i++) {
+		parse_with_cursor(pkt, &parsed);
+	}
+	cursor_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (i = 0; i < PARSE_ROUNDS; i++) {
+		parse_with_offsets(pkt, &parsed);
+	}
+	offset_cycles = k_cycle_get_32() - start;
+
+	printk("IPv6/UDP/CoAP parse, %d fragment(s): cursor %u cycles, "
+	       "offsets %u cycles\n", frag_count,
+	       cursor_cycles / PARSE_ROUNDS, offset_cycles / PARSE_ROUNDS);
+
+	net_pkt_unref(pkt);
+}
+
+static void test_pkt_cursor_bench(void)
+{
+	bench_parse(1);
+	bench_parse(10);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(net_pkt_tests,
@@ -1080,7 +1362,9 @@ void test_main(void)
 			 ztest_unit_test(test_pkt_read_append),
 			 ztest_unit_test(test_pkt_read_write_insert),
 			 ztest_unit_test(test_fragment_compact),
-			 ztest_unit_test(test_fragment_split)
+			 ztest_unit_test(test_fragment_split),
+			 ztest_unit_test(test_pkt_cursor),
+			 ztest_unit_test(test_pkt_cursor_bench)
 			 );
 
 	ztest_run_test_suite(net_pkt_tests);
@@ -0,0 +1,185 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#include <net/buf.h>
+#include <net/net_pkt.h>
+
+#define SMALL_SIZE CONFIG_NET_BUF_SMALL_DATA_SIZE
+#define NORMAL_SIZE CONFIG_NET_BUF_DATA_SIZE
+#define LARGE_SIZE CONFIG_NET_BUF_LARGE_DATA_SIZE
+
+static u8_t frame[1400];
+
+static struct net_buf_pool *pools[8];
+static int pool_count;
+
+static void pool_cb(struct net_buf_pool *pool, void *user_data)
+{
+	if (pool_count < ARRAY_SIZE(pools)) {
+		pools[pool_count++] = pool;
+	}
+}
+
+static void test_size_classes(void)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+	zassert_not_null(pkt, "No RX packet");
+
+	/* A TCP ACK sized fragment comes from the small class */
+	frag = net_pkt_get_frag_len(pkt, 60, K_NO_WAIT);
+	zassert_not_null(frag, "No small fragment");
+	zassert_equal(frag->size, SMALL_SIZE, "Not a small fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	frag = net_pkt_get_frag_len(pkt, SMALL_SIZE + 1, K_NO_WAIT);
+	zassert_not_null(frag, "No normal fragment");
+	zassert_equal(frag->size, NORMAL_SIZE, "Not a normal fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	/* A full Ethernet frame fits into one large fragment */
+	frag = net_pkt_get_frag_len(pkt, 1514, K_NO_WAIT);
+	zassert_not_null(frag, "No large fragment");
+	zassert_equal(frag->size, LARGE_SIZE, "Not a large fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	/* Bigger than any class gets the biggest one */
+	frag = net_pkt_get_frag_len(pkt, 2000, K_NO_WAIT);
+	zassert_not_null(frag, "No large fragment");
+	zassert_equal(frag->size, LARGE_SIZE, "Not a large fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	/* The unsized variant keeps using the normal class */
+	frag = net_pkt_get_frag(pkt, K_NO_WAIT);
+	zassert_not_null(frag, "No fragment");
+	zassert_equal(frag->size, NORMAL_SIZE, "Not a normal fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	net_pkt_unref(pkt);
+}
+
+static void test_size_class_fallback(void)
+{
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	int i;
+
+	pkt = net_pkt_get_reserve_tx(0, K_FOREVER);
+	zassert_not_null(pkt, "No TX packet");
+
+	for (i = 0; i < CONFIG_NET_BUF_TX_SMALL_COUNT; i++) {
+		frag = net_pkt_get_frag_len(pkt, 10, K_NO_WAIT);
+		zassert_not_null(frag, "No small fragment");
+		zassert_equal(frag->size, SMALL_SIZE, "Not a small fragment");
+		net_pkt_frag_add(pkt, frag);
+	}
+
+	/* Small class is exhausted, a bigger fragment is used instead of
+	 * failing.
+	 */
+	frag = net_pkt_get_frag_len(pkt, 10, K_NO_WAIT);
+	zassert_not_null(frag, "No fallback fragment");
+	zassert_equal(frag->size, NORMAL_SIZE, "Not a normal fragment");
+	net_pkt_frag_add(pkt, frag);
+
+	/* Large class is the last one so there is nothing to fall back to */
+	for (i = 0; i < CONFIG_NET_BUF_TX_LARGE_COUNT; i++) {
+		frag = net_pkt_get_frag_len(pkt, 1000, K_NO_WAIT);
+		zassert_not_null(frag, "No large fragment");
+		net_pkt_frag_add(pkt, frag);
+	}
+
+	frag = net_pkt_get_frag_len(pkt, 1000, K_NO_WAIT);
+	zassert_is_null(frag, "Large class not exhausted");
+
+	net_pkt_unref(pkt);
+}
+
+static void test_append_sized(void)
+{
+	struct net_pkt *pkt;
+	int i;
+
+	for (i = 0; i < sizeof(frame); i++) {
+		frame[i] = i;
+	}
+
+	pkt = net_pkt_get_reserve_tx(0, K_FOREVER);
+	zassert_not_null(pkt, "No TX packet");
+
+	zassert_true(net_pkt_append_all(pkt, sizeof(frame), frame, K_FOREVER),
+		     "Append failed");
+
+	/* Without size classes this would be a chain of 11 fragments */
+	zassert_not_null(pkt->frags, "No fragments");
+	zassert_is_null(pkt->frags->frags, "Data not in one fragment");
+	zassert_equal(pkt->frags->len, sizeof(frame), "Wrong length");
+	zassert_true(!memcmp(pkt->frags->data, frame, sizeof(frame)),
+		     "Data mismatch");
+
+	net_pkt_unref(pkt);
+
+	/* Short data stays in a small fragment */
+	pkt = net_pkt_get_reserve_tx(0, K_FOREVER);
+	zassert_true(net_pkt_append_all(pkt, 20, frame, K_FOREVER),
+		     "Append failed");
+	zassert_equal(pkt->frags->size, SMALL_SIZE, "Not a small fragment");
+
+	net_pkt_unref(pkt);
+}
+
+static void test_pool_usage(void)
+{
+	int i;
+
+	net_pkt_data_pool_foreach(pool_cb, NULL);
+
+	/* Small, normal and large for both RX and TX */
+	zassert_equal(pool_count, 6, "Wrong number of data pools");
+
+	for (i = 0; i < pool_count; i++) {
+		printk("%s: frag %u count %u avail %d peak %d\n",
+		       pools[i]->name, pools[i]->buf_size,
+		       pools[i]->buf_count, pools[i]->avail_count,
+		       pools[i]->buf_count - pools[i]->min_avail_count);
+
+		zassert_equal(pools[i]->avail_count, pools[i]->buf_count,
+			      "Fragments leaked");
+		zassert_true(i == 0 || pools[i]->buf_size >
+			     pools[i - 1]->buf_size || i == pool_count / 2,
+			     "Classes not sorted");
+	}
+
+	/* Earlier tests used every large TX fragment at the same time */
+	zassert_equal(pools[5]->buf_size, LARGE_SIZE, "Not the large class");
+	zassert_equal(pools[5]->min_avail_count, 0, "Peak usage not tracked");
+
+	/* but never more than two normal RX fragments */
+	zassert_equal(pools[1]->buf_count - pools[1]->min_avail_count, 2,
+		      "Wrong peak usage");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_pkt_size_class_test,
+			 ztest_unit_test(test_size_classes),
+			 ztest_unit_test(test_size_class_fallback),
+			 ztest_unit_test(test_append_sized),
+			 ztest_unit_test(test_pool_usage));
+
+	ztest_run_test_suite(net_pkt_size_class_test);
+}
@@ -0,0 +1,306 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <linker/sections.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+#include "ipv6.h"
+#include "nbr.h"
+#include "route.h"
+
+#define BENCH_ROUTES 512
+#define BENCH_ROUNDS 4
+
+static struct net_if *iface;
+
+static struct in6_addr nexthop_addr = { { { 0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+					    0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+static u8_t nexthop_mac[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x02 };
+
+static struct net_linkaddr nexthop_lladdr = {
+	.addr = nexthop_mac,
+	.len = sizeof(nexthop_mac),
+};
+
+static struct net_route_entry *bench_routes[BENCH_ROUTES];
+static struct in6_addr bench_dst[BENCH_ROUTES];
+
+struct net_route_lpm_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_route_lpm_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_route_lpm_iface_init(struct net_if *iface)
+{
+	struct net_route_lpm_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr,
+			     sizeof(struct net_eth_addr), NET_LINK_ETHERNET);
+}
+
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_route_lpm_test net_route_lpm_data;
+
+static struct net_if_api net_route_lpm_if_api = {
+	.init = net_route_lpm_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT(net_route_lpm_test, "net_route_lpm_test",
+		net_route_lpm_dev_init, &net_route_lpm_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_route_lpm_if_api, DUMMY_L2,
+		NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static struct net_route_entry *add_route(u16_t a0, u16_t a1, u16_t a2,
+					 u16_t a3, u16_t a7, u8_t len)
+{
+	struct in6_addr addr;
+
+	net_ipv6_addr_create(&addr, a0, a1, a2, a3, 0, 0, 0, a7);
+
+	return net_route_add(iface, &addr, len, &nexthop_addr);
+}
+
+static struct net_route_entry *lookup(u16_t a0, u16_t a1, u16_t a2,
+				      u16_t a3, u16_t a7)
+{
+	struct in6_addr addr;
+
+	net_ipv6_addr_create(&addr, a0, a1, a2, a3, 0, 0, 0, a7);
+
+	return net_route_lookup(iface, &addr);
+}
+
+static void test_setup(void)
+{
+	iface = net_if_get_default();
+	zassert_not_null(iface, "No interface");
+
+	zassert_not_null(net_ipv6_nbr_add(iface, &nexthop_addr,
+					  &nexthop_lladdr, false,
+					  NET_IPV6_NBR_STATE_REACHABLE),
+			 "Cannot add nexthop neighbor");
+}
+
+static void test_longest_prefix(void)
+{
+	struct net_route_entry *r32, *r48, *r64, *r128;
+
+	r32 = add_route(0x2001, 0xdb8, 0, 0, 0, 32);
+	r48 = add_route(0x2001, 0xdb8, 1, 0, 0, 48);
+	r64 = add_route(0x2001, 0xdb8, 1, 2, 0, 64);
+	r128 = add_route(0x2001, 0xdb8, 1, 2, 5, 128);
+
+	zassert_not_null(r32, "Cannot add /32");
+	zassert_not_null(r48, "Cannot add /48");
+	zassert_not_null(r64, "Cannot add /64");
+	zassert_not_null(r128, "Cannot add /128");
+
+	/* A more specific route must not replace the covering one */
+	zassert_true(r32 != r48 && r48 != r64 && r64 != r128,
+		     "Routes were merged");
+
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 2, 5), r128, "Not /128");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 2, 6), r64, "Not /64");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 3, 1), r48, "Not /48");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 2, 0, 1), r32, "Not /32");
+	zassert_is_null(lookup(0x2001, 0xdb9, 0, 0, 1), "Unexpected match");
+
+	/* Adding the same prefix again gives the existing route */
+	zassert_equal_ptr(add_route(0x2001, 0xdb8, 1, 0, 0, 48), r48,
+			  "Route duplicated");
+
+	/* The last lookup is cached, make sure deleting the route
+	 * invalidates it.
+	 */
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 2, 6), r64, "Not /64");
+	zassert_equal(net_route_del(r64), 0, "Cannot delete /64");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 2, 6), r48, "Not /48");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 2, 5), r128, "Not /128");
+
+	/* Deleting the covering route keeps the more specific ones */
+	zassert_equal(net_route_del(r32), 0, "Cannot delete /32");
+	zassert_is_null(lookup(0x2001, 0xdb8, 2, 0, 1), "Unexpected match");
+	zassert_equal_ptr(lookup(0x2001, 0xdb8, 1, 3, 1), r48, "Not /48");
+
+	/* Interface filter */
+	zassert_equal_ptr(net_route_lookup(NULL, &r48->addr), r48,
+			  "Not found without interface");
+
+	zassert_equal(net_route_del(r48), 0, "Cannot delete /48");
+	zassert_equal(net_route_del(r128), 0, "Cannot delete /128");
+	zassert_is_null(lookup(0x2001, 0xdb8, 1, 2, 5), "Unexpected match");
+}
+
+static void test_mcast(void)
+{
+#if defined(CONFIG_NET_ROUTE_MCAST)
+	struct net_route_entry_mcast *g1, *g2;
+	struct in6_addr group;
+
+	net_ipv6_addr_create(&group, 0xff3e, 0, 0, 0, 0, 0, 0, 1);
+	g1 = net_route_mcast_add(iface, &group);
+	zassert_not_null(g1, "Cannot add group 1");
+
+	zassert_equal_ptr(net_route_mcast_add(iface, &group), g1,
+			  "Group duplicated");
+
+	net_ipv6_addr_create(&group, 0xff3e, 0, 0, 0, 0, 0, 0, 2);
+	g2 = net_route_mcast_add(iface, &group);
+	zassert_not_null(g2, "Cannot add group 2");
+
+	zassert_equal_ptr(net_route_mcast_lookup(&g1->group), g1,
+			  "Group 1 not found");
+	zassert_equal_ptr(net_route_mcast_lookup(&g2->group), g2,
+			  "Group 2 not found");
+
+	net_ipv6_addr_create(&group, 0xff3e, 0, 0, 0, 0, 0, 0, 3);
+	zassert_is_null(net_route_mcast_lookup(&group), "Unexpected group");
+
+	zassert_true(net_route_mcast_del(g2), "Cannot delete group 2");
+	zassert_is_null(net_route_mcast_lookup(&g2->group),
+			"Group 2 still found");
+	zassert_equal_ptr(net_route_mcast_lookup(&g1->group), g1,
+			  "Group 1 not found");
+
+	zassert_true(net_route_mcast_del(g1), "Cannot delete group 1");
+	zassert_is_null(net_route_mcast_lookup(&g1->group),
+			"Group 1 still found");
+#endif
+}
+
+/* The lookup as it was done before the trie, for comparison */
+static struct net_route_entry *linear_lookup(struct in6_addr *dst)
+{
+	struct net_route_entry *found = NULL;
+	u8_t longest_match = 0;
+	int i;
+
+	for (i = 0; i < BENCH_ROUTES; i++) {
+		struct net_route_entry *route = bench_routes[i];
+
+		if (route->iface != iface) {
+			continue;
+		}
+
+		if (route->prefix_len >= longest_match &&
+		    net_is_ipv6_prefix((u8_t *)dst, (u8_t *)&route->addr,
+				       route->prefix_len)) {
+			found = route;
+			longest_match = route->prefix_len;
+		}
+	}
+
+	return found;
+}
+
+static void test_bench(void)
+{
+	u32_t start, trie_cycles, cached_cycles, linear_cycles;
+	int i, j;
+
+	/* Downward routes of a border router: one /64 per node */
+	for (i = 0; i < BENCH_ROUTES; i++) {
+		bench_routes[i] = add_route(0x2001, 0xdb8, i / 64, i,
+					    0, 64);
+		zassert_not_null(bench_routes[i], "Cannot add route");
+
+		net_ipv6_addr_create(&bench_dst[i], 0x2001, 0xdb8, i / 64, i,
+				     0, 0, 0, i + 1);
+	}
+
+	for (i = 0; i < BENCH_ROUTES; i++) {
+		zassert_equal_ptr(net_route_lookup(iface, &bench_dst[i]),
+				  bench_routes[i], "Wrong route");
+		zassert_equal_ptr(linear_lookup(&bench_dst[i]),
+				  bench_routes[i], "Wrong linear route");
+	}
+
+	start = k_cycle_get_32();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < BENCH_ROUTES; i++) {
+			net_route_lookup(iface, &bench_dst[i]);
+		}
+	}
+	trie_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < BENCH_ROUTES; i++) {
+			net_route_lookup(iface, &bench_dst[0]);
+		}
+	}
+	cached_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < BENCH_ROUTES; i++) {
+			linear_lookup(&bench_dst[i]);
+		}
+	}
+	linear_cycles = k_cycle_get_32() - start;
+
+	printk("Route lookup with %d routes: trie %u, cached %u, "
+	       "linear %u cycles\n", BENCH_ROUTES,
+	       trie_cycles / (BENCH_ROUNDS * BENCH_ROUTES),
+	       cached_cycles / (BENCH_ROUNDS * BENCH_ROUTES),
+	       linear_cycles / (BENCH_ROUNDS * BENCH_ROUTES));
+
+	for (i = 0; i < BENCH_ROUTES; i++) {
+		zassert_equal(net_route_del(bench_routes[i]), 0,
+			      "Cannot delete route");
+	}
+
+	zassert_is_null(net_route_lookup(iface, &bench_dst[0]),
+			"Route not deleted");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_route_lpm_test,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_longest_prefix),
+			 ztest_unit_test(test_mcast),
+			 ztest_unit_test(test_bench));
+
+	ztest_run_test_suite(net_route_lpm_test);
+}
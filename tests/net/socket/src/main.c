@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/socket.h>
+
+#define MY_IPV4_ADDR "192.0.2.1"
+#define MY_IPV6_ADDR "2001:db8::1"
+
+#define SERVER_PORT 4242
+#define CLIENT_PORT 4243
+
+#define ECHO_COUNT 100
+
+static const char test_data[] = "Test data to be sent";
+
+struct net_if_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+/* All the traffic of the test is sent to our own addresses, so it is
+ * looped back by the IP stack and never reaches the driver.
+ */
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct net_if_test net_iface_data;
+
+static struct net_if_api net_iface_api = {
+	.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_socket_test, "net_socket_test",
+		net_iface_dev_init, &net_iface_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_iface_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static void prepare_addr(sa_family_t family, struct sockaddr *addr,
+			 u16_t port)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->family = family;
+
+	if (family == AF_INET6) {
+		zassert_equal(inet_pton(AF_INET6, MY_IPV6_ADDR,
+					&net_sin6(addr)->sin6_addr), 1,
+			      "inet_pton failed");
+		net_sin6(addr)->sin6_port = htons(port);
+	} else {
+		zassert_equal(inet_pton(AF_INET, MY_IPV4_ADDR,
+					&net_sin(addr)->sin_addr), 1,
+			      "inet_pton failed");
+		net_sin(addr)->sin_port = htons(port);
+	}
+}
+
+static socklen_t addr_len(sa_family_t family)
+{
+	return family == AF_INET6 ? sizeof(struct sockaddr_in6) :
+		sizeof(struct sockaddr_in);
+}
+
+static void udp_pair(sa_family_t family, int *server, int *client,
+		     struct sockaddr *server_addr)
+{
+	struct sockaddr client_addr;
+
+	prepare_addr(family, server_addr, SERVER_PORT);
+	prepare_addr(family, &client_addr, CLIENT_PORT);
+
+	*server = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(*server >= 0, "Cannot create server socket");
+
+	*client = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(*client >= 0, "Cannot create client socket");
+
+	zassert_equal(bind(*server, server_addr, addr_len(family)), 0,
+		      "Cannot bind server socket");
+	zassert_equal(bind(*client, &client_addr, addr_len(family)), 0,
+		      "Cannot bind client socket");
+}
+
+static void test_init(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in6_addr addr6;
+	struct in_addr addr4;
+
+	zassert_equal(inet_pton(AF_INET6, MY_IPV6_ADDR, &addr6), 1,
+		      "inet_pton failed");
+	zassert_equal(inet_pton(AF_INET, MY_IPV4_ADDR, &addr4), 1,
+		      "inet_pton failed");
+	zassert_equal(inet_pton(AF_INET, "192.0.2", &addr4), 0,
+		      "Invalid address accepted");
+
+	zassert_not_null(net_if_ipv6_addr_add(iface, &addr6,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add IPv6 address");
+	zassert_not_null(net_if_ipv4_addr_add(iface, &addr4,
+					      NET_ADDR_MANUAL, 0),
+			 "Cannot add IPv4 address");
+}
+
+static void test_invalid_fd(void)
+{
+	char buf[4];
+
+	zassert_equal(recv(-1, buf, sizeof(buf), 0), -1, "recv succeeded");
+	zassert_equal(errno, EBADF, "Wrong errno");
+
+	zassert_equal(close(CONFIG_NET_MAX_CONTEXTS), -1, "close succeeded");
+	zassert_equal(errno, EBADF, "Wrong errno");
+}
+
+static void udp_send_recv(sa_family_t family)
+{
+	struct sockaddr server_addr, from;
+	socklen_t from_len = sizeof(from);
+	int server, client;
+	char buf[32];
+	ssize_t len;
+
+	udp_pair(family, &server, &client, &server_addr);
+
+	len = sendto(client, test_data, sizeof(test_data), 0, &server_addr,
+		     addr_len(family));
+	zassert_equal(len, sizeof(test_data), "sendto failed");
+
+	/* Peeking leaves the datagram in the queue */
+	len = recv(server, buf, sizeof(buf), MSG_PEEK);
+	zassert_equal(len, sizeof(test_data), "recv peek failed");
+
+	memset(buf, 0, sizeof(buf));
+	len = recvfrom(server, buf, sizeof(buf), 0, &from, &from_len);
+	zassert_equal(len, sizeof(test_data), "recvfrom failed");
+	zassert_equal(memcmp(buf, test_data, len), 0, "Wrong data");
+	zassert_equal(from_len, addr_len(family), "Wrong address length");
+	zassert_equal(from.family, family, "Wrong address family");
+
+	if (family == AF_INET6) {
+		zassert_equal(net_sin6(&from)->sin6_port, htons(CLIENT_PORT),
+			      "Wrong source port");
+	} else {
+		zassert_equal(net_sin(&from)->sin_port, htons(CLIENT_PORT),
+			      "Wrong source port");
+	}
+
+	/* Reply to the sender, then check that truncation works */
+	len = sendto(server, test_data, sizeof(test_data), 0, &from,
+		     from_len);
+	zassert_equal(len, sizeof(test_data), "sendto reply failed");
+
+	len = recv(client, buf, 4, 0);
+	zassert_equal(len, 4, "Datagram not truncated");
+
+	len = recv(client, buf, sizeof(buf), MSG_DONTWAIT);
+	zassert_equal(len, -1, "Truncated datagram was not discarded");
+	zassert_equal(errno, EAGAIN, "Wrong errno");
+
+	zassert_equal(close(server), 0, "close failed");
+	zassert_equal(close(client), 0, "close failed");
+}
+
+static void test_udp_v4(void)
+{
+	udp_send_recv(AF_INET);
+}
+
+static void test_udp_v6(void)
+{
+	udp_send_recv(AF_INET6);
+}
+
+static void test_nonblock(void)
+{
+	struct sockaddr server_addr;
+	int server, client;
+	char buf[32];
+
+	udp_pair(AF_INET6, &server, &client, &server_addr);
+
+	zassert_equal(fcntl(server, F_GETFL, 0), 0, "Blocking by default");
+	zassert_equal(fcntl(server, F_SETFL, O_NONBLOCK), 0, "fcntl failed");
+	zassert_equal(fcntl(server, F_GETFL, 0), O_NONBLOCK,
+		      "O_NONBLOCK not set");
+
+	zassert_equal(recv(server, buf, sizeof(buf), 0), -1,
+		      "recv did not fail");
+	zassert_equal(errno, EAGAIN, "Wrong errno");
+
+	zassert_equal(fcntl(server, F_SETFL, 0), 0, "fcntl failed");
+	zassert_equal(fcntl(server, F_GETFL, 0), 0, "O_NONBLOCK still set");
+
+	close(server);
+	close(client);
+}
+
+static void test_poll(void)
+{
+	struct sockaddr server_addr;
+	struct pollfd fds[2];
+	int server, client;
+	char buf[32];
+
+	udp_pair(AF_INET6, &server, &client, &server_addr);
+
+	fds[0].fd = server;
+	fds[0].events = POLLIN;
+	fds[1].fd = client;
+	fds[1].events = POLLIN;
+
+	zassert_equal(poll(fds, 2, 0), 0, "Nothing should be ready");
+	zassert_equal(poll(fds, 2, 10), 0, "Nothing should be ready");
+
+	sendto(client, test_data, sizeof(test_data), 0, &server_addr,
+	       addr_len(AF_INET6));
+
+	zassert_equal(poll(fds, 2, -1), 1, "Server should be ready");
+	zassert_equal(fds[0].revents, POLLIN, "Wrong server events");
+	zassert_equal(fds[1].revents, 0, "Wrong client events");
+
+	recv(server, buf, sizeof(buf), 0);
+
+	zassert_equal(poll(fds, 2, 0), 0, "Nothing should be ready");
+
+	/* A closed socket is reported, not waited for */
+	close(client);
+
+	zassert_equal(poll(fds, 2, 0), 1, "Closed socket not reported");
+	zassert_equal(fds[1].revents, POLLNVAL, "Wrong closed events");
+
+	close(server);
+
+	/* Nothing to wait for, an infinite timeout must not block */
+	zassert_equal(poll(fds, 0, -1), 0, "Nothing should be ready");
+}
+
+static void test_tcp_listen(void)
+{
+	struct sockaddr addr;
+	int sock;
+
+	prepare_addr(AF_INET, &addr, SERVER_PORT);
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(sock >= 0, "Cannot create socket");
+
+	zassert_equal(accept(sock, NULL, NULL), -1, "Not listening");
+	zassert_equal(errno, EINVAL, "Wrong errno");
+
+	zassert_equal(bind(sock, &addr, sizeof(struct sockaddr_in)), 0,
+		      "bind failed");
+	zassert_equal(listen(sock, 1), 0, "listen failed");
+
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+
+	zassert_equal(accept(sock, NULL, NULL), -1, "Nothing to accept");
+	zassert_equal(errno, EAGAIN, "Wrong errno");
+
+	close(sock);
+}
+
+/* Not a pass/fail test, shows the cost of a datagram round trip through
+ * the socket queues.
+ */
+static void test_udp_echo_cycles(void)
+{
+	struct sockaddr server_addr, from;
+	socklen_t from_len;
+	int server, client, i;
+	u32_t start, cycles;
+	char buf[32];
+
+	udp_pair(AF_INET, &server, &client, &server_addr);
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ECHO_COUNT; i++) {
+		sendto(client, test_data, sizeof(test_data), 0, &server_addr,
+		       sizeof(struct sockaddr_in));
+
+		from_len = sizeof(from);
+		recvfrom(server, buf, sizeof(buf), 0, &from, &from_len);
+		sendto(server, buf, sizeof(test_data), 0, &from, from_len);
+
+		zassert_equal(recv(client, buf, sizeof(buf), 0),
+			      sizeof(test_data), "Echo failed");
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("%d UDP echoes, %u cycles per echo\n", ECHO_COUNT,
+	       cycles / ECHO_COUNT);
+
+	close(server);
+	close(client);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(socket_tests,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_invalid_fd),
+			 ztest_unit_test(test_udp_v4),
+			 ztest_unit_test(test_udp_v6),
+			 ztest_unit_test(test_nonblock),
+			 ztest_unit_test(test_poll),
+			 ztest_unit_test(test_tcp_listen),
+			 ztest_unit_test(test_udp_echo_cycles));
+
+	ztest_run_test_suite(socket_tests);
+}
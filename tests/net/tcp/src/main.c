@@ -175,6 +175,40 @@ static int tester_send(struct net_if *iface, struct net_pkt *pkt)
 	return 0;
 }
 
+/* Connection requests injected by the connection rate test, all of them
+ * come from the same unconfigured address with consecutive ports.
+ */
+#define CONN_COUNT 12
+#define CONN_PORT 20000
+#define CONN_IRS 1000
+
+static struct in_addr conn_v4_inaddr = { { { 198, 51, 100, 1 } } };
+static u32_t conn_iss[CONN_COUNT];
+static struct net_context *conn_ctx[CONN_COUNT];
+static int conn_accepted;
+static int conn_resets;
+static u32_t conn_reset_seq;
+static struct k_sem conn_synack;
+static struct k_sem conn_accept;
+
+static void conn_reply_recv(struct net_pkt *pkt)
+{
+	int i = ntohs(NET_TCP_HDR(pkt)->dst_port) - CONN_PORT;
+
+	if (net_pkt_family(pkt) != AF_INET || i < 0 || i >= CONN_COUNT) {
+		return;
+	}
+
+	if (NET_TCP_FLAGS(pkt) == (NET_TCP_SYN | NET_TCP_ACK)) {
+		conn_iss[i] = sys_get_be32(NET_TCP_HDR(pkt)->seq);
+		k_sem_give(&conn_synack);
+	} else if (NET_TCP_FLAGS(pkt) & NET_TCP_RST) {
+		conn_reset_seq = sys_get_be32(NET_TCP_HDR(pkt)->seq);
+		conn_resets++;
+		k_sem_give(&conn_synack);
+	}
+}
+
 static int tester_send_peer(struct net_if *iface, struct net_pkt *pkt)
 {
 	if (!pkt->frags) {
@@ -184,6 +218,8 @@ static int tester_send_peer(struct net_if *iface, struct net_pkt *pkt)
 
 	DBG("Peer data was sent successfully\n");
 
+	conn_reply_recv(pkt);
+
 	net_pkt_unref(pkt);
 
 	return 0;
@@ -1289,6 +1325,11 @@ static void accept_v4_cb(struct net_context *new_context,
 			 void *user_data)
 {
 	DBG("error %d\n", error);
+
+	if (!error && conn_accepted < CONN_COUNT) {
+		conn_ctx[conn_accepted++] = new_context;
+		k_sem_give(&conn_accept);
+	}
 }
 
 static bool test_init_tcp_accept(void)
@@ -1326,6 +1367,328 @@ static bool test_init_tcp_accept(void)
 	return true;
 }
 
+static void send_conn_v4_data(int i, u16_t port, u8_t flags, u32_t seq,
+			      u32_t ack, const char *data, u16_t len)
+{
+	struct net_if *iface = net_if_get_default() + 1;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+	frag = net_pkt_get_frag(pkt, K_FOREVER);
+
+	net_pkt_frag_add(pkt, frag);
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_family(pkt, AF_INET);
+
+	setup_ipv4_tcp(pkt, &conn_v4_inaddr, &peer_v4_inaddr,
+		       CONN_PORT + i, port);
+
+	NET_IPV4_HDR(pkt)->len[1] += len;
+
+	NET_TCP_HDR(pkt)->offset = NET_TCPH_LEN << 2;
+	NET_TCP_HDR(pkt)->flags = flags;
+	sys_put_be32(seq, NET_TCP_HDR(pkt)->seq);
+	sys_put_be32(ack, NET_TCP_HDR(pkt)->ack);
+	sys_put_be16(NET_TCP_MAX_WIN, NET_TCP_HDR(pkt)->wnd);
+
+	if (len) {
+		memcpy(net_buf_add(frag, len), data, len);
+	}
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+	}
+}
+
+static void send_conn_v4_seg(int i, u8_t flags, u32_t seq, u32_t ack)
+{
+	send_conn_v4_data(i, PEER_TCP_PORT, flags, seq, ack, NULL, 0);
+}
+
+static void used_context_cb(struct net_context *context, void *user_data)
+{
+	(*(int *)user_data)++;
+}
+
+static int used_contexts(void)
+{
+	int count = 0;
+
+	net_context_foreach(used_context_cb, &count);
+
+	return count;
+}
+
+/* Opens more connections than CONFIG_NET_TCP_SYN_BACKLOG at once, so that
+ * part of them can only be completed with SYN cookies, and prints the
+ * cost of a handshake.
+ */
+static bool test_v4_connection_rate(void)
+{
+	int used, i;
+	u32_t start, cycles;
+
+	k_sem_init(&conn_synack, 0, UINT_MAX);
+	k_sem_init(&conn_accept, 0, UINT_MAX);
+
+	used = used_contexts();
+	start = k_cycle_get_32();
+
+	for (i = 0; i < CONN_COUNT; i++) {
+		send_conn_v4_seg(i, NET_TCP_SYN, CONN_IRS * i, 0);
+	}
+
+	for (i = 0; i < CONN_COUNT; i++) {
+		if (k_sem_take(&conn_synack, WAIT_TIME)) {
+			TC_ERROR("SYN-ACK %d not sent\n", i);
+			return false;
+		}
+	}
+
+	if (used_contexts() != used) {
+		TC_ERROR("Connection requests allocated %d contexts\n",
+			 used_contexts() - used);
+		return false;
+	}
+
+	for (i = 0; i < CONN_COUNT; i++) {
+		send_conn_v4_seg(i, NET_TCP_ACK, CONN_IRS * i + 1,
+				 conn_iss[i] + 1);
+	}
+
+	for (i = 0; i < CONN_COUNT; i++) {
+		if (k_sem_take(&conn_accept, WAIT_TIME)) {
+			TC_ERROR("Only %d of %d connections accepted\n",
+				 conn_accepted, CONN_COUNT);
+			return false;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("%d connections (%d half-open max), %u cycles per "
+	       "connection\n", CONN_COUNT, CONFIG_NET_TCP_SYN_BACKLOG,
+	       cycles / CONN_COUNT);
+
+	if (conn_resets) {
+		TC_ERROR("%d connections reset\n", conn_resets);
+		return false;
+	}
+
+	for (i = 0; i < CONN_COUNT; i++) {
+		net_context_put(conn_ctx[i]);
+		conn_ctx[i] = NULL;
+	}
+
+	return true;
+}
+
+/* An ACK that matches neither a connection request nor a SYN cookie must
+ * be answered with a reset and not allocate a context. The reset takes
+ * its sequence number from the ACK, without touching the listener.
+ */
+static bool test_v4_invalid_ack(void)
+{
+	u32_t send_seq = reply_v4_ctx->tcp->send_seq;
+	u32_t send_ack = reply_v4_ctx->tcp->send_ack;
+	int used = used_contexts();
+
+	conn_accepted = 0;
+	conn_resets = 0;
+
+	send_conn_v4_seg(0, NET_TCP_ACK, CONN_IRS + 1, 0xdeadbeef);
+
+	if (k_sem_take(&conn_synack, WAIT_TIME) || conn_resets != 1) {
+		TC_ERROR("Invalid ACK was not reset\n");
+		return false;
+	}
+
+	if (conn_accepted || used_contexts() != used) {
+		TC_ERROR("Invalid ACK was accepted\n");
+		return false;
+	}
+
+	if (conn_reset_seq != 0xdeadbeef) {
+		TC_ERROR("Reset seq 0x%x is not the ACK\n", conn_reset_seq);
+		return false;
+	}
+
+	if (reply_v4_ctx->tcp->send_seq != send_seq ||
+	    reply_v4_ctx->tcp->send_ack != send_ack) {
+		TC_ERROR("Reset changed the listener sequence numbers\n");
+		return false;
+	}
+
+	return true;
+}
+
+#define BACKLOG_PORT (PEER_TCP_PORT + 1)
+
+static struct net_context *backlog_ctx;
+static int backlog_recv_len;
+static struct k_sem backlog_recv;
+
+static void backlog_recv_cb(struct net_context *context,
+			    struct net_pkt *pkt,
+			    int status,
+			    void *user_data)
+{
+	if (pkt) {
+		backlog_recv_len += net_pkt_appdatalen(pkt);
+		net_pkt_unref(pkt);
+		k_sem_give(&backlog_recv);
+	}
+}
+
+static void backlog_accept_cb(struct net_context *new_context,
+			      struct sockaddr *addr,
+			      socklen_t addrlen,
+			      int error,
+			      void *user_data)
+{
+	if (!error && conn_accepted < CONN_COUNT) {
+		conn_ctx[conn_accepted++] = new_context;
+		net_context_recv(new_context, backlog_recv_cb, K_NO_WAIT,
+				 NULL);
+		k_sem_give(&conn_accept);
+	}
+}
+
+static bool backlog_syn(int i)
+{
+	send_conn_v4_data(i, BACKLOG_PORT, NET_TCP_SYN, CONN_IRS * i, 0,
+			  NULL, 0);
+
+	if (k_sem_take(&conn_synack, WAIT_TIME) || conn_resets) {
+		TC_ERROR("SYN-ACK %d not sent\n", i);
+		return false;
+	}
+
+	return true;
+}
+
+/* A listener whose accept queue is full resets the connections it
+ * cannot queue, as their peer already considers them established.
+ */
+static bool test_v4_backlog_full(void)
+{
+	struct sockaddr_in addr = peer_v4_addr;
+	int used, i, ret;
+
+	conn_accepted = 0;
+	conn_resets = 0;
+	k_sem_init(&conn_synack, 0, UINT_MAX);
+	k_sem_init(&conn_accept, 0, UINT_MAX);
+
+	ret = net_context_get(AF_INET, SOCK_STREAM, IPPROTO_TCP,
+			      &backlog_ctx);
+	if (ret) {
+		TC_ERROR("Context get backlog test failed (%d)\n", ret);
+		return false;
+	}
+
+	addr.sin_port = htons(BACKLOG_PORT);
+
+	ret = net_context_bind(backlog_ctx, (struct sockaddr *)&addr,
+			       sizeof(addr));
+	if (ret) {
+		TC_ERROR("Context bind backlog test failed (%d)\n", ret);
+		return false;
+	}
+
+	ret = net_context_listen(backlog_ctx, 1);
+	if (ret) {
+		TC_ERROR("Context listen backlog test failed (%d)\n", ret);
+		return false;
+	}
+
+	used = used_contexts();
+
+	for (i = 0; i < 2; i++) {
+		if (!backlog_syn(i)) {
+			return false;
+		}
+	}
+
+	/* The first connection is queued, the second one reset */
+	for (i = 0; i < 2; i++) {
+		send_conn_v4_data(i, BACKLOG_PORT, NET_TCP_ACK,
+				  CONN_IRS * i + 1, conn_iss[i] + 1, NULL, 0);
+	}
+
+	if (k_sem_take(&conn_synack, WAIT_TIME) || conn_resets != 1) {
+		TC_ERROR("Connection over the backlog was not reset\n");
+		return false;
+	}
+
+	if (conn_reset_seq != conn_iss[1] + 1) {
+		TC_ERROR("Reset seq 0x%x is not the ACK\n", conn_reset_seq);
+		return false;
+	}
+
+	if (used_contexts() != used + 1) {
+		TC_ERROR("%d connections queued instead of 1\n",
+			 used_contexts() - used);
+		return false;
+	}
+
+	ret = net_context_accept(backlog_ctx, backlog_accept_cb, K_NO_WAIT,
+				 NULL);
+	if (ret) {
+		TC_ERROR("Context accept backlog test failed (%d)\n", ret);
+		return false;
+	}
+
+	if (k_sem_take(&conn_accept, K_NO_WAIT)) {
+		TC_ERROR("Queued connection not accepted\n");
+		return false;
+	}
+
+	return true;
+}
+
+/* A final ACK carrying data establishes the connection, its data being
+ * received by the new connection.
+ */
+static bool test_v4_ack_with_data(void)
+{
+	static const char data[] = "data";
+	int i;
+
+	conn_resets = 0;
+	k_sem_init(&backlog_recv, 0, UINT_MAX);
+
+	if (!backlog_syn(2)) {
+		return false;
+	}
+
+	send_conn_v4_data(2, BACKLOG_PORT, NET_TCP_ACK | NET_TCP_PSH,
+			  CONN_IRS * 2 + 1, conn_iss[2] + 1,
+			  data, sizeof(data));
+
+	if (k_sem_take(&conn_accept, WAIT_TIME)) {
+		TC_ERROR("ACK with data did not establish the connection\n");
+		return false;
+	}
+
+	if (k_sem_take(&backlog_recv, WAIT_TIME) ||
+	    backlog_recv_len != sizeof(data)) {
+		TC_ERROR("Received %d bytes instead of %zu\n",
+			 backlog_recv_len, sizeof(data));
+		return false;
+	}
+
+	for (i = 0; i < conn_accepted; i++) {
+		net_context_put(conn_ctx[i]);
+		conn_ctx[i] = NULL;
+	}
+
+	net_context_put(backlog_ctx);
+
+	return true;
+}
+
 #if 0
 static bool test_init_tcp_connect(void)
 {
@@ -1474,6 +1837,10 @@ static const struct {
 	{ "test IPv4 TCP seq check", test_v4_seq_check },
 	{ "test TCP reply context init", test_init_tcp_reply_context },
 	{ "test TCP accept init", test_init_tcp_accept },
+	{ "test IPv4 TCP connection rate", test_v4_connection_rate },
+	{ "test IPv4 TCP invalid ACK", test_v4_invalid_ack },
+	{ "test IPv4 TCP backlog full", test_v4_backlog_full },
+	{ "test IPv4 TCP ACK with data", test_v4_ack_with_data },
 #if 0
 	/* TBD: more tests are needed */
 	{ "test TCP connect init", test_init_tcp_connect },
@@ -0,0 +1,237 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <misc/printk.h>
+#include <linker/sections.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+
+#if defined(CONFIG_NET_DEBUG_IF)
+#define DBG(fmt, ...) printk(fmt, ##__VA_ARGS__)
+#else
+#define DBG(fmt, ...)
+#endif
+
+#define WAIT_TIME 250
+#define MAX_SENT 8
+
+static struct net_if *iface;
+static struct k_sem wait_data;
+
+/* Priorities of the packets in the order the driver saw them */
+static u8_t sent_prio[MAX_SENT];
+static int sent_count;
+
+static struct in6_addr mcast_addr = { { { 0xff, 0x02, 0, 0, 0, 0, 0, 0,
+					  0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+struct net_tc_test {
+	u8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_tc_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_tc_iface_init(struct net_if *iface)
+{
+	struct net_tc_test *data = net_if_get_device(iface)->driver_data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = 0x01;
+
+	net_if_set_link_addr(iface, data->mac_addr,
+			     sizeof(struct net_eth_addr), NET_LINK_ETHERNET);
+}
+
+static int sender_iface(struct net_if *iface, struct net_pkt *pkt)
+{
+	if (!pkt->frags) {
+		DBG("No data to send!\n");
+		return -ENODATA;
+	}
+
+	if (sent_count < MAX_SENT) {
+		sent_prio[sent_count++] = net_pkt_priority(pkt);
+	}
+
+	net_pkt_unref(pkt);
+
+	k_sem_give(&wait_data);
+
+	return 0;
+}
+
+static struct net_tc_test net_tc_data;
+
+static struct net_if_api net_tc_if_api = {
+	.init = net_tc_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT(net_tc_test, "net_tc_test",
+		net_tc_dev_init, &net_tc_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_tc_if_api, DUMMY_L2,
+		NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static struct net_pkt *create_pkt(u8_t prio, u8_t tclass, u8_t nexthdr)
+{
+	struct net_ipv6_hdr *hdr;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+
+	pkt = net_pkt_get_reserve_tx(0, K_FOREVER);
+	frag = net_pkt_get_frag(pkt, K_FOREVER);
+	net_pkt_frag_add(pkt, frag);
+
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_family(pkt, AF_INET6);
+	net_pkt_set_ip_hdr_len(pkt, sizeof(struct net_ipv6_hdr));
+	net_pkt_set_priority(pkt, prio);
+
+	hdr = (struct net_ipv6_hdr *)net_buf_add(frag, sizeof(*hdr) + 8);
+	memset(hdr, 0, sizeof(*hdr) + 8);
+
+	hdr->vtc = 0x60 | (tclass >> 4);
+	hdr->tcflow = tclass << 4;
+	hdr->len[1] = 8;
+	hdr->nexthdr = nexthdr;
+	hdr->hop_limit = 1;
+	net_ipaddr_copy(&hdr->dst, &mcast_addr);
+
+	return pkt;
+}
+
+static void wait_sent(int count)
+{
+	while (count--) {
+		zassert_false(k_sem_take(&wait_data, WAIT_TIME),
+			      "Timeout while waiting data");
+	}
+}
+
+static void tc_setup(void)
+{
+	k_sem_init(&wait_data, 0, UINT_MAX);
+
+	iface = net_if_get_default();
+	zassert_not_null(iface, "No interface");
+}
+
+static void tc_priority2tc(void)
+{
+	/* IEEE 802.1Q mapping for four traffic classes */
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_BK), 0, "BK");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_BE), 0, "BE");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_EE), 1, "EE");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_CA), 1, "CA");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_VI), 2, "VI");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_VO), 2, "VO");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_IC), 3, "IC");
+	zassert_equal(net_if_tx_priority2tc(NET_PRIORITY_NC), 3, "NC");
+
+	/* Invalid values are treated as best effort */
+	zassert_equal(net_if_tx_priority2tc(NET_MAX_PRIORITIES), 0,
+		      "invalid");
+}
+
+static void tc_strict_priority(void)
+{
+	static const u8_t prios[] = { NET_PRIORITY_BK, NET_PRIORITY_BE,
+				      NET_PRIORITY_VO, NET_PRIORITY_NC };
+	int i;
+
+	sent_count = 0;
+
+	/* Queue everything before the TX thread gets a chance to run */
+	k_sched_lock();
+
+	for (i = 0; i < ARRAY_SIZE(prios); i++) {
+		net_if_queue_tx(iface, create_pkt(prios[i], 0,
+						  IPPROTO_UDP));
+	}
+
+	k_sched_unlock();
+
+	wait_sent(ARRAY_SIZE(prios));
+
+	zassert_equal(sent_count, ARRAY_SIZE(prios), "Packets missing");
+	zassert_equal(sent_prio[0], NET_PRIORITY_NC, "NC not first");
+	zassert_equal(sent_prio[1], NET_PRIORITY_VO, "VO not second");
+
+	/* Same traffic class keeps the FIFO order */
+	zassert_equal(sent_prio[2], NET_PRIORITY_BK, "BK not third");
+	zassert_equal(sent_prio[3], NET_PRIORITY_BE, "BE not last");
+}
+
+static void tc_classify(void)
+{
+	sent_count = 0;
+
+	/* ICMPv6 (ND, RPL, MLD) is network control */
+	zassert_equal(net_if_send_data(iface,
+				       create_pkt(NET_PRIORITY_BE, 0,
+						  IPPROTO_ICMPV6)),
+		      NET_OK, "Send failed");
+
+	/* DSCP EF (46) maps to voice */
+	zassert_equal(net_if_send_data(iface,
+				       create_pkt(NET_PRIORITY_BE, 46 << 2,
+						  IPPROTO_UDP)),
+		      NET_OK, "Send failed");
+
+	/* Default DSCP stays best effort */
+	zassert_equal(net_if_send_data(iface,
+				       create_pkt(NET_PRIORITY_BE, 0,
+						  IPPROTO_UDP)),
+		      NET_OK, "Send failed");
+
+	/* Explicit priority set by the sender is not overridden */
+	zassert_equal(net_if_send_data(iface,
+				       create_pkt(NET_PRIORITY_BK, 46 << 2,
+						  IPPROTO_UDP)),
+		      NET_OK, "Send failed");
+
+	wait_sent(4);
+
+	zassert_equal(sent_prio[0], NET_PRIORITY_NC, "ICMPv6 not NC");
+	zassert_equal(sent_prio[1], NET_PRIORITY_VO, "EF not VO");
+	zassert_equal(sent_prio[2], NET_PRIORITY_BE, "default not BE");
+	zassert_equal(sent_prio[3], NET_PRIORITY_BK, "explicit prio lost");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_traffic_class_test,
+			 ztest_unit_test(tc_setup),
+			 ztest_unit_test(tc_priority2tc),
+			 ztest_unit_test(tc_strict_priority),
+			 ztest_unit_test(tc_classify));
+
+	ztest_run_test_suite(net_traffic_class_test);
+}
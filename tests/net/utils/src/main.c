@@ -368,6 +368,177 @@ static bool run_tests(void)
 	return true;
 }
 
+/* Straightforward byte-by-byte implementation used as a reference for
+ * the optimized checksum code.
+ */
+static u16_t chksum_ref(u16_t sum, const u8_t *ptr, u16_t len)
+{
+	u16_t tmp;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		tmp = (i % 2) ? ptr[i] : ptr[i] << 8;
+		sum += tmp;
+		if (sum < tmp) {
+			sum++;
+		}
+	}
+
+	return sum;
+}
+
+#define CHKSUM_PAYLOAD_LEN 1232
+#define CHKSUM_BENCH_ROUNDS 100
+
+static u8_t chksum_payload[CHKSUM_PAYLOAD_LEN];
+
+/* Create an IPv6 UDP packet whose payload is split to fragments of
+ * frag_len bytes, each fragment data starting at the given offset so
+ * that different alignments are exercised.
+ */
+static struct net_pkt *chksum_create_pkt(int frag_len, int align,
+					 u16_t payload_len)
+{
+	struct net_ipv6_hdr *hdr;
+	struct net_pkt *pkt;
+	struct net_buf *frag;
+	u16_t pos = 0;
+
+	pkt = net_pkt_get_reserve_rx(0, K_FOREVER);
+	frag = net_pkt_get_reserve_rx_data(0, K_FOREVER);
+	net_pkt_frag_add(pkt, frag);
+
+	hdr = (struct net_ipv6_hdr *)net_buf_add(frag, sizeof(*hdr));
+	memcpy(hdr, pkt1, sizeof(*hdr));
+	hdr->nexthdr = IPPROTO_UDP;
+	hdr->len[0] = payload_len >> 8;
+	hdr->len[1] = payload_len;
+
+	net_pkt_set_ip_hdr_len(pkt, sizeof(struct net_ipv6_hdr));
+	net_pkt_set_family(pkt, AF_INET6);
+	net_pkt_set_ipv6_ext_len(pkt, 0);
+
+	while (pos < payload_len) {
+		u16_t len = min(frag_len, payload_len - pos);
+
+		frag = net_pkt_get_reserve_rx_data(align, K_FOREVER);
+		len = min(len, net_buf_tailroom(frag));
+
+		memcpy(net_buf_add(frag, len), chksum_payload + pos, len);
+		net_pkt_frag_add(pkt, frag);
+
+		pos += len;
+	}
+
+	return pkt;
+}
+
+static u16_t chksum_expected(struct net_pkt *pkt, u16_t payload_len)
+{
+	u16_t sum;
+
+	sum = chksum_ref(payload_len + IPPROTO_UDP,
+			 (u8_t *)&NET_IPV6_HDR(pkt)->src,
+			 2 * sizeof(struct in6_addr));
+	sum = chksum_ref(sum, chksum_payload, payload_len);
+
+	return (sum == 0) ? 0xffff : htons(sum);
+}
+
+static bool run_chksum_tests(void)
+{
+	static const u8_t frag_lens[] = { 1, 3, 7, 64, 77, 128 };
+	u32_t start, opt_cycles, ref_cycles;
+	struct net_pkt *pkt;
+	u16_t sum, payload_len;
+	u8_t old[6], hdr[40];
+	int i, align, round;
+
+	TC_START("test_chksum_fragments");
+
+	for (i = 0; i < sizeof(chksum_payload); i++) {
+		chksum_payload[i] = sys_rand32_get();
+	}
+
+	for (i = 0; i < ARRAY_SIZE(frag_lens); i++) {
+		for (align = 0; align < 4; align++) {
+			payload_len = (frag_lens[i] < 64) ? 11 + align :
+				      301 + align;
+
+			pkt = chksum_create_pkt(frag_lens[i], align,
+						payload_len);
+
+			sum = net_calc_chksum(pkt, IPPROTO_UDP);
+			if (sum != chksum_expected(pkt, payload_len)) {
+				printk("Invalid chksum 0x%x, frag len %d "
+				       "align %d, should be 0x%x\n", sum,
+				       frag_lens[i], align,
+				       chksum_expected(pkt, payload_len));
+				net_pkt_unref(pkt);
+				TC_END(FAIL, "failed\n");
+				return false;
+			}
+
+			net_pkt_unref(pkt);
+		}
+	}
+
+	TC_END(PASS, "passed\n");
+
+	TC_START("test_chksum_update");
+
+	memcpy(hdr, pkt2, sizeof(hdr));
+	sum = htons(~chksum_ref(0, hdr, sizeof(hdr)));
+
+	for (i = 0; i + sizeof(old) <= sizeof(hdr); i += 2) {
+		memcpy(old, &hdr[i], sizeof(old));
+		hdr[i] ^= 0x5a;
+		hdr[i + 3] += 0x11;
+		hdr[i + 5] = sys_rand32_get();
+
+		sum = net_calc_chksum_update(sum, old, &hdr[i], sizeof(old));
+		if (chksum_ref(ntohs(sum), hdr, sizeof(hdr)) != 0xffff) {
+			printk("Invalid incremental chksum 0x%x at %d\n",
+			       sum, i);
+			TC_END(FAIL, "failed\n");
+			return false;
+		}
+	}
+
+	TC_END(PASS, "passed\n");
+
+	TC_START("test_chksum_benchmark");
+
+	pkt = chksum_create_pkt(128, 0, sizeof(chksum_payload));
+
+	start = k_cycle_get_32();
+	for (round = 0; round < CHKSUM_BENCH_ROUNDS; round++) {
+		sum = net_calc_chksum(pkt, IPPROTO_UDP);
+	}
+	opt_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (round = 0; round < CHKSUM_BENCH_ROUNDS; round++) {
+		sum = chksum_expected(pkt, sizeof(chksum_payload));
+	}
+	ref_cycles = k_cycle_get_32() - start;
+
+	net_pkt_unref(pkt);
+
+	printk("Checksum of %zu bytes: %u cycles (%u bytes/kcycle), "
+	       "byte-wise reference %u cycles (%u bytes/kcycle)\n",
+	       sizeof(chksum_payload), opt_cycles / CHKSUM_BENCH_ROUNDS,
+	       opt_cycles ? (u32_t)(1000ULL * sizeof(chksum_payload) *
+				    CHKSUM_BENCH_ROUNDS / opt_cycles) : 0,
+	       ref_cycles / CHKSUM_BENCH_ROUNDS,
+	       ref_cycles ? (u32_t)(1000ULL * sizeof(chksum_payload) *
+				    CHKSUM_BENCH_ROUNDS / ref_cycles) : 0);
+
+	TC_END(PASS, "passed\n");
+
+	return true;
+}
+
 struct net_addr_test_data {
 	sa_family_t family;
 	bool pton;
@@ -745,7 +916,7 @@ static bool run_net_addr_tests(void)
 void main(void)
 {
 	k_thread_priority_set(k_current_get(), K_PRIO_COOP(7));
-	if (run_tests() && run_net_addr_tests()) {
+	if (run_tests() && run_chksum_tests() && run_net_addr_tests()) {
 		TC_END_REPORT(TC_PASS);
 	} else {
 		TC_END_REPORT(TC_FAIL);